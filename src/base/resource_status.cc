@@ -27,14 +27,17 @@
 
 namespace firmament {
 
-ResourceStatus::ResourceStatus(ResourceDescriptor* descr,
+ResourceStatus::ResourceStatus(boost::uuids::uuid res_id,
+                               ResourceDescriptor* descr,
                                ResourceTopologyNodeDescriptor* rtnd,
                                const string& endpoint_uri,
                                uint64_t last_heartbeat)
-    : descriptor_(descr),
+    : id_(res_id),
+      descriptor_(descr),
       topology_node_(rtnd),
       endpoint_uri_(endpoint_uri),
-      last_heartbeat_(last_heartbeat) {
+      last_heartbeat_(last_heartbeat),
+      handle_(kInvalidIDHandle) {
 }
 
 }  // namespace firmament
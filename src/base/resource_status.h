@@ -25,18 +25,37 @@
 
 #include <string>
 
+#include <boost/uuid/uuid.hpp>
+
 #include "base/common.h"
 #include "base/resource_desc.pb.h"
 #include "base/resource_topology_node_desc.pb.h"
 
 namespace firmament {
 
+// The dense handle that an IDInterner (misc/id_interner.h) assigns to an ID.
+// N.B.: base/types.h includes this header before it defines its types, so the
+// handle type is defined here.
+typedef uint32_t IDHandle_t;
+// The handle of IDs that have not been assigned one.
+const IDHandle_t kInvalidIDHandle = 0xFFFFFFFF;
+
 class ResourceStatus {
  public:
-  ResourceStatus(ResourceDescriptor* descr,
+  ResourceStatus(boost::uuids::uuid res_id,
+                 ResourceDescriptor* descr,
                  ResourceTopologyNodeDescriptor* rtnd,
                  const string& endpoint_uri,
                  uint64_t last_heartbeat);
+  // The parsed ID of the resource. It is cached here so that callers do not
+  // have to parse descriptor().uuid() every time they need it.
+  // N.B.: we cannot use ResourceID_t here because base/types.h includes this
+  // header before it defines the ID types.
+  inline const boost::uuids::uuid& id() const { return id_; }
+  // The dense handle the flow scheduler assigns to the resource when it is
+  // registered, or kInvalidIDHandle if the resource is not registered with it.
+  inline IDHandle_t handle() const { return handle_; }
+  inline void set_handle(IDHandle_t handle) { handle_ = handle; }
   inline ResourceDescriptor* mutable_descriptor() { return descriptor_; }
   inline const ResourceDescriptor& descriptor() { return *descriptor_; }
   inline const string& location() { return endpoint_uri_; }
@@ -49,10 +68,12 @@ class ResourceStatus {
     return *topology_node_;
   }
  protected:
+  boost::uuids::uuid id_;
   ResourceDescriptor* descriptor_;
   ResourceTopologyNodeDescriptor* topology_node_;
   string endpoint_uri_;
   uint64_t last_heartbeat_;
+  IDHandle_t handle_;
 };
 
 }  // namespace firmament
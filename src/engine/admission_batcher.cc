@@ -0,0 +1,126 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Admission batching for the coordinator.
+
+#include "engine/admission_batcher.h"
+
+#include "misc/utils.h"
+
+namespace firmament {
+
+AdmissionBatcher::AdmissionBatcher(SchedulerInterface* scheduler,
+                                   TimeInterface* time_manager,
+                                   uint64_t window, uint64_t max_batch_size)
+  : scheduler_(scheduler), time_manager_(time_manager), window_(window),
+    max_batch_size_(max_batch_size), num_batches_(0) {
+}
+
+uint64_t AdmissionBatcher::AdmitJob(JobDescriptor* jd_ptr) {
+  CHECK_NOTNULL(jd_ptr);
+  uint64_t admission_time = time_manager_->GetCurrentTimestamp();
+  vector<pair<JobDescriptor*, uint64_t>> batch;
+  {
+    boost::lock_guard<boost::mutex> lock(lock_);
+    if (batch_job_ids_.insert(JobIDFromString(jd_ptr->uuid())).second) {
+      batch_.push_back(pair<JobDescriptor*, uint64_t>(jd_ptr,
+                                                      admission_time));
+    }
+    if (window_ > 0 &&
+        (max_batch_size_ == 0 || batch_.size() < max_batch_size_)) {
+      return 0;
+    }
+    batch.swap(batch_);
+    batch_job_ids_.clear();
+  }
+  return ScheduleJobs(batch);
+}
+
+void AdmissionBatcher::GetDelayHistogram(LatencyHistogram* delay_histogram,
+                                         uint64_t* num_batches) const {
+  boost::lock_guard<boost::mutex> lock(lock_);
+  *delay_histogram = delay_histogram_;
+  *num_batches = num_batches_;
+}
+
+uint64_t AdmissionBatcher::ScheduleBatch() {
+  vector<pair<JobDescriptor*, uint64_t>> batch;
+  {
+    boost::lock_guard<boost::mutex> lock(lock_);
+    batch.swap(batch_);
+    batch_job_ids_.clear();
+  }
+  return ScheduleJobs(batch);
+}
+
+uint64_t AdmissionBatcher::ScheduleBatchIfDue() {
+  {
+    boost::lock_guard<boost::mutex> lock(lock_);
+    // The first job of the batch has waited the longest.
+    if (batch_.empty() ||
+        time_manager_->GetCurrentTimestamp() < batch_[0].second + window_) {
+      return 0;
+    }
+  }
+  return ScheduleBatch();
+}
+
+uint64_t AdmissionBatcher::ScheduleJobs(
+    const vector<pair<JobDescriptor*, uint64_t>>& batch) {
+  if (batch.empty()) {
+    return 0;
+  }
+  uint64_t start_time = time_manager_->GetCurrentTimestamp();
+  vector<JobDescriptor*> jds;
+  vector<uint64_t> admission_times;
+  for (auto& jd_admission_time : batch) {
+    JobDescriptor* jd_ptr = jd_admission_time.first;
+    // The job may have finished while it was waiting in the batch. Adding it
+    // again would make the scheduler track it again.
+    if (jd_ptr->state() == JobDescriptor::COMPLETED ||
+        jd_ptr->state() == JobDescriptor::FAILED ||
+        jd_ptr->state() == JobDescriptor::ABORTED) {
+      continue;
+    }
+    // The jobs may have changed since they were last scheduled (e.g., tasks
+    // may have been spawned), so we add them again for the scheduler to find
+    // their runnable tasks.
+    scheduler_->AddJob(jd_ptr);
+    jds.push_back(jd_ptr);
+    admission_times.push_back(jd_admission_time.second);
+  }
+  if (jds.empty()) {
+    return 0;
+  }
+  scheduler::SchedulerStats scheduler_stats;
+  uint64_t num_scheduled_tasks = scheduler_->ScheduleJobs(jds,
+                                                          &scheduler_stats);
+  LOG(INFO) << "Scheduled " << num_scheduled_tasks << " tasks for a batch of "
+            << jds.size() << " jobs";
+  boost::lock_guard<boost::mutex> lock(lock_);
+  for (auto& admission_time : admission_times) {
+    delay_histogram_.Record(
+        start_time > admission_time ? start_time - admission_time : 0);
+  }
+  num_batches_++;
+  return num_scheduled_tasks;
+}
+
+}  // namespace firmament
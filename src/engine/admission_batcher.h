@@ -0,0 +1,116 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Admission batching for the coordinator. Instead of running the scheduler
+// for every submitted job and every task event, the coordinator admits the
+// affected jobs into a batch, which is scheduled in a single scheduler run
+// once the admission window has passed or the batch is full.
+
+#ifndef FIRMAMENT_ENGINE_ADMISSION_BATCHER_H
+#define FIRMAMENT_ENGINE_ADMISSION_BATCHER_H
+
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "base/common.h"
+#include "base/job_desc.pb.h"
+#include "base/types.h"
+#include "misc/latency_histogram.h"
+#include "misc/time_interface.h"
+#include "scheduling/scheduler_interface.h"
+
+namespace firmament {
+
+using scheduler::SchedulerInterface;
+
+class AdmissionBatcher {
+ public:
+  /**
+   * @param scheduler the scheduler that schedules the batches
+   * @param time_manager the source of the admission times
+   * @param window the time (in microseconds) for which a batch collects jobs
+   * after its first job has been admitted; 0 schedules every job as soon as
+   * it is admitted
+   * @param max_batch_size the number of jobs at which a batch is scheduled
+   * before its window has passed; 0 for no limit
+   */
+  AdmissionBatcher(SchedulerInterface* scheduler, TimeInterface* time_manager,
+                   uint64_t window, uint64_t max_batch_size);
+
+  /**
+   * Admits a job that may have new runnable tasks. A job that is already in
+   * the current batch keeps its original admission time.
+   * @param jd_ptr the descriptor of the job
+   * @return the number of tasks scheduled, if admitting the job caused a
+   * scheduler run
+   */
+  uint64_t AdmitJob(JobDescriptor* jd_ptr);
+
+  /**
+   * Copies the histogram of the time (in microseconds) the admitted jobs
+   * waited for their batch to be scheduled.
+   * @param delay_histogram set to the histogram
+   * @param num_batches set to the number of batches scheduled
+   */
+  void GetDelayHistogram(LatencyHistogram* delay_histogram,
+                         uint64_t* num_batches) const;
+
+  /**
+   * Schedules the current batch, if it is not empty.
+   * @return the number of tasks scheduled
+   */
+  uint64_t ScheduleBatch();
+
+  /**
+   * Schedules the current batch if its admission window has passed. The
+   * coordinator calls this periodically.
+   * @return the number of tasks scheduled
+   */
+  uint64_t ScheduleBatchIfDue();
+
+ private:
+  /**
+   * Schedules the jobs of a batch that has been removed from batch_. Must be
+   * called without holding lock_.
+   */
+  uint64_t ScheduleJobs(const vector<pair<JobDescriptor*, uint64_t>>& batch);
+
+  SchedulerInterface* scheduler_;
+  TimeInterface* time_manager_;
+  uint64_t window_;
+  uint64_t max_batch_size_;
+  // Protects the current batch and the statistics, as jobs are admitted from
+  // the message handlers and the web UI.
+  mutable boost::mutex lock_;
+  // The jobs of the current batch, in admission order, with their admission
+  // times.
+  vector<pair<JobDescriptor*, uint64_t>> batch_;
+  unordered_set<JobID_t, boost::hash<JobID_t>> batch_job_ids_;
+  LatencyHistogram delay_histogram_;
+  uint64_t num_batches_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_ENGINE_ADMISSION_BATCHER_H
@@ -0,0 +1,193 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// AdmissionBatcher class unit tests.
+
+#include <gtest/gtest.h>
+
+#include "base/common.h"
+#include "base/job_desc.pb.h"
+#include "base/task_desc.pb.h"
+#include "engine/admission_batcher.h"
+#include "misc/map-util.h"
+#include "misc/trace_generator.h"
+#include "misc/utils.h"
+#include "scheduling/knowledge_base.h"
+#include "scheduling/simple/simple_scheduler.h"
+#include "storage/simple_object_store.h"
+
+namespace firmament {
+
+using machine::topology::TopologyManager;
+using scheduler::SimpleScheduler;
+
+// Time source that only advances when the test advances it.
+class TestTime : public TimeInterface {
+ public:
+  TestTime() : current_timestamp_(0) {
+  }
+  uint64_t GetCurrentTimestamp() {
+    return current_timestamp_;
+  }
+  void UpdateCurrentTimestamp(uint64_t timestamp) {
+    current_timestamp_ = timestamp;
+  }
+
+ private:
+  uint64_t current_timestamp_;
+};
+
+// The fixture for testing class AdmissionBatcher.
+class AdmissionBatcherTest : public ::testing::Test {
+ protected:
+  AdmissionBatcherTest() :
+    job_map_(new JobMap_t),
+    res_map_(new ResourceMap_t),
+    obj_store_(new store::SimpleObjectStore(GenerateResourceID())),
+    task_map_(new TaskMap_t),
+    trace_generator_(&time_) {
+  }
+
+  virtual void SetUp() {
+    sched_.reset(new SimpleScheduler(job_map_, res_map_, &res_topo_,
+                                     obj_store_, task_map_,
+                                     shared_ptr<KnowledgeBase>(),
+                                     shared_ptr<TopologyManager>(), NULL, NULL,
+                                     GenerateResourceID(), "test",
+                                     &time_, &trace_generator_));
+  }
+
+  // Adds a job with a single task to the job and task maps.
+  JobDescriptor* AddJob() {
+    JobID_t job_id = GenerateJobID();
+    JobDescriptor jd;
+    jd.set_uuid(to_string(job_id));
+    // The root task ID is generated from the job name.
+    jd.set_name(to_string(job_id));
+    CHECK(InsertIfNotPresent(job_map_.get(), job_id, jd));
+    JobDescriptor* jd_ptr = FindOrNull(*job_map_, job_id);
+    TaskDescriptor* rtd_ptr = jd_ptr->mutable_root_task();
+    rtd_ptr->set_uid(GenerateRootTaskID(*jd_ptr));
+    rtd_ptr->set_state(TaskDescriptor::CREATED);
+    rtd_ptr->set_job_id(jd_ptr->uuid());
+    CHECK(InsertIfNotPresent(task_map_.get(), rtd_ptr->uid(), rtd_ptr));
+    return jd_ptr;
+  }
+
+  TestTime time_;
+  scoped_ptr<SimpleScheduler> sched_;
+  shared_ptr<JobMap_t> job_map_;
+  shared_ptr<ResourceMap_t> res_map_;
+  ResourceTopologyNodeDescriptor res_topo_;
+  shared_ptr<store::SimpleObjectStore> obj_store_;
+  shared_ptr<TaskMap_t> task_map_;
+  TraceGenerator trace_generator_;
+};
+
+// Tests that jobs are scheduled as soon as they are admitted if there is no
+// admission window.
+TEST_F(AdmissionBatcherTest, NoWindow) {
+  AdmissionBatcher batcher(sched_.get(), &time_, 0, 0);
+  JobDescriptor* jd_ptr = AddJob();
+  batcher.AdmitJob(jd_ptr);
+  // The scheduler has found the job's runnable task, although there is no
+  // resource to place it on.
+  EXPECT_EQ(jd_ptr->root_task().state(), TaskDescriptor::RUNNABLE);
+  LatencyHistogram delay_histogram;
+  uint64_t num_batches;
+  batcher.GetDelayHistogram(&delay_histogram, &num_batches);
+  EXPECT_EQ(num_batches, 1UL);
+  EXPECT_EQ(delay_histogram.count(), 1UL);
+  EXPECT_EQ(delay_histogram.max(), 0UL);
+}
+
+// Tests that the jobs admitted within the window are scheduled together once
+// the window has passed.
+TEST_F(AdmissionBatcherTest, ScheduleBatchAfterWindow) {
+  AdmissionBatcher batcher(sched_.get(), &time_, 1000, 0);
+  JobDescriptor* jd_ptr1 = AddJob();
+  JobDescriptor* jd_ptr2 = AddJob();
+  batcher.AdmitJob(jd_ptr1);
+  time_.UpdateCurrentTimestamp(400);
+  batcher.AdmitJob(jd_ptr2);
+  // Admitting a job twice does not add it to the batch again.
+  batcher.AdmitJob(jd_ptr1);
+  time_.UpdateCurrentTimestamp(999);
+  batcher.ScheduleBatchIfDue();
+  EXPECT_EQ(jd_ptr1->root_task().state(), TaskDescriptor::CREATED);
+  EXPECT_EQ(jd_ptr2->root_task().state(), TaskDescriptor::CREATED);
+  time_.UpdateCurrentTimestamp(1000);
+  batcher.ScheduleBatchIfDue();
+  EXPECT_EQ(jd_ptr1->root_task().state(), TaskDescriptor::RUNNABLE);
+  EXPECT_EQ(jd_ptr2->root_task().state(), TaskDescriptor::RUNNABLE);
+  LatencyHistogram delay_histogram;
+  uint64_t num_batches;
+  batcher.GetDelayHistogram(&delay_histogram, &num_batches);
+  EXPECT_EQ(num_batches, 1UL);
+  EXPECT_EQ(delay_histogram.count(), 2UL);
+  EXPECT_EQ(delay_histogram.min(), 600UL);
+  EXPECT_EQ(delay_histogram.max(), 1000UL);
+  // The batch is empty now.
+  time_.UpdateCurrentTimestamp(5000);
+  batcher.ScheduleBatchIfDue();
+  batcher.GetDelayHistogram(&delay_histogram, &num_batches);
+  EXPECT_EQ(num_batches, 1UL);
+}
+
+// Tests that a full batch is scheduled before the window has passed.
+TEST_F(AdmissionBatcherTest, ScheduleFullBatch) {
+  AdmissionBatcher batcher(sched_.get(), &time_, 1000, 2);
+  JobDescriptor* jd_ptr1 = AddJob();
+  JobDescriptor* jd_ptr2 = AddJob();
+  batcher.AdmitJob(jd_ptr1);
+  EXPECT_EQ(jd_ptr1->root_task().state(), TaskDescriptor::CREATED);
+  time_.UpdateCurrentTimestamp(10);
+  batcher.AdmitJob(jd_ptr2);
+  EXPECT_EQ(jd_ptr1->root_task().state(), TaskDescriptor::RUNNABLE);
+  EXPECT_EQ(jd_ptr2->root_task().state(), TaskDescriptor::RUNNABLE);
+  LatencyHistogram delay_histogram;
+  uint64_t num_batches;
+  batcher.GetDelayHistogram(&delay_histogram, &num_batches);
+  EXPECT_EQ(num_batches, 1UL);
+  EXPECT_EQ(delay_histogram.max(), 10UL);
+}
+
+// Tests that a job that is admitted after it has completed is not handed to
+// the scheduler again.
+TEST_F(AdmissionBatcherTest, SkipCompletedJob) {
+  AdmissionBatcher batcher(sched_.get(), &time_, 0, 0);
+  JobDescriptor* jd_ptr = AddJob();
+  sched_->HandleJobCompletion(JobIDFromString(jd_ptr->uuid()));
+  batcher.AdmitJob(jd_ptr);
+  EXPECT_EQ(jd_ptr->state(), JobDescriptor::COMPLETED);
+  EXPECT_EQ(jd_ptr->root_task().state(), TaskDescriptor::CREATED);
+  LatencyHistogram delay_histogram;
+  uint64_t num_batches;
+  batcher.GetDelayHistogram(&delay_histogram, &num_batches);
+  EXPECT_EQ(num_batches, 0UL);
+  EXPECT_EQ(delay_histogram.count(), 0UL);
+}
+
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
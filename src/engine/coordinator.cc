@@ -69,9 +69,20 @@ DEFINE_int32(http_ui_port, 8080,
 #endif
 DEFINE_bool(populate_knowledge_base_from_file, false,
             "True if we should load the knowledge base from file.");
+DEFINE_uint64(admission_window, 0, "Time (in microseconds) for which the "
+              "coordinator collects submitted jobs and task events before it "
+              "schedules them in one scheduler run. 0 runs the scheduler for "
+              "every job and event.");
+DEFINE_uint64(admission_batch_size, 0, "Number of jobs at which an admission "
+              "batch is scheduled before the admission window has passed. 0 "
+              "for no limit.");
 
 namespace firmament {
 
+// Maximum time (in microseconds) for which the main loop waits for incoming
+// messages before it checks for due admission batches and heartbeats.
+static const uint64_t kMaxMessageWait = 1000;
+
 Coordinator::Coordinator()
   : Node(GenerateResourceID(
         boost::asio::ip::host_name() + "/" + FLAGS_listen_uri)),
@@ -129,6 +140,10 @@ Coordinator::Coordinator()
                << " specified on coordinator command line!";
   }
 
+  admission_batcher_ =
+    new AdmissionBatcher(scheduler_, time_manager_, FLAGS_admission_window,
+                         FLAGS_admission_batch_size);
+
   // Log information
   LOG(INFO) << "Coordinator starting on host " << FLAGS_listen_uri
             << ", UUID " << uuid_;
@@ -144,6 +159,7 @@ Coordinator::Coordinator()
 }
 
 Coordinator::~Coordinator() {
+  delete admission_batcher_;
   delete trace_generator_;
   delete time_manager_;
   // TODO(malte): check destruction order in C++; c_http_ui_ may already
@@ -202,7 +218,7 @@ void Coordinator::AddResource(ResourceTopologyNodeDescriptor* rtnd,
   VLOG(1) << "Adding resource " << res_id << " to resource map; "
           << "endpoint URI is " << endpoint_uri;
   CHECK(InsertIfNotPresent(associated_resources_.get(), res_id,
-          new ResourceStatus(resource_desc, rtnd, endpoint_uri,
+          new ResourceStatus(res_id, resource_desc, rtnd, endpoint_uri,
                              time_manager_->GetCurrentTimestamp())));
   // Record the machine UUID if this is the local topology
   if (resource_desc->type() == ResourceDescriptor::RESOURCE_MACHINE &&
@@ -264,6 +280,13 @@ void Coordinator::Run() {
     // itself might need to take, and how they can be triggered
     VLOG(3) << "Hello from main loop!";
     AwaitNextMessage();
+    // Handle the messages received by the I/O threads. All changes to the
+    // scheduler's state are made on this thread.
+    HandleQueuedMessages(kMaxMessageWait);
+    ApplyMachineHeartbeats();
+    ApplyTaskHeartbeats();
+    // Run the scheduler for the jobs admitted during the admission window.
+    admission_batcher_->ScheduleBatchIfDue();
     // TODO(malte): wrap this in a timer
     cur_time = time_manager_->GetCurrentTimestamp();
     if (cur_time - last_heartbeat_time > FLAGS_heartbeat_interval) {
@@ -320,60 +343,179 @@ bool Coordinator::HasJobCompleted(const JobDescriptor& jd) {
   return true;
 }
 
+void Coordinator::ApplyMachineHeartbeats() {
+  unordered_map<ResourceID_t, uint64_t> machine_heartbeats;
+  {
+    boost::lock_guard<boost::mutex> lock(machine_heartbeats_lock_);
+    if (machine_heartbeats_.empty())
+      return;
+    machine_heartbeats.swap(machine_heartbeats_);
+  }
+  for (auto& machine_heartbeat : machine_heartbeats) {
+    ResourceStatus* rsp =
+      FindPtrOrNull(*associated_resources_, machine_heartbeat.first);
+    if (!rsp) {
+      LOG(WARNING) << "HEARTBEAT from UNKNOWN resource (uuid: "
+                   << machine_heartbeat.first << ")!";
+      continue;
+    }
+    VLOG(1) << "Recording HEARTBEAT from resource " << machine_heartbeat.first
+            << " (last seen at " << rsp->last_heartbeat() << ")";
+    // Update timestamp
+    rsp->set_last_heartbeat(machine_heartbeat.second);
+  }
+}
+
+void Coordinator::ApplyTaskHeartbeats() {
+  unordered_map<TaskID_t, pair<string, uint64_t>> task_heartbeats;
+  vector<TaskHeartbeatMessage> forwarded_task_heartbeats;
+  {
+    boost::lock_guard<boost::mutex> lock(task_heartbeats_lock_);
+    if (task_heartbeats_.empty() && forwarded_task_heartbeats_.empty())
+      return;
+    task_heartbeats.swap(task_heartbeats_);
+    forwarded_task_heartbeats.swap(forwarded_task_heartbeats_);
+  }
+  for (auto& task_heartbeat : task_heartbeats) {
+    TaskDescriptor* tdp = FindPtrOrNull(*task_table_, task_heartbeat.first);
+    if (!tdp) {
+      LOG(WARNING) << "HEARTBEAT from UNKNOWN task (ID: "
+                   << task_heartbeat.first << ")!";
+      continue;
+    }
+    // Remember the current location from which this task reports
+    tdp->set_last_heartbeat_location(task_heartbeat.second.first);
+    // Remember the heartbeat time
+    tdp->set_last_heartbeat_time(task_heartbeat.second.second);
+  }
+  // If we have a parent coordinator on whose behalf we are managing the
+  // tasks, forward the heartbeats.
+  // TODO(malte): this does not currently perform any aggregation, so we're
+  // likely to DoS the parent coordinator on a large deployment. Instead, we
+  // should only selectively forward heartbeats and aggregate them.
+  for (auto& task_heartbeat : forwarded_task_heartbeats) {
+    BaseMessage bm;
+    bm.mutable_task_heartbeat()->Swap(&task_heartbeat);
+    if (!SendMessageToRemote(parent_chan_, &bm)) {
+      LOG(ERROR) << "Failed to forward heartbeat to parent coordinator!";
+      // Try to re-register
+      RegisterWithCoordinator(parent_chan_);
+    }
+  }
+}
+
 void Coordinator::HandleIncomingMessage(BaseMessage *bm,
                                         const string& remote_endpoint) {
-  uint32_t handled_extensions = 0;
-  // Registration message
-  if (bm->has_registration()) {
-    const RegistrationMessage& msg = bm->registration();
-    HandleRegistrationRequest(msg);
-    handled_extensions++;
+  // Heartbeats are the bulk of the messages. Their statistics samples go to
+  // the knowledge base, which is safe to use from several threads, so we add
+  // them here rather than queueing them behind scheduler runs. The resource
+  // map and the task table are only modified by the main loop, so the
+  // heartbeat times are buffered and the main loop records them. However, the
+  // heartbeats of a resource must not overtake its registration, so we queue
+  // the messages from endpoints that have a queued registration.
+  {
+    boost::lock_guard<boost::mutex> lock(pending_registrations_lock_);
+    if (bm->has_registration()) {
+      pending_registrations_[remote_endpoint]++;
+    }
+    if (pending_registrations_.find(remote_endpoint) !=
+        pending_registrations_.end()) {
+      dispatch_queue_.Push(new BaseMessage(*bm), remote_endpoint);
+      return;
+    }
   }
+  bool handled_heartbeat = false;
   // Resource Heartbeat message
   if (bm->has_heartbeat()) {
     const HeartbeatMessage& msg = bm->heartbeat();
     HandleHeartbeat(msg);
-    handled_extensions++;
+    bm->clear_heartbeat();
+    handled_heartbeat = true;
   }
   // Task heartbeat message
   if (bm->has_task_heartbeat()) {
     const TaskHeartbeatMessage& msg = bm->task_heartbeat();
     HandleTaskHeartbeat(msg);
+    bm->clear_task_heartbeat();
+    handled_heartbeat = true;
+  }
+  if (handled_heartbeat && bm->ByteSize() == 0)
+    return;
+  // The message is owned by the adapter, which reuses its memory once we
+  // return, so the queue gets a copy.
+  dispatch_queue_.Push(new BaseMessage(*bm), remote_endpoint);
+}
+
+void Coordinator::HandleQueuedMessages(uint64_t timeout) {
+  vector<QueuedMessage> messages;
+  dispatch_queue_.PopAll(timeout, &messages);
+  for (auto& message : messages) {
+    HandleQueuedMessage(*message.first, message.second);
+    delete message.first;
+  }
+}
+
+void Coordinator::HandleQueuedMessage(const BaseMessage& bm,
+                                      const string& remote_endpoint) {
+  uint32_t handled_extensions = 0;
+  // Registration message
+  if (bm.has_registration()) {
+    const RegistrationMessage& msg = bm.registration();
+    HandleRegistrationRequest(msg);
+    handled_extensions++;
+    boost::lock_guard<boost::mutex> lock(pending_registrations_lock_);
+    unordered_map<string, uint32_t>::iterator it =
+      pending_registrations_.find(remote_endpoint);
+    CHECK(it != pending_registrations_.end());
+    if (--it->second == 0) {
+      pending_registrations_.erase(it);
+    }
+  }
+  // Heartbeats are only queued if they were received while a registration
+  // from the same endpoint was queued.
+  if (bm.has_heartbeat()) {
+    const HeartbeatMessage& msg = bm.heartbeat();
+    HandleHeartbeat(msg);
+    handled_extensions++;
+  }
+  if (bm.has_task_heartbeat()) {
+    const TaskHeartbeatMessage& msg = bm.task_heartbeat();
+    HandleTaskHeartbeat(msg);
     handled_extensions++;
   }
   // Task state change message
-  if (bm->has_task_state()) {
-    const TaskStateMessage& msg = bm->task_state();
+  if (bm.has_task_state()) {
+    const TaskStateMessage& msg = bm.task_state();
     HandleTaskStateChange(msg);
     handled_extensions++;
   }
   // Task spawn message
-  if (bm->has_task_spawn()) {
-    const TaskSpawnMessage& msg = bm->task_spawn();
+  if (bm.has_task_spawn()) {
+    const TaskSpawnMessage& msg = bm.task_spawn();
     HandleTaskSpawn(msg);
     handled_extensions++;
   }
   // Task info request message
-  if (bm->has_task_info_request()) {
-    const TaskInfoRequestMessage& msg = bm->task_info_request();
+  if (bm.has_task_info_request()) {
+    const TaskInfoRequestMessage& msg = bm.task_info_request();
     HandleTaskInfoRequest(msg, remote_endpoint);
     handled_extensions++;
   }
   // Task delegation message
-  if (bm->has_task_delegation_request()) {
-    const TaskDelegationRequestMessage& msg = bm->task_delegation_request();
+  if (bm.has_task_delegation_request()) {
+    const TaskDelegationRequestMessage& msg = bm.task_delegation_request();
     HandleTaskDelegationRequest(msg, remote_endpoint);
     handled_extensions++;
   }
   // Task delegation request message (at delegatee coordinator)
-  if (bm->has_task_delegation_response()) {
-    const TaskDelegationResponseMessage& msg = bm->task_delegation_response();
+  if (bm.has_task_delegation_response()) {
+    const TaskDelegationResponseMessage& msg = bm.task_delegation_response();
     HandleTaskDelegationResponse(msg, remote_endpoint);
     handled_extensions++;
   }
   // Task kill message
-  if (bm->has_task_kill()) {
-    const TaskKillMessage& msg = bm->task_kill();
+  if (bm.has_task_kill()) {
+    const TaskKillMessage& msg = bm.task_kill();
     if (!KillRunningTask(msg.task_id(), msg.reason())) {
       LOG(ERROR)  << "Failed to kill task " << msg.task_id() << "!";
     }
@@ -382,8 +524,8 @@ void Coordinator::HandleIncomingMessage(BaseMessage *bm,
   // Task final report
   // TODO(malte): The TaskFinalReport protobuf lives in the wrong place (base
   // instead of messages). Move over.
-  if (bm->has_task_final_report()) {
-    const TaskFinalReport& msg = bm->task_final_report();
+  if (bm.has_task_final_report()) {
+    const TaskFinalReport& msg = bm.task_final_report();
     TaskDescriptor *td_ptr = FindPtrOrNull(*task_table_, msg.task_id());
     CHECK_NOTNULL(td_ptr);
     scheduler_->HandleTaskFinalReport(msg, td_ptr);
@@ -392,7 +534,7 @@ void Coordinator::HandleIncomingMessage(BaseMessage *bm,
   // Check that we have handled at least one sub-message
   if (handled_extensions == 0)
     LOG(ERROR) << "Ignored incoming message, no known extension present, "
-               << "so cannot handle it: " << bm->DebugString();
+               << "so cannot handle it: " << bm.DebugString();
 }
 
 void Coordinator::HandleIncomingReceiveError(
@@ -414,22 +556,19 @@ void Coordinator::HandleIncomingReceiveError(
 }
 
 void Coordinator::HandleHeartbeat(const HeartbeatMessage& msg) {
-  boost::uuids::string_generator gen;
-  boost::uuids::uuid uuid = gen(msg.uuid());
-  ResourceStatus* rsp = FindPtrOrNull(*associated_resources_, uuid);
-  if (!rsp) {
-      LOG(WARNING) << "HEARTBEAT from UNKNOWN resource (uuid: "
-              << msg.uuid() << ")!";
-  } else {
-      VLOG(1) << "HEARTBEAT from resource " << msg.uuid()
-              << " (last seen at " << rsp->last_heartbeat() << ")";
-      if (msg.has_load())
-        VLOG(2) << "Remote resource stats: " << msg.load().ShortDebugString();
-      // Update timestamp
-      rsp->set_last_heartbeat(time_manager_->GetCurrentTimestamp());
-      // Record resource statistics sample
-      scheduler_->knowledge_base()->AddMachineSample(msg.load());
+  ResourceID_t res_id = ResourceIDFromString(msg.uuid());
+  VLOG(1) << "HEARTBEAT from resource " << msg.uuid();
+  if (msg.has_load())
+    VLOG(2) << "Remote resource stats: " << msg.load().ShortDebugString();
+  // The resource map may be modified by the main loop concurrently, so the
+  // main loop records the heartbeat in the resource's status. It also warns
+  // about heartbeats from unknown resources.
+  {
+    boost::lock_guard<boost::mutex> lock(machine_heartbeats_lock_);
+    machine_heartbeats_[res_id] = time_manager_->GetCurrentTimestamp();
   }
+  // Record resource statistics sample
+  scheduler_->knowledge_base()->AddMachineSample(msg.load());
 }
 
 void Coordinator::HandleRegistrationRequest(
@@ -464,37 +603,24 @@ void Coordinator::HandleRegistrationRequest(
 
 void Coordinator::HandleTaskHeartbeat(const TaskHeartbeatMessage& msg) {
   TaskID_t task_id = msg.task_id();
-  TaskDescriptor* tdp = FindPtrOrNull(*task_table_, task_id);
-  if (!tdp) {
-    LOG(WARNING) << "HEARTBEAT from UNKNOWN task (ID: "
-                 << task_id << ")!";
-  } else {
-    VLOG(1) << "HEARTBEAT from task " << task_id;
-    // Remember the current location from which this task reports
-    tdp->set_last_heartbeat_location(msg.location());
-    // Remember the heartbeat time
-    tdp->set_last_heartbeat_time(time_manager_->GetCurrentTimestamp());
-    // Process the profiling information submitted by the task, add it to
-    // the knowledge base
-    scheduler_->knowledge_base()->AddTaskSample(msg.stats());
-  }
-
-  // If we have a parent coordinator on whose behalf we are managing this task,
-  // forward the message.
-  // TODO(malte): this does not currently perform any aggregation, so we're
-  // likely to DoS the parent coordinator on a large deployment. Instead, we
-  // should only selectively forward heartbeats and aggregate them.
-  if (parent_chan_ != NULL) {
-    BaseMessage bm;
-    bm.mutable_task_heartbeat()->CopyFrom(msg);
-    if (!SendMessageToRemote(parent_chan_, &bm)) {
-      LOG(ERROR) << "Failed to forward heartbeat to parent coordinator!";
-      // Try to re-register
-      RegisterWithCoordinator(parent_chan_);
+  VLOG(1) << "HEARTBEAT from task " << task_id;
+  // The task descriptor may be modified by the scheduler concurrently, so the
+  // main loop records the heartbeat in it. If the task sends several
+  // heartbeats in the meantime, only the latest one is recorded.
+  // The main loop also owns the channel to the parent coordinator, so it
+  // forwards the heartbeat if there is a parent.
+  {
+    boost::lock_guard<boost::mutex> lock(task_heartbeats_lock_);
+    task_heartbeats_[task_id] =
+      pair<string, uint64_t>(msg.location(),
+                             time_manager_->GetCurrentTimestamp());
+    if (parent_chan_ != NULL) {
+      forwarded_task_heartbeats_.push_back(msg);
     }
-  } else {
-    scheduler_->knowledge_base()->AddTaskSample(msg.stats());
   }
+  // Process the profiling information submitted by the task, add it to the
+  // knowledge base
+  scheduler_->knowledge_base()->AddTaskSample(msg.stats());
 }
 
 void Coordinator::HandleTaskDelegationRequest(
@@ -541,6 +667,10 @@ void Coordinator::HandleTaskDelegationResponse(
                  << remote_endpoint << " FAILED. Trying again to schedule.";
     // Handle the failure by putting the task back into RUNNABLE state
     scheduler_->HandleTaskDelegationFailure(td);
+    // Try again to schedule the task
+    JobDescriptor* jd = DescriptorForJob(td->job_id());
+    CHECK_NOTNULL(jd);
+    admission_batcher_->AdmitJob(jd);
   }
 }
 
@@ -596,10 +726,7 @@ void Coordinator::HandleTaskSpawn(const TaskSpawnMessage& msg) {
   // Run the scheduler for this job
   JobDescriptor* job = FindOrNull(*job_table_, job_id);
   CHECK_NOTNULL(job);
-  scheduler::SchedulerStats scheduler_stats;
-  uint64_t tasks_scheduled = scheduler_->ScheduleJob(job, &scheduler_stats);
-  LOG(INFO) << "Scheduled " << tasks_scheduled << " tasks for job "
-            << job_id;
+  admission_batcher_->AdmitJob(job);
 }
 
 void Coordinator::HandleTaskStateChange(
@@ -655,8 +782,7 @@ void Coordinator::HandleTaskStateChange(
   // the scheduling iteration from within the earlier handler call into the
   // scheduler
   JobDescriptor* jd = DescriptorForJob(td_ptr->job_id());
-  scheduler::SchedulerStats scheduler_stats;
-  scheduler_->ScheduleJob(jd, &scheduler_stats);
+  admission_batcher_->AdmitJob(jd);
   // XXX(malte): tear down the respective connection, cleanup
 }
 
@@ -904,13 +1030,11 @@ const string Coordinator::SubmitJob(const JobDescriptor& job_descriptor) {
         << "Could not find reference to data object ID " << output_id
         << ", which we just added!";
   }
-  // Kick off the scheduler for this job.
-  scheduler::SchedulerStats scheduler_stats;
-  uint64_t num_scheduled =
-    scheduler_->ScheduleJob(FindOrNull(*job_table_, new_job_id),
-                            &scheduler_stats);
-  LOG(INFO) << "Attempted to schedule job " << new_job_id << ", successfully "
-            << "scheduled " << num_scheduled << " tasks.";
+  // Kick off the scheduler for this job, possibly together with other jobs
+  // admitted within the admission window.
+  uint64_t num_scheduled = admission_batcher_->AdmitJob(new_jd);
+  LOG(INFO) << "Admitted job " << new_job_id << " for scheduling, "
+            << num_scheduled << " tasks scheduled so far.";
   // Finally, return the new job's ID
   return to_string(new_job_id);
 }
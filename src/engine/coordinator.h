@@ -47,7 +47,9 @@
 #include "base/reference_desc.pb.h"
 #include "base/resource_desc.pb.h"
 #include "base/resource_topology_node_desc.pb.h"
+#include "engine/admission_batcher.h"
 #include "engine/health_monitor.h"
+#include "engine/message_dispatch_queue.h"
 #include "engine/node.h"
 #include "messages/heartbeat_message.pb.h"
 #include "messages/registration_message.pb.h"
@@ -238,6 +240,9 @@ class Coordinator : public Node,
   const SchedulerInterface* scheduler() const {
     return scheduler_;
   }
+  const AdmissionBatcher* admission_batcher() const {
+    return admission_batcher_;
+  }
 
   bool KillRunningJob(JobID_t job_id);
   bool KillRunningTask(TaskID_t task_id,
@@ -251,7 +256,34 @@ class Coordinator : public Node,
   bool RegisterWithCoordinator(StreamSocketsChannel<BaseMessage>* chan);
   void DetectLocalResources();
   bool HasJobCompleted(const JobDescriptor& jd);
+  /**
+   * Records the resource heartbeats received since the last call in the
+   * resources' statuses. Called from the main loop.
+   */
+  void ApplyMachineHeartbeats();
+  /**
+   * Records the task heartbeats received since the last call in the tasks'
+   * descriptors, and forwards them to the parent coordinator if there is one.
+   * Called from the main loop.
+   */
+  void ApplyTaskHeartbeats();
+  /**
+   * Handles an incoming message on the messaging adapter's I/O thread that
+   * received it. Heartbeats are handled straight away, unless a registration
+   * from the same endpoint is still queued: their samples are added to the
+   * knowledge base, and their times are buffered for the main loop. The other
+   * messages, which may modify the scheduler's state, are queued for the main
+   * loop.
+   */
   void HandleIncomingMessage(BaseMessage *bm, const string& remote_endpoint);
+  /**
+   * Handles the messages queued by HandleIncomingMessage, in the order in
+   * which they were received. Called from the main loop.
+   * @param timeout the maximum time (in microseconds) to wait for a message
+   */
+  void HandleQueuedMessages(uint64_t timeout);
+  void HandleQueuedMessage(const BaseMessage& bm,
+                           const string& remote_endpoint);
   void HandleIncomingReceiveError(const boost::system::error_code& error,
                                   const string& remote_endpoint);
   void HandleHeartbeat(const HeartbeatMessage& msg);
@@ -304,6 +336,27 @@ class Coordinator : public Node,
   // which case this will be a stub that defers to another scheduler.
   // TODO(malte): Work out the detailed semantics of this.
   SchedulerInterface* scheduler_;
+  // Collects the jobs to schedule into batches, each of which is scheduled in
+  // a single scheduler run.
+  AdmissionBatcher* admission_batcher_;
+  // The incoming messages that the main loop handles.
+  MessageDispatchQueue dispatch_queue_;
+  // The time of the latest heartbeat of each resource that sent a heartbeat
+  // since the main loop last applied them to the resource statuses.
+  boost::mutex machine_heartbeats_lock_;
+  unordered_map<ResourceID_t, uint64_t> machine_heartbeats_;
+  // The location and time of the latest heartbeat of each task that sent a
+  // heartbeat since the main loop last applied them to the task descriptors,
+  // and the heartbeats the main loop is yet to forward to the parent
+  // coordinator.
+  boost::mutex task_heartbeats_lock_;
+  unordered_map<TaskID_t, pair<string, uint64_t>> task_heartbeats_;
+  vector<TaskHeartbeatMessage> forwarded_task_heartbeats_;
+  // The number of queued registrations from every remote endpoint. The
+  // messages from these endpoints are queued, so that their heartbeats do not
+  // overtake the registrations.
+  boost::mutex pending_registrations_lock_;
+  unordered_map<string, uint32_t> pending_registrations_;
   // Store URI of parent coordinator (if any)
   string parent_uri_;
   // Pointer to channel to the parent coordinator
@@ -33,11 +33,13 @@
 
 #include "base/job_desc.pb.h"
 #include "engine/coordinator.h"
+#include "misc/latency_histogram.h"
 #include "misc/utils.h"
 #include "misc/string_utils.h"
 #include "misc/uri_tools.h"
 #include "messages/task_kill_message.pb.h"
 #include "scheduling/knowledge_base.h"
+#include "scheduling/scheduler_phase_stats.h"
 #include "scheduling/flow/cost_model_interface.h"
 #include "scheduling/flow/flow_scheduler.h"
 #include "scheduling/flow/solver_dispatcher.h"
@@ -63,8 +65,21 @@ using boost::lexical_cast;
 
 using ctemplate::TemplateDictionary;
 
+using scheduler::NUM_SCHEDULER_PHASES;
+using scheduler::SchedulerPhase;
+using scheduler::SchedulerPhaseStats;
 using store::DataObjectMap_t;
 
+// Appends a machine sample to a JSON array that is being rendered.
+static void AppendMachineSampleJSON(const MachinePerfStatisticsSample& sample,
+                                    string* output) {
+  if (*output != "[")
+    *output += ", ";
+  string json;
+  CHECK(MessageToJsonString(sample, &json).ok());
+  *output += json;
+}
+
 CoordinatorHTTPUI::CoordinatorHTTPUI(shared_ptr<Coordinator> coordinator)
   : coordinator_(coordinator),
     active_(true) { }
@@ -816,6 +831,74 @@ void CoordinatorHTTPUI::HandleSchedFlowGraphURI(
   FinishOkResponse(writer);
 }
 
+void CoordinatorHTTPUI::HandleSchedLatencyURI(
+    const http::request_ptr& http_request,
+    const tcp::connection_ptr& tcp_conn) {
+  LogRequest(http_request);
+  if (FLAGS_scheduler != "flow") {
+    ErrorResponse(http::types::RESPONSE_CODE_NOT_FOUND, http_request,
+                  tcp_conn);
+    return;
+  }
+  http::response_writer_ptr writer = InitOkResponse(http_request, tcp_conn);
+  const FlowScheduler* sched =
+    dynamic_cast<const FlowScheduler*>(coordinator_->scheduler());
+  vector<LatencyHistogram> phase_histograms;
+  LatencyHistogram total_histogram;
+  sched->phase_stats().GetHistograms(&phase_histograms, &total_histogram);
+  TemplateDictionary dict("sched_latency");
+  AddHeaderToTemplate(&dict, coordinator_->uuid(), NULL);
+  AddFooterToTemplate(&dict);
+  dict.SetFormattedValue("SCHED_ROUNDS", "%ju", total_histogram.count());
+  for (uint32_t phase = 0; phase <= NUM_SCHEDULER_PHASES; ++phase) {
+    // The last entry summarizes the total round runtimes.
+    const LatencyHistogram& histogram = phase < NUM_SCHEDULER_PHASES ?
+      phase_histograms[phase] : total_histogram;
+    TemplateDictionary* sect_dict = dict.AddSectionDictionary("PHASE_DATA");
+    sect_dict->SetValue("PHASE_NAME", phase < NUM_SCHEDULER_PHASES ?
+        SchedulerPhaseStats::PhaseName(static_cast<SchedulerPhase>(phase)) :
+        "total");
+    sect_dict->SetFormattedValue("PHASE_MEAN", "%.0f", histogram.Mean());
+    sect_dict->SetFormattedValue("PHASE_P50", "%ju",
+                                 histogram.Percentile(50.0));
+    sect_dict->SetFormattedValue("PHASE_P90", "%ju",
+                                 histogram.Percentile(90.0));
+    sect_dict->SetFormattedValue("PHASE_P99", "%ju",
+                                 histogram.Percentile(99.0));
+    sect_dict->SetFormattedValue("PHASE_P999", "%ju",
+                                 histogram.Percentile(99.9));
+    sect_dict->SetFormattedValue("PHASE_MAX", "%ju", histogram.max());
+  }
+  // The time jobs waited in the admission window adds to their placement
+  // latency.
+  LatencyHistogram admission_histogram;
+  uint64_t num_admission_batches;
+  coordinator_->admission_batcher()->GetDelayHistogram(&admission_histogram,
+                                                       &num_admission_batches);
+  dict.SetFormattedValue("ADMISSION_BATCHES", "%ju", num_admission_batches);
+  dict.SetFormattedValue("ADMISSION_JOBS", "%ju", admission_histogram.count());
+  dict.SetFormattedValue("ADMISSION_MEAN", "%.0f", admission_histogram.Mean());
+  dict.SetFormattedValue("ADMISSION_P50", "%ju",
+                         admission_histogram.Percentile(50.0));
+  dict.SetFormattedValue("ADMISSION_P90", "%ju",
+                         admission_histogram.Percentile(90.0));
+  dict.SetFormattedValue("ADMISSION_P99", "%ju",
+                         admission_histogram.Percentile(99.0));
+  dict.SetFormattedValue("ADMISSION_P999", "%ju",
+                         admission_histogram.Percentile(99.9));
+  dict.SetFormattedValue("ADMISSION_MAX", "%ju", admission_histogram.max());
+  string output;
+  if (!http_request->get_query("json").empty()) {
+    ExpandTemplate(FLAGS_http_ui_template_dir + "/json_sched_latency.tpl",
+                   ctemplate::DO_NOT_STRIP, &dict, &output);
+  } else {
+    ExpandTemplate(FLAGS_http_ui_template_dir + "/sched_latency.tpl",
+                   ctemplate::DO_NOT_STRIP, &dict, &output);
+  }
+  writer->write(output);
+  FinishOkResponse(writer);
+}
+
 void CoordinatorHTTPUI::HandleStatisticsURI(
     const http::request_ptr& http_request,
     const tcp::connection_ptr& tcp_conn) {
@@ -838,21 +921,13 @@ void CoordinatorHTTPUI::HandleStatisticsURI(
   // Check if we have any statistics for this resource
   if (!res_id_str.empty()) {
     ResourceID_t res_id = ResourceIDFromString(res_id_str);
-    const deque<MachinePerfStatisticsSample> result =
-      coordinator_->scheduler()->knowledge_base()->GetStatsForMachine(res_id);
     if (coordinator_->GetResourceTreeNode(res_id)) {
-      int64_t length = static_cast<int64_t>(result.size());
       output += "[";
-      for (deque<MachinePerfStatisticsSample>::const_iterator it =
-             result.begin() + max(0LL, length - WEBUI_PERF_QUEUE_LEN);
-          it != result.end();
-          ++it) {
-        if (output != "[")
-          output += ", ";
-        string json;
-        CHECK(MessageToJsonString(*it, &json).ok());
-        output += json;
-      }
+      // N.B.: we only render the most recent samples, and visit them in
+      // place rather than copying the machine's whole sample queue.
+      coordinator_->scheduler()->knowledge_base()->VisitRecentStatsForMachine(
+          res_id, WEBUI_PERF_QUEUE_LEN,
+          boost::bind(&AppendMachineSampleJSON, _1, &output));
       output += "]";
     } else {
       ErrorResponse(http::types::RESPONSE_CODE_NOT_FOUND, http_request,
@@ -1297,6 +1372,9 @@ void __attribute__((no_sanitize_address)) CoordinatorHTTPUI::Init(
     // Scheduler live flow graph JSON
     coordinator_http_server_->add_resource("/sched/flowgraph/", boost::bind(
         &CoordinatorHTTPUI::HandleSchedFlowGraphURI, this, _1, _2));
+    // Scheduler per-phase latency histograms
+    coordinator_http_server_->add_resource("/sched/latency/", boost::bind(
+        &CoordinatorHTTPUI::HandleSchedLatencyURI, this, _1, _2));
     // Scheduler cost model JSON
     coordinator_http_server_->add_resource("/sched/costmodel/", boost::bind(
         &CoordinatorHTTPUI::HandleSchedCostModelURI, this, _1, _2));
@@ -102,6 +102,8 @@ class CoordinatorHTTPUI {
                                const tcp::connection_ptr& tcp_conn);
   void HandleSchedFlowGraphURI(const http::request_ptr& http_request,
                                const tcp::connection_ptr& tcp_conn);
+  void HandleSchedLatencyURI(const http::request_ptr& http_request,
+                             const tcp::connection_ptr& tcp_conn);
   void HandleStatisticsURI(const http::request_ptr& http_request,
                            const tcp::connection_ptr& tcp_conn);
   void HandleTasksListURI(const http::request_ptr& http_request,
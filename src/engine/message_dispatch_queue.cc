@@ -0,0 +1,67 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Queue of the incoming messages that the coordinator handles on its main
+// thread.
+
+#include "engine/message_dispatch_queue.h"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace firmament {
+
+MessageDispatchQueue::MessageDispatchQueue() {
+}
+
+MessageDispatchQueue::~MessageDispatchQueue() {
+  for (auto& message : messages_) {
+    delete message.first;
+  }
+}
+
+void MessageDispatchQueue::Push(BaseMessage* msg,
+                                const string& remote_endpoint) {
+  CHECK_NOTNULL(msg);
+  {
+    boost::lock_guard<boost::mutex> lock(lock_);
+    messages_.push_back(QueuedMessage(msg, remote_endpoint));
+  }
+  queued_cond_.notify_one();
+}
+
+uint64_t MessageDispatchQueue::PopAll(uint64_t timeout,
+                                      vector<QueuedMessage>* messages) {
+  boost::unique_lock<boost::mutex> lock(lock_);
+  if (messages_.empty() && timeout > 0) {
+    queued_cond_.timed_wait(lock, boost::posix_time::microseconds(timeout));
+  }
+  uint64_t num_messages = messages_.size();
+  messages->insert(messages->end(), messages_.begin(), messages_.end());
+  messages_.clear();
+  return num_messages;
+}
+
+uint64_t MessageDispatchQueue::size() const {
+  boost::lock_guard<boost::mutex> lock(lock_);
+  return messages_.size();
+}
+
+}  // namespace firmament
@@ -0,0 +1,78 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Queue of the incoming messages that the coordinator handles on its main
+// thread. The messaging adapter's I/O threads receive messages concurrently,
+// but the messages that modify the scheduler's state are handled one at a
+// time, in the order in which they were received.
+
+#ifndef FIRMAMENT_ENGINE_MESSAGE_DISPATCH_QUEUE_H
+#define FIRMAMENT_ENGINE_MESSAGE_DISPATCH_QUEUE_H
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "base/common.h"
+#include "messages/base_message.pb.h"
+
+namespace firmament {
+
+// A queued message and the endpoint it was received from.
+typedef pair<BaseMessage*, string> QueuedMessage;
+
+class MessageDispatchQueue {
+ public:
+  MessageDispatchQueue();
+  ~MessageDispatchQueue();
+
+  /**
+   * Queues a message. It can be called from any thread.
+   * @param msg the message; the queue takes ownership of it
+   * @param remote_endpoint the endpoint the message was received from
+   */
+  void Push(BaseMessage* msg, const string& remote_endpoint);
+
+  /**
+   * Removes all the queued messages. It waits for a message to be queued if
+   * there is none.
+   * @param timeout the maximum time (in microseconds) to wait for a message
+   * @param messages set to the messages, in the order in which they were
+   * queued; the caller takes ownership of them
+   * @return the number of messages removed
+   */
+  uint64_t PopAll(uint64_t timeout, vector<QueuedMessage>* messages);
+
+  uint64_t size() const;
+
+ private:
+  mutable boost::mutex lock_;
+  // Signalled when a message is queued.
+  boost::condition_variable queued_cond_;
+  deque<QueuedMessage> messages_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_ENGINE_MESSAGE_DISPATCH_QUEUE_H
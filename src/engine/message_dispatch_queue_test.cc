@@ -0,0 +1,91 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// MessageDispatchQueue class unit tests.
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "base/common.h"
+#include "engine/message_dispatch_queue.h"
+#include "messages/base_message.pb.h"
+
+namespace firmament {
+
+static void PushKillMessage(MessageDispatchQueue* queue, uint64_t task_id) {
+  BaseMessage* msg = new BaseMessage;
+  msg->mutable_task_kill()->set_task_id(task_id);
+  queue->Push(msg, "tcp:localhost:" + to_string(task_id));
+}
+
+// Tests that the messages are popped in the order in which they were pushed.
+TEST(MessageDispatchQueueTest, PopAllInOrder) {
+  MessageDispatchQueue queue;
+  for (uint64_t task_id = 1; task_id <= 3; ++task_id) {
+    PushKillMessage(&queue, task_id);
+  }
+  EXPECT_EQ(queue.size(), 3);
+  vector<QueuedMessage> messages;
+  EXPECT_EQ(queue.PopAll(0, &messages), 3);
+  ASSERT_EQ(messages.size(), 3);
+  for (uint64_t index = 0; index < messages.size(); ++index) {
+    EXPECT_EQ(messages[index].first->task_kill().task_id(), index + 1);
+    EXPECT_EQ(messages[index].second, "tcp:localhost:" + to_string(index + 1));
+    delete messages[index].first;
+  }
+  EXPECT_EQ(queue.size(), 0);
+  messages.clear();
+  EXPECT_EQ(queue.PopAll(0, &messages), 0);
+  EXPECT_TRUE(messages.empty());
+}
+
+// Tests that PopAll returns when a message is pushed by another thread.
+TEST(MessageDispatchQueueTest, PopAllWaitsForMessage) {
+  MessageDispatchQueue queue;
+  boost::thread pusher(boost::bind(&PushKillMessage, &queue, 42));
+  vector<QueuedMessage> messages;
+  // Wait for up to 10 seconds, which the test should never get close to.
+  while (messages.empty()) {
+    queue.PopAll(10000000, &messages);
+  }
+  pusher.join();
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0].first->task_kill().task_id(), 42);
+  delete messages[0].first;
+}
+
+// Tests that the messages left in the queue are deleted with it.
+TEST(MessageDispatchQueueTest, DeleteQueuedMessages) {
+  MessageDispatchQueue* queue = new MessageDispatchQueue;
+  PushKillMessage(queue, 1);
+  PushKillMessage(queue, 2);
+  delete queue;
+}
+
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -270,6 +270,94 @@ TEST_F(SimpleSchedulerTest, FindRunnableTasksForComplexJob2) {
   delete test_job;
 }
 
+// Tests that a job's graph is only reduced when the job changes, and that the
+// jobs with runnable tasks are tracked as tasks stop and become runnable.
+TEST_F(SimpleSchedulerTest, IncrementalRunnableTasks) {
+  JobDescriptor* test_job = new JobDescriptor;
+  JobID_t job_id = GenerateJobID();
+  test_job->set_uuid(to_string(job_id));
+  TaskDescriptor* rtp = test_job->mutable_root_task();
+  rtp->set_uid(GenerateRootTaskID(*test_job));
+  rtp->set_state(TaskDescriptor::CREATED);
+  rtp->set_job_id(to_string(job_id));
+  AddJobsTasksToTaskMap(test_job);
+  sched_->AddJob(test_job);
+  // The job is only reduced when its runnable tasks are needed.
+  EXPECT_EQ(sched_->jobs_to_reduce_.size(), 1UL);
+  EXPECT_EQ(sched_->jobs_with_runnables_.size(), 0UL);
+  vector<JobDescriptor*> jobs;
+  sched_->ComputeJobsWithRunnableTasks(&jobs);
+  ASSERT_EQ(jobs.size(), 1UL);
+  EXPECT_EQ(jobs[0], test_job);
+  EXPECT_EQ(sched_->jobs_to_reduce_.size(), 0UL);
+  EXPECT_EQ(rtp->state(), TaskDescriptor::RUNNABLE);
+  // The job has no runnable tasks once its only task has been removed.
+  sched_->RemoveTaskFromRunnables(job_id, rtp->uid());
+  jobs.clear();
+  sched_->ComputeJobsWithRunnableTasks(&jobs);
+  EXPECT_EQ(jobs.size(), 0UL);
+  // The task becomes runnable again (e.g., because it was evicted).
+  sched_->InsertTaskIntoRunnables(job_id, rtp->uid());
+  sched_->ComputeJobsWithRunnableTasks(&jobs);
+  ASSERT_EQ(jobs.size(), 1UL);
+  EXPECT_EQ(jobs[0], test_job);
+  delete test_job;
+}
+
+// Tests that the scheduler keeps track of the idle PUs as tasks are bound to
+// and unbound from them.
+TEST_F(SimpleSchedulerTest, IdlePUIndex) {
+  ResourceTopologyNodeDescriptor machine_rtnd;
+  ResourceDescriptor* machine_rd = machine_rtnd.mutable_resource_desc();
+  ResourceID_t machine_id = GenerateResourceID();
+  machine_rd->set_uuid(to_string(machine_id));
+  machine_rd->set_type(ResourceDescriptor::RESOURCE_MACHINE);
+  // Only PUs can run tasks, even if other resources are idle.
+  machine_rd->set_state(ResourceDescriptor::RESOURCE_IDLE);
+  CHECK(InsertIfNotPresent(res_map_.get(), machine_id,
+                           new ResourceStatus(machine_id, machine_rd,
+                                              &machine_rtnd, "endpoint_uri",
+                                              0)));
+  for (uint32_t index = 0; index < 2; ++index) {
+    ResourceTopologyNodeDescriptor* pu_rtnd = machine_rtnd.add_children();
+    ResourceDescriptor* pu_rd = pu_rtnd->mutable_resource_desc();
+    ResourceID_t pu_id = GenerateResourceID();
+    pu_rd->set_uuid(to_string(pu_id));
+    pu_rd->set_type(ResourceDescriptor::RESOURCE_PU);
+    pu_rtnd->set_parent_id(machine_rd->uuid());
+    CHECK(InsertIfNotPresent(res_map_.get(), pu_id,
+                             new ResourceStatus(pu_id, pu_rd, pu_rtnd,
+                                                "endpoint_uri", 0)));
+  }
+  sched_->RegisterResource(&machine_rtnd, false, true);
+  EXPECT_EQ(sched_->idle_pus_.size(), 2UL);
+  TaskDescriptor td1;
+  td1.set_uid(1);
+  TaskDescriptor td2;
+  td2.set_uid(2);
+  ResourceID_t pu_id1;
+  ASSERT_TRUE(sched_->FindResourceForTask(td1, &pu_id1));
+  EXPECT_NE(pu_id1, machine_id);
+  ResourceDescriptor* pu_rd1 =
+    FindPtrOrNull(*res_map_, pu_id1)->mutable_descriptor();
+  sched_->BindTaskToResource(&td1, pu_rd1);
+  EXPECT_EQ(sched_->idle_pus_.size(), 1UL);
+  ResourceID_t pu_id2;
+  ASSERT_TRUE(sched_->FindRandomResourceForTask(td2, &pu_id2));
+  EXPECT_NE(pu_id2, pu_id1);
+  EXPECT_NE(pu_id2, machine_id);
+  sched_->BindTaskToResource(
+      &td2, FindPtrOrNull(*res_map_, pu_id2)->mutable_descriptor());
+  EXPECT_EQ(sched_->idle_pus_.size(), 0UL);
+  ResourceID_t res_id;
+  EXPECT_FALSE(sched_->FindResourceForTask(td1, &res_id));
+  // The first PU becomes idle again once its task is unbound.
+  pu_rd1->clear_current_running_tasks();
+  EXPECT_TRUE(sched_->UnbindTaskFromResource(&td1, pu_id1));
+  ASSERT_TRUE(sched_->FindResourceForTask(td1, &res_id));
+  EXPECT_EQ(res_id, pu_id1);
+}
+
 }  // namespace scheduler
 }  // namespace firmament
 
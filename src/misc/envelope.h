@@ -53,6 +53,14 @@ class Envelope : public PrintableInterface {
     // TODO(malte): consider moving this to a shared_ptr
     return data_;
   }
+  // Drops the envelope's content, de-allocating it if the envelope owns it,
+  // so that the envelope can be reused to parse another message.
+  virtual void Clear() {
+    if (is_owner_)
+      delete data_;
+    data_ = NULL;
+    is_owner_ = false;
+  }
   // Parses a message from a given buffer into the envelopes internal buffer.
   // Since this is the most basic envelope implementation, we simply copy the
   // binary data over.
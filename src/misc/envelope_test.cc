@@ -132,6 +132,24 @@ TEST_F(EnvelopeTest, StashProtobuf) {
            testMsg.test().test());
 }
 
+// Tests that an envelope can be cleared and reused to parse further protobufs,
+// which are allocated on the envelope's arena.
+TEST_F(EnvelopeTest, ReuseProtobufEnvelope) {
+  Envelope<BaseMessage> envelope;
+  for (uint64_t i = 0; i < 3; ++i) {
+    BaseMessage testMsg;
+    testMsg.mutable_test()->set_test(i);
+    vector<char> buf(testMsg.ByteSize());
+    CHECK(testMsg.SerializeToArray(&buf[0], testMsg.ByteSize()));
+    CHECK(envelope.Parse(&buf[0], testMsg.ByteSize()));
+    CHECK(envelope.is_owner_);
+    CHECK_EQ(envelope.data_->GetArena(), envelope.arena_.get());
+    CHECK_EQ(envelope.data_->test().test(), i);
+    envelope.Clear();
+    CHECK(envelope.data_ == NULL);
+    CHECK(!envelope.is_owner_);
+  }
+}
 
 }  // namespace misc
 }  // namespace firmament
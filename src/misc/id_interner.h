@@ -0,0 +1,115 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Assigns dense 32-bit handles to IDs (e.g., resource UUIDs), so that state
+// kept per ID can live in flat arrays indexed by handle rather than in hash
+// maps keyed by the full ID.
+
+#ifndef FIRMAMENT_MISC_ID_INTERNER_H
+#define FIRMAMENT_MISC_ID_INTERNER_H
+
+#include <vector>
+
+#include "base/common.h"
+#include "base/types.h"
+#include "misc/map-util.h"
+
+namespace firmament {
+
+template <typename ID_t, typename Hasher = boost::hash<ID_t> >
+class IDInterner {
+ public:
+  static const IDHandle_t kInvalidHandle = kInvalidIDHandle;
+
+  /**
+   * Returns the handle of an ID, and assigns one if the ID does not have one
+   * yet. Handles of released IDs are reused, so the handles stay dense.
+   * @param id the ID to intern
+   * @return the ID's handle
+   */
+  uint32_t Intern(const ID_t& id) {
+    uint32_t* handle_ptr = FindOrNull(handles_, id);
+    if (handle_ptr) {
+      return *handle_ptr;
+    }
+    uint32_t handle;
+    if (free_handles_.empty()) {
+      handle = static_cast<uint32_t>(ids_.size());
+      CHECK_NE(handle, kInvalidHandle);
+      ids_.push_back(id);
+    } else {
+      handle = free_handles_.back();
+      free_handles_.pop_back();
+      ids_[handle] = id;
+    }
+    CHECK(InsertIfNotPresent(&handles_, id, handle));
+    return handle;
+  }
+
+  /**
+   * Looks up the handle of an ID without assigning one.
+   * @return the ID's handle, or kInvalidHandle if the ID is not interned
+   */
+  uint32_t Lookup(const ID_t& id) const {
+    const uint32_t* handle_ptr = FindOrNull(handles_, id);
+    return handle_ptr ? *handle_ptr : kInvalidHandle;
+  }
+
+  /**
+   * Releases the handle of an ID. The handle may be assigned to another ID
+   * afterwards.
+   * @return true if the ID was interned
+   */
+  bool Release(const ID_t& id) {
+    uint32_t* handle_ptr = FindOrNull(handles_, id);
+    if (!handle_ptr) {
+      return false;
+    }
+    free_handles_.push_back(*handle_ptr);
+    handles_.erase(id);
+    return true;
+  }
+
+  inline const ID_t& IDForHandle(uint32_t handle) const {
+    return ids_[handle];
+  }
+  // All the handles assigned so far are smaller than this bound. Arrays
+  // indexed by handle must have at least this many elements.
+  inline uint32_t handle_bound() const {
+    return static_cast<uint32_t>(ids_.size());
+  }
+  inline size_t size() const {
+    return handles_.size();
+  }
+
+ private:
+  unordered_map<ID_t, uint32_t, Hasher> handles_;
+  // The ID of every handle, indexed by handle.
+  vector<ID_t> ids_;
+  // Released handles that can be assigned again.
+  vector<uint32_t> free_handles_;
+};
+
+template <typename ID_t, typename Hasher>
+const uint32_t IDInterner<ID_t, Hasher>::kInvalidHandle;
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_MISC_ID_INTERNER_H
@@ -0,0 +1,106 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// ID interner unit tests.
+
+#include <gtest/gtest.h>
+
+#include "base/common.h"
+#include "base/types.h"
+#include "misc/id_interner.h"
+#include "misc/utils.h"
+
+namespace firmament {
+
+typedef IDInterner<ResourceID_t, boost::hash<boost::uuids::uuid> >
+  ResourceIDInterner;
+
+// The fixture for testing class IDInterner.
+class IDInternerTest : public ::testing::Test {
+ protected:
+  // You can remove any or all of the following functions if its body
+  // is empty.
+
+  IDInternerTest() {
+    // You can do set-up work for each test here.
+  }
+
+  virtual ~IDInternerTest() {
+    // You can do clean-up work that doesn't throw exceptions here.
+  }
+
+  // If the constructor and destructor are not enough for setting up
+  // and cleaning up each test, you can define the following methods:
+
+  virtual void SetUp() {
+    // Code here will be called immediately after the constructor (right
+    // before each test).
+  }
+
+  virtual void TearDown() {
+    // Code here will be called immediately after each test (right
+    // before the destructor).
+  }
+
+  // Objects declared here can be used by all tests in the test case for
+  // IDInterner.
+};
+
+// Tests that IDs get dense handles, and that interning an ID again returns
+// the same handle.
+TEST_F(IDInternerTest, InternAssignsDenseHandles) {
+  ResourceIDInterner interner;
+  ResourceID_t res_id1 = GenerateResourceID();
+  ResourceID_t res_id2 = GenerateResourceID();
+  EXPECT_EQ(interner.Lookup(res_id1), ResourceIDInterner::kInvalidHandle);
+  EXPECT_EQ(interner.Intern(res_id1), 0U);
+  EXPECT_EQ(interner.Intern(res_id2), 1U);
+  EXPECT_EQ(interner.Intern(res_id1), 0U);
+  EXPECT_EQ(interner.Lookup(res_id2), 1U);
+  EXPECT_EQ(interner.IDForHandle(0), res_id1);
+  EXPECT_EQ(interner.IDForHandle(1), res_id2);
+  EXPECT_EQ(interner.size(), 2U);
+  EXPECT_EQ(interner.handle_bound(), 2U);
+}
+
+// Tests that released handles are reused, so that the handles stay dense.
+TEST_F(IDInternerTest, ReleaseReusesHandles) {
+  ResourceIDInterner interner;
+  ResourceID_t res_id1 = GenerateResourceID();
+  ResourceID_t res_id2 = GenerateResourceID();
+  ResourceID_t res_id3 = GenerateResourceID();
+  interner.Intern(res_id1);
+  interner.Intern(res_id2);
+  EXPECT_TRUE(interner.Release(res_id1));
+  EXPECT_FALSE(interner.Release(res_id1));
+  EXPECT_EQ(interner.Lookup(res_id1), ResourceIDInterner::kInvalidHandle);
+  EXPECT_EQ(interner.size(), 1U);
+  EXPECT_EQ(interner.Intern(res_id3), 0U);
+  EXPECT_EQ(interner.IDForHandle(0), res_id3);
+  EXPECT_EQ(interner.Lookup(res_id2), 1U);
+  EXPECT_EQ(interner.handle_bound(), 2U);
+}
+
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,105 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "misc/latency_histogram.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace firmament {
+
+LatencyHistogram::LatencyHistogram()
+  : counts_(kNumBuckets, 0), count_(0),
+    min_(numeric_limits<uint64_t>::max()), max_(0), sum_(0) {
+}
+
+uint64_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < kSubBuckets) {
+    return value;
+  }
+  uint64_t msb = 63 - static_cast<uint64_t>(__builtin_clzll(value));
+  uint64_t shift = msb - (kSubBucketBits - 1);
+  uint64_t sub_bucket = (value >> shift) - kHalfSubBuckets;
+  return kSubBuckets + (shift - 1) * kHalfSubBuckets + sub_bucket;
+}
+
+uint64_t LatencyHistogram::BucketHighestValue(uint64_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  uint64_t shift = (index - kSubBuckets) / kHalfSubBuckets + 1;
+  uint64_t top = (index - kSubBuckets) % kHalfSubBuckets + kHalfSubBuckets;
+  // N.B.: for the last bucket, the shift below overflows to 0, and the
+  // subtraction then yields the maximum uint64_t value.
+  return ((top + 1) << shift) - 1;
+}
+
+double LatencyHistogram::Mean() const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (uint64_t index = 0; index < kNumBuckets; ++index) {
+    counts_[index] += other.counts_[index];
+  }
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+uint64_t LatencyHistogram::Percentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  percentile = std::min(std::max(percentile, 0.0), 100.0);
+  uint64_t rank = static_cast<uint64_t>(
+      percentile / 100.0 * static_cast<double>(count_) + 0.5);
+  rank = std::min(std::max(rank, static_cast<uint64_t>(1)), count_);
+  uint64_t seen = 0;
+  for (uint64_t index = 0; index < kNumBuckets; ++index) {
+    seen += counts_[index];
+    if (seen >= rank) {
+      return std::min(BucketHighestValue(index), max_);
+    }
+  }
+  return max_;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+  counts_[BucketIndex(value)]++;
+  count_++;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += value;
+}
+
+void LatencyHistogram::Reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  count_ = 0;
+  min_ = numeric_limits<uint64_t>::max();
+  max_ = 0;
+  sum_ = 0;
+}
+
+}  // namespace firmament
@@ -0,0 +1,84 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Latency histogram with logarithmic buckets that are linearly subdivided
+// (in the style of HdrHistogram). Values below kSubBuckets are recorded
+// exactly; larger values are recorded with a relative error of at most
+// 1 / (kSubBuckets / 2), i.e., ~1.6%. The histogram uses a fixed amount of
+// memory regardless of the number or the range of the recorded values.
+
+#ifndef FIRMAMENT_MISC_LATENCY_HISTOGRAM_H
+#define FIRMAMENT_MISC_LATENCY_HISTOGRAM_H
+
+#include <vector>
+
+#include "base/common.h"
+
+namespace firmament {
+
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+  /**
+   * Returns the largest value that is recorded in the same bucket as the
+   * value at the given percentile (or the maximum recorded value, if it is
+   * smaller).
+   * @param percentile the percentile in [0, 100]
+   * @return the value, or 0 if the histogram is empty
+   */
+  uint64_t Percentile(double percentile) const;
+  double Mean() const;
+  void Merge(const LatencyHistogram& other);
+  void Record(uint64_t value);
+  void Reset();
+
+  inline uint64_t count() const {
+    return count_;
+  }
+  inline uint64_t max() const {
+    return max_;
+  }
+  inline uint64_t min() const {
+    return count_ == 0 ? 0 : min_;
+  }
+
+ private:
+  static const uint64_t kSubBucketBits = 7;
+  static const uint64_t kSubBuckets = 1ULL << kSubBucketBits;
+  static const uint64_t kHalfSubBuckets = kSubBuckets / 2;
+  // Values in [0, kSubBuckets) have a bucket each. Every further power of two
+  // [2^k, 2^(k+1)), with k >= kSubBucketBits, is split into kHalfSubBuckets
+  // buckets.
+  static const uint64_t kNumBuckets =
+    kSubBuckets + (64 - kSubBucketBits) * kHalfSubBuckets;
+
+  static uint64_t BucketIndex(uint64_t value);
+  static uint64_t BucketHighestValue(uint64_t index);
+
+  vector<uint64_t> counts_;
+  uint64_t count_;
+  uint64_t min_;
+  uint64_t max_;
+  uint64_t sum_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_MISC_LATENCY_HISTOGRAM_H
@@ -0,0 +1,104 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Latency histogram unit tests.
+
+#include <gtest/gtest.h>
+
+#include "base/common.h"
+#include "misc/latency_histogram.h"
+
+namespace firmament {
+
+// The fixture for testing class LatencyHistogram.
+class LatencyHistogramTest : public ::testing::Test {
+ protected:
+  LatencyHistogramTest() {
+    // You can do set-up work for each test here.
+  }
+
+  virtual ~LatencyHistogramTest() {
+    // You can do clean-up work that doesn't throw exceptions here.
+  }
+};
+
+// Tests that an empty histogram reports zeros.
+TEST_F(LatencyHistogramTest, Empty) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.count(), 0);
+  EXPECT_EQ(histogram.min(), 0);
+  EXPECT_EQ(histogram.max(), 0);
+  EXPECT_EQ(histogram.Percentile(50.0), 0);
+  EXPECT_EQ(histogram.Mean(), 0.0);
+}
+
+// Tests that small values are recorded exactly.
+TEST_F(LatencyHistogramTest, SmallValuesAreExact) {
+  LatencyHistogram histogram;
+  for (uint64_t value = 1; value <= 100; ++value) {
+    histogram.Record(value);
+  }
+  EXPECT_EQ(histogram.count(), 100);
+  EXPECT_EQ(histogram.min(), 1);
+  EXPECT_EQ(histogram.max(), 100);
+  EXPECT_EQ(histogram.Percentile(50.0), 50);
+  EXPECT_EQ(histogram.Percentile(99.0), 99);
+  EXPECT_EQ(histogram.Percentile(100.0), 100);
+  EXPECT_DOUBLE_EQ(histogram.Mean(), 50.5);
+}
+
+// Tests that large values are recorded within the histogram's precision.
+TEST_F(LatencyHistogramTest, LargeValuesWithinPrecision) {
+  LatencyHistogram histogram;
+  for (uint64_t value = 1; value <= 10000; ++value) {
+    histogram.Record(value * 1000);
+  }
+  uint64_t p90 = histogram.Percentile(90.0);
+  EXPECT_GE(p90, 9000000);
+  EXPECT_LE(p90, 9000000 + 9000000 / 64);
+  EXPECT_EQ(histogram.Percentile(100.0), 10000000);
+  // The largest representable values must not overflow the buckets.
+  histogram.Record(numeric_limits<uint64_t>::max());
+  EXPECT_EQ(histogram.Percentile(100.0), numeric_limits<uint64_t>::max());
+}
+
+// Tests merging and resetting histograms.
+TEST_F(LatencyHistogramTest, MergeAndReset) {
+  LatencyHistogram first;
+  LatencyHistogram second;
+  first.Record(10);
+  second.Record(1000);
+  second.Record(2000);
+  first.Merge(second);
+  EXPECT_EQ(first.count(), 3);
+  EXPECT_EQ(first.min(), 10);
+  EXPECT_EQ(first.max(), 2000);
+  EXPECT_EQ(first.Percentile(30.0), 10);
+  first.Reset();
+  EXPECT_EQ(first.count(), 0);
+  EXPECT_EQ(first.Percentile(50.0), 0);
+}
+
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
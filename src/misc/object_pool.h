@@ -0,0 +1,90 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Slab allocator for objects of a single type. Objects are carved out of
+// large contiguous chunks, and the slots of deleted objects are kept on a
+// free list and reused by subsequent allocations. Pointers to objects remain
+// valid until the objects are deleted.
+
+#ifndef FIRMAMENT_MISC_OBJECT_POOL_H
+#define FIRMAMENT_MISC_OBJECT_POOL_H
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "base/common.h"
+
+namespace firmament {
+
+template<typename T>
+class ObjectPool {
+ public:
+  explicit ObjectPool(size_t objects_per_chunk)
+    : objects_per_chunk_(objects_per_chunk),
+      next_slot_(objects_per_chunk) {
+    CHECK_GT(objects_per_chunk_, 0);
+  }
+
+  /**
+   * Releases the pool's memory. N.B.: the destructors of the objects that
+   * are still allocated are not called.
+   */
+  ~ObjectPool() {
+    for (auto& chunk : chunks_) {
+      delete[] chunk;
+    }
+  }
+
+  template<typename... Args>
+  T* New(Args&&... args) {
+    void* slot;
+    if (!free_slots_.empty()) {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      if (next_slot_ == objects_per_chunk_) {
+        chunks_.push_back(new Slot[objects_per_chunk_]);
+        next_slot_ = 0;
+      }
+      slot = &chunks_.back()[next_slot_++];
+    }
+    return new (slot) T(std::forward<Args>(args)...);
+  }
+
+  void Delete(T* object) {
+    object->~T();
+    free_slots_.push_back(object);
+  }
+
+ private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+  size_t objects_per_chunk_;
+  // Index of the next never used slot in the last chunk.
+  size_t next_slot_;
+  vector<Slot*> chunks_;
+  vector<void*> free_slots_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_MISC_OBJECT_POOL_H
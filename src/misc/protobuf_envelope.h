@@ -25,12 +25,21 @@
 
 #include <vector>
 
+#include <google/protobuf/arena.h>
+
+#include "base/types.h"
 #include "messages/base_message.pb.h"
 #include "misc/envelope.h"
 
 namespace firmament {
 namespace misc {
 
+// Size (in bytes) of the first block of the arena that an envelope allocates
+// the messages it parses on. The block is kept when the envelope is cleared,
+// so an envelope that is reused for messages that fit into it does not
+// allocate any memory for them.
+static const size_t kEnvelopeArenaBlockSize = 8 * 1024;
+
 // Message envelope.
 template <>
 class Envelope<BaseMessage> : public PrintableInterface {
@@ -39,10 +48,19 @@ class Envelope<BaseMessage> : public PrintableInterface {
   explicit Envelope(BaseMessage *data) : data_(data), is_owner_(false) {}
   virtual ~Envelope() {
     VLOG(2) << "Envelope at " << this << " is being destroyed.";
-    VLOG(2) << "At destruction, content is: " << *this;
+    // The messages that the envelope owns are on the arena, which is
+    // de-allocated along with the envelope.
+    if (data_)
+      VLOG(2) << "At destruction, content is: " << *this;
+  }
+  // Drops the envelope's content, so that the envelope can be reused to parse
+  // another message. If the envelope owns the content, the arena's memory is
+  // released for the next message.
+  virtual void Clear() {
     if (is_owner_)
-      // de-allocate buffer
-      delete data_;
+      arena_->Reset();
+    data_ = NULL;
+    is_owner_ = false;
   }
   virtual int32_t size() const {
     CHECK(data_ != NULL) << "Protobuf message envelope has NULL content.";
@@ -55,17 +73,31 @@ class Envelope<BaseMessage> : public PrintableInterface {
   }
   virtual bool Parse(void *buffer, int32_t length) {
     if (!data_) {
-      // XXX(malte): check if we can use smart pointers instead here.
       VLOG(2) << "Allocating new message inside envelope at " << this;
-      data_ = new BaseMessage();
+      if (!arena_) {
+        arena_block_.resize(kEnvelopeArenaBlockSize);
+        google::protobuf::ArenaOptions options;
+        options.initial_block = &arena_block_[0];
+        options.initial_block_size = arena_block_.size();
+        arena_.reset(new google::protobuf::Arena(options));
+      }
+      data_ = google::protobuf::Arena::CreateMessage<BaseMessage>(
+          arena_.get());
       is_owner_ = true;
     }
+    // N.B.: this parses the message in place, without copying the buffer.
     return data_->ParseFromArray(buffer, length);
   }
   virtual bool Serialize(void *buffer, int32_t length) const {
     CHECK(data_ != NULL) << "Tried to serialize a protobuf message envelope "
                          << "with NULL contents.";
-    return data_->SerializeToArray(buffer, length);
+    // Callers obtain the length from size(), which has just computed and
+    // cached the sizes of the message and its sub-messages.
+    if (data_->GetCachedSize() != length)
+      return data_->SerializeToArray(buffer, length);
+    data_->SerializeWithCachedSizesToArray(
+        static_cast<google::protobuf::uint8*>(buffer));
+    return true;
   }
   virtual ostream& ToString(ostream* stream) const {
     return *stream << "(PB Envelope, size=" << size() << ", at=" << this
@@ -77,9 +109,14 @@ class Envelope<BaseMessage> : public PrintableInterface {
   FRIEND_TEST(EnvelopeTest, EmptyParseProtobuf);
   FRIEND_TEST(EnvelopeTest, EmptyParseBlankProtobuf);
   FRIEND_TEST(EnvelopeTest, StashProtobuf);
+  FRIEND_TEST(EnvelopeTest, ReuseProtobufEnvelope);
   // fields
   BaseMessage* data_;
   bool is_owner_;
+  // The arena that parsed messages are allocated on, and its first block,
+  // which must outlive the arena.
+  vector<char> arena_block_;
+  scoped_ptr<google::protobuf::Arena> arena_;
 };
 
 }  // namespace misc
@@ -22,6 +22,8 @@
 
 #include "misc/trace_generator.h"
 
+#include <string.h>
+
 #include <boost/functional/hash.hpp>
 #include <SpookyV2.h>
 #include <string>
@@ -37,13 +39,108 @@ DEFINE_string(generated_trace_path, "",
               "Path to where the trace will be generated");
 DEFINE_bool(generate_quincy_cost_model_trace, false,
             "A trace containing information specific to the Quincy cost model");
+DEFINE_string(generated_trace_format, "csv",
+              "Format of the generated trace files: csv or binary. Binary "
+              "files contain fixed-size records of 64-bit fields. The "
+              "simulator replays a binary generated trace when "
+              "--binary_trace_file is set to its directory.");
+DEFINE_uint64(generated_trace_queue_size, 4 * 1024 * 1024,
+              "Number of bytes of trace records that can be queued for every "
+              "generated trace file. The scheduler waits for the trace "
+              "writer when a queue is full. The simulator writes out the "
+              "queued records if it fails on a CHECK or LOG(FATAL); other "
+              "binaries lose them.");
+DEFINE_uint64(generated_trace_write_interval, 100000,
+              "Interval (in microseconds) at which the queued trace records "
+              "are written to the generated trace files.");
+
+static bool ValidateGeneratedTraceFormat(const char* flagname,
+                                         const string& format) {
+  if (format.compare("csv") && format.compare("binary")) {
+    LOG(ERROR) << "Generated trace format can be one of: csv or binary";
+    return false;
+  }
+  return true;
+}
+
+static const bool generated_trace_format_validator =
+  google::RegisterFlagValidator(&FLAGS_generated_trace_format,
+                                &ValidateGeneratedTraceFormat);
 
 namespace firmament {
 
+// The records are formatted as CSV lines by the functions below, on the trace
+// writer's thread.
+
+static void FormatMachineEvent(FILE* file, const uint64_t* record) {
+  fprintf(file, "%ju,%ju,%ju,,,\n", record[0], record[1], record[2]);
+}
+
+static void FormatSchedulerEvent(FILE* file, const uint64_t* record) {
+  fprintf(file, "%ju,%ju,%ju,%ju,%ju,%ju,%ju,%ju,%ju,%ju",
+          record[0], record[1], record[2], record[3], record[4], record[5],
+          record[6], record[7], record[8], record[9]);
+  // The DIMACS change stats.
+  for (uint32_t index = 10; index < kSchedulerEventFields; ++index) {
+    fprintf(file, ",%ju", record[index]);
+  }
+  fputc('\n', file);
+}
+
+static void FormatTaskEvent(FILE* file, const uint64_t* record) {
+  if (record[4] == TASK_SUBMIT_EVENT) {
+    // Submitted tasks are not on a machine.
+    fprintf(file, "%ju,,%ju,%ju,,%ju,,,,,,,\n",
+            record[0], record[1], record[2], record[4]);
+  } else {
+    fprintf(file, "%ju,,%ju,%ju,%ju,%ju,,,,,,,\n",
+            record[0], record[1], record[2], record[3], record[4]);
+  }
+}
+
+static void FormatTaskRuntime(FILE* file, const uint64_t* record) {
+  // NOTE: We are using the job id as the job logical name.
+  fprintf(file, "%ju,%ju,%ju,%ju,%ju,%ju,%ju\n", record[0], record[1],
+          record[0], record[2], record[3], record[4], record[5]);
+}
+
+static void FormatJobNumTasks(FILE* file, const uint64_t* record) {
+  fprintf(file, "%ju,%ju\n", record[0], record[1]);
+}
+
+static void FormatTaskUsageStat(FILE* file, const uint64_t* record) {
+  fprintf(file, "%ju,%ju,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
+          "0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0\n", record[0], record[1]);
+}
+
+static void FormatDFSEvent(FILE* file, const uint64_t* record) {
+  fprintf(file, "%ju,%ju,%ju,%ju,%ju\n",
+          record[0], record[1], record[2], record[3], record[4]);
+}
+
+static void FormatTaskToBlock(FILE* file, const uint64_t* record) {
+  fprintf(file, "%ju,%ju,%ju\n", record[0], record[1], record[2]);
+}
+
+static void FormatMachineToRack(FILE* file, const uint64_t* record) {
+  fprintf(file, "%ju,%ju,%ju,%ju\n",
+          record[0], record[1], record[2], record[3]);
+}
+
+static void FormatQuincyTask(FILE* file, const uint64_t* record) {
+  // The costs are signed.
+  fprintf(file, "%ju,%ju,%ju,%ju,%jd,%jd,%jd,%jd,%ju,%ju\n",
+          record[0], record[1], record[2], record[3],
+          static_cast<intmax_t>(record[4]), static_cast<intmax_t>(record[5]),
+          static_cast<intmax_t>(record[6]), static_cast<intmax_t>(record[7]),
+          record[8], record[9]);
+}
+
 TraceGenerator::TraceGenerator(TimeInterface* time_manager)
-  : time_manager_(time_manager), unscheduled_tasks_cnt_(0),
-    running_tasks_cnt_(0), evicted_tasks_cnt_(0), migrated_tasks_cnt_(0),
-    task_events_cnt_per_round_(0), machine_events_cnt_per_round_(0) {
+  : time_manager_(time_manager), trace_writer_(NULL),
+    unscheduled_tasks_cnt_(0), running_tasks_cnt_(0), evicted_tasks_cnt_(0),
+    migrated_tasks_cnt_(0), task_events_cnt_per_round_(0),
+    machine_events_cnt_per_round_(0) {
   if (FLAGS_generate_trace) {
     MkdirIfNotPresent(FLAGS_generated_trace_path);
     MkdirIfNotPresent(FLAGS_generated_trace_path + "/machine_events");
@@ -55,81 +152,70 @@ TraceGenerator::TraceGenerator(TimeInterface* time_manager)
     MkdirIfNotPresent(FLAGS_generated_trace_path + "/dfs_events");
     MkdirIfNotPresent(FLAGS_generated_trace_path + "/tasks_to_blocks");
     MkdirIfNotPresent(FLAGS_generated_trace_path + "/machines_to_racks");
-    string path =
-      FLAGS_generated_trace_path + "/machine_events/part-00000-of-00001.csv";
-    machine_events_ = fopen(path.c_str(), "w");
-    CHECK(machine_events_ != NULL) << "Failed to open: " << path;
-    path = FLAGS_generated_trace_path +
-      "/scheduler_events/scheduler_events.csv";
-    scheduler_events_ = fopen(path.c_str(), "w");
-    CHECK(scheduler_events_ != NULL) << "Failed to open: " << path;
-    path = FLAGS_generated_trace_path + "/task_events/part-00000-of-00500.csv";
-    task_events_ = fopen(path.c_str(), "w");
-    CHECK(task_events_ != NULL) << "Failed to open: " << path;
-    path = FLAGS_generated_trace_path +
-      "/task_runtime_events/task_runtime_events.csv";
-    task_runtime_events_ = fopen(path.c_str(), "w");
-    CHECK(task_runtime_events_ != NULL) << "Failed to open: " << path;
-    path = FLAGS_generated_trace_path + "/jobs_num_tasks/jobs_num_tasks.csv";
-    jobs_num_tasks_ = fopen(path.c_str(), "w");
-    CHECK(jobs_num_tasks_ != NULL) << "Failed to open: " << path;
-    path = FLAGS_generated_trace_path + "/task_usage_stat/task_usage_stat.csv";
-    task_usage_stat_ = fopen(path.c_str(), "w");
-    CHECK(task_usage_stat_ != NULL) << "Failed to open: " << path;
-    path = FLAGS_generated_trace_path + "/dfs_events/dfs_events.csv";
-    dfs_events_ = fopen(path.c_str(), "w");
-    CHECK(dfs_events_ != NULL) << "Failed to open: " << path;
-    path = FLAGS_generated_trace_path + "/tasks_to_blocks/tasks_to_blocks.csv";
-    tasks_to_blocks_ = fopen(path.c_str(), "w");
-    CHECK(tasks_to_blocks_ != NULL) << "Failed to open: " << path;
-    path = FLAGS_generated_trace_path + "/machines_to_racks/machines_to_racks.csv";
-    machines_to_racks_ = fopen(path.c_str(), "w");
-    CHECK(machines_to_racks_ != NULL) << "Failed to open: " << path;
+    trace_writer_ = new TraceWriter(
+        FLAGS_generated_trace_format == "binary" ? BINARY_TRACE_FILE
+                                                 : CSV_TRACE_FILE,
+        FLAGS_generated_trace_queue_size,
+        FLAGS_generated_trace_write_interval);
+    // The writer adds the file extensions.
+    machine_events_ = trace_writer_->AddFile(
+        FLAGS_generated_trace_path + "/machine_events/part-00000-of-00001",
+        kMachineEventFields, &FormatMachineEvent);
+    scheduler_events_ = trace_writer_->AddFile(
+        FLAGS_generated_trace_path + "/scheduler_events/scheduler_events",
+        kSchedulerEventFields, &FormatSchedulerEvent);
+    task_events_ = trace_writer_->AddFile(
+        FLAGS_generated_trace_path + "/task_events/part-00000-of-00500",
+        kTaskEventFields, &FormatTaskEvent);
+    task_runtime_events_ = trace_writer_->AddFile(
+        FLAGS_generated_trace_path +
+        "/task_runtime_events/task_runtime_events",
+        kTaskRuntimeFields, &FormatTaskRuntime);
+    jobs_num_tasks_ = trace_writer_->AddFile(
+        FLAGS_generated_trace_path + "/jobs_num_tasks/jobs_num_tasks",
+        kJobNumTasksFields, &FormatJobNumTasks);
+    task_usage_stat_ = trace_writer_->AddFile(
+        FLAGS_generated_trace_path + "/task_usage_stat/task_usage_stat",
+        kTaskUsageStatFields, &FormatTaskUsageStat);
+    dfs_events_ = trace_writer_->AddFile(
+        FLAGS_generated_trace_path + "/dfs_events/dfs_events",
+        kDFSEventFields, &FormatDFSEvent);
+    tasks_to_blocks_ = trace_writer_->AddFile(
+        FLAGS_generated_trace_path + "/tasks_to_blocks/tasks_to_blocks",
+        kTaskToBlockFields, &FormatTaskToBlock);
+    machines_to_racks_ = trace_writer_->AddFile(
+        FLAGS_generated_trace_path + "/machines_to_racks/machines_to_racks",
+        kMachineToRackFields, &FormatMachineToRack);
     if (FLAGS_generate_quincy_cost_model_trace) {
       MkdirIfNotPresent(FLAGS_generated_trace_path + "/quincy_tasks");
-      path = FLAGS_generated_trace_path + "/quincy_tasks/quincy_tasks.csv";
-      quincy_tasks_ = fopen(path.c_str(), "w");
-      CHECK(quincy_tasks_ != NULL) << "Failed to open: " << path;
+      quincy_tasks_ = trace_writer_->AddFile(
+          FLAGS_generated_trace_path + "/quincy_tasks/quincy_tasks",
+          kQuincyTaskFields, &FormatQuincyTask);
     }
   }
 }
 
 TraceGenerator::~TraceGenerator() {
   if (FLAGS_generate_trace) {
-    fclose(machine_events_);
-    fclose(scheduler_events_);
-    fclose(task_events_);
     // Print runtime for service tasks or tasks that haven't completed.
     for (auto& task_id_runtime : task_to_runtime_) {
       uint64_t* job_id_ptr = FindOrNull(task_to_job_, task_id_runtime.first);
-      TaskRuntime task_runtime = task_id_runtime.second;
-      // NOTE: We are using the job id as the job logical name.
-      fprintf(task_runtime_events_, "%ju,%ju,%ju,%ju,%ju,%ju,%ju\n",
-              *job_id_ptr, task_runtime.task_id_, *job_id_ptr,
-              task_runtime.start_time_, task_runtime.total_runtime_,
-              task_runtime.runtime_, task_runtime.num_runs_);
+      WriteTaskRuntime(*job_id_ptr, task_id_runtime.second);
     }
-    fclose(task_runtime_events_);
     // Print number of tasks for service jobs or jobs that haven't completed.
     for (auto& job_to_num_tasks : job_num_tasks_) {
-      fprintf(jobs_num_tasks_, "%ju,%ju\n", job_to_num_tasks.first,
-              job_to_num_tasks.second);
+      uint64_t record[kJobNumTasksFields] = {job_to_num_tasks.first,
+                                             job_to_num_tasks.second};
+      trace_writer_->Append(jobs_num_tasks_, record);
     }
-    fclose(jobs_num_tasks_);
     // TODO(ionel): Collect task usage stats.
     // for (auto& task_to_job : task_to_job_) {
-    //   uint64_t* job_id_ptr = FindOrNull(task_to_job_, task_to_job.first);
-    //   fprintf(task_usage_stat_, "%ju,%ju,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
-    //           "0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0\n", *job_id_ptr,
-    //           task_to_job.first);
+    //   uint64_t record[kTaskUsageStatFields] = {task_to_job.second,
+    //                                            task_to_job.first};
+    //   trace_writer_->Append(task_usage_stat_, record);
     // }
-    fclose(task_usage_stat_);
-    fclose(dfs_events_);
-    fclose(tasks_to_blocks_);
-    fclose(machines_to_racks_);
-    if (FLAGS_generate_quincy_cost_model_trace) {
-      fclose(quincy_tasks_);
-    }
+    // Writes out the queued records and closes the files.
+    delete trace_writer_;
   }
   // time_manager is not owned by this class. We don't have to delete it here.
 }
@@ -141,8 +227,9 @@ void TraceGenerator::AddBlock(ResourceID_t machine_res_id,
     uint64_t* machine_id =
       FindOrNull(machine_res_id_to_trace_id_, machine_res_id);
     CHECK_NOTNULL(machine_id);
-    fprintf(dfs_events_, "%ju,%d,%ju,%ju,%ju\n", timestamp, BLOCK_ADD,
-            *machine_id, block_id, block_size);
+    uint64_t record[kDFSEventFields] = {timestamp, BLOCK_ADD, *machine_id,
+                                        block_id, block_size};
+    trace_writer_->Append(dfs_events_, record);
   }
 }
 
@@ -154,8 +241,9 @@ void TraceGenerator::AddMachine(const ResourceDescriptor& rd) {
     CHECK(InsertIfNotPresent(&machine_res_id_to_trace_id_,
                              ResourceIDFromString(rd.uuid()),
                              machine_id));
-    fprintf(machine_events_, "%ju,%ju,%d,,,\n",
-            timestamp, machine_id, MACHINE_ADD);
+    uint64_t record[kMachineEventFields] = {timestamp, machine_id,
+                                            MACHINE_ADD};
+    trace_writer_->Append(machine_events_, record);
   }
 }
 
@@ -166,8 +254,9 @@ void TraceGenerator::AddMachineToRack(ResourceID_t machine_res_id,
     uint64_t* machine_id =
       FindOrNull(machine_res_id_to_trace_id_, machine_res_id);
     CHECK_NOTNULL(machine_id);
-    fprintf(machines_to_racks_, "%ju,%d,%ju,%ju\n", timestamp, MACHINE_ADD,
-            *machine_id, rack_id);
+    uint64_t record[kMachineToRackFields] = {timestamp, MACHINE_ADD,
+                                             *machine_id, rack_id};
+    trace_writer_->Append(machines_to_racks_, record);
   }
 }
 
@@ -183,8 +272,9 @@ void TraceGenerator::AddTaskInputBlock(const TaskDescriptor& td,
       trace_job_id = HashString(td.job_id());
       trace_task_id = td.uid();
     }
-    fprintf(tasks_to_blocks_, "%ju,%ju,%ju\n",
-            trace_job_id, trace_task_id, block_id);
+    uint64_t record[kTaskToBlockFields] = {trace_job_id, trace_task_id,
+                                           block_id};
+    trace_writer_->Append(tasks_to_blocks_, record);
   }
 }
 
@@ -204,10 +294,14 @@ void TraceGenerator::AddTaskQuincy(
       trace_job_id = HashString(td.job_id());
       trace_task_id = td.uid();
     }
-    fprintf(quincy_tasks_, "%ju,%ju,%ju,%ju,%jd,%jd,%jd,%jd,%ju,%ju\n",
-            timestamp, trace_job_id, trace_task_id, input_size,
-            worst_cluster_cost, best_rack_cost, best_machine_cost,
-            cost_to_unsched, num_pref_machines, num_pref_racks);
+    uint64_t record[kQuincyTaskFields] = {
+      timestamp, trace_job_id, trace_task_id, input_size,
+      static_cast<uint64_t>(worst_cluster_cost),
+      static_cast<uint64_t>(best_rack_cost),
+      static_cast<uint64_t>(best_machine_cost),
+      static_cast<uint64_t>(cost_to_unsched), num_pref_machines,
+      num_pref_racks};
+    trace_writer_->Append(quincy_tasks_, record);
   }
 }
 
@@ -226,8 +320,9 @@ void TraceGenerator::RemoveBlock(ResourceID_t machine_res_id,
     uint64_t* machine_id =
       FindOrNull(machine_res_id_to_trace_id_, machine_res_id);
     CHECK_NOTNULL(machine_id);
-    fprintf(dfs_events_, "%ju,%d,%ju,%ju,%ju\n", timestamp, BLOCK_REMOVE,
-            *machine_id, block_id, block_size);
+    uint64_t record[kDFSEventFields] = {timestamp, BLOCK_REMOVE, *machine_id,
+                                        block_id, block_size};
+    trace_writer_->Append(dfs_events_, record);
   }
 }
 
@@ -237,8 +332,9 @@ void TraceGenerator::RemoveMachine(const ResourceDescriptor& rd) {
     uint64_t timestamp = time_manager_->GetCurrentTimestamp();
     uint64_t machine_id = GetMachineId(rd);
     machine_res_id_to_trace_id_.erase(ResourceIDFromString(rd.uuid()));
-    fprintf(machine_events_, "%ju,%ju,%d,,,\n",
-            timestamp, machine_id, MACHINE_REMOVE);
+    uint64_t record[kMachineEventFields] = {timestamp, machine_id,
+                                            MACHINE_REMOVE};
+    trace_writer_->Append(machine_events_, record);
   }
 }
 
@@ -249,8 +345,9 @@ void TraceGenerator::RemoveMachineFromRack(ResourceID_t machine_res_id,
     uint64_t* machine_id =
       FindOrNull(machine_res_id_to_trace_id_, machine_res_id);
     CHECK_NOTNULL(machine_id);
-    fprintf(machines_to_racks_, "%ju,%d,%ju,%ju\n", timestamp, MACHINE_REMOVE,
-            *machine_id, rack_id);
+    uint64_t record[kMachineToRackFields] = {timestamp, MACHINE_REMOVE,
+                                             *machine_id, rack_id};
+    trace_writer_->Append(machines_to_racks_, record);
   }
 }
 
@@ -265,19 +362,22 @@ void TraceGenerator::SchedulerRun(
                    << "% of tasks are unscheduled";
     }
     uint64_t timestamp = time_manager_->GetCurrentTimestamp();
-    fprintf(scheduler_events_, "%ju,%ju,%ju,%ju,%ju,%ju,%ju,%ju,%ju,%ju,%s\n",
-            timestamp, scheduler_stats.scheduler_runtime_,
-            scheduler_stats.algorithm_runtime_,
-            scheduler_stats.total_runtime_,
-            unscheduled_tasks_cnt_, evicted_tasks_cnt_, migrated_tasks_cnt_,
-            unscheduled_tasks_cnt_ + running_tasks_cnt_,
-            task_events_cnt_per_round_, machine_events_cnt_per_round_,
-            dimacs_stats.GetStatsString().c_str());
+    uint64_t record[kSchedulerEventFields] = {
+      timestamp, scheduler_stats.scheduler_runtime_,
+      scheduler_stats.algorithm_runtime_, scheduler_stats.total_runtime_,
+      unscheduled_tasks_cnt_, evicted_tasks_cnt_, migrated_tasks_cnt_,
+      unscheduled_tasks_cnt_ + running_tasks_cnt_,
+      task_events_cnt_per_round_, machine_events_cnt_per_round_,
+      dimacs_stats.nodes_added_, dimacs_stats.nodes_removed_,
+      dimacs_stats.arcs_added_, dimacs_stats.arcs_changed_,
+      dimacs_stats.arcs_removed_};
+    memcpy(&record[15], dimacs_stats.num_changes_of_type_,
+           sizeof(dimacs_stats.num_changes_of_type_));
+    trace_writer_->Append(scheduler_events_, record);
     evicted_tasks_cnt_ = 0;
     migrated_tasks_cnt_ = 0;
     task_events_cnt_per_round_ = 0;
     machine_events_cnt_per_round_ = 0;
-    fflush(scheduler_events_);
   }
 }
 
@@ -312,9 +412,7 @@ void TraceGenerator::TaskSubmitted(TaskDescriptor* td_ptr) {
         *num_tasks = *num_tasks + 1;
       }
     }
-    fprintf(task_events_, "%ju,,%ju,%ju,,%d,,,,,,,\n",
-            timestamp, job_id, trace_task_id, TASK_SUBMIT_EVENT);
-    fflush(task_events_);
+    WriteTaskEvent(timestamp, job_id, trace_task_id, 0, TASK_SUBMIT_EVENT);
     TaskRuntime* tr_ptr = FindOrNull(task_to_runtime_, task_id);
     if (tr_ptr == NULL) {
       TaskRuntime task_runtime;
@@ -338,17 +436,13 @@ void TraceGenerator::TaskCompleted(TaskID_t task_id,
     TaskRuntime* tr_ptr = FindOrNull(task_to_runtime_, task_id);
     CHECK_NOTNULL(tr_ptr);
     uint64_t machine_id = GetMachineId(rd);
-    fprintf(task_events_, "%ju,,%ju,%ju,%ju,%d,,,,,,,\n",
-            timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
-            TASK_FINISH_EVENT);
-    fflush(task_events_);
+    WriteTaskEvent(timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
+                   TASK_FINISH_EVENT);
     // XXX(ionel): This assumes that only one task with task_id is running
     // at a time.
     tr_ptr->total_runtime_ += timestamp - tr_ptr->last_schedule_time_;
     tr_ptr->runtime_ = timestamp - tr_ptr->last_schedule_time_;
-    fprintf(task_runtime_events_, "%ju,%ju,%ju,%ju,%ju,%ju,%ju\n",
-            *job_id_ptr, tr_ptr->task_id_, *job_id_ptr, tr_ptr->start_time_,
-            tr_ptr->total_runtime_, tr_ptr->runtime_, tr_ptr->num_runs_);
+    WriteTaskRuntime(*job_id_ptr, *tr_ptr);
     task_to_job_.erase(task_id);
     task_to_runtime_.erase(task_id);
   }
@@ -369,10 +463,8 @@ void TraceGenerator::TaskEvicted(TaskID_t task_id,
     TaskRuntime* tr_ptr = FindOrNull(task_to_runtime_, task_id);
     CHECK_NOTNULL(tr_ptr);
     uint64_t machine_id = GetMachineId(rd);
-    fprintf(task_events_, "%ju,,%ju,%ju,%ju,%d,,,,,,,\n",
-            timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
-            TASK_EVICT_EVENT);
-    fflush(task_events_);
+    WriteTaskEvent(timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
+                   TASK_EVICT_EVENT);
     // XXX(ionel): This assumes that only one task with task_id is running
     // at a time.
     tr_ptr->total_runtime_ += timestamp - tr_ptr->last_schedule_time_;
@@ -390,16 +482,12 @@ void TraceGenerator::TaskFailed(TaskID_t task_id,
     TaskRuntime* tr_ptr = FindOrNull(task_to_runtime_, task_id);
     CHECK_NOTNULL(tr_ptr);
     uint64_t machine_id = GetMachineId(rd);
-    fprintf(task_events_, "%ju,,%ju,%ju,%ju,%d,,,,,,,\n",
-            timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
-            TASK_FAIL_EVENT);
-    fflush(task_events_);
+    WriteTaskEvent(timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
+                   TASK_FAIL_EVENT);
     // XXX(ionel): This assumes that only one task with task_id is running
     // at a time.
     tr_ptr->total_runtime_ += timestamp - tr_ptr->last_schedule_time_;
-    fprintf(task_runtime_events_, "%ju,%ju,%ju,%ju,%ju,%ju,%ju\n",
-            *job_id_ptr, tr_ptr->task_id_, *job_id_ptr, tr_ptr->start_time_,
-            tr_ptr->total_runtime_, tr_ptr->runtime_, tr_ptr->num_runs_);
+    WriteTaskRuntime(*job_id_ptr, *tr_ptr);
     task_to_job_.erase(task_id);
     task_to_runtime_.erase(task_id);
   }
@@ -416,16 +504,12 @@ void TraceGenerator::TaskKilled(TaskID_t task_id,
     TaskRuntime* tr_ptr = FindOrNull(task_to_runtime_, task_id);
     CHECK_NOTNULL(tr_ptr);
     uint64_t machine_id = GetMachineId(rd);
-    fprintf(task_events_, "%ju,,%ju,%ju,%ju,%d,,,,,,,\n",
-            timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
-            TASK_KILL_EVENT);
-    fflush(task_events_);
+    WriteTaskEvent(timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
+                   TASK_KILL_EVENT);
     // XXX(ionel): This assumes that only one task with task_id is running
     // at a time.
     tr_ptr->total_runtime_ += timestamp - tr_ptr->last_schedule_time_;
-    fprintf(task_runtime_events_, "%ju,%ju,%ju,%ju,%ju,%ju,%ju\n",
-            *job_id_ptr, tr_ptr->task_id_, *job_id_ptr, tr_ptr->start_time_,
-            tr_ptr->total_runtime_, tr_ptr->runtime_, tr_ptr->num_runs_);
+    WriteTaskRuntime(*job_id_ptr, *tr_ptr);
     task_to_job_.erase(task_id);
     task_to_runtime_.erase(task_id);
   }
@@ -455,13 +539,30 @@ void TraceGenerator::TaskScheduled(TaskID_t task_id,
     TaskRuntime* tr_ptr = FindOrNull(task_to_runtime_, task_id);
     CHECK_NOTNULL(tr_ptr);
     uint64_t machine_id = GetMachineId(rd);
-    fprintf(task_events_, "%ju,,%ju,%ju,%ju,%d,,,,,,,\n",
-            timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
-            TASK_SCHEDULE_EVENT);
-    fflush(task_events_);
+    WriteTaskEvent(timestamp, *job_id_ptr, tr_ptr->task_id_, machine_id,
+                   TASK_SCHEDULE_EVENT);
     tr_ptr->num_runs_++;
     tr_ptr->last_schedule_time_ = timestamp;
   }
 }
 
+void TraceGenerator::WriteTaskEvent(uint64_t timestamp, uint64_t job_id,
+                                    uint64_t trace_task_id,
+                                    uint64_t machine_id,
+                                    TraceTaskEvent event) {
+  uint64_t record[kTaskEventFields] = {timestamp, job_id, trace_task_id,
+                                       machine_id,
+                                       static_cast<uint64_t>(event)};
+  trace_writer_->Append(task_events_, record);
+}
+
+void TraceGenerator::WriteTaskRuntime(uint64_t job_id,
+                                      const TaskRuntime& task_runtime) {
+  uint64_t record[kTaskRuntimeFields] = {
+    job_id, task_runtime.task_id_, task_runtime.start_time_,
+    task_runtime.total_runtime_, task_runtime.runtime_,
+    task_runtime.num_runs_};
+  trace_writer_->Append(task_runtime_events_, record);
+}
+
 } // namespace firmament
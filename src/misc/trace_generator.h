@@ -25,6 +25,7 @@
 
 #include "base/types.h"
 #include "misc/time_interface.h"
+#include "misc/trace_writer.h"
 #include "scheduling/flow/dimacs_change_stats.h"
 #include "scheduling/scheduler_interface.h"
 
@@ -55,6 +56,18 @@ enum TraceDFSEvent {
   BLOCK_REMOVE = 1
 };
 
+// Number of fields of the records of every generated trace file.
+static const uint32_t kMachineEventFields = 3;
+static const uint32_t kSchedulerEventFields = 15 + NUM_CHANGE_TYPES;
+static const uint32_t kTaskEventFields = 5;
+static const uint32_t kTaskRuntimeFields = 6;
+static const uint32_t kJobNumTasksFields = 2;
+static const uint32_t kTaskUsageStatFields = 2;
+static const uint32_t kDFSEventFields = 5;
+static const uint32_t kTaskToBlockFields = 3;
+static const uint32_t kMachineToRackFields = 4;
+static const uint32_t kQuincyTaskFields = 10;
+
 struct TaskRuntime {
   TaskRuntime() : task_id_(0), start_time_(0), num_runs_(0),
     last_schedule_time_(0), total_runtime_(0), runtime_(0),
@@ -111,6 +124,10 @@ class TraceGenerator {
 
  private:
   uint64_t GetMachineId(const ResourceDescriptor& rd);
+  void WriteTaskEvent(uint64_t timestamp, uint64_t job_id,
+                      uint64_t trace_task_id, uint64_t machine_id,
+                      TraceTaskEvent event);
+  void WriteTaskRuntime(uint64_t job_id, const TaskRuntime& task_runtime);
 
   TimeInterface* time_manager_;
   unordered_map<TaskID_t, uint64_t> task_to_job_;
@@ -121,16 +138,20 @@ class TraceGenerator {
   unordered_map<TaskID_t, TaskRuntime> task_to_runtime_;
   unordered_map<ResourceID_t, uint64_t,
       boost::hash<ResourceID_t>> machine_res_id_to_trace_id_;
-  FILE* machine_events_;
-  FILE* scheduler_events_;
-  FILE* task_events_;
-  FILE* task_runtime_events_;
-  FILE* jobs_num_tasks_;
-  FILE* task_usage_stat_;
-  FILE* dfs_events_;
-  FILE* tasks_to_blocks_;
-  FILE* machines_to_racks_;
-  FILE* quincy_tasks_;
+  // Writes the trace files on a background thread, so that the scheduler
+  // does not wait for the file I/O.
+  TraceWriter* trace_writer_;
+  // Ids of the trace_writer_ files.
+  uint32_t machine_events_;
+  uint32_t scheduler_events_;
+  uint32_t task_events_;
+  uint32_t task_runtime_events_;
+  uint32_t jobs_num_tasks_;
+  uint32_t task_usage_stat_;
+  uint32_t dfs_events_;
+  uint32_t tasks_to_blocks_;
+  uint32_t machines_to_racks_;
+  uint32_t quincy_tasks_;
   uint64_t unscheduled_tasks_cnt_;
   uint64_t running_tasks_cnt_;
   uint64_t evicted_tasks_cnt_;
@@ -0,0 +1,284 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Background trace file writer.
+
+#include "misc/trace_writer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace firmament {
+
+boost::mutex TraceWriter::open_writers_lock_;
+set<TraceWriter*>* TraceWriter::open_writers_ = NULL;
+
+// Size of the stdio buffer of every file.
+static const size_t kTraceFileBufferSize = 1 << 20;
+
+bool ReadBinaryTraceFile(const string& file_name, uint32_t num_fields,
+                         vector<uint64_t>* records) {
+  FILE* file = fopen(file_name.c_str(), "rb");
+  if (file == NULL) {
+    PLOG(ERROR) << "Could not open " << file_name;
+    return false;
+  }
+  BinaryTraceFileHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, kBinaryTraceFileMagic, sizeof(header.magic)) ||
+      header.version != kBinaryTraceFileVersion ||
+      header.num_fields != num_fields) {
+    LOG(ERROR) << file_name << " is not a version " << kBinaryTraceFileVersion
+               << " binary trace file with " << num_fields << " fields";
+    fclose(file);
+    return false;
+  }
+  records->clear();
+  vector<uint64_t> record(num_fields);
+  size_t num_read;
+  while ((num_read = fread(&record[0], sizeof(uint64_t), num_fields,
+                           file)) == num_fields) {
+    records->insert(records->end(), record.begin(), record.end());
+  }
+  bool read_all = num_read == 0 && !ferror(file);
+  fclose(file);
+  if (!read_all) {
+    LOG(ERROR) << "Could not read all the records of " << file_name;
+  }
+  return read_all;
+}
+
+TraceRecordQueue::TraceRecordQueue(uint32_t num_fields, uint64_t capacity)
+  : num_fields_(num_fields), capacity_(1), write_pos_(0),
+    cached_read_pos_(0), read_pos_(0) {
+  CHECK_GT(num_fields_, 0);
+  CHECK_GT(capacity, 0);
+  while (capacity_ * 2 <= capacity) {
+    capacity_ *= 2;
+  }
+  records_.resize(capacity_ * num_fields_);
+}
+
+bool TraceRecordQueue::Append(const uint64_t* record) {
+  uint64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+  if (write_pos - cached_read_pos_ == capacity_) {
+    cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+    if (write_pos - cached_read_pos_ == capacity_) {
+      return false;
+    }
+  }
+  memcpy(&records_[(write_pos & (capacity_ - 1)) * num_fields_], record,
+         num_fields_ * sizeof(uint64_t));
+  write_pos_.store(write_pos + 1, std::memory_order_release);
+  return true;
+}
+
+uint64_t TraceRecordQueue::Peek(const uint64_t** records) {
+  uint64_t read_pos = read_pos_.load(std::memory_order_relaxed);
+  uint64_t num_records =
+    write_pos_.load(std::memory_order_acquire) - read_pos;
+  uint64_t index = read_pos & (capacity_ - 1);
+  *records = &records_[index * num_fields_];
+  return min(num_records, capacity_ - index);
+}
+
+void TraceRecordQueue::Pop(uint64_t num_records) {
+  read_pos_.store(read_pos_.load(std::memory_order_relaxed) + num_records,
+                  std::memory_order_release);
+}
+
+TraceWriter::TraceWriter(TraceFileFormat format, uint64_t queue_size,
+                         uint64_t write_interval)
+  : format_(format), queue_size_(queue_size),
+    write_interval_(write_interval), stop_writer_(false),
+    num_flushes_requested_(0), num_flushes_completed_(0), pid_(getpid()) {
+  writer_thread_ =
+    new boost::thread(boost::bind(&TraceWriter::WriterLoop, this));
+  boost::lock_guard<boost::mutex> lock(open_writers_lock_);
+  if (!open_writers_) {
+    open_writers_ = new set<TraceWriter*>;
+  }
+  open_writers_->insert(this);
+}
+
+TraceWriter::~TraceWriter() {
+  Close();
+  for (auto& trace_file : files_) {
+    delete trace_file->queue;
+    delete trace_file;
+  }
+}
+
+uint32_t TraceWriter::AddFile(const string& path, uint32_t num_fields,
+                              TraceRecordFormatter formatter) {
+  string file_path = path;
+  if (format_ == BINARY_TRACE_FILE) {
+    file_path += ".bin";
+  } else {
+    CHECK_NOTNULL(formatter);
+    file_path += ".csv";
+  }
+  TraceFile* trace_file = new TraceFile;
+  trace_file->file = fopen(file_path.c_str(), "w");
+  CHECK(trace_file->file != NULL) << "Failed to open: " << file_path;
+  trace_file->buffer.resize(kTraceFileBufferSize);
+  setvbuf(trace_file->file, &trace_file->buffer[0], _IOFBF,
+          trace_file->buffer.size());
+  trace_file->formatter = formatter;
+  trace_file->queue = new TraceRecordQueue(
+      num_fields, max(queue_size_ / (num_fields * sizeof(uint64_t)),
+                      static_cast<uint64_t>(1)));
+  if (format_ == BINARY_TRACE_FILE) {
+    BinaryTraceFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kBinaryTraceFileMagic, sizeof(header.magic));
+    header.version = kBinaryTraceFileVersion;
+    header.num_fields = num_fields;
+    CHECK_EQ(fwrite(&header, sizeof(header), 1, trace_file->file), 1)
+      << "Failed to write: " << file_path;
+  }
+  boost::lock_guard<boost::mutex> lock(writer_lock_);
+  CHECK(writer_thread_ != NULL) << "The trace writer has been closed";
+  files_.push_back(trace_file);
+  return files_.size() - 1;
+}
+
+void TraceWriter::Close() {
+  if (!writer_thread_) {
+    return;
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(open_writers_lock_);
+    open_writers_->erase(this);
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(writer_lock_);
+    stop_writer_ = true;
+  }
+  writer_cond_.notify_one();
+  writer_thread_->join();
+  delete writer_thread_;
+  writer_thread_ = NULL;
+  for (auto& trace_file : files_) {
+    fclose(trace_file->file);
+  }
+}
+
+void TraceWriter::Flush() {
+  boost::unique_lock<boost::mutex> lock(writer_lock_);
+  uint64_t flush_id = ++num_flushes_requested_;
+  writer_cond_.notify_one();
+  while (num_flushes_completed_ < flush_id) {
+    written_cond_.wait(lock);
+  }
+}
+
+void TraceWriter::InstallFailureFunction() {
+  google::InstallFailureFunction(&TraceWriter::FlushAllAndAbort);
+}
+
+void TraceWriter::FlushAllAndAbort() {
+  // A failure while the records are written out (e.g., in a writer thread)
+  // must not wait for the first failure's flush.
+  static std::atomic<bool> failed(false);
+  if (failed.exchange(true)) {
+    abort();
+  }
+  boost::lock_guard<boost::mutex> lock(open_writers_lock_);
+  if (!open_writers_) {
+    abort();
+  }
+  for (auto& writer : *open_writers_) {
+    // The writer thread cannot flush its own records if it's the one that
+    // failed, as it holds the writer lock.
+    if (writer->pid_ == getpid() &&
+        writer->writer_thread_->get_id() != boost::this_thread::get_id()) {
+      writer->Flush();
+    }
+  }
+  abort();
+}
+
+void TraceWriter::WaitAndAppend(TraceRecordQueue* queue,
+                                const uint64_t* record) {
+  do {
+    writer_cond_.notify_one();
+    boost::this_thread::yield();
+  } while (!queue->Append(record));
+}
+
+void TraceWriter::WriteQueuedRecords() {
+  for (auto& trace_file : files_) {
+    TraceRecordQueue* queue = trace_file->queue;
+    uint32_t num_fields = queue->num_fields();
+    bool wrote_records = false;
+    const uint64_t* records;
+    uint64_t num_records;
+    // The records can wrap around the end of the queue.
+    while ((num_records = queue->Peek(&records)) > 0) {
+      if (format_ == BINARY_TRACE_FILE) {
+        CHECK_EQ(fwrite(records, num_fields * sizeof(uint64_t), num_records,
+                        trace_file->file), num_records);
+      } else {
+        for (uint64_t index = 0; index < num_records; ++index) {
+          trace_file->formatter(trace_file->file,
+                                records + index * num_fields);
+        }
+      }
+      queue->Pop(num_records);
+      wrote_records = true;
+    }
+    if (wrote_records) {
+      fflush(trace_file->file);
+    }
+  }
+}
+
+void TraceWriter::WriterLoop() {
+  boost::unique_lock<boost::mutex> lock(writer_lock_);
+  while (true) {
+    bool stop = stop_writer_;
+    uint64_t num_flushes_requested = num_flushes_requested_;
+    if (!stop && num_flushes_requested == num_flushes_completed_) {
+      writer_cond_.timed_wait(
+          lock, boost::posix_time::microseconds(write_interval_));
+      stop = stop_writer_;
+      num_flushes_requested = num_flushes_requested_;
+    }
+    // The records appended before the stop or the flush was requested are
+    // visible now, as the requests were made under the lock.
+    WriteQueuedRecords();
+    if (num_flushes_requested != num_flushes_completed_) {
+      num_flushes_completed_ = num_flushes_requested;
+      written_cond_.notify_all();
+    }
+    if (stop) {
+      return;
+    }
+  }
+}
+
+}  // namespace firmament
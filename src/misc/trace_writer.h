@@ -0,0 +1,245 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Writes trace files on a background thread. Producers append fixed-size
+// records of 64-bit fields to a per-file single-producer single-consumer
+// queue, and the writer thread formats the queued records and writes them out
+// in large buffered writes. A file is either written as CSV, with a formatter
+// provided by the producer, or as a header followed by the raw records. If
+// the process fails (e.g., on a CHECK failure), the queued records are
+// written out before it aborts.
+
+#ifndef FIRMAMENT_MISC_TRACE_WRITER_H
+#define FIRMAMENT_MISC_TRACE_WRITER_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "base/common.h"
+
+namespace firmament {
+
+// Must be incremented whenever the layout of the binary files changes.
+static const uint32_t kBinaryTraceFileVersion = 1;
+static const char kBinaryTraceFileMagic[8] = {'F', 'I', 'R', 'M', 'G', 'T',
+                                              'R', '\0'};
+
+// Header of a binary trace file. It is followed by the records, each of
+// which is num_fields little-endian 64-bit fields. Signed fields are stored in
+// two's complement.
+struct BinaryTraceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_fields;
+};
+
+/**
+ * Reads the records of a binary file written by a TraceWriter.
+ * @param file_name the path of the file, including the extension
+ * @param num_fields the number of fields that the file's records must have
+ * @param records set to the fields of all the records, one record after the
+ * other
+ * @return false if the file could not be read, or if it is not a binary trace
+ * file of the current version with records of num_fields fields
+ */
+bool ReadBinaryTraceFile(const string& file_name, uint32_t num_fields,
+                         vector<uint64_t>* records);
+
+enum TraceFileFormat {
+  CSV_TRACE_FILE = 0,
+  BINARY_TRACE_FILE = 1,
+};
+
+// Writes a record as a CSV line.
+typedef void (*TraceRecordFormatter)(FILE* file, const uint64_t* record);
+
+class TraceRecordQueue {
+ public:
+  /**
+   * @param num_fields the number of fields of every record
+   * @param capacity the number of records the queue can hold; it is rounded
+   * down to a power of two
+   */
+  TraceRecordQueue(uint32_t num_fields, uint64_t capacity);
+
+  /**
+   * Copies a record into the queue. It must only be called by the producer.
+   * @return false if the queue is full
+   */
+  bool Append(const uint64_t* record);
+  uint32_t num_fields() const {
+    return num_fields_;
+  }
+
+  /**
+   * Checks if the queue has just become half full, based on the producer's
+   * possibly stale view of the consumer's position. It must only be called
+   * by the producer, after a successful Append.
+   */
+  bool JustReachedHalfCapacity() const {
+    return write_pos_.load(std::memory_order_relaxed) - cached_read_pos_ ==
+      capacity_ / 2;
+  }
+
+  /**
+   * Makes the records returned by the last call to Peek available to the
+   * producer again. It must only be called by the consumer.
+   */
+  void Pop(uint64_t num_records);
+
+  /**
+   * Returns the oldest queued records that are contiguous in memory. It must
+   * only be called by the consumer.
+   * @param records set to the first of the returned records
+   * @return the number of records returned
+   */
+  uint64_t Peek(const uint64_t** records);
+
+ private:
+  uint32_t num_fields_;
+  uint64_t capacity_;
+  vector<uint64_t> records_;
+  // The positions are record counts since the queue was created; they never
+  // wrap. Keep the producer's and the consumer's fields on separate cache
+  // lines.
+  char padding0_[64];
+  std::atomic<uint64_t> write_pos_;
+  // The producer's copy of read_pos_, which is only refreshed when the queue
+  // looks full.
+  uint64_t cached_read_pos_;
+  char padding1_[48];
+  std::atomic<uint64_t> read_pos_;
+  char padding2_[56];
+};
+
+class TraceWriter {
+ public:
+  /**
+   * @param format the format of the files
+   * @param queue_size the number of bytes of records that can be queued for
+   * every file before producers wait for the writer thread
+   * @param write_interval the interval (in microseconds) at which the writer
+   * thread writes out the queued records
+   */
+  TraceWriter(TraceFileFormat format, uint64_t queue_size,
+              uint64_t write_interval);
+  ~TraceWriter();
+
+  /**
+   * Opens a file. It must not be called concurrently with Append.
+   * @param path the path of the file, without the extension, which depends
+   * on the format
+   * @param num_fields the number of fields of the file's records
+   * @param formatter the function that formats the records of CSV files
+   * @return the id of the file to append records to
+   */
+  uint32_t AddFile(const string& path, uint32_t num_fields,
+                   TraceRecordFormatter formatter);
+
+  /**
+   * Queues a record to be written to a file. It only waits if the file's
+   * queue is full. The calls for a file must not be concurrent.
+   * @param file_id the id returned by AddFile
+   * @param record the num_fields fields of the record
+   */
+  inline void Append(uint32_t file_id, const uint64_t* record) {
+    TraceRecordQueue* queue = files_[file_id]->queue;
+    if (!queue->Append(record)) {
+      WaitAndAppend(queue, record);
+    } else if (queue->JustReachedHalfCapacity()) {
+      // Wake up the writer thread before the producer has to wait.
+      writer_cond_.notify_one();
+    }
+  }
+
+  /**
+   * Writes out the records that have been queued, and closes the files.
+   * Records must not be appended afterwards.
+   */
+  void Close();
+
+  /**
+   * Waits until all the records queued before the call have been written to
+   * the files.
+   */
+  void Flush();
+
+  /**
+   * Installs a glog failure function that writes out the records queued in
+   * all the open writers before it aborts. It replaces the failure function
+   * that was installed before, so the binary's main decides whether to call
+   * it. Otherwise, the queued records are lost if the process fails.
+   */
+  static void InstallFailureFunction();
+
+ private:
+  struct TraceFile {
+    FILE* file;
+    TraceRecordFormatter formatter;
+    TraceRecordQueue* queue;
+    vector<char> buffer;
+  };
+
+  /**
+   * The failure function installed by InstallFailureFunction. Writes out the
+   * records queued in all the open writers and aborts.
+   */
+  static void FlushAllAndAbort();
+  void WaitAndAppend(TraceRecordQueue* queue, const uint64_t* record);
+  /**
+   * Writes out the records that are queued.
+   */
+  void WriteQueuedRecords();
+  void WriterLoop();
+
+  TraceFileFormat format_;
+  uint64_t queue_size_;
+  uint64_t write_interval_;
+  vector<TraceFile*> files_;
+  boost::thread* writer_thread_;
+  boost::mutex writer_lock_;
+  // Wakes up the writer thread.
+  boost::condition_variable writer_cond_;
+  // Signalled when the writer thread has written out the queued records.
+  boost::condition_variable written_cond_;
+  bool stop_writer_;
+  // Number of flushes requested and completed.
+  uint64_t num_flushes_requested_;
+  uint64_t num_flushes_completed_;
+  // The process that created the writer. A forked child does not have the
+  // writer thread, so it must not wait for it.
+  pid_t pid_;
+  // The open writers, which are flushed if the process fails.
+  static boost::mutex open_writers_lock_;
+  static set<TraceWriter*>* open_writers_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_MISC_TRACE_WRITER_H
@@ -0,0 +1,188 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Trace writer unit tests.
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/common.h"
+#include "misc/trace_writer.h"
+
+namespace firmament {
+
+static void FormatTestRecord(FILE* file, const uint64_t* record) {
+  fprintf(file, "%ju,%ju\n", record[0], record[1]);
+}
+
+class TraceWriterTest : public ::testing::Test {
+ protected:
+  TraceWriterTest() {
+    char file_name[] = "/tmp/trace_writer_test_XXXXXX";
+    int fd = mkstemp(file_name);
+    CHECK_GE(fd, 0);
+    close(fd);
+    unlink(file_name);
+    path_ = file_name;
+  }
+
+  virtual ~TraceWriterTest() {
+    unlink((path_ + ".csv").c_str());
+    unlink((path_ + ".bin").c_str());
+  }
+
+  string ReadFile(const string& file_name) {
+    std::ifstream file(file_name.c_str(), std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+  }
+
+  string path_;
+};
+
+// Tests that the records wrap around the end of the queue.
+TEST_F(TraceWriterTest, QueueWrapsAround) {
+  // The capacity is rounded down to 4 records.
+  TraceRecordQueue queue(2, 5);
+  const uint64_t* records;
+  for (uint64_t round = 0; round < 3; ++round) {
+    for (uint64_t index = 0; index < 3; ++index) {
+      uint64_t record[2] = {round, index};
+      ASSERT_TRUE(queue.Append(record));
+    }
+    uint64_t num_read = 0;
+    uint64_t num_records;
+    while ((num_records = queue.Peek(&records)) > 0) {
+      for (uint64_t index = 0; index < num_records; ++index) {
+        EXPECT_EQ(records[index * 2], round);
+        EXPECT_EQ(records[index * 2 + 1], num_read + index);
+      }
+      queue.Pop(num_records);
+      num_read += num_records;
+    }
+    EXPECT_EQ(num_read, 3);
+  }
+}
+
+// Tests that records are not appended when the queue is full.
+TEST_F(TraceWriterTest, QueueFull) {
+  TraceRecordQueue queue(1, 2);
+  uint64_t record = 1;
+  EXPECT_TRUE(queue.Append(&record));
+  EXPECT_TRUE(queue.JustReachedHalfCapacity());
+  EXPECT_TRUE(queue.Append(&record));
+  EXPECT_FALSE(queue.Append(&record));
+  const uint64_t* records;
+  EXPECT_EQ(queue.Peek(&records), 2);
+  queue.Pop(1);
+  EXPECT_TRUE(queue.Append(&record));
+}
+
+// Tests that all the records are written, in order, even though the producer
+// has to wait for the writer thread.
+TEST_F(TraceWriterTest, WriteCSV) {
+  // The queue only holds 4 records.
+  TraceWriter writer(CSV_TRACE_FILE, 4 * 2 * sizeof(uint64_t), 1000);
+  uint32_t file_id = writer.AddFile(path_, 2, &FormatTestRecord);
+  string expected;
+  for (uint64_t index = 0; index < 1000; ++index) {
+    uint64_t record[2] = {index, index * 2};
+    writer.Append(file_id, record);
+    expected += to_string(index) + "," + to_string(index * 2) + "\n";
+  }
+  writer.Flush();
+  EXPECT_EQ(ReadFile(path_ + ".csv"), expected);
+  uint64_t record[2] = {1000, 2000};
+  writer.Append(file_id, record);
+  writer.Close();
+  EXPECT_EQ(ReadFile(path_ + ".csv"), expected + "1000,2000\n");
+}
+
+// Queues ten records and fails before the writer thread writes them out.
+static void AppendRecordsAndFail(const string& path) {
+  // The writer thread only writes out the records once an hour.
+  TraceWriter::InstallFailureFunction();
+  TraceWriter writer(CSV_TRACE_FILE, 1024, 3600000000ULL);
+  uint32_t file_id = writer.AddFile(path, 2, &FormatTestRecord);
+  for (uint64_t index = 0; index < 10; ++index) {
+    uint64_t record[2] = {index, index * 2};
+    writer.Append(file_id, record);
+  }
+  LOG(FATAL) << "Failing with queued records";
+}
+
+// Tests that the queued records are written out if the process fails.
+TEST_F(TraceWriterTest, WriteQueuedRecordsOnFailure) {
+  EXPECT_DEATH(AppendRecordsAndFail(path_), "Failing with queued records");
+  string expected;
+  for (uint64_t index = 0; index < 10; ++index) {
+    expected += to_string(index) + "," + to_string(index * 2) + "\n";
+  }
+  EXPECT_EQ(ReadFile(path_ + ".csv"), expected);
+}
+
+TEST_F(TraceWriterTest, WriteBinary) {
+  TraceWriter writer(BINARY_TRACE_FILE, 1024, 1000);
+  uint32_t file_id = writer.AddFile(path_, 3, NULL);
+  for (uint64_t index = 0; index < 100; ++index) {
+    uint64_t record[3] = {index, index + 1, static_cast<uint64_t>(-1)};
+    writer.Append(file_id, record);
+  }
+  writer.Close();
+  string contents = ReadFile(path_ + ".bin");
+  ASSERT_EQ(contents.size(),
+            sizeof(BinaryTraceFileHeader) + 100 * 3 * sizeof(uint64_t));
+  BinaryTraceFileHeader header;
+  memcpy(&header, contents.data(), sizeof(header));
+  EXPECT_EQ(memcmp(header.magic, kBinaryTraceFileMagic, sizeof(header.magic)),
+            0);
+  EXPECT_EQ(header.version, kBinaryTraceFileVersion);
+  EXPECT_EQ(header.num_fields, 3);
+  const char* data = contents.data() + sizeof(header);
+  for (uint64_t index = 0; index < 100; ++index) {
+    uint64_t record[3];
+    memcpy(record, data + index * sizeof(record), sizeof(record));
+    EXPECT_EQ(record[0], index);
+    EXPECT_EQ(record[1], index + 1);
+    EXPECT_EQ(static_cast<int64_t>(record[2]), -1);
+  }
+  vector<uint64_t> records;
+  ASSERT_TRUE(ReadBinaryTraceFile(path_ + ".bin", 3, &records));
+  ASSERT_EQ(records.size(), 100 * 3);
+  EXPECT_EQ(records[3 * 42], 42);
+  EXPECT_EQ(records[3 * 42 + 1], 43);
+  // The records have three fields.
+  EXPECT_FALSE(ReadBinaryTraceFile(path_ + ".bin", 2, &records));
+}
+
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -247,12 +247,58 @@ DataObjectID_t DataObjectIDFromProtobuf(const ReferenceDescriptor& rd) {
 }
 
 
+#ifdef __PLATFORM_HAS_BOOST__
+// Returns the value of a hexadecimal digit, or -1 if c is not one.
+static inline int32_t HexDigitValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Parses a UUID from its canonical 36-character representation (e.g.,
+// "feedcafe-dead-beef-0123-456789abcdef"). All the IDs we generate are
+// formatted like this. The fast path avoids boost::uuids::string_generator,
+// which is slow because it supports braces, wide characters and missing
+// dashes. We fall back to it for any string not in canonical form.
+static boost::uuids::uuid UUIDFromString(const string& str) {
+  boost::uuids::uuid uuid;
+  if (str.size() == 36 && str[8] == '-' && str[13] == '-' &&
+      str[18] == '-' && str[23] == '-') {
+    const char* cur = str.data();
+    bool valid = true;
+    for (uint32_t index = 0; index < 16; ++index) {
+      if (*cur == '-') {
+        ++cur;
+      }
+      int32_t high = HexDigitValue(cur[0]);
+      int32_t low = HexDigitValue(cur[1]);
+      if (high < 0 || low < 0) {
+        valid = false;
+        break;
+      }
+      uuid.data[index] = static_cast<uint8_t>((high << 4) | low);
+      cur += 2;
+    }
+    if (valid) {
+      return uuid;
+    }
+  }
+  boost::uuids::string_generator gen;
+  uuid = gen(str);
+  return uuid;
+}
+#endif
+
 JobID_t JobIDFromString(const string& str) {
   // XXX(malte): This makes assumptions about JobID_t being a Boost UUID. We
   // should have a generic "JobID_t-from-string" helper instead.
 #ifdef __PLATFORM_HAS_BOOST__
-  boost::uuids::string_generator gen;
-  boost::uuids::uuid job_uuid = gen(str);
+  boost::uuids::uuid job_uuid = UUIDFromString(str);
 #else
   string job_uuid = str;
 #endif
@@ -272,15 +318,14 @@ ResourceID_t MachineResIDForResource(shared_ptr<ResourceMap_t> resource_map,
     rs = FindPtrOrNull(*resource_map, ResourceIDFromString(rtnd->parent_id()));
     rtnd = rs->mutable_topology_node();
   }
-  return ResourceIDFromString(rtnd->resource_desc().uuid());
+  return rs->id();
 }
 
 ResourceID_t ResourceIDFromString(const string& str) {
   // XXX(malte): This makes assumptions about ResourceID_t being a Boost UUID.
   // We should have a generic "JobID_t-from-string" helper instead.
 #ifdef __PLATFORM_HAS_BOOST__
-  boost::uuids::string_generator gen;
-  boost::uuids::uuid res_uuid = gen(str);
+  boost::uuids::uuid res_uuid = UUIDFromString(str);
 #else
   string res_uuid = str;
 #endif
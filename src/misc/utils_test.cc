@@ -105,6 +105,28 @@ TEST_F(UtilsTest, TaskIDFromString) {
   EXPECT_EQ(TaskIDFromString(test2), 16733209960240500155ULL);
 }
 
+// Tests that the canonical-form fast path and boost's string generator parse
+// resource and job IDs identically.
+TEST_F(UtilsTest, ResourceIDFromString) {
+  boost::uuids::string_generator gen;
+  for (uint32_t i = 0; i < 100; ++i) {
+    ResourceID_t res_id = GenerateResourceID();
+    string res_id_str = to_string(res_id);
+    EXPECT_EQ(ResourceIDFromString(res_id_str), res_id);
+    EXPECT_EQ(ResourceIDFromString(res_id_str), gen(res_id_str));
+    JobID_t job_id = GenerateJobID();
+    EXPECT_EQ(JobIDFromString(to_string(job_id)), job_id);
+  }
+  // Upper-case digits are valid in the canonical form.
+  string upper = "FEEDCAFE-DEAD-BEEF-0123-456789ABCDEF";
+  EXPECT_EQ(ResourceIDFromString(upper), gen(upper));
+  // Non-canonical forms are handled by the fallback.
+  string braces = "{feedcafe-dead-beef-0123-456789abcdef}";
+  EXPECT_EQ(ResourceIDFromString(braces), gen(braces));
+  string no_dashes = "feedcafedeadbeef0123456789abcdef";
+  EXPECT_EQ(ResourceIDFromString(no_dashes), gen(no_dashes));
+}
+
 
 
 }  // namespace firmament
@@ -31,6 +31,10 @@
 #include "misc/map-util.h"
 #include "platforms/unix/tcp_connection.h"
 
+DEFINE_uint64(listen_threads, 1, "Number of threads that handle network I/O "
+              "on the listening socket's connections, and that receive "
+              "incoming messages.");
+
 using boost::asio::ip::tcp;
 using boost::posix_time::ptime;
 using boost::posix_time::second_clock;
@@ -85,20 +89,23 @@ void AsyncTCPServer::StartAccept() {
 }
 
 void AsyncTCPServer::DropConnectionForEndpoint(const string& remote_endpoint) {
+  boost::lock_guard<boost::mutex> lock(endpoint_connection_map_mutex_);
   endpoint_connection_map_.erase(remote_endpoint);
 }
 
 void AsyncTCPServer::Run() {
   // TODO(malte): Figure out if we need to reset the io_service itself here,
   // given that it may have been stopped beforehand.
-  VLOG(2) << "Creating IO service thread";
+  CHECK_GT(FLAGS_listen_threads, 0);
+  VLOG(2) << "Creating " << FLAGS_listen_threads << " IO service threads";
   io_service_work_.reset(new boost::asio::io_service::work(*io_service_));
-  thread_.reset(new boost::thread(
-      boost::bind(&boost::asio::io_service::run, io_service_.get())));
-  // Wait for thread to exit
-  VLOG(2) << "IO service thread (" << thread_->get_id()
-          << ") running -- Waiting for join...";
-  thread_->join();
+  for (uint64_t i = 0; i < FLAGS_listen_threads; ++i) {
+    io_threads_.create_thread(
+        boost::bind(&boost::asio::io_service::run, io_service_.get()));
+  }
+  // Wait for threads to exit
+  VLOG(2) << "IO service threads running -- Waiting for join...";
+  io_threads_.join_all();
   VLOG(2) << "IO service terminated; TCP server's Run() method returning...";
 }
 
@@ -122,6 +129,7 @@ void AsyncTCPServer::Stop() {
   // indiscriminately invoke close() here; see CL #241942.
   if (acceptor_.is_open())
     acceptor_.close();
+  boost::lock_guard<boost::mutex> lock(endpoint_connection_map_mutex_);
   for (unordered_map<string, TCPConnection::connection_ptr>::iterator
        c_iter = endpoint_connection_map_.begin();
        c_iter != endpoint_connection_map_.end();
@@ -145,10 +153,14 @@ void AsyncTCPServer::HandleAccept(TCPConnection::connection_ptr connection,
     connection->Start(remote_endpoint);
     // Get string version of remote endpoint
     string remote_ept_str = EndpointToString(*remote_endpoint);
-    // Check we do not already have a connection for this endpoint
-    CHECK(!endpoint_connection_map_.count(remote_ept_str));
-    // Record a mapping for the connection's endpoint
-    InsertIfNotPresent(&endpoint_connection_map_, remote_ept_str, connection);
+    {
+      boost::lock_guard<boost::mutex> lock(endpoint_connection_map_mutex_);
+      // Check we do not already have a connection for this endpoint
+      CHECK(!endpoint_connection_map_.count(remote_ept_str));
+      // Record a mapping for the connection's endpoint
+      InsertIfNotPresent(&endpoint_connection_map_, remote_ept_str,
+                         connection);
+    }
     // Once the connection is up, we invoke the callback to notify the messaging
     // adapter (which will wrap the connection into a channel).
     VLOG(2) << "Invoking accept handler...";
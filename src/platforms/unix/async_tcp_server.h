@@ -56,6 +56,7 @@ class AsyncTCPServer : public boost::enable_shared_from_this<AsyncTCPServer>,
   void Run();
   void Stop();
   TCPConnection::connection_ptr connection(const string& endpoint) {
+    boost::lock_guard<boost::mutex> lock(endpoint_connection_map_mutex_);
     CHECK_EQ(endpoint_connection_map_.count(endpoint), 1);
     return endpoint_connection_map_[endpoint];
   }
@@ -70,8 +71,13 @@ class AsyncTCPServer : public boost::enable_shared_from_this<AsyncTCPServer>,
                     shared_ptr<tcp::endpoint> remote_endpoint);
 
   unordered_map<string, TCPConnection::connection_ptr> endpoint_connection_map_;
+  // Connections are accepted and dropped on different I/O threads.
+  boost::mutex endpoint_connection_map_mutex_;
   AcceptHandler::type accept_handler_;
-  scoped_ptr<boost::thread> thread_;
+  // The threads that run the io_service's handlers. Handlers for different
+  // connections run concurrently; each connection's strand serializes the
+  // handlers for that connection.
+  boost::thread_group io_threads_;
   scoped_ptr<boost::asio::io_service::work> io_service_work_;
   shared_ptr<boost::asio::io_service> io_service_;
   tcp::acceptor acceptor_;
@@ -75,9 +75,13 @@ class StreamSocketsAdapter : public firmament::MessagingAdapterInterface<T>,
     if (endpoint_channel_map_.size() == 0)
       return;
     // Otherwise, let's make sure we have an outstanding async receive request
-    // for each fo them.
+    // for each fo them. Once a channel has one, the next request is issued
+    // when a message has been received, so we only need to look for channels
+    // that have been added since the last call.
     {
       boost::lock_guard<boost::mutex> envel_lock(channel_recv_envelopes_mutex_);
+      if (channel_recv_envelopes_.size() == endpoint_channel_map_.size())
+        return;
       for (__typeof__(endpoint_channel_map_.begin()) chan_iter =
              endpoint_channel_map_.begin();
            chan_iter != endpoint_channel_map_.end();
@@ -85,16 +89,7 @@ class StreamSocketsAdapter : public firmament::MessagingAdapterInterface<T>,
         StreamSocketsChannel<T>* chan = chan_iter->second;
         if (!channel_recv_envelopes_.count(chan)) {
           // No outstanding receive request for this channel, so create one
-          Envelope<T>* envelope = new Envelope<T>();
-          CHECK(InsertIfNotPresent(&channel_recv_envelopes_, chan, envelope));
-          VLOG(2) << "MA replenishing envelope for channel " << chan
-                  << " at " << envelope;
-          chan->RecvA(envelope,
-                      boost::bind(&StreamSocketsAdapter::HandleAsyncMessageRecv,
-                                  this,
-                                  boost::asio::placeholders::error,
-                                  boost::asio::placeholders::bytes_transferred,
-                                  chan));
+          StartRecv(chan, new Envelope<T>());
         }
       }
     }
@@ -276,6 +271,7 @@ class StreamSocketsAdapter : public firmament::MessagingAdapterInterface<T>,
         boost::lock_guard<boost::mutex> envel_lock(
             channel_recv_envelopes_mutex_);
         CHECK(endpoint_channel_map_.erase(remote_endpoint));
+        delete FindPtrOrNull(channel_recv_envelopes_, chan);
         CHECK(channel_recv_envelopes_.erase(chan));
       } else {
         LOG(ERROR) << "Failed to receive on channel at " << chan
@@ -302,20 +298,30 @@ class StreamSocketsAdapter : public firmament::MessagingAdapterInterface<T>,
                    << remote_endpoint;
       return;
     }
-    CHECK_GT(channel_recv_envelopes_.count(chan), 0)
-      << "No envelopes around when we expected to have at least one.";
-    Envelope<T>* envelope = FindPtrOrNull(channel_recv_envelopes_, chan);
+    Envelope<T>* envelope;
+    {
+      boost::lock_guard<boost::mutex> lock(channel_recv_envelopes_mutex_);
+      CHECK_GT(channel_recv_envelopes_.count(chan), 0)
+        << "No envelopes around when we expected to have at least one.";
+      envelope = FindPtrOrNull(channel_recv_envelopes_, chan);
+    }
     CHECK_NOTNULL(envelope);
     VLOG(2) << "Received in MA: " << *envelope << " ("
             << bytes_transferred << ")";
-    // Invoke message receipt callback, if any registered
+    // Invoke message receipt callback, if any registered. This runs on the
+    // I/O thread that received the message, and may run concurrently with
+    // the callbacks for messages received on other channels.
     CHECK(message_recv_handler_ != NULL);
     message_recv_handler_(envelope->data(), chan->RemoteEndpointString());
-    // We've finished dealing with this message, so clean up now.
+    // We've finished dealing with this message, so clean up now, and issue
+    // the next receive request on the channel straight away, rather than
+    // waiting for the next call to AwaitNextMessage(). The envelope is reused
+    // for the next message, which keeps its memory.
     {
       boost::lock_guard<boost::mutex> lock(channel_recv_envelopes_mutex_);
       channel_recv_envelopes_.erase(chan);
-      delete envelope;
+      envelope->Clear();
+      StartRecv(chan, envelope);
     }
     {
       boost::lock_guard<boost::mutex> lock(message_wait_mutex_);
@@ -328,6 +334,25 @@ class StreamSocketsAdapter : public firmament::MessagingAdapterInterface<T>,
     message_wait_condvar_.notify_all();
   }
 
+  /**
+   * Issues an asynchronous receive request on a channel that does not have an
+   * outstanding one. Must be called with channel_recv_envelopes_mutex_ held.
+   * @param chan the channel
+   * @param envelope the empty envelope to receive the message into; the
+   * adapter takes ownership of it
+   */
+  void StartRecv(StreamSocketsChannel<T>* chan, Envelope<T>* envelope) {
+    CHECK(InsertIfNotPresent(&channel_recv_envelopes_, chan, envelope));
+    VLOG(2) << "MA replenishing envelope for channel " << chan
+            << " at " << envelope;
+    chan->RecvA(envelope,
+                boost::bind(&StreamSocketsAdapter::HandleAsyncMessageRecv,
+                            this,
+                            boost::asio::placeholders::error,
+                            boost::asio::placeholders::bytes_transferred,
+                            chan));
+  }
+
   bool _EstablishChannel(const string& endpoint_uri,
                          StreamSocketsChannel<T>* chan) {
     VLOG(1) << "Establishing channel to endpoint " << endpoint_uri
@@ -0,0 +1,150 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Loopback microbenchmark for the stream sockets messaging adapter. Several
+// client channels send heartbeat messages to an adapter listening on the
+// loopback interface, as workers do to their coordinator, and the benchmark
+// reports the number of messages per second that the adapter receives and
+// parses. Run it with --listen_threads to vary the number of I/O threads.
+
+#include <stdio.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/timer/timer.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "base/common.h"
+#include "messages/base_message.pb.h"
+#include "misc/utils.h"
+#include "platforms/unix/stream_sockets_adapter.h"
+#include "platforms/unix/stream_sockets_channel.h"
+
+DEFINE_uint64(benchmark_clients, 8, "Number of client channels that send "
+              "messages concurrently.");
+DEFINE_uint64(benchmark_messages, 100000, "Number of messages that each "
+              "client sends.");
+DEFINE_uint64(benchmark_cpus, 16, "Number of CPUs whose usage each heartbeat "
+              "message reports.");
+
+namespace firmament {
+namespace platform_unix {
+namespace streamsockets {
+
+class StreamSocketsBenchmark {
+ public:
+  StreamSocketsBenchmark() : num_received_(0) {
+  }
+
+  void Run() {
+    StreamSocketsAdapter<BaseMessage> adapter;
+    adapter.RegisterAsyncMessageReceiptCallback(
+        boost::bind(&StreamSocketsBenchmark::HandleMessage, this, _1, _2));
+    string endpoint = adapter.Listen("localhost");
+    vector<StreamSocketsChannel<BaseMessage>*> channels;
+    for (uint64_t i = 0; i < FLAGS_benchmark_clients; ++i) {
+      StreamSocketsChannel<BaseMessage>* channel =
+        new StreamSocketsChannel<BaseMessage>(
+            StreamSocketsChannel<BaseMessage>::SS_TCP);
+      CHECK(channel->Establish(endpoint));
+      channels.push_back(channel);
+    }
+    // Wait for the adapter to accept all the connections, and issue the
+    // first receive request on them.
+    while (adapter.NumActiveChannels() < FLAGS_benchmark_clients) {
+      boost::this_thread::yield();
+    }
+    adapter.AwaitNextMessage();
+    uint64_t num_messages = FLAGS_benchmark_clients * FLAGS_benchmark_messages;
+    boost::timer::cpu_timer timer;
+    boost::thread_group senders;
+    for (auto& channel : channels) {
+      senders.create_thread(
+          boost::bind(&StreamSocketsBenchmark::SendMessages, this, channel));
+    }
+    senders.join_all();
+    while (num_received_.load() < num_messages) {
+      // Issue receive requests on channels whose connections were accepted
+      // late.
+      adapter.AwaitNextMessage();
+      boost::this_thread::yield();
+    }
+    timer.stop();
+    LOG(INFO) << "Received " << num_messages << " messages in "
+              << timer.elapsed().wall / 1000000 << " ms: "
+              << num_messages * 1000000000 / (timer.elapsed().wall + 1)
+              << " messages/s";
+    // Wait for the adapter to drop the channels of the closed connections, so
+    // that it does not close them concurrently when it stops listening.
+    for (auto& channel : channels) {
+      channel->Close();
+      delete channel;
+    }
+    while (adapter.NumActiveChannels() > 0) {
+      boost::this_thread::yield();
+    }
+    adapter.StopListen();
+  }
+
+ private:
+  void HandleMessage(BaseMessage* bm, const string& remote_endpoint) {
+    CHECK(bm->has_heartbeat());
+    num_received_++;
+  }
+
+  void SendMessages(StreamSocketsChannel<BaseMessage>* channel) {
+    BaseMessage bm;
+    HeartbeatMessage* heartbeat = bm.mutable_heartbeat();
+    heartbeat->set_uuid(to_string(GenerateResourceID()));
+    heartbeat->set_location(channel->LocalEndpointString());
+    MachinePerfStatisticsSample* load = heartbeat->mutable_load();
+    load->set_resource_id(heartbeat->uuid());
+    load->set_total_ram(64ULL << 30);
+    for (uint64_t cpu = 0; cpu < FLAGS_benchmark_cpus; ++cpu) {
+      CpuUsage* cpu_usage = load->add_cpus_usage();
+      cpu_usage->set_user(0.5);
+      cpu_usage->set_system(0.1);
+      cpu_usage->set_idle(0.4);
+    }
+    for (uint64_t i = 0; i < FLAGS_benchmark_messages; ++i) {
+      load->set_timestamp(i);
+      load->set_free_ram((32ULL << 30) + i);
+      Envelope<BaseMessage> envelope(&bm);
+      CHECK(channel->SendS(envelope));
+    }
+  }
+
+  std::atomic<uint64_t> num_received_;
+};
+
+}  // namespace streamsockets
+}  // namespace platform_unix
+}  // namespace firmament
+
+int main(int argc, char *argv[]) {
+  firmament::common::InitFirmament(argc, argv);
+  FLAGS_logtostderr = true;
+  firmament::platform_unix::streamsockets::StreamSocketsBenchmark benchmark;
+  benchmark.Run();
+  return 0;
+}
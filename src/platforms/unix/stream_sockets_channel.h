@@ -28,6 +28,7 @@
 #include <string>
 #include <vector>
 
+#include <boost/array.hpp>
 #include <boost/noncopyable.hpp>
 
 #include "base/common.h"
@@ -44,6 +45,11 @@ namespace firmament {
 namespace platform_unix {
 namespace streamsockets {
 
+// Maximum capacity (in bytes) of the receive and send buffers that a channel
+// keeps for its next message. A channel that transfers a larger message frees
+// the buffer afterwards.
+static const size_t kMaxPooledBufferSize = 64 * 1024;
+
 // Channel.
 template <class T>
 class StreamSocketsChannel : public MessagingChannelInterface<T>,
@@ -58,8 +64,7 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
   typedef shared_ptr<type> ptr_type;
 
   explicit StreamSocketsChannel(StreamSocketType type)
-    : async_recv_buffer_(NULL),
-      async_recv_buffer_vec_(NULL),
+    : async_recv_size_(0),
       client_io_service_(new io_service),
       client_socket_(NULL),
       channel_ready_(false),
@@ -77,8 +82,7 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
   }
 
   explicit StreamSocketsChannel(TCPConnection::connection_ptr connection)
-    : async_recv_buffer_(NULL),
-      async_recv_buffer_vec_(NULL),
+    : async_recv_size_(0),
       client_socket_(connection->socket()),
       client_connection_(connection),
       channel_ready_(false),
@@ -229,22 +233,15 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
     }
     // Obtain the lock on the async receive buffer.
     async_recv_lock_.lock();
-    CHECK_EQ(async_recv_buffer_vec_, static_cast<char*>(NULL));
-    CHECK_EQ(async_recv_buffer_,
-             static_cast<boost::asio::mutable_buffers_1*>(NULL));
-    async_recv_buffer_vec_ = reinterpret_cast<char*>(malloc(sizeof(uint64_t)));
-    async_recv_buffer_ =
-      new boost::asio::mutable_buffers_1(async_recv_buffer_vec_,
-                                         sizeof(uint64_t));
     // Asynchronously read the incoming protobuf message length and invoke the
     // second stage of the receive call once we have it.
-    async_read(*client_socket_, *async_recv_buffer_,
-               boost::asio::transfer_exactly(sizeof(uint64_t)),
-               boost::bind(&StreamSocketsChannel<T>::RecvASecondStage,
-                           this,
-                           boost::asio::placeholders::error,
-                           boost::asio::placeholders::bytes_transferred,
-                           message, callback));
+    AsyncReadExactly(boost::asio::mutable_buffers_1(&async_recv_size_,
+                                                    sizeof(uint64_t)),
+                     boost::bind(&StreamSocketsChannel<T>::RecvASecondStage,
+                                 this,
+                                 boost::asio::placeholders::error,
+                                 boost::asio::placeholders::bytes_transferred,
+                                 message, callback));
     // First stage of RecvA always succeeds.
     return true;
   }
@@ -253,7 +250,7 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
    * Synchronous receive -- blocks until the next message is received.
    */
   bool RecvS(misc::Envelope<T>* message) {
-    boost::lock_guard<boost::mutex> lock(sync_send_lock_);
+    boost::lock_guard<boost::mutex> lock(sync_recv_lock_);
     VLOG(2) << "In RecvS, polling for next message";
     if (!Ready()) {
       LOG(WARNING) << "Tried to read from channel " << this
@@ -261,9 +258,9 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
       return false;
     }
     uint64_t len;
-    vector<char> size_buf(sizeof(uint64_t));
-    boost::asio::mutable_buffers_1 size_m_buf(
-        reinterpret_cast<char*>(&size_buf[0]), sizeof(uint64_t));
+    uint64_t msg_size_endian;
+    boost::asio::mutable_buffers_1 size_m_buf(&msg_size_endian,
+                                              sizeof(uint64_t));
     boost::system::error_code error;
     // Read the incoming protobuf message length
     // N.B.: read() blocks until the buffer has been filled, i.e. an entire
@@ -281,16 +278,16 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
     // ... we can get away with a simple CHECK here and assume that we have some
     // incoming data available.
     CHECK_EQ(sizeof(uint64_t), len);
-    uint64_t msg_size = be64toh(*reinterpret_cast<uint64_t*>(&size_buf[0]));
+    uint64_t msg_size = be64toh(msg_size_endian);
     CHECK_GT(msg_size, 0);
     VLOG(3) << "RecvS: size of incoming protobuf from" << RemoteEndpointString()
             << "is " << msg_size << " bytes.";
     // XXX(malte): This is a nasty hack to highlight bugs in the channel logic.
     CHECK_LT(msg_size, 35000) << "Received implausibly large message size "
                               << "from " << RemoteEndpointString();
-    vector<char> buf(msg_size);
+    sync_recv_buffer_.resize(msg_size);
     len = read(*client_socket_,
-               boost::asio::mutable_buffers_1(&buf[0], msg_size),
+               boost::asio::mutable_buffers_1(&sync_recv_buffer_[0], msg_size),
                boost::asio::transfer_exactly(msg_size), error);
     VLOG(2) << "Read " << len << " bytes.";
 
@@ -307,8 +304,10 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
     }
     CHECK_GT(len, 0);
     CHECK_EQ(len, msg_size);
-    // XXX(malte): data copy here -- optimize away if possible.
-    return (message->Parse(&buf[0], len));
+    // The message is parsed straight from the receive buffer.
+    bool result = message->Parse(&sync_recv_buffer_[0], len);
+    ReleaseLargeBuffer(&sync_recv_buffer_);
+    return result;
   }
 
   /**
@@ -327,31 +326,23 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
 
   bool SendS(const misc::Envelope<T>& message) {
     boost::lock_guard<boost::mutex> lock(sync_send_lock_);
-    VLOG(2) << "Trying to send message of size " << message.size()
-            << " on channel " << *this;
     uint64_t msg_size = message.size();
-    vector<char> buf(msg_size);
-    CHECK(message.Serialize(&buf[0], message.size()));
-    // Send data size
+    VLOG(2) << "Trying to send message of size " << msg_size
+            << " on channel " << *this;
+    send_buffer_.resize(msg_size);
+    CHECK(message.Serialize(send_buffer_.data(), msg_size));
+    // Send the data size and the data in a single gathering write.
     boost::system::error_code error;
     uint64_t msg_size_endian = htobe64(msg_size);
-
+    boost::array<boost::asio::const_buffer, 2> buffers = {{
+      boost::asio::buffer(&msg_size_endian, sizeof(msg_size_endian)),
+      boost::asio::buffer(send_buffer_.data(), msg_size)
+    }};
     uint64_t len = boost::asio::write(
-        *client_socket_, boost::asio::buffer(
-            reinterpret_cast<char*>(&msg_size_endian), sizeof(msg_size_endian)),
-        boost::asio::transfer_exactly(sizeof(uint64_t)), error);
-    if (error || len != sizeof(uint64_t)) {
-      LOG(ERROR) << "Error sending size preamble on connection: "
-                 << error.message();
-      if (error)
-        HandleIOError(error);
-      return false;
-    }
-    // Send the data
-    len = boost::asio::write(
-        *client_socket_, boost::asio::buffer(buf, msg_size),
-        boost::asio::transfer_exactly(msg_size), error);
-    if (error || len != msg_size) {
+        *client_socket_, buffers,
+        boost::asio::transfer_exactly(sizeof(uint64_t) + msg_size), error);
+    ReleaseLargeBuffer(&send_buffer_);
+    if (error || len != sizeof(uint64_t) + msg_size) {
       LOG(ERROR) << "Error sending message on connection: "
                  << error.message();
       if (error)
@@ -419,6 +410,36 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
     }
   }
 
+  /**
+   * Fills a buffer from the socket asynchronously. If the channel was
+   * constructed around a server-side connection, whose io_service may be run
+   * by several threads, the handler is wrapped in the connection's strand.
+   * Called with the async_recv_lock_ mutex held.
+   */
+  template <typename Handler>
+  void AsyncReadExactly(boost::asio::mutable_buffers_1 buffer,
+                        Handler handler) {
+    size_t num_bytes = boost::asio::buffer_size(buffer);
+    TCPConnection::connection_ptr connection = client_connection_;
+    if (connection) {
+      async_read(*client_socket_, buffer,
+                 boost::asio::transfer_exactly(num_bytes),
+                 connection->strand()->wrap(handler));
+    } else {
+      async_read(*client_socket_, buffer,
+                 boost::asio::transfer_exactly(num_bytes), handler);
+    }
+  }
+
+  /**
+   * Frees a buffer that has grown larger than kMaxPooledBufferSize; smaller
+   * buffers are kept for the next message.
+   */
+  void ReleaseLargeBuffer(vector<char>* buffer) {
+    if (buffer->capacity() > kMaxPooledBufferSize)
+      vector<char>().swap(*buffer);
+  }
+
   /**
    * Second stage of asynchronous receive, which calls async_recv again in order
    * to get the actual message data.
@@ -446,8 +467,7 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
     CHECK_EQ(sizeof(uint64_t), bytes_read);
     // Nasty cast to get message size indicator received (after endian
     // conversion)
-    uint64_t msg_size =
-      be64toh(*reinterpret_cast<uint64_t*>(async_recv_buffer_vec_));
+    uint64_t msg_size = be64toh(async_recv_size_);
     CHECK_GT(msg_size, 0) << "Received message of length 0 from "
                           << RemoteEndpointString();
     // XXX(malte): This is a nasty hack to highlight bugs in the channel logic.
@@ -455,28 +475,24 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
                                   << "from " << RemoteEndpointString();
     VLOG(2) << "RecvA: size of incoming protobuf from" << RemoteEndpointString()
             << "is " << msg_size << " bytes.";
-    // We still hold the async_recv_lock_ mutex here.
-    free(async_recv_buffer_vec_);
-    async_recv_buffer_vec_ = reinterpret_cast<char*>(malloc(msg_size));
-    VLOG(2) << "New async recv buffer is at "
-            << static_cast<void*>(async_recv_buffer_vec_);
-    delete async_recv_buffer_;
-    async_recv_buffer_ =
-      new boost::asio::mutable_buffers_1(async_recv_buffer_vec_, msg_size);
-    async_read(*client_socket_, *async_recv_buffer_,
-               boost::asio::transfer_exactly(msg_size),
-               boost::bind(&StreamSocketsChannel<T>::RecvAThirdStage,
-                           this,
-                           boost::asio::placeholders::error,
-                           boost::asio::placeholders::bytes_transferred,
-                           msg_size, final_envelope, final_callback));
+    // We still hold the async_recv_lock_ mutex here. The receive buffer is
+    // kept from the previous message, and only grows if this one is larger.
+    async_recv_buffer_.resize(msg_size);
+    AsyncReadExactly(boost::asio::mutable_buffers_1(&async_recv_buffer_[0],
+                                                    msg_size),
+                     boost::bind(&StreamSocketsChannel<T>::RecvAThirdStage,
+                                 this,
+                                 boost::asio::placeholders::error,
+                                 boost::asio::placeholders::bytes_transferred,
+                                 msg_size, final_envelope, final_callback));
   }
 
   /**
    * Third stage of asynchronous receive, which finalizes the message reception
    * by parsing the received data.
    * Called with the async_recv_lock_ mutex held, but releases it before
-   * returning.
+   * invoking the final callback, so that the callback can issue the next
+   * receive on the channel.
    */
   void RecvAThirdStage(const boost::system::error_code& error,
                        const size_t bytes_read, uint64_t message_size,
@@ -503,33 +519,33 @@ class StreamSocketsChannel : public MessagingChannelInterface<T>,
     CHECK_GT(bytes_read, 0);
     CHECK_EQ(bytes_read, message_size);
     VLOG(2) << "About to parse message";
-    if (!final_envelope->Parse(async_recv_buffer_vec_, bytes_read)) {
+    if (!final_envelope->Parse(&async_recv_buffer_[0], bytes_read)) {
       LOG(ERROR) << "Failed to parse protobuf message of " << bytes_read
                  << " bytes!";
     }
-    free(async_recv_buffer_vec_);
-    delete async_recv_buffer_;
-    async_recv_buffer_vec_ = NULL;
-    async_recv_buffer_ = NULL;
+    ReleaseLargeBuffer(&async_recv_buffer_);
+    // Drop the lock. The envelope is owned by the caller of RecvA, and no
+    // further receive can complete on this channel before it issues one.
+    VLOG(2) << "Unlocking async receive buffer";
+    async_recv_lock_.unlock();
     // Invoke the original callback
-    // XXX(malte): potential race condition -- someone else may finish and
-    // invoke the callback before we do (although this is very unlikely).
     VLOG(2) << "About to invoke final async recv callback!";
     final_callback(error, bytes_read, final_envelope);
-    // Drop the lock
-    VLOG(2) << "Unlocking async receive buffer";
-    async_recv_lock_.unlock();
   }
 
  private:
+  // Buffers for synchronous receives and sends, which are kept across
+  // messages, and their locks. A receive and a send can proceed concurrently.
   boost::mutex sync_recv_lock_;
+  vector<char> sync_recv_buffer_;
   boost::mutex sync_send_lock_;
+  vector<char> send_buffer_;
   // Async receive buffer data structures and lock
   boost::mutex async_recv_lock_;
-  //scoped_ptr<boost::asio::mutable_buffers_1> async_recv_buffer_;
-  boost::asio::mutable_buffers_1* async_recv_buffer_;
-  //scoped_ptr<vector<char> > async_recv_buffer_vec_;
-  char* async_recv_buffer_vec_;
+  // The size preamble of the message being received, in network byte order.
+  uint64_t async_recv_size_;
+  // The message being received. The buffer is kept across messages.
+  vector<char> async_recv_buffer_;
   // TCP and io_service data structures
   shared_ptr<boost::asio::io_service> client_io_service_;
   scoped_ptr<boost::asio::io_service::work> io_service_work_;
@@ -54,7 +54,8 @@ class TCPConnection : public boost::enable_shared_from_this<TCPConnection>,
  public:
   typedef shared_ptr<TCPConnection> connection_ptr;
   explicit TCPConnection(shared_ptr<io_service> io_service)
-      : socket_(*io_service), io_service_(io_service), ready_(false) { }
+      : socket_(*io_service), io_service_(io_service), strand_(*io_service),
+        ready_(false) { }
   virtual ~TCPConnection();
   // XXX(malte): unsafe raw pointer, fix this
   tcp::socket* socket() {
@@ -65,12 +66,22 @@ class TCPConnection : public boost::enable_shared_from_this<TCPConnection>,
   const string RemoteEndpointString();
   void Start(shared_ptr<tcp::endpoint> remote_endpoint);
   void Close();
+  /**
+   * The strand that the completion handlers of asynchronous operations on the
+   * connection's socket must be wrapped in. The io_service may be run by
+   * several threads, and the strand ensures that the handlers for one
+   * connection do not run concurrently.
+   */
+  io_service::strand* strand() {
+    return &strand_;
+  }
 
  private:
   void HandleWrite(const boost::system::error_code& error,
                    size_t bytes_transferred);
   tcp::socket socket_;
   shared_ptr<io_service> io_service_;
+  io_service::strand strand_;
   shared_ptr<tcp::endpoint> remote_endpoint_;
   bool ready_;
 };
@@ -20,12 +20,45 @@
 
 #include "scheduling/common.h"
 
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 DEFINE_int64(flow_max_arc_cost, 100000000, "The maximum cost of an arc");
 DEFINE_uint64(num_pref_arcs_task_to_res, 1,
              "Number of preference arcs from task to resources");
 DEFINE_uint64(num_pref_arcs_agg_to_res, 2,
              "Number of preference arcs from equiv class to resources");
+DEFINE_uint64(cost_model_threads, 1,
+              "Number of threads the cost models may use to compute batches "
+              "of arc costs");
 
 namespace firmament {
 
+// Minimum number of items a thread must get in order for us to start it.
+static const uint64_t kMinItemsPerThread = 512;
+
+void ParallelForRanges(uint64_t num_items,
+                       const boost::function<void(uint64_t, uint64_t)>& fn) {
+  uint64_t num_threads =
+    std::min(FLAGS_cost_model_threads, num_items / kMinItemsPerThread);
+  if (num_threads <= 1) {
+    if (num_items > 0) {
+      fn(0, num_items);
+    }
+    return;
+  }
+  uint64_t items_per_thread = (num_items + num_threads - 1) / num_threads;
+  boost::thread_group threads;
+  // The calling thread processes the first range itself.
+  for (uint64_t begin = items_per_thread; begin < num_items;
+       begin += items_per_thread) {
+    threads.create_thread(
+        boost::bind(fn, begin, std::min(begin + items_per_thread, num_items)));
+  }
+  fn(0, items_per_thread);
+  threads.join_all();
+}
+
 }
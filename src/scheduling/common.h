@@ -22,13 +22,29 @@
 #define FIRMAMENT_SCHEDULING_COMMON_H
 
 #include <gflags/gflags.h>
+#include <stdint.h>
+
+#include <boost/function.hpp>
 
 DECLARE_int64(flow_max_arc_cost);
 DECLARE_uint64(num_pref_arcs_task_to_res);
 DECLARE_uint64(num_pref_arcs_agg_to_res);
+DECLARE_uint64(cost_model_threads);
 
 namespace firmament {
 
+/**
+ * Splits [0, num_items) into contiguous ranges and invokes fn(begin, end) on
+ * each of them. The ranges are processed concurrently by up to
+ * --cost_model_threads threads. Small batches are processed in the calling
+ * thread because it's not worth starting threads for them.
+ * @param num_items the number of items to process
+ * @param fn the function to invoke on each range; it must be safe to call
+ * concurrently on disjoint ranges
+ */
+void ParallelForRanges(uint64_t num_items,
+                       const boost::function<void(uint64_t, uint64_t)>& fn);
+
 }
 
 #endif // FIRMAMENT_SCHEDULING_COMMON_H
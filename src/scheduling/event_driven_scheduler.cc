@@ -95,7 +95,10 @@ EventDrivenScheduler::~EventDrivenScheduler() {
 
 void EventDrivenScheduler::AddJob(JobDescriptor* jd_ptr) {
   boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
-  InsertOrUpdate(&jobs_to_schedule_, JobIDFromString(jd_ptr->uuid()), jd_ptr);
+  JobID_t job_id = JobIDFromString(jd_ptr->uuid());
+  InsertOrUpdate(&jobs_to_schedule_, job_id, jd_ptr);
+  // The job is either new or has new tasks, which may be runnable.
+  jobs_to_reduce_.insert(job_id);
 }
 
 void EventDrivenScheduler::BindTaskToResource(TaskDescriptor* td_ptr,
@@ -223,6 +226,8 @@ void EventDrivenScheduler::HandleJobCompletion(JobID_t job_id) {
   CHECK_NOTNULL(jd);
   jobs_to_schedule_.erase(job_id);
   runnable_tasks_.erase(job_id);
+  jobs_with_runnables_.erase(job_id);
+  jobs_to_reduce_.erase(job_id);
   jd->set_state(JobDescriptor::COMPLETED);
   if (event_notifier_) {
     event_notifier_->OnJobCompletion(job_id);
@@ -314,11 +319,6 @@ void EventDrivenScheduler::HandleTaskDelegationFailure(
   JobID_t job_id = JobIDFromString(td_ptr->job_id());
   InsertTaskIntoRunnables(job_id, td_ptr->uid());
   td_ptr->clear_start_time();
-  JobDescriptor* jd = FindOrNull(*job_map_, job_id);
-  CHECK_NOTNULL(jd);
-  // Try again to schedule...
-  scheduler::SchedulerStats scheduler_stats;
-  ScheduleJob(jd, &scheduler_stats);
 }
 
 void EventDrivenScheduler::HandleTaskDelegationSuccess(
@@ -330,7 +330,7 @@ void EventDrivenScheduler::HandleTaskDelegationSuccess(
   // We don't have to check if we're actually removing the task because
   // some schedulers may already remove it before calling
   // HandleTaskDelegationSuccess.
-  runnable_tasks_[job_id].erase(task_id);
+  RemoveTaskFromRunnables(job_id, task_id);
 }
 
 void EventDrivenScheduler::HandleTaskEviction(TaskDescriptor* td_ptr,
@@ -379,6 +379,8 @@ void EventDrivenScheduler::HandleTaskFailure(TaskDescriptor* td_ptr) {
   // (The state may already have been changed elsewhere, but since the failure
   // case can arise unexpectedly, we set it again here).
   td_ptr->set_state(TaskDescriptor::FAILED);
+  // The failed task may have to run again to produce outputs its job needs.
+  jobs_to_reduce_.insert(JobIDFromString(td_ptr->job_id()));
   // We only need to run the scheduler if the failed task was not delegated from
   // elsewhere, i.e. if it is managed by the local scheduler. If so, we kick the
   // scheduler if we haven't exceeded the retry limit.
@@ -433,12 +435,7 @@ void EventDrivenScheduler::HandleTaskPlacement(
   VLOG(1) << "Placing task " << task_id << " on resource " << rd_ptr->uuid();
   BindTaskToResource(td_ptr, rd_ptr);
   // Remove the task from the runnable_tasks.
-  JobID_t job_id = JobIDFromString(td_ptr->job_id());
-  unordered_set<TaskID_t>* runnables_for_job =
-    FindOrNull(runnable_tasks_, job_id);
-  if (runnables_for_job) {
-    runnables_for_job->erase(task_id);
-  }
+  RemoveTaskFromRunnables(JobIDFromString(td_ptr->job_id()), task_id);
   ExecuteTask(td_ptr, rd_ptr);
   trace_generator_->TaskScheduled(task_id, *rd_ptr);
   if (event_notifier_) {
@@ -488,6 +485,7 @@ void EventDrivenScheduler::InsertTaskIntoRunnables(JobID_t job_id,
   } else {
     runnable_tasks_for_job->insert(task_id);
   }
+  jobs_with_runnables_.insert(job_id);
 }
 
 // Implementation of lazy graph reduction algorithm, as per p58, fig. 3.5 in
@@ -503,9 +501,12 @@ void EventDrivenScheduler::LazyGraphReduction(
   // not already concrete.
   VLOG(2) << "for a job with " << output_ids.size() << " outputs";
   for (auto& output_id : output_ids) {
-    unordered_set<ReferenceInterface*> refs = ReferencesForID(*output_id);
-    if (!refs.empty()) {
-      for (auto& ref : refs) {
+    // Look the references up in place rather than copying them with
+    // ReferencesForID.
+    unordered_set<ReferenceInterface*>* refs =
+      object_store_->GetReferences(*output_id);
+    if (refs) {
+      for (auto& ref : *refs) {
         // TODO(malte): this logic is very simple-minded; sometimes, it may be
         // beneficial to produce locally instead of fetching remotely!
         if (ref->Consumable() && !ref->desc().non_deterministic()) {
@@ -553,7 +554,8 @@ void EventDrivenScheduler::LazyGraphReduction(
     if (current_task->state() == TaskDescriptor::CREATED ||
         current_task->state() == TaskDescriptor::BLOCKING) {
       for (auto& dependency : current_task->dependencies()) {
-        ReferenceInterface* ref = ReferenceFromDescriptor(dependency);
+        scoped_ptr<ReferenceInterface> ref(
+            ReferenceFromDescriptor(dependency));
         // Subscribe the current task to the reference, to enable it to be
         // unblocked if it becomes available.
         // Note that we subscribe even tasks whose dependencies are concrete, as
@@ -583,7 +585,7 @@ void EventDrivenScheduler::LazyGraphReduction(
           unordered_set<TaskDescriptor*> producing_tasks =
             ProducingTasksForDataObjectID(ref->id(), job_id);
           if (producing_tasks.size() == 0) {
-            LOG(ERROR) << "Failed to find producing task for ref " << ref
+            LOG(ERROR) << "Failed to find producing task for ref " << *ref
                        << "; will block until it is produced.";
             continue;
           }
@@ -733,6 +735,44 @@ void EventDrivenScheduler::RegisterSimulatedResource(ResourceID_t res_id) {
   CHECK(InsertIfNotPresent(&executors_, res_id, exec));
 }
 
+void EventDrivenScheduler::RestoreSolverState(
+    const SolverState& solver_state) {
+  // The event-driven scheduler doesn't use a solver.
+}
+
+void EventDrivenScheduler::RestoreTaskPlacements(
+    const vector<pair<TaskDescriptor*, ResourceDescriptor*>>& placements) {
+  boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
+  UpdateRunnableTasks();
+  for (auto& placement : placements) {
+    JobDescriptor* jd_ptr =
+      FindOrNull(*job_map_, JobIDFromString(placement.first->job_id()));
+    CHECK_NOTNULL(jd_ptr);
+    if (jd_ptr->state() != JobDescriptor::RUNNING) {
+      jd_ptr->set_state(JobDescriptor::RUNNING);
+    }
+    HandleTaskPlacement(placement.first, placement.second);
+  }
+}
+
+void EventDrivenScheduler::SaveSolverState(SolverState* solver_state) {
+  // The event-driven scheduler doesn't use a solver.
+}
+
+void EventDrivenScheduler::RemoveTaskFromRunnables(JobID_t job_id,
+                                                   TaskID_t task_id) {
+  unordered_set<TaskID_t>* runnable_tasks_for_job =
+    FindOrNull(runnable_tasks_, job_id);
+  if (runnable_tasks_for_job) {
+    // We keep the empty set because callers may hold references to it
+    // (e.g., the one returned by ComputeRunnableTasksForJob).
+    runnable_tasks_for_job->erase(task_id);
+    if (runnable_tasks_for_job->empty()) {
+      jobs_with_runnables_.erase(job_id);
+    }
+  }
+}
+
 void EventDrivenScheduler::RemoveResourceNodeFromParentChildrenList(
     ResourceTopologyNodeDescriptor* rtnd_ptr) {
   ResourceStatus* parent_rs_ptr =
@@ -763,14 +803,29 @@ void EventDrivenScheduler::RemoveResourceNodeFromParentChildrenList(
   }
 }
 
+void EventDrivenScheduler::ComputeJobsWithRunnableTasks(
+    vector<JobDescriptor*>* jds_ptr) {
+  UpdateRunnableTasks();
+  for (auto& job_id : jobs_with_runnables_) {
+    JobDescriptor* jd_ptr = FindPtrOrNull(jobs_to_schedule_, job_id);
+    if (jd_ptr) {
+      jds_ptr->push_back(jd_ptr);
+    }
+  }
+}
+
 const unordered_set<TaskID_t>& EventDrivenScheduler::ComputeRunnableTasksForJob(
     JobDescriptor* job_desc) {
   // TODO(malte): check if this is broken
   unordered_set<DataObjectID_t*> outputs =
       DataObjectIDsFromProtobuf(job_desc->output_ids());
   TaskDescriptor* rtp = job_desc->mutable_root_task();
-  LazyGraphReduction(outputs, rtp, JobIDFromString(job_desc->uuid()));
   JobID_t job_id = JobIDFromString(job_desc->uuid());
+  LazyGraphReduction(outputs, rtp, job_id);
+  for (auto& output : outputs) {
+    delete output;
+  }
+  jobs_to_reduce_.erase(job_id);
   unordered_set<TaskID_t>* runnable_tasks_for_job =
     FindOrNull(runnable_tasks_, job_id);
   if (runnable_tasks_for_job != NULL) {
@@ -839,5 +894,17 @@ bool EventDrivenScheduler::UnbindTaskFromResource(TaskDescriptor* td_ptr,
   }
 }
 
+void EventDrivenScheduler::UpdateRunnableTasks() {
+  // ComputeRunnableTasksForJob removes the job from jobs_to_reduce_.
+  unordered_set<JobID_t, boost::hash<JobID_t>> jobs_to_reduce;
+  jobs_to_reduce.swap(jobs_to_reduce_);
+  for (auto& job_id : jobs_to_reduce) {
+    JobDescriptor* jd_ptr = FindPtrOrNull(jobs_to_schedule_, job_id);
+    if (jd_ptr) {
+      ComputeRunnableTasksForJob(jd_ptr);
+    }
+  }
+}
+
 }  // namespace scheduler
 }  // namespace firmament
@@ -88,6 +88,10 @@ class EventDrivenScheduler : public SchedulerInterface {
   virtual void RegisterResource(ResourceTopologyNodeDescriptor* rtnd_ptr,
                                 bool local,
                                 bool simulated);
+  virtual void RestoreSolverState(const SolverState& solver_state);
+  virtual void RestoreTaskPlacements(
+      const vector<pair<TaskDescriptor*, ResourceDescriptor*>>& placements);
+  virtual void SaveSolverState(SolverState* solver_state);
   // N.B. ScheduleJob must be implemented in scheduler-specific logic
   virtual uint64_t ScheduleAllJobs(SchedulerStats* scheduler_stats) = 0;
   virtual uint64_t ScheduleAllJobs(SchedulerStats* scheduler_stats,
@@ -105,7 +109,9 @@ class EventDrivenScheduler : public SchedulerInterface {
   FRIEND_TEST(SimpleSchedulerTest, FindRunnableTasksForJob);
   FRIEND_TEST(SimpleSchedulerTest, FindRunnableTasksForComplexJob);
   FRIEND_TEST(SimpleSchedulerTest, FindRunnableTasksForComplexJob2);
-  void BindTaskToResource(TaskDescriptor* td_ptr, ResourceDescriptor* rd_ptr);
+  FRIEND_TEST(SimpleSchedulerTest, IncrementalRunnableTasks);
+  virtual void BindTaskToResource(TaskDescriptor* td_ptr,
+                                  ResourceDescriptor* rd_ptr);
   void CleanStateForDeregisteredResource(
       ResourceTopologyNodeDescriptor* rtnd_ptr);
   void DebugPrintRunnableTasks();
@@ -127,6 +133,14 @@ class EventDrivenScheduler : public SchedulerInterface {
   void RegisterRemoteResource(ResourceID_t res_id);
   void RegisterSimulatedResource(ResourceID_t res_id);
 
+  /**
+   * Removes a task from its job's runnable tasks, and the job from the jobs
+   * with runnable tasks if it has no runnable tasks left.
+   * @param job_id the id of the task's job
+   * @param task_id the id of the task
+   */
+  void RemoveTaskFromRunnables(JobID_t job_id, TaskID_t task_id);
+
   /**
    * Removes a resource from its parent's children list.
    * @param rtnd_ptr the resource node to remove
@@ -134,18 +148,38 @@ class EventDrivenScheduler : public SchedulerInterface {
   void RemoveResourceNodeFromParentChildrenList(
       ResourceTopologyNodeDescriptor* rtnd_ptr);
 
+  /**
+   * Updates the runnable tasks of the jobs that have changed, and finds the
+   * jobs to schedule that have runnable tasks.
+   * @param jds_ptr vector to which the jobs with runnable tasks are added
+   */
+  void ComputeJobsWithRunnableTasks(vector<JobDescriptor*>* jds_ptr);
   const unordered_set<TaskID_t>& ComputeRunnableTasksForJob(
       JobDescriptor* job_desc);
   void SetupPUs(ResourceTopologyNodeDescriptor* rtnd_ptr,
                 bool local,
                 bool simulated);
-  bool UnbindTaskFromResource(TaskDescriptor* td_ptr, ResourceID_t res_id);
+  virtual bool UnbindTaskFromResource(TaskDescriptor* td_ptr,
+                                      ResourceID_t res_id);
+
+  /**
+   * Runs the lazy graph reduction for the jobs to schedule that have changed
+   * since their last reduction (e.g., because tasks have been added to them).
+   * The runnable tasks of the other jobs are kept up to date as tasks are
+   * placed, evicted or unblocked.
+   */
+  void UpdateRunnableTasks();
 
-  // Cached sets of runnable and blocked tasks; these are updated on each
-  // execution of LazyGraphReduction. Note that this set includes tasks from all
-  // jobs.
+  // Cached sets of runnable tasks. They are updated by LazyGraphReduction,
+  // and whenever a task becomes runnable or stops being runnable. Note that
+  // this set includes tasks from all jobs.
   unordered_map<JobID_t, unordered_set<TaskID_t>,
     boost::hash<JobID_t>> runnable_tasks_;
+  // The jobs that have a non-empty set in runnable_tasks_.
+  unordered_set<JobID_t, boost::hash<JobID_t>> jobs_with_runnables_;
+  // The jobs whose task graphs have to be reduced again to find their
+  // runnable tasks.
+  unordered_set<JobID_t, boost::hash<JobID_t>> jobs_to_reduce_;
   // Initialized to hold the URI of the (currently unique) coordinator this
   // scheduler is associated with. This is passed down to the executor and to
   // tasks so that they can find the coordinator at runtime.
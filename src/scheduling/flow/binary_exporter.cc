@@ -0,0 +1,193 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Implementation of the binary export utility. Records are accumulated in a
+// buffer and written out in large batches using writev, which avoids the
+// per-line formatting and system call overheads of the DIMACS exporter.
+
+#include "scheduling/flow/binary_exporter.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "scheduling/flow/dimacs_add_node.h"
+
+namespace firmament {
+
+// Number of records after which a full graph export writes out the buffer.
+static const uint64_t kRecordsPerWrite = 16384;
+
+BinaryExporter::BinaryExporter() : fd_(-1), ring_(NULL) {
+}
+
+void BinaryExporter::Export(const FlowGraph& graph, int fd) {
+  fd_ = fd;
+  ring_ = NULL;
+  ExportGraph(graph);
+}
+
+void BinaryExporter::Export(const FlowGraph& graph, SharedMemoryRing* ring) {
+  ring_ = CHECK_NOTNULL(ring);
+  ExportGraph(graph);
+}
+
+void BinaryExporter::ExportEndOfStream(int fd) {
+  fd_ = fd;
+  ring_ = NULL;
+  ExportEOS();
+}
+
+void BinaryExporter::ExportEndOfStream(SharedMemoryRing* ring) {
+  ring_ = CHECK_NOTNULL(ring);
+  ExportEOS();
+}
+
+void BinaryExporter::ExportIncremental(const vector<DIMACSChange*>& changes,
+                                       int fd) {
+  fd_ = fd;
+  ring_ = NULL;
+  ExportChanges(changes);
+}
+
+void BinaryExporter::ExportIncremental(const vector<DIMACSChange*>& changes,
+                                       SharedMemoryRing* ring) {
+  ring_ = CHECK_NOTNULL(ring);
+  ExportChanges(changes);
+}
+
+void BinaryExporter::ExportGraph(const FlowGraph& graph) {
+  SolverWireHeader header;
+  memset(&header, 0, sizeof(SolverWireHeader));
+  header.magic_ = kSolverWireMagic;
+  header.message_type_ = SOLVER_WIRE_GRAPH;
+  header.num_records_ = graph.Nodes().size() + graph.NumArcs();
+  header.num_nodes_ = graph.NumNodes();
+  header.num_arcs_ = graph.NumArcs();
+  SolverWireHeader* pending_header = &header;
+  records_.clear();
+  records_.reserve(kRecordsPerWrite);
+  SolverWireRecord record;
+  memset(&record, 0, sizeof(SolverWireRecord));
+  record.kind_ = SOLVER_WIRE_NODE;
+  for (auto& node_ptr : graph.Nodes()) {
+    const FlowGraphNode& node = *node_ptr;
+    record.type_ = DIMACSAddNode::GetNodeType(node.type_);
+    record.src_ = node.id_;
+    record.cost_ = node.excess_;
+    records_.push_back(record);
+    if (records_.size() == kRecordsPerWrite) {
+      FlushRecords(pending_header);
+      pending_header = NULL;
+    }
+  }
+  record.kind_ = SOLVER_WIRE_ARC;
+  for (const auto& arc : graph.Arcs()) {
+    record.type_ = arc->type_;
+    record.src_ = arc->src_;
+    record.dst_ = arc->dst_;
+    record.cap_lower_bound_ = arc->cap_lower_bound_;
+    record.cap_upper_bound_ = arc->cap_upper_bound_;
+    record.cost_ = arc->cost_;
+    records_.push_back(record);
+    if (records_.size() == kRecordsPerWrite) {
+      FlushRecords(pending_header);
+      pending_header = NULL;
+    }
+  }
+  FlushRecords(pending_header);
+}
+
+void BinaryExporter::ExportEOS() {
+  SolverWireHeader header;
+  memset(&header, 0, sizeof(SolverWireHeader));
+  header.magic_ = kSolverWireMagic;
+  header.message_type_ = SOLVER_WIRE_EOS;
+  records_.clear();
+  FlushRecords(&header);
+}
+
+void BinaryExporter::ExportChanges(const vector<DIMACSChange*>& changes) {
+  // The number of records is only known once all the changes have been
+  // converted. The changes are already in memory, so we buffer all the
+  // records before we write the message.
+  records_.clear();
+  for (const auto& change : changes) {
+    change->GenerateWireRecords(&records_);
+  }
+  SolverWireHeader header;
+  memset(&header, 0, sizeof(SolverWireHeader));
+  header.magic_ = kSolverWireMagic;
+  header.message_type_ = SOLVER_WIRE_DELTA;
+  header.num_records_ = records_.size();
+  FlushRecords(&header);
+}
+
+void BinaryExporter::FlushRecords(SolverWireHeader* header) {
+  struct iovec iov[2];
+  int iovcnt = 0;
+  if (header) {
+    iov[iovcnt].iov_base = header;
+    iov[iovcnt].iov_len = sizeof(SolverWireHeader);
+    iovcnt++;
+  }
+  if (!records_.empty()) {
+    iov[iovcnt].iov_base = &records_[0];
+    iov[iovcnt].iov_len = records_.size() * sizeof(SolverWireRecord);
+    iovcnt++;
+  }
+  if (iovcnt > 0) {
+    if (ring_) {
+      if (!ring_->Write(iov, iovcnt)) {
+        LOG(FATAL) << "Solver closed the shared memory ring";
+      }
+    } else {
+      WriteFully(fd_, iov, iovcnt);
+    }
+  }
+  records_.clear();
+}
+
+void BinaryExporter::WriteFully(int fd, struct iovec* iov, int iovcnt) {
+  while (iovcnt > 0) {
+    ssize_t written = writev(fd, iov, iovcnt);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      PLOG(FATAL) << "Error while writing to solver";
+    }
+    // Skip the iovecs that have been completely written, and adjust the
+    // first one that has only been partially written.
+    size_t remaining = static_cast<size_t>(written);
+    while (iovcnt > 0 && remaining >= iov->iov_len) {
+      remaining -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + remaining;
+      iov->iov_len -= remaining;
+    }
+  }
+}
+
+}  // namespace firmament
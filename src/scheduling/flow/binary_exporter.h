@@ -0,0 +1,78 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Export utility that writes the flow graph or the incremental graph changes
+// to a solver using the binary wire format defined in solver_wire_format.h.
+
+#ifndef FIRMAMENT_SCHEDULING_FLOW_BINARY_EXPORTER_H
+#define FIRMAMENT_SCHEDULING_FLOW_BINARY_EXPORTER_H
+
+#include <sys/uio.h>
+#include <vector>
+
+#include "base/common.h"
+#include "base/types.h"
+#include "scheduling/flow/dimacs_change.h"
+#include "scheduling/flow/flow_graph.h"
+#include "scheduling/flow/shared_memory_ring.h"
+#include "scheduling/flow/solver_wire_format.h"
+
+namespace firmament {
+
+class BinaryExporter {
+ public:
+  BinaryExporter();
+  void Export(const FlowGraph& graph, int fd);
+  void Export(const FlowGraph& graph, SharedMemoryRing* ring);
+  void ExportEndOfStream(int fd);
+  void ExportEndOfStream(SharedMemoryRing* ring);
+  void ExportIncremental(const vector<DIMACSChange*>& changes, int fd);
+  void ExportIncremental(const vector<DIMACSChange*>& changes,
+                         SharedMemoryRing* ring);
+
+  /**
+   * Writes all the data described by the iovecs to the file descriptor. It
+   * retries on interrupts and partial writes.
+   */
+  static void WriteFully(int fd, struct iovec* iov, int iovcnt);
+
+ private:
+  void ExportGraph(const FlowGraph& graph);
+  void ExportChanges(const vector<DIMACSChange*>& changes);
+  void ExportEOS();
+
+  /**
+   * Writes the buffered records to the output, preceded by the header if
+   * header is not NULL, and clears the buffer.
+   */
+  void FlushRecords(SolverWireHeader* header);
+
+  // Buffer of records that have not yet been written. The buffer is reused
+  // across exports in order to avoid allocations.
+  vector<SolverWireRecord> records_;
+  // The output of the current export: either a file descriptor or a shared
+  // memory ring (if ring_ is not NULL).
+  int fd_;
+  SharedMemoryRing* ring_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SCHEDULING_FLOW_BINARY_EXPORTER_H
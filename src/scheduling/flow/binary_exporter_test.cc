@@ -0,0 +1,168 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Tests for the binary wire format exporter.
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "base/common.h"
+#include "scheduling/flow/binary_exporter.h"
+#include "scheduling/flow/dimacs_add_node.h"
+#include "scheduling/flow/dimacs_change_arc.h"
+#include "scheduling/flow/dimacs_remove_node.h"
+#include "scheduling/flow/flow_graph.h"
+
+namespace firmament {
+
+// The fixture for testing the BinaryExporter class.
+class BinaryExporterTest : public ::testing::Test {
+ protected:
+  // You can remove any or all of the following functions if its body
+  // is empty.
+
+  BinaryExporterTest() {
+    // You can do set-up work for each test here.
+    FLAGS_v = 2;
+  }
+
+  virtual ~BinaryExporterTest() {
+    // You can do clean-up work that doesn't throw exceptions here.
+  }
+
+  // If the constructor and destructor are not enough for setting up
+  // and cleaning up each test, you can define the following methods:
+
+  virtual void SetUp() {
+    // Code here will be called immediately after the constructor (right
+    // before each test).
+    CHECK_NOTNULL(output_file_ = tmpfile());
+  }
+
+  virtual void TearDown() {
+    // Code here will be called immediately after each test (right
+    // before the destructor).
+    fclose(output_file_);
+  }
+
+  // Reads back a message written to output_file_.
+  void ReadMessage(SolverWireHeader* header,
+                   vector<SolverWireRecord>* records) {
+    int fd = fileno(output_file_);
+    CHECK_EQ(lseek(fd, 0, SEEK_SET), 0);
+    CHECK_EQ(read(fd, header, sizeof(SolverWireHeader)),
+             sizeof(SolverWireHeader));
+    CHECK_EQ(header->magic_, kSolverWireMagic);
+    records->resize(header->num_records_);
+    ssize_t length = header->num_records_ * sizeof(SolverWireRecord);
+    if (length > 0) {
+      CHECK_EQ(read(fd, &(*records)[0], length), length);
+    }
+  }
+
+  FILE* output_file_;
+};
+
+// Exports a small graph and checks that all the nodes and arcs are written.
+TEST_F(BinaryExporterTest, ExportGraph) {
+  FlowGraph graph;
+  FlowGraphNode* task_node = graph.AddNode();
+  task_node->type_ = FlowNodeType::UNSCHEDULED_TASK;
+  task_node->excess_ = 1;
+  FlowGraphNode* pu_node = graph.AddNode();
+  pu_node->type_ = FlowNodeType::PU;
+  FlowGraphNode* sink_node = graph.AddNode();
+  sink_node->type_ = FlowNodeType::SINK;
+  sink_node->excess_ = -1;
+  graph.ChangeArc(graph.AddArc(task_node, pu_node), 0, 1, 42);
+  graph.ChangeArc(graph.AddArc(pu_node, sink_node), 0, 1, 0);
+  BinaryExporter exporter;
+  exporter.Export(graph, fileno(output_file_));
+  SolverWireHeader header;
+  vector<SolverWireRecord> records;
+  ReadMessage(&header, &records);
+  CHECK_EQ(header.message_type_, SOLVER_WIRE_GRAPH);
+  CHECK_EQ(header.num_records_, 5);
+  CHECK_EQ(header.num_nodes_, graph.NumNodes());
+  CHECK_EQ(header.num_arcs_, 2);
+  uint64_t num_nodes = 0;
+  for (auto& record : records) {
+    if (record.kind_ == SOLVER_WIRE_NODE) {
+      num_nodes++;
+      if (record.src_ == task_node->id_) {
+        CHECK_EQ(record.cost_, 1);
+        CHECK_EQ(record.type_, DIMACSAddNode::GetNodeType(task_node->type_));
+      }
+    } else {
+      CHECK_EQ(record.kind_, SOLVER_WIRE_ARC);
+      if (record.src_ == task_node->id_) {
+        CHECK_EQ(record.dst_, pu_node->id_);
+        CHECK_EQ(record.cap_upper_bound_, 1);
+        CHECK_EQ(record.cost_, 42);
+      }
+    }
+  }
+  CHECK_EQ(num_nodes, 3);
+}
+
+// Exports incremental changes and checks that they are written in order.
+TEST_F(BinaryExporterTest, ExportIncremental) {
+  FlowGraph graph;
+  FlowGraphNode* src_node = graph.AddNode();
+  FlowGraphNode* dst_node = graph.AddNode();
+  FlowGraphArc* arc = graph.AddArc(src_node, dst_node);
+  graph.ChangeArc(arc, 0, 1, 5);
+  vector<FlowGraphArc*> arcs;
+  arcs.push_back(arc);
+  vector<DIMACSChange*> changes;
+  changes.push_back(new DIMACSAddNode(*src_node, arcs));
+  changes.push_back(new DIMACSChangeArc(*arc, 3));
+  changes.push_back(new DIMACSRemoveNode(*dst_node));
+  BinaryExporter exporter;
+  exporter.ExportIncremental(changes, fileno(output_file_));
+  SolverWireHeader header;
+  vector<SolverWireRecord> records;
+  ReadMessage(&header, &records);
+  CHECK_EQ(header.message_type_, SOLVER_WIRE_DELTA);
+  CHECK_EQ(records.size(), 4);
+  CHECK_EQ(records[0].kind_, SOLVER_WIRE_NODE);
+  CHECK_EQ(records[0].src_, src_node->id_);
+  CHECK_EQ(records[1].kind_, SOLVER_WIRE_ARC);
+  CHECK_EQ(records[1].dst_, dst_node->id_);
+  CHECK_EQ(records[2].kind_, SOLVER_WIRE_CHANGE_ARC);
+  CHECK_EQ(records[2].cost_, 5);
+  CHECK_EQ(records[2].old_cost_, 3);
+  CHECK_EQ(records[3].kind_, SOLVER_WIRE_REMOVE_NODE);
+  CHECK_EQ(records[3].src_, dst_node->id_);
+  for (auto& change : changes) {
+    delete change;
+  }
+}
+
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -30,6 +30,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include <boost/bind.hpp>
+
 #include "base/common.h"
 #include "base/types.h"
 #include "base/units.h"
@@ -67,7 +69,8 @@ CocoCostModel::CocoCostModel(
 }
 
 void CocoCostModel::AccumulateResourceStats(ResourceDescriptor* accumulator,
-                                            ResourceDescriptor* other) {
+                                            ResourceDescriptor* other,
+                                            const FlowGraphNode* other_node) {
   // Track the aggregate available resources below the accumulator node
   ResourceVector* acc_avail = accumulator->mutable_available_resources();
   ResourceVector* other_avail = other->mutable_available_resources();
@@ -129,8 +132,13 @@ void CocoCostModel::AccumulateResourceStats(ResourceDescriptor* accumulator,
   // Interference scores
   CoCoInterferenceScores* aiv = accumulator->mutable_coco_interference_scores();
   const CoCoInterferenceScores& oiv = other->coco_interference_scores();
+  // The flow scheduler registers the resources' statuses with the graph
+  // manager, which we can then ask by handle.
   ResourceStatus* ors =
-    FindPtrOrNull(*resource_map_, ResourceIDFromString(other->uuid()));
+    flow_graph_manager_->ResourceStatusForHandle(other_node->resource_handle_);
+  if (!ors) {
+    ors = FindPtrOrNull(*resource_map_, other_node->resource_id_);
+  }
   CHECK_NOTNULL(ors);
   const ResourceTopologyNodeDescriptor& ortnd = ors->topology_node();
   uint64_t num_children =
@@ -395,6 +403,13 @@ void CocoCostModel::GetInterferenceScoreForTask(
 
 vector<EquivClass_t>* CocoCostModel::GetTaskEquivClasses(TaskID_t task_id) {
   vector<EquivClass_t>* equiv_classes = new vector<EquivClass_t>();
+  FillTaskEquivClasses(task_id, equiv_classes);
+  return equiv_classes;
+}
+
+void CocoCostModel::FillTaskEquivClasses(TaskID_t task_id,
+                                         vector<EquivClass_t>* equiv_classes) {
+  equiv_classes->clear();
   const TaskDescriptor& td = GetTask(task_id);
   // We have one task agg per job. The id of the aggregator is the hash
   // of the job id.
@@ -410,14 +425,21 @@ vector<EquivClass_t>* CocoCostModel::GetTaskEquivClasses(TaskID_t task_id) {
     task_set.insert(task_id);
     CHECK(InsertIfNotPresent(&task_ec_to_set_task_id_, task_agg, task_set));
   }
-  return equiv_classes;
 }
 
 vector<ResourceID_t>* CocoCostModel::GetOutgoingEquivClassPrefArcs(
     EquivClass_t ec) {
+  vector<ResourceID_t>* prefered_res = new vector<ResourceID_t>();
+  FillOutgoingEquivClassPrefArcs(ec, prefered_res);
+  return prefered_res;
+}
+
+void CocoCostModel::FillOutgoingEquivClassPrefArcs(
+    EquivClass_t ec,
+    vector<ResourceID_t>* prefered_res) {
   // TODO(ionel): This method may end up adding many preference arcs.
   // Limit the number of preference arcs it adds.
-  vector<ResourceID_t>* prefered_res = new vector<ResourceID_t>();
+  prefered_res->clear();
   if (task_aggs_.find(ec) != task_aggs_.end()) {
     ResourceStatus* root_rs =
       FindPtrOrNull(*resource_map_,
@@ -427,7 +449,7 @@ vector<ResourceID_t>* CocoCostModel::GetOutgoingEquivClassPrefArcs(
     ResourceTopologyNodeDescriptor* root_rtnd =
       root_rs->mutable_topology_node();
     if (root_rtnd->children_size() == 0) {
-      return prefered_res;
+      return;
     } else {
       // BFS over resource topology.
       // We hand-roll the BFS here instead of using one of the
@@ -485,23 +507,43 @@ vector<ResourceID_t>* CocoCostModel::GetOutgoingEquivClassPrefArcs(
       }
     }
   }
-  return prefered_res;
 }
 
 vector<ResourceID_t>* CocoCostModel::GetTaskPreferenceArcs(TaskID_t task_id) {
+  vector<ResourceID_t>* pref_res = new vector<ResourceID_t>();
+  FillTaskPreferenceArcs(task_id, pref_res);
+  return pref_res;
+}
+
+void CocoCostModel::FillTaskPreferenceArcs(TaskID_t task_id,
+                                           vector<ResourceID_t>* pref_res) {
   // TODO(malte): implement!
-  return NULL;
+  pref_res->clear();
 }
 
 vector<EquivClass_t>* CocoCostModel::GetEquivClassToEquivClassesArcs(
     EquivClass_t tec) {
+  vector<EquivClass_t>* pref_ecs = new vector<EquivClass_t>();
+  FillEquivClassToEquivClassesArcs(tec, pref_ecs);
+  return pref_ecs;
+}
+
+void CocoCostModel::FillEquivClassToEquivClassesArcs(
+    EquivClass_t tec,
+    vector<EquivClass_t>* pref_ecs) {
   // TODO(malte): implement!
-  return NULL;
+  pref_ecs->clear();
 }
 
 // The cost of leaving a task unscheduled should be higher than the cost of
 // scheduling it.
 Cost_t CocoCostModel::TaskToUnscheduledAggCost(TaskID_t task_id) {
+  return ComputeUnscheduledAggCost(task_id,
+                                   time_manager_->GetCurrentTimestamp());
+}
+
+Cost_t CocoCostModel::ComputeUnscheduledAggCost(TaskID_t task_id,
+                                                uint64_t cur_timestamp) {
   const TaskDescriptor& td = GetTask(task_id);
   // Baseline value (based on resource request)
   CostVector_t cost_vector;
@@ -525,8 +567,7 @@ Cost_t CocoCostModel::TaskToUnscheduledAggCost(TaskID_t task_id) {
   cost_vector.interference_score_ = 1;
   cost_vector.locality_score_ = 0;
   int64_t base_cost = FlattenCostVector(cost_vector);
-  uint64_t time_since_submit =
-    time_manager_->GetCurrentTimestamp() - td.submit_time();
+  uint64_t time_since_submit = cur_timestamp - td.submit_time();
   // timestamps are in microseconds, but we scale to tenths of a second here in
   // order to keep the costs small
   int64_t wait_time_cost = WAIT_TIME_MULTIPLIER * (time_since_submit / 100000);
@@ -568,12 +609,34 @@ Cost_t CocoCostModel::TaskToResourceNodeCost(TaskID_t task_id,
 Cost_t CocoCostModel::ResourceNodeToResourceNodeCost(
     const ResourceDescriptor& source,
     const ResourceDescriptor& destination) {
+  uint32_t source_handle =
+    flow_graph_manager_->ResourceHandle(ResourceIDFromString(source.uuid()));
+  uint32_t destination_handle = flow_graph_manager_->ResourceHandle(
+      ResourceIDFromString(destination.uuid()));
+  CHECK_NE(source_handle, kInvalidIDHandle);
+  CHECK_NE(destination_handle, kInvalidIDHandle);
+  FlowGraphNode* source_node =
+    flow_graph_manager_->NodeForResourceHandle(source_handle);
+  FlowGraphNode* destination_node =
+    flow_graph_manager_->NodeForResourceHandle(destination_handle);
+  return ResourceNodeToResourceNodeCostForNodes(*source_node,
+                                                *destination_node);
+}
+
+Cost_t CocoCostModel::ResourceNodeToResourceNodeCostForNodes(
+    const FlowGraphNode& source_node,
+    const FlowGraphNode& destination_node) {
+  CHECK_NOTNULL(source_node.rd_ptr_);
+  CHECK_NOTNULL(destination_node.rd_ptr_);
+  const ResourceDescriptor& source = *source_node.rd_ptr_;
+  const ResourceDescriptor& destination = *destination_node.rd_ptr_;
   // Get the RD for the machine corresponding to this resource
-  ResourceID_t destination_res_id = ResourceIDFromString(destination.uuid());
-  ResourceStatus* machine_rs =
-    FindPtrOrNull(*resource_map_, MachineResIDForResource(destination_res_id));
-  CHECK_NOTNULL(machine_rs);
-  const ResourceDescriptor& machine_rd = machine_rs->descriptor();
+  CHECK_NE(destination_node.resource_handle_, kInvalidIDHandle);
+  FlowGraphNode* machine_node = flow_graph_manager_->NodeForResourceHandle(
+      flow_graph_manager_->MachineHandleForResource(
+          destination_node.resource_handle_));
+  CHECK_NOTNULL(machine_node->rd_ptr_);
+  const ResourceDescriptor& machine_rd = *machine_node->rd_ptr_;
   // Compute resource request dimensions (normalized by machine capacity)
   CostVector_t cost_vector;
   bzero(&cost_vector, sizeof(CostVector_t));
@@ -605,7 +668,7 @@ Cost_t CocoCostModel::ResourceNodeToResourceNodeCost(
   // XXX(malte): unimplemented
   cost_vector.machine_type_score_ = 0;
   cost_vector.interference_score_ =
-    ComputeInterferenceScore(destination_res_id);
+    ComputeInterferenceScore(destination_node.resource_id_);
   // XXX(malte): unimplemented
   cost_vector.locality_score_ = 0;
   Cost_t flat_cost = FlattenCostVector(cost_vector);
@@ -720,19 +783,65 @@ pair<Cost_t, uint64_t> CocoCostModel::EquivClassToEquivClass(
   return pair<Cost_t, uint64_t>(0LL, 0ULL);
 }
 
-ResourceID_t CocoCostModel::MachineResIDForResource(ResourceID_t res_id) {
-  ResourceStatus* rs = FindPtrOrNull(*resource_map_, res_id);
-  CHECK_NOTNULL(rs);
-  ResourceTopologyNodeDescriptor* rtnd = rs->mutable_topology_node();
-  while (rtnd->resource_desc().type() != ResourceDescriptor::RESOURCE_MACHINE) {
-    if (rtnd->parent_id().empty()) {
-      LOG(FATAL) << "Non-machine resource " << rtnd->resource_desc().uuid()
-                 << " has no parent!";
+void CocoCostModel::TaskToUnscheduledAggCosts(
+    const vector<TaskID_t>& task_ids,
+    vector<Cost_t>* costs) {
+  CHECK_NOTNULL(costs);
+  costs->resize(task_ids.size());
+  ParallelForRanges(
+      task_ids.size(),
+      boost::bind(&CocoCostModel::ComputeTaskToUnscheduledAggCosts, this,
+                  boost::cref(task_ids), time_manager_->GetCurrentTimestamp(),
+                  costs, _1, _2));
+}
+
+void CocoCostModel::ComputeTaskToUnscheduledAggCosts(
+    const vector<TaskID_t>& task_ids,
+    uint64_t cur_timestamp,
+    vector<Cost_t>* costs,
+    uint64_t begin, uint64_t end) {
+  for (uint64_t index = begin; index < end; ++index) {
+    (*costs)[index] = ComputeUnscheduledAggCost(task_ids[index],
+                                                cur_timestamp);
+  }
+}
+
+void CocoCostModel::TaskToEquivClassAggregatorCosts(
+    const vector<pair<TaskID_t, EquivClass_t>>& task_ecs,
+    vector<Cost_t>* costs) {
+  CHECK_NOTNULL(costs);
+  costs->resize(task_ecs.size());
+  // The cost only depends on the task's resource request. We therefore
+  // compute it once for each run of arcs that start at the same task.
+  for (uint64_t index = 0; index < task_ecs.size(); ++index) {
+    if (index > 0 && task_ecs[index].first == task_ecs[index - 1].first) {
+      (*costs)[index] = (*costs)[index - 1];
+    } else {
+      (*costs)[index] = TaskToEquivClassAggregator(task_ecs[index].first,
+                                                   task_ecs[index].second);
     }
-    rs = FindPtrOrNull(*resource_map_, ResourceIDFromString(rtnd->parent_id()));
-    rtnd = rs->mutable_topology_node();
   }
-  return ResourceIDFromString(rtnd->resource_desc().uuid());
+}
+
+void CocoCostModel::EquivClassToResourceNodeCosts(
+    const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+    vector<pair<Cost_t, uint64_t>>* costs_and_caps) {
+  CHECK_NOTNULL(costs_and_caps);
+  costs_and_caps->resize(ec_res.size());
+  ParallelForRanges(
+      ec_res.size(),
+      boost::bind(&CocoCostModel::ComputeEquivClassToResourceNodeCosts, this,
+                  boost::cref(ec_res), costs_and_caps, _1, _2));
+}
+
+void CocoCostModel::ComputeEquivClassToResourceNodeCosts(
+    const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+    vector<pair<Cost_t, uint64_t>>* costs_and_caps,
+    uint64_t begin, uint64_t end) {
+  for (uint64_t index = begin; index < end; ++index) {
+    (*costs_and_caps)[index] =
+      EquivClassToResourceNode(ec_res[index].first, ec_res[index].second);
+  }
 }
 
 Cost_t CocoCostModel::NormalizeCost(double raw_cost, double max_cost) {
@@ -854,10 +963,11 @@ FlowGraphNode* CocoCostModel::GatherStats(FlowGraphNode* accumulator,
   // We're inside the resource topology
   ResourceDescriptor* rd_ptr = accumulator->rd_ptr_;
   CHECK_NOTNULL(rd_ptr);
-  // Use the KB to find load information and compute available resources
-  ResourceID_t machine_res_id =
-    MachineResIDForResource(accumulator->resource_id_);
   if (accumulator->type_ == FlowNodeType::PU) {
+    // Use the KB to find load information and compute available resources
+    ResourceID_t machine_res_id = flow_graph_manager_->ResourceIDForHandle(
+        flow_graph_manager_->MachineHandleForResource(
+            accumulator->resource_handle_));
     // Base case: (PU -> SINK). We are at a PU and we gather the statistics.
     CHECK(other->resource_id_.is_nil());
     // Get the RD for the machine
@@ -960,7 +1070,7 @@ FlowGraphNode* CocoCostModel::GatherStats(FlowGraphNode* accumulator,
     }
   }
   if (accumulator->rd_ptr_ && other->rd_ptr_) {
-    AccumulateResourceStats(accumulator->rd_ptr_, other->rd_ptr_);
+    AccumulateResourceStats(accumulator->rd_ptr_, other->rd_ptr_, other);
   }
   return accumulator;
 }
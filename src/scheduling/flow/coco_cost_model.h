@@ -74,6 +74,9 @@ class CocoCostModel : public CostModelInterface {
   // Costs within the resource topology
   Cost_t ResourceNodeToResourceNodeCost(const ResourceDescriptor& source,
                                         const ResourceDescriptor& destination);
+  Cost_t ResourceNodeToResourceNodeCostForNodes(
+      const FlowGraphNode& source,
+      const FlowGraphNode& destination);
   Cost_t LeafResourceNodeToSinkCost(ResourceID_t resource_id);
   // Costs pertaining to preemption (i.e. already running tasks)
   Cost_t TaskContinuationCost(TaskID_t task_id);
@@ -85,11 +88,28 @@ class CocoCostModel : public CostModelInterface {
       ResourceID_t res_id);
   pair<Cost_t, uint64_t> EquivClassToEquivClass(EquivClass_t tec1,
                                                 EquivClass_t tec2);
+  // Batch cost methods
+  void TaskToUnscheduledAggCosts(const vector<TaskID_t>& task_ids,
+                                 vector<Cost_t>* costs);
+  void TaskToEquivClassAggregatorCosts(
+      const vector<pair<TaskID_t, EquivClass_t>>& task_ecs,
+      vector<Cost_t>* costs);
+  void EquivClassToResourceNodeCosts(
+      const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+      vector<pair<Cost_t, uint64_t>>* costs_and_caps);
   // Get the type of equiv class.
   vector<EquivClass_t>* GetTaskEquivClasses(TaskID_t task_id);
   vector<ResourceID_t>* GetOutgoingEquivClassPrefArcs(EquivClass_t tec);
   vector<ResourceID_t>* GetTaskPreferenceArcs(TaskID_t task_id);
   vector<EquivClass_t>* GetEquivClassToEquivClassesArcs(EquivClass_t tec);
+  void FillTaskEquivClasses(TaskID_t task_id,
+                            vector<EquivClass_t>* equiv_classes);
+  void FillOutgoingEquivClassPrefArcs(EquivClass_t tec,
+                                      vector<ResourceID_t>* pref_res);
+  void FillTaskPreferenceArcs(TaskID_t task_id,
+                              vector<ResourceID_t>* pref_res);
+  void FillEquivClassToEquivClassesArcs(EquivClass_t tec,
+                                        vector<EquivClass_t>* pref_ecs);
   void AddMachine(ResourceTopologyNodeDescriptor* rtnd_ptr);
   void AddTask(TaskID_t task_id);
   void PrintCostVector(CostVector_t cv);
@@ -127,11 +147,23 @@ class CocoCostModel : public CostModelInterface {
 
   // Load statistics accumulator helper
   void AccumulateResourceStats(ResourceDescriptor* accumulator,
-                               ResourceDescriptor* other);
+                               ResourceDescriptor* other,
+                               const FlowGraphNode* other_node);
   // Check if rv1 fits into rv2 fully, partially or not at all.
   ResourceVectorFitIndication_t CompareResourceVectors(
     const ResourceVector& rv1,
     const ResourceVector& rv2);
+  // Range helpers for the batch cost methods. They only read state, and can
+  // thus be invoked concurrently on disjoint ranges.
+  void ComputeTaskToUnscheduledAggCosts(const vector<TaskID_t>& task_ids,
+                                        uint64_t cur_timestamp,
+                                        vector<Cost_t>* costs,
+                                        uint64_t begin, uint64_t end);
+  void ComputeEquivClassToResourceNodeCosts(
+      const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+      vector<pair<Cost_t, uint64_t>>* costs_and_caps,
+      uint64_t begin, uint64_t end);
+  Cost_t ComputeUnscheduledAggCost(TaskID_t task_id, uint64_t cur_timestamp);
   // Interference score
   int64_t ComputeInterferenceScore(ResourceID_t res_id);
   // Helper method to get TD for a task ID
@@ -140,8 +172,6 @@ class CocoCostModel : public CostModelInterface {
                                    CoCoInterferenceScores* interference_vector);
   Cost_t FlattenCostVector(CostVector_t cv);
   Cost_t FlattenInterferenceScore(const CoCoInterferenceScores& iv);
-  // Get machine resource for a lower-level resource
-  ResourceID_t MachineResIDForResource(ResourceID_t res_id);
   // Bring cost into the range (0, omega_)
   Cost_t NormalizeCost(double raw_cost, double max_cost);
   // Get a delimited string representing a resource vector
@@ -79,6 +79,18 @@ class CostModelInterface {
   virtual Cost_t ResourceNodeToResourceNodeCost(
       const ResourceDescriptor& source,
       const ResourceDescriptor& destination) = 0;
+  /**
+   * Variant of the method above that the flow graph manager uses. Cost models
+   * can override it to use the resource IDs and handles cached on the nodes
+   * instead of parsing the descriptors' UUIDs. The default implementation
+   * invokes the method above with the nodes' resource descriptors.
+   */
+  virtual Cost_t ResourceNodeToResourceNodeCostForNodes(
+      const FlowGraphNode& source,
+      const FlowGraphNode& destination) {
+    return ResourceNodeToResourceNodeCost(*source.rd_ptr_,
+                                          *destination.rd_ptr_);
+  }
   /**
    * Get the cost of an arc from a resource to the sink.
    **/
@@ -107,6 +119,60 @@ class CostModelInterface {
    */
   virtual pair<Cost_t, uint64_t> EquivClassToEquivClass(EquivClass_t tec1,
                                                         EquivClass_t tec2) = 0;
+
+  /**
+   * Batch variants of the cost methods above. The flow graph manager uses them
+   * to query the costs of many arcs at once. Cost models can override them in
+   * order to share lookups across the batch or to compute the costs in
+   * parallel. The default implementations invoke the per-arc methods.
+   * @param task_ids/task_ecs/... the arcs for which to compute the costs
+   * @param costs resized to the number of arcs; the i-th entry is set to the
+   * cost (and capacity) of the i-th arc
+   */
+  virtual void TaskToUnscheduledAggCosts(const vector<TaskID_t>& task_ids,
+                                         vector<Cost_t>* costs) {
+    costs->resize(task_ids.size());
+    for (uint64_t index = 0; index < task_ids.size(); ++index) {
+      (*costs)[index] = TaskToUnscheduledAggCost(task_ids[index]);
+    }
+  }
+  virtual void TaskToResourceNodeCosts(
+      const vector<pair<TaskID_t, ResourceID_t>>& task_res,
+      vector<Cost_t>* costs) {
+    costs->resize(task_res.size());
+    for (uint64_t index = 0; index < task_res.size(); ++index) {
+      (*costs)[index] =
+        TaskToResourceNodeCost(task_res[index].first, task_res[index].second);
+    }
+  }
+  virtual void TaskToEquivClassAggregatorCosts(
+      const vector<pair<TaskID_t, EquivClass_t>>& task_ecs,
+      vector<Cost_t>* costs) {
+    costs->resize(task_ecs.size());
+    for (uint64_t index = 0; index < task_ecs.size(); ++index) {
+      (*costs)[index] = TaskToEquivClassAggregator(task_ecs[index].first,
+                                                   task_ecs[index].second);
+    }
+  }
+  virtual void EquivClassToResourceNodeCosts(
+      const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+      vector<pair<Cost_t, uint64_t>>* costs_and_caps) {
+    costs_and_caps->resize(ec_res.size());
+    for (uint64_t index = 0; index < ec_res.size(); ++index) {
+      (*costs_and_caps)[index] =
+        EquivClassToResourceNode(ec_res[index].first, ec_res[index].second);
+    }
+  }
+  virtual void EquivClassToEquivClassCosts(
+      const vector<pair<EquivClass_t, EquivClass_t>>& ec_ecs,
+      vector<pair<Cost_t, uint64_t>>* costs_and_caps) {
+    costs_and_caps->resize(ec_ecs.size());
+    for (uint64_t index = 0; index < ec_ecs.size(); ++index) {
+      (*costs_and_caps)[index] =
+        EquivClassToEquivClass(ec_ecs[index].first, ec_ecs[index].second);
+    }
+  }
+
   /**
    * Get the equivalence classes of a task.
    * @param task_id the task id for which to get the equivalence classes
@@ -135,6 +201,33 @@ class CostModelInterface {
   virtual vector<EquivClass_t>* GetEquivClassToEquivClassesArcs(
       EquivClass_t tec) = 0;
 
+  /**
+   * Allocation-free variants of the four methods above. The caller passes an
+   * output vector, which it can reuse across calls; the methods clear it and
+   * add the equivalence classes (or resource ids) to it. The flow scheduler
+   * and graph manager only use these variants. The default implementations
+   * adapt the methods that return a new vector, so that cost models which
+   * only implement those keep working. A NULL vector counts as empty.
+   */
+  virtual void FillTaskEquivClasses(TaskID_t task_id,
+                                    vector<EquivClass_t>* equiv_classes) {
+    AdaptPreferences(GetTaskEquivClasses(task_id), equiv_classes);
+  }
+  virtual void FillOutgoingEquivClassPrefArcs(
+      EquivClass_t tec,
+      vector<ResourceID_t>* pref_res) {
+    AdaptPreferences(GetOutgoingEquivClassPrefArcs(tec), pref_res);
+  }
+  virtual void FillTaskPreferenceArcs(TaskID_t task_id,
+                                      vector<ResourceID_t>* pref_res) {
+    AdaptPreferences(GetTaskPreferenceArcs(task_id), pref_res);
+  }
+  virtual void FillEquivClassToEquivClassesArcs(
+      EquivClass_t tec,
+      vector<EquivClass_t>* pref_ecs) {
+    AdaptPreferences(GetEquivClassToEquivClassesArcs(tec), pref_ecs);
+  }
+
   /**
    * Called by the flow_graph when a machine is added.
    */
@@ -171,6 +264,27 @@ class CostModelInterface {
   virtual FlowGraphNode* UpdateStats(FlowGraphNode* accumulator,
                                      FlowGraphNode* other) = 0;
 
+  /**
+   * Returns true if PrepareStats, GatherStats and UpdateStats can be invoked
+   * concurrently for nodes that belong to different machines' resource
+   * subtrees. Cost models that only touch the descriptors of the nodes they
+   * are passed can override this to get their statistics computed in
+   * parallel.
+   */
+  virtual bool StatsAreThreadSafe() const {
+    return false;
+  }
+
+  /**
+   * Returns true if the statistics the cost model gathers depend on the
+   * machine samples stored in the knowledge base. If so, the statistics of
+   * a machine's subtree are recomputed whenever a new sample arrives for
+   * the machine.
+   */
+  virtual bool StatsDependOnMachineSamples() const {
+    return true;
+  }
+
   /**
    * Handle to pull debug information from cost model; return string.
    */
@@ -189,6 +303,19 @@ class CostModelInterface {
   }
 
  protected:
+  /**
+   * Moves the contents of a vector returned by one of the Get*Arcs or
+   * GetTaskEquivClasses methods into an output vector, and frees it.
+   */
+  template<typename T>
+  static void AdaptPreferences(vector<T>* prefs, vector<T>* output) {
+    output->clear();
+    if (prefs) {
+      output->insert(output->end(), prefs->begin(), prefs->end());
+      delete prefs;
+    }
+  }
+
   shared_ptr<FlowGraphManager> flow_graph_manager_;
 };
 
@@ -18,6 +18,7 @@
  * permissions and limitations under the License.
  */
 
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -58,21 +59,39 @@ const string DIMACSAddNode::GenerateChange() const {
   return ss.str();
 }
 
+void DIMACSAddNode::GenerateWireRecords(
+    vector<SolverWireRecord>* records) const {
+  SolverWireRecord record;
+  memset(&record, 0, sizeof(SolverWireRecord));
+  record.kind_ = SOLVER_WIRE_NODE;
+  record.type_ = GetNodeType();
+  record.src_ = id_;
+  record.cost_ = excess_;
+  records->push_back(record);
+  for (const DIMACSNewArc &new_arc : arc_additions_) {
+    new_arc.GenerateWireRecords(records);
+  }
+}
+
 uint32_t DIMACSAddNode::GetNodeType() const {
-  if (type_ == FlowNodeType::PU) {
+  return GetNodeType(type_);
+}
+
+uint32_t DIMACSAddNode::GetNodeType(FlowNodeType type) {
+  if (type == FlowNodeType::PU) {
     return DIMACS_NODE_PU;
-  } else if (type_ == FlowNodeType::MACHINE) {
+  } else if (type == FlowNodeType::MACHINE) {
     return DIMACS_NODE_MACHINE;
-  } else if (type_ == FlowNodeType::NUMA_NODE ||
-             type_ == FlowNodeType::SOCKET ||
-             type_ == FlowNodeType::CACHE ||
-             type_ == FlowNodeType::CORE) {
+  } else if (type == FlowNodeType::NUMA_NODE ||
+             type == FlowNodeType::SOCKET ||
+             type == FlowNodeType::CACHE ||
+             type == FlowNodeType::CORE) {
     return DIMACS_NODE_INTERMEDIATE_RES;
-  } else if (type_ == FlowNodeType::SINK) {
+  } else if (type == FlowNodeType::SINK) {
     return DIMACS_NODE_SINK;
-  } else if (type_ == FlowNodeType::UNSCHEDULED_TASK ||
-             type_ == FlowNodeType::SCHEDULED_TASK ||
-             type_ == FlowNodeType::ROOT_TASK) {
+  } else if (type == FlowNodeType::UNSCHEDULED_TASK ||
+             type == FlowNodeType::SCHEDULED_TASK ||
+             type == FlowNodeType::ROOT_TASK) {
     return DIMACS_NODE_TASK;
   } else {
     return DIMACS_NODE_OTHER;
@@ -38,7 +38,9 @@ class DIMACSAddNode : public DIMACSChange {
   DIMACSAddNode(const FlowGraphNode& node, const vector<FlowGraphArc*>& arcs);
   ~DIMACSAddNode() {}
   const string GenerateChange() const;
+  void GenerateWireRecords(vector<SolverWireRecord>* records) const;
   uint32_t GetNodeType() const;
+  static uint32_t GetNodeType(FlowNodeType type);
   const uint64_t id_;
   const int64_t excess_;
   const FlowNodeType type_;
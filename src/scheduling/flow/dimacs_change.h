@@ -22,8 +22,10 @@
 #define FIRMAMENT_SCHEDULING_FLOW_DIMACS_CHANGE_H
 
 #include <string>
+#include <vector>
 
 #include "base/types.h"
+#include "scheduling/flow/solver_wire_format.h"
 
 namespace firmament {
 
@@ -51,6 +53,11 @@ class DIMACSChange {
   }
 
   virtual const std::string GenerateChange() const = 0;
+  /**
+   * Appends the binary wire format records that describe the change.
+   */
+  virtual void GenerateWireRecords(
+      vector<SolverWireRecord>* records) const = 0;
 
  protected:
   string comment_;
@@ -22,6 +22,7 @@
 #define FIRMAMENT_SCHEDULING_FLOW_DIMACS_CHANGE_ARC_H
 
 #include <string>
+#include <vector>
 
 #include "base/types.h"
 #include "scheduling/flow/dimacs_change.h"
@@ -34,6 +35,7 @@ class DIMACSChangeArc : public DIMACSChange {
  public:
   explicit DIMACSChangeArc(const FlowGraphArc& arc, int64_t old_cost);
   const string GenerateChange() const;
+  void GenerateWireRecords(vector<SolverWireRecord>* records) const;
 
   uint64_t src_;
   uint64_t dst_;
@@ -34,21 +34,18 @@ namespace firmament {
 DIMACSExporter::DIMACSExporter() {
 }
 
+// N.B.: we only flush the stream once the entire graph has been written;
+// flushing after every line results in one system call per node and arc.
 void DIMACSExporter::Export(const FlowGraph& graph, FILE* stream) {
   fprintf(stream, "c ===========================\n");
-  fflush(stream);
   fprintf(stream, "p min %" PRIu64 " %" PRIu64 "\n",
           graph.NumNodes(), graph.NumArcs());
-  fflush(stream);
   fprintf(stream, "c ===========================\n");
-  fflush(stream);
   fprintf(stream, "c === ALL NODES FOLLOW ===\n");
-  fflush(stream);
-  for (auto& id_node : graph.Nodes()) {
-    GenerateNode(*id_node.second, stream);
+  for (auto& node : graph.Nodes()) {
+    GenerateNode(*node, stream);
   }
   fprintf(stream, "c === ALL ARCS FOLLOW ===\n");
-  fflush(stream);
   for (const auto& arc : graph.Arcs()) {
     GenerateArc(*arc, stream);
   }
@@ -60,8 +57,7 @@ void DIMACSExporter::Export(const FlowGraph& graph, FILE* stream) {
 void DIMACSExporter::ExportIncremental(const vector<DIMACSChange*>& changes,
                                        FILE* stream) {
   for (const auto& change : changes) {
-    fprintf(stream, "%s", change->GenerateChange().c_str());
-    fflush(stream);
+    fputs(change->GenerateChange().c_str(), stream);
   }
   // Add end of iteration comment.
   fprintf(stream, "c EOI\n");
@@ -73,7 +69,6 @@ inline void DIMACSExporter::GenerateArc(const FlowGraphArc& arc, FILE* stream) {
           "a %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRId64 "\n",
           arc.src_, arc.dst_, arc.cap_lower_bound_, arc.cap_upper_bound_,
           arc.cost_);
-  fflush(stream);
 }
 
 inline void DIMACSExporter::GenerateNode(const FlowGraphNode& node,
@@ -84,8 +79,8 @@ inline void DIMACSExporter::GenerateNode(const FlowGraphNode& node,
     fprintf(stream, "c nd Task_%" PRIu64 "\n", node.td_ptr_->uid());
   } else if (node.ec_id_) {
     fprintf(stream, "c nd EC_%" PRIu64 "\n", node.ec_id_);
-  } else if (node.comment_ != "") {
-    fprintf(stream, "c nd %s\n", node.comment_.c_str());
+  } else if (node.comment_) {
+    fprintf(stream, "c nd %s\n", node.comment_->c_str());
   }
   uint32_t node_type = 0;
   if (node.type_ == FlowNodeType::PU) {
@@ -108,7 +103,6 @@ inline void DIMACSExporter::GenerateNode(const FlowGraphNode& node,
   }
   fprintf(stream, "n %" PRIu64 " %" PRId64 " %d\n",
           node.id_, node.excess_, node_type);
-  fflush(stream);
 }
 
 }  // namespace firmament
@@ -18,6 +18,7 @@
  * permissions and limitations under the License.
  */
 
+#include <cstring>
 #include <string>
 
 #include "scheduling/flow/dimacs_new_arc.h"
@@ -39,4 +40,18 @@ const string DIMACSNewArc::GenerateChange() const {
   return ss.str();
 }
 
+void DIMACSNewArc::GenerateWireRecords(
+    vector<SolverWireRecord>* records) const {
+  SolverWireRecord record;
+  memset(&record, 0, sizeof(SolverWireRecord));
+  record.kind_ = SOLVER_WIRE_ARC;
+  record.type_ = type_;
+  record.src_ = src_;
+  record.dst_ = dst_;
+  record.cap_lower_bound_ = cap_lower_bound_;
+  record.cap_upper_bound_ = cap_upper_bound_;
+  record.cost_ = cost_;
+  records->push_back(record);
+}
+
 } // namespace firmament
@@ -22,6 +22,7 @@
 #define FIRMAMENT_SCHEDULING_FLOW_DIMACS_NEW_ARC_H
 
 #include <string>
+#include <vector>
 
 #include "base/types.h"
 #include "scheduling/flow/dimacs_change.h"
@@ -33,6 +34,7 @@ class DIMACSNewArc : public DIMACSChange {
  public:
   explicit DIMACSNewArc(const FlowGraphArc& arc);
   const string GenerateChange() const;
+  void GenerateWireRecords(vector<SolverWireRecord>* records) const;
 
   uint64_t src_;
   uint64_t dst_;
@@ -18,6 +18,9 @@
  * permissions and limitations under the License.
  */
 
+#include <cstring>
+#include <vector>
+
 #include "scheduling/flow/dimacs_remove_node.h"
 
 namespace firmament {
@@ -33,4 +36,13 @@ const string DIMACSRemoveNode::GenerateChange() const {
   return ss.str();
 }
 
+void DIMACSRemoveNode::GenerateWireRecords(
+    vector<SolverWireRecord>* records) const {
+  SolverWireRecord record;
+  memset(&record, 0, sizeof(SolverWireRecord));
+  record.kind_ = SOLVER_WIRE_REMOVE_NODE;
+  record.src_ = node_id_;
+  records->push_back(record);
+}
+
 } // namespace firmament
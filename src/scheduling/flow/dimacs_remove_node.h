@@ -22,6 +22,7 @@
 #define FIRMAMENT_SCHEDULING_FLOW_DIMACS_REMOVE_NODE_H
 
 #include <string>
+#include <vector>
 
 #include "base/types.h"
 #include "misc/map-util.h"
@@ -35,6 +36,7 @@ class DIMACSRemoveNode : public DIMACSChange {
  public:
   explicit DIMACSRemoveNode(const FlowGraphNode& node);
   const string GenerateChange() const;
+  void GenerateWireRecords(vector<SolverWireRecord>* records) const;
 
   const uint64_t node_id_;
 };
@@ -25,47 +25,61 @@ DEFINE_bool(randomize_flow_graph_node_ids, false,
 
 namespace firmament {
 
-FlowGraph::FlowGraph() : current_id_(1) {
+// Number of nodes and arcs per slab.
+static const size_t kObjectsPerChunk = 16384;
+
+FlowGraph::FlowGraph()
+  : arc_pool_(kObjectsPerChunk), node_pool_(kObjectsPerChunk),
+    current_id_(1),
+    sparse_node_ids_(FLAGS_flow_scheduling_solver == "flowlessly"),
+    randomize_node_ids_(FLAGS_randomize_flow_graph_node_ids) {
   // We do not randomize the special nodes because the solvers make
   // assumptions about the the id number of the sink node.
-  if (FLAGS_randomize_flow_graph_node_ids) {
+  if (randomize_node_ids_) {
     PopulateUnusedIds(50);
   }
 }
 
 FlowGraph::~FlowGraph() {
-  for (unordered_map<uint64_t, FlowGraphNode*>::iterator it = node_map_.begin();
-       it != node_map_.end(); ) {
-    unordered_map<uint64_t, FlowGraphNode*>::iterator it_tmp = it;
-    ++it;
-    DeleteNode(it_tmp->second);
+  // The whole graph goes away, so there's no need to unlink the arcs from
+  // the nodes one by one.
+  for (auto& arc : arcs_) {
+    arc_pool_.Delete(arc);
+  }
+  for (auto& node : nodes_) {
+    node_pool_.Delete(node);
   }
 }
 
 FlowGraphArc* FlowGraph::AddArc(FlowGraphNode* src,
                                 FlowGraphNode* dst) {
-  FlowGraphArc* arc = new FlowGraphArc(src->id_, dst->id_, src, dst);
-  CHECK(arc_set_.insert(arc).second);
-  src->AddArc(arc);
+  CHECK(GetArc(src, dst) == NULL);
+  FlowGraphArc* arc = arc_pool_.New(src->id_, dst->id_, src, dst);
+  arc->index_ = arcs_.size();
+  arcs_.push_back(arc);
+  arc->outgoing_index_ = src->outgoing_arcs_.size();
+  src->outgoing_arcs_.push_back(arc);
+  arc->incoming_index_ = dst->incoming_arcs_.size();
+  dst->incoming_arcs_.push_back(arc);
   return arc;
 }
 
 FlowGraphArc* FlowGraph::AddArc(uint64_t src, uint64_t dst) {
-  FlowGraphNode* src_node = FindPtrOrNull(node_map_, src);
-  CHECK_NOTNULL(src_node);
-  FlowGraphNode* dst_node = FindPtrOrNull(node_map_, dst);
-  CHECK_NOTNULL(dst_node);
-  FlowGraphArc* arc = new FlowGraphArc(src, dst, src_node, dst_node);
-  arc_set_.insert(arc);
-  src_node->AddArc(arc);
-  return arc;
+  FlowGraphNode* src_node = const_cast<FlowGraphNode*>(&Node(src));
+  FlowGraphNode* dst_node = const_cast<FlowGraphNode*>(&Node(dst));
+  return AddArc(src_node, dst_node);
 }
 
 FlowGraphNode* FlowGraph::AddNode() {
   uint64_t id = NextId();
-  FlowGraphNode* node = new FlowGraphNode(id);
-  CHECK_NOTNULL(node);
-  CHECK(InsertIfNotPresent(&node_map_, id, node));
+  if (id >= node_index_.size()) {
+    node_index_.resize(max(id + 1, 2 * node_index_.size()), NULL);
+  }
+  CHECK(node_index_[id] == NULL);
+  FlowGraphNode* node = node_pool_.New(id);
+  node->index_ = nodes_.size();
+  nodes_.push_back(node);
+  node_index_[id] = node;
   return node;
 }
 
@@ -81,60 +95,71 @@ void FlowGraph::ChangeArcCost(FlowGraphArc* arc, int64_t cost) {
 }
 
 void FlowGraph::DeleteArc(FlowGraphArc* arc) {
-  // Remove the arc from the incoming and outgoing collections.
-  arc->src_node_->outgoing_arc_map_.erase(arc->dst_node_->id_);
-  arc->dst_node_->incoming_arc_map_.erase(arc->src_node_->id_);
-  // First remove various meta-data relating to this arc
-  arc_set_.erase(arc);
+  // Remove the arc from the outgoing and incoming vectors, and from the
+  // graph's arc vector, by moving the last element into its slot.
+  vector<FlowGraphArc*>* outgoing_arcs = &arc->src_node_->outgoing_arcs_;
+  FlowGraphArc* moved_arc = outgoing_arcs->back();
+  (*outgoing_arcs)[arc->outgoing_index_] = moved_arc;
+  moved_arc->outgoing_index_ = arc->outgoing_index_;
+  outgoing_arcs->pop_back();
+  vector<FlowGraphArc*>* incoming_arcs = &arc->dst_node_->incoming_arcs_;
+  moved_arc = incoming_arcs->back();
+  (*incoming_arcs)[arc->incoming_index_] = moved_arc;
+  moved_arc->incoming_index_ = arc->incoming_index_;
+  incoming_arcs->pop_back();
+  moved_arc = arcs_.back();
+  arcs_[arc->index_] = moved_arc;
+  moved_arc->index_ = arc->index_;
+  arcs_.pop_back();
   // Then delete the arc itself
-  delete arc;
+  arc_pool_.Delete(arc);
 }
 
 void FlowGraph::DeleteNode(FlowGraphNode* node) {
   unused_ids_.push(node->id_);
-  // First remove all outgoing arcs
-  for (unordered_map<uint64_t, FlowGraphArc*>::iterator it =
-         node->outgoing_arc_map_.begin();
-       it != node->outgoing_arc_map_.end();) {
-    CHECK_EQ(it->first, it->second->dst_);
-    CHECK_EQ(node->id_, it->second->src_);
-    CHECK_EQ(it->second->dst_node_->incoming_arc_map_.erase(it->second->src_),
-             1);
-    unordered_map<uint64_t, FlowGraphArc*>::iterator it_tmp = it;
-    ++it;
-    DeleteArc(it_tmp->second);
+  // First remove all outgoing arcs. We remove them from the back so that
+  // DeleteArc does not have to move any other arcs.
+  while (!node->outgoing_arcs_.empty()) {
+    CHECK_EQ(node->id_, node->outgoing_arcs_.back()->src_);
+    DeleteArc(node->outgoing_arcs_.back());
   }
-  node->outgoing_arc_map_.clear();
   // Remove all incoming arcs.
-  for (unordered_map<uint64_t, FlowGraphArc*>::iterator it =
-         node->incoming_arc_map_.begin();
-       it != node->incoming_arc_map_.end();) {
-    CHECK_EQ(node->id_, it->second->dst_);
-    CHECK_EQ(it->first, it->second->src_);
-    CHECK_EQ(it->second->src_node_->outgoing_arc_map_.erase(it->second->dst_),
-             1);
-    unordered_map<uint64_t, FlowGraphArc*>::iterator it_tmp = it;
-    ++it;
-    DeleteArc(it_tmp->second);
+  while (!node->incoming_arcs_.empty()) {
+    CHECK_EQ(node->id_, node->incoming_arcs_.back()->dst_);
+    DeleteArc(node->incoming_arcs_.back());
   }
-  node->incoming_arc_map_.clear();
-  node_map_.erase(node->id_);
-  delete node;
+  ReleaseNodeComment(node);
+  FlowGraphNode* moved_node = nodes_.back();
+  nodes_[node->index_] = moved_node;
+  moved_node->index_ = node->index_;
+  nodes_.pop_back();
+  node_index_[node->id_] = NULL;
+  node_pool_.Delete(node);
 }
 
 FlowGraphArc* FlowGraph::GetArc(FlowGraphNode* src, FlowGraphNode* dst) {
   CHECK_NOTNULL(src);
   CHECK_NOTNULL(dst);
-  unordered_map<uint64_t, FlowGraphArc*>::iterator arc_it =
-    src->outgoing_arc_map_.find(dst->id_);
-  if (arc_it == src->outgoing_arc_map_.end()) {
-    return NULL;
+  // Scan whichever of the two arc vectors is shorter. Nodes with many arcs
+  // (e.g., the sink or aggregators) usually connect to nodes with few arcs.
+  if (src->outgoing_arcs_.size() <= dst->incoming_arcs_.size()) {
+    for (auto& arc : src->outgoing_arcs_) {
+      if (arc->dst_node_ == dst) {
+        return arc;
+      }
+    }
+  } else {
+    for (auto& arc : dst->incoming_arcs_) {
+      if (arc->src_node_ == src) {
+        return arc;
+      }
+    }
   }
-  return arc_it->second;
+  return NULL;
 }
 
 uint64_t FlowGraph::NextId() {
-  if (FLAGS_randomize_flow_graph_node_ids) {
+  if (randomize_node_ids_) {
     if (unused_ids_.empty()) {
       PopulateUnusedIds(current_id_ * 2);
     }
@@ -165,4 +190,30 @@ void FlowGraph::PopulateUnusedIds(uint64_t new_current_id) {
   current_id_ = new_current_id;
 }
 
+void FlowGraph::ReleaseNodeComment(FlowGraphNode* node) {
+  if (node->comment_ == NULL) {
+    return;
+  }
+  unordered_map<string, uint64_t>::iterator it =
+    comments_.find(*node->comment_);
+  CHECK(it != comments_.end());
+  if (--it->second == 0) {
+    comments_.erase(it);
+  }
+  node->comment_ = NULL;
+}
+
+void FlowGraph::SetNodeComment(FlowGraphNode* node, const string& comment) {
+  ReleaseNodeComment(node);
+  if (comment.empty()) {
+    return;
+  }
+  // Elements of an unordered_map do not move when the map is rehashed, so
+  // the node can keep a pointer to the interned string.
+  unordered_map<string, uint64_t>::iterator it =
+    comments_.insert(pair<const string, uint64_t>(comment, 0)).first;
+  it->second++;
+  node->comment_ = &it->first;
+}
+
 }  // namespace firmament
@@ -22,9 +22,11 @@
 #define FIRMAMENT_SCHEDULING_FLOW_FLOW_GRAPH_H
 
 #include <queue>
+#include <string>
 #include <vector>
 
 #include "misc/map-util.h"
+#include "misc/object_pool.h"
 #include "scheduling/flow/flow_graph_arc.h"
 #include "scheduling/flow/flow_graph_node.h"
 
@@ -45,19 +47,23 @@ class FlowGraph {
   void DeleteArc(FlowGraphArc* arc);
   void DeleteNode(FlowGraphNode* node);
   FlowGraphArc* GetArc(FlowGraphNode* src, FlowGraphNode* dst);
-  inline const unordered_set<FlowGraphArc*>& Arcs() const { return arc_set_; }
-  inline const unordered_map<uint64_t, FlowGraphNode*>& Nodes() const {
-    return node_map_;
-  }
+  /**
+   * Sets the node's debugging comment. Comments are interned because many
+   * nodes share the same comment.
+   */
+  void SetNodeComment(FlowGraphNode* node, const string& comment);
+  inline const vector<FlowGraphArc*>& Arcs() const { return arcs_; }
+  inline const vector<FlowGraphNode*>& Nodes() const { return nodes_; }
   inline const FlowGraphNode& Node(uint64_t id) const {
-    FlowGraphNode* node = FindPtrOrNull(node_map_, id);
+    CHECK_LT(id, node_index_.size());
+    FlowGraphNode* node = node_index_[id];
     CHECK_NOTNULL(node);
     return *node;
   }
-  inline uint64_t NumArcs() const { return arc_set_.size(); }
+  inline uint64_t NumArcs() const { return arcs_.size(); }
   inline uint64_t NumNodes() const {
-    if (!FLAGS_flow_scheduling_solver.compare("flowlessly")) {
-      return node_map_.size();
+    if (sparse_node_ids_) {
+      return nodes_.size();
     } else {
       // TODO(malte): This is a work-around as cs2 and Relax IV do not allow
       // sparse node IDs, and will get tripped up
@@ -73,13 +79,29 @@ class FlowGraph {
   FRIEND_TEST(FlowGraphManagerTest, RemoveUnscheduledAggNode);
   FRIEND_TEST(FlowGraphManagerTest, TraverseAndRemoveTopology);
 
+  void ReleaseNodeComment(FlowGraphNode* node);
   uint64_t NextId();
   void PopulateUnusedIds(uint64_t new_current_id);
 
-  unordered_set<FlowGraphArc*> arc_set_;
+  // Nodes and arcs are allocated from slabs, and are stored in dense
+  // vectors so that exporting the graph is a linear scan.
+  ObjectPool<FlowGraphArc> arc_pool_;
+  ObjectPool<FlowGraphNode> node_pool_;
+  vector<FlowGraphArc*> arcs_;
+  vector<FlowGraphNode*> nodes_;
   // Graph structure containers and helper fields
   uint64_t current_id_;
-  unordered_map<uint64_t, FlowGraphNode*> node_map_;
+  // True if the solver supports sparse node ids. Set from
+  // FLAGS_flow_scheduling_solver when the graph is created, so that the hot
+  // path does not read the flag.
+  bool sparse_node_ids_;
+  // Copy of FLAGS_randomize_flow_graph_node_ids taken when the graph is
+  // created.
+  bool randomize_node_ids_;
+  // Nodes indexed by node id; NULL for ids that are not in use.
+  vector<FlowGraphNode*> node_index_;
+  // Interned node comments and the number of nodes that use them.
+  unordered_map<string, uint64_t> comments_;
   // Queue storing the ids of the nodes we've previously removed.
   queue<uint64_t> unused_ids_;
 };
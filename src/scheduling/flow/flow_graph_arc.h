@@ -52,6 +52,12 @@ struct FlowGraphArc {
   FlowGraphNode* src_node_;
   FlowGraphNode* dst_node_;
   FlowGraphArcType type_;
+  // Positions of the arc in the FlowGraph's arc vector, in the source node's
+  // outgoing arcs and in the destination node's incoming arcs. They are
+  // maintained by the FlowGraph and allow arcs to be removed in O(1).
+  uint32_t index_;
+  uint32_t outgoing_index_;
+  uint32_t incoming_index_;
 };
 
 } // namespace firmament
@@ -0,0 +1,319 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Microbenchmark for the flow graph data structures. It builds a Quincy-style
+// graph (tasks, per-job unscheduled aggregators, a cluster aggregator and a
+// machine/PU topology), and measures the time it takes to build, update,
+// query and export the graph, as well as the resident memory it uses. Finally,
+// it churns a small fraction of the tasks in several rounds, and compares the
+// runtime of a cold primal-dual solver run to that of a warm-started one.
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <boost/timer/timer.hpp>
+
+#include <string>
+#include <vector>
+
+#include "base/common.h"
+#include "misc/string_utils.h"
+#include "scheduling/flow/binary_exporter.h"
+#include "scheduling/flow/dimacs_change_stats.h"
+#include "scheduling/flow/dimacs_exporter.h"
+#include "scheduling/flow/flow_graph_change_manager.h"
+#include "scheduling/flow/primal_dual_solver.h"
+
+DEFINE_uint64(benchmark_machines, 12000,
+              "Number of machines in the benchmark graph.");
+DEFINE_uint64(benchmark_pus_per_machine, 4,
+              "Number of PUs per machine in the benchmark graph.");
+DEFINE_uint64(benchmark_tasks, 500000,
+              "Number of tasks in the benchmark graph.");
+DEFINE_uint64(benchmark_tasks_per_job, 100,
+              "Number of tasks per job in the benchmark graph.");
+DEFINE_uint64(benchmark_preference_arcs, 2,
+              "Number of task to machine preference arcs per task.");
+DEFINE_double(benchmark_churn, 0.1,
+              "Fraction of the tasks that are removed and re-added in the "
+              "update phase.");
+DEFINE_uint64(benchmark_solver_rounds, 5,
+              "Number of rounds in which the graph is solved by a cold and by "
+              "a warm-started solver.");
+DEFINE_double(benchmark_solver_churn, 0.001,
+              "Fraction of the tasks that are removed and re-added before "
+              "every solver round.");
+
+DECLARE_bool(incremental_flow);
+DECLARE_bool(primal_dual_warm_start);
+
+namespace firmament {
+
+struct BenchmarkTask {
+  FlowGraphNode* node_;
+  vector<FlowGraphArc*> arcs_;
+};
+
+class FlowGraphBenchmark {
+ public:
+  FlowGraphBenchmark()
+    : change_manager_(new FlowGraphChangeManager(&dimacs_stats_)),
+      sink_node_(NULL), cluster_agg_node_(NULL) {
+    srand(42);
+  }
+
+  ~FlowGraphBenchmark() {
+    delete change_manager_;
+  }
+
+  void Run() {
+    uint64_t base_rss = ResidentBytes();
+    boost::timer::cpu_timer timer;
+    BuildTopology();
+    BuildTasks();
+    Report("build", &timer);
+    LOG(INFO) << "Graph has " << change_manager_->flow_graph().NumNodes()
+              << " nodes and " << change_manager_->flow_graph().NumArcs()
+              << " arcs, resident memory: "
+              << (ResidentBytes() - base_rss) / (1024 * 1024) << " MB";
+    timer.start();
+    UpdateCosts();
+    Report("update costs", &timer);
+    timer.start();
+    ChurnTasks(FLAGS_benchmark_churn);
+    Report("churn tasks", &timer);
+    timer.start();
+    LookupArcs();
+    Report("lookup arcs", &timer);
+    FILE* dev_null = fopen("/dev/null", "w");
+    CHECK_NOTNULL(dev_null);
+    timer.start();
+    DIMACSExporter dimacs_exporter;
+    dimacs_exporter.Export(change_manager_->flow_graph(), dev_null);
+    Report("DIMACS export", &timer);
+    timer.start();
+    BinaryExporter binary_exporter;
+    binary_exporter.Export(change_manager_->flow_graph(), fileno(dev_null));
+    Report("binary export", &timer);
+    fclose(dev_null);
+    SolveRounds();
+    timer.start();
+    delete change_manager_;
+    change_manager_ = NULL;
+    Report("teardown", &timer);
+  }
+
+ private:
+  void AddTask(BenchmarkTask* task, FlowGraphNode* unsched_agg_node) {
+    task->node_ = change_manager_->AddNode(FlowNodeType::UNSCHEDULED_TASK, 1,
+                                           ADD_TASK_NODE, "AddTaskNode");
+    task->arcs_.clear();
+    task->arcs_.push_back(
+        change_manager_->AddArc(task->node_, unsched_agg_node, 0, 1, 5000,
+                                FlowGraphArcType::OTHER, ADD_ARC_TO_UNSCHED,
+                                "AddTaskNode"));
+    task->arcs_.push_back(
+        change_manager_->AddArc(task->node_, cluster_agg_node_, 0, 1, 1000,
+                                FlowGraphArcType::OTHER,
+                                ADD_ARC_TASK_TO_EQUIV_CLASS, "AddTaskNode"));
+    for (uint64_t index = 0; index < FLAGS_benchmark_preference_arcs;
+         ++index) {
+      FlowGraphNode* machine_node =
+        machine_nodes_[rand() % machine_nodes_.size()];
+      if (change_manager_->mutable_flow_graph()->GetArc(task->node_,
+                                                        machine_node)) {
+        continue;
+      }
+      task->arcs_.push_back(
+          change_manager_->AddArc(task->node_, machine_node, 0, 1,
+                                  rand() % 1000, FlowGraphArcType::OTHER,
+                                  ADD_ARC_TASK_TO_RES, "AddTaskNode"));
+    }
+  }
+
+  void BuildTasks() {
+    uint64_t num_jobs = (FLAGS_benchmark_tasks +
+                         FLAGS_benchmark_tasks_per_job - 1) /
+      FLAGS_benchmark_tasks_per_job;
+    for (uint64_t job = 0; job < num_jobs; ++job) {
+      string comment = "UNSCHED_AGG_for_" + to_string(job);
+      FlowGraphNode* unsched_agg_node =
+        change_manager_->AddNode(FlowNodeType::JOB_AGGREGATOR, 0,
+                                 ADD_UNSCHED_JOB_NODE, comment.c_str());
+      change_manager_->AddArc(unsched_agg_node, sink_node_, 0,
+                              FLAGS_benchmark_tasks_per_job, 0,
+                              FlowGraphArcType::OTHER, ADD_ARC_FROM_UNSCHED,
+                              "AddUnscheduledAggNode");
+      unsched_agg_nodes_.push_back(unsched_agg_node);
+    }
+    tasks_.resize(FLAGS_benchmark_tasks);
+    for (uint64_t index = 0; index < tasks_.size(); ++index) {
+      AddTask(&tasks_[index],
+              unsched_agg_nodes_[index / FLAGS_benchmark_tasks_per_job]);
+      sink_node_->excess_--;
+    }
+  }
+
+  void BuildTopology() {
+    sink_node_ = change_manager_->AddNode(FlowNodeType::SINK, 0, ADD_SINK_NODE,
+                                          "SINK");
+    cluster_agg_node_ =
+      change_manager_->AddNode(FlowNodeType::EQUIVALENCE_CLASS, 0,
+                               ADD_EQUIV_CLASS_NODE, "CLUSTER_AGG");
+    for (uint64_t machine = 0; machine < FLAGS_benchmark_machines; ++machine) {
+      string comment;
+      spf(&comment, "machine_%jd", machine);
+      FlowGraphNode* machine_node =
+        change_manager_->AddNode(FlowNodeType::MACHINE, 0, ADD_RESOURCE_NODE,
+                                 comment.c_str());
+      change_manager_->AddArc(cluster_agg_node_, machine_node, 0,
+                              FLAGS_benchmark_pus_per_machine, 0,
+                              FlowGraphArcType::OTHER,
+                              ADD_ARC_EQUIV_CLASS_TO_RES, "AddMachine");
+      for (uint64_t pu = 0; pu < FLAGS_benchmark_pus_per_machine; ++pu) {
+        spf(&comment, "machine_%jd_pu_%jd", machine, pu);
+        FlowGraphNode* pu_node =
+          change_manager_->AddNode(FlowNodeType::PU, 0, ADD_RESOURCE_NODE,
+                                   comment.c_str());
+        change_manager_->AddArc(machine_node, pu_node, 0, 1, 0,
+                                FlowGraphArcType::OTHER, ADD_ARC_BETWEEN_RES,
+                                "AddMachine");
+        change_manager_->AddArc(pu_node, sink_node_, 0, 1, 0,
+                                FlowGraphArcType::OTHER, ADD_ARC_RES_TO_SINK,
+                                "AddMachine");
+      }
+      machine_nodes_.push_back(machine_node);
+    }
+  }
+
+  void ChurnTasks(double churn) {
+    uint64_t num_churned = static_cast<uint64_t>(tasks_.size() * churn);
+    for (uint64_t index = 0; index < num_churned; ++index) {
+      uint64_t task_index = rand() % tasks_.size();
+      change_manager_->DeleteNode(tasks_[task_index].node_, DEL_TASK_NODE,
+                                  "ChurnTasks");
+      tasks_[task_index] = tasks_.back();
+      tasks_.pop_back();
+    }
+    for (uint64_t index = 0; index < num_churned; ++index) {
+      BenchmarkTask task;
+      AddTask(&task, unsched_agg_nodes_[rand() % unsched_agg_nodes_.size()]);
+      tasks_.push_back(task);
+    }
+  }
+
+  void LookupArcs() {
+    FlowGraph* flow_graph = change_manager_->mutable_flow_graph();
+    uint64_t num_found = 0;
+    for (auto& task : tasks_) {
+      for (auto& arc : task.arcs_) {
+        if (flow_graph->GetArc(task.node_, arc->dst_node_) == arc) {
+          num_found++;
+        }
+      }
+      if (flow_graph->GetArc(task.node_, sink_node_) != NULL) {
+        num_found++;
+      }
+    }
+    VLOG(1) << "Found " << num_found << " arcs";
+  }
+
+  void Report(const string& phase, boost::timer::cpu_timer* timer) {
+    timer->stop();
+    LOG(INFO) << phase << ": " << timer->elapsed().wall / 1000000 << " ms";
+  }
+
+  void ReportSolve(const string& phase, boost::timer::cpu_timer* timer,
+                   const PrimalDualSolver& solver) {
+    timer->stop();
+    LOG(INFO) << phase << ": " << timer->elapsed().wall / 1000000 << " ms, "
+              << solver.num_iterations() << " iterations";
+  }
+
+  uint64_t ResidentBytes() {
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+      if (fscanf(statm, "%ju %ju", &size, &resident) != 2) {
+        resident = 0;
+      }
+      fclose(statm);
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+  }
+
+  void SolveRounds() {
+    if (FLAGS_benchmark_solver_rounds == 0) {
+      return;
+    }
+    const FlowGraph& flow_graph = change_manager_->flow_graph();
+    vector<unordered_map<uint64_t, uint64_t>> extracted_flow;
+    PrimalDualSolver warm_solver;
+    boost::timer::cpu_timer timer;
+    FLAGS_primal_dual_warm_start = true;
+    warm_solver.Solve(flow_graph, &extracted_flow);
+    ReportSolve("initial solve", &timer, warm_solver);
+    for (uint64_t round = 0; round < FLAGS_benchmark_solver_rounds; ++round) {
+      ChurnTasks(FLAGS_benchmark_solver_churn);
+      // A new solver does not have any flow or potentials to start from.
+      PrimalDualSolver cold_solver;
+      FLAGS_primal_dual_warm_start = false;
+      extracted_flow.clear();
+      timer.start();
+      cold_solver.Solve(flow_graph, &extracted_flow);
+      ReportSolve("cold solve " + to_string(round), &timer, cold_solver);
+      FLAGS_primal_dual_warm_start = true;
+      extracted_flow.clear();
+      timer.start();
+      warm_solver.Solve(flow_graph, &extracted_flow);
+      ReportSolve("warm solve " + to_string(round), &timer, warm_solver);
+    }
+  }
+
+  void UpdateCosts() {
+    for (auto& task : tasks_) {
+      for (auto& arc : task.arcs_) {
+        change_manager_->ChangeArcCost(arc, arc->cost_ + rand() % 100,
+                                       CHG_ARC_TASK_TO_RES, "UpdateCosts");
+      }
+    }
+  }
+
+  DIMACSChangeStats dimacs_stats_;
+  FlowGraphChangeManager* change_manager_;
+  FlowGraphNode* sink_node_;
+  FlowGraphNode* cluster_agg_node_;
+  vector<FlowGraphNode*> machine_nodes_;
+  vector<FlowGraphNode*> unsched_agg_nodes_;
+  vector<BenchmarkTask> tasks_;
+};
+
+}  // namespace firmament
+
+int main(int argc, char *argv[]) {
+  firmament::common::InitFirmament(argc, argv);
+  FLAGS_logtostderr = true;
+  // The benchmark measures the graph itself, not the change log.
+  FLAGS_incremental_flow = false;
+  firmament::FlowGraphBenchmark benchmark;
+  benchmark.Run();
+  return 0;
+}
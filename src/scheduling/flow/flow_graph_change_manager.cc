@@ -99,7 +99,7 @@ FlowGraphNode* FlowGraphChangeManager::AddNode(
   FlowGraphNode* node = flow_graph_->AddNode();
   node->type_ = node_type;
   node->excess_ = excess;
-  node->comment_ = comment;
+  flow_graph_->SetNodeComment(node, comment);
   if (FLAGS_incremental_flow) {
     DIMACSChange* chg = new DIMACSAddNode(*node, vector<FlowGraphArc*>());
     chg->set_comment(comment);
@@ -21,6 +21,8 @@
 #include "scheduling/flow/flow_graph_manager.h"
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <limits>
 #include <queue>
 #include <set>
@@ -30,6 +32,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <boost/bind.hpp>
+#include <boost/thread.hpp>
 
 #include "base/common.h"
 #include "base/types.h"
@@ -48,6 +51,12 @@ DEFINE_bool(update_preferences_running_task, false,
             "True if the preferences of a running task should be updated before"
             " each scheduling round");
 
+DEFINE_uint64(topology_stats_threads, 0,
+              "Number of threads used to compute the resource statistics of "
+              "the machines in parallel. Only used with cost models whose "
+              "statistics methods are thread-safe. If 0, the statistics are "
+              "computed in the scheduler's thread.");
+
 DECLARE_string(flow_scheduling_solver);
 DECLARE_uint64(max_tasks_per_pu);
 
@@ -144,9 +153,21 @@ void FlowGraphManager::AddResourceTopologyDFS(
   CHECK_NOTNULL(rd_ptr);
   ResourceID_t res_id = ResourceIDFromString(rd_ptr->uuid());
   FlowGraphNode* res_node = NodeForResourceID(res_id);
+  FlowGraphNode* parent_node = NULL;
   if (!res_node) {
     added_new_res_node = true;
     res_node = AddResourceNode(rd_ptr);
+    if (!rtnd_ptr->parent_id().empty()) {
+      parent_node =
+        NodeForResourceID(ResourceIDFromString(rtnd_ptr->parent_id()));
+      CHECK_NOTNULL(parent_node);
+      // The resources below a machine belong to the same machine as their
+      // parent. The machine's own handle is set in AddResourceNode.
+      if (res_node->type_ != FlowNodeType::MACHINE) {
+        machine_handles_[res_node->resource_handle_] =
+          machine_handles_[parent_node->resource_handle_];
+      }
+    }
     if (res_node->type_ == FlowNodeType::PU) {
       UpdateResToSinkArc(res_node);
       if (rd_ptr->num_slots_below() == 0) {
@@ -182,15 +203,12 @@ void FlowGraphManager::AddResourceTopologyDFS(
       << "A resource node that is not a coordinator must have a parent";
   } else if (added_new_res_node) {
     // Connect the node to the parent.
-    FlowGraphNode* parent_node =
-      NodeForResourceID(ResourceIDFromString(rtnd_ptr->parent_id()));
-    CHECK_NOTNULL(parent_node);
     CHECK(InsertIfNotPresent(&node_to_parent_node_map_, res_node, parent_node));
     graph_change_manager_->AddArc(
         parent_node, res_node, 0,
         CapacityFromResNodeToParent(rtnd_ptr->resource_desc()),
-        cost_model_->ResourceNodeToResourceNodeCost(*parent_node->rd_ptr_,
-                                                    *rd_ptr),
+        cost_model_->ResourceNodeToResourceNodeCostForNodes(*parent_node,
+                                                            *res_node),
         OTHER, ADD_ARC_BETWEEN_RES, "AddResourceTopologyDFS");
   }
 }
@@ -199,6 +217,8 @@ void FlowGraphManager::AddResourceTopology(
     ResourceTopologyNodeDescriptor* rtnd_ptr) {
   CHECK_NOTNULL(rtnd_ptr);
   AddResourceTopologyDFS(rtnd_ptr);
+  MarkResourceDirty(ResourceIDFromString(rtnd_ptr->resource_desc().uuid()),
+                    true);
   // Progapate the capacity increase to the root of the topology.
   if (!rtnd_ptr->parent_id().empty()) {
     // We start from rtnd_ptr's parent because in AddResourceTopologyDFS we
@@ -230,7 +250,21 @@ FlowGraphNode* FlowGraphManager::AddResourceNode(ResourceDescriptor* rd_ptr) {
   ResourceID_t res_id = ResourceIDFromString(rd_ptr->uuid());
   res_node->resource_id_ = res_id;
   res_node->rd_ptr_ = rd_ptr;
-  CHECK(InsertIfNotPresent(&resource_to_node_map_, res_id, res_node));
+  uint32_t handle = resource_handles_.Intern(res_id);
+  if (handle >= resource_nodes_.size()) {
+    resource_nodes_.resize(handle + 1, NULL);
+    machine_handles_.resize(handle + 1, ResourceIDInterner::kInvalidHandle);
+    resource_statuses_.resize(handle + 1, NULL);
+  }
+  CHECK(resource_nodes_[handle] == NULL)
+    << "Resource node for resource: " << res_id << " already exists";
+  resource_nodes_[handle] = res_node;
+  res_node->resource_handle_ = handle;
+  if (res_node->type_ == FlowNodeType::MACHINE) {
+    machine_handles_[handle] = handle;
+  } else {
+    machine_handles_[handle] = ResourceIDInterner::kInvalidHandle;
+  }
   if (res_node->type_ == FlowNodeType::PU) {
     leaf_nodes_.insert(res_node->id_);
     leaf_res_ids_->insert(res_id);
@@ -249,6 +283,9 @@ FlowGraphNode* FlowGraphManager::AddTaskNode(JobID_t job_id,
                                    ADD_TASK_NODE, "AddTaskNode");
   task_node->td_ptr_ = td_ptr;
   task_node->job_id_ = job_id;
+  // The job's aggregator may not exist yet, in which case the handle is
+  // looked up again when it is needed.
+  task_node->job_handle_ = job_handles_.Lookup(job_id);
   sink_node_->excess_--;
   CHECK(InsertIfNotPresent(&task_to_node_map_, td_ptr->uid(), task_node));
   return task_node;
@@ -258,7 +295,15 @@ FlowGraphNode* FlowGraphManager::AddUnscheduledAggNode(JobID_t job_id) {
   string comment = "UNSCHED_AGG_for_" + to_string(job_id);
   FlowGraphNode* unsched_agg_node = graph_change_manager_->AddNode(
       FlowNodeType::JOB_AGGREGATOR, 0, ADD_UNSCHED_JOB_NODE, comment.c_str());
-  CHECK(InsertIfNotPresent(&job_unsched_to_node_, job_id, unsched_agg_node));
+  unsched_agg_node->job_id_ = job_id;
+  uint32_t handle = job_handles_.Intern(job_id);
+  if (handle >= unsched_agg_nodes_.size()) {
+    unsched_agg_nodes_.resize(handle + 1, NULL);
+  }
+  CHECK(unsched_agg_nodes_[handle] == NULL)
+    << "Unscheduled aggregator for job: " << job_id << " already exists";
+  unsched_agg_nodes_[handle] = unsched_agg_node;
+  unsched_agg_node->job_handle_ = handle;
   return unsched_agg_node;
 }
 
@@ -271,11 +316,168 @@ uint64_t FlowGraphManager::CapacityFromResNodeToParent(
   }
 }
 
+void FlowGraphManager::CollectDirtySubtree(
+    FlowGraphNode* res_node,
+    uint32_t subtree_mark,
+    vector<FlowGraphNode*>* res_nodes) {
+  if (res_node->visited_ == subtree_mark) {
+    // The node is in the subtree of another dirty node.
+    return;
+  }
+  uint64_t first_node = res_nodes->size();
+  res_node->visited_ = subtree_mark;
+  res_nodes->push_back(res_node);
+  for (uint64_t index = first_node; index < res_nodes->size(); ++index) {
+    for (auto& arc : (*res_nodes)[index]->outgoing_arcs_) {
+      FlowGraphNode* child_node = arc->dst_node_;
+      if (child_node->IsResourceNode() &&
+          child_node->visited_ != subtree_mark) {
+        child_node->visited_ = subtree_mark;
+        res_nodes->push_back(child_node);
+      }
+    }
+  }
+}
+
+void FlowGraphManager::ComputeDirtyTopologyStatistics(
+    boost::function<void(FlowGraphNode*)> prepare,
+    boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> gather,
+    boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> update) {
+  if (dirty_res_nodes_.empty()) {
+    return;
+  }
+  cur_traversal_counter_++;
+  // We first collect the dirty subtrees, and only afterwards the paths from
+  // the dirty nodes to the root. Otherwise, we could not tell apart a node
+  // whose subtree we've already collected from a node that is only on the
+  // path of one of its descendants.
+  vector<FlowGraphNode*> res_nodes;
+  for (auto& node_subtree : dirty_res_nodes_) {
+    if (node_subtree.second) {
+      CollectDirtySubtree(node_subtree.first, cur_traversal_counter_,
+                          &res_nodes);
+    }
+  }
+  for (auto& node_subtree : dirty_res_nodes_) {
+    FlowGraphNode* cur_node = node_subtree.first;
+    if (!node_subtree.second) {
+      if (cur_node->visited_ == cur_traversal_counter_) {
+        continue;
+      }
+      cur_node->visited_ = cur_traversal_counter_;
+      res_nodes.push_back(cur_node);
+    }
+    // Walk up until we reach a node that has already been collected. Its
+    // ancestors have either been collected already or will be collected when
+    // we walk up from the dirty node that caused it to be collected.
+    while (true) {
+      cur_node = FindPtrOrNull(node_to_parent_node_map_, cur_node);
+      if (!cur_node || cur_node->visited_ == cur_traversal_counter_) {
+        break;
+      }
+      cur_node->visited_ = cur_traversal_counter_;
+      res_nodes.push_back(cur_node);
+    }
+  }
+  dirty_res_nodes_.clear();
+  // Visit the nodes bottom-up so that every node has been updated before its
+  // statistics are gathered into its parent.
+  vector<pair<uint64_t, FlowGraphNode*>> depth_nodes;
+  depth_nodes.reserve(res_nodes.size());
+  for (auto& res_node : res_nodes) {
+    uint64_t depth = 0;
+    for (FlowGraphNode* cur_node = res_node;
+         (cur_node = FindPtrOrNull(node_to_parent_node_map_, cur_node)); ) {
+      depth++;
+    }
+    depth_nodes.push_back(make_pair(depth, res_node));
+  }
+  sort(depth_nodes.begin(), depth_nodes.end(),
+       greater<pair<uint64_t, FlowGraphNode*>>());
+  for (auto& depth_node : depth_nodes) {
+    FlowGraphNode* res_node = depth_node.second;
+    if (prepare) {
+      prepare(res_node);
+    }
+    for (auto& arc : res_node->outgoing_arcs_) {
+      if (arc->dst_node_ == sink_node_ || arc->dst_node_->IsResourceNode()) {
+        arc->src_node_ = gather(arc->src_node_, arc->dst_node_);
+        arc->src_node_ = update(arc->src_node_, arc->dst_node_);
+      }
+    }
+  }
+}
+
+void FlowGraphManager::ComputeMachineSubtreeStatistics(
+    FlowGraphNode* machine_node,
+    uint32_t subtree_mark,
+    const boost::function<void(FlowGraphNode*)>& prepare,
+    const boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)>&
+      gather,
+    const boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)>&
+      update,
+    vector<FlowGraphNode*>* subtree_nodes) {
+  // Collect the machine's subtree top-down. Every node is prepared before
+  // any statistics are gathered into it.
+  uint64_t first_node = subtree_nodes->size();
+  machine_node->visited_ = subtree_mark;
+  if (prepare) {
+    prepare(machine_node);
+  }
+  subtree_nodes->push_back(machine_node);
+  for (uint64_t index = first_node; index < subtree_nodes->size(); ++index) {
+    for (auto& arc : (*subtree_nodes)[index]->outgoing_arcs_) {
+      FlowGraphNode* child_node = arc->dst_node_;
+      if (child_node->IsResourceNode() &&
+          child_node->visited_ != subtree_mark) {
+        child_node->visited_ = subtree_mark;
+        if (prepare) {
+          prepare(child_node);
+        }
+        subtree_nodes->push_back(child_node);
+      }
+    }
+  }
+  // Visit the nodes in reverse order so that every node has received the
+  // statistics of all its children before it's gathered into its parent.
+  for (uint64_t index = subtree_nodes->size(); index > first_node; ) {
+    FlowGraphNode* cur_node = (*subtree_nodes)[--index];
+    for (auto& arc : cur_node->outgoing_arcs_) {
+      if (arc->dst_node_ == sink_node_ ||
+          arc->dst_node_->visited_ == subtree_mark) {
+        arc->src_node_ = gather(arc->src_node_, arc->dst_node_);
+        arc->src_node_ = update(arc->src_node_, arc->dst_node_);
+      }
+    }
+  }
+}
+
+void FlowGraphManager::ComputeMachineStatistics(
+    const vector<FlowGraphNode*>& machine_nodes,
+    uint32_t subtree_mark,
+    const boost::function<void(FlowGraphNode*)>& prepare,
+    const boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)>&
+      gather,
+    const boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)>&
+      update,
+    std::atomic<uint64_t>* next_machine,
+    vector<FlowGraphNode*>* subtree_nodes) {
+  // Machines are handed out one at a time, so threads that finish their
+  // subtrees early pick up the remaining machines.
+  for (uint64_t index = next_machine->fetch_add(1);
+       index < machine_nodes.size();
+       index = next_machine->fetch_add(1)) {
+    ComputeMachineSubtreeStatistics(machine_nodes[index], subtree_mark,
+                                    prepare, gather, update, subtree_nodes);
+  }
+}
+
 void FlowGraphManager::ComputeTopologyStatistics(
     FlowGraphNode* node,
     boost::function<void(FlowGraphNode*)> prepare,
     boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> gather,
-    boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> update) {
+    boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> update,
+    bool thread_safe) {
   // XXX(ionel): The function only works correctly as long as the topology is a
   // tree. If the topology is a DAG then it does not work correctly! It does
   // not work in the DAG case because the function implements BFS. Hence,
@@ -288,25 +490,69 @@ void FlowGraphManager::ComputeTopologyStatistics(
   // variable we avoid having to reset the visited state of each node before
   // of a traversal.
   cur_traversal_counter_++;
+  // If the callbacks are thread-safe, we first compute the statistics of the
+  // machines' subtrees in parallel. The nodes in these subtrees are marked
+  // with their own counter value so that the BFS below knows that the arcs
+  // within the subtrees have already been visited.
+  bool parallel = thread_safe && FLAGS_topology_stats_threads > 0 &&
+    node == sink_node_;
+  uint32_t subtree_mark = cur_traversal_counter_;
+  vector<vector<FlowGraphNode*>> subtree_nodes;
+  if (parallel) {
+    cur_traversal_counter_++;
+    vector<FlowGraphNode*> machine_nodes;
+    for (auto res_node : resource_nodes_) {
+      if (res_node && res_node->type_ == FlowNodeType::MACHINE) {
+        machine_nodes.push_back(res_node);
+      }
+    }
+    uint64_t num_threads =
+      min(FLAGS_topology_stats_threads,
+          static_cast<uint64_t>(machine_nodes.size()));
+    subtree_nodes.resize(num_threads);
+    std::atomic<uint64_t> next_machine(0);
+    boost::thread_group threads;
+    for (uint64_t index = 0; index < num_threads; ++index) {
+      threads.create_thread(
+          boost::bind(&FlowGraphManager::ComputeMachineStatistics, this,
+                      boost::cref(machine_nodes), subtree_mark, prepare,
+                      gather, update, &next_machine, &subtree_nodes[index]));
+    }
+    threads.join_all();
+  }
   to_visit.push(node);
   node->visited_ = cur_traversal_counter_;
+  // The subtree nodes can still have incoming arcs from outside their
+  // subtree (e.g., from the cluster aggregator or from tasks).
+  for (auto& nodes : subtree_nodes) {
+    for (auto& subtree_node : nodes) {
+      to_visit.push(subtree_node);
+    }
+  }
   while (!to_visit.empty()) {
     FlowGraphNode* cur_node = to_visit.front();
     to_visit.pop();
-    for (auto& incoming_arc : cur_node->incoming_arc_map_) {
-      if (incoming_arc.second->src_node_->visited_ != cur_traversal_counter_) {
+    for (auto& incoming_arc : cur_node->incoming_arcs_) {
+      if (parallel && incoming_arc->src_node_->visited_ == subtree_mark) {
+        if (cur_node == sink_node_ || cur_node->visited_ == subtree_mark) {
+          // The arc is within a subtree.
+          continue;
+        }
+      } else if (incoming_arc->src_node_->visited_ != cur_traversal_counter_) {
         if (prepare) {
-          prepare(incoming_arc.second->src_node_);
+          prepare(incoming_arc->src_node_);
         }
-        to_visit.push(incoming_arc.second->src_node_);
-        incoming_arc.second->src_node_->visited_ = cur_traversal_counter_;
+        to_visit.push(incoming_arc->src_node_);
+        incoming_arc->src_node_->visited_ = cur_traversal_counter_;
       }
-      incoming_arc.second->src_node_ =
-        gather(incoming_arc.second->src_node_, cur_node);
-      incoming_arc.second->src_node_ =
-        update(incoming_arc.second->src_node_, cur_node);
+      incoming_arc->src_node_ = gather(incoming_arc->src_node_, cur_node);
+      incoming_arc->src_node_ = update(incoming_arc->src_node_, cur_node);
     }
   }
+  if (node == sink_node_) {
+    // We've recomputed the statistics of the entire topology.
+    dirty_res_nodes_.clear();
+  }
 }
 
 void FlowGraphManager::JobCompleted(JobID_t job_id) {
@@ -315,6 +561,53 @@ void FlowGraphManager::JobCompleted(JobID_t job_id) {
   // removed.
 }
 
+uint32_t FlowGraphManager::MachineHandleForResource(
+    uint32_t res_handle) const {
+  CHECK_LT(res_handle, machine_handles_.size());
+  uint32_t machine_handle = machine_handles_[res_handle];
+  CHECK_NE(machine_handle, ResourceIDInterner::kInvalidHandle)
+    << "Resource " << resource_handles_.IDForHandle(res_handle)
+    << " is not in a machine";
+  return machine_handle;
+}
+
+ResourceID_t FlowGraphManager::MachineResIDForResource(
+    const ResourceID_t& res_id) const {
+  uint32_t handle = resource_handles_.Lookup(res_id);
+  CHECK_NE(handle, ResourceIDInterner::kInvalidHandle)
+    << "Resource " << res_id << " has no node";
+  return resource_handles_.IDForHandle(MachineHandleForResource(handle));
+}
+
+void FlowGraphManager::MarkResourceDirty(ResourceID_t res_id, bool subtree) {
+  FlowGraphNode* res_node = NodeForResourceID(res_id);
+  if (!res_node) {
+    // We may get statistics for resources that are not in the flow graph
+    // (e.g., for the local machine when it's not a scheduling target).
+    VLOG(2) << "Not marking unknown resource " << res_id << " as dirty";
+    return;
+  }
+  MarkResourceNodeDirty(res_node, subtree);
+}
+
+void FlowGraphManager::MarkResourceNodeDirty(FlowGraphNode* res_node,
+                                             bool subtree) {
+  CHECK_NOTNULL(res_node);
+  bool* dirty_subtree = FindOrNull(dirty_res_nodes_, res_node);
+  if (dirty_subtree) {
+    *dirty_subtree = *dirty_subtree || subtree;
+  } else {
+    CHECK(InsertIfNotPresent(&dirty_res_nodes_, res_node, subtree));
+  }
+}
+
+void FlowGraphManager::MarkTaskResourceDirty(TaskID_t task_id) {
+  FlowGraphArc* running_arc = FindPtrOrNull(task_to_running_arc_, task_id);
+  if (running_arc) {
+    MarkResourceNodeDirty(running_arc->dst_node_, false);
+  }
+}
+
 void FlowGraphManager::SchedulingDeltasForPreemptedTasks(
     const multimap<uint64_t, uint64_t>& task_mappings,
     shared_ptr<ResourceMap_t> resource_map,
@@ -368,7 +661,7 @@ void FlowGraphManager::NodeBindingToSchedulingDeltas(
   ResourceID_t* bound_res = FindOrNull(*task_bindings, task.uid());
   if (bound_res) {
     // Task already running somewhere.
-    if (*bound_res != ResourceIDFromString(res.uuid())) {
+    if (*bound_res != res_node.resource_id_) {
       // Task is running on a different resource => migration.
       VLOG(2) << "MIGRATION: take " << task.uid() << " off "
               << *bound_res << " and move it to "
@@ -397,12 +690,10 @@ void FlowGraphManager::NodeBindingToSchedulingDeltas(
 void FlowGraphManager::PinTaskToNode(FlowGraphNode* task_node,
                                      FlowGraphNode* res_node) {
   bool added_running_arc = false;
-  // Remove all arcs apart from the task -> resource mapping.
-  for (unordered_map<uint64_t, FlowGraphArc*>::iterator it =
-         task_node->outgoing_arc_map_.begin();
-       it != task_node->outgoing_arc_map_.end(); ) {
-    FlowGraphArc* arc = it->second;
-    ++it;
+  // Remove all arcs apart from the task -> resource mapping. We iterate
+  // backwards because deleting an arc moves the last arc into its slot.
+  for (uint64_t index = task_node->outgoing_arcs_.size(); index > 0; ) {
+    FlowGraphArc* arc = task_node->outgoing_arcs_[--index];
     if (arc->dst_node_->id_ == res_node->id_) {
       // This preference arc connects the same nodes as the running arc. Hence,
       // we just transform it into the running arc.
@@ -431,7 +722,7 @@ void FlowGraphManager::PinTaskToNode(FlowGraphNode* task_node,
     }
   }
   // Decrement capacity from unsched agg node to sink.
-  UpdateUnscheduledAggNode(UnschedAggNodeForJobID(task_node->job_id_), -1);
+  UpdateUnscheduledAggNode(UnschedAggNodeForTaskNode(task_node), -1);
   if (!added_running_arc) {
     uint64_t low_bound_capacity = 1;
     if (FLAGS_flow_scheduling_solver == "custom") {
@@ -461,7 +752,7 @@ void FlowGraphManager::PurgeUnconnectedEquivClassNodes() {
        it != tec_to_node_map_.end(); ) {
     FlowGraphNode* ec_node = it->second;
     ++it;
-    if (ec_node->incoming_arc_map_.size() == 0) {
+    if (ec_node->incoming_arcs_.size() == 0) {
       RemoveEquivClassNode(ec_node);
     }
   }
@@ -478,17 +769,22 @@ void FlowGraphManager::RemoveInvalidECPrefArcs(
     const FlowGraphNode& node,
     const vector<EquivClass_t>& pref_ecs,
     DIMACSChangeType change_type) {
-  unordered_set<EquivClass_t> ec_preferences(pref_ecs.begin(), pref_ecs.end());
-  unordered_set<FlowGraphArc*> to_delete;
-  for (auto& dst_arc : node.outgoing_arc_map_) {
-    EquivClass_t pref_ec = dst_arc.second->dst_node_->ec_id_;
+  // N.B.: this runs for every node we update, so we look the preferences up
+  // in a sorted copy kept in a reused buffer rather than building a hash set.
+  sorted_pref_ecs_.assign(pref_ecs.begin(), pref_ecs.end());
+  sort(sorted_pref_ecs_.begin(), sorted_pref_ecs_.end());
+  arcs_to_delete_.clear();
+  for (auto& dst_arc : node.outgoing_arcs_) {
+    EquivClass_t pref_ec = dst_arc->dst_node_->ec_id_;
     // Remove if the pref is an EC node and it's not in the preferences vector
-    if (pref_ec != 0 && ec_preferences.find(pref_ec) == ec_preferences.end()) {
-      to_delete.insert(dst_arc.second);
+    if (pref_ec != 0 &&
+        !binary_search(sorted_pref_ecs_.begin(), sorted_pref_ecs_.end(),
+                       pref_ec)) {
+      arcs_to_delete_.push_back(dst_arc);
       VLOG(2) << "Deleting no-longer-current arc to EC " << pref_ec;
     }
   }
-  for (auto& arc : to_delete) {
+  for (auto& arc : arcs_to_delete_) {
     graph_change_manager_->DeleteArc(arc, change_type,
                                      "RemoveInvalidECPrefArcs");
   }
@@ -498,27 +794,36 @@ void FlowGraphManager::RemoveInvalidPrefResArcs(
     const FlowGraphNode& node,
     const vector<ResourceID_t>& pref_resources,
     DIMACSChangeType change_type) {
-  unordered_set<ResourceID_t, boost::hash<boost::uuids::uuid>> res_preferences(
-      pref_resources.begin(),
-      pref_resources.end());
-  unordered_set<FlowGraphArc*> to_delete;
-  for (auto& dst_arc : node.outgoing_arc_map_) {
-    ResourceID_t pref_rid = dst_arc.second->dst_node_->resource_id_;
+  sorted_pref_res_.assign(pref_resources.begin(), pref_resources.end());
+  sort(sorted_pref_res_.begin(), sorted_pref_res_.end());
+  arcs_to_delete_.clear();
+  for (auto& dst_arc : node.outgoing_arcs_) {
+    ResourceID_t pref_rid = dst_arc->dst_node_->resource_id_;
     // Remove if the pref node is a resource node and it's not in the
     // preferences set.
     if (!pref_rid.is_nil() &&
-        res_preferences.find(pref_rid) == res_preferences.end() &&
-        dst_arc.second->type_ != FlowGraphArcType::RUNNING) {
-      to_delete.insert(dst_arc.second);
+        !binary_search(sorted_pref_res_.begin(), sorted_pref_res_.end(),
+                       pref_rid) &&
+        dst_arc->type_ != FlowGraphArcType::RUNNING) {
+      arcs_to_delete_.push_back(dst_arc);
       VLOG(2) << "Deleting no-longer-current arc to resource " << pref_rid;
     }
   }
-  for (auto& arc : to_delete) {
+  for (auto& arc : arcs_to_delete_) {
     graph_change_manager_->DeleteArc(arc, change_type,
                                      "RemoveInvalidResPrefArcs");
   }
 }
 
+void FlowGraphManager::RegisterResourceStatus(ResourceStatus* rs_ptr) {
+  CHECK_NOTNULL(rs_ptr);
+  uint32_t handle = resource_handles_.Lookup(rs_ptr->id());
+  CHECK_NE(handle, ResourceIDInterner::kInvalidHandle)
+    << "Resource " << rs_ptr->id() << " has no node";
+  rs_ptr->set_handle(handle);
+  resource_statuses_[handle] = rs_ptr;
+}
+
 void FlowGraphManager::RemoveResourceTopology(const ResourceDescriptor& rd,
                                               set<uint64_t>* pus_removed) {
   CHECK_NOTNULL(pus_removed);
@@ -526,18 +831,22 @@ void FlowGraphManager::RemoveResourceTopology(const ResourceDescriptor& rd,
   FlowGraphNode* res_node = NodeForResourceID(res_id);
   CHECK_NOTNULL(res_node);
   int64_t cap_delta = 0;
-  // Delete the children nodes. We use an iterator because we change the
-  // collection while we iterate over it.
-  for (unordered_map<uint64_t, FlowGraphArc*>::iterator
-         it = res_node->outgoing_arc_map_.begin();
-       it != res_node->outgoing_arc_map_.end();) {
-    FlowGraphArc* arc = it->second;
-    ++it;
+  // Delete the children nodes. We iterate backwards because we change the
+  // collection while we iterate over it, and deleting an arc moves the last
+  // arc into its slot.
+  for (uint64_t index = res_node->outgoing_arcs_.size(); index > 0; ) {
+    FlowGraphArc* arc = res_node->outgoing_arcs_[--index];
     cap_delta -=  arc->cap_upper_bound_;
     if (!arc->dst_node_->resource_id_.is_nil()) {
       TraverseAndRemoveTopology(arc->dst_node_, pus_removed);
     }
   }
+  // The parent's statistics no longer include the removed subtree.
+  FlowGraphNode* parent_node = FindPtrOrNull(node_to_parent_node_map_,
+                                             res_node);
+  if (parent_node) {
+    MarkResourceNodeDirty(parent_node, false);
+  }
   // Propagate the stats update up to the root resource.
   UpdateResourceStatsUpToRoot(
       res_node, cap_delta,
@@ -560,16 +869,66 @@ void FlowGraphManager::RemoveResourceNode(FlowGraphNode* res_node) {
   // No need to check erase result, as the call may not delete anything if the
   // resource is not a leaf.
   leaf_nodes_.erase(res_node->id_);
+  dirty_res_nodes_.erase(res_node);
   // When we call erase() on a set we end up deleting the object because the set
   // calls the object's destructor. We copy res_id to avoid using freed memory.
   ResourceID_t res_id_tmp = res_node->resource_id_;
   ResourceID_t res_id_tmp2 = res_node->resource_id_;
   leaf_res_ids_->erase(res_id_tmp);
-  resource_to_node_map_.erase(res_id_tmp2);
+  resource_nodes_[res_node->resource_handle_] = NULL;
+  machine_handles_[res_node->resource_handle_] =
+    ResourceIDInterner::kInvalidHandle;
+  ResourceStatus* rs_ptr = resource_statuses_[res_node->resource_handle_];
+  if (rs_ptr) {
+    rs_ptr->set_handle(ResourceIDInterner::kInvalidHandle);
+    resource_statuses_[res_node->resource_handle_] = NULL;
+  }
+  resource_handles_.Release(res_id_tmp2);
   graph_change_manager_->DeleteNode(res_node, DEL_RESOURCE_NODE,
                                     "RemoveResourceNode");
 }
 
+void FlowGraphManager::RestoreSolverState(
+    const SolverState& solver_state, vector<int64_t>* potentials,
+    vector<unordered_map<uint64_t, uint64_t>>* flow) const {
+  CHECK_NOTNULL(potentials);
+  CHECK_NOTNULL(flow);
+  const FlowGraph& flow_graph = graph_change_manager_->flow_graph();
+  unordered_map<string, uint64_t> node_ids;
+  uint64_t num_nodes = flow_graph.NumNodes() + 1;
+  SolverNodeState node_state;
+  for (auto& node : flow_graph.Nodes()) {
+    num_nodes = max(num_nodes, node->id_ + 1);
+    if (SetSolverNodeState(*node, &node_state)) {
+      InsertIfNotPresent(&node_ids, SolverNodeKey(node_state), node->id_);
+    }
+  }
+  potentials->assign(num_nodes, 0);
+  flow->assign(num_nodes, unordered_map<uint64_t, uint64_t>());
+  // Ids of the saved nodes in the current graph, or num_nodes if a node is no
+  // longer in the graph.
+  vector<uint64_t> restored_ids;
+  restored_ids.reserve(solver_state.nodes_size());
+  for (auto& saved_node : solver_state.nodes()) {
+    const uint64_t* node_id = FindOrNull(node_ids, SolverNodeKey(saved_node));
+    if (node_id == NULL) {
+      restored_ids.push_back(num_nodes);
+    } else {
+      restored_ids.push_back(*node_id);
+      (*potentials)[*node_id] = saved_node.potential();
+    }
+  }
+  for (auto& arc_flow : solver_state.flows()) {
+    CHECK_LT(arc_flow.src(), restored_ids.size());
+    CHECK_LT(arc_flow.dst(), restored_ids.size());
+    uint64_t src = restored_ids[arc_flow.src()];
+    uint64_t dst = restored_ids[arc_flow.dst()];
+    if (src < num_nodes && dst < num_nodes) {
+      (*flow)[dst][src] = arc_flow.flow();
+    }
+  }
+}
+
 uint64_t FlowGraphManager::RemoveTaskNode(FlowGraphNode* task_node) {
   CHECK_NOTNULL(task_node);
   uint64_t task_node_id = task_node->id_;
@@ -584,11 +943,78 @@ uint64_t FlowGraphManager::RemoveTaskNode(FlowGraphNode* task_node) {
 void FlowGraphManager::RemoveUnscheduledAggNode(JobID_t job_id) {
   FlowGraphNode* unsched_agg_node = UnschedAggNodeForJobID(job_id);
   CHECK_NOTNULL(unsched_agg_node);
-  CHECK_EQ(job_unsched_to_node_.erase(job_id), 1);
+  unsched_agg_nodes_[unsched_agg_node->job_handle_] = NULL;
+  CHECK(job_handles_.Release(job_id));
   graph_change_manager_->DeleteNode(unsched_agg_node, DEL_UNSCHED_JOB_NODE,
                                     "RemoveUnscheduledAggNode");
 }
 
+void FlowGraphManager::SaveSolverState(
+    const vector<int64_t>& potentials,
+    const vector<unordered_map<uint64_t, uint64_t>>& flow,
+    SolverState* solver_state) const {
+  CHECK_NOTNULL(solver_state);
+  const FlowGraph& flow_graph = graph_change_manager_->flow_graph();
+  // Index of every saved node in solver_state's nodes.
+  unordered_map<uint64_t, uint64_t> node_indices;
+  for (auto& node : flow_graph.Nodes()) {
+    if (node->id_ >= potentials.size()) {
+      // The node was added after the solver's last run.
+      continue;
+    }
+    SolverNodeState* node_state = solver_state->add_nodes();
+    if (!SetSolverNodeState(*node, node_state)) {
+      solver_state->mutable_nodes()->RemoveLast();
+      continue;
+    }
+    node_state->set_potential(potentials[node->id_]);
+    InsertOrUpdate(&node_indices, node->id_, solver_state->nodes_size() - 1);
+  }
+  for (uint64_t dst = 0; dst < flow.size(); ++dst) {
+    const uint64_t* dst_index = FindOrNull(node_indices, dst);
+    if (dst_index == NULL) {
+      continue;
+    }
+    for (auto& src_flow : flow[dst]) {
+      const uint64_t* src_index = FindOrNull(node_indices, src_flow.first);
+      if (src_index != NULL) {
+        SolverArcFlow* arc_flow = solver_state->add_flows();
+        arc_flow->set_src(*src_index);
+        arc_flow->set_dst(*dst_index);
+        arc_flow->set_flow(src_flow.second);
+      }
+    }
+  }
+}
+
+bool FlowGraphManager::SetSolverNodeState(const FlowGraphNode& node,
+                                          SolverNodeState* node_state) const {
+  node_state->Clear();
+  if (node.type_ == FlowNodeType::SINK) {
+    node_state->set_kind(SolverNodeState::SINK);
+  } else if (node.IsTaskNode()) {
+    node_state->set_kind(SolverNodeState::TASK);
+    node_state->set_id(node.td_ptr_->uid());
+  } else if (node.IsResourceNode()) {
+    node_state->set_kind(SolverNodeState::RESOURCE);
+    node_state->set_uuid(to_string(node.resource_id_));
+  } else if (node.IsEquivalenceClassNode()) {
+    node_state->set_kind(SolverNodeState::EQUIVALENCE_CLASS);
+    node_state->set_id(node.ec_id_);
+  } else if (node.type_ == FlowNodeType::JOB_AGGREGATOR) {
+    node_state->set_kind(SolverNodeState::UNSCHEDULED_AGGREGATOR);
+    node_state->set_uuid(to_string(node.job_id_));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+string FlowGraphManager::SolverNodeKey(const SolverNodeState& node_state) {
+  return to_string(static_cast<int>(node_state.kind())) + "/" +
+    to_string(node_state.id()) + "/" + node_state.uuid();
+}
+
 uint64_t FlowGraphManager::TaskCompleted(TaskID_t task_id) {
   FlowGraphNode* task_node = NodeForTaskID(task_id);
   CHECK_NOTNULL(task_node);
@@ -596,8 +1022,9 @@ uint64_t FlowGraphManager::TaskCompleted(TaskID_t task_id) {
     // When we pin the task we reduce the capacity from the unscheduled
     // aggrator to the sink. Hence, we only have to reduce the capacity
     // when we support preemption.
-    UpdateUnscheduledAggNode(UnschedAggNodeForJobID(task_node->job_id_), -1);
+    UpdateUnscheduledAggNode(UnschedAggNodeForTaskNode(task_node), -1);
   }
+  MarkTaskResourceDirty(task_id);
   task_to_running_arc_.erase(task_id);
   uint64_t task_node_id = RemoveTaskNode(task_node);
   // NOTE: We do not remove the task from the cost_model because
@@ -612,6 +1039,7 @@ void FlowGraphManager::TaskEvicted(TaskID_t task_id, ResourceID_t res_id) {
   FlowGraphArc* running_arc =
     FindPtrOrNull(task_to_running_arc_, task_node->td_ptr_->uid());
   CHECK_NOTNULL(running_arc);
+  MarkTaskResourceDirty(task_id);
   task_to_running_arc_.erase(task_id);
   graph_change_manager_->DeleteArc(running_arc, DEL_ARC_EVICTED_TASK,
                                    "TaskEvicted: delete running arc");
@@ -619,8 +1047,7 @@ void FlowGraphManager::TaskEvicted(TaskID_t task_id, ResourceID_t res_id) {
     // If we're running with preemption disabled then increase the capacity from
     // the unscheduled aggregator to the sink because the task can now stay
     // unscheduled.
-    FlowGraphNode* unsched_agg_node =
-      UnschedAggNodeForJobID(JobIDFromString(task_node->td_ptr_->job_id()));
+    FlowGraphNode* unsched_agg_node = UnschedAggNodeForTaskNode(task_node);
     CHECK_NOTNULL(unsched_agg_node);
     // Increment capacity from unsched agg node to sink.
     UpdateUnscheduledAggNode(unsched_agg_node, 1);
@@ -628,32 +1055,36 @@ void FlowGraphManager::TaskEvicted(TaskID_t task_id, ResourceID_t res_id) {
   // The task's arcs will be updated just before the next solver run.
 }
 
-void FlowGraphManager::TaskFailed(TaskID_t task_id) {
+uint64_t FlowGraphManager::TaskFailed(TaskID_t task_id) {
   FlowGraphNode* task_node = NodeForTaskID(task_id);
   CHECK_NOTNULL(task_node);
   if (FLAGS_preemption) {
     // When we pin the task we reduce the capacity from the unscheduled
     // aggrator to the sink. Hence, we only have to reduce the capacity
     // when we support preemption.
-    UpdateUnscheduledAggNode(UnschedAggNodeForJobID(task_node->job_id_), -1);
+    UpdateUnscheduledAggNode(UnschedAggNodeForTaskNode(task_node), -1);
   }
+  MarkTaskResourceDirty(task_id);
   task_to_running_arc_.erase(task_id);
-  RemoveTaskNode(task_node);
+  uint64_t task_node_id = RemoveTaskNode(task_node);
   cost_model_->RemoveTask(task_id);
+  return task_node_id;
 }
 
-void FlowGraphManager::TaskKilled(TaskID_t task_id) {
+uint64_t FlowGraphManager::TaskKilled(TaskID_t task_id) {
   FlowGraphNode* task_node = NodeForTaskID(task_id);
   CHECK_NOTNULL(task_node);
   if (FLAGS_preemption) {
     // When we pin the task we reduce the capacity from the unscheduled
     // aggrator to the sink. Hence, we only have to reduce the capacity
     // when we support preemption.
-    UpdateUnscheduledAggNode(UnschedAggNodeForJobID(task_node->job_id_), -1);
+    UpdateUnscheduledAggNode(UnschedAggNodeForTaskNode(task_node), -1);
   }
+  MarkTaskResourceDirty(task_id);
   task_to_running_arc_.erase(task_id);
-  RemoveTaskNode(task_node);
+  uint64_t task_node_id = RemoveTaskNode(task_node);
   cost_model_->RemoveTask(task_id);
+  return task_node_id;
 }
 
 void FlowGraphManager::TaskMigrated(TaskID_t task_id,
@@ -668,18 +1099,16 @@ void FlowGraphManager::TaskScheduled(TaskID_t task_id, ResourceID_t res_id) {
   CHECK_NOTNULL(task_node);
   task_node->type_ = FlowNodeType::SCHEDULED_TASK;
   FlowGraphNode* res_node = NodeForResourceID(res_id);
+  MarkResourceNodeDirty(res_node, false);
   UpdateArcsForScheduledTask(task_node, res_node);
 }
 
 void FlowGraphManager::TraverseAndRemoveTopology(FlowGraphNode* res_node,
                                                  set<uint64_t>* pus_removed) {
-  // We use an iterator because we change the collection while we iterate over
-  // it.
-  for (unordered_map<uint64_t, FlowGraphArc*>::iterator
-         it = res_node->outgoing_arc_map_.begin();
-       it != res_node->outgoing_arc_map_.end();) {
-    FlowGraphArc* arc = it->second;
-    ++it;
+  // We iterate backwards because we change the collection while we iterate
+  // over it, and deleting an arc moves the last arc into its slot.
+  for (uint64_t index = res_node->outgoing_arcs_.size(); index > 0; ) {
+    FlowGraphArc* arc = res_node->outgoing_arcs_[--index];
     if (!arc->dst_node_->resource_id_.is_nil()) {
       // The arc is pointing to a resource node.
       TraverseAndRemoveTopology(arc->dst_node_, pus_removed);
@@ -694,19 +1123,30 @@ void FlowGraphManager::TraverseAndRemoveTopology(FlowGraphNode* res_node,
 }
 
 void FlowGraphManager::UpdateAllCostsToUnscheduledAggs() {
-  for (auto& job_node : job_unsched_to_node_) {
-    const FlowGraphNode* unsched_node = job_node.second;
-    CHECK_NOTNULL(unsched_node);
-    for (auto& dst_arc : unsched_node->incoming_arc_map_) {
-      FlowGraphNode* task_node = dst_arc.second->src_node_;
+  // We first collect the unscheduled tasks in order to compute their costs
+  // in a single batch.
+  vector<FlowGraphNode*> unsched_task_nodes;
+  vector<TaskID_t> unsched_task_ids;
+  for (auto unsched_node : unsched_agg_nodes_) {
+    if (!unsched_node) {
+      continue;
+    }
+    for (auto& dst_arc : unsched_node->incoming_arcs_) {
+      FlowGraphNode* task_node = dst_arc->src_node_;
       CHECK_NOTNULL(task_node->td_ptr_);
       if (task_node->IsTaskAssignedOrRunning()) {
         UpdateRunningTaskNode(task_node, false, NULL, NULL);
       } else {
-        UpdateTaskToUnscheduledAggArc(task_node);
+        unsched_task_nodes.push_back(task_node);
+        unsched_task_ids.push_back(task_node->td_ptr_->uid());
       }
     }
   }
+  vector<Cost_t> costs;
+  cost_model_->TaskToUnscheduledAggCosts(unsched_task_ids, &costs);
+  for (uint64_t index = 0; index < unsched_task_nodes.size(); ++index) {
+    UpdateTaskToUnscheduledAggArc(unsched_task_nodes[index], costs[index]);
+  }
 }
 
 void FlowGraphManager::UpdateArcsForScheduledTask(FlowGraphNode* task_node,
@@ -762,7 +1202,8 @@ void FlowGraphManager::UpdateChildrenTasks(
         JobID_t job_id = JobIDFromString(child_td_ptr->job_id());
         child_task_node = AddTaskNode(job_id, child_td_ptr);
         // Increment capacity from unsched agg node to sink.
-        UpdateUnscheduledAggNode(UnschedAggNodeForJobID(job_id), 1);
+        UpdateUnscheduledAggNode(UnschedAggNodeForTaskNode(child_task_node),
+                                 1);
         node_queue->push(new TDOrNodeWrapper(child_task_node, child_td_ptr));
         marked_nodes->insert(child_task_node->id_);
       } else {
@@ -795,16 +1236,23 @@ void FlowGraphManager::UpdateEquivToEquivArcs(
   CHECK_NOTNULL(ec_node);
   CHECK_NOTNULL(node_queue);
   CHECK_NOTNULL(marked_nodes);
-  vector<EquivClass_t>* pref_ec =
-    cost_model_->GetEquivClassToEquivClassesArcs(ec_node->ec_id_);
-  if (pref_ec) {
-    for (auto& pref_ec_id : *pref_ec) {
+  vector<EquivClass_t>* pref_ec = &pref_ecs_buffer_;
+  cost_model_->FillEquivClassToEquivClassesArcs(ec_node->ec_id_, pref_ec);
+  vector<pair<EquivClass_t, EquivClass_t>>* ec_ecs = &ec_ecs_buffer_;
+  ec_ecs->clear();
+  for (auto& pref_ec_id : *pref_ec) {
+    ec_ecs->push_back(make_pair(ec_node->ec_id_, pref_ec_id));
+  }
+  if (!ec_ecs->empty()) {
+    vector<pair<Cost_t, uint64_t>>* costs_and_caps = &costs_and_caps_buffer_;
+    cost_model_->EquivClassToEquivClassCosts(*ec_ecs, costs_and_caps);
+    for (uint64_t index = 0; index < pref_ec->size(); ++index) {
+      EquivClass_t pref_ec_id = (*pref_ec)[index];
       FlowGraphNode* pref_ec_node = NodeForEquivClass(pref_ec_id);
       if (!pref_ec_node) {
         pref_ec_node = AddEquivClassNode(pref_ec_id);
       }
-      pair<Cost_t, uint64_t> cost_and_cap =
-        cost_model_->EquivClassToEquivClass(ec_node->ec_id_, pref_ec_id);
+      const pair<Cost_t, uint64_t>& cost_and_cap = (*costs_and_caps)[index];
       FlowGraphArc* pref_ec_arc =
         graph_change_manager_->mutable_flow_graph()->GetArc(ec_node,
                                                             pref_ec_node);
@@ -825,12 +1273,8 @@ void FlowGraphManager::UpdateEquivToEquivArcs(
             new TDOrNodeWrapper(pref_ec_node, pref_ec_node->td_ptr_));
       }
     }
-    RemoveInvalidECPrefArcs(*ec_node, *pref_ec, DEL_ARC_BETWEEN_EQUIV_CLASS);
-    delete pref_ec;
-  } else {
-    vector<EquivClass_t> no_pref_ec;
-    RemoveInvalidECPrefArcs(*ec_node, no_pref_ec, DEL_ARC_BETWEEN_EQUIV_CLASS);
   }
+  RemoveInvalidECPrefArcs(*ec_node, *pref_ec, DEL_ARC_BETWEEN_EQUIV_CLASS);
 }
 
 void FlowGraphManager::UpdateEquivToResArcs(
@@ -840,16 +1284,22 @@ void FlowGraphManager::UpdateEquivToResArcs(
   CHECK_NOTNULL(ec_node);
   CHECK_NOTNULL(node_queue);
   CHECK_NOTNULL(marked_nodes);
-  vector<ResourceID_t>* pref_res =
-    cost_model_->GetOutgoingEquivClassPrefArcs(ec_node->ec_id_);
-  if (pref_res) {
-    for (auto& pref_res_id : *pref_res) {
-      FlowGraphNode* pref_res_node = NodeForResourceID(pref_res_id);
+  vector<ResourceID_t>* pref_res = &pref_res_buffer_;
+  cost_model_->FillOutgoingEquivClassPrefArcs(ec_node->ec_id_, pref_res);
+  vector<pair<EquivClass_t, ResourceID_t>>* ec_res = &ec_res_buffer_;
+  ec_res->clear();
+  for (auto& pref_res_id : *pref_res) {
+    ec_res->push_back(make_pair(ec_node->ec_id_, pref_res_id));
+  }
+  if (!ec_res->empty()) {
+    vector<pair<Cost_t, uint64_t>>* costs_and_caps = &costs_and_caps_buffer_;
+    cost_model_->EquivClassToResourceNodeCosts(*ec_res, costs_and_caps);
+    for (uint64_t index = 0; index < pref_res->size(); ++index) {
+      FlowGraphNode* pref_res_node = NodeForResourceID((*pref_res)[index]);
       // The resource node should already exist because the cost models cannot
       // prefer a resource before it is added to the graph.
       CHECK_NOTNULL(pref_res_node);
-      pair<Cost_t, uint64_t> cost_and_cap =
-        cost_model_->EquivClassToResourceNode(ec_node->ec_id_, pref_res_id);
+      const pair<Cost_t, uint64_t>& cost_and_cap = (*costs_and_caps)[index];
       FlowGraphArc* pref_res_arc =
         graph_change_manager_->mutable_flow_graph()->GetArc(ec_node,
                                                             pref_res_node);
@@ -871,12 +1321,8 @@ void FlowGraphManager::UpdateEquivToResArcs(
             new TDOrNodeWrapper(pref_res_node, pref_res_node->td_ptr_));
       }
     }
-    RemoveInvalidPrefResArcs(*ec_node, *pref_res, DEL_ARC_EQUIV_CLASS_TO_RES);
-    delete pref_res;
-  } else {
-    vector<ResourceID_t> no_pref_res;
-    RemoveInvalidPrefResArcs(*ec_node, no_pref_res, DEL_ARC_EQUIV_CLASS_TO_RES);
   }
+  RemoveInvalidPrefResArcs(*ec_node, *pref_res, DEL_ARC_EQUIV_CLASS_TO_RES);
 }
 
 void FlowGraphManager::UpdateFlowGraph(
@@ -884,26 +1330,56 @@ void FlowGraphManager::UpdateFlowGraph(
     unordered_set<uint64_t>* marked_nodes) {
   CHECK_NOTNULL(node_queue);
   CHECK_NOTNULL(marked_nodes);
+  vector<TDOrNodeWrapper*> level;
+  vector<TaskID_t> unsched_task_ids;
+  vector<Cost_t> unsched_costs;
   while (!node_queue->empty()) {
-    TDOrNodeWrapper* cur_node = node_queue->front();
-    node_queue->pop();
-    if (!cur_node->node_) {
-      // We're handling a task that doesn't have an associated flow graph node.
-      UpdateChildrenTasks(cur_node->td_ptr_, node_queue, marked_nodes);
-      delete cur_node;
-      continue;
+    // We process the queue one BFS level at a time. This allows us to compute
+    // the costs of the level's unscheduled tasks to their unscheduled
+    // aggregators in a single batch. The nodes that the level adds to the
+    // queue form the next level.
+    level.clear();
+    unsched_task_ids.clear();
+    while (!node_queue->empty()) {
+      TDOrNodeWrapper* cur_node = node_queue->front();
+      node_queue->pop();
+      level.push_back(cur_node);
+      if (cur_node->node_ && cur_node->node_->IsTaskNode() &&
+          !cur_node->node_->IsTaskAssignedOrRunning()) {
+        unsched_task_ids.push_back(cur_node->td_ptr_->uid());
+      }
     }
-    if (cur_node->node_->IsTaskNode()) {
-      UpdateTaskNode(cur_node->node_, node_queue, marked_nodes);
-      UpdateChildrenTasks(cur_node->td_ptr_, node_queue, marked_nodes);
-    } else if (cur_node->node_->IsEquivalenceClassNode()) {
-      UpdateEquivClassNode(cur_node->node_, node_queue, marked_nodes);
-    } else if (cur_node->node_->IsResourceNode()) {
-      UpdateResourceNode(cur_node->node_, node_queue, marked_nodes);
-    } else {
-      LOG(FATAL) << "Unexpected node type: " << cur_node->node_->type_;
+    cost_model_->TaskToUnscheduledAggCosts(unsched_task_ids, &unsched_costs);
+    uint64_t unsched_index = 0;
+    for (auto& cur_node : level) {
+      if (!cur_node->node_) {
+        // We're handling a task that doesn't have an associated flow graph
+        // node.
+        UpdateChildrenTasks(cur_node->td_ptr_, node_queue, marked_nodes);
+        delete cur_node;
+        continue;
+      }
+      if (cur_node->node_->IsTaskNode()) {
+        if (cur_node->node_->IsTaskAssignedOrRunning()) {
+          UpdateRunningTaskNode(cur_node->node_,
+                                FLAGS_update_preferences_running_task,
+                                node_queue, marked_nodes);
+        } else {
+          UpdateUnscheduledTaskNode(cur_node->node_,
+                                    unsched_costs[unsched_index++],
+                                    node_queue, marked_nodes);
+        }
+        UpdateChildrenTasks(cur_node->td_ptr_, node_queue, marked_nodes);
+      } else if (cur_node->node_->IsEquivalenceClassNode()) {
+        UpdateEquivClassNode(cur_node->node_, node_queue, marked_nodes);
+      } else if (cur_node->node_->IsResourceNode()) {
+        UpdateResourceNode(cur_node->node_, node_queue, marked_nodes);
+      } else {
+        LOG(FATAL) << "Unexpected node type: " << cur_node->node_->type_;
+      }
+      delete cur_node;
     }
-    delete cur_node;
+    CHECK_EQ(unsched_index, unsched_task_ids.size());
   }
 }
 
@@ -1027,16 +1503,13 @@ void FlowGraphManager::UpdateResOutgoingArcs(
   CHECK_NOTNULL(res_node);
   CHECK_NOTNULL(node_queue);
   CHECK_NOTNULL(marked_nodes);
-  for (unordered_map<uint64_t, FlowGraphArc*>::iterator it =
-         res_node->outgoing_arc_map_.begin();
-       it != res_node->outgoing_arc_map_.end(); ) {
-    FlowGraphArc* arc = it->second;
-    ++it;
+  for (uint64_t index = res_node->outgoing_arcs_.size(); index > 0; ) {
+    FlowGraphArc* arc = res_node->outgoing_arcs_[--index];
     if (!arc->dst_node_->resource_id_.is_nil()) {
       graph_change_manager_->ChangeArcCost(
           arc,
-          cost_model_->ResourceNodeToResourceNodeCost(*res_node->rd_ptr_,
-                                                      *arc->dst_node_->rd_ptr_),
+          cost_model_->ResourceNodeToResourceNodeCostForNodes(
+              *res_node, *arc->dst_node_),
           CHG_ARC_BETWEEN_RES, "UpdateResOutgoingArcs");
       if (marked_nodes->find(arc->dst_node_->id_) == marked_nodes->end()) {
         // Add the dst node to the queue if it hasn't been marked yet.
@@ -1101,7 +1574,7 @@ void FlowGraphManager::UpdateRunningTaskToUnscheduledAggArc(
     FlowGraphNode* task_node) {
   CHECK(FLAGS_preemption) << "Arc to unscheduled doesn't exist for running task"
                           << " when preemption is not enabled";
-  FlowGraphNode* unsched_agg_node = UnschedAggNodeForJobID(task_node->job_id_);
+  FlowGraphNode* unsched_agg_node = UnschedAggNodeForTaskNode(task_node);
   CHECK_NOTNULL(unsched_agg_node);
   FlowGraphArc* unsched_arc =
     graph_change_manager_->mutable_flow_graph()->GetArc(task_node,
@@ -1120,9 +1593,10 @@ void FlowGraphManager::UpdateTaskNode(FlowGraphNode* task_node,
     UpdateRunningTaskNode(task_node, FLAGS_update_preferences_running_task,
                           node_queue, marked_nodes);
   } else {
-    UpdateTaskToUnscheduledAggArc(task_node);
-    UpdateTaskToEquivArcs(task_node, node_queue, marked_nodes);
-    UpdateTaskToResArcs(task_node, node_queue, marked_nodes);
+    UpdateUnscheduledTaskNode(
+        task_node,
+        cost_model_->TaskToUnscheduledAggCost(task_node->td_ptr_->uid()),
+        node_queue, marked_nodes);
   }
 }
 
@@ -1133,17 +1607,22 @@ void FlowGraphManager::UpdateTaskToEquivArcs(
   CHECK_NOTNULL(task_node);
   CHECK_NOTNULL(node_queue);
   CHECK_NOTNULL(marked_nodes);
-  vector<EquivClass_t>* pref_ec =
-    cost_model_->GetTaskEquivClasses(task_node->td_ptr_->uid());
-  if (pref_ec) {
-    for (auto& pref_ec_id : *pref_ec) {
-      FlowGraphNode* pref_ec_node = NodeForEquivClass(pref_ec_id);
+  vector<EquivClass_t>* pref_ec = &pref_ecs_buffer_;
+  cost_model_->FillTaskEquivClasses(task_node->td_ptr_->uid(), pref_ec);
+  vector<pair<TaskID_t, EquivClass_t>>* task_ecs = &task_ecs_buffer_;
+  task_ecs->clear();
+  for (auto& pref_ec_id : *pref_ec) {
+    task_ecs->push_back(make_pair(task_node->td_ptr_->uid(), pref_ec_id));
+  }
+  if (!task_ecs->empty()) {
+    vector<Cost_t>* costs = &costs_buffer_;
+    cost_model_->TaskToEquivClassAggregatorCosts(*task_ecs, costs);
+    for (uint64_t index = 0; index < pref_ec->size(); ++index) {
+      FlowGraphNode* pref_ec_node = NodeForEquivClass((*pref_ec)[index]);
       if (!pref_ec_node) {
-        pref_ec_node = AddEquivClassNode(pref_ec_id);
+        pref_ec_node = AddEquivClassNode((*pref_ec)[index]);
       }
-      Cost_t new_cost =
-        cost_model_->TaskToEquivClassAggregator(task_node->td_ptr_->uid(),
-                                                pref_ec_id);
+      Cost_t new_cost = (*costs)[index];
       FlowGraphArc* pref_ec_arc =
         graph_change_manager_->mutable_flow_graph()->GetArc(task_node,
                                                             pref_ec_node);
@@ -1165,13 +1644,8 @@ void FlowGraphManager::UpdateTaskToEquivArcs(
             new TDOrNodeWrapper(pref_ec_node, pref_ec_node->td_ptr_));
       }
     }
-    RemoveInvalidECPrefArcs(*task_node, *pref_ec, DEL_ARC_TASK_TO_EQUIV_CLASS);
-    delete pref_ec;
-  } else {
-    vector<EquivClass_t> no_pref_ec;
-    RemoveInvalidECPrefArcs(*task_node, no_pref_ec,
-                            DEL_ARC_TASK_TO_EQUIV_CLASS);
   }
+  RemoveInvalidECPrefArcs(*task_node, *pref_ec, DEL_ARC_TASK_TO_EQUIV_CLASS);
 }
 
 void FlowGraphManager::UpdateTaskToResArcs(
@@ -1181,17 +1655,22 @@ void FlowGraphManager::UpdateTaskToResArcs(
   CHECK_NOTNULL(task_node);
   CHECK_NOTNULL(node_queue);
   CHECK_NOTNULL(marked_nodes);
-  vector<ResourceID_t>* pref_res =
-    cost_model_->GetTaskPreferenceArcs(task_node->td_ptr_->uid());
-  if (pref_res) {
-    for (auto& pref_res_id : *pref_res) {
-      FlowGraphNode* pref_res_node = NodeForResourceID(pref_res_id);
+  vector<ResourceID_t>* pref_res = &pref_res_buffer_;
+  cost_model_->FillTaskPreferenceArcs(task_node->td_ptr_->uid(), pref_res);
+  vector<pair<TaskID_t, ResourceID_t>>* task_res = &task_res_buffer_;
+  task_res->clear();
+  for (auto& pref_res_id : *pref_res) {
+    task_res->push_back(make_pair(task_node->td_ptr_->uid(), pref_res_id));
+  }
+  if (!task_res->empty()) {
+    vector<Cost_t>* costs = &costs_buffer_;
+    cost_model_->TaskToResourceNodeCosts(*task_res, costs);
+    for (uint64_t index = 0; index < pref_res->size(); ++index) {
+      FlowGraphNode* pref_res_node = NodeForResourceID((*pref_res)[index]);
       // The resource node should already exist because the cost models cannot
       // prefer a resource before it is added to the graph.
       CHECK_NOTNULL(pref_res_node);
-      Cost_t new_cost =
-        cost_model_->TaskToResourceNodeCost(task_node->td_ptr_->uid(),
-                                            pref_res_id);
+      Cost_t new_cost = (*costs)[index];
       FlowGraphArc* pref_res_arc =
         graph_change_manager_->mutable_flow_graph()->GetArc(task_node,
                                                             pref_res_node);
@@ -1214,23 +1693,27 @@ void FlowGraphManager::UpdateTaskToResArcs(
             new TDOrNodeWrapper(pref_res_node, pref_res_node->td_ptr_));
       }
     }
-    RemoveInvalidPrefResArcs(*task_node, *pref_res, DEL_ARC_TASK_TO_RES);
-    delete pref_res;
-  } else {
-    vector<ResourceID_t> no_pref_res;
-    RemoveInvalidPrefResArcs(*task_node, no_pref_res, DEL_ARC_TASK_TO_RES);
   }
+  RemoveInvalidPrefResArcs(*task_node, *pref_res, DEL_ARC_TASK_TO_RES);
 }
 
 FlowGraphNode* FlowGraphManager::UpdateTaskToUnscheduledAggArc(
     FlowGraphNode* task_node) {
   CHECK_NOTNULL(task_node);
-  FlowGraphNode* unsched_agg_node = UnschedAggNodeForJobID(task_node->job_id_);
+  return UpdateTaskToUnscheduledAggArc(
+      task_node,
+      cost_model_->TaskToUnscheduledAggCost(task_node->td_ptr_->uid()));
+}
+
+FlowGraphNode* FlowGraphManager::UpdateTaskToUnscheduledAggArc(
+    FlowGraphNode* task_node,
+    Cost_t new_cost) {
+  CHECK_NOTNULL(task_node);
+  FlowGraphNode* unsched_agg_node = UnschedAggNodeForTaskNode(task_node);
   if (!unsched_agg_node) {
     unsched_agg_node = AddUnscheduledAggNode(task_node->job_id_);
+    task_node->job_handle_ = unsched_agg_node->job_handle_;
   }
-  Cost_t new_cost =
-    cost_model_->TaskToUnscheduledAggCost(task_node->td_ptr_->uid());
   FlowGraphArc* to_unsched_arc =
     graph_change_manager_->mutable_flow_graph()->GetArc(task_node,
                                                         unsched_agg_node);
@@ -1251,6 +1734,17 @@ void FlowGraphManager::UpdateTimeDependentCosts(
   AddOrUpdateJobNodes(jd_ptr_vec);
 }
 
+void FlowGraphManager::UpdateUnscheduledTaskNode(
+    FlowGraphNode* task_node,
+    Cost_t unsched_agg_cost,
+    queue<TDOrNodeWrapper*>* node_queue,
+    unordered_set<uint64_t>* marked_nodes) {
+  CHECK_NOTNULL(task_node);
+  UpdateTaskToUnscheduledAggArc(task_node, unsched_agg_cost);
+  UpdateTaskToEquivArcs(task_node, node_queue, marked_nodes);
+  UpdateTaskToResArcs(task_node, node_queue, marked_nodes);
+}
+
 void FlowGraphManager::UpdateUnscheduledAggNode(
     FlowGraphNode* unsched_agg_node, int64_t cap_delta) {
   CHECK_NOTNULL(unsched_agg_node);
@@ -21,6 +21,7 @@
 #ifndef FIRMAMENT_SCHEDULING_FLOW_FLOW_GRAPH_MANAGER_H
 #define FIRMAMENT_SCHEDULING_FLOW_FLOW_GRAPH_MANAGER_H
 
+#include <atomic>
 #include <queue>
 #include <set>
 #include <string>
@@ -29,10 +30,12 @@
 #include "base/common.h"
 #include "base/types.h"
 #include "base/resource_topology_node_desc.pb.h"
+#include "misc/id_interner.h"
 #include "misc/map-util.h"
 #include "misc/time_interface.h"
 #include "misc/trace_generator.h"
 #include "scheduling/scheduling_delta.pb.h"
+#include "scheduling/solver_state.pb.h"
 #include "scheduling/flow/cost_model_interface.h"
 #include "scheduling/flow/dimacs_change.h"
 #include "scheduling/flow/dimacs_change_stats.h"
@@ -55,6 +58,10 @@ struct TDOrNodeWrapper {
   TaskDescriptor* td_ptr_;
 };
 
+typedef IDInterner<ResourceID_t, boost::hash<boost::uuids::uuid> >
+  ResourceIDInterner;
+typedef IDInterner<JobID_t, boost::hash<boost::uuids::uuid> > JobIDInterner;
+
 class FlowGraphManager {
  public:
   explicit FlowGraphManager(CostModelInterface* cost_model,
@@ -74,12 +81,72 @@ class FlowGraphManager {
    */
   void AddResourceTopology(ResourceTopologyNodeDescriptor* rtnd_ptr);
 
+  /**
+   * Recomputes the statistics of the resources that have been marked as dirty
+   * since the last traversal, and of all their ancestors. The callbacks are
+   * only invoked on resource nodes and on the arcs connecting them to their
+   * children and to the sink. The statistics of all the other resources are
+   * left as they were computed in a previous traversal.
+   * @param prepare called on every dirty node before any statistics are
+   * gathered into it
+   * @param gather called on every arc from a dirty node to accumulate the
+   * statistics of the arc's destination into its source
+   * @param update called on every arc after gather
+   */
+  void ComputeDirtyTopologyStatistics(
+      boost::function<void(FlowGraphNode*)> prepare,
+      boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> gather,
+      boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> update);
+
+  /**
+   * Traverses the flow graph from node upwards and invokes the callbacks on
+   * every pair of connected nodes.
+   * @param node the node from which to start the traversal (usually the sink)
+   * @param prepare called on every node before any statistics are gathered
+   * into it
+   * @param gather called on every arc to accumulate the statistics of the
+   * arc's destination into its source
+   * @param update called on every arc after gather
+   * @param thread_safe true if the callbacks can be invoked concurrently for
+   * nodes in different machines' subtrees. If so, and
+   * --topology_stats_threads is set, the machines' statistics are computed in
+   * parallel.
+   */
   void ComputeTopologyStatistics(
       FlowGraphNode* node,
       boost::function<void(FlowGraphNode*)> prepare,
       boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> gather,
-      boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> update);
+      boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> update,
+      bool thread_safe);
   void JobCompleted(JobID_t job_id);
+
+  /**
+   * Returns the handle of the machine a resource belongs to. Cost models
+   * should use this method with the resource_handle_ of the nodes they are
+   * given, or with the handle cached on the ResourceStatus, rather than look
+   * up the resource by ID.
+   * @param res_handle the handle of a resource in or below a machine
+   * @return the handle of the machine resource
+   */
+  uint32_t MachineHandleForResource(uint32_t res_handle) const;
+
+  /**
+   * Returns the ID of the machine a resource belongs to. The machine is
+   * looked up by the resource's dense handle, rather than by walking up the
+   * resource topology in the resource map.
+   * @param res_id the ID of a resource in or below a machine
+   * @return the ID of the machine resource
+   */
+  ResourceID_t MachineResIDForResource(const ResourceID_t& res_id) const;
+
+  /**
+   * Marks the statistics of a resource as out of date. They are recomputed
+   * in the next call to ComputeDirtyTopologyStatistics.
+   * @param res_id the ID of the resource
+   * @param subtree true if the statistics of all the resources below res_id
+   * are out of date as well
+   */
+  void MarkResourceDirty(ResourceID_t res_id, bool subtree);
   void NodeBindingToSchedulingDeltas(
       uint64_t task_node_id, uint64_t resource_node_id,
       unordered_map<TaskID_t, ResourceID_t>* task_bindings,
@@ -94,6 +161,13 @@ class FlowGraphManager {
    */
   void PurgeUnconnectedEquivClassNodes();
 
+  /**
+   * Caches the handle of a resource that has a node on its ResourceStatus,
+   * and makes the status available by handle.
+   * @param rs_ptr the status of the resource
+   */
+  void RegisterResourceStatus(ResourceStatus* rs_ptr);
+
   /**
    * Removes the entire resource topology tree rooted at rd. The method also
    * updates the statistics of the nodes up to the root resource.
@@ -103,14 +177,39 @@ class FlowGraphManager {
    */
   void RemoveResourceTopology(const ResourceDescriptor& rd,
                               set<uint64_t>* pus_removed);
+
+  /**
+   * Maps a solver's warm-start state saved by SaveSolverState onto the nodes
+   * of the current flow graph. The state of the nodes that are no longer in
+   * the graph is dropped.
+   * @param solver_state the saved state
+   * @param potentials set to the node potentials, indexed by node id
+   * @param flow set to the flow, indexed by destination and then by source
+   * node id
+   */
+  void RestoreSolverState(
+      const SolverState& solver_state, vector<int64_t>* potentials,
+      vector<unordered_map<uint64_t, uint64_t>>* flow) const;
+
+  /**
+   * Saves a solver's warm-start state such that it can be restored after the
+   * flow graph has been rebuilt with different node ids.
+   * @param potentials the node potentials, indexed by node id
+   * @param flow the flow, indexed by destination and then by source node id
+   * @param solver_state the state to add the nodes and the flow to
+   */
+  void SaveSolverState(
+      const vector<int64_t>& potentials,
+      const vector<unordered_map<uint64_t, uint64_t>>& flow,
+      SolverState* solver_state) const;
   void SchedulingDeltasForPreemptedTasks(
       const multimap<uint64_t, uint64_t>& task_mappings,
       shared_ptr<ResourceMap_t> resource_map,
       vector<SchedulingDelta*>* deltas);
   uint64_t TaskCompleted(TaskID_t task_id);
   void TaskEvicted(TaskID_t task_id, ResourceID_t res_id);
-  void TaskFailed(TaskID_t task_id);
-  void TaskKilled(TaskID_t task_id);
+  uint64_t TaskFailed(TaskID_t task_id);
+  uint64_t TaskKilled(TaskID_t task_id);
   void TaskMigrated(TaskID_t task_id,
                     ResourceID_t old_res_id,
                     ResourceID_t new_res_id);
@@ -129,6 +228,21 @@ class FlowGraphManager {
   inline FlowGraphChangeManager* flow_graph_change_manager() {
     return graph_change_manager_;
   }
+  inline FlowGraphNode* NodeForResourceHandle(uint32_t res_handle) const {
+    return resource_nodes_[res_handle];
+  }
+  inline const ResourceID_t& ResourceIDForHandle(uint32_t res_handle) const {
+    return resource_handles_.IDForHandle(res_handle);
+  }
+  // Returns the handle of a resource, or ResourceIDInterner::kInvalidHandle
+  // if the resource has no node.
+  inline uint32_t ResourceHandle(const ResourceID_t& res_id) const {
+    return resource_handles_.Lookup(res_id);
+  }
+  // Returns NULL if the status of the resource has not been registered.
+  inline ResourceStatus* ResourceStatusForHandle(uint32_t res_handle) const {
+    return resource_statuses_[res_handle];
+  }
   inline const unordered_set<uint64_t>& leaf_node_ids() const {
     return leaf_nodes_;
   }
@@ -145,16 +259,20 @@ class FlowGraphManager {
   FRIEND_TEST(FlowGraphManagerTest, AddResourceTopologyDFS);
   FRIEND_TEST(FlowGraphManagerTest, AddTaskNode);
   FRIEND_TEST(FlowGraphManagerTest, AddUnscheduledAggNode);
+  FRIEND_TEST(FlowGraphManagerTest, MachineResIDForResource);
   FRIEND_TEST(FlowGraphManagerTest, PinTaskToNode);
   FRIEND_TEST(FlowGraphManagerTest, RemoveEquivClassNode);
   FRIEND_TEST(FlowGraphManagerTest, RemoveInvalidECPrefArcs);
   FRIEND_TEST(FlowGraphManagerTest, RemoveInvalidPrefResArcs);
+  FRIEND_TEST(FlowGraphManagerTest, RemoveInvalidPrefResArcsUnsorted);
   FRIEND_TEST(FlowGraphManagerTest, RemoveResourceNode);
+  FRIEND_TEST(FlowGraphManagerTest, SaveAndRestoreSolverState);
   FRIEND_TEST(FlowGraphManagerTest, TraverseAndRemoveTopology);
   FRIEND_TEST(FlowGraphManagerTest, UpdateArcsForScheduledTask);
   FRIEND_TEST(FlowGraphManagerTest, UpdateChildrenTasks);
   FRIEND_TEST(FlowGraphManagerTest, UpdateEquivClassNode);
   FRIEND_TEST(FlowGraphManagerTest, UpdateEquivToEquivArcs);
+  FRIEND_TEST(FlowGraphManagerTest, UpdateEquivToEquivArcsReusesBuffers);
   FRIEND_TEST(FlowGraphManagerTest, UpdateEquivToResArcs);
   FRIEND_TEST(FlowGraphManagerTest, UpdateFlowGraph);
   FRIEND_TEST(FlowGraphManagerTest, UpdateResourceStatsUpToRoot);
@@ -184,6 +302,46 @@ class FlowGraphManager {
   FlowGraphNode* AddTaskNode(JobID_t job_id, TaskDescriptor* td_ptr);
   FlowGraphNode* AddUnscheduledAggNode(JobID_t job_id);
   uint64_t CapacityFromResNodeToParent(const ResourceDescriptor& rd);
+
+  /**
+   * Adds to res_nodes all the resource nodes in res_node's subtree that are
+   * not already marked with subtree_mark, and marks them.
+   */
+  void CollectDirtySubtree(FlowGraphNode* res_node, uint32_t subtree_mark,
+                           vector<FlowGraphNode*>* res_nodes);
+
+  /**
+   * Computes the statistics of the subtrees rooted at machine_nodes. It's
+   * invoked concurrently by several threads, which take machines from
+   * machine_nodes until next_machine has gone past its end.
+   * @param subtree_nodes the nodes of the subtrees this thread visited
+   */
+  void ComputeMachineStatistics(
+      const vector<FlowGraphNode*>& machine_nodes,
+      uint32_t subtree_mark,
+      const boost::function<void(FlowGraphNode*)>& prepare,
+      const boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)>&
+        gather,
+      const boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)>&
+        update,
+      std::atomic<uint64_t>* next_machine,
+      vector<FlowGraphNode*>* subtree_nodes);
+  void ComputeMachineSubtreeStatistics(
+      FlowGraphNode* machine_node,
+      uint32_t subtree_mark,
+      const boost::function<void(FlowGraphNode*)>& prepare,
+      const boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)>&
+        gather,
+      const boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)>&
+        update,
+      vector<FlowGraphNode*>* subtree_nodes);
+  void MarkResourceNodeDirty(FlowGraphNode* res_node, bool subtree);
+
+  /**
+   * Marks the resource on which a task is running as dirty. It must be called
+   * before the task's running arc is removed.
+   */
+  void MarkTaskResourceDirty(TaskID_t task_id);
   void PinTaskToNode(FlowGraphNode* task_node, FlowGraphNode* res_node);
   void RemoveEquivClassNode(FlowGraphNode* ec_node);
 
@@ -212,6 +370,14 @@ class FlowGraphManager {
   uint64_t RemoveTaskNode(FlowGraphNode* task_node);
   void RemoveUnscheduledAggNode(JobID_t job_id);
 
+  /**
+   * Sets node_state to identify the node by what it represents.
+   * @return false if the node is of a kind that SolverState cannot identify
+   */
+  bool SetSolverNodeState(const FlowGraphNode& node,
+                          SolverNodeState* node_state) const;
+  static string SolverNodeKey(const SolverNodeState& node_state);
+
   /**
    * Remove the resource topology rooted at res_node.
    * @param res_node the root of the topology tree to remove
@@ -345,6 +511,16 @@ class FlowGraphManager {
    */
   FlowGraphNode* UpdateTaskToUnscheduledAggArc(FlowGraphNode* task_node);
 
+  /**
+   * Same as above, but uses a cost that has already been computed (e.g., as
+   * part of a batch).
+   * @param task_node the node for which to update the arc
+   * @param new_cost the cost of the arc to the unscheduled aggregator
+   * @return the unscheduled aggregator node
+   */
+  FlowGraphNode* UpdateTaskToUnscheduledAggArc(FlowGraphNode* task_node,
+                                               Cost_t new_cost);
+
   /**
    * Adjusts the capacity of the arc connecting the unscheduled agg to the sink
    * by cap_delta. The method also updates the cost if need be.
@@ -354,13 +530,27 @@ class FlowGraphManager {
   void UpdateUnscheduledAggNode(FlowGraphNode* unsched_agg_node,
                                 int64_t cap_delta);
 
+  /**
+   * Updates the outgoing arcs of a task that is neither assigned nor running.
+   * @param task_node the node of the task
+   * @param unsched_agg_cost the cost of the arc to the unscheduled aggregator
+   */
+  void UpdateUnscheduledTaskNode(FlowGraphNode* task_node,
+                                 Cost_t unsched_agg_cost,
+                                 queue<TDOrNodeWrapper*>* node_queue,
+                                 unordered_set<uint64_t>* marked_nodes);
+
   void VisitTopologyChildren(ResourceTopologyNodeDescriptor* rtnd_ptr);
 
   inline FlowGraphNode* NodeForEquivClass(const EquivClass_t& ec) {
     return FindPtrOrNull(tec_to_node_map_, ec);
   }
   inline FlowGraphNode* NodeForResourceID(const ResourceID_t& res_id) {
-    return FindPtrOrNull(resource_to_node_map_, res_id);
+    uint32_t handle = resource_handles_.Lookup(res_id);
+    if (handle == ResourceIDInterner::kInvalidHandle) {
+      return NULL;
+    }
+    return resource_nodes_[handle];
   }
   inline FlowGraphNode* NodeForTaskID(TaskID_t task_id) {
     return FindPtrOrNull(task_to_node_map_, task_id);
@@ -371,24 +561,55 @@ class FlowGraphManager {
       td.state() == TaskDescriptor::ASSIGNED;
   }
   inline FlowGraphNode* UnschedAggNodeForJobID(JobID_t job_id) {
-    return FindPtrOrNull(job_unsched_to_node_, job_id);
+    uint32_t handle = job_handles_.Lookup(job_id);
+    if (handle == JobIDInterner::kInvalidHandle) {
+      return NULL;
+    }
+    return unsched_agg_nodes_[handle];
+  }
+  inline FlowGraphNode* UnschedAggNodeForTaskNode(FlowGraphNode* task_node) {
+    uint32_t handle = task_node->job_handle_;
+    if (handle < unsched_agg_nodes_.size() && unsched_agg_nodes_[handle] &&
+        unsched_agg_nodes_[handle]->job_id_ == task_node->job_id_) {
+      return unsched_agg_nodes_[handle];
+    }
+    // The cached handle is stale.
+    FlowGraphNode* unsched_agg_node =
+      UnschedAggNodeForJobID(task_node->job_id_);
+    if (unsched_agg_node) {
+      task_node->job_handle_ = unsched_agg_node->job_handle_;
+    }
+    return unsched_agg_node;
   }
 
   // Resource and task mappings
   unordered_map<TaskID_t, FlowGraphNode*> task_to_node_map_;
-  unordered_map<ResourceID_t, FlowGraphNode*,
-      boost::hash<boost::uuids::uuid> > resource_to_node_map_;
+  // Dense handles of the resources that have nodes. The per-resource state
+  // below is stored in vectors indexed by handle.
+  ResourceIDInterner resource_handles_;
+  // The node of every resource, or NULL if the handle is unused.
+  vector<FlowGraphNode*> resource_nodes_;
+  // The handle of the machine every resource belongs to, or kInvalidHandle
+  // for the resources above the machines.
+  vector<uint32_t> machine_handles_;
+  // The status of every resource, or NULL if it has not been registered.
+  vector<ResourceStatus*> resource_statuses_;
   // Mapping storing flow graph node for each task equivalence class.
   unordered_map<EquivClass_t, FlowGraphNode*> tec_to_node_map_;
-  // Mapping storing flow graph node for each unscheduled aggregator.
-  unordered_map<JobID_t, FlowGraphNode*,
-      boost::hash<boost::uuids::uuid> > job_unsched_to_node_;
+  // Dense handles of the jobs that have unscheduled aggregators.
+  JobIDInterner job_handles_;
+  // The unscheduled aggregator of every job, or NULL if the handle is unused.
+  vector<FlowGraphNode*> unsched_agg_nodes_;
 
   // The "node ID" for the job is currently the ID of the job's unscheduled node
   unordered_set<uint64_t> leaf_nodes_;
   // Map storing the running arc for every task that is running.
   unordered_map<TaskID_t, FlowGraphArc*> task_to_running_arc_;
   unordered_map<FlowGraphNode*, FlowGraphNode*> node_to_parent_node_map_;
+  // Resource nodes whose statistics must be recomputed in the next
+  // ComputeDirtyTopologyStatistics call. The value is true if the statistics
+  // of the node's entire subtree must be recomputed.
+  unordered_map<FlowGraphNode*, bool> dirty_res_nodes_;
   FlowGraphNode* sink_node_;
   CostModelInterface* cost_model_;
   FlowGraphChangeManager* graph_change_manager_;
@@ -399,6 +620,21 @@ class FlowGraphManager {
   // used as a marker in the resource topology traversal. It helps us to avoid
   // having to reset the visited state before each traversal.
   uint32_t cur_traversal_counter_;
+  // Scratch buffers reused across the Update*Arcs and RemoveInvalid*Arcs
+  // calls. They avoid allocating vectors and hash sets for every node we
+  // visit while updating the flow graph. None of these methods are
+  // re-entrant, so a single set of buffers suffices.
+  vector<EquivClass_t> pref_ecs_buffer_;
+  vector<ResourceID_t> pref_res_buffer_;
+  vector<pair<TaskID_t, EquivClass_t>> task_ecs_buffer_;
+  vector<pair<TaskID_t, ResourceID_t>> task_res_buffer_;
+  vector<pair<EquivClass_t, EquivClass_t>> ec_ecs_buffer_;
+  vector<pair<EquivClass_t, ResourceID_t>> ec_res_buffer_;
+  vector<Cost_t> costs_buffer_;
+  vector<pair<Cost_t, uint64_t>> costs_and_caps_buffer_;
+  vector<EquivClass_t> sorted_pref_ecs_;
+  vector<ResourceID_t> sorted_pref_res_;
+  vector<FlowGraphArc*> arcs_to_delete_;
 };
 
 }  // namespace firmament
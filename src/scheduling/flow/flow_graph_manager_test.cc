@@ -22,9 +22,11 @@
 #include <gtest/gtest.h>
 
 #include "base/common.h"
+#include "base/units.h"
 #include "misc/map-util.h"
 #include "misc/wall_time.h"
 #include "misc/utils.h"
+#include "scheduling/flow/coco_cost_model.h"
 #include "scheduling/flow/dimacs_add_node.h"
 #include "scheduling/flow/dimacs_change_arc.h"
 #include "scheduling/flow/dimacs_change_stats.h"
@@ -36,9 +38,12 @@
 #include "scheduling/flow/mock_cost_model.h"
 #include "scheduling/flow/trivial_cost_model.h"
 #include "scheduling/flow/void_cost_model.h"
+#include "scheduling/knowledge_base.h"
 
 DECLARE_string(flow_scheduling_solver);
+DECLARE_uint64(max_tasks_per_pu);
 DECLARE_uint64(num_pref_arcs_task_to_res);
+DECLARE_uint64(topology_stats_threads);
 
 using ::testing::_;
 
@@ -103,6 +108,31 @@ class FlowGraphManagerTest : public ::testing::Test {
     return rd_ptr;
   }
 
+  // Creates a coordinator with num_machines machines, each of which has
+  // num_pus PUs.
+  void CreateTopology(ResourceTopologyNodeDescriptor* rtnd_ptr,
+                      uint64_t num_machines, uint64_t num_pus) {
+    ResourceID_t root_res_id = GenerateResourceID("test");
+    rtnd_ptr->mutable_resource_desc()->set_uuid(to_string(root_res_id));
+    rtnd_ptr->mutable_resource_desc()->set_type(
+        ResourceDescriptor::RESOURCE_COORDINATOR);
+    for (uint64_t machine = 0; machine < num_machines; ++machine) {
+      ResourceTopologyNodeDescriptor* rtn_machine = rtnd_ptr->add_children();
+      CreateMachine(rtn_machine, "machine" + to_string(machine));
+      rtn_machine->set_parent_id(to_string(root_res_id));
+      for (uint64_t pu = 0; pu < num_pus; ++pu) {
+        ResourceTopologyNodeDescriptor* rtn_pu = rtn_machine->add_children();
+        ResourceID_t pu_res_id =
+          GenerateResourceID("machine" + to_string(machine) + "-pu" +
+                             to_string(pu));
+        rtn_pu->mutable_resource_desc()->set_uuid(to_string(pu_res_id));
+        rtn_pu->mutable_resource_desc()->set_type(
+            ResourceDescriptor::RESOURCE_PU);
+        rtn_pu->set_parent_id(rtn_machine->resource_desc().uuid());
+      }
+    }
+  }
+
   TaskDescriptor* CreateTask(JobDescriptor* jd_ptr, uint64_t job_id_seed) {
     JobID_t job_id = GenerateJobID(job_id_seed);
     jd_ptr->set_uuid(to_string(job_id));
@@ -159,7 +189,7 @@ TEST_F(FlowGraphManagerTest, AddResourceNode) {
   CHECK_NOTNULL(res_node);
   EXPECT_EQ(res_node->resource_id_, res_id);
   EXPECT_EQ(res_node->rd_ptr_, rd_ptr);
-  EXPECT_EQ(FindPtrOrNull(graph_manager->resource_to_node_map_,
+  EXPECT_EQ(graph_manager->NodeForResourceID(
                           res_node->resource_id_),
             res_node);
   EXPECT_EQ(num_nodes + 1,
@@ -178,7 +208,7 @@ TEST_F(FlowGraphManagerTest, AddResourceNode) {
   CHECK_NOTNULL(res_child_node);
   EXPECT_EQ(res_child_node->resource_id_, res_child_id);
   EXPECT_EQ(res_child_node->rd_ptr_, rd_child_ptr);
-  EXPECT_EQ(FindPtrOrNull(graph_manager->resource_to_node_map_,
+  EXPECT_EQ(graph_manager->NodeForResourceID(
                           res_child_node->resource_id_),
             res_child_node);
   EXPECT_NE(graph_manager->leaf_nodes_.find(res_child_node->id_),
@@ -227,7 +257,7 @@ TEST_F(FlowGraphManagerTest, AddUnscheduledAggNode) {
   JobID_t job_id = GenerateJobID(42);
   FlowGraphNode* unsched_agg_node =
     graph_manager->AddUnscheduledAggNode(job_id);
-  EXPECT_EQ(FindPtrOrNull(graph_manager->job_unsched_to_node_, job_id),
+  EXPECT_EQ(graph_manager->UnschedAggNodeForJobID(job_id),
             unsched_agg_node);
   EXPECT_EQ(num_nodes + 1,
             graph_manager->graph_change_manager_->flow_graph().NumNodes());
@@ -277,18 +307,334 @@ TEST_F(FlowGraphManagerTest, AddResourceTopologyDFS) {
   CHECK_NOTNULL(machine_node);
   FlowGraphNode* core_node = graph_manager->NodeForResourceID(core_res_id);
   CHECK_NOTNULL(core_node);
-  EXPECT_EQ(root_node->outgoing_arc_map_.size(), 2);
-  EXPECT_EQ(machine_node->incoming_arc_map_.size(), 1);
-  EXPECT_EQ(machine_node->outgoing_arc_map_.size(), 0);
-  EXPECT_EQ(core_node->incoming_arc_map_.size(), 1);
-  EXPECT_EQ(core_node->outgoing_arc_map_.size(), 1);
+  EXPECT_EQ(root_node->outgoing_arcs_.size(), 2);
+  EXPECT_EQ(machine_node->incoming_arcs_.size(), 1);
+  EXPECT_EQ(machine_node->outgoing_arcs_.size(), 0);
+  EXPECT_EQ(core_node->incoming_arcs_.size(), 1);
+  EXPECT_EQ(core_node->outgoing_arcs_.size(), 1);
   EXPECT_EQ(root_node->rd_ptr_->num_slots_below(), 1);
   EXPECT_EQ(root_node->rd_ptr_->num_running_tasks_below(), 0);
-  EXPECT_EQ(core_node->incoming_arc_map_.begin()->second->cap_upper_bound_, 1);
-  EXPECT_EQ(machine_node->incoming_arc_map_.begin()->second->cap_upper_bound_,
+  EXPECT_EQ(core_node->incoming_arcs_[0]->cap_upper_bound_, 1);
+  EXPECT_EQ(machine_node->incoming_arcs_[0]->cap_upper_bound_,
             0);
 }
 
+// Tests that every resource maps to its machine, and that the handles of
+// removed resources are reused.
+TEST_F(FlowGraphManagerTest, MachineResIDForResource) {
+  FlowGraphManager* graph_manager = CreateGraphManagerUsingTrivialCost();
+  ResourceTopologyNodeDescriptor rtnd;
+  CreateTopology(&rtnd, 2, 2);
+  graph_manager->AddResourceTopology(&rtnd);
+  for (auto& rtn_machine : rtnd.children()) {
+    ResourceID_t machine_res_id =
+      ResourceIDFromString(rtn_machine.resource_desc().uuid());
+    EXPECT_EQ(graph_manager->MachineResIDForResource(machine_res_id),
+              machine_res_id);
+    uint32_t machine_handle = graph_manager->ResourceHandle(machine_res_id);
+    EXPECT_EQ(graph_manager->NodeForResourceHandle(machine_handle)->
+              resource_handle_, machine_handle);
+    for (auto& rtn_pu : rtn_machine.children()) {
+      ResourceID_t pu_res_id =
+        ResourceIDFromString(rtn_pu.resource_desc().uuid());
+      EXPECT_EQ(graph_manager->MachineResIDForResource(pu_res_id),
+                machine_res_id);
+      EXPECT_EQ(graph_manager->MachineHandleForResource(
+                    graph_manager->ResourceHandle(pu_res_id)),
+                machine_handle);
+    }
+  }
+  // Cache the first machine's handle on its status.
+  ResourceTopologyNodeDescriptor* rtn_removed = rtnd.mutable_children(0);
+  ResourceID_t removed_res_id =
+    ResourceIDFromString(rtn_removed->resource_desc().uuid());
+  ResourceStatus removed_rs(removed_res_id,
+                            rtn_removed->mutable_resource_desc(), rtn_removed,
+                            "", 0);
+  graph_manager->RegisterResourceStatus(&removed_rs);
+  EXPECT_EQ(removed_rs.handle(),
+            graph_manager->ResourceHandle(removed_res_id));
+  EXPECT_EQ(graph_manager->ResourceStatusForHandle(removed_rs.handle()),
+            &removed_rs);
+  uint32_t handle_bound = graph_manager->resource_handles_.handle_bound();
+  EXPECT_EQ(handle_bound, 7U);
+  // Remove the first machine and add it again under a different ID.
+  set<uint64_t> pus_removed;
+  graph_manager->RemoveResourceTopology(rtnd.children(0).resource_desc(),
+                                        &pus_removed);
+  EXPECT_EQ(pus_removed.size(), 2U);
+  EXPECT_EQ(removed_rs.handle(), ResourceIDInterner::kInvalidHandle);
+  ResourceTopologyNodeDescriptor* rtn_machine = rtnd.mutable_children(0);
+  rtn_machine->clear_children();
+  ResourceDescriptor* machine_rd_ptr =
+    CreateMachine(rtn_machine, "machine-readded");
+  ResourceID_t machine_res_id = ResourceIDFromString(machine_rd_ptr->uuid());
+  EXPECT_TRUE(graph_manager->NodeForResourceID(machine_res_id) == NULL);
+  graph_manager->AddResourceTopology(rtn_machine);
+  EXPECT_EQ(graph_manager->MachineResIDForResource(machine_res_id),
+            machine_res_id);
+  EXPECT_EQ(graph_manager->resource_handles_.handle_bound(), handle_bound);
+  EXPECT_EQ(graph_manager->NodeForResourceID(machine_res_id)->resource_id_,
+            machine_res_id);
+  delete graph_manager;
+}
+
+// Counts the PrepareStats calls, i.e., the number of nodes that are
+// recomputed.
+static void CountPrepareStats(TrivialCostModel* cost_model,
+                              uint64_t* num_prepared,
+                              FlowGraphNode* accumulator) {
+  (*num_prepared)++;
+  cost_model->PrepareStats(accumulator);
+}
+
+TEST_F(FlowGraphManagerTest, ComputeDirtyTopologyStatistics) {
+  TrivialCostModel* cost_model =
+    new TrivialCostModel(resource_map_, task_map_, leaf_res_ids_);
+  FlowGraphManager* graph_manager =
+    new FlowGraphManager(cost_model, leaf_res_ids_, &wall_time_, tg_,
+                         &dimacs_stats_);
+  ResourceTopologyNodeDescriptor rtnd;
+  CreateTopology(&rtnd, 3, 2);
+  graph_manager->AddResourceTopology(&rtnd);
+  uint64_t num_prepared = 0;
+  boost::function<void(FlowGraphNode*)> prepare =
+    boost::bind(&CountPrepareStats, cost_model, &num_prepared, _1);
+  boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> gather =
+    boost::bind(&TrivialCostModel::GatherStats, cost_model, _1, _2);
+  boost::function<FlowGraphNode*(FlowGraphNode*, FlowGraphNode*)> update =
+    boost::bind(&TrivialCostModel::UpdateStats, cost_model, _1, _2);
+  // The newly added topology is dirty.
+  graph_manager->ComputeDirtyTopologyStatistics(prepare, gather, update);
+  CHECK_EQ(num_prepared, 10);
+  CHECK_EQ(rtnd.resource_desc().num_slots_below(),
+           6 * FLAGS_max_tasks_per_pu);
+  // Nothing changed.
+  num_prepared = 0;
+  graph_manager->ComputeDirtyTopologyStatistics(prepare, gather, update);
+  CHECK_EQ(num_prepared, 0);
+  // Start a task on a PU. Only the PU, its machine and the coordinator are
+  // recomputed.
+  ResourceDescriptor* pu_rd_ptr =
+    rtnd.mutable_children(1)->mutable_children(0)->mutable_resource_desc();
+  pu_rd_ptr->add_current_running_tasks(42);
+  graph_manager->MarkResourceDirty(ResourceIDFromString(pu_rd_ptr->uuid()),
+                                   false);
+  graph_manager->ComputeDirtyTopologyStatistics(prepare, gather, update);
+  CHECK_EQ(num_prepared, 3);
+  CHECK_EQ(pu_rd_ptr->num_running_tasks_below(), 1);
+  CHECK_EQ(rtnd.children(1).resource_desc().num_running_tasks_below(), 1);
+  CHECK_EQ(rtnd.resource_desc().num_running_tasks_below(), 1);
+  CHECK_EQ(rtnd.resource_desc().num_slots_below(),
+           6 * FLAGS_max_tasks_per_pu);
+  // A dirty machine subtree that contains a dirty PU.
+  num_prepared = 0;
+  graph_manager->MarkResourceDirty(ResourceIDFromString(pu_rd_ptr->uuid()),
+                                   false);
+  graph_manager->MarkResourceDirty(
+      ResourceIDFromString(rtnd.children(1).resource_desc().uuid()), true);
+  graph_manager->ComputeDirtyTopologyStatistics(prepare, gather, update);
+  CHECK_EQ(num_prepared, 4);
+  CHECK_EQ(rtnd.resource_desc().num_running_tasks_below(), 1);
+  // Remove a machine. Only the coordinator is recomputed.
+  num_prepared = 0;
+  set<uint64_t> pus_removed;
+  graph_manager->RemoveResourceTopology(rtnd.children(0).resource_desc(),
+                                        &pus_removed);
+  CHECK_EQ(pus_removed.size(), 2);
+  graph_manager->ComputeDirtyTopologyStatistics(prepare, gather, update);
+  CHECK_EQ(num_prepared, 1);
+  CHECK_EQ(rtnd.resource_desc().num_slots_below(),
+           4 * FLAGS_max_tasks_per_pu);
+  CHECK_EQ(rtnd.resource_desc().num_running_tasks_below(), 1);
+}
+
+// Adds every resource in the topology to the resource map.
+static void AddResourcesToMap(ResourceTopologyNodeDescriptor* rtnd_ptr,
+                              ResourceMap_t* resource_map) {
+  ResourceDescriptor* rd_ptr = rtnd_ptr->mutable_resource_desc();
+  ResourceID_t res_id = ResourceIDFromString(rd_ptr->uuid());
+  CHECK(InsertIfNotPresent(resource_map, res_id,
+                           new ResourceStatus(res_id, rd_ptr, rtnd_ptr,
+                                              "endpoint_uri", 0)));
+  for (auto& rtn_child : *rtnd_ptr->mutable_children()) {
+    AddResourcesToMap(&rtn_child, resource_map);
+  }
+}
+
+// Records the descriptor of every resource in the topology.
+static void CollectResourceStats(const ResourceTopologyNodeDescriptor& rtnd,
+                                 map<string, string>* stats) {
+  (*stats)[rtnd.resource_desc().uuid()] = rtnd.resource_desc().DebugString();
+  for (auto& rtn_child : rtnd.children()) {
+    CollectResourceStats(rtn_child, stats);
+  }
+}
+
+// Recomputes the statistics of the dirty resources the same way the
+// FlowScheduler does with --incremental_topology_stats, and checks that they
+// are identical to the statistics of a full recomputation.
+static void CheckDirtyStatisticsMatchFull(
+    FlowGraphManager* graph_manager,
+    CostModelInterface* cost_model,
+    KnowledgeBase* knowledge_base,
+    const ResourceTopologyNodeDescriptor& rtnd) {
+  vector<ResourceID_t> updated_machines;
+  knowledge_base->TakeUpdatedMachines(&updated_machines);
+  if (cost_model->StatsDependOnMachineSamples()) {
+    for (auto& res_id : updated_machines) {
+      graph_manager->MarkResourceDirty(res_id, true);
+    }
+  }
+  graph_manager->ComputeDirtyTopologyStatistics(
+      boost::bind(&CostModelInterface::PrepareStats, cost_model, _1),
+      boost::bind(&CostModelInterface::GatherStats, cost_model, _1, _2),
+      boost::bind(&CostModelInterface::UpdateStats, cost_model, _1, _2));
+  map<string, string> dirty_stats;
+  CollectResourceStats(rtnd, &dirty_stats);
+  graph_manager->ComputeTopologyStatistics(
+      graph_manager->sink_node(),
+      boost::bind(&CostModelInterface::PrepareStats, cost_model, _1),
+      boost::bind(&CostModelInterface::GatherStats, cost_model, _1, _2),
+      boost::bind(&CostModelInterface::UpdateStats, cost_model, _1, _2),
+      false);
+  map<string, string> full_stats;
+  CollectResourceStats(rtnd, &full_stats);
+  CHECK_EQ(dirty_stats.size(), full_stats.size());
+  for (auto& res_stats : full_stats) {
+    EXPECT_EQ(dirty_stats[res_stats.first], res_stats.second)
+      << "Statistics of " << res_stats.first << " differ";
+  }
+}
+
+TEST_F(FlowGraphManagerTest, ComputeDirtyTopologyStatisticsMatchesFull) {
+  ResourceTopologyNodeDescriptor rtnd;
+  CreateTopology(&rtnd, 3, 2);
+  for (auto& rtn_machine : *rtnd.mutable_children()) {
+    ResourceVector* capacity =
+      rtn_machine.mutable_resource_desc()->mutable_resource_capacity();
+    capacity->set_cpu_cores(2.0);
+    capacity->set_ram_cap(16384);
+    capacity->set_disk_bw(500);
+    capacity->set_net_tx_bw(1000);
+    capacity->set_net_rx_bw(1000);
+    for (int32_t pu = 0; pu < rtn_machine.children_size(); ++pu) {
+      rtn_machine.mutable_children(pu)->mutable_resource_desc()->
+        set_friendly_name("PU #" + to_string(pu));
+    }
+  }
+  AddResourcesToMap(&rtnd, resource_map_.get());
+  shared_ptr<KnowledgeBase> knowledge_base(new KnowledgeBase);
+  // The CoCo cost model's statistics depend on the machine samples and on
+  // the tasks running on the PUs.
+  CocoCostModel* cost_model =
+    new CocoCostModel(resource_map_, rtnd, task_map_, leaf_res_ids_,
+                      knowledge_base, &wall_time_);
+  shared_ptr<FlowGraphManager> graph_manager(
+      new FlowGraphManager(cost_model, leaf_res_ids_, &wall_time_, tg_,
+                           &dimacs_stats_));
+  cost_model->SetFlowGraphManager(graph_manager);
+  graph_manager->AddResourceTopology(&rtnd);
+  CheckDirtyStatisticsMatchFull(graph_manager.get(), cost_model,
+                                knowledge_base.get(), rtnd);
+  // Every machine sends a sample.
+  for (uint64_t machine = 0; machine < 3; ++machine) {
+    MachinePerfStatisticsSample sample;
+    sample.set_resource_id(rtnd.children(machine).resource_desc().uuid());
+    sample.set_free_ram(8192 * BYTES_TO_MB);
+    sample.set_disk_bw((100 + machine) * BYTES_TO_MB);
+    sample.set_net_tx_bw(200 * BYTES_TO_MB);
+    sample.set_net_rx_bw(300 * BYTES_TO_MB);
+    sample.add_cpus_usage()->set_idle(50.0);
+    sample.add_cpus_usage()->set_idle(80.0);
+    knowledge_base->AddMachineSample(sample);
+  }
+  CheckDirtyStatisticsMatchFull(graph_manager.get(), cost_model,
+                                knowledge_base.get(), rtnd);
+  CHECK_EQ(rtnd.children(2).resource_desc().available_resources().disk_bw(),
+           398);
+  // Place a task on the first PU of the first two machines.
+  JobDescriptor test_jobs[2];
+  ResourceDescriptor* pu_rd_ptrs[2];
+  for (uint64_t index = 0; index < 2; ++index) {
+    TaskDescriptor* td_ptr = CreateTask(&test_jobs[index], 42 + index);
+    td_ptr->set_task_type(index == 0 ? TaskDescriptor::SHEEP :
+                          TaskDescriptor::DEVIL);
+    td_ptr->mutable_resource_request()->set_cpu_cores(0.5);
+    td_ptr->mutable_resource_request()->set_ram_cap(1024);
+    InsertIfNotPresent(task_map_.get(), td_ptr->uid(), td_ptr);
+    pu_rd_ptrs[index] =
+      rtnd.mutable_children(index)->mutable_children(0)->
+        mutable_resource_desc();
+    pu_rd_ptrs[index]->add_current_running_tasks(td_ptr->uid());
+    graph_manager->MarkResourceDirty(
+        ResourceIDFromString(pu_rd_ptrs[index]->uuid()), false);
+  }
+  CheckDirtyStatisticsMatchFull(graph_manager.get(), cost_model,
+                                knowledge_base.get(), rtnd);
+  CHECK_EQ(rtnd.children(1).resource_desc().num_running_tasks_below(), 1);
+  CHECK_EQ(rtnd.children(1).resource_desc().reserved_resources().ram_cap(),
+           1024);
+  // Remove the first task and get a new sample from the second machine.
+  pu_rd_ptrs[0]->clear_current_running_tasks();
+  graph_manager->MarkResourceDirty(
+      ResourceIDFromString(pu_rd_ptrs[0]->uuid()), false);
+  MachinePerfStatisticsSample sample;
+  sample.set_resource_id(rtnd.children(1).resource_desc().uuid());
+  sample.set_free_ram(4096 * BYTES_TO_MB);
+  sample.set_disk_bw(250 * BYTES_TO_MB);
+  sample.add_cpus_usage()->set_idle(10.0);
+  sample.add_cpus_usage()->set_idle(20.0);
+  knowledge_base->AddMachineSample(sample);
+  CheckDirtyStatisticsMatchFull(graph_manager.get(), cost_model,
+                                knowledge_base.get(), rtnd);
+  CHECK_EQ(rtnd.children(0).resource_desc().num_running_tasks_below(), 0);
+  CHECK_EQ(rtnd.children(1).resource_desc().available_resources().ram_cap(),
+           4096);
+  delete cost_model;
+  for (auto& res_id_status : *resource_map_) {
+    delete res_id_status.second;
+  }
+  resource_map_->clear();
+}
+
+TEST_F(FlowGraphManagerTest, ComputeTopologyStatisticsInParallel) {
+  TrivialCostModel* cost_model =
+    new TrivialCostModel(resource_map_, task_map_, leaf_res_ids_);
+  FlowGraphManager* graph_manager =
+    new FlowGraphManager(cost_model, leaf_res_ids_, &wall_time_, tg_,
+                         &dimacs_stats_);
+  // Create a coordinator with three machines, each of which has two PUs.
+  ResourceTopologyNodeDescriptor rtnd;
+  CreateTopology(&rtnd, 3, 2);
+  graph_manager->AddResourceTopology(&rtnd);
+  FLAGS_topology_stats_threads = 2;
+  graph_manager->ComputeTopologyStatistics(
+      graph_manager->sink_node(),
+      boost::bind(&TrivialCostModel::PrepareStats, cost_model, _1),
+      boost::bind(&TrivialCostModel::GatherStats, cost_model, _1, _2),
+      boost::bind(&TrivialCostModel::UpdateStats, cost_model, _1, _2),
+      true);
+  for (auto& rtn_machine : rtnd.children()) {
+    CHECK_EQ(rtn_machine.resource_desc().num_slots_below(),
+             2 * FLAGS_max_tasks_per_pu);
+    CHECK_EQ(rtn_machine.resource_desc().num_running_tasks_below(), 0);
+  }
+  CHECK_EQ(rtnd.resource_desc().num_slots_below(),
+           6 * FLAGS_max_tasks_per_pu);
+  CHECK_EQ(rtnd.resource_desc().num_running_tasks_below(), 0);
+  // Computing the statistics again must not double count them.
+  graph_manager->ComputeTopologyStatistics(
+      graph_manager->sink_node(),
+      boost::bind(&TrivialCostModel::PrepareStats, cost_model, _1),
+      boost::bind(&TrivialCostModel::GatherStats, cost_model, _1, _2),
+      boost::bind(&TrivialCostModel::UpdateStats, cost_model, _1, _2),
+      true);
+  CHECK_EQ(rtnd.resource_desc().num_slots_below(),
+           6 * FLAGS_max_tasks_per_pu);
+  FLAGS_topology_stats_threads = 0;
+}
+
 TEST_F(FlowGraphManagerTest, PinTaskToNode) {
   MockCostModel mock_cost_model;
   FlowGraphManager* graph_manager =
@@ -338,7 +684,7 @@ TEST_F(FlowGraphManagerTest, PinTaskToNode) {
   graph_manager->graph_change_manager_->AddArc(
       task_node, pu2_node, 0, 1, 1, FlowGraphArcType::OTHER,
       ADD_ARC_TASK_TO_RES, "test");
-  CHECK_EQ(task_node->outgoing_arc_map_.size(), 4);
+  CHECK_EQ(task_node->outgoing_arcs_.size(), 4);
   CHECK_EQ(arc_from_unsched->cap_upper_bound_, 1);
   ON_CALL(mock_cost_model, TaskContinuationCost(_))
     .WillByDefault(testing::Return(42));
@@ -347,7 +693,7 @@ TEST_F(FlowGraphManagerTest, PinTaskToNode) {
   // The task node has a preference arc to resource node to which we pin the
   // task.
   graph_manager->PinTaskToNode(task_node, pu1_node);
-  CHECK_EQ(task_node->outgoing_arc_map_.size(), 1);
+  CHECK_EQ(task_node->outgoing_arcs_.size(), 1);
   CHECK_EQ(FindPtrOrNull(graph_manager->task_to_running_arc_,
                          task_node->td_ptr_->uid()),
            running_arc);
@@ -359,8 +705,8 @@ TEST_F(FlowGraphManagerTest, PinTaskToNode) {
   // The task node does not have a preference arc to resource node to which we
   // pin the task.
   graph_manager->PinTaskToNode(task_node, pu2_node);
-  CHECK_EQ(task_node->outgoing_arc_map_.size(), 1);
-  FlowGraphArc* new_running_arc = task_node->outgoing_arc_map_.begin()->second;
+  CHECK_EQ(task_node->outgoing_arcs_.size(), 1);
+  FlowGraphArc* new_running_arc = task_node->outgoing_arcs_[0];
   CHECK_EQ(new_running_arc->dst_node_->id_, pu2_node->id_);
 }
 
@@ -414,18 +760,18 @@ TEST_F(FlowGraphManagerTest, RemoveInvalidECPrefArcs) {
       ec_node, res_node, 0, 1, 1, FlowGraphArcType::OTHER,
       ADD_ARC_EQUIV_CLASS_TO_RES, "test");
   EXPECT_EQ(flow_graph.NumArcs(), num_arcs + 3);
-  EXPECT_EQ(ec_node->outgoing_arc_map_.size(), 3);
+  EXPECT_EQ(ec_node->outgoing_arcs_.size(), 3);
   vector<EquivClass_t> pref_ecs;
   pref_ecs.push_back(ec_child1_node->ec_id_);
   graph_manager->RemoveInvalidECPrefArcs(*ec_node, pref_ecs,
                                           DEL_ARC_BETWEEN_EQUIV_CLASS);
   EXPECT_EQ(flow_graph.NumArcs(), num_arcs + 2);
-  EXPECT_EQ(ec_node->outgoing_arc_map_.size(), 2);
+  EXPECT_EQ(ec_node->outgoing_arcs_.size(), 2);
   vector<EquivClass_t> no_pref_ecs;
   graph_manager->RemoveInvalidECPrefArcs(*ec_node, no_pref_ecs,
                                           DEL_ARC_BETWEEN_EQUIV_CLASS);
   EXPECT_EQ(flow_graph.NumArcs(), num_arcs + 1);
-  EXPECT_EQ(ec_node->outgoing_arc_map_.begin()->second, arc_to_res);
+  EXPECT_EQ(ec_node->outgoing_arcs_[0], arc_to_res);
 }
 
 TEST_F(FlowGraphManagerTest, RemoveInvalidPrefResArcs) {
@@ -464,7 +810,7 @@ TEST_F(FlowGraphManagerTest, RemoveInvalidPrefResArcs) {
       ec_node, machine2_res_node, 0, 1, 1, FlowGraphArcType::OTHER,
       ADD_ARC_EQUIV_CLASS_TO_RES, "test");
   EXPECT_EQ(flow_graph.NumArcs(), num_arcs + 3);
-  EXPECT_EQ(ec_node->outgoing_arc_map_.size(), 3);
+  EXPECT_EQ(ec_node->outgoing_arcs_.size(), 3);
 
   vector<ResourceID_t> pref_res;
   pref_res.push_back(machine2_res_node->resource_id_);
@@ -475,7 +821,51 @@ TEST_F(FlowGraphManagerTest, RemoveInvalidPrefResArcs) {
   graph_manager->RemoveInvalidPrefResArcs(*ec_node, no_pref_res,
                                            DEL_ARC_EQUIV_CLASS_TO_RES);
   EXPECT_EQ(flow_graph.NumArcs(), num_arcs + 1);
-  EXPECT_EQ(ec_node->outgoing_arc_map_.begin()->second, arc_to_ec);
+  EXPECT_EQ(ec_node->outgoing_arcs_[0], arc_to_ec);
+}
+
+TEST_F(FlowGraphManagerTest, RemoveInvalidPrefResArcsUnsorted) {
+  FlowGraphManager* graph_manager = CreateGraphManagerUsingTrivialCost();
+  EquivClass_t ec = 42;
+  FlowGraphNode* ec_node = graph_manager->AddEquivClassNode(ec);
+  CHECK_NOTNULL(ec_node);
+  const FlowGraph& flow_graph =
+    graph_manager->graph_change_manager_->flow_graph();
+  vector<FlowGraphNode*> machine_nodes;
+  vector<ResourceTopologyNodeDescriptor> machine_rtnds(4);
+  for (uint64_t index = 0; index < machine_rtnds.size(); ++index) {
+    ResourceDescriptor* rd_ptr =
+      CreateMachine(&machine_rtnds[index], "machine" + to_string(index));
+    FlowGraphNode* res_node = graph_manager->AddResourceNode(rd_ptr);
+    CHECK_NOTNULL(res_node);
+    machine_nodes.push_back(res_node);
+    graph_manager->graph_change_manager_->AddArc(
+        ec_node, res_node, 0, 1, 1, FlowGraphArcType::OTHER,
+        ADD_ARC_EQUIV_CLASS_TO_RES, "test");
+  }
+  EXPECT_EQ(flow_graph.NumArcs(), 4);
+  // The preferences are in reverse order and contain a duplicate.
+  vector<ResourceID_t> pref_res;
+  pref_res.push_back(machine_nodes[3]->resource_id_);
+  pref_res.push_back(machine_nodes[1]->resource_id_);
+  pref_res.push_back(machine_nodes[3]->resource_id_);
+  graph_manager->RemoveInvalidPrefResArcs(*ec_node, pref_res,
+                                           DEL_ARC_EQUIV_CLASS_TO_RES);
+  EXPECT_EQ(flow_graph.NumArcs(), 2);
+  EXPECT_EQ(graph_manager->sorted_pref_res_.size(), 3);
+  for (auto& arc : ec_node->outgoing_arcs_) {
+    EXPECT_TRUE(arc->dst_node_ == machine_nodes[1] ||
+                arc->dst_node_ == machine_nodes[3]);
+  }
+  // A shorter preference vector must not match stale entries left in the
+  // reused sorted copy.
+  vector<ResourceID_t> new_pref_res;
+  new_pref_res.push_back(machine_nodes[1]->resource_id_);
+  graph_manager->RemoveInvalidPrefResArcs(*ec_node, new_pref_res,
+                                           DEL_ARC_EQUIV_CLASS_TO_RES);
+  EXPECT_EQ(flow_graph.NumArcs(), 1);
+  EXPECT_EQ(graph_manager->sorted_pref_res_.size(), 1);
+  EXPECT_EQ(ec_node->outgoing_arcs_[0]->dst_node_, machine_nodes[1]);
 }
 
 TEST_F(FlowGraphManagerTest, RemoveResourceNode) {
@@ -488,14 +878,14 @@ TEST_F(FlowGraphManagerTest, RemoveResourceNode) {
   FlowGraphNode* res_node = graph_manager->AddResourceNode(rd_ptr);
   CHECK_NOTNULL(res_node);
   EXPECT_EQ(num_arcs, flow_graph.NumArcs());
-  EXPECT_EQ(FindPtrOrNull(graph_manager->resource_to_node_map_,
+  EXPECT_EQ(graph_manager->NodeForResourceID(
                           res_node->resource_id_),
             res_node);
   EXPECT_EQ(0, flow_graph.unused_ids_.size());
   graph_manager->RemoveResourceNode(res_node);
   EXPECT_EQ(1, flow_graph.unused_ids_.size());
   ResourceID_t res_id = ResourceIDFromString(rd_ptr->uuid());
-  CHECK(FindPtrOrNull(graph_manager->resource_to_node_map_, res_id) == NULL);
+  CHECK(graph_manager->NodeForResourceID(res_id) == NULL);
   EXPECT_DEATH(graph_manager->RemoveResourceNode(NULL), "");
 }
 
@@ -529,16 +919,76 @@ TEST_F(FlowGraphManagerTest, RemoveUnscheduledAggNode) {
   CHECK_NOTNULL(unsched_agg_node);
   EXPECT_EQ(num_arcs, flow_graph.NumArcs());
   EXPECT_EQ(flow_graph.unused_ids_.size(), 0);
+  FlowGraphNode task_node(0);
+  task_node.job_id_ = job_id;
+  task_node.job_handle_ = unsched_agg_node->job_handle_;
   graph_manager->RemoveUnscheduledAggNode(job_id);
   EXPECT_EQ(flow_graph.unused_ids_.size(), 1);
   // Check the method doesn't add any new arcs.
   EXPECT_EQ(num_arcs, flow_graph.NumArcs());
-  CHECK(FindPtrOrNull(graph_manager->job_unsched_to_node_, job_id) == NULL);
+  CHECK(graph_manager->UnschedAggNodeForJobID(job_id) == NULL);
+  // The job's handle is reused by another job. Task nodes that still cache
+  // it find their job's new aggregator.
+  FlowGraphNode* other_unsched_agg_node =
+    graph_manager->AddUnscheduledAggNode(GenerateJobID(43));
+  EXPECT_EQ(other_unsched_agg_node->job_handle_, task_node.job_handle_);
+  EXPECT_TRUE(graph_manager->UnschedAggNodeForTaskNode(&task_node) == NULL);
+  unsched_agg_node = graph_manager->AddUnscheduledAggNode(job_id);
+  EXPECT_EQ(graph_manager->UnschedAggNodeForTaskNode(&task_node),
+            unsched_agg_node);
+  EXPECT_EQ(task_node.job_handle_, unsched_agg_node->job_handle_);
   // Fail if we already added an unscheduled agg for job_id.
   job_id = GenerateJobID(47);
   EXPECT_DEATH(graph_manager->RemoveUnscheduledAggNode(job_id), "");
 }
 
+TEST_F(FlowGraphManagerTest, SaveAndRestoreSolverState) {
+  FlowGraphManager* saved_graph_manager = CreateGraphManagerUsingTrivialCost();
+  ResourceTopologyNodeDescriptor rtnd;
+  CreateTopology(&rtnd, 1, 2);
+  saved_graph_manager->AddResourceTopology(&rtnd);
+  JobID_t job_id = GenerateJobID(42);
+  JobID_t removed_job_id = GenerateJobID(47);
+  FlowGraphNode* saved_agg_node =
+    saved_graph_manager->AddUnscheduledAggNode(job_id);
+  FlowGraphNode* removed_agg_node =
+    saved_graph_manager->AddUnscheduledAggNode(removed_job_id);
+  ResourceID_t pu_res_id =
+    ResourceIDFromString(rtnd.children(0).children(1).resource_desc().uuid());
+  FlowGraphNode* saved_pu_node =
+    saved_graph_manager->NodeForResourceID(pu_res_id);
+  FlowGraphNode* saved_sink_node = saved_graph_manager->sink_node();
+  const FlowGraph& saved_graph =
+    saved_graph_manager->graph_change_manager_->flow_graph();
+  vector<int64_t> potentials(saved_graph.NumNodes() + 1, 0);
+  vector<unordered_map<uint64_t, uint64_t>> flow(saved_graph.NumNodes() + 1);
+  potentials[saved_agg_node->id_] = 3;
+  potentials[removed_agg_node->id_] = 5;
+  potentials[saved_pu_node->id_] = 7;
+  flow[saved_sink_node->id_][saved_agg_node->id_] = 1;
+  flow[saved_sink_node->id_][removed_agg_node->id_] = 2;
+  flow[saved_sink_node->id_][saved_pu_node->id_] = 4;
+  SolverState solver_state;
+  saved_graph_manager->SaveSolverState(potentials, flow, &solver_state);
+  // Rebuild the graph in a different order such that the nodes get different
+  // ids, and without the removed job.
+  FlowGraphManager* graph_manager = CreateGraphManagerUsingTrivialCost();
+  FlowGraphNode* agg_node = graph_manager->AddUnscheduledAggNode(job_id);
+  graph_manager->AddResourceTopology(&rtnd);
+  FlowGraphNode* pu_node = graph_manager->NodeForResourceID(pu_res_id);
+  FlowGraphNode* sink_node = graph_manager->sink_node();
+  EXPECT_NE(agg_node->id_, saved_agg_node->id_);
+  vector<int64_t> restored_potentials;
+  vector<unordered_map<uint64_t, uint64_t>> restored_flow;
+  graph_manager->RestoreSolverState(solver_state, &restored_potentials,
+                                    &restored_flow);
+  EXPECT_EQ(restored_potentials[agg_node->id_], 3);
+  EXPECT_EQ(restored_potentials[pu_node->id_], 7);
+  EXPECT_EQ(restored_flow[sink_node->id_].size(), 2);
+  EXPECT_EQ(restored_flow[sink_node->id_][agg_node->id_], 1);
+  EXPECT_EQ(restored_flow[sink_node->id_][pu_node->id_], 4);
+}
+
 TEST_F(FlowGraphManagerTest, TraverseAndRemoveTopology) {
   MockCostModel mock_cost_model;
   FlowGraphManager* graph_manager =
@@ -729,7 +1179,70 @@ TEST_F(FlowGraphManagerTest, UpdateEquivToEquivArcs) {
   EXPECT_EQ(marked_nodes.size(), 2);
   EXPECT_EQ(node_queue.size(), 2);
   EXPECT_EQ(flow_graph.NumArcs(), 0);
-  EXPECT_EQ(ec_node->outgoing_arc_map_.size(), 0);
+  EXPECT_EQ(ec_node->outgoing_arcs_.size(), 0);
+}
+
+TEST_F(FlowGraphManagerTest, UpdateEquivToEquivArcsReusesBuffers) {
+  MockCostModel mock_cost_model;
+  FlowGraphManager* graph_manager =
+    new FlowGraphManager(&mock_cost_model, leaf_res_ids_, &wall_time_, tg_,
+                         &dimacs_stats_);
+  const FlowGraph& flow_graph =
+    graph_manager->graph_change_manager_->flow_graph();
+  EquivClass_t ec = 42;
+  FlowGraphNode* ec_node = graph_manager->AddEquivClassNode(ec);
+  EquivClass_t ec_child1 = 43;
+  FlowGraphNode* ec_child1_node = graph_manager->AddEquivClassNode(ec_child1);
+  EquivClass_t ec_child2 = 44;
+  FlowGraphNode* ec_child2_node = graph_manager->AddEquivClassNode(ec_child2);
+  EquivClass_t ec_child3 = 45;
+  FlowGraphNode* ec_child3_node = graph_manager->AddEquivClassNode(ec_child3);
+  queue<TDOrNodeWrapper*> node_queue;
+  unordered_set<uint64_t> marked_nodes;
+  // The preferences are not sorted.
+  vector<EquivClass_t>* pref_ecs = new vector<EquivClass_t>();
+  pref_ecs->push_back(ec_child2);
+  pref_ecs->push_back(ec_child1);
+  ON_CALL(mock_cost_model, GetEquivClassToEquivClassesArcs(_))
+    .WillByDefault(testing::Return(pref_ecs));
+  EXPECT_CALL(mock_cost_model, GetEquivClassToEquivClassesArcs(_))
+    .Times(1);
+  EXPECT_CALL(mock_cost_model, EquivClassToEquivClass(_, _)).Times(2);
+  graph_manager->UpdateEquivToEquivArcs(ec_node, &node_queue, &marked_nodes);
+  EXPECT_EQ(flow_graph.NumArcs(), 2);
+  EXPECT_EQ(graph_manager->pref_ecs_buffer_.size(), 2);
+  EXPECT_EQ(graph_manager->ec_ecs_buffer_.size(), 2);
+  const EquivClass_t* pref_ecs_data = graph_manager->pref_ecs_buffer_.data();
+  // The next round's preferences replace the previous round's in the same
+  // buffers. The arc to the EC that is no longer preferred is removed.
+  vector<EquivClass_t>* new_pref_ecs = new vector<EquivClass_t>();
+  new_pref_ecs->push_back(ec_child3);
+  new_pref_ecs->push_back(ec_child1);
+  ON_CALL(mock_cost_model, GetEquivClassToEquivClassesArcs(_))
+    .WillByDefault(testing::Return(new_pref_ecs));
+  EXPECT_CALL(mock_cost_model, GetEquivClassToEquivClassesArcs(_))
+    .Times(1);
+  EXPECT_CALL(mock_cost_model, EquivClassToEquivClass(_, _)).Times(2);
+  graph_manager->UpdateEquivToEquivArcs(ec_node, &node_queue, &marked_nodes);
+  EXPECT_EQ(graph_manager->pref_ecs_buffer_.data(), pref_ecs_data);
+  EXPECT_EQ(graph_manager->pref_ecs_buffer_.size(), 2);
+  EXPECT_EQ(graph_manager->ec_ecs_buffer_.size(), 2);
+  EXPECT_EQ(flow_graph.NumArcs(), 2);
+  FlowGraph* mutable_flow_graph =
+    graph_manager->graph_change_manager_->mutable_flow_graph();
+  EXPECT_TRUE(mutable_flow_graph->GetArc(ec_node, ec_child1_node) != NULL);
+  EXPECT_TRUE(mutable_flow_graph->GetArc(ec_node, ec_child2_node) == NULL);
+  EXPECT_TRUE(mutable_flow_graph->GetArc(ec_node, ec_child3_node) != NULL);
+  // Cost models that return NULL must not leave the previous round's
+  // preferences in the reused buffer.
+  ON_CALL(mock_cost_model, GetEquivClassToEquivClassesArcs(_))
+    .WillByDefault(testing::Return(static_cast<vector<EquivClass_t>*>(NULL)));
+  EXPECT_CALL(mock_cost_model, GetEquivClassToEquivClassesArcs(_))
+    .Times(1);
+  graph_manager->UpdateEquivToEquivArcs(ec_node, &node_queue, &marked_nodes);
+  EXPECT_TRUE(graph_manager->pref_ecs_buffer_.empty());
+  EXPECT_EQ(flow_graph.NumArcs(), 0);
+  EXPECT_EQ(ec_node->outgoing_arcs_.size(), 0);
 }
 
 TEST_F(FlowGraphManagerTest, UpdateEquivToResArcs) {
@@ -781,7 +1294,7 @@ TEST_F(FlowGraphManagerTest, UpdateEquivToResArcs) {
   EXPECT_EQ(marked_nodes.size(), 2);
   EXPECT_EQ(node_queue.size(), 2);
   EXPECT_EQ(flow_graph.NumArcs(), 0);
-  EXPECT_EQ(ec_node->outgoing_arc_map_.size(), 0);
+  EXPECT_EQ(ec_node->outgoing_arcs_.size(), 0);
 }
 
 TEST_F(FlowGraphManagerTest, UpdateResourceStatsUpToRoot) {
@@ -1010,7 +1523,7 @@ TEST_F(FlowGraphManagerTest, UpdateTaskToEquivArcs) {
   EXPECT_EQ(marked_nodes.size(), 2);
   EXPECT_EQ(node_queue.size(), 2);
   EXPECT_EQ(flow_graph.NumArcs(), 1);
-  EXPECT_EQ(task_node->outgoing_arc_map_.size(), 1);
+  EXPECT_EQ(task_node->outgoing_arcs_.size(), 1);
 }
 
 TEST_F(FlowGraphManagerTest, UpdateTaskToResArcs) {
@@ -1070,7 +1583,7 @@ TEST_F(FlowGraphManagerTest, UpdateTaskToResArcs) {
   EXPECT_EQ(marked_nodes.size(), 2);
   EXPECT_EQ(node_queue.size(), 2);
   EXPECT_EQ(flow_graph.NumArcs(), 1);
-  EXPECT_EQ(task_node->outgoing_arc_map_.size(), 1);
+  EXPECT_EQ(task_node->outgoing_arcs_.size(), 1);
 }
 
 TEST_F(FlowGraphManagerTest, UpdateTaskToUnscheduledAggArc) {
@@ -1093,7 +1606,7 @@ TEST_F(FlowGraphManagerTest, UpdateTaskToUnscheduledAggArc) {
   EXPECT_EQ(flow_graph.NumNodes(), num_nodes + 2);
   EXPECT_EQ(flow_graph.NumArcs(), 1);
   FlowGraphArc* task_to_unsched_arc =
-    task_node->outgoing_arc_map_.begin()->second;
+    task_node->outgoing_arcs_[0];
   EXPECT_EQ(task_to_unsched_arc->cap_lower_bound_, 0);
   EXPECT_EQ(task_to_unsched_arc->cap_upper_bound_, 1);
 
@@ -1111,9 +1624,16 @@ TEST_F(FlowGraphManagerTest, UpdateTaskToUnscheduledAggArc) {
   graph_manager->UpdateTaskToUnscheduledAggArc(task_node);
   EXPECT_EQ(flow_graph.NumNodes(), num_nodes + 4);
   EXPECT_EQ(flow_graph.NumArcs(), 2);
-  task_to_unsched_arc = task_node->outgoing_arc_map_.begin()->second;
+  task_to_unsched_arc = task_node->outgoing_arcs_[0];
   EXPECT_EQ(task_to_unsched_arc->cap_lower_bound_, 0);
   EXPECT_EQ(task_to_unsched_arc->cap_upper_bound_, 1);
+
+  // Case when the cost has already been computed as part of a batch.
+  EXPECT_CALL(mock_cost_model, TaskToUnscheduledAggCost(_))
+    .Times(0);
+  graph_manager->UpdateTaskToUnscheduledAggArc(task_node, 42);
+  EXPECT_EQ(flow_graph.NumArcs(), 2);
+  EXPECT_EQ(task_to_unsched_arc->cost_, 42);
 }
 
 TEST_F(FlowGraphManagerTest, UpdateUnscheduledAggNode) {
@@ -1125,7 +1645,7 @@ TEST_F(FlowGraphManagerTest, UpdateUnscheduledAggNode) {
   JobID_t job_id = GenerateJobID(42);
   FlowGraphNode* unsched_agg_node =
     graph_manager->AddUnscheduledAggNode(job_id);
-  EXPECT_EQ(FindPtrOrNull(graph_manager->job_unsched_to_node_, job_id),
+  EXPECT_EQ(graph_manager->UnschedAggNodeForJobID(job_id),
             unsched_agg_node);
   EXPECT_EQ(flow_graph.NumArcs(), 0);
   EXPECT_EQ(flow_graph.NumNodes(), num_nodes + 1);
@@ -1134,23 +1654,23 @@ TEST_F(FlowGraphManagerTest, UpdateUnscheduledAggNode) {
   // This call to update ends up adding the arc.
   graph_manager->UpdateUnscheduledAggNode(unsched_agg_node, 1);
   EXPECT_EQ(flow_graph.NumArcs(), 1);
-  EXPECT_EQ(graph_manager->sink_node_->incoming_arc_map_.size(), 1);
+  EXPECT_EQ(graph_manager->sink_node_->incoming_arcs_.size(), 1);
   FlowGraphArc* arc_to_unsched =
-    unsched_agg_node->outgoing_arc_map_.begin()->second;
+    unsched_agg_node->outgoing_arcs_[0];
   EXPECT_EQ(arc_to_unsched->src_node_, unsched_agg_node);
-  EXPECT_EQ(unsched_agg_node->outgoing_arc_map_.size(), 1);
+  EXPECT_EQ(unsched_agg_node->outgoing_arcs_.size(), 1);
   EXPECT_EQ(arc_to_unsched->dst_node_, graph_manager->sink_node_);
   EXPECT_EQ(arc_to_unsched->cap_upper_bound_, 1);
   // Update the arc again.
   graph_manager->UpdateUnscheduledAggNode(unsched_agg_node, 1);
-  EXPECT_EQ(graph_manager->sink_node_->incoming_arc_map_.size(), 1);
-  EXPECT_EQ(unsched_agg_node->outgoing_arc_map_.size(), 1);
+  EXPECT_EQ(graph_manager->sink_node_->incoming_arcs_.size(), 1);
+  EXPECT_EQ(unsched_agg_node->outgoing_arcs_.size(), 1);
   EXPECT_EQ(flow_graph.NumArcs(), 1);
   EXPECT_EQ(arc_to_unsched->cap_upper_bound_, 2);
   // Update the arc so that its capacity is zero.
   graph_manager->UpdateUnscheduledAggNode(unsched_agg_node, -2);
-  EXPECT_EQ(graph_manager->sink_node_->incoming_arc_map_.size(), 1);
-  EXPECT_EQ(unsched_agg_node->outgoing_arc_map_.size(), 1);
+  EXPECT_EQ(graph_manager->sink_node_->incoming_arcs_.size(), 1);
+  EXPECT_EQ(unsched_agg_node->outgoing_arcs_.size(), 1);
   EXPECT_EQ(flow_graph.NumArcs(), 1);
   EXPECT_EQ(arc_to_unsched->cap_upper_bound_, 0);
 }
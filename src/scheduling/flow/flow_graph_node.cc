@@ -21,27 +21,23 @@
 #include "scheduling/flow/flow_graph_node.h"
 
 #include "base/common.h"
-#include "misc/map-util.h"
 
 namespace firmament {
 
   FlowGraphNode::FlowGraphNode(uint64_t id)
       : id_(id), excess_(0), job_id_(boost::uuids::nil_uuid()),
-        resource_id_(boost::uuids::nil_uuid()), rd_ptr_(NULL), td_ptr_(NULL),
-        ec_id_(0), visited_(0) {
+        job_handle_(kInvalidIDHandle), resource_id_(boost::uuids::nil_uuid()),
+        resource_handle_(kInvalidIDHandle),
+        rd_ptr_(NULL), td_ptr_(NULL),
+        ec_id_(0), comment_(NULL), index_(0), visited_(0) {
   }
 
   FlowGraphNode::FlowGraphNode(uint64_t id, int64_t excess)
       : id_(id), excess_(excess), job_id_(boost::uuids::nil_uuid()),
-        resource_id_(boost::uuids::nil_uuid()), rd_ptr_(NULL), td_ptr_(NULL),
-        ec_id_(0), visited_(0) {
-  }
-
-  void FlowGraphNode::AddArc(FlowGraphArc* arc) {
-    CHECK_EQ(arc->src_, id_);
-    CHECK(InsertIfNotPresent(&outgoing_arc_map_, arc->dst_, arc));
-    CHECK(InsertIfNotPresent(&(arc->dst_node_->incoming_arc_map_),
-                             arc->src_, arc));
+        job_handle_(kInvalidIDHandle), resource_id_(boost::uuids::nil_uuid()),
+        resource_handle_(kInvalidIDHandle),
+        rd_ptr_(NULL), td_ptr_(NULL),
+        ec_id_(0), comment_(NULL), index_(0), visited_(0) {
   }
 
   FlowNodeType FlowGraphNode::TransformToResourceNodeType(
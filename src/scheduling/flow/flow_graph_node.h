@@ -25,6 +25,7 @@
 #define FIRMAMENT_SCHEDULING_FLOW_FLOW_GRAPH_NODE_H
 
 #include <string>
+#include <vector>
 #include <boost/uuid/nil_generator.hpp>
 
 #include "base/common.h"
@@ -54,7 +55,6 @@ enum FlowNodeType {
 struct FlowGraphNode {
   explicit FlowGraphNode(uint64_t id);
   FlowGraphNode(uint64_t id, int64_t excess);
-  void AddArc(FlowGraphArc* arc);
   bool IsEquivalenceClassNode() const {
     return type_ == FlowNodeType::EQUIVALENCE_CLASS;
   };
@@ -84,22 +84,32 @@ struct FlowGraphNode {
   FlowNodeType type_;
   // TODO(malte): Not sure if these should be here, but they've got to go
   // somewhere.
-  // The ID of the job that this task belongs to (if task node).
+  // The ID of the job that this task belongs to (if task node), or the ID of
+  // the job whose unscheduled tasks this node aggregates (if job aggregator).
   JobID_t job_id_;
+  // The FlowGraphManager's dense handle for job_id_. It can be stale for task
+  // nodes whose job aggregator has been removed and added again.
+  IDHandle_t job_handle_;
   // The ID of the resource that this node represents.
   ResourceID_t resource_id_;
+  // The FlowGraphManager's dense handle for resource_id_ (if resource node).
+  IDHandle_t resource_handle_;
   // The descriptor of the resource that this node represents.
   ResourceDescriptor* rd_ptr_;
   // The descriptor of the task represented by this node.
   TaskDescriptor* td_ptr_;
   // the ID of the equivalence class represented by this node.
   EquivClass_t ec_id_;
-  // Free-form comment for debugging purposes (used to label special nodes)
-  string comment_;
-  // Outgoing arcs from this node, keyed by destination node
-  unordered_map<uint64_t, FlowGraphArc*> outgoing_arc_map_;
-  // Incoming arcs to this node, keyed by source node
-  unordered_map<uint64_t, FlowGraphArc*> incoming_arc_map_;
+  // Free-form comment for debugging purposes (used to label special nodes).
+  // The string is interned by the FlowGraph; NULL if there's no comment.
+  const string* comment_;
+  // Outgoing arcs from this node. Use FlowGraph::GetArc to look up the arc
+  // to a particular destination node.
+  vector<FlowGraphArc*> outgoing_arcs_;
+  // Incoming arcs to this node.
+  vector<FlowGraphArc*> incoming_arcs_;
+  // Position of the node in the FlowGraph's node vector.
+  uint32_t index_;
   // Field use to mark if the node has been visited in a graph traversal.
   uint32_t visited_;
 };
@@ -70,7 +70,7 @@ TEST_F(FlowGraphTest, AddArcToNode) {
   FlowGraphArc* arc = graph.AddArc(n0->id_, n1->id_);
   CHECK_EQ(graph.NumNodes(), init_node_count + 2);
   CHECK_EQ(graph.NumArcs(), 1);
-  CHECK_EQ(n0->outgoing_arc_map_[n1->id_], arc);
+  CHECK_EQ(graph.GetArc(n0, n1), arc);
 }
 
 // Change an arc and check it gets added to changes.
@@ -92,6 +92,42 @@ TEST_F(FlowGraphTest, ChangeArc) {
   CHECK_EQ(graph.NumArcs(), num_arcs - 1);
 }
 
+// Delete a node and check that the remaining nodes and arcs are still
+// reachable, and that the node's id and comment are released.
+TEST_F(FlowGraphTest, DeleteNode) {
+  FlowGraph graph;
+  FlowGraphNode* n0 = graph.AddNode();
+  FlowGraphNode* n1 = graph.AddNode();
+  FlowGraphNode* n2 = graph.AddNode();
+  FlowGraphNode* n3 = graph.AddNode();
+  graph.SetNodeComment(n0, "shared");
+  graph.SetNodeComment(n1, "shared");
+  CHECK_EQ(n0->comment_, n1->comment_);
+  graph.AddArc(n0, n1);
+  graph.AddArc(n0, n2);
+  FlowGraphArc* arc03 = graph.AddArc(n0, n3);
+  graph.AddArc(n2, n1);
+  graph.AddArc(n1, n3);
+  uint64_t n1_id = n1->id_;
+  graph.DeleteNode(n1);
+  CHECK_EQ(graph.Nodes().size(), 3);
+  CHECK_EQ(graph.NumArcs(), 2);
+  CHECK(graph.GetArc(n0, n2) != NULL);
+  CHECK_EQ(graph.GetArc(n0, n3), arc03);
+  CHECK_EQ(n0->outgoing_arcs_.size(), 2);
+  CHECK_EQ(n2->outgoing_arcs_.size(), 0);
+  CHECK_EQ(n3->incoming_arcs_.size(), 1);
+  CHECK_EQ(*n0->comment_, "shared");
+  // The id of the deleted node is re-used.
+  FlowGraphNode* n4 = graph.AddNode();
+  CHECK_EQ(n4->id_, n1_id);
+  CHECK_EQ(&graph.Node(n1_id), n4);
+  CHECK(n4->comment_ == NULL);
+  CHECK(graph.GetArc(n0, n4) == NULL);
+  graph.AddArc(n2, n4);
+  CHECK_EQ(graph.NumArcs(), 3);
+}
+
 }  // namespace firmament
 
 int main(int argc, char **argv) {
@@ -22,6 +22,7 @@
 
 #include "scheduling/flow/flow_scheduler.h"
 
+#include <boost/bind.hpp>
 #include <boost/timer/timer.hpp>
 #include <cstdio>
 #include <map>
@@ -66,6 +67,19 @@ DEFINE_string(solver_runtime_accounting_mode, "algorithm",
               "scheduling duration in simulations");
 DEFINE_bool(reschedule_tasks_upon_node_failure, true, "True if tasks that were "
             "running on failed nodes should be rescheduled");
+DEFINE_bool(incremental_topology_stats, true, "True if the resource "
+            "statistics should only be recomputed for the resources that "
+            "changed since the previous scheduling round. The statistics are "
+            "otherwise recomputed for the entire topology (in parallel if "
+            "--topology_stats_threads is set)");
+DEFINE_bool(pipelined_scheduling, false, "True if the scheduler should keep "
+            "handling events while the solver runs. The graph changes made "
+            "during a solver run are sent to the solver in the next round, "
+            "which starts as soon as the results come back. The placements "
+            "are applied asynchronously, so ScheduleJobs returns before they "
+            "are made and always reports 0 placed tasks. "
+            "--flowlessly_flip_algorithms does not force solver runs in this "
+            "mode. Not supported in simulations.");
 
 DECLARE_string(flow_scheduling_solver);
 DECLARE_bool(flowlessly_flip_algorithms);
@@ -99,7 +113,14 @@ FlowScheduler::FlowScheduler(
       leaf_res_ids_(new unordered_set<ResourceID_t,
                       boost::hash<boost::uuids::uuid>>),
       dimacs_stats_(new DIMACSChangeStats),
-      solver_run_cnt_(0) {
+      solver_run_cnt_(0),
+      solver_run_in_flight_(false),
+      pipelined_round_requested_(false),
+      pipelined_round_start_timestamp_(0),
+      solver_waiter_thread_(NULL) {
+  if (FLAGS_pipelined_scheduling && event_notifier_) {
+    LOG(FATAL) << "Pipelined scheduling is not supported in simulations";
+  }
   // Select the cost model to use
   VLOG(1) << "Set cost model to use in flow graph to \""
           << FLAGS_flow_scheduling_cost_model << "\"";
@@ -158,11 +179,16 @@ FlowScheduler::FlowScheduler(
 
   // Set up the initial flow graph
   flow_graph_manager_->AddResourceTopology(resource_topology);
+  DFSTraverseResourceProtobufTreeReturnRTND(
+      resource_topology,
+      boost::bind(&FlowScheduler::RegisterResourceStatus, this, _1));
   // Set up the dispatcher, which starts the flow solver
   solver_dispatcher_ = new SolverDispatcher(flow_graph_manager_, false);
 }
 
 FlowScheduler::~FlowScheduler() {
+  // Wait for the in-flight solver run to complete.
+  JoinSolverWaiterThread();
   delete dimacs_stats_;
   delete cost_model_;
   delete solver_dispatcher_;
@@ -253,7 +279,7 @@ void FlowScheduler::HandleTaskCompletion(TaskDescriptor* td_ptr,
   // Otherwise, we need to remove nodes, etc.
   if (td_ptr->delegated_from().empty()) {
     uint64_t task_node_id = flow_graph_manager_->TaskCompleted(td_ptr->uid());
-    tasks_completed_during_solver_run_.insert(task_node_id);
+    tasks_removed_during_solver_run_.insert(task_node_id);
   }
 }
 
@@ -267,7 +293,8 @@ void FlowScheduler::HandleTaskEviction(TaskDescriptor* td_ptr,
 
 void FlowScheduler::HandleTaskFailure(TaskDescriptor* td_ptr) {
   boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
-  flow_graph_manager_->TaskFailed(td_ptr->uid());
+  uint64_t task_node_id = flow_graph_manager_->TaskFailed(td_ptr->uid());
+  tasks_removed_during_solver_run_.insert(task_node_id);
   EventDrivenScheduler::HandleTaskFailure(td_ptr);
 }
 
@@ -275,11 +302,9 @@ void FlowScheduler::HandleTaskFinalReport(const TaskFinalReport& report,
                                           TaskDescriptor* td_ptr) {
   boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
   TaskID_t task_id = td_ptr->uid();
-  vector<EquivClass_t>* equiv_classes =
-    cost_model_->GetTaskEquivClasses(task_id);
-  CHECK_NOTNULL(equiv_classes);
-  knowledge_base_->ProcessTaskFinalReport(*equiv_classes, report);
-  delete equiv_classes;
+  vector<EquivClass_t> equiv_classes;
+  cost_model_->FillTaskEquivClasses(task_id, &equiv_classes);
+  knowledge_base_->ProcessTaskFinalReport(equiv_classes, report);
   // NOTE: We should remove the task from the cost model in TaskCompleted.
   // However, we cannot do that because in this method we need the
   // task's equivalence classes.
@@ -319,10 +344,19 @@ void FlowScheduler::HandleTaskPlacement(TaskDescriptor* td_ptr,
 void FlowScheduler::KillRunningTask(TaskID_t task_id,
                                     TaskKillMessage::TaskKillReason reason) {
   boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
-  flow_graph_manager_->TaskKilled(task_id);
+  uint64_t task_node_id = flow_graph_manager_->TaskKilled(task_id);
+  tasks_removed_during_solver_run_.insert(task_node_id);
   EventDrivenScheduler::KillRunningTask(task_id, reason);
 }
 
+void FlowScheduler::JoinSolverWaiterThread() {
+  if (solver_waiter_thread_) {
+    solver_waiter_thread_->join();
+    delete solver_waiter_thread_;
+    solver_waiter_thread_ = NULL;
+  }
+}
+
 void FlowScheduler::LogDebugCostModel() {
   string csv_log;
   spf(&csv_log, "%s/cost_model_%d.csv", FLAGS_debug_output_dir.c_str(),
@@ -341,16 +375,13 @@ void FlowScheduler::PopulateSchedulerResourceUI(
 
 void FlowScheduler::PopulateSchedulerTaskUI(TaskID_t task_id,
                                             TemplateDictionary* dict) const {
-  vector<EquivClass_t>* equiv_classes =
-    cost_model_->GetTaskEquivClasses(task_id);
-  if (equiv_classes) {
-    for (vector<EquivClass_t>::iterator it = equiv_classes->begin();
-         it != equiv_classes->end(); ++it) {
-      TemplateDictionary* tec_dict = dict->AddSectionDictionary("TASK_TECS");
-      tec_dict->SetFormattedValue("TASK_TEC", "%ju", *it);
-    }
+  vector<EquivClass_t> equiv_classes;
+  cost_model_->FillTaskEquivClasses(task_id, &equiv_classes);
+  for (vector<EquivClass_t>::iterator it = equiv_classes.begin();
+       it != equiv_classes.end(); ++it) {
+    TemplateDictionary* tec_dict = dict->AddSectionDictionary("TASK_TECS");
+    tec_dict->SetFormattedValue("TASK_TEC", "%ju", *it);
   }
-  delete equiv_classes;
 }
 
 uint64_t FlowScheduler::ScheduleAllJobs(SchedulerStats* scheduler_stats) {
@@ -361,11 +392,7 @@ uint64_t FlowScheduler::ScheduleAllJobs(SchedulerStats* scheduler_stats,
                                         vector<SchedulingDelta>* deltas) {
   boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
   vector<JobDescriptor*> jobs;
-  for (auto& job_id_jd : jobs_to_schedule_) {
-    if (ComputeRunnableTasksForJob(job_id_jd.second).size() > 0) {
-      jobs.push_back(job_id_jd.second);
-    }
-  }
+  ComputeJobsWithRunnableTasks(&jobs);
   uint64_t num_scheduled_tasks = ScheduleJobs(jobs, scheduler_stats, deltas);
   return num_scheduled_tasks;
 }
@@ -376,6 +403,9 @@ uint64_t FlowScheduler::ScheduleJob(JobDescriptor* jd_ptr,
   LOG(INFO) << "START SCHEDULING (via " << jd_ptr->uuid() << ")";
   LOG(WARNING) << "This way of scheduling a job is slow in the flow scheduler! "
                << "Consider using ScheduleAllJobs() instead.";
+  // The job may have changed without the scheduler being told (e.g., tasks
+  // may have been spawned), so we reduce its graph again.
+  ComputeRunnableTasksForJob(jd_ptr);
   vector<JobDescriptor*> jobs_to_schedule {jd_ptr};
   return ScheduleJobs(jobs_to_schedule, scheduler_stats);
 }
@@ -387,15 +417,24 @@ uint64_t FlowScheduler::ScheduleJobs(const vector<JobDescriptor*>& jd_ptr_vect,
   CHECK_NOTNULL(scheduler_stats);
   uint64_t num_scheduled_tasks = 0;
   boost::timer::cpu_timer total_scheduler_timer;
+  UpdateRunnableTasks();
   vector<JobDescriptor*> jds_with_runnables;
   for (auto& jd_ptr : jd_ptr_vect) {
     // Check if we have any runnable tasks in this job
-    const unordered_set<TaskID_t> runnable_tasks =
-      ComputeRunnableTasksForJob(jd_ptr);
-    if (runnable_tasks.size() > 0) {
+    if (jobs_with_runnables_.find(JobIDFromString(jd_ptr->uuid())) !=
+        jobs_with_runnables_.end()) {
       jds_with_runnables.push_back(jd_ptr);
     }
   }
+  if (FLAGS_pipelined_scheduling) {
+    // The placements are made by the solver waiter thread once the results
+    // come back, so we can't report how many tasks were placed. We also don't
+    // run the solver without runnable jobs, even with
+    // --flowlessly_flip_algorithms set, because pipelined mode is not
+    // supported in simulations.
+    StartPipelinedRound(jds_with_runnables);
+    return 0;
+  }
   // XXX(ionel): HACK! We should only run the scheduler when we have
   // runnable jobs. However, we also run the scheduler when we've
   // set the flowlessly_flip_algorithms flag in order to speed up
@@ -407,8 +446,16 @@ uint64_t FlowScheduler::ScheduleJobs(const vector<JobDescriptor*>& jd_ptr_vect,
     // (e.g. based on machine load and prior decisions); these need to be
     // known before AddOrUpdateJobNodes is invoked below, as it may add arcs
     // depending on these metrics.
+    boost::timer::cpu_timer phase_timer;
     UpdateCostModelResourceStats();
+    scheduler_stats->phase_runtimes_[PHASE_TOPOLOGY_STATS] =
+      static_cast<uint64_t>(phase_timer.elapsed().wall) /
+      NANOSECONDS_IN_MICROSECOND;
+    phase_timer.start();
     flow_graph_manager_->AddOrUpdateJobNodes(jds_with_runnables);
+    scheduler_stats->phase_runtimes_[PHASE_ADD_OR_UPDATE_JOB_NODES] =
+      static_cast<uint64_t>(phase_timer.elapsed().wall) /
+      NANOSECONDS_IN_MICROSECOND;
     num_scheduled_tasks += RunSchedulingIteration(scheduler_stats, deltas);
     VLOG(1) << "STOP SCHEDULING, placed " << num_scheduled_tasks << " tasks";
     // If we have cost model debug logging turned on, write some debugging
@@ -423,6 +470,7 @@ uint64_t FlowScheduler::ScheduleJobs(const vector<JobDescriptor*>& jd_ptr_vect,
     scheduler_stats->total_runtime_ =
       static_cast<uint64_t>(total_scheduler_timer.elapsed().wall) /
       NANOSECONDS_IN_MICROSECOND;
+    phase_stats_.RecordRound(*scheduler_stats);
     trace_generator_->SchedulerRun(*scheduler_stats, current_run_dimacs_stats);
   }
   return num_scheduled_tasks;
@@ -434,14 +482,61 @@ void FlowScheduler::RegisterResource(ResourceTopologyNodeDescriptor* rtnd_ptr,
   boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
   EventDrivenScheduler::RegisterResource(rtnd_ptr, local, simulated);
   flow_graph_manager_->AddResourceTopology(rtnd_ptr);
+  DFSTraverseResourceProtobufTreeReturnRTND(
+      rtnd_ptr,
+      boost::bind(&FlowScheduler::RegisterResourceStatus, this, _1));
   if (rtnd_ptr->parent_id().empty()) {
     resource_roots_.insert(rtnd_ptr);
   }
 }
 
+void FlowScheduler::RegisterResourceStatus(
+    ResourceTopologyNodeDescriptor* rtnd_ptr) {
+  ResourceStatus* rs_ptr =
+    FindPtrOrNull(*resource_map_,
+                  ResourceIDFromString(rtnd_ptr->resource_desc().uuid()));
+  if (rs_ptr) {
+    flow_graph_manager_->RegisterResourceStatus(rs_ptr);
+  }
+}
+
+void FlowScheduler::RestoreSolverState(const SolverState& solver_state) {
+  boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
+  solver_dispatcher_->RestoreSolverState(solver_state);
+}
+
+void FlowScheduler::RestoreTaskPlacements(
+    const vector<pair<TaskDescriptor*, ResourceDescriptor*>>& placements) {
+  boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
+  vector<JobDescriptor*> jds_with_runnables;
+  ComputeJobsWithRunnableTasks(&jds_with_runnables);
+  // The task nodes must be in the flow graph before the tasks are placed.
+  // The same steps as for a scheduling round add them, except that the
+  // solver does not run.
+  UpdateCostModelResourceStats();
+  flow_graph_manager_->AddOrUpdateJobNodes(jds_with_runnables);
+  EventDrivenScheduler::RestoreTaskPlacements(placements);
+}
+
+void FlowScheduler::SaveSolverState(SolverState* solver_state) {
+  boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
+  solver_dispatcher_->SaveSolverState(solver_state);
+}
+
 uint64_t FlowScheduler::RunSchedulingIteration(
     SchedulerStats* scheduler_stats,
     vector<SchedulingDelta>* deltas_output) {
+  PrepareSchedulingIteration();
+  uint64_t scheduler_start_timestamp = time_manager_->GetCurrentTimestamp();
+  // Run the flow solver! This is where all the juicy goodness happens :)
+  multimap<uint64_t, uint64_t>* task_mappings =
+    solver_dispatcher_->Run(scheduler_stats);
+  solver_run_cnt_++;
+  return ApplySolverResults(task_mappings, scheduler_stats,
+                            scheduler_start_timestamp, deltas_output);
+}
+
+void FlowScheduler::PrepareSchedulingIteration() {
   // If it's time to revisit time-dependent costs, do so now, just before
   // we run the solver.
   uint64_t cur_time = time_manager_->GetCurrentTimestamp();
@@ -472,12 +567,15 @@ uint64_t FlowScheduler::RunSchedulingIteration(
     flow_graph_manager_->PurgeUnconnectedEquivClassNodes();
   }
   pus_removed_during_solver_run_.clear();
-  tasks_completed_during_solver_run_.clear();
-  uint64_t scheduler_start_timestamp = time_manager_->GetCurrentTimestamp();
-  // Run the flow solver! This is where all the juicy goodness happens :)
-  multimap<uint64_t, uint64_t>* task_mappings =
-    solver_dispatcher_->Run(scheduler_stats);
-  solver_run_cnt_++;
+  tasks_removed_during_solver_run_.clear();
+}
+
+uint64_t FlowScheduler::ApplySolverResults(
+    multimap<uint64_t, uint64_t>* task_mappings,
+    SchedulerStats* scheduler_stats,
+    uint64_t scheduler_start_timestamp,
+    vector<SchedulingDelta>* deltas_output) {
+  CHECK_NOTNULL(task_mappings);
   CHECK_LE(scheduler_stats->scheduler_runtime_, FLAGS_max_solver_runtime)
     << "Solver took longer than limit of "
     << scheduler_stats->scheduler_runtime_;
@@ -513,6 +611,7 @@ uint64_t FlowScheduler::RunSchedulingIteration(
     }
   }
   // Solver's done, let's post-process the results.
+  boost::timer::cpu_timer phase_timer;
   multimap<uint64_t, uint64_t>::iterator it;
   vector<SchedulingDelta*> deltas;
   // We first generate the deltas for the preempted tasks in a separate step.
@@ -523,12 +622,12 @@ uint64_t FlowScheduler::RunSchedulingIteration(
                                                          resource_map_,
                                                          &deltas);
   for (it = task_mappings->begin(); it != task_mappings->end(); it++) {
-    if (tasks_completed_during_solver_run_.find(it->first) !=
-        tasks_completed_during_solver_run_.end()) {
-      // Ignore the task because it has already completed while the solver
-      // was running.
+    if (tasks_removed_during_solver_run_.find(it->first) !=
+        tasks_removed_during_solver_run_.end()) {
+      // Ignore the task because it has already completed (or failed, or has
+      // been killed) while the solver was running.
       VLOG(1) << "Task with node id: " << it->first
-              << " completed while the solver was running";
+              << " was removed while the solver was running";
       continue;
     }
     if (pus_removed_during_solver_run_.find(it->second) !=
@@ -547,6 +646,9 @@ uint64_t FlowScheduler::RunSchedulingIteration(
   }
   // Freeing the mappings because they're not used below.
   delete task_mappings;
+  scheduler_stats->phase_runtimes_[PHASE_DELTA_GENERATION] =
+    static_cast<uint64_t>(phase_timer.elapsed().wall) /
+    NANOSECONDS_IN_MICROSECOND;
 
   // Move the time to solver_start_time + solver_run_time if this is not
   // the first run of a simulation.
@@ -575,7 +677,11 @@ uint64_t FlowScheduler::RunSchedulingIteration(
                  << FLAGS_solver_runtime_accounting_mode;
     }
   }
+  phase_timer.start();
   uint64_t num_scheduled = ApplySchedulingDeltas(deltas);
+  scheduler_stats->phase_runtimes_[PHASE_APPLY_DELTAS] =
+    static_cast<uint64_t>(phase_timer.elapsed().wall) /
+    NANOSECONDS_IN_MICROSECOND;
   if (deltas_output) {
     for (auto& delta : deltas) {
       deltas_output->push_back(*delta);
@@ -592,10 +698,112 @@ uint64_t FlowScheduler::RunSchedulingIteration(
   return num_scheduled;
 }
 
+void FlowScheduler::StartPipelinedRound(
+    const vector<JobDescriptor*>& jds_with_runnables) {
+  if (solver_run_in_flight_) {
+    // The jobs are considered in the round that starts as soon as the
+    // in-flight run completes.
+    pipelined_round_requested_ = true;
+    return;
+  }
+  if (jds_with_runnables.size() == 0) {
+    return;
+  }
+  // The thread has finished waiting for the previous run, but it may not
+  // have exited yet.
+  JoinSolverWaiterThread();
+  SubmitPipelinedRound(jds_with_runnables);
+  solver_waiter_thread_ =
+    new boost::thread(boost::bind(&FlowScheduler::WaitForPipelinedRounds,
+                                  this));
+}
+
+void FlowScheduler::SubmitPipelinedRound(
+    const vector<JobDescriptor*>& jds_with_runnables) {
+  pipelined_round_timer_.start();
+  pipelined_round_stats_ = SchedulerStats();
+  boost::timer::cpu_timer phase_timer;
+  UpdateCostModelResourceStats();
+  pipelined_round_stats_.phase_runtimes_[PHASE_TOPOLOGY_STATS] =
+    static_cast<uint64_t>(phase_timer.elapsed().wall) /
+    NANOSECONDS_IN_MICROSECOND;
+  phase_timer.start();
+  flow_graph_manager_->AddOrUpdateJobNodes(jds_with_runnables);
+  pipelined_round_stats_.phase_runtimes_[PHASE_ADD_OR_UPDATE_JOB_NODES] =
+    static_cast<uint64_t>(phase_timer.elapsed().wall) /
+    NANOSECONDS_IN_MICROSECOND;
+  PrepareSchedulingIteration();
+  pipelined_round_start_timestamp_ = time_manager_->GetCurrentTimestamp();
+  solver_dispatcher_->SubmitRun();
+  // The solver works on the changes made so far. All the graph changes we
+  // make from now on are going to be included in the next round.
+  pipelined_round_dimacs_stats_ = *dimacs_stats_;
+  dimacs_stats_->ResetStats();
+  solver_run_in_flight_ = true;
+  pipelined_round_requested_ = false;
+}
+
+void FlowScheduler::WaitForPipelinedRounds() {
+  while (true) {
+    // The round we wait for has already been submitted, so its stats don't
+    // change anymore.
+    SchedulerStats scheduler_stats = pipelined_round_stats_;
+    // We don't hold the scheduling lock while we wait for the solver. Hence,
+    // the scheduler can handle events (e.g., task completions) meanwhile.
+    multimap<uint64_t, uint64_t>* task_mappings =
+      solver_dispatcher_->WaitForRun(&scheduler_stats);
+    boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
+    solver_run_cnt_++;
+    uint64_t num_scheduled_tasks =
+      ApplySolverResults(task_mappings, &scheduler_stats,
+                         pipelined_round_start_timestamp_, NULL);
+    VLOG(1) << "STOP SCHEDULING, placed " << num_scheduled_tasks << " tasks";
+    if (FLAGS_debug_cost_model) {
+      LogDebugCostModel();
+    }
+    scheduler_stats.total_runtime_ =
+      static_cast<uint64_t>(pipelined_round_timer_.elapsed().wall) /
+      NANOSECONDS_IN_MICROSECOND;
+    phase_stats_.RecordRound(scheduler_stats);
+    trace_generator_->SchedulerRun(scheduler_stats,
+                                   pipelined_round_dimacs_stats_);
+    vector<JobDescriptor*> jobs;
+    if (pipelined_round_requested_) {
+      ComputeJobsWithRunnableTasks(&jobs);
+    }
+    if (jobs.size() == 0) {
+      solver_run_in_flight_ = false;
+      pipelined_round_requested_ = false;
+      return;
+    }
+    // Start the next round right away. Its graph changes have accumulated
+    // while the solver was running.
+    SubmitPipelinedRound(jobs);
+  }
+}
+
 void FlowScheduler::UpdateCostModelResourceStats() {
   VLOG(2) << "Updating resource statistics in flow graph";
-  flow_graph_manager_->ComputeTopologyStatistics(
-      flow_graph_manager_->sink_node(),
+  if (!FLAGS_incremental_topology_stats) {
+    flow_graph_manager_->ComputeTopologyStatistics(
+        flow_graph_manager_->sink_node(),
+        boost::bind(&CostModelInterface::PrepareStats, cost_model_, _1),
+        boost::bind(&CostModelInterface::GatherStats, cost_model_, _1, _2),
+        boost::bind(&CostModelInterface::UpdateStats, cost_model_, _1, _2),
+        cost_model_->StatsAreThreadSafe());
+    return;
+  }
+  // Task placements, completions and resource changes have already marked
+  // the resources they affect as dirty. The machines that sent samples since
+  // the previous round are only dirty if the cost model uses the samples.
+  vector<ResourceID_t> updated_machines;
+  knowledge_base_->TakeUpdatedMachines(&updated_machines);
+  if (cost_model_->StatsDependOnMachineSamples()) {
+    for (auto& res_id : updated_machines) {
+      flow_graph_manager_->MarkResourceDirty(res_id, true);
+    }
+  }
+  flow_graph_manager_->ComputeDirtyTopologyStatistics(
       boost::bind(&CostModelInterface::PrepareStats, cost_model_, _1),
       boost::bind(&CostModelInterface::GatherStats, cost_model_, _1, _2),
       boost::bind(&CostModelInterface::UpdateStats, cost_model_, _1, _2));
@@ -28,6 +28,9 @@
 #include <string>
 #include <vector>
 
+#include <boost/thread.hpp>
+#include <boost/timer/timer.hpp>
+
 #include "base/common.h"
 #include "base/types.h"
 #include "base/job_desc.pb.h"
@@ -36,6 +39,7 @@
 #include "misc/time_interface.h"
 #include "scheduling/event_driven_scheduler.h"
 #include "scheduling/knowledge_base.h"
+#include "scheduling/scheduler_phase_stats.h"
 #include "scheduling/scheduling_delta.pb.h"
 #include "scheduling/scheduling_event_notifier_interface.h"
 #include "scheduling/flow/dimacs_change_stats.h"
@@ -85,11 +89,20 @@ class FlowScheduler : public EventDrivenScheduler {
   virtual void RegisterResource(ResourceTopologyNodeDescriptor* rtnd_ptr,
                                 bool local,
                                 bool simulated);
+  virtual void RestoreSolverState(const SolverState& solver_state);
+  virtual void RestoreTaskPlacements(
+      const vector<pair<TaskDescriptor*, ResourceDescriptor*>>& placements);
+  virtual void SaveSolverState(SolverState* solver_state);
   virtual uint64_t ScheduleAllJobs(SchedulerStats* scheduler_stats);
   virtual uint64_t ScheduleAllJobs(SchedulerStats* scheduler_stats,
                                    vector<SchedulingDelta>* deltas);
   virtual uint64_t ScheduleJob(JobDescriptor* jd_ptr,
                                SchedulerStats* scheduler_stats);
+  /**
+   * Schedules the runnable tasks of the given jobs.
+   * @return the number of tasks that were placed; always 0 with
+   * --pipelined_scheduling, as the placements are then made asynchronously
+   */
   virtual uint64_t ScheduleJobs(const vector<JobDescriptor*>& jds_ptr,
                                 SchedulerStats* scheduler_stats,
                                 vector<SchedulingDelta>* deltas = NULL);
@@ -104,6 +117,9 @@ class FlowScheduler : public EventDrivenScheduler {
   const SolverDispatcher& dispatcher() const {
     return *solver_dispatcher_;
   }
+  const SchedulerPhaseStats& phase_stats() const {
+    return phase_stats_;
+  }
 
  protected:
   virtual void HandleTaskMigration(TaskDescriptor* td_ptr,
@@ -112,15 +128,60 @@ class FlowScheduler : public EventDrivenScheduler {
                                    ResourceDescriptor* rd_ptr);
 
  private:
+  FRIEND_TEST(FlowSchedulerTest, LabelSelectorsRestrictPlacement);
+  FRIEND_TEST(FlowSchedulerTest, PipelinedFollowUpRound);
+  FRIEND_TEST(FlowSchedulerTest, PipelinedTaskCompletionDuringSolverRun);
+  FRIEND_TEST(FlowSchedulerTest, PipelinedTaskKillDuringSolverRun);
+
   uint64_t ApplySchedulingDeltas(const vector<SchedulingDelta*>& deltas);
   void HandleTasksFromDeregisteredResource(
       ResourceTopologyNodeDescriptor* rtnd_ptr);
+  /**
+   * Waits for the thread that applies the pipelined solver runs' results to
+   * exit, if there is one.
+   */
+  void JoinSolverWaiterThread();
   void LogDebugCostModel();
   TaskDescriptor* ProducingTaskForDataObjectID(DataObjectID_t id);
   void RegisterLocalResource(ResourceID_t res_id);
   void RegisterRemoteResource(ResourceID_t res_id);
+  /**
+   * Caches the flow graph manager's handle of a resource on its
+   * ResourceStatus. Resources that have no status are skipped.
+   * @param rtnd_ptr the topology descriptor of the resource
+   */
+  void RegisterResourceStatus(ResourceTopologyNodeDescriptor* rtnd_ptr);
   uint64_t RunSchedulingIteration(SchedulerStats* scheduler_stats,
                                   vector<SchedulingDelta>* deltas_output);
+  /**
+   * Updates the parts of the flow graph that must be updated just before the
+   * solver runs (e.g., time-dependent costs).
+   */
+  void PrepareSchedulingIteration();
+  /**
+   * Turns the solver's task mappings into scheduling deltas and applies them.
+   * Takes ownership of task_mappings.
+   * @param scheduler_start_timestamp the time at which the solver started
+   * @param deltas_output if not NULL, the applied deltas are appended to it
+   * @return the number of tasks that were placed
+   */
+  uint64_t ApplySolverResults(multimap<uint64_t, uint64_t>* task_mappings,
+                              SchedulerStats* scheduler_stats,
+                              uint64_t scheduler_start_timestamp,
+                              vector<SchedulingDelta>* deltas_output);
+  /**
+   * Starts a pipelined scheduling round, unless the solver is already
+   * running. In that case, the next round starts as soon as the solver's
+   * results come back.
+   */
+  void StartPipelinedRound(const vector<JobDescriptor*>& jds_with_runnables);
+  void SubmitPipelinedRound(const vector<JobDescriptor*>& jds_with_runnables);
+  /**
+   * Body of the thread that waits for the results of pipelined solver runs.
+   * It applies the results, and submits the next round if scheduling was
+   * requested while the solver was running.
+   */
+  void WaitForPipelinedRounds();
   void UpdateCostModelResourceStats();
 
   // Pointer to the coordinator's topology manager
@@ -140,13 +201,27 @@ class FlowScheduler : public EventDrivenScheduler {
   // while the solver was running. This set is used to make sure we don't
   // place tasks on PUs that have been removed.
   set<uint64_t> pus_removed_during_solver_run_;
-  // Set of task node ids that have completed while the solver was running.
-  // We use this set to make sure we don't try to place again the completed
-  // tasks.
-  set<uint64_t> tasks_completed_during_solver_run_;
+  // Set of task node ids that have completed, failed or have been killed
+  // while the solver was running. We use this set to make sure we don't try
+  // to place again the removed tasks.
+  set<uint64_t> tasks_removed_during_solver_run_;
   DIMACSChangeStats* dimacs_stats_;
   uint64_t solver_run_cnt_;
+  // True while a solver run started in pipelined mode has not yet been
+  // applied.
+  bool solver_run_in_flight_;
+  // True if scheduling was requested while a solver run was in flight.
+  bool pipelined_round_requested_;
+  // State of the in-flight pipelined round.
+  uint64_t pipelined_round_start_timestamp_;
+  boost::timer::cpu_timer pipelined_round_timer_;
+  DIMACSChangeStats pipelined_round_dimacs_stats_;
+  SchedulerStats pipelined_round_stats_;
+  // Thread that waits for the results of pipelined solver runs.
+  boost::thread* solver_waiter_thread_;
   unordered_set<ResourceTopologyNodeDescriptor*> resource_roots_;
+  // Latency histograms of the phases of all the scheduling rounds.
+  SchedulerPhaseStats phase_stats_;
 };
 
 }  // namespace scheduler
@@ -0,0 +1,308 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// FlowScheduler class unit tests.
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "base/common.h"
+#include "base/job_desc.pb.h"
+#include "base/resource_status.h"
+#include "base/task_desc.pb.h"
+#include "base/task_final_report.pb.h"
+#include "misc/map-util.h"
+#include "misc/trace_generator.h"
+#include "misc/utils.h"
+#include "misc/wall_time.h"
+#include "platforms/sim/simulated_messaging_adapter.h"
+#include "scheduling/flow/flow_scheduler.h"
+#include "scheduling/knowledge_base.h"
+
+DECLARE_int32(flow_scheduling_cost_model);
+DECLARE_string(flow_scheduling_solver);
+DECLARE_bool(pipelined_scheduling);
+
+namespace firmament {
+namespace scheduler {
+
+using machine::topology::TopologyManager;
+using platform::sim::SimulatedMessagingAdapter;
+
+// The fixture for testing class FlowScheduler.
+class FlowSchedulerTest : public ::testing::Test {
+ protected:
+  // You can remove any or all of the following functions if its body
+  // is empty.
+
+  FlowSchedulerTest() :
+    job_map_(new JobMap_t),
+    resource_map_(new ResourceMap_t),
+    task_map_(new TaskMap_t),
+    trace_generator_(&wall_time_) {
+    // You can do set-up work for each test here.
+    FLAGS_v = 2;
+  }
+
+  virtual ~FlowSchedulerTest() {
+    // You can do clean-up work that doesn't throw exceptions here.
+  }
+
+  // If the constructor and destructor are not enough for setting up
+  // and cleaning up each test, you can define the following methods:
+
+  virtual void SetUp() {
+    // Code here will be called immediately after the constructor (right
+    // before each test).
+    // The in-process solver runs when the round is submitted, which makes
+    // the order of events in the tests deterministic.
+    FLAGS_flow_scheduling_cost_model = CostModelType::COST_MODEL_TRIVIAL;
+    FLAGS_flow_scheduling_solver = "inprocess";
+    FLAGS_pipelined_scheduling = true;
+    ResourceID_t root_res_id = GenerateResourceID("test");
+    AddResource(&rtn_root_, root_res_id,
+                ResourceDescriptor::RESOURCE_COORDINATOR);
+    sched_.reset(new FlowScheduler(
+        job_map_, resource_map_, &rtn_root_,
+        shared_ptr<store::ObjectStoreInterface>(), task_map_,
+        shared_ptr<KnowledgeBase>(new KnowledgeBase),
+        shared_ptr<TopologyManager>(), &m_adapter_, NULL, root_res_id,
+        "test", &wall_time_, &trace_generator_));
+    // Add a machine with two PUs.
+    ResourceTopologyNodeDescriptor* rtn_machine = rtn_root_.add_children();
+    AddResource(rtn_machine, GenerateResourceID("machine0"),
+                ResourceDescriptor::RESOURCE_MACHINE);
+    rtn_machine->set_parent_id(rtn_root_.resource_desc().uuid());
+    for (uint64_t pu = 0; pu < 2; ++pu) {
+      ResourceTopologyNodeDescriptor* rtn_pu = rtn_machine->add_children();
+      AddResource(rtn_pu, GenerateResourceID("machine0-pu" + to_string(pu)),
+                  ResourceDescriptor::RESOURCE_PU);
+      rtn_pu->set_parent_id(rtn_machine->resource_desc().uuid());
+    }
+    sched_->RegisterResource(rtn_machine, false, true);
+  }
+
+  virtual void TearDown() {
+    // Code here will be called immediately after each test (right
+    // before the destructor).
+    sched_.reset();
+    for (auto& res_id_status : *resource_map_) {
+      delete res_id_status.second;
+    }
+    FLAGS_pipelined_scheduling = false;
+    FLAGS_flow_scheduling_solver = "cs2";
+  }
+
+  // Objects declared here can be used by all tests.
+  void AddResource(ResourceTopologyNodeDescriptor* rtnd_ptr,
+                   ResourceID_t res_id,
+                   ResourceDescriptor::ResourceType type) {
+    ResourceDescriptor* rd_ptr = rtnd_ptr->mutable_resource_desc();
+    rd_ptr->set_uuid(to_string(res_id));
+    rd_ptr->set_type(type);
+    CHECK(InsertIfNotPresent(resource_map_.get(), res_id,
+                             new ResourceStatus(res_id, rd_ptr, rtnd_ptr,
+                                                "endpoint_uri", 0)));
+  }
+
+  // Adds a job with a single task to the job and task maps.
+  JobDescriptor* AddJob() {
+    JobID_t job_id = GenerateJobID();
+    JobDescriptor jd;
+    jd.set_uuid(to_string(job_id));
+    jd.set_name(to_string(job_id));
+    CHECK(InsertIfNotPresent(job_map_.get(), job_id, jd));
+    JobDescriptor* jd_ptr = FindOrNull(*job_map_, job_id);
+    TaskDescriptor* rtd_ptr = jd_ptr->mutable_root_task();
+    rtd_ptr->set_uid(GenerateRootTaskID(*jd_ptr));
+    rtd_ptr->set_state(TaskDescriptor::CREATED);
+    rtd_ptr->set_job_id(jd_ptr->uuid());
+    CHECK(InsertIfNotPresent(task_map_.get(), rtd_ptr->uid(), rtd_ptr));
+    return jd_ptr;
+  }
+
+  WallTime wall_time_;
+  shared_ptr<JobMap_t> job_map_;
+  shared_ptr<ResourceMap_t> resource_map_;
+  shared_ptr<TaskMap_t> task_map_;
+  ResourceTopologyNodeDescriptor rtn_root_;
+  SimulatedMessagingAdapter<BaseMessage> m_adapter_;
+  TraceGenerator trace_generator_;
+  scoped_ptr<FlowScheduler> sched_;
+  SchedulerStats scheduler_stats_;
+};
+
+// Tests that a task which completes while the solver runs is not placed
+// again when the solver's results are applied.
+TEST_F(FlowSchedulerTest, PipelinedTaskCompletionDuringSolverRun) {
+  JobDescriptor* jd_ptr1 = AddJob();
+  TaskDescriptor* td_ptr1 = jd_ptr1->mutable_root_task();
+  sched_->AddJob(jd_ptr1);
+  vector<JobDescriptor*> jobs1 {jd_ptr1};
+  EXPECT_EQ(sched_->ScheduleJobs(jobs1, &scheduler_stats_), 0UL);
+  sched_->JoinSolverWaiterThread();
+  ASSERT_EQ(td_ptr1->state(), TaskDescriptor::RUNNING);
+  JobDescriptor* jd_ptr2 = AddJob();
+  TaskDescriptor* td_ptr2 = jd_ptr2->mutable_root_task();
+  {
+    // The results of the second round can't be applied while we hold the
+    // scheduling lock.
+    boost::lock_guard<boost::recursive_mutex> lock(sched_->scheduling_lock_);
+    sched_->AddJob(jd_ptr2);
+    vector<JobDescriptor*> jobs2 {jd_ptr2};
+    EXPECT_EQ(sched_->ScheduleJobs(jobs2, &scheduler_stats_), 0UL);
+    EXPECT_TRUE(sched_->solver_run_in_flight_);
+    TaskFinalReport report;
+    sched_->HandleTaskCompletion(td_ptr1, &report);
+    EXPECT_EQ(sched_->tasks_removed_during_solver_run_.size(), 1UL);
+  }
+  sched_->JoinSolverWaiterThread();
+  EXPECT_EQ(sched_->solver_run_cnt_, 2UL);
+  EXPECT_FALSE(sched_->solver_run_in_flight_);
+  EXPECT_EQ(td_ptr1->state(), TaskDescriptor::COMPLETED);
+  EXPECT_TRUE(sched_->BoundResourceForTask(td_ptr1->uid()) == NULL);
+  EXPECT_EQ(td_ptr2->state(), TaskDescriptor::RUNNING);
+}
+
+// Tests that a task which is killed while the solver runs is not placed
+// again when the solver's results are applied.
+TEST_F(FlowSchedulerTest, PipelinedTaskKillDuringSolverRun) {
+  JobDescriptor* jd_ptr1 = AddJob();
+  TaskDescriptor* td_ptr1 = jd_ptr1->mutable_root_task();
+  sched_->AddJob(jd_ptr1);
+  vector<JobDescriptor*> jobs1 {jd_ptr1};
+  sched_->ScheduleJobs(jobs1, &scheduler_stats_);
+  sched_->JoinSolverWaiterThread();
+  ASSERT_EQ(td_ptr1->state(), TaskDescriptor::RUNNING);
+  ResourceID_t res_id1 = *sched_->BoundResourceForTask(td_ptr1->uid());
+  JobDescriptor* jd_ptr2 = AddJob();
+  TaskDescriptor* td_ptr2 = jd_ptr2->mutable_root_task();
+  {
+    boost::lock_guard<boost::recursive_mutex> lock(sched_->scheduling_lock_);
+    sched_->AddJob(jd_ptr2);
+    vector<JobDescriptor*> jobs2 {jd_ptr2};
+    sched_->ScheduleJobs(jobs2, &scheduler_stats_);
+    EXPECT_TRUE(sched_->solver_run_in_flight_);
+    sched_->KillRunningTask(td_ptr1->uid(), TaskKillMessage::USER_ABORT);
+    EXPECT_EQ(sched_->tasks_removed_during_solver_run_.size(), 1UL);
+  }
+  sched_->JoinSolverWaiterThread();
+  EXPECT_EQ(sched_->solver_run_cnt_, 2UL);
+  EXPECT_FALSE(sched_->solver_run_in_flight_);
+  EXPECT_EQ(td_ptr1->state(), TaskDescriptor::ABORTED);
+  // The killed task has neither been placed again nor migrated.
+  ResourceID_t* res_id_ptr1 = sched_->BoundResourceForTask(td_ptr1->uid());
+  ASSERT_TRUE(res_id_ptr1 != NULL);
+  EXPECT_EQ(*res_id_ptr1, res_id1);
+  EXPECT_EQ(td_ptr2->state(), TaskDescriptor::RUNNING);
+}
+
+// Tests that scheduling requested while the solver runs starts a follow-up
+// round as soon as the solver's results have been applied.
+TEST_F(FlowSchedulerTest, PipelinedFollowUpRound) {
+  JobDescriptor* jd_ptr1 = AddJob();
+  TaskDescriptor* td_ptr1 = jd_ptr1->mutable_root_task();
+  JobDescriptor* jd_ptr2 = AddJob();
+  TaskDescriptor* td_ptr2 = jd_ptr2->mutable_root_task();
+  {
+    boost::lock_guard<boost::recursive_mutex> lock(sched_->scheduling_lock_);
+    sched_->AddJob(jd_ptr1);
+    vector<JobDescriptor*> jobs1 {jd_ptr1};
+    sched_->ScheduleJobs(jobs1, &scheduler_stats_);
+    EXPECT_TRUE(sched_->solver_run_in_flight_);
+    EXPECT_FALSE(sched_->pipelined_round_requested_);
+    // The second job is submitted while the first round is in flight.
+    sched_->AddJob(jd_ptr2);
+    vector<JobDescriptor*> jobs2 {jd_ptr2};
+    EXPECT_EQ(sched_->ScheduleJobs(jobs2, &scheduler_stats_), 0UL);
+    EXPECT_TRUE(sched_->pipelined_round_requested_);
+    EXPECT_EQ(td_ptr1->state(), TaskDescriptor::RUNNABLE);
+    EXPECT_EQ(td_ptr2->state(), TaskDescriptor::RUNNABLE);
+  }
+  // The waiter thread applies the first round's results and runs the
+  // follow-up round before it exits.
+  sched_->JoinSolverWaiterThread();
+  EXPECT_EQ(sched_->solver_run_cnt_, 2UL);
+  EXPECT_FALSE(sched_->solver_run_in_flight_);
+  EXPECT_FALSE(sched_->pipelined_round_requested_);
+  EXPECT_EQ(td_ptr1->state(), TaskDescriptor::RUNNING);
+  EXPECT_EQ(td_ptr2->state(), TaskDescriptor::RUNNING);
+  EXPECT_NE(*sched_->BoundResourceForTask(td_ptr1->uid()),
+            *sched_->BoundResourceForTask(td_ptr2->uid()));
+}
+
+// Tests that tasks with label selectors are only placed on machines that
+// satisfy them.
+TEST_F(FlowSchedulerTest, LabelSelectorsRestrictPlacement) {
+  // Add a second machine with two PUs and a label.
+  ResourceTopologyNodeDescriptor* rtn_machine = rtn_root_.add_children();
+  AddResource(rtn_machine, GenerateResourceID("machine1"),
+              ResourceDescriptor::RESOURCE_MACHINE);
+  rtn_machine->set_parent_id(rtn_root_.resource_desc().uuid());
+  Label* label = rtn_machine->mutable_resource_desc()->add_labels();
+  label->set_key("zone");
+  label->set_value("b");
+  for (uint64_t pu = 0; pu < 2; ++pu) {
+    ResourceTopologyNodeDescriptor* rtn_pu = rtn_machine->add_children();
+    AddResource(rtn_pu, GenerateResourceID("machine1-pu" + to_string(pu)),
+                ResourceDescriptor::RESOURCE_PU);
+    rtn_pu->set_parent_id(rtn_machine->resource_desc().uuid());
+  }
+  sched_->RegisterResource(rtn_machine, false, true);
+  vector<JobDescriptor*> jobs;
+  for (uint64_t job = 0; job < 3; ++job) {
+    JobDescriptor* jd_ptr = AddJob();
+    LabelSelector* selector =
+      jd_ptr->mutable_root_task()->add_label_selectors();
+    selector->set_type(LabelSelector::IN_SET);
+    selector->set_key("zone");
+    selector->add_values("b");
+    sched_->AddJob(jd_ptr);
+    jobs.push_back(jd_ptr);
+  }
+  sched_->ScheduleJobs(jobs, &scheduler_stats_);
+  sched_->JoinSolverWaiterThread();
+  // Only two of the tasks fit on the labelled machine. The third one must not
+  // be placed on the other machine.
+  uint64_t num_running = 0;
+  for (auto& jd_ptr : jobs) {
+    const TaskDescriptor& td = jd_ptr->root_task();
+    if (td.state() != TaskDescriptor::RUNNING) {
+      EXPECT_EQ(td.state(), TaskDescriptor::RUNNABLE);
+      continue;
+    }
+    num_running++;
+    ResourceStatus* rs =
+      FindPtrOrNull(*resource_map_, *sched_->BoundResourceForTask(td.uid()));
+    ASSERT_TRUE(rs != NULL);
+    EXPECT_EQ(rs->topology_node().parent_id(),
+              rtn_machine->resource_desc().uuid());
+  }
+  EXPECT_EQ(num_running, 2UL);
+}
+
+}  // namespace scheduler
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -111,9 +111,15 @@ pair<Cost_t, uint64_t> NetCostModel::EquivClassToEquivClass(
                                 1250LL, 1ULL);
 }
 
-vector<EquivClass_t>* NetCostModel::GetTaskEquivClasses(
-    TaskID_t task_id) {
+vector<EquivClass_t>* NetCostModel::GetTaskEquivClasses(TaskID_t task_id) {
   vector<EquivClass_t>* ecs = new vector<EquivClass_t>();
+  FillTaskEquivClasses(task_id, ecs);
+  return ecs;
+}
+
+void NetCostModel::FillTaskEquivClasses(TaskID_t task_id,
+                                        vector<EquivClass_t>* ecs) {
+  ecs->clear();
   // Get the equivalence class for the task's required rx bw.
   uint64_t* task_required_rx_bw = FindOrNull(task_rx_bw_requirement_, task_id);
   CHECK_NOTNULL(task_required_rx_bw);
@@ -121,27 +127,47 @@ vector<EquivClass_t>* NetCostModel::GetTaskEquivClasses(
     static_cast<EquivClass_t>(HashInt(*task_required_rx_bw));
   ecs->push_back(rx_bw_ec);
   InsertIfNotPresent(&ec_rx_bw_requirement_, rx_bw_ec, *task_required_rx_bw);
-  return ecs;
 }
 
 vector<ResourceID_t>* NetCostModel::GetOutgoingEquivClassPrefArcs(
     EquivClass_t ec) {
   vector<ResourceID_t>* machine_res = new vector<ResourceID_t>();
+  FillOutgoingEquivClassPrefArcs(ec, machine_res);
+  return machine_res;
+}
+
+void NetCostModel::FillOutgoingEquivClassPrefArcs(
+    EquivClass_t ec,
+    vector<ResourceID_t>* machine_res) {
+  machine_res->clear();
   ResourceID_t* machine_res_id = FindOrNull(ec_to_machine_, ec);
   if (machine_res_id) {
     machine_res->push_back(*machine_res_id);
   }
-  return machine_res;
 }
 
 vector<ResourceID_t>* NetCostModel::GetTaskPreferenceArcs(TaskID_t task_id) {
   vector<ResourceID_t>* pref_res = new vector<ResourceID_t>();
+  FillTaskPreferenceArcs(task_id, pref_res);
   return pref_res;
 }
 
+void NetCostModel::FillTaskPreferenceArcs(TaskID_t task_id,
+                                          vector<ResourceID_t>* pref_res) {
+  pref_res->clear();
+}
+
 vector<EquivClass_t>* NetCostModel::GetEquivClassToEquivClassesArcs(
     EquivClass_t ec) {
   vector<EquivClass_t>* pref_ecs = new vector<EquivClass_t>();
+  FillEquivClassToEquivClassesArcs(ec, pref_ecs);
+  return pref_ecs;
+}
+
+void NetCostModel::FillEquivClassToEquivClassesArcs(
+    EquivClass_t ec,
+    vector<EquivClass_t>* pref_ecs) {
+  pref_ecs->clear();
   uint64_t* required_net_rx_bw = FindOrNull(ec_rx_bw_requirement_, ec);
   if (required_net_rx_bw) {
     // if EC is a rx bw EC then connect it to machine ECs.
@@ -164,7 +190,6 @@ vector<EquivClass_t>* NetCostModel::GetEquivClassToEquivClassesArcs(
       }
     }
   }
-  return pref_ecs;
 }
 
 void NetCostModel::AddMachine(
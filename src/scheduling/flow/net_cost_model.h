@@ -65,6 +65,14 @@ class NetCostModel : public CostModelInterface {
   vector<ResourceID_t>* GetOutgoingEquivClassPrefArcs(EquivClass_t tec);
   vector<ResourceID_t>* GetTaskPreferenceArcs(TaskID_t task_id);
   vector<EquivClass_t>* GetEquivClassToEquivClassesArcs(EquivClass_t tec);
+  void FillTaskEquivClasses(TaskID_t task_id,
+                            vector<EquivClass_t>* equiv_classes);
+  void FillOutgoingEquivClassPrefArcs(EquivClass_t tec,
+                                      vector<ResourceID_t>* pref_res);
+  void FillTaskPreferenceArcs(TaskID_t task_id,
+                              vector<ResourceID_t>* pref_res);
+  void FillEquivClassToEquivClassesArcs(EquivClass_t tec,
+                                        vector<EquivClass_t>* pref_ecs);
   void AddMachine(ResourceTopologyNodeDescriptor* rtnd_ptr);
   void AddTask(TaskID_t task_id);
   void RemoveMachine(ResourceID_t res_id);
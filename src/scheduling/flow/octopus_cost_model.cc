@@ -110,18 +110,32 @@ pair<Cost_t, uint64_t> OctopusCostModel::EquivClassToEquivClass(
   return pair<Cost_t, uint64_t>(0LL, 0ULL);
 }
 
-vector<EquivClass_t>* OctopusCostModel::GetTaskEquivClasses(
-    TaskID_t task_id) {
+vector<EquivClass_t>* OctopusCostModel::GetTaskEquivClasses(TaskID_t task_id) {
   vector<EquivClass_t>* equiv_classes = new vector<EquivClass_t>();
+  FillTaskEquivClasses(task_id, equiv_classes);
+  return equiv_classes;
+}
+
+void OctopusCostModel::FillTaskEquivClasses(
+    TaskID_t task_id,
+    vector<EquivClass_t>* equiv_classes) {
+  equiv_classes->clear();
   // All tasks have an arc to the cluster aggregator, i.e. they are
   // all in the cluster aggregator EC.
   equiv_classes->push_back(cluster_aggregator_ec_);
-  return equiv_classes;
 }
 
 vector<ResourceID_t>* OctopusCostModel::GetOutgoingEquivClassPrefArcs(
     EquivClass_t ec) {
   vector<ResourceID_t>* arc_destinations = new vector<ResourceID_t>();
+  FillOutgoingEquivClassPrefArcs(ec, arc_destinations);
+  return arc_destinations;
+}
+
+void OctopusCostModel::FillOutgoingEquivClassPrefArcs(
+    EquivClass_t ec,
+    vector<ResourceID_t>* arc_destinations) {
+  arc_destinations->clear();
   if (ec == cluster_aggregator_ec_) {
     // ec is the cluster aggregator, and has arcs to all machines.
     // XXX(malte): This is inefficient, as it needlessly adds all the
@@ -133,18 +147,32 @@ vector<ResourceID_t>* OctopusCostModel::GetOutgoingEquivClassPrefArcs(
       arc_destinations->push_back(*it);
     }
   }
-  return arc_destinations;
 }
 
 vector<ResourceID_t>* OctopusCostModel::GetTaskPreferenceArcs(
     TaskID_t task_id) {
+  vector<ResourceID_t>* pref_res = new vector<ResourceID_t>();
+  FillTaskPreferenceArcs(task_id, pref_res);
+  return pref_res;
+}
+
+void OctopusCostModel::FillTaskPreferenceArcs(TaskID_t task_id,
+                                              vector<ResourceID_t>* pref_res) {
   // Not used in Octopus cost model
-  return NULL;
+  pref_res->clear();
 }
 
 vector<EquivClass_t>* OctopusCostModel::GetEquivClassToEquivClassesArcs(
     EquivClass_t ec) {
-  return NULL;
+  vector<EquivClass_t>* pref_ecs = new vector<EquivClass_t>();
+  FillEquivClassToEquivClassesArcs(ec, pref_ecs);
+  return pref_ecs;
+}
+
+void OctopusCostModel::FillEquivClassToEquivClassesArcs(
+    EquivClass_t ec,
+    vector<EquivClass_t>* pref_ecs) {
+  pref_ecs->clear();
 }
 
 void OctopusCostModel::AddMachine(
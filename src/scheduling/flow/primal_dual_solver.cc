@@ -0,0 +1,387 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Implementation of the linked-in primal-dual min-cost flow solver.
+//
+// The solver maintains a pseudo-flow that satisfies the reduced cost
+// optimality conditions (i.e., no residual arc has a negative reduced cost).
+// It repeatedly runs Dijkstra from the nodes with excess to the closest node
+// with deficit, updates the node potentials, and augments flow along the
+// admissible (zero reduced cost) arcs until all the excess has been routed.
+
+#include "scheduling/flow/primal_dual_solver.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+#include <boost/timer/timer.hpp>
+
+#include "base/units.h"
+#include "misc/map-util.h"
+
+DEFINE_bool(primal_dual_warm_start, true, "Start every primal-dual solver "
+            "run from the flow and the potentials of the previous run.");
+
+namespace firmament {
+
+static const uint64_t kNoArc = numeric_limits<uint64_t>::max();
+static const uint64_t kNoNode = numeric_limits<uint64_t>::max();
+static const int64_t kInfiniteDistance = numeric_limits<int64_t>::max();
+
+PrimalDualSolver::PrimalDualSolver()
+  : cur_visit_counter_(0), num_iterations_(0) {
+}
+
+PrimalDualSolver::~PrimalDualSolver() {
+}
+
+void PrimalDualSolver::AugmentAdmissiblePaths() {
+  // We use visited_ to lazily reset current_arc_ at the beginning of each
+  // augmentation phase. A node whose current arc has reached the end of its
+  // arc range cannot reach a deficit node via admissible arcs anymore.
+  cur_visit_counter_++;
+  for (auto& src : excess_nodes_) {
+    while (excess_[src] > 0) {
+      path_arcs_.clear();
+      uint64_t cur_node = src;
+      bool found_deficit = false;
+      if (visited_[src] != cur_visit_counter_) {
+        visited_[src] = cur_visit_counter_;
+        current_arc_[src] = node_offsets_[src];
+      }
+      on_path_[src] = true;
+      while (true) {
+        if (cur_node != src && excess_[cur_node] < 0) {
+          found_deficit = true;
+          break;
+        }
+        bool advanced = false;
+        uint64_t arcs_end = node_offsets_[cur_node + 1];
+        for (; current_arc_[cur_node] < arcs_end; ++current_arc_[cur_node]) {
+          const ResidualArc& arc = arcs_[current_arc_[cur_node]];
+          if (arc.residual_ <= 0 || on_path_[arc.dst_] ||
+              ReducedCost(cur_node, arc) != 0) {
+            continue;
+          }
+          if (visited_[arc.dst_] != cur_visit_counter_) {
+            visited_[arc.dst_] = cur_visit_counter_;
+            current_arc_[arc.dst_] = node_offsets_[arc.dst_];
+          } else if (current_arc_[arc.dst_] == node_offsets_[arc.dst_ + 1]) {
+            // The destination node is a dead end.
+            continue;
+          }
+          path_arcs_.push_back(current_arc_[cur_node]);
+          cur_node = arc.dst_;
+          on_path_[cur_node] = true;
+          advanced = true;
+          break;
+        }
+        if (!advanced) {
+          // Dead end; retreat to the previous node on the path.
+          on_path_[cur_node] = false;
+          if (path_arcs_.empty()) {
+            break;
+          }
+          uint64_t arc_index = path_arcs_.back();
+          path_arcs_.pop_back();
+          cur_node = arcs_[arcs_[arc_index].rev_].dst_;
+          ++current_arc_[cur_node];
+        }
+      }
+      if (!found_deficit) {
+        break;
+      }
+      int64_t delta = min(excess_[src], -excess_[cur_node]);
+      for (auto& arc_index : path_arcs_) {
+        delta = min(delta, arcs_[arc_index].residual_);
+      }
+      for (auto& arc_index : path_arcs_) {
+        ResidualArc& arc = arcs_[arc_index];
+        arc.residual_ -= delta;
+        arcs_[arc.rev_].residual_ += delta;
+        on_path_[arc.dst_] = false;
+      }
+      on_path_[src] = false;
+      excess_[src] -= delta;
+      excess_[cur_node] += delta;
+    }
+  }
+}
+
+void PrimalDualSolver::AugmentShortestPath(uint64_t dst) {
+  int64_t delta = -excess_[dst];
+  uint64_t src = dst;
+  while (parent_arc_[src] != kNoArc) {
+    const ResidualArc& arc = arcs_[parent_arc_[src]];
+    delta = min(delta, arc.residual_);
+    src = arcs_[arc.rev_].dst_;
+  }
+  delta = min(delta, excess_[src]);
+  CHECK_GT(delta, 0);
+  for (uint64_t node_id = dst; parent_arc_[node_id] != kNoArc; ) {
+    ResidualArc& arc = arcs_[parent_arc_[node_id]];
+    arc.residual_ -= delta;
+    arcs_[arc.rev_].residual_ += delta;
+    node_id = arcs_[arc.rev_].dst_;
+  }
+  excess_[src] -= delta;
+  excess_[dst] += delta;
+}
+
+void PrimalDualSolver::BuildResidualGraph(const FlowGraph& graph) {
+  uint64_t num_nodes = graph.NumNodes() + 1;
+  for (auto& node : graph.Nodes()) {
+    num_nodes = max(num_nodes, node->id_ + 1);
+  }
+  excess_.assign(num_nodes, 0);
+  for (auto& node : graph.Nodes()) {
+    excess_[node->id_] = node->excess_;
+  }
+  // Node ids may have been re-used since the last run. This is fine because
+  // any potentials are valid once we've saturated the arcs with negative
+  // reduced costs.
+  potentials_.resize(num_nodes, 0);
+  distance_.assign(num_nodes, kInfiniteDistance);
+  parent_arc_.resize(num_nodes, kNoArc);
+  current_arc_.resize(num_nodes, 0);
+  visited_.resize(num_nodes, 0);
+  on_path_.assign(num_nodes, false);
+  // Count the residual arcs of every node and compute the CSR offsets.
+  node_offsets_.assign(num_nodes + 1, 0);
+  graph_arcs_.clear();
+  graph_arcs_.reserve(graph.NumArcs());
+  for (const auto& arc : graph.Arcs()) {
+    node_offsets_[arc->src_ + 1]++;
+    node_offsets_[arc->dst_ + 1]++;
+    graph_arcs_.push_back(arc);
+  }
+  for (uint64_t node_id = 1; node_id <= num_nodes; ++node_id) {
+    node_offsets_[node_id] += node_offsets_[node_id - 1];
+  }
+  arcs_.resize(node_offsets_[num_nodes]);
+  forward_arc_index_.resize(graph_arcs_.size());
+  // We use current_arc_ as the insertion position of each node.
+  copy(node_offsets_.begin(), node_offsets_.end() - 1, current_arc_.begin());
+  for (uint64_t index = 0; index < graph_arcs_.size(); ++index) {
+    const FlowGraphArc* arc = graph_arcs_[index];
+    CHECK_GE(arc->cap_upper_bound_, arc->cap_lower_bound_);
+    uint64_t forward = current_arc_[arc->src_]++;
+    uint64_t backward = current_arc_[arc->dst_]++;
+    // The lower bound flow is always sent along the arc. When warm starting,
+    // we also send the flow the arc carried in the previous run.
+    uint64_t flow = arc->cap_lower_bound_;
+    if (FLAGS_primal_dual_warm_start) {
+      flow = min(max(PreviousFlow(arc->src_, arc->dst_), flow),
+                 arc->cap_upper_bound_);
+    }
+    ResidualArc& forward_arc = arcs_[forward];
+    forward_arc.dst_ = arc->dst_;
+    forward_arc.rev_ = backward;
+    forward_arc.residual_ = static_cast<int64_t>(arc->cap_upper_bound_ - flow);
+    forward_arc.cost_ = arc->cost_;
+    ResidualArc& backward_arc = arcs_[backward];
+    backward_arc.dst_ = arc->src_;
+    backward_arc.rev_ = forward;
+    backward_arc.residual_ =
+      static_cast<int64_t>(flow - arc->cap_lower_bound_);
+    backward_arc.cost_ = -arc->cost_;
+    excess_[arc->src_] -= static_cast<int64_t>(flow);
+    excess_[arc->dst_] += static_cast<int64_t>(flow);
+    forward_arc_index_[index] = forward;
+  }
+}
+
+void PrimalDualSolver::ExtractFlow(
+    const FlowGraph& graph,
+    vector<unordered_map<uint64_t, uint64_t>>* extracted_flow) {
+  if (extracted_flow->size() < excess_.size()) {
+    extracted_flow->resize(excess_.size());
+  }
+  if (FLAGS_primal_dual_warm_start) {
+    previous_flow_.resize(excess_.size());
+    for (auto& incoming_flow : previous_flow_) {
+      incoming_flow.clear();
+    }
+  }
+  for (uint64_t index = 0; index < graph_arcs_.size(); ++index) {
+    const FlowGraphArc* arc = graph_arcs_[index];
+    const ResidualArc& forward_arc = arcs_[forward_arc_index_[index]];
+    // The residual capacity of the backward arc is equal to the flow we've
+    // sent in addition to the lower bound.
+    uint64_t flow = arc->cap_lower_bound_ +
+      static_cast<uint64_t>(arcs_[forward_arc.rev_].residual_);
+    if (flow > 0) {
+      (*extracted_flow)[arc->dst_][arc->src_] = flow;
+      if (FLAGS_primal_dual_warm_start) {
+        previous_flow_[arc->dst_][arc->src_] = flow;
+      }
+    }
+  }
+}
+
+uint64_t PrimalDualSolver::FindShortestPath() {
+  typedef pair<int64_t, uint64_t> DistanceNode;
+  priority_queue<DistanceNode, vector<DistanceNode>,
+                 greater<DistanceNode>> to_visit;
+  touched_nodes_.clear();
+  for (auto& node_id : excess_nodes_) {
+    distance_[node_id] = 0;
+    parent_arc_[node_id] = kNoArc;
+    touched_nodes_.push_back(node_id);
+    to_visit.push(make_pair(0, node_id));
+  }
+  uint64_t deficit_node = kNoNode;
+  int64_t deficit_distance = 0;
+  while (!to_visit.empty()) {
+    DistanceNode cur = to_visit.top();
+    to_visit.pop();
+    uint64_t cur_node = cur.second;
+    if (cur.first > distance_[cur_node]) {
+      // Stale queue entry.
+      continue;
+    }
+    if (excess_[cur_node] < 0) {
+      deficit_node = cur_node;
+      deficit_distance = cur.first;
+      break;
+    }
+    for (uint64_t index = node_offsets_[cur_node];
+         index < node_offsets_[cur_node + 1]; ++index) {
+      const ResidualArc& arc = arcs_[index];
+      if (arc.residual_ <= 0) {
+        continue;
+      }
+      int64_t new_distance = cur.first + ReducedCost(cur_node, arc);
+      if (new_distance < distance_[arc.dst_]) {
+        if (distance_[arc.dst_] == kInfiniteDistance) {
+          touched_nodes_.push_back(arc.dst_);
+        }
+        distance_[arc.dst_] = new_distance;
+        parent_arc_[arc.dst_] = index;
+        to_visit.push(make_pair(new_distance, arc.dst_));
+      }
+    }
+  }
+  // Update the potentials of the nodes we've touched. We subtract
+  // deficit_distance from every node's potential (which does not change the
+  // reduced costs), so that the potentials of untouched nodes remain the same.
+  for (auto& node_id : touched_nodes_) {
+    if (deficit_node != kNoNode) {
+      potentials_[node_id] +=
+        min(distance_[node_id], deficit_distance) - deficit_distance;
+    }
+    distance_[node_id] = kInfiniteDistance;
+  }
+  return deficit_node;
+}
+
+void PrimalDualSolver::GetWarmStartState(
+    vector<int64_t>* potentials,
+    vector<unordered_map<uint64_t, uint64_t>>* flow) const {
+  CHECK_NOTNULL(potentials);
+  CHECK_NOTNULL(flow);
+  *potentials = potentials_;
+  *flow = previous_flow_;
+}
+
+uint64_t PrimalDualSolver::PreviousFlow(uint64_t src, uint64_t dst) const {
+  if (dst >= previous_flow_.size()) {
+    return 0;
+  }
+  const uint64_t* flow = FindOrNull(previous_flow_[dst], src);
+  return flow == NULL ? 0 : *flow;
+}
+
+void PrimalDualSolver::SaturateNegativeArcs() {
+  uint64_t num_nodes = excess_.size();
+  for (uint64_t node_id = 0; node_id < num_nodes; ++node_id) {
+    for (uint64_t index = node_offsets_[node_id];
+         index < node_offsets_[node_id + 1]; ++index) {
+      ResidualArc& arc = arcs_[index];
+      if (arc.residual_ > 0 && ReducedCost(node_id, arc) < 0) {
+        int64_t delta = arc.residual_;
+        arc.residual_ = 0;
+        arcs_[arc.rev_].residual_ += delta;
+        excess_[node_id] -= delta;
+        excess_[arc.dst_] += delta;
+      }
+    }
+  }
+}
+
+void PrimalDualSolver::SetWarmStartState(
+    const vector<int64_t>& potentials,
+    const vector<unordered_map<uint64_t, uint64_t>>& flow) {
+  potentials_ = potentials;
+  if (FLAGS_primal_dual_warm_start) {
+    previous_flow_ = flow;
+  }
+}
+
+uint64_t PrimalDualSolver::Solve(
+    const FlowGraph& graph,
+    vector<unordered_map<uint64_t, uint64_t>>* extracted_flow) {
+  CHECK_NOTNULL(extracted_flow);
+  boost::timer::cpu_timer solver_timer;
+  BuildResidualGraph(graph);
+  // With a warm start, only the arcs whose cost changed (or whose end nodes
+  // are new) can violate the optimality conditions. Hence, only the flow that
+  // we push here and the flow displaced by changed bounds and excesses has to
+  // be routed by the iterations below.
+  SaturateNegativeArcs();
+  excess_nodes_.clear();
+  for (uint64_t node_id = 0; node_id < excess_.size(); ++node_id) {
+    if (excess_[node_id] > 0) {
+      excess_nodes_.push_back(node_id);
+    }
+  }
+  num_iterations_ = 0;
+  while (true) {
+    // Nodes never gain excess during augmentations, so we only have to
+    // remove the nodes that have no excess left.
+    excess_nodes_.erase(
+        remove_if(excess_nodes_.begin(), excess_nodes_.end(),
+                  [this](uint64_t node_id) {
+                    return excess_[node_id] <= 0;
+                  }),
+        excess_nodes_.end());
+    if (excess_nodes_.empty()) {
+      break;
+    }
+    uint64_t deficit_node = FindShortestPath();
+    if (deficit_node == kNoNode) {
+      LOG(FATAL) << "Flow network is infeasible: " << excess_nodes_.size()
+                 << " nodes with excess cannot reach a node with deficit";
+    }
+    AugmentShortestPath(deficit_node);
+    AugmentAdmissiblePaths();
+    num_iterations_++;
+  }
+  ExtractFlow(graph, extracted_flow);
+  VLOG(1) << "Primal-dual solver finished after " << num_iterations_
+          << " shortest path iterations";
+  return static_cast<uint64_t>(solver_timer.elapsed().wall) /
+    NANOSECONDS_IN_MICROSECOND;
+}
+
+}  // namespace firmament
@@ -0,0 +1,144 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Linked-in primal-dual (successive shortest path) min-cost flow solver. The
+// solver operates directly on the FlowGraph and avoids the DIMACS
+// serialization and the process spawning required by cs2 and flowlessly.
+// Unless -primal_dual_warm_start is false, the solver keeps the flow and the
+// node potentials of a run and uses them as the starting point of the next
+// run, so that after a small graph change it only has to route the flow that
+// the change displaced.
+
+#ifndef FIRMAMENT_SCHEDULING_FLOW_PRIMAL_DUAL_SOLVER_H
+#define FIRMAMENT_SCHEDULING_FLOW_PRIMAL_DUAL_SOLVER_H
+
+#include <vector>
+
+#include "base/common.h"
+#include "base/types.h"
+#include "scheduling/flow/flow_graph.h"
+#include "scheduling/flow/solver_interface.h"
+
+namespace firmament {
+
+class PrimalDualSolver : public SolverInterface {
+ public:
+  PrimalDualSolver();
+  virtual ~PrimalDualSolver();
+  virtual void GetWarmStartState(
+      vector<int64_t>* potentials,
+      vector<unordered_map<uint64_t, uint64_t>>* flow) const;
+  virtual void SetWarmStartState(
+      const vector<int64_t>& potentials,
+      const vector<unordered_map<uint64_t, uint64_t>>& flow);
+  virtual uint64_t Solve(
+      const FlowGraph& graph,
+      vector<unordered_map<uint64_t, uint64_t>>* extracted_flow);
+  inline uint64_t num_iterations() const {
+    return num_iterations_;
+  }
+
+ private:
+  FRIEND_TEST(PrimalDualSolverTest, PotentialsKeptAcrossRounds);
+  FRIEND_TEST(PrimalDualSolverTest, WarmStartAfterGraphChange);
+
+  // Arc in the residual graph. Arcs are stored in CSR order (i.e., grouped
+  // by source node), and every arc stores the index of its reverse arc.
+  struct ResidualArc {
+    uint64_t dst_;
+    uint64_t rev_;
+    int64_t residual_;
+    int64_t cost_;
+  };
+
+  /**
+   * Pushes delta units of flow along the shortest path found by the last
+   * FindShortestPath call, which ends at node dst.
+   */
+  void AugmentShortestPath(uint64_t dst);
+
+  /**
+   * Augments flow along paths of admissible arcs (i.e., arcs with residual
+   * capacity and zero reduced cost) from excess nodes to deficit nodes.
+   */
+  void AugmentAdmissiblePaths();
+
+  /**
+   * Builds the residual graph and sends the initial flow along every arc. The
+   * initial flow is the flow the arc carried in the previous run (if warm
+   * starting is enabled), clamped to the arc's current bounds. Otherwise, it
+   * is the arc's lower bound.
+   */
+  void BuildResidualGraph(const FlowGraph& graph);
+  void ExtractFlow(const FlowGraph& graph,
+                   vector<unordered_map<uint64_t, uint64_t>>* extracted_flow);
+  uint64_t PreviousFlow(uint64_t src, uint64_t dst) const;
+
+  /**
+   * Runs Dijkstra from all the excess nodes until it reaches a deficit node,
+   * and updates the node potentials such that the reduced costs stay
+   * non-negative.
+   * @return the deficit node reached, or the maximum uint64_t value if no
+   * deficit node is reachable
+   */
+  uint64_t FindShortestPath();
+  inline int64_t ReducedCost(uint64_t src, const ResidualArc& arc) const {
+    return arc.cost_ + potentials_[src] - potentials_[arc.dst_];
+  }
+
+  /**
+   * Saturates all the arcs that have a negative reduced cost. This establishes
+   * the optimality conditions for the initial pseudo-flow.
+   */
+  void SaturateNegativeArcs();
+
+  // Residual graph: the arcs of node i are at [node_offsets_[i],
+  // node_offsets_[i + 1]) in arcs_.
+  vector<ResidualArc> arcs_;
+  vector<uint64_t> node_offsets_;
+  // Index of the forward residual arc of every graph arc.
+  vector<uint64_t> forward_arc_index_;
+  vector<const FlowGraphArc*> graph_arcs_;
+  vector<int64_t> excess_;
+  // Nodes that had excess at the beginning of the current iteration.
+  vector<uint64_t> excess_nodes_;
+  // Node potentials. They are kept in-between solver runs as they are likely
+  // to be close to the optimal potentials of the next run.
+  vector<int64_t> potentials_;
+  // Flow of the previous run, indexed by destination node id and then by
+  // source node id. Node ids may have been re-used since the previous run,
+  // but any flow that is within the arc bounds is a valid starting point.
+  vector<unordered_map<uint64_t, uint64_t>> previous_flow_;
+  // Dijkstra and DFS state.
+  vector<int64_t> distance_;
+  vector<uint64_t> parent_arc_;
+  vector<uint64_t> current_arc_;
+  vector<uint32_t> visited_;
+  vector<bool> on_path_;
+  vector<uint64_t> path_arcs_;
+  vector<uint64_t> touched_nodes_;
+  uint32_t cur_visit_counter_;
+  // Number of shortest path iterations of the last run.
+  uint64_t num_iterations_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SCHEDULING_FLOW_PRIMAL_DUAL_SOLVER_H
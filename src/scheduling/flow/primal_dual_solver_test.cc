@@ -0,0 +1,213 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Tests for the linked-in primal-dual min-cost flow solver.
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "base/common.h"
+#include "scheduling/flow/flow_graph.h"
+#include "scheduling/flow/primal_dual_solver.h"
+
+DECLARE_bool(primal_dual_warm_start);
+
+namespace firmament {
+
+// The fixture for testing the PrimalDualSolver class.
+class PrimalDualSolverTest : public ::testing::Test {
+ protected:
+  // You can remove any or all of the following functions if its body
+  // is empty.
+
+  PrimalDualSolverTest() {
+    // You can do set-up work for each test here.
+    FLAGS_v = 2;
+  }
+
+  virtual ~PrimalDualSolverTest() {
+    // You can do clean-up work that doesn't throw exceptions here.
+  }
+
+  // If the constructor and destructor are not enough for setting up
+  // and cleaning up each test, you can define the following methods:
+
+  virtual void SetUp() {
+    // Code here will be called immediately after the constructor (right
+    // before each test).
+  }
+
+  virtual void TearDown() {
+    // Code here will be called immediately after each test (right
+    // before the destructor).
+  }
+
+  // Builds a graph with two tasks, two machines and a sink. Placing task 0 on
+  // machine 1 and task 1 on machine 0 is the only optimal solution.
+  void CreateTwoTaskGraph(FlowGraph* graph) {
+    task_nodes_.clear();
+    machine_nodes_.clear();
+    for (uint32_t index = 0; index < 2; ++index) {
+      FlowGraphNode* task_node = graph->AddNode();
+      task_node->excess_ = 1;
+      task_nodes_.push_back(task_node);
+    }
+    for (uint32_t index = 0; index < 2; ++index) {
+      machine_nodes_.push_back(graph->AddNode());
+    }
+    sink_node_ = graph->AddNode();
+    sink_node_->excess_ = -2;
+    graph->ChangeArc(graph->AddArc(task_nodes_[0], machine_nodes_[0]),
+                     0, 1, 1);
+    graph->ChangeArc(graph->AddArc(task_nodes_[0], machine_nodes_[1]),
+                     0, 1, 5);
+    graph->ChangeArc(graph->AddArc(task_nodes_[1], machine_nodes_[0]),
+                     0, 1, 2);
+    graph->ChangeArc(graph->AddArc(task_nodes_[1], machine_nodes_[1]),
+                     0, 1, 10);
+    for (auto& machine_node : machine_nodes_) {
+      graph->ChangeArc(graph->AddArc(machine_node, sink_node_), 0, 1, 0);
+    }
+  }
+
+  uint64_t FlowOnArc(const vector<unordered_map<uint64_t, uint64_t>>& flow,
+                     FlowGraphNode* src, FlowGraphNode* dst) {
+    const uint64_t* arc_flow = FindOrNull(flow[dst->id_], src->id_);
+    return arc_flow == NULL ? 0 : *arc_flow;
+  }
+
+  vector<FlowGraphNode*> task_nodes_;
+  vector<FlowGraphNode*> machine_nodes_;
+  FlowGraphNode* sink_node_;
+};
+
+// Checks that the solver finds the min-cost assignment.
+TEST_F(PrimalDualSolverTest, SimpleAssignment) {
+  FlowGraph graph;
+  CreateTwoTaskGraph(&graph);
+  PrimalDualSolver solver;
+  vector<unordered_map<uint64_t, uint64_t>> flow;
+  solver.Solve(graph, &flow);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[0], machine_nodes_[0]), 0);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[0], machine_nodes_[1]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[1], machine_nodes_[0]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[1], machine_nodes_[1]), 0);
+  CHECK_EQ(FlowOnArc(flow, machine_nodes_[0], sink_node_), 1);
+  CHECK_EQ(FlowOnArc(flow, machine_nodes_[1], sink_node_), 1);
+}
+
+// Checks that the flow on an arc respects its lower bound (as is the case for
+// the arcs of the running tasks).
+TEST_F(PrimalDualSolverTest, ArcLowerBound) {
+  FlowGraph graph;
+  CreateTwoTaskGraph(&graph);
+  FlowGraphArc* arc = graph.GetArc(task_nodes_[0], machine_nodes_[0]);
+  graph.ChangeArc(arc, 1, 1, arc->cost_);
+  PrimalDualSolver solver;
+  vector<unordered_map<uint64_t, uint64_t>> flow;
+  solver.Solve(graph, &flow);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[0], machine_nodes_[0]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[1], machine_nodes_[1]), 1);
+}
+
+// Checks that arcs with negative costs are handled correctly.
+TEST_F(PrimalDualSolverTest, NegativeArcCost) {
+  FlowGraph graph;
+  CreateTwoTaskGraph(&graph);
+  FlowGraphArc* arc = graph.GetArc(task_nodes_[1], machine_nodes_[1]);
+  graph.ChangeArc(arc, 0, 1, -10);
+  PrimalDualSolver solver;
+  vector<unordered_map<uint64_t, uint64_t>> flow;
+  solver.Solve(graph, &flow);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[0], machine_nodes_[0]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[1], machine_nodes_[1]), 1);
+}
+
+// Checks that the potentials computed in a run are used by the next run, and
+// that the next run still finds the optimal solution after costs change.
+TEST_F(PrimalDualSolverTest, PotentialsKeptAcrossRounds) {
+  FlowGraph graph;
+  CreateTwoTaskGraph(&graph);
+  PrimalDualSolver solver;
+  vector<unordered_map<uint64_t, uint64_t>> flow;
+  solver.Solve(graph, &flow);
+  CHECK_GE(solver.potentials_.size(), graph.NumNodes());
+  vector<int64_t> potentials = solver.potentials_;
+  // Re-running on the same graph does not have to change the potentials.
+  flow.clear();
+  solver.Solve(graph, &flow);
+  CHECK(potentials == solver.potentials_);
+  // Make machine 1 expensive for task 0.
+  FlowGraphArc* arc = graph.GetArc(task_nodes_[0], machine_nodes_[1]);
+  graph.ChangeArc(arc, 0, 1, 20);
+  flow.clear();
+  solver.Solve(graph, &flow);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[0], machine_nodes_[0]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[1], machine_nodes_[1]), 1);
+}
+
+// Checks that a warm-started run only routes the flow that a graph change
+// displaced, and that it still finds the optimal solution.
+TEST_F(PrimalDualSolverTest, WarmStartAfterGraphChange) {
+  FLAGS_primal_dual_warm_start = true;
+  FlowGraph graph;
+  CreateTwoTaskGraph(&graph);
+  PrimalDualSolver solver;
+  vector<unordered_map<uint64_t, uint64_t>> flow;
+  solver.Solve(graph, &flow);
+  CHECK_GT(solver.num_iterations(), 0);
+  // Re-running on the same graph starts from the optimal flow.
+  flow.clear();
+  solver.Solve(graph, &flow);
+  CHECK_EQ(solver.num_iterations(), 0);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[0], machine_nodes_[1]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[1], machine_nodes_[0]), 1);
+  // Add a third task and a third machine. Only the new task's flow has to be
+  // routed.
+  FlowGraphNode* task_node = graph.AddNode();
+  task_node->excess_ = 1;
+  FlowGraphNode* machine_node = graph.AddNode();
+  graph.ChangeArc(graph.AddArc(task_node, machine_node), 0, 1, 3);
+  graph.ChangeArc(graph.AddArc(machine_node, sink_node_), 0, 1, 0);
+  sink_node_->excess_--;
+  flow.clear();
+  solver.Solve(graph, &flow);
+  CHECK_EQ(solver.num_iterations(), 1);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[0], machine_nodes_[1]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[1], machine_nodes_[0]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_node, machine_node), 1);
+  CHECK_EQ(FlowOnArc(flow, machine_node, sink_node_), 1);
+  // Remove task 0's arc to machine 1. Task 0 must move to machine 0, and
+  // task 1 to machine 1.
+  graph.DeleteArc(graph.GetArc(task_nodes_[0], machine_nodes_[1]));
+  flow.clear();
+  solver.Solve(graph, &flow);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[0], machine_nodes_[0]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_nodes_[1], machine_nodes_[1]), 1);
+  CHECK_EQ(FlowOnArc(flow, task_node, machine_node), 1);
+}
+
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -26,6 +26,8 @@
 #include <string>
 #include <unordered_map>
 
+#include <boost/bind.hpp>
+
 #include "base/common.h"
 #include "base/types.h"
 #include "base/units.h"
@@ -34,6 +36,7 @@
 #include "scheduling/common.h"
 #include "scheduling/knowledge_base.h"
 #include "scheduling/flow/cost_model_interface.h"
+#include "scheduling/flow/flow_graph_manager.h"
 
 DEFINE_double(quincy_wait_time_factor, 0.5, "The Quincy wait time factor");
 DEFINE_double(quincy_preferred_machine_data_fraction, 0.1,
@@ -85,7 +88,12 @@ QuincyCostModel::~QuincyCostModel() {
 // The cost of leaving a task unscheduled should be higher than the cost of
 // scheduling it.
 Cost_t QuincyCostModel::TaskToUnscheduledAggCost(TaskID_t task_id) {
-  const TaskDescriptor& td = GetTask(task_id);
+  return ComputeUnscheduledAggCost(GetTask(task_id),
+                                   time_manager_->GetCurrentTimestamp());
+}
+
+Cost_t QuincyCostModel::ComputeUnscheduledAggCost(const TaskDescriptor& td,
+                                                  uint64_t cur_timestamp) {
   int64_t no_delay_offset = 0;
   if (FLAGS_quincy_no_scheduling_delay) {
     // XXX(ionel): HACK! In our simulations a task doesn't have more than 39GB
@@ -104,7 +112,7 @@ Cost_t QuincyCostModel::TaskToUnscheduledAggCost(TaskID_t task_id) {
   // Include current unscheduled wait period if it hasn't yet started.
   if (td.start_time() == 0 || td.start_time() < td.submit_time()) {
     total_unscheduled_time +=
-      static_cast<int64_t>(time_manager_->GetCurrentTimestamp()) -
+      static_cast<int64_t>(cur_timestamp) -
       static_cast<int64_t>(td.submit_time());
   }
   return static_cast<Cost_t>(total_unscheduled_time *
@@ -150,7 +158,7 @@ Cost_t QuincyCostModel::GetTransferCostToNotPreferredRes(
     // different resource.
     TaskDescriptor* td_ptr = GetMutableTask(task_id);
     ResourceID_t machine_res_id =
-      MachineResIDForResource(resource_map_, res_id);
+      flow_graph_manager_->MachineResIDForResource(res_id);
     uint64_t data_on_rack = 0;
     uint64_t data_on_machine = 0;
     uint64_t input_size =
@@ -184,7 +192,7 @@ Cost_t QuincyCostModel::TaskContinuationCost(TaskID_t task_id) {
   const TaskDescriptor& td = GetTask(task_id);
   ResourceID_t pu_res_id = ResourceIDFromString(td.scheduled_to_resource());
   ResourceID_t machine_res_id =
-    MachineResIDForResource(resource_map_, pu_res_id);
+    flow_graph_manager_->MachineResIDForResource(pu_res_id);
   Cost_t cost_to_resource = TaskToResourceNodeCost(task_id, machine_res_id);
   // NOTE: total_run_time only includes the time of previous runs. We need
   // to include the current run time as well in order for the continuation
@@ -242,49 +250,170 @@ pair<Cost_t, uint64_t> QuincyCostModel::EquivClassToEquivClass(
   }
 }
 
+void QuincyCostModel::TaskToUnscheduledAggCosts(
+    const vector<TaskID_t>& task_ids,
+    vector<Cost_t>* costs) {
+  CHECK_NOTNULL(costs);
+  costs->resize(task_ids.size());
+  // We read the time once so that all the tasks in the batch see the same
+  // timestamp.
+  ParallelForRanges(
+      task_ids.size(),
+      boost::bind(&QuincyCostModel::ComputeTaskToUnscheduledAggCosts, this,
+                  boost::cref(task_ids), time_manager_->GetCurrentTimestamp(),
+                  costs, _1, _2));
+}
+
+void QuincyCostModel::ComputeTaskToUnscheduledAggCosts(
+    const vector<TaskID_t>& task_ids,
+    uint64_t cur_timestamp,
+    vector<Cost_t>* costs,
+    uint64_t begin, uint64_t end) {
+  for (uint64_t index = begin; index < end; ++index) {
+    (*costs)[index] =
+      ComputeUnscheduledAggCost(GetTask(task_ids[index]), cur_timestamp);
+  }
+}
+
+void QuincyCostModel::TaskToResourceNodeCosts(
+    const vector<pair<TaskID_t, ResourceID_t>>& task_res,
+    vector<Cost_t>* costs) {
+  CHECK_NOTNULL(costs);
+  costs->resize(task_res.size());
+  // The batches usually contain the preferences of a single task. Hence, we
+  // only look up the task's preferred machines when the task changes.
+  // N.B.: The costs are computed sequentially because the method may update
+  // the cached costs of the running arcs.
+  TaskID_t cur_task_id = 0;
+  unordered_map<ResourceID_t, Cost_t, boost::hash<ResourceID_t>>*
+    machines_data = NULL;
+  for (uint64_t index = 0; index < task_res.size(); ++index) {
+    TaskID_t task_id = task_res[index].first;
+    if (index == 0 || task_id != cur_task_id) {
+      cur_task_id = task_id;
+      machines_data = FindOrNull(task_preferred_machines_, task_id);
+    }
+    Cost_t* transfer_cost =
+      machines_data ? FindOrNull(*machines_data, task_res[index].second)
+                    : NULL;
+    if (transfer_cost) {
+      (*costs)[index] = *transfer_cost + FLAGS_quincy_positive_cost_offset;
+    } else {
+      (*costs)[index] =
+        GetTransferCostToNotPreferredRes(task_id, task_res[index].second) +
+        FLAGS_quincy_positive_cost_offset;
+    }
+  }
+}
+
+void QuincyCostModel::TaskToEquivClassAggregatorCosts(
+    const vector<pair<TaskID_t, EquivClass_t>>& task_ecs,
+    vector<Cost_t>* costs) {
+  CHECK_NOTNULL(costs);
+  costs->resize(task_ecs.size());
+  TaskID_t cur_task_id = 0;
+  unordered_map<EquivClass_t, Cost_t>* ec_costs = NULL;
+  for (uint64_t index = 0; index < task_ecs.size(); ++index) {
+    if (index == 0 || task_ecs[index].first != cur_task_id) {
+      cur_task_id = task_ecs[index].first;
+      ec_costs = FindOrNull(task_preferred_ecs_, cur_task_id);
+      CHECK_NOTNULL(ec_costs);
+    }
+    Cost_t* transfer_cost = FindOrNull(*ec_costs, task_ecs[index].second);
+    CHECK_NOTNULL(transfer_cost);
+    (*costs)[index] = *transfer_cost + FLAGS_quincy_positive_cost_offset;
+  }
+}
+
+void QuincyCostModel::EquivClassToResourceNodeCosts(
+    const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+    vector<pair<Cost_t, uint64_t>>* costs_and_caps) {
+  CHECK_NOTNULL(costs_and_caps);
+  costs_and_caps->resize(ec_res.size());
+  ParallelForRanges(
+      ec_res.size(),
+      boost::bind(&QuincyCostModel::ComputeEquivClassToResourceNodeCosts,
+                  this, boost::cref(ec_res), costs_and_caps, _1, _2));
+}
+
+void QuincyCostModel::ComputeEquivClassToResourceNodeCosts(
+    const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+    vector<pair<Cost_t, uint64_t>>* costs_and_caps,
+    uint64_t begin, uint64_t end) {
+  for (uint64_t index = begin; index < end; ++index) {
+    (*costs_and_caps)[index] =
+      EquivClassToResourceNode(ec_res[index].first, ec_res[index].second);
+  }
+}
+
 vector<EquivClass_t>* QuincyCostModel::GetTaskEquivClasses(TaskID_t task_id) {
+  vector<EquivClass_t>* task_ecs = new vector<EquivClass_t>();
+  FillTaskEquivClasses(task_id, task_ecs);
+  return task_ecs;
+}
+
+void QuincyCostModel::FillTaskEquivClasses(TaskID_t task_id,
+                                           vector<EquivClass_t>* task_ecs) {
   auto ecs_data = FindOrNull(task_preferred_ecs_, task_id);
   CHECK_NOTNULL(ecs_data);
-  vector<EquivClass_t>* task_ecs = new vector<EquivClass_t>();
+  task_ecs->clear();
   for (auto& ec_data : *ecs_data) {
     task_ecs->push_back(ec_data.first);
   }
-  return task_ecs;
 }
 
 vector<ResourceID_t>* QuincyCostModel::GetOutgoingEquivClassPrefArcs(
     EquivClass_t ec) {
+  vector<ResourceID_t>* pref_res = new vector<ResourceID_t>();
+  FillOutgoingEquivClassPrefArcs(ec, pref_res);
+  return pref_res;
+}
+
+void QuincyCostModel::FillOutgoingEquivClassPrefArcs(
+    EquivClass_t ec,
+    vector<ResourceID_t>* pref_res) {
   if (ec == cluster_aggregator_ec_) {
     // The cluster aggregator is not directly connected to any resource.
-    return NULL;
+    pref_res->clear();
   } else {
     const auto& rack_machine_res = data_layer_manager_->GetMachinesInRack(ec);
-    vector<ResourceID_t>* pref_res =
-      new vector<ResourceID_t>(rack_machine_res.begin(),
-                               rack_machine_res.end());
-    return pref_res;
+    pref_res->assign(rack_machine_res.begin(), rack_machine_res.end());
   }
 }
 
 vector<ResourceID_t>* QuincyCostModel::GetTaskPreferenceArcs(TaskID_t task_id) {
+  vector<ResourceID_t>* preferred_machines = new vector<ResourceID_t>();
+  FillTaskPreferenceArcs(task_id, preferred_machines);
+  return preferred_machines;
+}
+
+void QuincyCostModel::FillTaskPreferenceArcs(
+    TaskID_t task_id,
+    vector<ResourceID_t>* preferred_machines) {
   auto machines_data = FindOrNull(task_preferred_machines_, task_id);
   CHECK_NOTNULL(machines_data);
-  vector<ResourceID_t>* preferred_machines = new vector<ResourceID_t>();
+  preferred_machines->clear();
   for (auto& machine_data : *machines_data) {
     preferred_machines->push_back(machine_data.first);
   }
-  return preferred_machines;
 }
 
 vector<EquivClass_t>* QuincyCostModel::GetEquivClassToEquivClassesArcs(
     EquivClass_t ec) {
+  vector<EquivClass_t>* outgoing_ec = new vector<EquivClass_t>();
+  FillEquivClassToEquivClassesArcs(ec, outgoing_ec);
+  return outgoing_ec;
+}
+
+void QuincyCostModel::FillEquivClassToEquivClassesArcs(
+    EquivClass_t ec,
+    vector<EquivClass_t>* outgoing_ec) {
+  // N.B.: GetRackIDs appends to the vector.
+  outgoing_ec->clear();
   if (ec == cluster_aggregator_ec_) {
-    vector<EquivClass_t>* outgoing_ec = new vector<EquivClass_t>();
     data_layer_manager_->GetRackIDs(outgoing_ec);
-    return outgoing_ec;
   }
   // The rack aggregators are only connected to resources.
-  return NULL;
 }
 
 void QuincyCostModel::AddMachine(
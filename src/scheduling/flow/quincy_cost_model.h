@@ -73,11 +73,31 @@ class QuincyCostModel : public CostModelInterface {
       ResourceID_t res_id);
   pair<Cost_t, uint64_t> EquivClassToEquivClass(EquivClass_t tec1,
                                                 EquivClass_t tec2);
+  // Batch cost methods
+  void TaskToUnscheduledAggCosts(const vector<TaskID_t>& task_ids,
+                                 vector<Cost_t>* costs);
+  void TaskToResourceNodeCosts(
+      const vector<pair<TaskID_t, ResourceID_t>>& task_res,
+      vector<Cost_t>* costs);
+  void TaskToEquivClassAggregatorCosts(
+      const vector<pair<TaskID_t, EquivClass_t>>& task_ecs,
+      vector<Cost_t>* costs);
+  void EquivClassToResourceNodeCosts(
+      const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+      vector<pair<Cost_t, uint64_t>>* costs_and_caps);
   // Get the type of equiv class.
   vector<EquivClass_t>* GetEquivClassToEquivClassesArcs(EquivClass_t tec);
   vector<ResourceID_t>* GetOutgoingEquivClassPrefArcs(EquivClass_t tec);
   vector<EquivClass_t>* GetTaskEquivClasses(TaskID_t task_id);
   vector<ResourceID_t>* GetTaskPreferenceArcs(TaskID_t task_id);
+  void FillTaskEquivClasses(TaskID_t task_id,
+                            vector<EquivClass_t>* equiv_classes);
+  void FillOutgoingEquivClassPrefArcs(EquivClass_t tec,
+                                      vector<ResourceID_t>* pref_res);
+  void FillTaskPreferenceArcs(TaskID_t task_id,
+                              vector<ResourceID_t>* pref_res);
+  void FillEquivClassToEquivClassesArcs(EquivClass_t tec,
+                                        vector<EquivClass_t>* pref_ecs);
   void AddMachine(ResourceTopologyNodeDescriptor* rtnd_ptr);
   void AddTask(TaskID_t task_id);
   void RemoveMachine(ResourceID_t res_id);
@@ -85,6 +105,12 @@ class QuincyCostModel : public CostModelInterface {
   FlowGraphNode* GatherStats(FlowGraphNode* accumulator, FlowGraphNode* other);
   void PrepareStats(FlowGraphNode* accumulator);
   FlowGraphNode* UpdateStats(FlowGraphNode* accumulator, FlowGraphNode* other);
+  bool StatsAreThreadSafe() const {
+    return true;
+  }
+  bool StatsDependOnMachineSamples() const {
+    return false;
+  }
 
  private:
   uint64_t ComputeClusterDataStatistics(
@@ -114,6 +140,24 @@ class QuincyCostModel : public CostModelInterface {
       const unordered_map<ResourceID_t, uint64_t,
         boost::hash<ResourceID_t>>& data_on_machines);
   void ConstructTaskPreferredSet(TaskID_t task_id);
+  /**
+   * Computes the costs of the arcs from tasks to their unscheduled
+   * aggregators for the tasks in [begin, end). The method only reads state,
+   * and can thus be invoked concurrently on disjoint ranges.
+   * @param task_ids the tasks for which to compute the costs
+   * @param cur_timestamp the current time
+   * @param costs the vector in which to store the costs
+   */
+  void ComputeTaskToUnscheduledAggCosts(const vector<TaskID_t>& task_ids,
+                                        uint64_t cur_timestamp,
+                                        vector<Cost_t>* costs,
+                                        uint64_t begin, uint64_t end);
+  void ComputeEquivClassToResourceNodeCosts(
+      const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+      vector<pair<Cost_t, uint64_t>>* costs_and_caps,
+      uint64_t begin, uint64_t end);
+  Cost_t ComputeUnscheduledAggCost(const TaskDescriptor& td,
+                                   uint64_t cur_timestamp);
   /**
    * Get the transfer cost to a resource that is not preferred and on which
    * the task is currently running.
@@ -111,9 +111,16 @@ pair<Cost_t, uint64_t> RandomCostModel::EquivClassToEquivClass(
   return pair<Cost_t, uint64_t>(0LL, 0ULL);
 }
 
-vector<EquivClass_t>* RandomCostModel::GetTaskEquivClasses(
-    TaskID_t task_id) {
+vector<EquivClass_t>* RandomCostModel::GetTaskEquivClasses(TaskID_t task_id) {
   vector<EquivClass_t>* equiv_classes = new vector<EquivClass_t>();
+  FillTaskEquivClasses(task_id, equiv_classes);
+  return equiv_classes;
+}
+
+void RandomCostModel::FillTaskEquivClasses(
+    TaskID_t task_id,
+    vector<EquivClass_t>* equiv_classes) {
+  equiv_classes->clear();
   // All tasks have an arc to the cluster aggregator.
   equiv_classes->push_back(cluster_aggregator_ec_);
   // An additional TEC is the hash of the task binary name.
@@ -132,12 +139,19 @@ vector<EquivClass_t>* RandomCostModel::GetTaskEquivClasses(
     task_set.insert(task_id);
     CHECK(InsertIfNotPresent(&task_ec_to_set_task_id_, task_agg, task_set));
   }
-  return equiv_classes;
 }
 
 vector<ResourceID_t>* RandomCostModel::GetOutgoingEquivClassPrefArcs(
     EquivClass_t ec) {
   vector<ResourceID_t>* arc_destinations = new vector<ResourceID_t>();
+  FillOutgoingEquivClassPrefArcs(ec, arc_destinations);
+  return arc_destinations;
+}
+
+void RandomCostModel::FillOutgoingEquivClassPrefArcs(
+    EquivClass_t ec,
+    vector<ResourceID_t>* arc_destinations) {
+  arc_destinations->clear();
   if (ec == cluster_aggregator_ec_) {
     // Cluster aggregator, put arcs to all machines
     for (auto it = machines_.begin();
@@ -153,18 +167,32 @@ vector<ResourceID_t>* RandomCostModel::GetOutgoingEquivClassPrefArcs(
       arc_destinations->push_back(PickRandomResourceID(*leaf_res_ids_));
     }
   }
-  return arc_destinations;
 }
 
 vector<ResourceID_t>* RandomCostModel::GetTaskPreferenceArcs(TaskID_t task_id) {
   vector<ResourceID_t>* prefered_res = new vector<ResourceID_t>();
+  FillTaskPreferenceArcs(task_id, prefered_res);
   return prefered_res;
 }
 
+void RandomCostModel::FillTaskPreferenceArcs(
+    TaskID_t task_id,
+    vector<ResourceID_t>* prefered_res) {
+  prefered_res->clear();
+}
+
 vector<EquivClass_t>* RandomCostModel::GetEquivClassToEquivClassesArcs(
     EquivClass_t ec) {
+  vector<EquivClass_t>* pref_ecs = new vector<EquivClass_t>();
+  FillEquivClassToEquivClassesArcs(ec, pref_ecs);
+  return pref_ecs;
+}
+
+void RandomCostModel::FillEquivClassToEquivClassesArcs(
+    EquivClass_t ec,
+    vector<EquivClass_t>* pref_ecs) {
   // Not used in the random cost model
-  return NULL;
+  pref_ecs->clear();
 }
 
 void RandomCostModel::AddMachine(
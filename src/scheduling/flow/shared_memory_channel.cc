@@ -0,0 +1,93 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Implementation of the shared memory channel to the solver.
+
+#include "scheduling/flow/shared_memory_channel.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace firmament {
+
+SharedMemoryChannel::SharedMemoryChannel()
+  : memory_(NULL), memory_size_(0), owner_(false) {
+}
+
+SharedMemoryChannel::~SharedMemoryChannel() {
+  if (memory_ != NULL) {
+    // Tell the other side that we're going away.
+    to_solver_.Close();
+    from_solver_.Close();
+    CHECK_EQ(munmap(memory_, memory_size_), 0);
+  }
+  if (owner_) {
+    shm_unlink(name_.c_str());
+  }
+}
+
+void SharedMemoryChannel::Attach(const string& name) {
+  CHECK(memory_ == NULL);
+  name_ = name;
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    PLOG(FATAL) << "Could not open shared memory object " << name;
+  }
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0);
+  memory_size_ = static_cast<uint64_t>(st.st_size);
+  memory_ = mmap(NULL, memory_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 0);
+  CHECK_EQ(close(fd), 0);
+  if (memory_ == MAP_FAILED) {
+    PLOG(FATAL) << "Could not map shared memory object " << name;
+  }
+  char* ring_memory = reinterpret_cast<char*>(memory_);
+  to_solver_.Attach(ring_memory);
+  from_solver_.Attach(ring_memory + memory_size_ / 2);
+}
+
+void SharedMemoryChannel::Create(const string& name, uint64_t capacity) {
+  CHECK(memory_ == NULL);
+  name_ = name;
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    PLOG(FATAL) << "Could not create shared memory object " << name;
+  }
+  owner_ = true;
+  uint64_t ring_size = SharedMemoryRing::MemorySize(capacity);
+  memory_size_ = 2 * ring_size;
+  if (ftruncate(fd, static_cast<off_t>(memory_size_)) != 0) {
+    PLOG(FATAL) << "Could not resize shared memory object " << name;
+  }
+  memory_ = mmap(NULL, memory_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 0);
+  CHECK_EQ(close(fd), 0);
+  if (memory_ == MAP_FAILED) {
+    PLOG(FATAL) << "Could not map shared memory object " << name;
+  }
+  char* ring_memory = reinterpret_cast<char*>(memory_);
+  to_solver_.Initialize(ring_memory, capacity);
+  from_solver_.Initialize(ring_memory + ring_size, capacity);
+}
+
+}  // namespace firmament
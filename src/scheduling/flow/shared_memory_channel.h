@@ -0,0 +1,77 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Named POSIX shared memory object that holds two ring buffers: one for the
+// graph changes sent to the solver and one for the solver's replies. Both
+// directions carry messages in the binary wire format (solver_wire_format.h).
+
+#ifndef FIRMAMENT_SCHEDULING_FLOW_SHARED_MEMORY_CHANNEL_H
+#define FIRMAMENT_SCHEDULING_FLOW_SHARED_MEMORY_CHANNEL_H
+
+#include <string>
+
+#include "base/common.h"
+#include "base/types.h"
+#include "scheduling/flow/shared_memory_ring.h"
+
+namespace firmament {
+
+class SharedMemoryChannel {
+ public:
+  SharedMemoryChannel();
+  ~SharedMemoryChannel();
+
+  /**
+   * Maps an existing shared memory object (used by the solver).
+   * @param name the name of the shared memory object
+   */
+  void Attach(const string& name);
+
+  /**
+   * Creates and maps a new shared memory object. The object is unlinked
+   * when the channel is destroyed.
+   * @param name the name of the shared memory object (e.g., "/firmament")
+   * @param capacity the number of data bytes each of the two rings can hold
+   */
+  void Create(const string& name, uint64_t capacity);
+
+  inline SharedMemoryRing* from_solver() {
+    return &from_solver_;
+  }
+  inline const string& name() const {
+    return name_;
+  }
+  inline SharedMemoryRing* to_solver() {
+    return &to_solver_;
+  }
+
+ private:
+  string name_;
+  void* memory_;
+  uint64_t memory_size_;
+  // True if this channel created the shared memory object.
+  bool owner_;
+  SharedMemoryRing to_solver_;
+  SharedMemoryRing from_solver_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SCHEDULING_FLOW_SHARED_MEMORY_CHANNEL_H
@@ -0,0 +1,191 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Tests for the shared memory channel between the scheduler and the solver.
+
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "base/common.h"
+#include "misc/string_utils.h"
+#include "scheduling/flow/binary_exporter.h"
+#include "scheduling/flow/dimacs_add_node.h"
+#include "scheduling/flow/dimacs_remove_node.h"
+#include "scheduling/flow/flow_graph.h"
+#include "scheduling/flow/shared_memory_channel.h"
+
+namespace firmament {
+
+// The fixture for testing the SharedMemoryChannel class.
+class SharedMemoryChannelTest : public ::testing::Test {
+ protected:
+  // You can remove any or all of the following functions if its body
+  // is empty.
+
+  SharedMemoryChannelTest() {
+    // You can do set-up work for each test here.
+    FLAGS_v = 2;
+    spf(&shm_name_, "/firmament_shm_test_%d", getpid());
+  }
+
+  virtual ~SharedMemoryChannelTest() {
+    // You can do clean-up work that doesn't throw exceptions here.
+  }
+
+  // If the constructor and destructor are not enough for setting up
+  // and cleaning up each test, you can define the following methods:
+
+  virtual void SetUp() {
+    // Code here will be called immediately after the constructor (right
+    // before each test).
+  }
+
+  virtual void TearDown() {
+    // Code here will be called immediately after each test (right
+    // before the destructor).
+  }
+
+  // Mock solver: for every delta it receives, it assigns each added task
+  // node to the PU node with id 1. It exits once it receives EOS. Returns
+  // the number of rounds it has processed.
+  static int RunMockSolver(const string& shm_name) {
+    SharedMemoryChannel channel;
+    channel.Attach(shm_name);
+    int num_rounds = 0;
+    while (true) {
+      SolverWireHeader header;
+      if (!channel.to_solver()->Read(&header, sizeof(SolverWireHeader)) ||
+          header.magic_ != kSolverWireMagic) {
+        return -1;
+      }
+      if (header.message_type_ == SOLVER_WIRE_EOS) {
+        return num_rounds;
+      }
+      vector<SolverWireRecord> assignments;
+      for (uint64_t index = 0; index < header.num_records_; ++index) {
+        SolverWireRecord record;
+        if (!channel.to_solver()->Read(&record, sizeof(SolverWireRecord))) {
+          return -1;
+        }
+        if (record.kind_ == SOLVER_WIRE_NODE) {
+          SolverWireRecord assignment;
+          memset(&assignment, 0, sizeof(SolverWireRecord));
+          assignment.kind_ = SOLVER_WIRE_TASK_ASSIGNMENT;
+          assignment.src_ = record.src_;
+          assignment.dst_ = 1;
+          assignments.push_back(assignment);
+        }
+      }
+      SolverWireHeader reply;
+      memset(&reply, 0, sizeof(SolverWireHeader));
+      reply.magic_ = kSolverWireMagic;
+      reply.message_type_ = SOLVER_WIRE_ASSIGNMENTS;
+      reply.num_records_ = assignments.size();
+      reply.algorithm_runtime_ = 42;
+      struct iovec iov[2];
+      iov[0].iov_base = &reply;
+      iov[0].iov_len = sizeof(SolverWireHeader);
+      iov[1].iov_base = assignments.empty() ? NULL : &assignments[0];
+      iov[1].iov_len = assignments.size() * sizeof(SolverWireRecord);
+      if (!channel.from_solver()->Write(iov, 2)) {
+        return -1;
+      }
+      num_rounds++;
+    }
+  }
+
+  // Sends a round of node additions to the mock solver and checks that it
+  // assigns all the task nodes.
+  void RunRound(SharedMemoryChannel* channel, BinaryExporter* exporter,
+                uint64_t num_tasks) {
+    FlowGraph graph;
+    vector<DIMACSChange*> changes;
+    vector<FlowGraphNode*> task_nodes;
+    for (uint64_t index = 0; index < num_tasks; ++index) {
+      FlowGraphNode* node = graph.AddNode();
+      node->type_ = FlowNodeType::UNSCHEDULED_TASK;
+      task_nodes.push_back(node);
+      changes.push_back(new DIMACSAddNode(*node, vector<FlowGraphArc*>()));
+      changes.push_back(new DIMACSRemoveNode(*node));
+    }
+    exporter->ExportIncremental(changes, channel->to_solver());
+    SolverWireHeader header;
+    CHECK(channel->from_solver()->Read(&header, sizeof(SolverWireHeader)));
+    CHECK_EQ(header.message_type_, SOLVER_WIRE_ASSIGNMENTS);
+    CHECK_EQ(header.num_records_, num_tasks);
+    CHECK_EQ(header.algorithm_runtime_, 42);
+    for (uint64_t index = 0; index < num_tasks; ++index) {
+      SolverWireRecord record;
+      CHECK(channel->from_solver()->Read(&record, sizeof(SolverWireRecord)));
+      CHECK_EQ(record.kind_, SOLVER_WIRE_TASK_ASSIGNMENT);
+      CHECK_EQ(record.src_, task_nodes[index]->id_);
+      CHECK_EQ(record.dst_, 1);
+    }
+    for (auto& change : changes) {
+      delete change;
+    }
+  }
+
+  string shm_name_;
+};
+
+// Runs several rounds against a mock solver process. The rings are smaller
+// than the messages, which makes both sides wait for each other and wrap
+// around the end of the rings.
+TEST_F(SharedMemoryChannelTest, MockSolverRounds) {
+  SharedMemoryChannel* channel = new SharedMemoryChannel();
+  channel->Create(shm_name_, 1000);
+  pid_t pid = fork();
+  CHECK_GE(pid, 0);
+  if (pid == 0) {
+    _exit(RunMockSolver(shm_name_));
+  }
+  BinaryExporter exporter;
+  RunRound(channel, &exporter, 1);
+  RunRound(channel, &exporter, 100);
+  RunRound(channel, &exporter, 7);
+  exporter.ExportEndOfStream(channel->to_solver());
+  int status;
+  CHECK_EQ(waitpid(pid, &status, 0), pid);
+  CHECK(WIFEXITED(status));
+  CHECK_EQ(WEXITSTATUS(status), 3);
+  delete channel;
+}
+
+// Checks that a reader notices when the other side closes the ring.
+TEST_F(SharedMemoryChannelTest, ReadFromClosedRing) {
+  SharedMemoryChannel channel;
+  channel.Create(shm_name_, 1000);
+  channel.from_solver()->Close();
+  SolverWireHeader header;
+  CHECK(!channel.from_solver()->Read(&header, sizeof(SolverWireHeader)));
+}
+
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
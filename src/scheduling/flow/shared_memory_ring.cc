@@ -0,0 +1,174 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Implementation of the shared memory ring buffer.
+
+#include "scheduling/flow/shared_memory_ring.h"
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace firmament {
+
+// Waits are bounded so that we notice when the other side closes the ring
+// without being able to wake us up (e.g., because it crashed).
+static const long kFutexWaitTimeoutNs = 100 * 1000 * 1000;
+
+SharedMemoryRing::SharedMemoryRing() : control_(NULL), data_(NULL) {
+}
+
+void SharedMemoryRing::Attach(void* memory) {
+  control_ = reinterpret_cast<SharedMemoryRingControl*>(memory);
+  data_ = reinterpret_cast<char*>(memory) + sizeof(SharedMemoryRingControl);
+  CHECK_GT(control_->capacity_, 0);
+}
+
+void SharedMemoryRing::Close() {
+  CHECK_NOTNULL(control_);
+  control_->closed_.store(1, std::memory_order_release);
+  WakeUp(&control_->write_seq_, &control_->write_waiters_);
+  WakeUp(&control_->read_seq_, &control_->read_waiters_);
+}
+
+void SharedMemoryRing::Initialize(void* memory, uint64_t capacity) {
+  SharedMemoryRingControl* control =
+    reinterpret_cast<SharedMemoryRingControl*>(memory);
+  control->write_pos_.store(0, std::memory_order_relaxed);
+  control->write_seq_.store(0, std::memory_order_relaxed);
+  control->closed_.store(0, std::memory_order_relaxed);
+  control->write_waiters_.store(0, std::memory_order_relaxed);
+  control->read_pos_.store(0, std::memory_order_relaxed);
+  control->read_seq_.store(0, std::memory_order_relaxed);
+  control->read_waiters_.store(0, std::memory_order_relaxed);
+  control->capacity_ = capacity;
+  std::atomic_thread_fence(std::memory_order_release);
+  Attach(memory);
+}
+
+bool SharedMemoryRing::IsClosed() const {
+  return control_->closed_.load(std::memory_order_acquire) != 0;
+}
+
+bool SharedMemoryRing::Read(void* buffer, uint64_t length) {
+  char* position = reinterpret_cast<char*>(buffer);
+  uint64_t read_pos = control_->read_pos_.load(std::memory_order_relaxed);
+  while (length > 0) {
+    uint32_t write_seq = control_->write_seq_.load(std::memory_order_acquire);
+    uint64_t available =
+      control_->write_pos_.load(std::memory_order_acquire) - read_pos;
+    if (available == 0) {
+      if (IsClosed()) {
+        return false;
+      }
+      WaitForChange(&control_->write_seq_, write_seq,
+                    &control_->write_waiters_);
+      continue;
+    }
+    // Copy as much as we can without wrapping around the end of the ring.
+    uint64_t offset = read_pos % control_->capacity_;
+    uint64_t to_copy =
+      min(min(available, length), control_->capacity_ - offset);
+    memcpy(position, data_ + offset, to_copy);
+    position += to_copy;
+    length -= to_copy;
+    read_pos += to_copy;
+    control_->read_pos_.store(read_pos, std::memory_order_release);
+    WakeUp(&control_->read_seq_, &control_->read_waiters_);
+  }
+  return true;
+}
+
+void SharedMemoryRing::WaitForChange(std::atomic<uint32_t>* seq,
+                                     uint32_t old_seq,
+                                     std::atomic<uint32_t>* waiters) {
+  struct timespec timeout;
+  timeout.tv_sec = 0;
+  timeout.tv_nsec = kFutexWaitTimeoutNs;
+  // Announce the waiter before the futex checks the sequence number. Either
+  // the other side sees the waiter and wakes us up, or it has incremented
+  // the sequence number before it looked, and the futex does not wait.
+  waiters->fetch_add(1, std::memory_order_seq_cst);
+  // N.B.: the futex must not be FUTEX_PRIVATE because it is shared between
+  // processes. EAGAIN means that the sequence number has already changed.
+  if (syscall(SYS_futex, reinterpret_cast<uint32_t*>(seq), FUTEX_WAIT,
+              old_seq, &timeout, NULL, 0) != 0 &&
+      errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+    PLOG(FATAL) << "Failed to wait on shared memory ring";
+  }
+  waiters->fetch_sub(1, std::memory_order_relaxed);
+}
+
+void SharedMemoryRing::WakeUp(std::atomic<uint32_t>* seq,
+                              std::atomic<uint32_t>* waiters) {
+  seq->fetch_add(1, std::memory_order_seq_cst);
+  // Skip the syscall if nobody waits, which is the common case when both
+  // sides keep up with each other.
+  if (waiters->load(std::memory_order_seq_cst) == 0) {
+    return;
+  }
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(seq), FUTEX_WAKE, INT_MAX,
+          NULL, NULL, 0);
+}
+
+bool SharedMemoryRing::Write(const struct iovec* iov, int iovcnt) {
+  for (int index = 0; index < iovcnt; ++index) {
+    if (!WriteBytes(reinterpret_cast<const char*>(iov[index].iov_base),
+                    iov[index].iov_len)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SharedMemoryRing::WriteBytes(const char* data, uint64_t length) {
+  uint64_t write_pos = control_->write_pos_.load(std::memory_order_relaxed);
+  while (length > 0) {
+    if (IsClosed()) {
+      return false;
+    }
+    uint32_t read_seq = control_->read_seq_.load(std::memory_order_acquire);
+    uint64_t free_space = control_->capacity_ -
+      (write_pos - control_->read_pos_.load(std::memory_order_acquire));
+    if (free_space == 0) {
+      WaitForChange(&control_->read_seq_, read_seq,
+                    &control_->read_waiters_);
+      continue;
+    }
+    uint64_t offset = write_pos % control_->capacity_;
+    uint64_t to_copy =
+      min(min(free_space, length), control_->capacity_ - offset);
+    memcpy(data_ + offset, data, to_copy);
+    data += to_copy;
+    length -= to_copy;
+    write_pos += to_copy;
+    control_->write_pos_.store(write_pos, std::memory_order_release);
+    WakeUp(&control_->write_seq_, &control_->write_waiters_);
+  }
+  return true;
+}
+
+}  // namespace firmament
@@ -0,0 +1,109 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Single-producer single-consumer byte ring buffer that lives in memory
+// shared between two processes. The consumer waits for data and the producer
+// waits for free space using futexes on sequence counters that are stored in
+// the shared memory, too.
+
+#ifndef FIRMAMENT_SCHEDULING_FLOW_SHARED_MEMORY_RING_H
+#define FIRMAMENT_SCHEDULING_FLOW_SHARED_MEMORY_RING_H
+
+#include <sys/uio.h>
+#include <atomic>
+
+#include "base/common.h"
+#include "base/types.h"
+
+namespace firmament {
+
+// Control block at the beginning of the ring's memory. The positions are
+// byte counts since the ring was initialized; they never wrap.
+struct SharedMemoryRingControl {
+  std::atomic<uint64_t> write_pos_;
+  // Futex word that is incremented whenever the producer publishes data.
+  std::atomic<uint32_t> write_seq_;
+  // Set by either side to indicate that it won't use the ring anymore.
+  std::atomic<uint32_t> closed_;
+  // Number of consumers that are waiting on write_seq_. The producer only
+  // makes the futex wake-up syscall if it is non-zero.
+  std::atomic<uint32_t> write_waiters_;
+  // Keep the producer's and the consumer's fields on separate cache lines.
+  char padding0_[44];
+  std::atomic<uint64_t> read_pos_;
+  // Futex word that is incremented whenever the consumer frees space.
+  std::atomic<uint32_t> read_seq_;
+  // Number of producers that are waiting on read_seq_.
+  std::atomic<uint32_t> read_waiters_;
+  char padding1_[48];
+  uint64_t capacity_;
+  char padding2_[56];
+};
+
+class SharedMemoryRing {
+ public:
+  SharedMemoryRing();
+
+  /**
+   * Sets up the ring in memory that has already been initialized (e.g., by
+   * the other process).
+   * @param memory the start of the ring's memory
+   */
+  void Attach(void* memory);
+  void Close();
+
+  /**
+   * Initializes the ring's control block and sets up the ring.
+   * @param memory the start of the ring's memory; it must be at least
+   * MemorySize(capacity) bytes long
+   * @param capacity the number of data bytes the ring can hold
+   */
+  void Initialize(void* memory, uint64_t capacity);
+  bool IsClosed() const;
+
+  /**
+   * Reads exactly length bytes. It blocks until enough data is available.
+   * @return false if the ring was closed before all the bytes were read
+   */
+  bool Read(void* buffer, uint64_t length);
+
+  /**
+   * Writes all the data described by the iovecs. It blocks while the ring
+   * is full.
+   * @return false if the ring was closed before all the data was written
+   */
+  bool Write(const struct iovec* iov, int iovcnt);
+  static uint64_t MemorySize(uint64_t capacity) {
+    return sizeof(SharedMemoryRingControl) + capacity;
+  }
+
+ private:
+  void WaitForChange(std::atomic<uint32_t>* seq, uint32_t old_seq,
+                     std::atomic<uint32_t>* waiters);
+  void WakeUp(std::atomic<uint32_t>* seq, std::atomic<uint32_t>* waiters);
+  bool WriteBytes(const char* data, uint64_t length);
+
+  SharedMemoryRingControl* control_;
+  char* data_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SCHEDULING_FLOW_SHARED_MEMORY_RING_H
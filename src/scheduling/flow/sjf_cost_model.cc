@@ -150,6 +150,13 @@ pair<Cost_t, uint64_t> SJFCostModel::EquivClassToEquivClass(EquivClass_t tec1,
 
 vector<EquivClass_t>* SJFCostModel::GetTaskEquivClasses(TaskID_t task_id) {
   vector<EquivClass_t>* equiv_classes = new vector<EquivClass_t>();
+  FillTaskEquivClasses(task_id, equiv_classes);
+  return equiv_classes;
+}
+
+void SJFCostModel::FillTaskEquivClasses(TaskID_t task_id,
+                                        vector<EquivClass_t>* equiv_classes) {
+  equiv_classes->clear();
   TaskDescriptor* td_ptr = FindPtrOrNull(*task_map_, task_id);
   CHECK_NOTNULL(td_ptr);
   // A level 0 TEC is the hash of the task binary name.
@@ -157,12 +164,19 @@ vector<EquivClass_t>* SJFCostModel::GetTaskEquivClasses(TaskID_t task_id) {
       static_cast<EquivClass_t>(HashString(td_ptr->binary())));
   // All tasks also have an arc to the cluster aggregator.
   equiv_classes->push_back(cluster_aggregator_ec_);
-  return equiv_classes;
 }
 
 vector<ResourceID_t>* SJFCostModel::GetOutgoingEquivClassPrefArcs(
     EquivClass_t ec) {
   vector<ResourceID_t>* prefered_res = new vector<ResourceID_t>();
+  FillOutgoingEquivClassPrefArcs(ec, prefered_res);
+  return prefered_res;
+}
+
+void SJFCostModel::FillOutgoingEquivClassPrefArcs(
+    EquivClass_t ec,
+    vector<ResourceID_t>* prefered_res) {
+  prefered_res->clear();
   if (ec == cluster_aggregator_ec_) {
     // ec is the cluster aggregator, and has arcs to all machines.
     // XXX(malte): This is inefficient, as it needlessly adds all the
@@ -174,18 +188,32 @@ vector<ResourceID_t>* SJFCostModel::GetOutgoingEquivClassPrefArcs(
       prefered_res->push_back(it->first);
     }
   }
-  return prefered_res;
 }
 
 vector<ResourceID_t>* SJFCostModel::GetTaskPreferenceArcs(TaskID_t task_id) {
+  vector<ResourceID_t>* pref_res = new vector<ResourceID_t>();
+  FillTaskPreferenceArcs(task_id, pref_res);
+  return pref_res;
+}
+
+void SJFCostModel::FillTaskPreferenceArcs(TaskID_t task_id,
+                                          vector<ResourceID_t>* pref_res) {
   // No preference arcs in SJF cost model
-  return NULL;
+  pref_res->clear();
 }
 
 vector<EquivClass_t>* SJFCostModel::GetEquivClassToEquivClassesArcs(
     EquivClass_t tec) {
+  vector<EquivClass_t>* pref_ecs = new vector<EquivClass_t>();
+  FillEquivClassToEquivClassesArcs(tec, pref_ecs);
+  return pref_ecs;
+}
+
+void SJFCostModel::FillEquivClassToEquivClassesArcs(
+    EquivClass_t tec,
+    vector<EquivClass_t>* pref_ecs) {
   // There are no internal EC connectors in the SJF cost model
-  return NULL;
+  pref_ecs->clear();
 }
 
 void SJFCostModel::AddMachine(ResourceTopologyNodeDescriptor* rtnd_ptr) {
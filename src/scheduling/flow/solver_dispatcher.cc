@@ -20,8 +20,10 @@
 
 #include "scheduling/flow/solver_dispatcher.h"
 
+#include <errno.h>
 #include <sys/stat.h>
 #include <pthread.h>
+#include <unistd.h>
 #include <utility>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -31,13 +33,15 @@
 #include "base/units.h"
 #include "misc/string_utils.h"
 #include "misc/utils.h"
+#include "scheduling/flow/primal_dual_solver.h"
 
 DEFINE_bool(debug_flow_graph, false, "Write out a debug copy of the scheduling"
             " flow graph to the debug directory.");
 DEFINE_string(flow_scheduling_solver, "cs2",
               "Solver to use for flow network optimization. Possible values:"
               "\"cs2\": Goldberg solver, \"flowlessly\": local Flowlessly "
-              "solver reimplementation; \"custom\": specify custom solver. "
+              "solver reimplementation; \"inprocess\": linked-in primal-dual "
+              "solver; \"custom\": specify custom solver. "
               "with -flow_scheduling_binary and -flow_scheduling_args.");
 DEFINE_string(flow_scheduling_binary, "", "Path to flow solving executable. "
               "If specified, overrides default path. "
@@ -45,6 +49,14 @@ DEFINE_string(flow_scheduling_binary, "", "Path to flow solving executable. "
 DEFINE_string(custom_flow_scheduling_args, "", "Arguments for custom solver. "
               "Defaults to no arguments.");
 DEFINE_bool(incremental_flow, false, "Generate incremental graph changes.");
+DEFINE_bool(binary_solver_protocol, false, "Communicate with the solver using "
+            "the binary wire format instead of DIMACS. The solver must "
+            "support the binary format.");
+DEFINE_bool(solver_shared_memory, false, "Exchange graph changes and results "
+            "with the solver daemon via shared memory ring buffers. Requires "
+            "-incremental_flow and a solver that supports the binary format.");
+DEFINE_uint64(solver_shared_memory_capacity, 64 * 1024 * 1024, "Capacity "
+              "in bytes of each of the shared memory rings.");
 DEFINE_bool(only_read_assignment_changes, false, "Read only changes in task"
             " assignments.");
 DEFINE_string(flowlessly_binary,
@@ -73,6 +85,9 @@ DEFINE_int64(flowlessly_alpha_factor, 9, "Alpha factor to be used by "
 namespace firmament {
 namespace scheduler {
 
+// Maximum number of records we read from the solver at once.
+static const uint64_t kWireRecordsPerRead = 16384;
+
 using boost::lexical_cast;
 using boost::algorithm::is_any_of;
 using boost::token_compress_on;
@@ -83,7 +98,13 @@ SolverDispatcher::SolverDispatcher(
   : flow_graph_manager_(flow_graph_manager),
     solver_ran_once_(solver_ran_once),
     debug_seq_num_(0), to_solver_(NULL), from_solver_(NULL),
-    from_solver_stderr_(NULL) {
+    from_solver_stderr_(NULL), solver_pid_(0),
+    logger_thread_(static_cast<pthread_t>(-1)),
+    change_optimization_runtime_(0), export_runtime_(0),
+    get_mappings_runtime_(0), in_process_solver_(NULL),
+    pending_solver_state_(NULL),
+    in_process_task_mappings_(NULL), in_process_algorithm_runtime_(0),
+    shm_channel_(NULL), snapshot_num_nodes_(0), snapshot_sink_id_(0) {
   // Set up debug directory if it doesn't exist
   struct stat st;
   if (!FLAGS_debug_output_dir.empty() &&
@@ -99,11 +120,35 @@ SolverDispatcher::SolverDispatcher(
 }
 
 SolverDispatcher::~SolverDispatcher() {
-  if (to_solver_ != NULL) {
+  if (shm_channel_ != NULL) {
+    // Send EOS to make sure the solver closes gracefully, unless the solver
+    // has already exited.
+    if (!shm_channel_->to_solver()->IsClosed()) {
+      binary_exporter_.ExportEndOfStream(shm_channel_->to_solver());
+    }
+    CHECK_EQ(fclose(to_solver_), 0);
+    to_solver_ = NULL;
+    // Reap the solver and wait for the logger thread, which uses the rings,
+    // before we unmap them.
+    int status = WaitForFinish(solver_pid_);
+    if (pthread_join(logger_thread_, NULL)) {
+      PLOG(FATAL) << "Error joining thread";
+    }
+    if (!(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+      LOG(ERROR) << "Solver terminated abnormally";
+    }
+    delete shm_channel_;
+  } else if (to_solver_ != NULL) {
     // Print EOS to Make sure the solver closes gracefully when running
     // in daemon mode.
-    fprintf(to_solver_, "c EOS\n");
-    fflush(to_solver_);
+    if (FLAGS_binary_solver_protocol) {
+      binary_exporter_.ExportEndOfStream(fileno(to_solver_));
+    } else {
+      fprintf(to_solver_, "c EOS\n");
+      fflush(to_solver_);
+    }
+  }
+  if (to_solver_ != NULL) {
     CHECK_EQ(fclose(to_solver_), 0);
   }
   if (from_solver_ != NULL) {
@@ -112,6 +157,9 @@ SolverDispatcher::~SolverDispatcher() {
   if (from_solver_stderr_ != NULL) {
     CHECK_EQ(fclose(from_solver_stderr_), 0);
   }
+  delete in_process_solver_;
+  delete pending_solver_state_;
+  delete in_process_task_mappings_;
 }
 
 void SolverDispatcher::ExportJSON(string* output) const {
@@ -146,6 +194,18 @@ void *ProcessStderrJustlog(void *x) {
   return NULL;
 }
 
+// Logs the STDERR of a solver that communicates via shared memory. The
+// solver's STDERR is only closed when the solver exits. Hence, we close the
+// rings at EOF so that the dispatcher does not wait forever on a solver that
+// has crashed.
+void *ProcessSharedMemorySolverStderr(void *x) {
+  SolverDispatcher* solver_dispatcher = reinterpret_cast<SolverDispatcher*>(x);
+  ProcessStderrJustlog(solver_dispatcher->from_solver_stderr_);
+  solver_dispatcher->shm_channel_->to_solver()->Close();
+  solver_dispatcher->shm_channel_->from_solver()->Close();
+  return NULL;
+}
+
 void SolverDispatcher::ExportGraph(FILE* stream) {
   // Note dimacs_exporter_ is the full graph iff solver is running for the first
   // time, or is non-incremental. Otherwise, dimacs_exporter_ is the incremental
@@ -153,18 +213,62 @@ void SolverDispatcher::ExportGraph(FILE* stream) {
   FlowGraphChangeManager* change_manager =
     flow_graph_manager_->flow_graph_change_manager();
   if (solver_ran_once_ && FLAGS_incremental_flow) {
-    dimacs_exporter_.ExportIncremental(
-        change_manager->GetOptimizedGraphChanges(), stream);
+    if (FLAGS_binary_solver_protocol) {
+      binary_exporter_.ExportIncremental(GetOptimizedGraphChanges(),
+                                         fileno(stream));
+    } else {
+      dimacs_exporter_.ExportIncremental(GetOptimizedGraphChanges(), stream);
+    }
   }
   if (!solver_ran_once_ || !FLAGS_incremental_flow) {
     // Always export full flow graph when running first time. If algorithm
     // is non-incremental, must do it for subsequent iterations too.
-    dimacs_exporter_.Export(change_manager->flow_graph(), stream);
+    if (FLAGS_binary_solver_protocol) {
+      binary_exporter_.Export(change_manager->flow_graph(), fileno(stream));
+    } else {
+      dimacs_exporter_.Export(change_manager->flow_graph(), stream);
+    }
   }
 }
 
+const vector<DIMACSChange*>& SolverDispatcher::GetOptimizedGraphChanges() {
+  boost::timer::cpu_timer optimization_timer;
+  const vector<DIMACSChange*>& changes =
+    flow_graph_manager_->flow_graph_change_manager()->
+    GetOptimizedGraphChanges();
+  change_optimization_runtime_ +=
+    static_cast<uint64_t>(optimization_timer.elapsed().wall) /
+    NANOSECONDS_IN_MICROSECOND;
+  return changes;
+}
+
+void SolverDispatcher::RestoreSolverState(const SolverState& solver_state) {
+  delete pending_solver_state_;
+  pending_solver_state_ = new SolverState(solver_state);
+}
+
+void SolverDispatcher::SaveSolverState(SolverState* solver_state) {
+  CHECK_NOTNULL(solver_state);
+  if (in_process_solver_ == NULL) {
+    if (pending_solver_state_ != NULL) {
+      // The solver hasn't run since the state was restored.
+      solver_state->CopyFrom(*pending_solver_state_);
+    }
+    return;
+  }
+  vector<int64_t> potentials;
+  vector<unordered_map<uint64_t, uint64_t>> flow;
+  in_process_solver_->GetWarmStartState(&potentials, &flow);
+  flow_graph_manager_->SaveSolverState(potentials, flow, solver_state);
+}
+
 multimap<uint64_t, uint64_t>* SolverDispatcher::Run(
     SchedulerStats* scheduler_stats) {
+  SubmitRun();
+  return WaitForRun(scheduler_stats);
+}
+
+void SolverDispatcher::SubmitRun() {
   // Adjusts the costs on the arcs from tasks to unsched aggs.
   if (solver_ran_once_) {
     flow_graph_manager_->UpdateAllCostsToUnscheduledAggs();
@@ -198,83 +302,87 @@ multimap<uint64_t, uint64_t>* SolverDispatcher::Run(
     }
   }
 
-  // Now run the solver
-  vector<string> args;
-  pid_t solver_pid = 0;
-  pthread_t logger_thread = static_cast<pthread_t>(-1);
-  // If the solver hasn't executed or if we're not running in incremental mode.
-  if (!solver_ran_once_ || !FLAGS_incremental_flow) {
-    // Pipe setup
-    // errfd[0] == PARENT_READ
-    // errfd[1] == CHILD_WRITE
-    // outfd[0] == PARENT_READ
-    // outfd[1] == CHILD_WRITE
-    // infd[0] == CHILD_READ
-    // infd[1] == PARENT_WRITE
-    string binary;
-    SolverConfiguration(FLAGS_flow_scheduling_solver, &binary, &args);
-    solver_pid = ExecCommandSync(binary, args, infd_, outfd_, errfd_);
-    VLOG(2) << "Solver running " << "(PID: " << solver_pid << ")"
-            << ", CHILD_READ: " << infd_[0]
-            << ", CHILD_WRITE_STD: " << outfd_[1]
-            << ", CHILD_WRITE_ERR: " << errfd_[1]
-            << ", PARENT_WRITE: " << infd_[1]
-            << ", PARENT_READ_STD: " << outfd_[0]
-            << ", PARENT_READ_ERR: " << errfd_[0];
-
-    if ((from_solver_stderr_ = fdopen(errfd_[0], "r")) == NULL) {
-      LOG(ERROR) << "Failed to open FD for reading solver's output. FD "
-                 << errfd_[0];
-    }
-    if ((from_solver_ = fdopen(outfd_[0], "r")) == NULL) {
-      LOG(ERROR) << "Failed to open FD for reading solver's output. FD "
-                 << outfd_[0];
-    }
-    if ((to_solver_ = fdopen(infd_[1], "w")) == NULL) {
-      LOG(ERROR) << "Failed to open FD to solver for writing. FD: "
-                 << infd_[1];
-    }
-
-    if (pthread_create(&logger_thread, NULL,
-                       ProcessStderrJustlog, from_solver_stderr_)) {
-      PLOG(FATAL) << "Error creating thread";
+  flowsolver_timer_.start();
+  change_optimization_runtime_ = 0;
+  export_runtime_ = 0;
+  get_mappings_runtime_ = 0;
+  SnapshotGraph();
+  if (FLAGS_flow_scheduling_solver == "inprocess") {
+    SubmitInProcessRun();
+  } else if (FLAGS_solver_shared_memory) {
+    boost::timer::cpu_timer export_timer;
+    SubmitSharedMemoryRun();
+    export_runtime_ = static_cast<uint64_t>(export_timer.elapsed().wall) /
+      NANOSECONDS_IN_MICROSECOND - change_optimization_runtime_;
+  } else {
+    solver_pid_ = 0;
+    // If the solver hasn't executed or if we're not running in incremental
+    // mode.
+    if (!solver_ran_once_ || !FLAGS_incremental_flow) {
+      solver_pid_ = StartSolver(&logger_thread_);
     }
+    boost::timer::cpu_timer export_timer;
+    // We export the graph before we return because it may change afterwards.
+    // Exporting synchronously cannot deadlock: the solver reads all its input
+    // before it writes any output, and the logger thread started in
+    // StartSolver keeps draining the solver's STDERR pipe meanwhile.
+    ExportToSolver(this);
+    export_runtime_ = static_cast<uint64_t>(export_timer.elapsed().wall) /
+      NANOSECONDS_IN_MICROSECOND - change_optimization_runtime_;
   }
+  solver_ran_once_ = true;
+}
 
-  boost::timer::cpu_timer flowsolver_timer;
-
-  // We must export graph and read from STDOUT/STDERR in parallel
-  // Otherwise, the solver might block if STDOUT/STDERR buffer gets full.
-  // (For example, if it outputs lots of warnings on STDERR.)
-
-  // Create thread to write the DIMACS
-  pthread_t exporter_thread;
-  if (pthread_create(&exporter_thread, NULL, ExportToSolver, this)) {
-    PLOG(FATAL) << "Error creating thread";
-  }
-
+multimap<uint64_t, uint64_t>* SolverDispatcher::WaitForRun(
+    SchedulerStats* scheduler_stats) {
   uint64_t algorithm_runtime = numeric_limits<uint64_t>::max();
-  multimap<uint64_t, uint64_t>* task_mappings =
-    ReadOutput(&algorithm_runtime);
-
-  // Wait for exporter to complete. (Should already have happened when we
-  // get here, given we've finished reading the output.)
-  if (pthread_join(exporter_thread, NULL)) {
-    PLOG(FATAL) << "Error joining thread";
+  uint64_t solve_runtime = 0;
+  uint64_t output_parse_runtime = 0;
+  multimap<uint64_t, uint64_t>* task_mappings;
+  if (FLAGS_flow_scheduling_solver == "inprocess") {
+    // The in-process solver has already run when the graph was submitted.
+    task_mappings = in_process_task_mappings_;
+    in_process_task_mappings_ = NULL;
+    algorithm_runtime = in_process_algorithm_runtime_;
+    solve_runtime = algorithm_runtime;
+  } else {
+    boost::timer::cpu_timer read_timer;
+    task_mappings = ReadOutput(&algorithm_runtime);
+    // We block in ReadOutput until the solver writes its output. Hence, the
+    // time spent reading includes the solver's runtime.
+    uint64_t read_runtime =
+      static_cast<uint64_t>(read_timer.elapsed().wall) /
+      NANOSECONDS_IN_MICROSECOND;
+    read_runtime -= min(read_runtime, get_mappings_runtime_);
+    if (algorithm_runtime != numeric_limits<uint64_t>::max()) {
+      solve_runtime = algorithm_runtime;
+      output_parse_runtime = read_runtime - min(read_runtime, solve_runtime);
+    } else {
+      // cs2 doesn't export its algorithm runtime, so we can't tell solving
+      // and output parsing apart.
+      solve_runtime = read_runtime;
+    }
   }
-
-  solver_ran_once_ = true;
+  CHECK_NOTNULL(task_mappings);
 
   if (scheduler_stats != NULL) {
     scheduler_stats->scheduler_runtime_ =
-      static_cast<uint64_t>(flowsolver_timer.elapsed().wall) /
+      static_cast<uint64_t>(flowsolver_timer_.elapsed().wall) /
       NANOSECONDS_IN_MICROSECOND;
     scheduler_stats->algorithm_runtime_ = algorithm_runtime;
+    scheduler_stats->phase_runtimes_[PHASE_CHANGE_OPTIMIZATION] =
+      change_optimization_runtime_;
+    scheduler_stats->phase_runtimes_[PHASE_EXPORT] = export_runtime_;
+    scheduler_stats->phase_runtimes_[PHASE_SOLVE] = solve_runtime;
+    scheduler_stats->phase_runtimes_[PHASE_OUTPUT_PARSE] =
+      output_parse_runtime;
+    scheduler_stats->phase_runtimes_[PHASE_GET_MAPPINGS] =
+      get_mappings_runtime_;
   }
 
-  if (!FLAGS_incremental_flow) {
+  if (!FLAGS_incremental_flow && FLAGS_flow_scheduling_solver != "inprocess") {
     // We're done with the solver and can let it terminate here.
-    int status = WaitForFinish(solver_pid);
+    int status = WaitForFinish(solver_pid_);
 
     CHECK_EQ(fclose(from_solver_), 0);
     from_solver_ = NULL;
@@ -285,7 +393,7 @@ multimap<uint64_t, uint64_t>* SolverDispatcher::Run(
     // it here)
 
     // wait for logger thread
-    if (pthread_join(logger_thread, NULL)) {
+    if (pthread_join(logger_thread_, NULL)) {
       PLOG(FATAL) << "Error joining thread";
     }
 
@@ -297,6 +405,167 @@ multimap<uint64_t, uint64_t>* SolverDispatcher::Run(
   return task_mappings;
 }
 
+void SolverDispatcher::SnapshotGraph() {
+  const FlowGraph& flow_graph =
+    flow_graph_manager_->flow_graph_change_manager()->flow_graph();
+  snapshot_num_nodes_ = flow_graph.NumNodes();
+  snapshot_sink_id_ = flow_graph_manager_->sink_node()->id_;
+  snapshot_leaf_ids_ = flow_graph_manager_->leaf_node_ids();
+  snapshot_task_nodes_.assign(snapshot_num_nodes_ + 1, false);
+  for (auto& node : flow_graph.Nodes()) {
+    if (node->IsTaskNode()) {
+      if (node->id_ >= snapshot_task_nodes_.size()) {
+        snapshot_task_nodes_.resize(node->id_ + 1, false);
+      }
+      snapshot_task_nodes_[node->id_] = true;
+    }
+  }
+}
+
+void SolverDispatcher::SubmitSharedMemoryRun() {
+  if (!FLAGS_incremental_flow) {
+    LOG(FATAL) << "-solver_shared_memory requires -incremental_flow";
+  }
+  if (shm_channel_ == NULL) {
+    shm_channel_ = new SharedMemoryChannel();
+    string shm_name;
+    spf(&shm_name, "/firmament_solver_%d_%p", getpid(), this);
+    shm_channel_->Create(shm_name, FLAGS_solver_shared_memory_capacity);
+    solver_pid_ = StartSolver(&logger_thread_);
+  }
+  // The solver reads the changes while we write them, so we don't need an
+  // exporter thread to avoid blocking when the ring is full.
+  FlowGraphChangeManager* change_manager =
+    flow_graph_manager_->flow_graph_change_manager();
+  if (solver_ran_once_) {
+    binary_exporter_.ExportIncremental(GetOptimizedGraphChanges(),
+                                       shm_channel_->to_solver());
+  } else {
+    binary_exporter_.Export(change_manager->flow_graph(),
+                            shm_channel_->to_solver());
+  }
+  change_manager->ResetChanges();
+}
+
+void SolverDispatcher::SubmitInProcessRun() {
+  if (in_process_solver_ == NULL) {
+    in_process_solver_ = new PrimalDualSolver();
+  }
+  FlowGraphChangeManager* change_manager =
+    flow_graph_manager_->flow_graph_change_manager();
+  const FlowGraph& flow_graph = change_manager->flow_graph();
+  if (pending_solver_state_ != NULL) {
+    vector<int64_t> potentials;
+    vector<unordered_map<uint64_t, uint64_t>> flow;
+    flow_graph_manager_->RestoreSolverState(*pending_solver_state_,
+                                            &potentials, &flow);
+    in_process_solver_->SetWarmStartState(potentials, flow);
+    LOG(INFO) << "Restored the solver state of "
+              << pending_solver_state_->nodes_size() << " nodes";
+    delete pending_solver_state_;
+    pending_solver_state_ = NULL;
+  }
+  vector<unordered_map<uint64_t, uint64_t>>* extracted_flow =
+    new vector<unordered_map<uint64_t, uint64_t>>(flow_graph.NumNodes() + 1);
+  // The solver works on the graph directly. Hence, we must run it before the
+  // graph changes again.
+  in_process_algorithm_runtime_ =
+    in_process_solver_->Solve(flow_graph, extracted_flow);
+  // The solver doesn't need the changes.
+  change_manager->ResetChanges();
+  in_process_task_mappings_ = GetMappings(extracted_flow);
+  delete extracted_flow;
+}
+
+static void ReadFully(int fd, void* buffer, size_t length) {
+  char* position = static_cast<char*>(buffer);
+  while (length > 0) {
+    ssize_t bytes_read = read(fd, position, length);
+    if (bytes_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      PLOG(FATAL) << "Error while reading from solver";
+    }
+    if (bytes_read == 0) {
+      LOG(FATAL) << "Solver closed its output before sending a full message";
+    }
+    position += bytes_read;
+    length -= static_cast<size_t>(bytes_read);
+  }
+}
+
+void SolverDispatcher::ReadFromSolver(int fd, void* buffer, uint64_t length) {
+  if (shm_channel_ != NULL) {
+    if (!shm_channel_->from_solver()->Read(buffer, length)) {
+      LOG(FATAL) << "Solver closed the shared memory ring before sending a "
+                 << "full message";
+    }
+  } else {
+    ReadFully(fd, buffer, length);
+  }
+}
+
+void SolverDispatcher::ReadWireHeader(int fd, SolverWireHeader* header) {
+  ReadFromSolver(fd, header, sizeof(SolverWireHeader));
+  if (header->magic_ != kSolverWireMagic) {
+    LOG(FATAL) << "Unexpected message from solver: the solver does not seem "
+               << "to support the binary wire format";
+  }
+}
+
+void SolverDispatcher::ReadWireRecords(int fd, uint64_t num_records) {
+  wire_records_.resize(num_records);
+  ReadFromSolver(fd, &wire_records_[0],
+                 num_records * sizeof(SolverWireRecord));
+}
+
+pid_t SolverDispatcher::StartSolver(pthread_t* logger_thread) {
+  // Pipe setup
+  // errfd[0] == PARENT_READ
+  // errfd[1] == CHILD_WRITE
+  // outfd[0] == PARENT_READ
+  // outfd[1] == CHILD_WRITE
+  // infd[0] == CHILD_READ
+  // infd[1] == PARENT_WRITE
+  string binary;
+  vector<string> args;
+  SolverConfiguration(FLAGS_flow_scheduling_solver, &binary, &args);
+  pid_t solver_pid = ExecCommandSync(binary, args, infd_, outfd_, errfd_);
+  VLOG(2) << "Solver running " << "(PID: " << solver_pid << ")"
+          << ", CHILD_READ: " << infd_[0]
+          << ", CHILD_WRITE_STD: " << outfd_[1]
+          << ", CHILD_WRITE_ERR: " << errfd_[1]
+          << ", PARENT_WRITE: " << infd_[1]
+          << ", PARENT_READ_STD: " << outfd_[0]
+          << ", PARENT_READ_ERR: " << errfd_[0];
+
+  if ((from_solver_stderr_ = fdopen(errfd_[0], "r")) == NULL) {
+    LOG(ERROR) << "Failed to open FD for reading solver's output. FD "
+               << errfd_[0];
+  }
+  if ((from_solver_ = fdopen(outfd_[0], "r")) == NULL) {
+    LOG(ERROR) << "Failed to open FD for reading solver's output. FD "
+               << outfd_[0];
+  }
+  if ((to_solver_ = fdopen(infd_[1], "w")) == NULL) {
+    LOG(ERROR) << "Failed to open FD to solver for writing. FD: "
+               << infd_[1];
+  }
+
+  // The shared memory rings are closed when the solver's STDERR is.
+  if (shm_channel_ != NULL) {
+    if (pthread_create(logger_thread, NULL, ProcessSharedMemorySolverStderr,
+                       this)) {
+      PLOG(FATAL) << "Error creating thread";
+    }
+  } else if (pthread_create(logger_thread, NULL,
+                            ProcessStderrJustlog, from_solver_stderr_)) {
+    PLOG(FATAL) << "Error creating thread";
+  }
+  return solver_pid;
+}
+
 void SolverDispatcher::SolverConfiguration(const string& solver,
                                            string* binary,
                                            vector<string> *args) {
@@ -364,24 +633,26 @@ void SolverDispatcher::SolverConfiguration(const string& solver,
       CHECK(false) << "Unknown flow solver chosen!";
     }
   }
+  if (shm_channel_ != NULL) {
+    args->push_back("--shared_memory=" + shm_channel_->name());
+  }
 }
 
 // Maps worker|root tasks to leaves. It expects a extracted_flow containing
 // only the arcs with positive flow (i.e. what ReadFlowGraph returns).
 multimap<uint64_t, uint64_t>* SolverDispatcher::GetMappings(
-    vector<unordered_map<uint64_t, uint64_t>>* extracted_flow,
-    unordered_set<uint64_t> leaves, uint64_t sink) {
+    vector<unordered_map<uint64_t, uint64_t>>* extracted_flow) {
   CHECK_NOTNULL(extracted_flow);
+  boost::timer::cpu_timer mappings_timer;
   multimap<uint64_t, uint64_t>* task_to_pu =
     new multimap<uint64_t, uint64_t>();
-  const FlowGraph& flow_graph =
-    flow_graph_manager_->flow_graph_change_manager()->flow_graph();
-  vector<vector<uint64_t>> pu_ids(flow_graph.NumNodes() + 1);
-  vector<bool> visited(flow_graph.NumNodes() + 1, false);
+  vector<vector<uint64_t>> pu_ids(snapshot_num_nodes_ + 1);
+  vector<bool> visited(snapshot_num_nodes_ + 1, false);
   queue<uint64_t> to_visit;
-  for (auto& leaf_node : leaves) {
+  for (auto& leaf_node : snapshot_leaf_ids_) {
     visited[leaf_node]= true;
-    uint64_t* flow = FindOrNull((*extracted_flow)[sink], leaf_node);
+    uint64_t* flow =
+      FindOrNull((*extracted_flow)[snapshot_sink_id_], leaf_node);
     if (flow != NULL) {
       // Exists flow from node to sink.
       for (uint64_t index = 0; index < *flow; ++index) {
@@ -394,12 +665,8 @@ multimap<uint64_t, uint64_t>* SolverDispatcher::GetMappings(
     uint64_t node_id = to_visit.front();
     to_visit.pop();
     visited[node_id] = true;
-    if (flow_graph_manager_->flow_graph_change_manager()->CheckNodeType(
-            node_id, FlowNodeType::ROOT_TASK) ||
-        flow_graph_manager_->flow_graph_change_manager()->CheckNodeType(
-            node_id, FlowNodeType::UNSCHEDULED_TASK) ||
-        flow_graph_manager_->flow_graph_change_manager()->CheckNodeType(
-            node_id, FlowNodeType::SCHEDULED_TASK)) {
+    if (node_id < snapshot_task_nodes_.size() &&
+        snapshot_task_nodes_[node_id]) {
       // It's a task node.
       for (auto& pu_node_id : pu_ids[node_id]) {
         task_to_pu->insert(pair<uint64_t, uint64_t>(node_id, pu_node_id));
@@ -432,6 +699,9 @@ multimap<uint64_t, uint64_t>* SolverDispatcher::GetMappings(
       }
     }
   }
+  get_mappings_runtime_ +=
+    static_cast<uint64_t>(mappings_timer.elapsed().wall) /
+    NANOSECONDS_IN_MICROSECOND;
   return task_to_pu;
 }
 
@@ -447,21 +717,98 @@ multimap<uint64_t, uint64_t>* SolverDispatcher::ReadOutput(
 
   // Process stdout in main thread
   if (FLAGS_only_read_assignment_changes) {
-    task_mappings = ReadTaskMappingChanges(from_solver_, algorithm_runtime);
+    if (FLAGS_binary_solver_protocol || shm_channel_ != NULL) {
+      task_mappings = ReadBinaryTaskMappingChanges(fileno(from_solver_),
+                                                   algorithm_runtime);
+    } else {
+      task_mappings = ReadTaskMappingChanges(from_solver_, algorithm_runtime);
+    }
   } else {
-    // Parse and process the result
-    uint64_t num_nodes =
-      flow_graph_manager_->flow_graph_change_manager()->flow_graph().NumNodes();
-    vector<unordered_map<uint64_t, uint64_t> >* extracted_flow =
-      ReadFlowGraph(from_solver_, algorithm_runtime, num_nodes);
-    task_mappings = GetMappings(extracted_flow,
-                                flow_graph_manager_->leaf_node_ids(),
-                                flow_graph_manager_->sink_node()->id_);
+    // Parse and process the result. We use the snapshot of the graph that
+    // was sent to the solver because the graph may have changed since.
+    vector<unordered_map<uint64_t, uint64_t> >* extracted_flow;
+    if (FLAGS_binary_solver_protocol || shm_channel_ != NULL) {
+      extracted_flow = ReadBinaryFlowGraph(fileno(from_solver_),
+                                           algorithm_runtime,
+                                           snapshot_num_nodes_);
+    } else {
+      extracted_flow = ReadFlowGraph(from_solver_, algorithm_runtime,
+                                     snapshot_num_nodes_);
+    }
+    task_mappings = GetMappings(extracted_flow);
     delete extracted_flow;
   }
   return task_mappings;
 }
 
+// Binary wire format version of ReadFlowGraph. If -debug_flow_graph is set,
+// the flow is also written out in DIMACS format.
+vector<unordered_map<uint64_t, uint64_t>>*
+SolverDispatcher::ReadBinaryFlowGraph(int fd, uint64_t* algorithm_runtime,
+                                      uint64_t num_vertices) {
+  vector<unordered_map<uint64_t, uint64_t>>* adj_list =
+    new vector<unordered_map<uint64_t, uint64_t> >(num_vertices + 1);
+  SolverWireHeader header;
+  ReadWireHeader(fd, &header);
+  CHECK_EQ(header.message_type_, SOLVER_WIRE_FLOW);
+  *algorithm_runtime = header.algorithm_runtime_;
+  FILE* dbg_fptr = NULL;
+  if (FLAGS_debug_flow_graph) {
+    string out_file_name;
+    spf(&out_file_name, "%s/debug-flow_%ju.dm",
+        FLAGS_debug_output_dir.c_str(), debug_seq_num_);
+    CHECK((dbg_fptr = fopen(out_file_name.c_str(), "w")) != NULL);
+    fprintf(dbg_fptr, "c ALGORITHM TIME %" PRIu64 "\n",
+            header.algorithm_runtime_);
+  }
+  uint64_t records_left = header.num_records_;
+  while (records_left > 0) {
+    uint64_t num_records = min(records_left, kWireRecordsPerRead);
+    ReadWireRecords(fd, num_records);
+    for (auto& record : wire_records_) {
+      CHECK_EQ(record.kind_, SOLVER_WIRE_ARC_FLOW);
+      if (FLAGS_debug_flow_graph) {
+        fprintf(dbg_fptr, "f %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                record.src_, record.dst_, record.cap_lower_bound_);
+      }
+      // Only add it to the adjacency list if flow > 0
+      if (record.cap_lower_bound_ > 0) {
+        (*adj_list)[record.dst_].insert(
+            make_pair(record.src_, record.cap_lower_bound_));
+      }
+    }
+    records_left -= num_records;
+  }
+  if (FLAGS_debug_flow_graph) {
+    fprintf(dbg_fptr, "c EOI\n");
+    CHECK_EQ(fclose(dbg_fptr), 0);
+  }
+  return adj_list;
+}
+
+multimap<uint64_t, uint64_t>* SolverDispatcher::ReadBinaryTaskMappingChanges(
+    int fd, uint64_t* algorithm_runtime) {
+  multimap<uint64_t, uint64_t>* task_node =
+    new multimap<uint64_t, uint64_t>();
+  SolverWireHeader header;
+  ReadWireHeader(fd, &header);
+  CHECK_EQ(header.message_type_, SOLVER_WIRE_ASSIGNMENTS);
+  *algorithm_runtime = header.algorithm_runtime_;
+  uint64_t records_left = header.num_records_;
+  while (records_left > 0) {
+    uint64_t num_records = min(records_left, kWireRecordsPerRead);
+    ReadWireRecords(fd, num_records);
+    for (auto& record : wire_records_) {
+      CHECK_EQ(record.kind_, SOLVER_WIRE_TASK_ASSIGNMENT);
+      VLOG(2) << "Assigning task node " << record.src_ << " to PU node "
+              << record.dst_;
+      task_node->insert(pair<uint64_t, uint64_t>(record.src_, record.dst_));
+    }
+    records_left -= num_records;
+  }
+  return task_node;
+}
+
 vector<unordered_map<uint64_t, uint64_t>>* SolverDispatcher::ReadFlowGraph(
     FILE* fptr, uint64_t* algorithm_runtime, uint64_t num_vertices) {
   vector<unordered_map<uint64_t, uint64_t>>* adj_list =
@@ -25,11 +25,16 @@
 #include <string>
 #include <vector>
 
+#include <boost/timer/timer.hpp>
+
 #include "base/common.h"
 #include "scheduling/scheduler_interface.h"
+#include "scheduling/flow/binary_exporter.h"
 #include "scheduling/flow/dimacs_exporter.h"
 #include "scheduling/flow/json_exporter.h"
 #include "scheduling/flow/flow_graph_manager.h"
+#include "scheduling/flow/shared_memory_channel.h"
+#include "scheduling/flow/solver_interface.h"
 
 namespace firmament {
 namespace scheduler {
@@ -41,7 +46,40 @@ class SolverDispatcher {
   ~SolverDispatcher();
 
   void ExportJSON(string* output) const;
+  /**
+   * Runs the solver on the current flow graph and waits for its results.
+   * Equivalent to SubmitRun() followed by WaitForRun().
+   * @return the task node to PU node mappings
+   */
   multimap<uint64_t, uint64_t>* Run(SchedulerStats* scheduler_stats);
+  /**
+   * Restores the warm-start state saved by SaveSolverState. The state is
+   * mapped onto the flow graph at the in-process solver's next run, by which
+   * time the graph has been rebuilt.
+   * @param solver_state the saved state
+   */
+  void RestoreSolverState(const SolverState& solver_state);
+  /**
+   * Saves the in-process solver's warm-start state. Nothing is saved for
+   * solvers that run in a separate process, as their state lives in that
+   * process.
+   * @param solver_state the state to save to
+   */
+  void SaveSolverState(SolverState* solver_state);
+  /**
+   * Sends the graph changes since the previous run to the solver, and returns
+   * without waiting for the solver's results. Once the method returns, the
+   * caller can modify the flow graph again: the modifications are sent to the
+   * solver in the next run.
+   */
+  void SubmitRun();
+  /**
+   * Waits for the results of the run started by SubmitRun(). The method does
+   * not access the flow graph; it interprets the results using a snapshot of
+   * the graph taken upon submission.
+   * @return the task node to PU node mappings
+   */
+  multimap<uint64_t, uint64_t>* WaitForRun(SchedulerStats* scheduler_stats);
 
   uint64_t seq_num() const {
     return debug_seq_num_;
@@ -49,9 +87,20 @@ class SolverDispatcher {
 
  private:
   void ExportGraph(FILE* stream);
+  /**
+   * Optimizes the graph changes since the previous run, and accounts the time
+   * spent doing so to the change optimization phase.
+   */
+  const vector<DIMACSChange*>& GetOptimizedGraphChanges();
   multimap<uint64_t, uint64_t>* GetMappings(
-      vector<unordered_map<uint64_t, uint64_t>>* extracted_flow,
-      unordered_set<uint64_t> leaves, uint64_t sink);
+      vector<unordered_map<uint64_t, uint64_t>>* extracted_flow);
+  vector<unordered_map<uint64_t, uint64_t>>* ReadBinaryFlowGraph(
+      int fd,
+      uint64_t* algorithm_runtime,
+      uint64_t num_vertices);
+  multimap<uint64_t, uint64_t>* ReadBinaryTaskMappingChanges(
+      int fd,
+      uint64_t* algorithm_runtime);
   multimap<uint64_t, uint64_t>* ReadOutput(uint64_t* algorithm_runtime);
   vector<unordered_map<uint64_t, uint64_t>>* ReadFlowGraph(
       FILE* fptr,
@@ -60,13 +109,26 @@ class SolverDispatcher {
   multimap<uint64_t, uint64_t>* ReadTaskMappingChanges(
       FILE* fptr,
       uint64_t* algorithm_runtime);
+  void SnapshotGraph();
+  void SubmitInProcessRun();
+  void SubmitSharedMemoryRun();
+  void ReadFromSolver(int fd, void* buffer, uint64_t length);
+  void ReadWireHeader(int fd, SolverWireHeader* header);
+  void ReadWireRecords(int fd, uint64_t num_records);
   void SolverConfiguration(const string& solver, string* binary,
                            vector<string> *args);
+  pid_t StartSolver(pthread_t* logger_thread);
   friend void *ExportToSolver(void *x);
+  friend void *ProcessSharedMemorySolverStderr(void *x);
 
   shared_ptr<FlowGraphManager> flow_graph_manager_;
   // DIMACS exporter for interfacing to the solver
   DIMACSExporter dimacs_exporter_;
+  // Exporter used instead of the DIMACS exporter when the solver
+  // communicates using the binary wire format.
+  BinaryExporter binary_exporter_;
+  // Buffer for the records read from the solver in binary wire format.
+  vector<SolverWireRecord> wire_records_;
   // JSON exporter for debug and visualisation
   JSONExporter json_exporter_;
   // Boolean that indicates if the solver has knowledge of the flow graph (i.e.
@@ -82,6 +144,39 @@ class SolverDispatcher {
   FILE* to_solver_;
   FILE* from_solver_;
   FILE* from_solver_stderr_;
+  // Solver process and its stderr logger thread. The solver is restarted
+  // for every run unless it runs as a daemon (i.e., -incremental_flow or
+  // -solver_shared_memory).
+  pid_t solver_pid_;
+  pthread_t logger_thread_;
+  // Timer started when a run is submitted.
+  boost::timer::cpu_timer flowsolver_timer_;
+  // Runtimes (in u-sec) of the phases of the current run that are measured
+  // by the dispatcher. WaitForRun reports them in the SchedulerStats.
+  uint64_t change_optimization_runtime_;
+  uint64_t export_runtime_;
+  uint64_t get_mappings_runtime_;
+  // Solver used when the flow network is optimized in-process (i.e.,
+  // -flow_scheduling_solver=inprocess). It is kept across runs so that it can
+  // warm-start from the flow and the potentials of the previous run (see
+  // -primal_dual_warm_start), independently of -incremental_flow.
+  SolverInterface* in_process_solver_;
+  // Warm-start state passed to RestoreSolverState that has not yet been given
+  // to the in-process solver, or NULL.
+  SolverState* pending_solver_state_;
+  // Results of the in-process solver, which runs upon submission.
+  multimap<uint64_t, uint64_t>* in_process_task_mappings_;
+  uint64_t in_process_algorithm_runtime_;
+  // Shared memory used to exchange graph changes and results with the solver
+  // daemon when running with -solver_shared_memory.
+  SharedMemoryChannel* shm_channel_;
+  // Snapshot of the parts of the flow graph that are needed to turn the
+  // solver's flow into task mappings. It is taken when a run is submitted
+  // because the graph may change while the solver runs.
+  uint64_t snapshot_num_nodes_;
+  uint64_t snapshot_sink_id_;
+  unordered_set<uint64_t> snapshot_leaf_ids_;
+  vector<bool> snapshot_task_nodes_;
 };
 
 } // namespace scheduler
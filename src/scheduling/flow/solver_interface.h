@@ -0,0 +1,85 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Abstract class representing the interface for min-cost flow solvers that
+// are linked into the scheduler (as opposed to solvers that run in a separate
+// process and communicate with the SolverDispatcher via pipes).
+
+#ifndef FIRMAMENT_SCHEDULING_FLOW_SOLVER_INTERFACE_H
+#define FIRMAMENT_SCHEDULING_FLOW_SOLVER_INTERFACE_H
+
+#include <vector>
+
+#include "base/common.h"
+#include "base/types.h"
+#include "scheduling/flow/flow_graph.h"
+
+namespace firmament {
+
+class SolverInterface {
+ public:
+  SolverInterface() {}
+  virtual ~SolverInterface() {}
+
+  /**
+   * Returns the state that the solver carries over to the next run. Solvers
+   * that do not keep state in-between runs return an empty state.
+   * @param potentials set to the node potentials, indexed by node id
+   * @param flow set to the flow of the last run, indexed by destination and
+   * then by source node id
+   */
+  virtual void GetWarmStartState(
+      vector<int64_t>* potentials,
+      vector<unordered_map<uint64_t, uint64_t>>* flow) const {
+    potentials->clear();
+    flow->clear();
+  }
+
+  /**
+   * Replaces the state that the solver carries over to the next run (e.g.,
+   * with the state returned by GetWarmStartState before a restart).
+   * @param potentials the node potentials, indexed by node id
+   * @param flow the flow to start from, indexed by destination and then by
+   * source node id
+   */
+  virtual void SetWarmStartState(
+      const vector<int64_t>& potentials,
+      const vector<unordered_map<uint64_t, uint64_t>>& flow) {
+  }
+
+  /**
+   * Computes a min-cost flow on the graph. Implementations may keep state
+   * in-between calls (e.g., node potentials) in order to speed up subsequent
+   * runs on similar graphs.
+   * @param graph the flow graph to optimize
+   * @param extracted_flow vector indexed by node id that gets populated with
+   * the arcs that carry flow into the node (i.e., extracted_flow[dst][src] =
+   * flow on arc (src, dst)). Only arcs with flow > 0 are added. The vector
+   * is resized if it does not have an entry for every node id.
+   * @return the time spent in the algorithm in microseconds
+   */
+  virtual uint64_t Solve(
+      const FlowGraph& graph,
+      vector<unordered_map<uint64_t, uint64_t>>* extracted_flow) = 0;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SCHEDULING_FLOW_SOLVER_INTERFACE_H
@@ -0,0 +1,94 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Binary wire format used to communicate with flow solvers that support it
+// (-binary_solver_protocol). Every message consists of a fixed-size header
+// followed by header.num_records_ fixed-size records. All fields are in host
+// byte order, as the solver always runs on the same machine as the scheduler.
+//
+// The messages correspond to the DIMACS input and output:
+//  - GRAPH: "p min" line followed by all the "n" and "a" lines.
+//  - DELTA: the incremental changes ("n", "a", "x" and "r" lines).
+//  - FLOW: the "f" lines of the solver's output.
+//  - ASSIGNMENTS: the "m" lines of the solver's output.
+//  - EOS: end of stream (i.e., "c EOS"); carries no records.
+
+#ifndef FIRMAMENT_SCHEDULING_FLOW_SOLVER_WIRE_FORMAT_H
+#define FIRMAMENT_SCHEDULING_FLOW_SOLVER_WIRE_FORMAT_H
+
+#include "base/types.h"
+
+namespace firmament {
+
+// "FIRM" in ASCII.
+static const uint32_t kSolverWireMagic = 0x4d524946;
+
+enum SolverWireMessageType {
+  SOLVER_WIRE_GRAPH = 1,
+  SOLVER_WIRE_DELTA = 2,
+  SOLVER_WIRE_FLOW = 3,
+  SOLVER_WIRE_ASSIGNMENTS = 4,
+  SOLVER_WIRE_EOS = 5,
+};
+
+// NOTE: Do not reorder the record kinds because it will affect the
+// communication with the solver.
+enum SolverWireRecordKind {
+  // Node addition. Uses src_ (node id), cost_ (excess) and type_ (node type).
+  SOLVER_WIRE_NODE = 1,
+  // Arc addition. Uses src_, dst_, cap_lower_bound_, cap_upper_bound_, cost_
+  // and type_ (arc type).
+  SOLVER_WIRE_ARC = 2,
+  // Arc change. Same as SOLVER_WIRE_ARC, but also uses old_cost_.
+  SOLVER_WIRE_CHANGE_ARC = 3,
+  // Node removal. Uses src_ (node id).
+  SOLVER_WIRE_REMOVE_NODE = 4,
+  // Flow on an arc. Uses src_, dst_ and cap_lower_bound_ (flow).
+  SOLVER_WIRE_ARC_FLOW = 5,
+  // Task assignment. Uses src_ (task node id) and dst_ (PU node id).
+  SOLVER_WIRE_TASK_ASSIGNMENT = 6,
+};
+
+struct SolverWireHeader {
+  uint32_t magic_;
+  uint32_t message_type_;
+  uint64_t num_records_;
+  // Number of nodes and arcs in the graph; only set for GRAPH messages.
+  uint64_t num_nodes_;
+  uint64_t num_arcs_;
+  // Time spent in the solver's algorithm in microseconds; only set for FLOW
+  // and ASSIGNMENTS messages.
+  uint64_t algorithm_runtime_;
+};
+
+struct SolverWireRecord {
+  uint32_t kind_;
+  uint32_t type_;
+  uint64_t src_;
+  uint64_t dst_;
+  uint64_t cap_lower_bound_;
+  uint64_t cap_upper_bound_;
+  int64_t cost_;
+  int64_t old_cost_;
+};
+
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SCHEDULING_FLOW_SOLVER_WIRE_FORMAT_H
@@ -27,6 +27,8 @@
 
 #include "misc/map-util.h"
 #include "misc/utils.h"
+#include "scheduling/label_utils.h"
+#include "scheduling/flow/flow_graph_manager.h"
 
 DECLARE_bool(preemption);
 DECLARE_uint64(max_tasks_per_pu);
@@ -79,7 +81,7 @@ Cost_t TrivialCostModel::TaskPreemptionCost(TaskID_t task_id) {
 
 Cost_t TrivialCostModel::TaskToEquivClassAggregator(TaskID_t task_id,
                                                     EquivClass_t ec) {
-  if (ec == cluster_aggregator_ec_)
+  if (ec == cluster_aggregator_ec_ || ContainsKey(label_selector_ecs_, ec))
     return 2ULL;
   else
     return 0ULL;
@@ -101,22 +103,43 @@ pair<Cost_t, uint64_t> TrivialCostModel::EquivClassToEquivClass(
   return pair<Cost_t, uint64_t>(0LL, 0ULL);
 }
 
-vector<EquivClass_t>* TrivialCostModel::GetTaskEquivClasses(
-    TaskID_t task_id) {
+vector<EquivClass_t>* TrivialCostModel::GetTaskEquivClasses(TaskID_t task_id) {
   vector<EquivClass_t>* equiv_classes = new vector<EquivClass_t>();
+  FillTaskEquivClasses(task_id, equiv_classes);
+  return equiv_classes;
+}
+
+void TrivialCostModel::FillTaskEquivClasses(
+    TaskID_t task_id,
+    vector<EquivClass_t>* equiv_classes) {
+  equiv_classes->clear();
   TaskDescriptor* td_ptr = FindPtrOrNull(*task_map_, task_id);
   CHECK_NOTNULL(td_ptr);
   // A level 0 TEC is the hash of the task binary name.
   equiv_classes->push_back(
       static_cast<EquivClass_t>(HashString(td_ptr->binary())));
-  // All tasks also have an arc to the cluster aggregator.
-  equiv_classes->push_back(cluster_aggregator_ec_);
-  return equiv_classes;
+  // Tasks that have label selectors have an arc to their label selector EC.
+  // All the other tasks have an arc to the cluster aggregator.
+  EquivClass_t* label_selector_ec =
+    FindOrNull(task_to_label_selector_ec_, task_id);
+  if (label_selector_ec) {
+    equiv_classes->push_back(*label_selector_ec);
+  } else {
+    equiv_classes->push_back(cluster_aggregator_ec_);
+  }
 }
 
 vector<ResourceID_t>* TrivialCostModel::GetOutgoingEquivClassPrefArcs(
     EquivClass_t ec) {
   vector<ResourceID_t>* prefered_res = new vector<ResourceID_t>();
+  FillOutgoingEquivClassPrefArcs(ec, prefered_res);
+  return prefered_res;
+}
+
+void TrivialCostModel::FillOutgoingEquivClassPrefArcs(
+    EquivClass_t ec,
+    vector<ResourceID_t>* prefered_res) {
+  prefered_res->clear();
   if (ec == cluster_aggregator_ec_) {
     // ec is the cluster aggregator, and has arcs to all machines.
     // XXX(malte): This is inefficient, as it needlessly adds all the
@@ -127,25 +150,70 @@ vector<ResourceID_t>* TrivialCostModel::GetOutgoingEquivClassPrefArcs(
          ++it) {
       prefered_res->push_back(it->first);
     }
+    return;
+  }
+  LabelSelectorEquivClass* label_selector_ec =
+    FindOrNull(label_selector_ecs_, ec);
+  if (label_selector_ec) {
+    // Recompile the selectors if machines with new labels have been added
+    // since they were last compiled.
+    if (label_selector_ec->num_interned_labels !=
+        label_index_.NumInternedLabels()) {
+      label_index_.CompileSelectors(label_selector_ec->selectors,
+                                    &label_selector_ec->compiled_selectors);
+      label_selector_ec->num_interned_labels =
+        label_index_.NumInternedLabels();
+    }
+    label_index_.GetCandidateMachines(label_selector_ec->compiled_selectors,
+                                      prefered_res);
   }
-  return prefered_res;
 }
 
 vector<ResourceID_t>* TrivialCostModel::GetTaskPreferenceArcs(
     TaskID_t task_id) {
   vector<ResourceID_t>* prefered_res = new vector<ResourceID_t>();
+  FillTaskPreferenceArcs(task_id, prefered_res);
+  return prefered_res;
+}
+
+void TrivialCostModel::FillTaskPreferenceArcs(
+    TaskID_t task_id,
+    vector<ResourceID_t>* prefered_res) {
+  prefered_res->clear();
   CHECK_GE(leaf_res_ids_->size(), FLAGS_num_pref_arcs_task_to_res);
+  TaskDescriptor* td_ptr = FindPtrOrNull(*task_map_, task_id);
+  CHECK_NOTNULL(td_ptr);
   for (uint32_t num_arc = 0; num_arc < FLAGS_num_pref_arcs_task_to_res;
        ++num_arc) {
-    prefered_res->push_back(PickRandomResourceID(*leaf_res_ids_));
+    ResourceID_t res_id = PickRandomResourceID(*leaf_res_ids_);
+    if (td_ptr->label_selectors_size() > 0) {
+      // Tasks must not get arcs to resources in machines that do not satisfy
+      // their label selectors.
+      FlowGraphNode* machine_node = flow_graph_manager_->NodeForResourceHandle(
+          flow_graph_manager_->MachineHandleForResource(
+              flow_graph_manager_->ResourceHandle(res_id)));
+      CHECK_NOTNULL(machine_node->rd_ptr_);
+      if (!scheduler::SatisfiesLabelSelectors(*machine_node->rd_ptr_,
+                                              td_ptr->label_selectors())) {
+        continue;
+      }
+    }
+    prefered_res->push_back(res_id);
   }
-  return prefered_res;
 }
 
 vector<EquivClass_t>* TrivialCostModel::GetEquivClassToEquivClassesArcs(
     EquivClass_t tec) {
+  vector<EquivClass_t>* pref_ecs = new vector<EquivClass_t>();
+  FillEquivClassToEquivClassesArcs(tec, pref_ecs);
+  return pref_ecs;
+}
+
+void TrivialCostModel::FillEquivClassToEquivClassesArcs(
+    EquivClass_t tec,
+    vector<EquivClass_t>* pref_ecs) {
   // The trivial cost model does not have any interconnected ECs.
-  return NULL;
+  pref_ecs->clear();
 }
 
 void TrivialCostModel::AddMachine(
@@ -153,19 +221,62 @@ void TrivialCostModel::AddMachine(
   CHECK_EQ(rtnd_ptr->resource_desc().type(),
            ResourceDescriptor::RESOURCE_MACHINE);
   // Add mapping between resource id and resource topology node.
-  InsertIfNotPresent(&machine_to_rtnd_,
-                     ResourceIDFromString(rtnd_ptr->resource_desc().uuid()),
-                     rtnd_ptr);
+  ResourceID_t res_id = ResourceIDFromString(rtnd_ptr->resource_desc().uuid());
+  if (InsertIfNotPresent(&machine_to_rtnd_, res_id, rtnd_ptr)) {
+    label_index_.AddMachine(res_id, rtnd_ptr->resource_desc());
+  }
 }
 
 void TrivialCostModel::AddTask(TaskID_t task_id) {
+  TaskDescriptor* td_ptr = FindPtrOrNull(*task_map_, task_id);
+  CHECK_NOTNULL(td_ptr);
+  if (td_ptr->label_selectors_size() == 0) {
+    return;
+  }
+  EquivClass_t ec = LabelSelectorsToEquivClass(td_ptr->label_selectors());
+  if (!InsertIfNotPresent(&task_to_label_selector_ec_, task_id, ec)) {
+    return;
+  }
+  LabelSelectorEquivClass* label_selector_ec =
+    FindOrNull(label_selector_ecs_, ec);
+  if (!label_selector_ec) {
+    label_selector_ec = &label_selector_ecs_[ec];
+    label_selector_ec->selectors = td_ptr->label_selectors();
+    label_index_.CompileSelectors(label_selector_ec->selectors,
+                                  &label_selector_ec->compiled_selectors);
+    label_selector_ec->num_interned_labels = label_index_.NumInternedLabels();
+    label_selector_ec->num_tasks = 0;
+  }
+  label_selector_ec->num_tasks++;
+}
+
+EquivClass_t TrivialCostModel::LabelSelectorsToEquivClass(
+    const RepeatedPtrField<LabelSelector>& selectors) {
+  string serialized_selectors = "LABEL_SELECTORS";
+  for (const auto& selector : selectors) {
+    serialized_selectors += selector.SerializeAsString();
+  }
+  return static_cast<EquivClass_t>(HashString(serialized_selectors));
 }
 
 void TrivialCostModel::RemoveMachine(ResourceID_t res_id) {
   CHECK_EQ(machine_to_rtnd_.erase(res_id), 1);
+  label_index_.RemoveMachine(res_id);
 }
 
 void TrivialCostModel::RemoveTask(TaskID_t task_id) {
+  EquivClass_t* ec_ptr = FindOrNull(task_to_label_selector_ec_, task_id);
+  if (!ec_ptr) {
+    return;
+  }
+  EquivClass_t ec = *ec_ptr;
+  task_to_label_selector_ec_.erase(task_id);
+  LabelSelectorEquivClass* label_selector_ec =
+    FindOrNull(label_selector_ecs_, ec);
+  CHECK_NOTNULL(label_selector_ec);
+  if (--label_selector_ec->num_tasks == 0) {
+    label_selector_ecs_.erase(ec);
+  }
 }
 
 FlowGraphNode* TrivialCostModel::GatherStats(FlowGraphNode* accumulator,
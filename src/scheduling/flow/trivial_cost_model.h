@@ -30,6 +30,7 @@
 
 #include "base/common.h"
 #include "base/types.h"
+#include "scheduling/label_index.h"
 #include "scheduling/flow/cost_model_interface.h"
 
 namespace firmament {
@@ -67,6 +68,14 @@ class TrivialCostModel : public CostModelInterface {
   vector<ResourceID_t>* GetOutgoingEquivClassPrefArcs(EquivClass_t tec);
   vector<ResourceID_t>* GetTaskPreferenceArcs(TaskID_t task_id);
   vector<EquivClass_t>* GetEquivClassToEquivClassesArcs(EquivClass_t tec);
+  void FillTaskEquivClasses(TaskID_t task_id,
+                            vector<EquivClass_t>* equiv_classes);
+  void FillOutgoingEquivClassPrefArcs(EquivClass_t tec,
+                                      vector<ResourceID_t>* pref_res);
+  void FillTaskPreferenceArcs(TaskID_t task_id,
+                              vector<ResourceID_t>* pref_res);
+  void FillEquivClassToEquivClassesArcs(EquivClass_t tec,
+                                        vector<EquivClass_t>* pref_ecs);
   void AddMachine(ResourceTopologyNodeDescriptor* rtnd_ptr);
   void AddTask(TaskID_t task_id);
   void RemoveMachine(ResourceID_t res_id);
@@ -74,8 +83,28 @@ class TrivialCostModel : public CostModelInterface {
   FlowGraphNode* GatherStats(FlowGraphNode* accumulator, FlowGraphNode* other);
   void PrepareStats(FlowGraphNode* accumulator);
   FlowGraphNode* UpdateStats(FlowGraphNode* accumulator, FlowGraphNode* other);
+  bool StatsAreThreadSafe() const {
+    return true;
+  }
+  bool StatsDependOnMachineSamples() const {
+    return false;
+  }
 
  private:
+  // EC of the tasks that have the same label selectors. It has arcs to the
+  // machines that satisfy the selectors.
+  struct LabelSelectorEquivClass {
+    RepeatedPtrField<LabelSelector> selectors;
+    scheduler::CompiledLabelSelectors compiled_selectors;
+    // Value of the label index's NumInternedLabels() when the selectors were
+    // compiled.
+    uint64_t num_interned_labels;
+    uint64_t num_tasks;
+  };
+
+  static EquivClass_t LabelSelectorsToEquivClass(
+      const RepeatedPtrField<LabelSelector>& selectors);
+
   shared_ptr<ResourceMap_t> resource_map_;
   // EC corresponding to the CLUSTER_AGG node
   EquivClass_t cluster_aggregator_ec_;
@@ -83,6 +112,11 @@ class TrivialCostModel : public CostModelInterface {
   // Mapping betweeen machine res id and resource topology node descriptor.
   unordered_map<ResourceID_t, const ResourceTopologyNodeDescriptor*,
     boost::hash<boost::uuids::uuid>> machine_to_rtnd_;
+  // Index of the machines' labels.
+  scheduler::LabelIndex label_index_;
+  unordered_map<EquivClass_t, LabelSelectorEquivClass> label_selector_ecs_;
+  // The label selector EC of every task that has label selectors.
+  unordered_map<TaskID_t, EquivClass_t> task_to_label_selector_ec_;
   // Shared access to the overall set of tasks
   shared_ptr<TaskMap_t> task_map_;
 };
@@ -100,6 +100,13 @@ pair<Cost_t, uint64_t> VoidCostModel::EquivClassToEquivClass(
 
 vector<EquivClass_t>* VoidCostModel::GetTaskEquivClasses(TaskID_t task_id) {
   vector<EquivClass_t>* equiv_classes = new vector<EquivClass_t>();
+  FillTaskEquivClasses(task_id, equiv_classes);
+  return equiv_classes;
+}
+
+void VoidCostModel::FillTaskEquivClasses(TaskID_t task_id,
+                                         vector<EquivClass_t>* equiv_classes) {
+  equiv_classes->clear();
   TaskDescriptor* td_ptr = FindPtrOrNull(*task_map_, task_id);
   CHECK_NOTNULL(td_ptr);
   // We have one task EC per program.
@@ -110,25 +117,46 @@ vector<EquivClass_t>* VoidCostModel::GetTaskEquivClasses(TaskID_t task_id) {
     static_cast<EquivClass_t>(HashCommandLine(*td_ptr));
   equiv_classes->push_back(task_agg);
   equiv_classes->push_back(task_id);
-  return equiv_classes;
 }
 
 vector<ResourceID_t>* VoidCostModel::GetOutgoingEquivClassPrefArcs(
     EquivClass_t tec) {
   vector<ResourceID_t>* prefered_res = new vector<ResourceID_t>();
+  FillOutgoingEquivClassPrefArcs(tec, prefered_res);
+  return prefered_res;
+}
+
+void VoidCostModel::FillOutgoingEquivClassPrefArcs(
+    EquivClass_t tec,
+    vector<ResourceID_t>* prefered_res) {
+  prefered_res->clear();
   for (auto& res_id_rtnd : machine_to_rtnd_) {
     prefered_res->push_back(res_id_rtnd.first);
   }
-  return prefered_res;
 }
 
 vector<ResourceID_t>* VoidCostModel::GetTaskPreferenceArcs(TaskID_t task_id) {
-  return NULL;
+  vector<ResourceID_t>* pref_res = new vector<ResourceID_t>();
+  FillTaskPreferenceArcs(task_id, pref_res);
+  return pref_res;
+}
+
+void VoidCostModel::FillTaskPreferenceArcs(TaskID_t task_id,
+                                           vector<ResourceID_t>* pref_res) {
+  pref_res->clear();
 }
 
 vector<EquivClass_t>* VoidCostModel::GetEquivClassToEquivClassesArcs(
     EquivClass_t tec) {
-  return NULL;
+  vector<EquivClass_t>* pref_ecs = new vector<EquivClass_t>();
+  FillEquivClassToEquivClassesArcs(tec, pref_ecs);
+  return pref_ecs;
+}
+
+void VoidCostModel::FillEquivClassToEquivClassesArcs(
+    EquivClass_t tec,
+    vector<EquivClass_t>* pref_ecs) {
+  pref_ecs->clear();
 }
 
 void VoidCostModel::AddMachine(ResourceTopologyNodeDescriptor* rtnd_ptr) {
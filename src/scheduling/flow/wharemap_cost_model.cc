@@ -29,6 +29,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include <boost/bind.hpp>
+
 #include "base/common.h"
 #include "base/types.h"
 #include "misc/map-util.h"
@@ -153,20 +155,53 @@ Cost_t WhareMapCostModel::TaskToUnscheduledAggCost(TaskID_t task_id) {
   // average runtime is a lower bound on the cost.
   vector<EquivClass_t>* equiv_classes = GetTaskEquivClasses(task_id);
   CHECK_GT(equiv_classes->size(), 0);
-  uint64_t avg_pspi =
-    knowledge_base_->GetAvgPsPIForTEC(equiv_classes->front());
-  uint64_t* best_avg_pspi =
-    FindOrNull(best_case_psi_map_, equiv_classes->front());
+  uint64_t normalized_avg_pspi =
+    ComputeNormalizedAvgPsPI(equiv_classes->front());
+  delete equiv_classes;
+  return COST_LOWER_BOUND + 1 +
+    max(WAIT_TIME_MULTIPLIER * wait_time_centamillis, normalized_avg_pspi);
+}
+
+void WhareMapCostModel::TaskToUnscheduledAggCosts(
+    const vector<TaskID_t>& task_ids,
+    vector<Cost_t>* costs) {
+  CHECK_NOTNULL(costs);
+  costs->resize(task_ids.size());
+  uint64_t now = time_manager_->GetCurrentTimestamp();
+  // All the tasks of a program share a TEC. We compute the TEC's average PsPI,
+  // which requires a pass over the TEC's reports in the knowledge base, only
+  // once per batch.
+  unordered_map<EquivClass_t, uint64_t> tec_to_normalized_pspi;
+  for (uint64_t index = 0; index < task_ids.size(); ++index) {
+    const TaskDescriptor& td = GetTask(task_ids[index]);
+    // timestamps are in microseconds, but we scale to tenths of a second here
+    // in order to keep the costs small
+    uint64_t wait_time_centamillis = (now - td.submit_time()) / 100000;
+    vector<EquivClass_t>* equiv_classes = GetTaskEquivClasses(task_ids[index]);
+    CHECK_GT(equiv_classes->size(), 0);
+    EquivClass_t tec = equiv_classes->front();
+    delete equiv_classes;
+    uint64_t* normalized_avg_pspi = FindOrNull(tec_to_normalized_pspi, tec);
+    if (!normalized_avg_pspi) {
+      normalized_avg_pspi =
+        &(tec_to_normalized_pspi[tec] = ComputeNormalizedAvgPsPI(tec));
+    }
+    (*costs)[index] = COST_LOWER_BOUND + 1 +
+      max(WAIT_TIME_MULTIPLIER * wait_time_centamillis, *normalized_avg_pspi);
+  }
+}
+
+uint64_t WhareMapCostModel::ComputeNormalizedAvgPsPI(EquivClass_t tec) {
+  uint64_t avg_pspi = knowledge_base_->GetAvgPsPIForTEC(tec);
+  uint64_t* best_avg_pspi = FindOrNull(best_case_psi_map_, tec);
   uint64_t normalized_avg_pspi = 100ULL;
   if (best_avg_pspi) {
     normalized_avg_pspi = ((avg_pspi * 100) / *best_avg_pspi) + 1;
-    VLOG(1) << "Avg PsPI for TEC " << equiv_classes->front() << " is "
+    VLOG(1) << "Avg PsPI for TEC " << tec << " is "
             << avg_pspi << ", "
             << (static_cast<double>(avg_pspi / *best_avg_pspi)) << "x best";
   }
-  delete equiv_classes;
-  return COST_LOWER_BOUND + 1 +
-    max(WAIT_TIME_MULTIPLIER * wait_time_centamillis, normalized_avg_pspi);
+  return normalized_avg_pspi;
 }
 
 // The cost from the unscheduled to the sink is 0. Setting it to a value greater
@@ -312,6 +347,27 @@ pair<Cost_t, uint64_t> WhareMapCostModel::EquivClassToEquivClass(
   return pair<Cost_t, uint64_t>(0LL, 0ULL);
 }
 
+void WhareMapCostModel::EquivClassToResourceNodeCosts(
+    const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+    vector<pair<Cost_t, uint64_t>>* costs_and_caps) {
+  CHECK_NOTNULL(costs_and_caps);
+  costs_and_caps->resize(ec_res.size());
+  ParallelForRanges(
+      ec_res.size(),
+      boost::bind(&WhareMapCostModel::ComputeEquivClassToResourceNodeCosts,
+                  this, boost::cref(ec_res), costs_and_caps, _1, _2));
+}
+
+void WhareMapCostModel::ComputeEquivClassToResourceNodeCosts(
+    const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+    vector<pair<Cost_t, uint64_t>>* costs_and_caps,
+    uint64_t begin, uint64_t end) {
+  for (uint64_t index = begin; index < end; ++index) {
+    (*costs_and_caps)[index] =
+      EquivClassToResourceNode(ec_res[index].first, ec_res[index].second);
+  }
+}
+
 uint64_t WhareMapCostModel::GetECOutgoingCapacity(EquivClass_t ec) {
   if (ec == cluster_aggregator_ec_) {
     LOG(FATAL) << "Method called with unexpected type of EC";
@@ -334,9 +390,16 @@ uint64_t WhareMapCostModel::GetECOutgoingCapacity(EquivClass_t ec) {
   }
 }
 
-vector<EquivClass_t>* WhareMapCostModel::GetTaskEquivClasses(
-    TaskID_t task_id) {
+vector<EquivClass_t>* WhareMapCostModel::GetTaskEquivClasses(TaskID_t task_id) {
   vector<EquivClass_t>* equiv_classes = new vector<EquivClass_t>();
+  FillTaskEquivClasses(task_id, equiv_classes);
+  return equiv_classes;
+}
+
+void WhareMapCostModel::FillTaskEquivClasses(
+    TaskID_t task_id,
+    vector<EquivClass_t>* equiv_classes) {
+  equiv_classes->clear();
   TaskDescriptor* td_ptr = FindPtrOrNull(*task_map_, task_id);
   CHECK_NOTNULL(td_ptr);
   // We have one task EC per program.
@@ -365,7 +428,6 @@ vector<EquivClass_t>* WhareMapCostModel::GetTaskEquivClasses(
   equiv_classes->push_back(job_agg);
   // All tasks also have an arc to the cluster aggregator.
   equiv_classes->push_back(cluster_aggregator_ec_);
-  return equiv_classes;
 }
 
 vector<EquivClass_t>* WhareMapCostModel::GetResourceEquivClasses(
@@ -384,6 +446,14 @@ vector<EquivClass_t>* WhareMapCostModel::GetResourceEquivClasses(
 vector<ResourceID_t>* WhareMapCostModel::GetOutgoingEquivClassPrefArcs(
     EquivClass_t ec) {
   vector<ResourceID_t>* prefered_res = new vector<ResourceID_t>();
+  FillOutgoingEquivClassPrefArcs(ec, prefered_res);
+  return prefered_res;
+}
+
+void WhareMapCostModel::FillOutgoingEquivClassPrefArcs(
+    EquivClass_t ec,
+    vector<ResourceID_t>* prefered_res) {
+  prefered_res->clear();
   if (ec == cluster_aggregator_ec_) {
     // ec is the cluster aggregator, and has arcs to all machines.
     // XXX(malte): This is inefficient, as it needlessly adds all the
@@ -456,18 +526,32 @@ vector<ResourceID_t>* WhareMapCostModel::GetOutgoingEquivClassPrefArcs(
     VLOG(1) << "Ignored unhandled type of equivalence aggregator "
             << "(EC " << ec << ")";
   }
-  return prefered_res;
 }
 
 vector<ResourceID_t>* WhareMapCostModel::GetTaskPreferenceArcs(
     TaskID_t task_id) {
   vector<ResourceID_t>* prefered_res = new vector<ResourceID_t>();
+  FillTaskPreferenceArcs(task_id, prefered_res);
   return prefered_res;
 }
 
+void WhareMapCostModel::FillTaskPreferenceArcs(
+    TaskID_t task_id,
+    vector<ResourceID_t>* prefered_res) {
+  prefered_res->clear();
+}
+
 vector<EquivClass_t>* WhareMapCostModel::GetEquivClassToEquivClassesArcs(
     EquivClass_t tec) {
   vector<EquivClass_t>* outgoing_ec = new vector<EquivClass_t>();
+  FillEquivClassToEquivClassesArcs(tec, outgoing_ec);
+  return outgoing_ec;
+}
+
+void WhareMapCostModel::FillEquivClassToEquivClassesArcs(
+    EquivClass_t tec,
+    vector<EquivClass_t>* outgoing_ec) {
+  outgoing_ec->clear();
   if (tec == cluster_aggregator_ec_) {
     // Cluster aggregator: has no outgoing arcs to other ECs in this
     // cost model. (Could have, e.g., arcs to rack aggregators, though!).
@@ -482,7 +566,6 @@ vector<EquivClass_t>* WhareMapCostModel::GetEquivClassToEquivClassesArcs(
   } else {
     // Nothing to do, ignore
   }
-  return outgoing_ec;
 }
 
 void WhareMapCostModel::AddMachine(
@@ -651,7 +734,7 @@ void WhareMapCostModel::RemoveTask(TaskID_t task_id) {
     CHECK(!td.scheduled_to_resource().empty());
     ResourceID_t res_id = ResourceIDFromString(td.scheduled_to_resource());
     ResourceID_t machine_res_id =
-      MachineResIDForResource(resource_map_, res_id);
+      flow_graph_manager_->MachineResIDForResource(res_id);
     EquivClass_t* mec = FindOrNull(machine_to_ec_, machine_res_id);
     CHECK_NOTNULL(mec);
     // Add the Whare-M information to the psi_map_
@@ -69,11 +69,25 @@ class WhareMapCostModel : public CostModelInterface {
       ResourceID_t res_id);
   pair<Cost_t, uint64_t> EquivClassToEquivClass(EquivClass_t tec1,
                                                 EquivClass_t tec2);
+  // Batch cost methods
+  void TaskToUnscheduledAggCosts(const vector<TaskID_t>& task_ids,
+                                 vector<Cost_t>* costs);
+  void EquivClassToResourceNodeCosts(
+      const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+      vector<pair<Cost_t, uint64_t>>* costs_and_caps);
   // Get the type of equiv class.
   vector<EquivClass_t>* GetTaskEquivClasses(TaskID_t task_id);
   vector<ResourceID_t>* GetOutgoingEquivClassPrefArcs(EquivClass_t tec);
   vector<ResourceID_t>* GetTaskPreferenceArcs(TaskID_t task_id);
   vector<EquivClass_t>* GetEquivClassToEquivClassesArcs(EquivClass_t tec);
+  void FillTaskEquivClasses(TaskID_t task_id,
+                            vector<EquivClass_t>* equiv_classes);
+  void FillOutgoingEquivClassPrefArcs(EquivClass_t tec,
+                                      vector<ResourceID_t>* pref_res);
+  void FillTaskPreferenceArcs(TaskID_t task_id,
+                              vector<ResourceID_t>* pref_res);
+  void FillEquivClassToEquivClassesArcs(EquivClass_t tec,
+                                        vector<EquivClass_t>* pref_ecs);
   uint64_t HashWhareMapStats(const WhareMapStats& wms);
   void AddMachine(ResourceTopologyNodeDescriptor* rtnd_ptr);
   void AddTask(TaskID_t task_id);
@@ -93,6 +107,14 @@ class WhareMapCostModel : public CostModelInterface {
                                WhareMapStats* other);
   Cost_t AverageFromVec(const vector<uint64_t>& vec) const;
   const TaskDescriptor& GetTask(TaskID_t task_id);
+  // Range helper for EquivClassToResourceNodeCosts. It only reads state, and
+  // can thus be invoked concurrently on disjoint ranges.
+  void ComputeEquivClassToResourceNodeCosts(
+      const vector<pair<EquivClass_t, ResourceID_t>>& ec_res,
+      vector<pair<Cost_t, uint64_t>>* costs_and_caps,
+      uint64_t begin, uint64_t end);
+  // Average PsPI of a task EC, normalized by the best-case PsPI of the TEC
+  uint64_t ComputeNormalizedAvgPsPI(EquivClass_t tec);
   void ComputeMachineTypeHash(const ResourceTopologyNodeDescriptor* rtnd_ptr,
                               size_t* hash);
   uint64_t GetECOutgoingCapacity(EquivClass_t ec);
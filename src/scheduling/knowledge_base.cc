@@ -23,6 +23,7 @@
 #include "scheduling/knowledge_base.h"
 
 #include <algorithm>
+#include <cmath>
 #include <deque>
 #include <vector>
 
@@ -89,22 +90,20 @@ KnowledgeBase::~KnowledgeBase() {
 
 void KnowledgeBase::AddMachineSample(
     const MachinePerfStatisticsSample& sample) {
-  boost::lock_guard<boost::upgrade_mutex> lock(kb_lock_);
   ResourceID_t rid = ResourceIDFromString(sample.resource_id());
-  // Check if we already have a record for this machine
-  deque<MachinePerfStatisticsSample>* q =
-      FindOrNull(machine_map_, rid);
-  if (!q) {
-    // Add a blank queue for this machine
-    CHECK(InsertOrUpdate(&machine_map_, rid,
-                         deque<MachinePerfStatisticsSample>()));
-    q = FindOrNull(machine_map_, rid);
-    CHECK_NOTNULL(q);
+  MachineSampleShard* shard = ShardForMachine(rid);
+  {
+    boost::unique_lock<boost::shared_mutex> lock(shard->lock);
+    // N.B.: operator[] adds a blank queue if this is the machine's first
+    // sample.
+    PushSample(sample, &shard->machine_map[rid]);
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(updated_machines_lock_);
+    updated_machines_.insert(rid);
   }
-  if (q->size() * sizeof(sample) >= FLAGS_max_sample_queue_size * KB_TO_BYTES)
-    q->pop_front();  // drop from the front
-  q->push_back(sample);
   if (FLAGS_serialize_knowledge_base) {
+    boost::lock_guard<boost::upgrade_mutex> lock(kb_lock_);
     string message_string;
     sample.SerializeToString(&message_string);
     coded_machine_output_->WriteVarint32(message_string.size());
@@ -116,18 +115,8 @@ void KnowledgeBase::AddMachineSample(
 void KnowledgeBase::AddTaskSample(const TaskPerfStatisticsSample& sample) {
   TaskID_t tid = sample.task_id();
   boost::lock_guard<boost::upgrade_mutex> lock(kb_lock_);
-  // Check if we already have a record for this task
-  deque<TaskPerfStatisticsSample>* q = FindOrNull(task_map_, tid);
-  if (!q) {
-    // Add a blank queue for this task
-    CHECK(InsertOrUpdate(&task_map_, tid,
-                         deque<TaskPerfStatisticsSample>()));
-    q = FindOrNull(task_map_, tid);
-    CHECK_NOTNULL(q);
-  }
-  if (q->size() * sizeof(sample) >= FLAGS_max_sample_queue_size * KB_TO_BYTES)
-    q->pop_front();  // drop from the front
-  q->push_back(sample);
+  // N.B.: operator[] adds a blank queue if this is the task's first sample.
+  PushSample(sample, &task_map_[tid]);
   if (FLAGS_serialize_knowledge_base) {
     string message_string;
     sample.SerializeToString(&message_string);
@@ -137,16 +126,19 @@ void KnowledgeBase::AddTaskSample(const TaskPerfStatisticsSample& sample) {
 }
 
 void KnowledgeBase::DumpMachineStats(const ResourceID_t& res_id) const {
+  const MachineSampleShard& shard = ShardForMachine(res_id);
+  boost::shared_lock<boost::shared_mutex> lock(shard.lock);
   // Sanity checks
-  const deque<MachinePerfStatisticsSample>* q =
-      FindOrNull(machine_map_, res_id);
+  const SampleQueue<MachinePerfStatisticsSample>* q =
+      FindOrNull(shard.machine_map, res_id);
   if (!q)
     return;
   // Dump
   LOG(INFO) << "STATS FOR " << res_id << ": ";
-  LOG(INFO) << "Have " << q->size() << " samples.";
-  for (deque<MachinePerfStatisticsSample>::const_iterator it = q->begin();
-      it != q->end();
+  LOG(INFO) << "Have " << q->samples.size() << " samples.";
+  for (deque<MachinePerfStatisticsSample>::const_iterator it =
+         q->samples.begin();
+      it != q->samples.end();
       ++it) {
     LOG(INFO) << it->free_ram();
   }
@@ -155,109 +147,91 @@ void KnowledgeBase::DumpMachineStats(const ResourceID_t& res_id) const {
 bool KnowledgeBase::GetLatestStatsForMachine(
     ResourceID_t id,
     MachinePerfStatisticsSample* sample) {
-  boost::lock_guard<boost::upgrade_mutex> lock_shared(kb_lock_);
-  const deque<MachinePerfStatisticsSample>* res = FindOrNull(machine_map_, id);
+  MachineSampleShard* shard = ShardForMachine(id);
+  boost::shared_lock<boost::shared_mutex> lock(shard->lock);
+  const SampleQueue<MachinePerfStatisticsSample>* res =
+    FindOrNull(shard->machine_map, id);
   if (!res)
     return false;
   // We make a copy here, as we lose the lock when returning
-  sample->CopyFrom(res->back());
+  sample->CopyFrom(res->samples.back());
   return true;
 }
 
 const deque<MachinePerfStatisticsSample> KnowledgeBase::GetStatsForMachine(
       ResourceID_t id) {
-  boost::lock_guard<boost::upgrade_mutex> lock_shared(kb_lock_);
-  const deque<MachinePerfStatisticsSample>* res = FindOrNull(machine_map_, id);
+  MachineSampleShard* shard = ShardForMachine(id);
+  boost::shared_lock<boost::shared_mutex> lock(shard->lock);
+  const SampleQueue<MachinePerfStatisticsSample>* res =
+    FindOrNull(shard->machine_map, id);
   if (!res) {
     const deque<MachinePerfStatisticsSample> empty;
     return empty;
   }
   // We make a copy here, as we lose the lock when returning
-  const deque<MachinePerfStatisticsSample> copy(*res);
+  const deque<MachinePerfStatisticsSample> copy(res->samples);
   return copy;
 }
 
 const deque<TaskPerfStatisticsSample>* KnowledgeBase::GetStatsForTask(
       TaskID_t id) const {
-  const deque<TaskPerfStatisticsSample>* res = FindOrNull(task_map_, id);
-  return res;
+  const SampleQueue<TaskPerfStatisticsSample>* res = FindOrNull(task_map_, id);
+  if (!res)
+    return NULL;
+  return &res->samples;
 }
 
 const deque<TaskFinalReport>* KnowledgeBase::GetFinalReportForTask(
       TaskID_t task_id) const {
-  const deque<TaskFinalReport>* res = FindOrNull(task_exec_reports_, task_id);
-  return res;
+  const FinalReports* res = FindOrNull(task_exec_reports_, task_id);
+  if (!res)
+    return NULL;
+  return &res->reports;
 }
 
 const deque<TaskFinalReport>* KnowledgeBase::GetFinalReportsForTEC(
       EquivClass_t ec_id) const {
-  const deque<TaskFinalReport>* res = FindOrNull(task_exec_reports_, ec_id);
-  return res;
+  const FinalReports* res = FindOrNull(task_exec_reports_, ec_id);
+  if (!res)
+    return NULL;
+  return &res->reports;
 }
 
 double KnowledgeBase::GetAvgCPIForTEC(EquivClass_t id) {
-  boost::lock_guard<boost::upgrade_mutex> lock_shared(kb_lock_);
-  const deque<TaskFinalReport>* res = FindOrNull(task_exec_reports_, id);
+  boost::shared_lock<boost::upgrade_mutex> lock_shared(kb_lock_);
+  const FinalReports* res = FindOrNull(task_exec_reports_, id);
   CHECK_NOTNULL(res);
-  if (!res || res->size() == 0)
+  if (!res || res->reports.size() == 0)
     return 0;
-  double accumulator = 0;
-  for (deque<TaskFinalReport>::const_iterator it = res->begin();
-       it != res->end();
-       ++it) {
-    accumulator += static_cast<double>(it->cycles()) /
-      static_cast<double>(it->instructions());
-  }
-  return accumulator / res->size();
+  return res->sums.cpi / res->reports.size();
 }
 
 double KnowledgeBase::GetAvgIPMAForTEC(EquivClass_t id) {
-  boost::lock_guard<boost::upgrade_mutex> lock_shared(kb_lock_);
-  const deque<TaskFinalReport>* res = FindOrNull(task_exec_reports_, id);
-  if (!res || res->size() == 0)
+  boost::shared_lock<boost::upgrade_mutex> lock_shared(kb_lock_);
+  const FinalReports* res = FindOrNull(task_exec_reports_, id);
+  if (!res || res->reports.size() == 0)
     return 0;
-  double accumulator = 0;
-  for (deque<TaskFinalReport>::const_iterator it = res->begin();
-       it != res->end();
-       ++it) {
-    accumulator += static_cast<double>(it->instructions()) /
-      static_cast<double>(it->llc_refs());
-  }
-  return accumulator / res->size();
+  return res->sums.ipma / res->reports.size();
 }
 
 double KnowledgeBase::GetAvgPsPIForTEC(EquivClass_t id) {
-  boost::lock_guard<boost::upgrade_mutex> lock_shared(kb_lock_);
-  const deque<TaskFinalReport>* res = FindOrNull(task_exec_reports_, id);
-  if (!res || res->size() == 0)
+  boost::shared_lock<boost::upgrade_mutex> lock_shared(kb_lock_);
+  const FinalReports* res = FindOrNull(task_exec_reports_, id);
+  if (!res || res->reports.size() == 0)
     return 0;
-  double accumulator = 0;
-  for (deque<TaskFinalReport>::const_iterator it = res->begin();
-       it != res->end();
-       ++it) {
-    accumulator += static_cast<double>(it->runtime() * 10000000000.0) /
-      static_cast<double>(it->instructions());
-  }
-  return accumulator / res->size();
+  return res->sums.pspi / res->reports.size();
 }
 
 double KnowledgeBase::GetAvgRuntimeForTEC(EquivClass_t id) {
-  boost::lock_guard<boost::upgrade_mutex> lock_shared(kb_lock_);
-  const deque<TaskFinalReport>* res = FindOrNull(task_exec_reports_, id);
-  if (!res || res->size() == 0)
+  boost::shared_lock<boost::upgrade_mutex> lock_shared(kb_lock_);
+  const FinalReports* res = FindOrNull(task_exec_reports_, id);
+  if (!res || res->reports.size() == 0)
     return 0;
-  double accumulator = 0;
-  for (deque<TaskFinalReport>::const_iterator it = res->begin();
-       it != res->end();
-       ++it) {
-    // Runtime is in seconds, but a double -- so convert into ms here
-    accumulator += it->runtime() * 1000.0;
-  }
-  return accumulator / res->size();
+  return res->sums.runtime_ms / res->reports.size();
 }
 
 uint64_t KnowledgeBase::GetRuntimeForTask(TaskID_t task_id) {
-  boost::lock_guard<boost::upgrade_mutex> lock_shared(kb_lock_);
+  boost::shared_lock<boost::upgrade_mutex> lock_shared(kb_lock_);
   const deque<TaskFinalReport>* rep = GetFinalReportForTask(task_id);
   CHECK_NOTNULL(rep);
   CHECK(rep->size() > 0);
@@ -327,27 +301,136 @@ void KnowledgeBase::LoadKnowledgeBaseFromFile() {
   task_samples.close();
 }
 
+KnowledgeBase::ReportMetrics KnowledgeBase::MetricsForReport(
+    const TaskFinalReport& report) {
+  ReportMetrics metrics;
+  metrics.cpi = static_cast<double>(report.cycles()) /
+    static_cast<double>(report.instructions());
+  metrics.ipma = static_cast<double>(report.instructions()) /
+    static_cast<double>(report.llc_refs());
+  metrics.pspi = static_cast<double>(report.runtime() * 10000000000.0) /
+    static_cast<double>(report.instructions());
+  // Runtime is in seconds, but a double -- so convert into ms here
+  metrics.runtime_ms = report.runtime() * 1000.0;
+  return metrics;
+}
+
 void KnowledgeBase::ProcessTaskFinalReport(
     const vector<EquivClass_t>& equiv_classes,
     const TaskFinalReport& report) {
+  ReportMetrics metrics = MetricsForReport(report);
   boost::lock_guard<boost::upgrade_mutex> lock(kb_lock_);
   for (auto& tec : equiv_classes) {
-    // Check if we already have a record for this equiv class
-    deque<TaskFinalReport>* reports = FindOrNull(task_exec_reports_, tec);
-    if (!reports) {
-      // Add a blank queue for this task
-      CHECK(InsertOrUpdate(&task_exec_reports_, tec,
-                           deque<TaskFinalReport>()));
-      reports = FindOrNull(task_exec_reports_, tec);
-      CHECK_NOTNULL(reports);
+    // N.B.: operator[] adds a blank queue if this is the equivalence class's
+    // first report.
+    FinalReports* reports = &task_exec_reports_[tec];
+    reports->reports.push_back(report);
+    reports->metrics.push_back(metrics);
+    // The stored copy can use less memory than the report we were given, and
+    // the copy is what we subtract when it is evicted.
+    reports->bytes += reports->reports.back().SpaceUsed();
+    reports->sums.cpi += metrics.cpi;
+    reports->sums.ipma += metrics.ipma;
+    reports->sums.pspi += metrics.pspi;
+    reports->sums.runtime_ms += metrics.runtime_ms;
+    bool recompute_sums = false;
+    // Evict the oldest reports until the queue fits, but always keep the
+    // new one.
+    while (reports->reports.size() > 1 &&
+           reports->bytes > FLAGS_max_sample_queue_size * KB_TO_BYTES) {
+      const ReportMetrics& evicted = reports->metrics.front();
+      reports->sums.cpi -= evicted.cpi;
+      reports->sums.ipma -= evicted.ipma;
+      reports->sums.pspi -= evicted.pspi;
+      reports->sums.runtime_ms -= evicted.runtime_ms;
+      // Subtracting a non-finite metric (e.g., the CPI of a report with no
+      // instructions) does not restore the sums.
+      recompute_sums |= !std::isfinite(evicted.cpi) ||
+        !std::isfinite(evicted.ipma) || !std::isfinite(evicted.pspi);
+      reports->bytes -= reports->reports.front().SpaceUsed();
+      reports->reports.pop_front();
+      reports->metrics.pop_front();
+      reports->evictions_since_recompute++;
     }
-    if (reports->size() * sizeof(report) >=
-        FLAGS_max_sample_queue_size * KB_TO_BYTES) {
-      reports->pop_front();
+    // Rounding errors accumulate in the sums as reports are added and
+    // evicted. We bound them by recomputing the sums once as many reports
+    // have been evicted as the queue holds, which keeps the amortized cost
+    // per report constant.
+    if (recompute_sums ||
+        reports->evictions_since_recompute >= reports->reports.size()) {
+      RecomputeSums(reports);
     }
-    reports->push_back(report);
     VLOG(2) << "Recorded final report for task " << report.task_id();
   }
 }
 
+template<typename T>
+void KnowledgeBase::PushSample(const T& sample, SampleQueue<T>* queue) {
+  queue->samples.push_back(sample);
+  // We account for the stored copies' actual in-memory size, which includes
+  // their repeated fields and strings. A copy can use less memory than the
+  // sample it was made from, and it is the copy's size that we subtract when
+  // it is evicted.
+  queue->bytes += queue->samples.back().SpaceUsed();
+  // Evict the oldest samples until the queue fits, but always keep the new
+  // one.
+  while (queue->samples.size() > 1 &&
+         queue->bytes > FLAGS_max_sample_queue_size * KB_TO_BYTES) {
+    queue->bytes -= queue->samples.front().SpaceUsed();
+    queue->samples.pop_front();  // drop from the front
+  }
+}
+
+void KnowledgeBase::RecomputeSums(FinalReports* reports) {
+  reports->sums.cpi = reports->sums.ipma = reports->sums.pspi =
+    reports->sums.runtime_ms = 0.0;
+  for (auto& metrics : reports->metrics) {
+    reports->sums.cpi += metrics.cpi;
+    reports->sums.ipma += metrics.ipma;
+    reports->sums.pspi += metrics.pspi;
+    reports->sums.runtime_ms += metrics.runtime_ms;
+  }
+  reports->evictions_since_recompute = 0;
+}
+
+KnowledgeBase::MachineSampleShard* KnowledgeBase::ShardForMachine(
+    ResourceID_t res_id) {
+  return &machine_shards_[boost::hash<boost::uuids::uuid>()(res_id) %
+                          kNumMachineShards];
+}
+
+const KnowledgeBase::MachineSampleShard& KnowledgeBase::ShardForMachine(
+    ResourceID_t res_id) const {
+  return machine_shards_[boost::hash<boost::uuids::uuid>()(res_id) %
+                         kNumMachineShards];
+}
+
+void KnowledgeBase::TakeUpdatedMachines(vector<ResourceID_t>* res_ids) {
+  CHECK_NOTNULL(res_ids);
+  boost::lock_guard<boost::mutex> lock(updated_machines_lock_);
+  res_ids->insert(res_ids->end(), updated_machines_.begin(),
+                  updated_machines_.end());
+  updated_machines_.clear();
+}
+
+bool KnowledgeBase::VisitRecentStatsForMachine(
+    ResourceID_t id, uint64_t max_samples,
+    boost::function<void(const MachinePerfStatisticsSample&)> visitor) {
+  MachineSampleShard* shard = ShardForMachine(id);
+  boost::shared_lock<boost::shared_mutex> lock(shard->lock);
+  const SampleQueue<MachinePerfStatisticsSample>* res =
+    FindOrNull(shard->machine_map, id);
+  if (!res)
+    return false;
+  uint64_t num_samples = min(max_samples,
+                             static_cast<uint64_t>(res->samples.size()));
+  for (deque<MachinePerfStatisticsSample>::const_iterator it =
+         res->samples.end() - num_samples;
+       it != res->samples.end();
+       ++it) {
+    visitor(*it);
+  }
+  return true;
+}
+
 }  // namespace firmament
@@ -32,6 +32,9 @@
 #include <string>
 #include <vector>
 
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
@@ -56,6 +59,19 @@ class KnowledgeBase {
                                 MachinePerfStatisticsSample* sample);
   const deque<MachinePerfStatisticsSample> GetStatsForMachine(
       ResourceID_t id);
+  /**
+   * Invokes the visitor on a machine's most recent samples, oldest first.
+   * The visitor runs under a shared lock on the machine's shard, so the
+   * samples are not copied. The visitor must not call into the knowledge
+   * base.
+   * @param id the id of the machine
+   * @param max_samples the maximum number of samples to visit
+   * @param visitor the function to invoke on each sample
+   * @return false if there are no samples for the machine
+   */
+  bool VisitRecentStatsForMachine(
+      ResourceID_t id, uint64_t max_samples,
+      boost::function<void(const MachinePerfStatisticsSample&)> visitor);
   const deque<TaskPerfStatisticsSample>* GetStatsForTask(
       TaskID_t id) const;
   virtual double GetAvgCPIForTEC(EquivClass_t id);
@@ -68,6 +84,11 @@ class KnowledgeBase {
   void LoadKnowledgeBaseFromFile();
   void ProcessTaskFinalReport(const vector<EquivClass_t>& equiv_classes,
                               const TaskFinalReport& report);
+  /**
+   * Moves the IDs of the machines for which samples have been added since
+   * the last call into res_ids.
+   */
+  void TakeUpdatedMachines(vector<ResourceID_t>* res_ids);
   inline const DataLayerManagerInterface& data_layer_manager() {
     CHECK_NOTNULL(data_layer_manager_);
     return *data_layer_manager_;
@@ -78,15 +99,69 @@ class KnowledgeBase {
   }
 
  protected:
-  unordered_map<ResourceID_t, deque<MachinePerfStatisticsSample>,
-      boost::hash<boost::uuids::uuid> > machine_map_;
+  // Number of shards the machine samples are split into. Samples for
+  // different machines arrive concurrently, and the cost models read them
+  // while the samples of other machines are being added.
+  static const uint32_t kNumMachineShards = 16;
+
+  // A queue of samples, together with their total in-memory size.
+  template<typename T>
+  struct SampleQueue {
+    SampleQueue() : bytes(0) {}
+    deque<T> samples;
+    uint64_t bytes;
+  };
+  // The metrics we average over an equivalence class's final reports.
+  struct ReportMetrics {
+    double cpi;
+    double ipma;
+    double pspi;
+    double runtime_ms;
+  };
+  // The final reports of an equivalence class (or task). The metrics of each
+  // report are stored alongside it, and their sums are maintained as
+  // reports are added and evicted, so the averages take constant time.
+  struct FinalReports {
+    FinalReports() : bytes(0), evictions_since_recompute(0) {
+      sums.cpi = sums.ipma = sums.pspi = sums.runtime_ms = 0.0;
+    }
+    deque<TaskFinalReport> reports;
+    deque<ReportMetrics> metrics;
+    ReportMetrics sums;
+    uint64_t bytes;
+    // Number of reports evicted since the sums were last recomputed.
+    uint64_t evictions_since_recompute;
+  };
+  struct MachineSampleShard {
+    mutable boost::shared_mutex lock;
+    unordered_map<ResourceID_t, SampleQueue<MachinePerfStatisticsSample>,
+        boost::hash<boost::uuids::uuid> > machine_map;
+  };
+
+  MachineSampleShard* ShardForMachine(ResourceID_t res_id);
+  const MachineSampleShard& ShardForMachine(ResourceID_t res_id) const;
+  static ReportMetrics MetricsForReport(const TaskFinalReport& report);
+  template<typename T>
+  static void PushSample(const T& sample, SampleQueue<T>* queue);
+  static void RecomputeSums(FinalReports* reports);
+
+  MachineSampleShard machine_shards_[kNumMachineShards];
+  // Machines for which we have received samples since the last call to
+  // TakeUpdatedMachines.
+  unordered_set<ResourceID_t, boost::hash<boost::uuids::uuid> >
+    updated_machines_;
+  boost::mutex updated_machines_lock_;
   // TODO(malte): note that below sample queue has no awareness of time within a
   // task, i.e. it mixes samples from all phases
-  unordered_map<TaskID_t, deque<TaskPerfStatisticsSample> > task_map_;
-  unordered_map<TaskID_t, deque<TaskFinalReport> > task_exec_reports_;
+  unordered_map<TaskID_t, SampleQueue<TaskPerfStatisticsSample> > task_map_;
+  unordered_map<TaskID_t, FinalReports> task_exec_reports_;
+  // Protects task_map_ and task_exec_reports_. Readers take it shared.
   boost::upgrade_mutex kb_lock_;
 
  private:
+  FRIEND_TEST(KnowledgeBaseTest, PeriodicSumRecompute);
+  FRIEND_TEST(KnowledgeBaseTest, QueueBytesMatchStoredEntries);
+
   fstream serial_machine_samples_;
   fstream serial_task_samples_;
   ::google::protobuf::io::ZeroCopyOutputStream* raw_machine_output_;
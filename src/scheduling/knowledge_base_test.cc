@@ -0,0 +1,221 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Knowledge base unit tests.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "base/common.h"
+#include "base/task_final_report.pb.h"
+#include "base/units.h"
+#include "misc/map-util.h"
+#include "misc/utils.h"
+#include "scheduling/knowledge_base.h"
+
+DECLARE_uint64(max_sample_queue_size);
+
+namespace firmament {
+
+// The fixture for testing class KnowledgeBase.
+class KnowledgeBaseTest : public ::testing::Test {
+ protected:
+  // You can remove any or all of the following functions if its body
+  // is empty.
+
+  KnowledgeBaseTest() : ecs_({kTEC}) {
+    // You can do set-up work for each test here.
+  }
+
+  virtual ~KnowledgeBaseTest() {
+    // You can do clean-up work that doesn't throw exceptions here.
+  }
+
+  // If the constructor and destructor are not enough for setting up
+  // and cleaning up each test, you can define the following methods:
+
+  virtual void SetUp() {
+    // Code here will be called immediately after the constructor (right
+    // before each test).
+    FLAGS_max_sample_queue_size = 1;
+  }
+
+  virtual void TearDown() {
+    // Code here will be called immediately after each test (right
+    // before the destructor).
+    FLAGS_max_sample_queue_size = 100;
+  }
+
+  // Objects declared here can be used by all tests in the test case for
+  // KnowledgeBase.
+  static const EquivClass_t kTEC = 42;
+
+  // Adds a report whose CPI is cycles / 1000 and whose runtime is
+  // runtime_sec seconds.
+  void AddReport(uint64_t cycles, uint64_t instructions, double runtime_sec) {
+    TaskFinalReport report;
+    report.set_task_id(++num_reports_);
+    report.set_instructions(instructions);
+    report.set_cycles(cycles);
+    report.set_llc_refs(100);
+    report.set_runtime(runtime_sec);
+    kb_.ProcessTaskFinalReport(ecs_, report);
+  }
+
+  // Number of reports that fit in an equivalence class's queue. All reports
+  // have the same in-memory size, as they only have scalar fields.
+  uint64_t ReportsPerQueue() {
+    TaskFinalReport report;
+    return FLAGS_max_sample_queue_size * KB_TO_BYTES / report.SpaceUsed();
+  }
+
+  KnowledgeBase kb_;
+  vector<EquivClass_t> ecs_;
+  uint64_t num_reports_ = 0;
+};
+
+const EquivClass_t KnowledgeBaseTest::kTEC;
+
+// Tests that the oldest reports are evicted once their in-memory size
+// exceeds the queue size, and that the averages only cover the remaining
+// reports.
+TEST_F(KnowledgeBaseTest, EvictionBySpaceUsed) {
+  uint64_t capacity = ReportsPerQueue();
+  ASSERT_GT(capacity, 1UL);
+  // The first report gets evicted: its CPI and runtime must not skew the
+  // averages afterwards.
+  AddReport(100000, 1000, 100.0);
+  for (uint64_t i = 0; i < capacity; ++i) {
+    AddReport(2000, 1000, 1.0);
+  }
+  const deque<TaskFinalReport>* reports = kb_.GetFinalReportsForTEC(kTEC);
+  ASSERT_TRUE(reports != NULL);
+  EXPECT_EQ(reports->size(), capacity);
+  EXPECT_EQ(reports->front().task_id(), 2UL);
+  EXPECT_DOUBLE_EQ(kb_.GetAvgCPIForTEC(kTEC), 2.0);
+  EXPECT_DOUBLE_EQ(kb_.GetAvgIPMAForTEC(kTEC), 10.0);
+  EXPECT_DOUBLE_EQ(kb_.GetAvgRuntimeForTEC(kTEC), 1000.0);
+  // Once half of the queue has been replaced, the averages are those of
+  // the two halves.
+  for (uint64_t i = 0; i < capacity / 2; ++i) {
+    AddReport(4000, 1000, 3.0);
+  }
+  EXPECT_EQ(reports->size(), capacity);
+  double new_share =
+    static_cast<double>(capacity / 2) / static_cast<double>(capacity);
+  EXPECT_NEAR(kb_.GetAvgCPIForTEC(kTEC), 2.0 + 2.0 * new_share, 1e-9);
+  EXPECT_NEAR(kb_.GetAvgRuntimeForTEC(kTEC), 1000.0 + 2000.0 * new_share,
+              1e-9);
+}
+
+// Tests that the averages become finite again once a report with a
+// non-finite metric has been evicted.
+TEST_F(KnowledgeBaseTest, EvictNonFiniteReport) {
+  uint64_t capacity = ReportsPerQueue();
+  // A report without instructions has an infinite CPI, and an IPMA and PsPI
+  // of NaN or infinity.
+  AddReport(1000, 0, 1.0);
+  AddReport(3000, 1000, 1.0);
+  EXPECT_FALSE(std::isfinite(kb_.GetAvgCPIForTEC(kTEC)));
+  for (uint64_t i = 1; i < capacity; ++i) {
+    AddReport(3000, 1000, 1.0);
+  }
+  ASSERT_EQ(kb_.GetFinalReportsForTEC(kTEC)->front().task_id(), 2UL);
+  EXPECT_DOUBLE_EQ(kb_.GetAvgCPIForTEC(kTEC), 3.0);
+  EXPECT_DOUBLE_EQ(kb_.GetAvgIPMAForTEC(kTEC), 10.0);
+  EXPECT_TRUE(std::isfinite(kb_.GetAvgPsPIForTEC(kTEC)));
+}
+
+// Tests that the running sums are recomputed from the stored metrics once
+// as many reports have been evicted as the queue holds.
+TEST_F(KnowledgeBaseTest, PeriodicSumRecompute) {
+  uint64_t capacity = ReportsPerQueue();
+  for (uint64_t i = 0; i < capacity; ++i) {
+    AddReport(1000 + i, 1000, 0.1);
+  }
+  KnowledgeBase::FinalReports* reports =
+    FindOrNull(kb_.task_exec_reports_, kTEC);
+  ASSERT_TRUE(reports != NULL);
+  EXPECT_EQ(reports->evictions_since_recompute, 0UL);
+  // Skew the sums to detect when they are recomputed.
+  reports->sums.cpi += 1000.0;
+  for (uint64_t i = 1; i < capacity; ++i) {
+    AddReport(1000, 1000, 0.1);
+    EXPECT_EQ(reports->evictions_since_recompute, i);
+  }
+  EXPECT_GT(kb_.GetAvgCPIForTEC(kTEC), 2.0);
+  AddReport(1000, 1000, 0.1);
+  EXPECT_EQ(reports->evictions_since_recompute, 0UL);
+  EXPECT_DOUBLE_EQ(kb_.GetAvgCPIForTEC(kTEC), 1.0);
+  EXPECT_NEAR(kb_.GetAvgRuntimeForTEC(kTEC), 100.0, 1e-9);
+}
+
+// Tests that the byte counts of the queues remain equal to the in-memory size
+// of the entries they hold, as entries are added and evicted.
+TEST_F(KnowledgeBaseTest, QueueBytesMatchStoredEntries) {
+  FLAGS_max_sample_queue_size = 100;
+  uint64_t max_bytes = FLAGS_max_sample_queue_size * KB_TO_BYTES;
+  ResourceID_t res_id = GenerateResourceID();
+  for (uint64_t i = 0; i < 5000; ++i) {
+    MachinePerfStatisticsSample sample;
+    sample.set_resource_id(to_string(res_id));
+    sample.set_timestamp(i);
+    // The repeated field grows its capacity as CPUs are added, while the
+    // stored copy only allocates what it needs, so the sample uses more
+    // memory than its copy.
+    for (uint32_t cpu = 0; cpu < 12; ++cpu) {
+      sample.add_cpus_usage()->set_user(0.5);
+    }
+    kb_.AddMachineSample(sample);
+  }
+  const KnowledgeBase::SampleQueue<MachinePerfStatisticsSample>* samples =
+    FindOrNull(kb_.ShardForMachine(res_id)->machine_map, res_id);
+  ASSERT_TRUE(samples != NULL);
+  uint64_t samples_bytes = 0;
+  for (auto& sample : samples->samples) {
+    samples_bytes += sample.SpaceUsed();
+  }
+  EXPECT_EQ(samples->bytes, samples_bytes);
+  EXPECT_GT(samples->samples.size(), 1UL);
+  EXPECT_LE(samples->bytes, max_bytes);
+  // The queue is full: another sample would not fit.
+  EXPECT_GT(samples->bytes + samples->samples.back().SpaceUsed(), max_bytes);
+  for (uint64_t i = 0; i < 5000; ++i) {
+    AddReport(1000 + i, 1000, 1.0);
+  }
+  KnowledgeBase::FinalReports* reports =
+    FindOrNull(kb_.task_exec_reports_, kTEC);
+  ASSERT_TRUE(reports != NULL);
+  uint64_t reports_bytes = 0;
+  for (auto& report : reports->reports) {
+    reports_bytes += report.SpaceUsed();
+  }
+  EXPECT_EQ(reports->bytes, reports_bytes);
+  EXPECT_EQ(reports->reports.size(), ReportsPerQueue());
+}
+
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
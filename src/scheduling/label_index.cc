@@ -0,0 +1,254 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "scheduling/label_index.h"
+
+#include <algorithm>
+
+#include "misc/map-util.h"
+
+namespace firmament {
+namespace scheduler {
+
+LabelIndex::LabelIndex() {
+}
+
+void LabelIndex::AddMachine(ResourceID_t res_id,
+                            const ResourceDescriptor& rd) {
+  uint32_t slot;
+  if (free_slots_.empty()) {
+    // All the bitsets are kept as large as the number of slots so that they
+    // can be combined directly.
+    slot = slot_to_machine_.size();
+    slot_to_machine_.push_back(res_id);
+    slot_labels_.push_back(MachineLabels());
+    live_slots_.push_back(false);
+    for (auto& machines : key_machines_) {
+      machines.push_back(false);
+    }
+    for (auto& machines : label_machines_) {
+      machines.push_back(false);
+    }
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+    slot_to_machine_[slot] = res_id;
+  }
+  CHECK(InsertIfNotPresent(&machine_to_slot_, res_id, slot))
+    << "Machine " << res_id << " is already in the label index";
+  live_slots_.set(slot);
+  MachineLabels* machine_labels = &slot_labels_[slot];
+  machine_labels->key_ids.clear();
+  machine_labels->label_ids.clear();
+  for (const auto& label : rd.labels()) {
+    LabelKeyID_t key_id = InternKey(label.key());
+    if (key_machines_[key_id].test(slot)) {
+      // SatisfiesLabelSelector only looks at the first label with a key.
+      continue;
+    }
+    LabelID_t label_id = InternLabel(key_id, label.value());
+    machine_labels->key_ids.push_back(key_id);
+    machine_labels->label_ids.push_back(label_id);
+    key_machines_[key_id].set(slot);
+    label_machines_[label_id].set(slot);
+  }
+  sort(machine_labels->key_ids.begin(), machine_labels->key_ids.end());
+  sort(machine_labels->label_ids.begin(), machine_labels->label_ids.end());
+}
+
+void LabelIndex::CompileSelectors(
+    const RepeatedPtrField<LabelSelector>& selectors,
+    CompiledLabelSelectors* compiled) const {
+  compiled->clear();
+  compiled->reserve(selectors.size());
+  for (const auto& selector : selectors) {
+    CompiledLabelSelector compiled_selector;
+    compiled_selector.type = selector.type();
+    const LabelKeyID_t* key_id = FindOrNull(key_ids_, selector.key());
+    if (key_id) {
+      compiled_selector.key_id = *key_id;
+      const unordered_map<string, LabelID_t>& value_ids =
+        key_value_ids_[*key_id];
+      for (const auto& value : selector.values()) {
+        const LabelID_t* label_id = FindOrNull(value_ids, value);
+        if (label_id) {
+          compiled_selector.label_ids.push_back(*label_id);
+        }
+      }
+    } else {
+      compiled_selector.key_id = kUnknownLabelKeyID;
+    }
+    sort(compiled_selector.label_ids.begin(),
+         compiled_selector.label_ids.end());
+    compiled->push_back(compiled_selector);
+  }
+}
+
+void LabelIndex::GetCandidateMachines(const CompiledLabelSelectors& selectors,
+                                      vector<ResourceID_t>* machines) const {
+  machines->clear();
+  boost::dynamic_bitset<> candidates(live_slots_);
+  boost::dynamic_bitset<> selected(live_slots_.size());
+  for (const auto& selector : selectors) {
+    switch (selector.type) {
+      case LabelSelector::IN_SET: {
+        MachinesWithAnyLabel(selector.label_ids, &selected);
+        candidates &= selected;
+        break;
+      }
+      case LabelSelector::NOT_IN_SET: {
+        MachinesWithAnyLabel(selector.label_ids, &selected);
+        candidates -= selected;
+        break;
+      }
+      case LabelSelector::EXISTS_KEY: {
+        if (selector.key_id == kUnknownLabelKeyID) {
+          candidates.reset();
+        } else {
+          candidates &= key_machines_[selector.key_id];
+        }
+        break;
+      }
+      case LabelSelector::NOT_EXISTS_KEY: {
+        if (selector.key_id != kUnknownLabelKeyID) {
+          candidates -= key_machines_[selector.key_id];
+        }
+        break;
+      }
+      default:
+        LOG(FATAL) << "Unsupported selector type: " << selector.type;
+    }
+    if (candidates.none()) {
+      return;
+    }
+  }
+  for (boost::dynamic_bitset<>::size_type slot = candidates.find_first();
+       slot != boost::dynamic_bitset<>::npos;
+       slot = candidates.find_next(slot)) {
+    machines->push_back(slot_to_machine_[slot]);
+  }
+}
+
+LabelKeyID_t LabelIndex::InternKey(const string& key) {
+  LabelKeyID_t* key_id = FindOrNull(key_ids_, key);
+  if (key_id) {
+    return *key_id;
+  }
+  LabelKeyID_t new_key_id = key_machines_.size();
+  CHECK(InsertIfNotPresent(&key_ids_, key, new_key_id));
+  key_value_ids_.push_back(unordered_map<string, LabelID_t>());
+  key_machines_.push_back(boost::dynamic_bitset<>(slot_to_machine_.size()));
+  return new_key_id;
+}
+
+LabelID_t LabelIndex::InternLabel(LabelKeyID_t key_id, const string& value) {
+  unordered_map<string, LabelID_t>* value_ids = &key_value_ids_[key_id];
+  LabelID_t* label_id = FindOrNull(*value_ids, value);
+  if (label_id) {
+    return *label_id;
+  }
+  LabelID_t new_label_id = label_machines_.size();
+  CHECK(InsertIfNotPresent(value_ids, value, new_label_id));
+  label_machines_.push_back(boost::dynamic_bitset<>(slot_to_machine_.size()));
+  return new_label_id;
+}
+
+bool LabelIndex::MachineSatisfiesSelectors(
+    const CompiledLabelSelectors& selectors,
+    ResourceID_t res_id) const {
+  const uint32_t* slot = FindOrNull(machine_to_slot_, res_id);
+  CHECK_NOTNULL(slot);
+  const MachineLabels& machine_labels = slot_labels_[*slot];
+  for (const auto& selector : selectors) {
+    bool has_key = binary_search(machine_labels.key_ids.begin(),
+                                 machine_labels.key_ids.end(),
+                                 selector.key_id);
+    bool has_value = false;
+    if (has_key && (selector.type == LabelSelector::IN_SET ||
+                    selector.type == LabelSelector::NOT_IN_SET)) {
+      for (auto& label_id : selector.label_ids) {
+        if (binary_search(machine_labels.label_ids.begin(),
+                          machine_labels.label_ids.end(), label_id)) {
+          has_value = true;
+          break;
+        }
+      }
+    }
+    switch (selector.type) {
+      case LabelSelector::IN_SET: {
+        if (!has_value) {
+          return false;
+        }
+        break;
+      }
+      case LabelSelector::NOT_IN_SET: {
+        if (has_value) {
+          return false;
+        }
+        break;
+      }
+      case LabelSelector::EXISTS_KEY: {
+        if (!has_key) {
+          return false;
+        }
+        break;
+      }
+      case LabelSelector::NOT_EXISTS_KEY: {
+        if (has_key) {
+          return false;
+        }
+        break;
+      }
+      default:
+        LOG(FATAL) << "Unsupported selector type: " << selector.type;
+    }
+  }
+  return true;
+}
+
+void LabelIndex::MachinesWithAnyLabel(
+    const vector<LabelID_t>& label_ids,
+    boost::dynamic_bitset<>* machines) const {
+  machines->reset();
+  for (auto& label_id : label_ids) {
+    *machines |= label_machines_[label_id];
+  }
+}
+
+void LabelIndex::RemoveMachine(ResourceID_t res_id) {
+  uint32_t* slot_ptr = FindOrNull(machine_to_slot_, res_id);
+  CHECK_NOTNULL(slot_ptr);
+  uint32_t slot = *slot_ptr;
+  MachineLabels* machine_labels = &slot_labels_[slot];
+  for (auto& key_id : machine_labels->key_ids) {
+    key_machines_[key_id].reset(slot);
+  }
+  for (auto& label_id : machine_labels->label_ids) {
+    label_machines_[label_id].reset(slot);
+  }
+  machine_labels->key_ids.clear();
+  machine_labels->label_ids.clear();
+  live_slots_.reset(slot);
+  machine_to_slot_.erase(res_id);
+  free_slots_.push_back(slot);
+}
+
+}  // namespace scheduler
+}  // namespace firmament
@@ -0,0 +1,136 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Inverted index from resource labels to the machines that carry them. Label
+// selectors are compiled against the index into integer IDs, so that they can
+// be matched without string comparisons, and the machines that satisfy a
+// selector list can be obtained with bitset operations.
+
+#ifndef FIRMAMENT_SCHEDULING_LABEL_INDEX_H
+#define FIRMAMENT_SCHEDULING_LABEL_INDEX_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include "base/common.h"
+#include "base/label_selector.pb.h"
+#include "base/resource_desc.pb.h"
+#include "base/types.h"
+
+namespace firmament {
+namespace scheduler {
+
+typedef uint32_t LabelKeyID_t;
+typedef uint32_t LabelID_t;
+
+// Key ID of compiled selectors whose key no machine has.
+const LabelKeyID_t kUnknownLabelKeyID = 0xFFFFFFFF;
+
+struct CompiledLabelSelector {
+  LabelSelector::SelectorType type;
+  LabelKeyID_t key_id;
+  // Sorted IDs of the (key, value) labels the selector refers to. Values that
+  // no machine has are left out, as no machine can match them.
+  vector<LabelID_t> label_ids;
+};
+
+typedef vector<CompiledLabelSelector> CompiledLabelSelectors;
+
+class LabelIndex {
+ public:
+  LabelIndex();
+  /**
+   * Adds a machine and its labels to the index. If the machine has several
+   * labels with the same key, only the first one is indexed, as in
+   * SatisfiesLabelSelector.
+   * @param res_id the id of the machine
+   * @param rd the descriptor of the machine
+   */
+  void AddMachine(ResourceID_t res_id, const ResourceDescriptor& rd);
+  /**
+   * Compiles label selectors into interned key and label IDs. Tasks should
+   * compile their selectors once and reuse the result. Compiling does not
+   * intern anything, so tasks cannot grow the index with keys and values
+   * that no machine has. Hence, the compiled selectors must be recompiled
+   * once NumInternedLabels() changes.
+   * @param selectors the selectors to compile
+   * @param compiled vector that gets populated with the compiled selectors
+   */
+  void CompileSelectors(const RepeatedPtrField<LabelSelector>& selectors,
+                        CompiledLabelSelectors* compiled) const;
+  /**
+   * Computes the machines that satisfy all the compiled selectors.
+   * @param selectors the compiled selectors
+   * @param machines vector that gets populated with the ids of the machines
+   */
+  void GetCandidateMachines(const CompiledLabelSelectors& selectors,
+                            vector<ResourceID_t>* machines) const;
+  /**
+   * Checks if a machine satisfies all the compiled selectors.
+   * @param selectors the compiled selectors
+   * @param res_id the id of the machine
+   * @return true if the machine satisfies the selectors
+   */
+  bool MachineSatisfiesSelectors(const CompiledLabelSelectors& selectors,
+                                 ResourceID_t res_id) const;
+  void RemoveMachine(ResourceID_t res_id);
+  inline uint64_t NumMachines() const {
+    return machine_to_slot_.size();
+  }
+  // Number of keys and labels interned so far. It only ever grows.
+  inline uint64_t NumInternedLabels() const {
+    return key_machines_.size() + label_machines_.size();
+  }
+
+ private:
+  struct MachineLabels {
+    // Sorted IDs of the machine's keys and of its (key, value) labels.
+    vector<LabelKeyID_t> key_ids;
+    vector<LabelID_t> label_ids;
+  };
+
+  LabelKeyID_t InternKey(const string& key);
+  LabelID_t InternLabel(LabelKeyID_t key_id, const string& value);
+  // Sets machines to the bitset of machines that carry any of the labels.
+  void MachinesWithAnyLabel(const vector<LabelID_t>& label_ids,
+                            boost::dynamic_bitset<>* machines) const;
+
+  // Interned keys, and interned (key, value) labels per key.
+  unordered_map<string, LabelKeyID_t> key_ids_;
+  vector<unordered_map<string, LabelID_t>> key_value_ids_;
+  // Machines carrying each key and each label, indexed by machine slot.
+  vector<boost::dynamic_bitset<>> key_machines_;
+  vector<boost::dynamic_bitset<>> label_machines_;
+  // Machines get dense slots, which are reused once a machine is removed.
+  unordered_map<ResourceID_t, uint32_t,
+    boost::hash<boost::uuids::uuid>> machine_to_slot_;
+  vector<ResourceID_t> slot_to_machine_;
+  vector<MachineLabels> slot_labels_;
+  vector<uint32_t> free_slots_;
+  boost::dynamic_bitset<> live_slots_;
+};
+
+}  // namespace scheduler
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SCHEDULING_LABEL_INDEX_H
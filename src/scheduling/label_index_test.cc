@@ -0,0 +1,188 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Tests for the label index.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/common.h"
+#include "misc/utils.h"
+#include "scheduling/label_index.h"
+#include "scheduling/label_utils.h"
+
+namespace firmament {
+namespace scheduler {
+
+class LabelIndexTest : public ::testing::Test {
+ protected:
+  LabelIndexTest() {
+    AddMachine(&machine1_, "machine1", "zone", "a", "gpu", "true");
+    AddMachine(&machine2_, "machine2", "zone", "b", "gpu", "false");
+    AddMachine(&machine3_, "machine3", "zone", "a", "", "");
+  }
+
+  void AddMachine(ResourceDescriptor* rd, const string& name,
+                  const string& key1, const string& value1,
+                  const string& key2, const string& value2) {
+    rd->set_uuid(to_string(GenerateResourceID(name)));
+    rd->set_type(ResourceDescriptor::RESOURCE_MACHINE);
+    Label* label = rd->add_labels();
+    label->set_key(key1);
+    label->set_value(value1);
+    if (!key2.empty()) {
+      label = rd->add_labels();
+      label->set_key(key2);
+      label->set_value(value2);
+    }
+    label_index_.AddMachine(ResourceIDFromString(rd->uuid()), *rd);
+  }
+
+  void AddSelector(LabelSelector::SelectorType type, const string& key,
+                   const vector<string>& values) {
+    LabelSelector* selector = selectors_.Add();
+    selector->set_type(type);
+    selector->set_key(key);
+    for (auto& value : values) {
+      selector->add_values(value);
+    }
+  }
+
+  // Checks that the index agrees with SatisfiesLabelSelectors.
+  void CheckCandidates(uint64_t expected_num_candidates) {
+    CompiledLabelSelectors compiled;
+    label_index_.CompileSelectors(selectors_, &compiled);
+    vector<ResourceID_t> candidates;
+    label_index_.GetCandidateMachines(compiled, &candidates);
+    EXPECT_EQ(candidates.size(), expected_num_candidates);
+    ResourceDescriptor* machines[] = {&machine1_, &machine2_, &machine3_};
+    for (auto& rd : machines) {
+      ResourceID_t res_id = ResourceIDFromString(rd->uuid());
+      bool satisfies = SatisfiesLabelSelectors(*rd, selectors_);
+      EXPECT_EQ(label_index_.MachineSatisfiesSelectors(compiled, res_id),
+                satisfies);
+      EXPECT_EQ(find(candidates.begin(), candidates.end(), res_id) !=
+                candidates.end(), satisfies);
+    }
+  }
+
+  LabelIndex label_index_;
+  ResourceDescriptor machine1_;
+  ResourceDescriptor machine2_;
+  ResourceDescriptor machine3_;
+  RepeatedPtrField<LabelSelector> selectors_;
+};
+
+TEST_F(LabelIndexTest, NoSelectors) {
+  CheckCandidates(3);
+}
+
+TEST_F(LabelIndexTest, InSet) {
+  AddSelector(LabelSelector::IN_SET, "zone", {"a"});
+  CheckCandidates(2);
+  AddSelector(LabelSelector::IN_SET, "gpu", {"true", "maybe"});
+  CheckCandidates(1);
+}
+
+TEST_F(LabelIndexTest, NotInSet) {
+  AddSelector(LabelSelector::NOT_IN_SET, "gpu", {"true"});
+  CheckCandidates(2);
+  AddSelector(LabelSelector::NOT_IN_SET, "zone", {"a", "c"});
+  CheckCandidates(1);
+}
+
+TEST_F(LabelIndexTest, ExistsKey) {
+  AddSelector(LabelSelector::EXISTS_KEY, "gpu", {});
+  CheckCandidates(2);
+  AddSelector(LabelSelector::NOT_EXISTS_KEY, "unknown", {});
+  CheckCandidates(2);
+  AddSelector(LabelSelector::NOT_EXISTS_KEY, "zone", {});
+  CheckCandidates(0);
+}
+
+TEST_F(LabelIndexTest, AddAndRemoveMachines) {
+  AddSelector(LabelSelector::IN_SET, "zone", {"a"});
+  CompiledLabelSelectors compiled;
+  label_index_.CompileSelectors(selectors_, &compiled);
+  label_index_.RemoveMachine(ResourceIDFromString(machine1_.uuid()));
+  EXPECT_EQ(label_index_.NumMachines(), 2);
+  vector<ResourceID_t> candidates;
+  label_index_.GetCandidateMachines(compiled, &candidates);
+  ASSERT_EQ(candidates.size(), 1);
+  EXPECT_EQ(candidates[0], ResourceIDFromString(machine3_.uuid()));
+  // The new machine reuses the removed machine's slot. The selectors compiled
+  // before it was added remain valid, as the machine's zone label was
+  // already interned.
+  ResourceDescriptor machine4;
+  AddMachine(&machine4, "machine4", "zone", "a", "ssd", "true");
+  label_index_.GetCandidateMachines(compiled, &candidates);
+  EXPECT_EQ(candidates.size(), 2);
+  EXPECT_TRUE(label_index_.MachineSatisfiesSelectors(
+      compiled, ResourceIDFromString(machine4.uuid())));
+}
+
+TEST_F(LabelIndexTest, DuplicateKeys) {
+  // Only the first label with a key counts, as in SatisfiesLabelSelector.
+  ResourceDescriptor machine4;
+  AddMachine(&machine4, "machine4", "zone", "b", "zone", "c");
+  AddSelector(LabelSelector::IN_SET, "zone", {"c"});
+  CompiledLabelSelectors compiled;
+  label_index_.CompileSelectors(selectors_, &compiled);
+  vector<ResourceID_t> candidates;
+  label_index_.GetCandidateMachines(compiled, &candidates);
+  EXPECT_EQ(candidates.size(), 0);
+  EXPECT_FALSE(SatisfiesLabelSelectors(machine4, selectors_));
+  EXPECT_FALSE(label_index_.MachineSatisfiesSelectors(
+      compiled, ResourceIDFromString(machine4.uuid())));
+  selectors_.Clear();
+  AddSelector(LabelSelector::NOT_IN_SET, "zone", {"c"});
+  CheckCandidates(4);
+}
+
+TEST_F(LabelIndexTest, CompilingDoesNotIntern) {
+  uint64_t num_interned_labels = label_index_.NumInternedLabels();
+  AddSelector(LabelSelector::IN_SET, "zone", {"a", "unknown"});
+  AddSelector(LabelSelector::NOT_EXISTS_KEY, "unknown", {});
+  CheckCandidates(2);
+  selectors_.Clear();
+  AddSelector(LabelSelector::EXISTS_KEY, "unknown", {});
+  CheckCandidates(0);
+  EXPECT_EQ(label_index_.NumInternedLabels(), num_interned_labels);
+  // Once a machine has the key, the selectors must be recompiled to match it.
+  ResourceDescriptor machine4;
+  AddMachine(&machine4, "machine4", "unknown", "true", "", "");
+  EXPECT_GT(label_index_.NumInternedLabels(), num_interned_labels);
+  CompiledLabelSelectors compiled;
+  label_index_.CompileSelectors(selectors_, &compiled);
+  vector<ResourceID_t> candidates;
+  label_index_.GetCandidateMachines(compiled, &candidates);
+  ASSERT_EQ(candidates.size(), 1);
+  EXPECT_EQ(candidates[0], ResourceIDFromString(machine4.uuid()));
+}
+
+}  // namespace scheduler
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
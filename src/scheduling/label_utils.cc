@@ -25,14 +25,32 @@
 namespace firmament {
 namespace scheduler {
 
-bool SatisfiesLabelSelectors(const ResourceDescriptor& rd,
-                             const RepeatedField<LabelSelector>& selectors) {
-  unordered_map<string, string> rd_labels;
+// Returns the value of the first label with the given key, or NULL if the
+// resource has no such label.
+static const string* FindLabelValue(const ResourceDescriptor& rd,
+                                    const string& key) {
   for (const auto& label : rd.labels()) {
-    InsertIfNotPresent(&rd_labels, label.key(), label.value());
+    if (label.key() == key) {
+      return &label.value();
+    }
+  }
+  return NULL;
+}
+
+static bool SelectorHasValue(const LabelSelector& selector,
+                             const string& value) {
+  for (const auto& selector_value : selector.values()) {
+    if (selector_value == value) {
+      return true;
+    }
   }
+  return false;
+}
+
+bool SatisfiesLabelSelectors(const ResourceDescriptor& rd,
+                             const RepeatedPtrField<LabelSelector>& selectors) {
   for (auto& selector : selectors) {
-    if (!SatisfiesLabelSelector(rd_labels, selector)) {
+    if (!SatisfiesLabelSelector(rd, selector)) {
       return false;
     }
   }
@@ -41,11 +59,27 @@ bool SatisfiesLabelSelectors(const ResourceDescriptor& rd,
 
 bool SatisfiesLabelSelector(const ResourceDescriptor& rd,
                             const LabelSelector& selector) {
-  unordered_map<string, string> rd_labels;
-  for (const auto& label : rd.labels()) {
-    InsertIfNotPresent(&rd_labels, label.key(), label.value());
+  // N.B.: resources and selectors have few labels and values, so we scan
+  // them rather than building hash maps on every call. Use a LabelIndex to
+  // match many resources against the same selectors.
+  const string* value = FindLabelValue(rd, selector.key());
+  switch (selector.type()) {
+    case LabelSelector::IN_SET: {
+      return value != NULL && SelectorHasValue(selector, *value);
+    }
+    case LabelSelector::NOT_IN_SET: {
+      return value == NULL || !SelectorHasValue(selector, *value);
+    }
+    case LabelSelector::EXISTS_KEY: {
+      return value != NULL;
+    }
+    case LabelSelector::NOT_EXISTS_KEY: {
+      return value == NULL;
+    }
+    default:
+      LOG(FATAL) << "Unsupported selector type: " << selector.type();
   }
-  return SatisfiesLabelSelector(rd_labels, selector);
+  return false;
 }
 
 bool SatisfiesLabelSelector(const unordered_map<string, string>& rd_labels,
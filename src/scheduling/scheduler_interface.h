@@ -39,6 +39,7 @@
 #include "engine/executors/topology_manager.h"
 #include "scheduling/knowledge_base.h"
 #include "scheduling/scheduling_delta.pb.h"
+#include "scheduling/solver_state.pb.h"
 #include "storage/object_store_interface.h"
 
 namespace firmament {
@@ -49,9 +50,36 @@ using machine::topology::TopologyManager;
 using store::DataObjectMap_t;
 using store::ObjectStoreInterface;
 
+// Phases of a scheduling round. Schedulers that don't have a phase leave
+// its runtime at zero.
+enum SchedulerPhase {
+  // Updating the resource topology statistics in the cost model.
+  PHASE_TOPOLOGY_STATS = 0,
+  // Adding and updating the flow graph nodes of the jobs to schedule.
+  PHASE_ADD_OR_UPDATE_JOB_NODES = 1,
+  // Merging and removing redundant incremental graph changes.
+  PHASE_CHANGE_OPTIMIZATION = 2,
+  // Writing the graph (or the graph changes) to the solver.
+  PHASE_EXPORT = 3,
+  // Running the solver algorithm.
+  PHASE_SOLVE = 4,
+  // Reading and parsing the solver's output.
+  PHASE_OUTPUT_PARSE = 5,
+  // Turning the solver's flow into task to PU mappings.
+  PHASE_GET_MAPPINGS = 6,
+  // Turning the task mappings into scheduling deltas.
+  PHASE_DELTA_GENERATION = 7,
+  // Applying the scheduling deltas.
+  PHASE_APPLY_DELTAS = 8,
+  NUM_SCHEDULER_PHASES = 9,
+};
+
 struct SchedulerStats {
   SchedulerStats() : algorithm_runtime_(numeric_limits<uint64_t>::max()),
     scheduler_runtime_(0ULL), total_runtime_(0ULL) {
+    for (uint32_t phase = 0; phase < NUM_SCHEDULER_PHASES; ++phase) {
+      phase_runtimes_[phase] = 0ULL;
+    }
   }
   // Accounts only the algorithmic part of the scheduler (in u-sec).
   uint64_t algorithm_runtime_;
@@ -62,6 +90,9 @@ struct SchedulerStats {
   // writing it, running the solver, reading the output and updating again
   // the graph.
   uint64_t total_runtime_;
+  // Runtime of each of the round's phases (in u-sec), indexed by
+  // SchedulerPhase.
+  uint64_t phase_runtimes_[NUM_SCHEDULER_PHASES];
 };
 
 class SchedulerInterface : public PrintableInterface {
@@ -136,7 +167,9 @@ class SchedulerInterface : public PrintableInterface {
   /**
    * Handles the failure of an attempt to delegate a task to a subordinate
    * coordinator. This can happen because the resource is no longer there (it
-   * failed) or it is no longer idle (someone else put a task there).
+   * failed) or it is no longer idle (someone else put a task there). The task
+   * becomes runnable again, and the caller is responsible for scheduling its
+   * job again.
    * @param td_ptr the descriptor of the task that could not be delegated
    */
   virtual void HandleTaskDelegationFailure(TaskDescriptor* td_ptr) = 0;
@@ -219,6 +252,31 @@ class SchedulerInterface : public PrintableInterface {
                                 bool local,
                                 bool simulated = false) = 0;
 
+  /**
+   * Places tasks without running a scheduling iteration, e.g., to restore
+   * the task placements saved in a simulation checkpoint. The jobs of the
+   * tasks must have been added.
+   * @param placements the tasks and the resources to place them on
+   */
+  virtual void RestoreTaskPlacements(
+      const vector<pair<TaskDescriptor*, ResourceDescriptor*>>& placements) = 0;
+
+  /**
+   * Restores the solver state saved by SaveSolverState, such that the first
+   * scheduling iteration after a restore does not start from scratch. It must
+   * be called after RestoreTaskPlacements.
+   * @param solver_state the saved state
+   */
+  virtual void RestoreSolverState(const SolverState& solver_state) = 0;
+
+  /**
+   * Saves the state the scheduler's solver carries over from one scheduling
+   * iteration to the next, e.g., to store it in a simulation checkpoint.
+   * Schedulers that do not use a solver save nothing.
+   * @param solver_state the state to save to
+   */
+  virtual void SaveSolverState(SolverState* solver_state) = 0;
+
   /**
    * Runs a scheduling iteration for all active jobs.
    * @return the number of tasks scheduled
@@ -0,0 +1,73 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "scheduling/scheduler_phase_stats.h"
+
+namespace firmament {
+namespace scheduler {
+
+SchedulerPhaseStats::SchedulerPhaseStats()
+  : phase_histograms_(NUM_SCHEDULER_PHASES) {
+}
+
+void SchedulerPhaseStats::GetHistograms(
+    vector<LatencyHistogram>* phase_histograms,
+    LatencyHistogram* total_histogram) const {
+  boost::lock_guard<boost::mutex> lock(lock_);
+  *phase_histograms = phase_histograms_;
+  *total_histogram = total_histogram_;
+}
+
+const char* SchedulerPhaseStats::PhaseName(SchedulerPhase phase) {
+  switch (phase) {
+    case PHASE_TOPOLOGY_STATS:
+      return "topology_stats";
+    case PHASE_ADD_OR_UPDATE_JOB_NODES:
+      return "add_or_update_job_nodes";
+    case PHASE_CHANGE_OPTIMIZATION:
+      return "change_optimization";
+    case PHASE_EXPORT:
+      return "export";
+    case PHASE_SOLVE:
+      return "solve";
+    case PHASE_OUTPUT_PARSE:
+      return "output_parse";
+    case PHASE_GET_MAPPINGS:
+      return "get_mappings";
+    case PHASE_DELTA_GENERATION:
+      return "delta_generation";
+    case PHASE_APPLY_DELTAS:
+      return "apply_scheduling_deltas";
+    default:
+      LOG(FATAL) << "Unexpected scheduler phase: " << phase;
+  }
+  return "unknown";
+}
+
+void SchedulerPhaseStats::RecordRound(const SchedulerStats& scheduler_stats) {
+  boost::lock_guard<boost::mutex> lock(lock_);
+  for (uint32_t phase = 0; phase < NUM_SCHEDULER_PHASES; ++phase) {
+    phase_histograms_[phase].Record(scheduler_stats.phase_runtimes_[phase]);
+  }
+  total_histogram_.Record(scheduler_stats.total_runtime_);
+}
+
+}  // namespace scheduler
+}  // namespace firmament
@@ -0,0 +1,62 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Per-phase latency statistics of the scheduling rounds. The scheduler
+// records every round, and the coordinator's web UI reads the histograms
+// concurrently.
+
+#ifndef FIRMAMENT_SCHEDULING_SCHEDULER_PHASE_STATS_H
+#define FIRMAMENT_SCHEDULING_SCHEDULER_PHASE_STATS_H
+
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "base/common.h"
+#include "misc/latency_histogram.h"
+#include "scheduling/scheduler_interface.h"
+
+namespace firmament {
+namespace scheduler {
+
+class SchedulerPhaseStats {
+ public:
+  SchedulerPhaseStats();
+  /**
+   * Copies the histograms.
+   * @param phase_histograms vector that gets populated with the histogram of
+   * every phase, indexed by SchedulerPhase
+   * @param total_histogram histogram of the total round runtimes
+   */
+  void GetHistograms(vector<LatencyHistogram>* phase_histograms,
+                     LatencyHistogram* total_histogram) const;
+  static const char* PhaseName(SchedulerPhase phase);
+  void RecordRound(const SchedulerStats& scheduler_stats);
+
+ private:
+  mutable boost::mutex lock_;
+  vector<LatencyHistogram> phase_histograms_;
+  LatencyHistogram total_histogram_;
+};
+
+}  // namespace scheduler
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SCHEDULING_SCHEDULER_PHASE_STATS_H
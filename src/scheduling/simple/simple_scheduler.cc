@@ -32,6 +32,7 @@
 
 #include "base/units.h"
 #include "misc/map-util.h"
+#include "misc/pb_utils.h"
 #include "misc/utils.h"
 #include "storage/object_store_interface.h"
 
@@ -59,31 +60,46 @@ SimpleScheduler::SimpleScheduler(
     : EventDrivenScheduler(job_map, resource_map, resource_topology,
                            object_store, task_map, knowledge_base, topo_mgr,
                            m_adapter, event_notifier, coordinator_res_id,
-                           coordinator_uri, time_manager, trace_generator) {
+                           coordinator_uri, time_manager, trace_generator),
+      rand_seed_(0) {
   VLOG(1) << "SimpleScheduler initiated.";
 }
 
 SimpleScheduler::~SimpleScheduler() {
 }
 
+void SimpleScheduler::BindTaskToResource(TaskDescriptor* td_ptr,
+                                         ResourceDescriptor* rd_ptr) {
+  EventDrivenScheduler::BindTaskToResource(td_ptr, rd_ptr);
+  UpdateIdlePU(*rd_ptr);
+}
+
+void SimpleScheduler::DeregisterResource(
+    ResourceTopologyNodeDescriptor* rtnd_ptr) {
+  boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
+  BFSTraverseResourceProtobufTreeReturnRTND(
+      rtnd_ptr,
+      boost::bind(&SimpleScheduler::RemoveIdlePUForNode, this, _1));
+  EventDrivenScheduler::DeregisterResource(rtnd_ptr);
+}
+
 bool SimpleScheduler::FindResourceForTask(const TaskDescriptor& task_desc,
                                           ResourceID_t* best_resource) {
   // TODO(malte): This is an extremely simple-minded approach to resource
-  // selection (i.e. the essence of scheduling). We will simply traverse the
-  // resource map in some order, and grab the first resource available.
+  // selection (i.e. the essence of scheduling). We will simply grab any idle
+  // PU.
   VLOG(2) << "Trying to place task " << task_desc.uid() << "...";
-  // Find the first idle resource in the resource map
-  for (ResourceMap_t::iterator res_iter = resource_map_->begin();
-       res_iter != resource_map_->end();
-       ++res_iter) {
-    VLOG(3) << "Considering resource " << res_iter->first
-            << ", which is in state "
-            << res_iter->second->descriptor().state();
-    if (res_iter->second->descriptor().state() ==
+  while (!idle_pus_.empty()) {
+    // Reusing the most recently freed PU is as good as any other choice.
+    ResourceID_t res_id = idle_pus_.back();
+    ResourceStatus* rs_ptr = FindPtrOrNull(*resource_map_, res_id);
+    if (rs_ptr && rs_ptr->descriptor().state() ==
         ResourceDescriptor::RESOURCE_IDLE) {
-      *best_resource = res_iter->first;
+      *best_resource = res_id;
       return true;
     }
+    // The PU has changed state without us noticing; drop it.
+    RemoveIdlePU(res_id);
   }
   // We have not found any idle resources in our local resource map. At this
   // point, we should start looking beyond the machine boundary and towards
@@ -93,26 +109,18 @@ bool SimpleScheduler::FindResourceForTask(const TaskDescriptor& task_desc,
 
 bool SimpleScheduler::FindRandomResourceForTask(const TaskDescriptor& task_desc,
                                                 ResourceID_t* best_resource) {
-  // TODO(malte): This is an extremely simple-minded approach to resource
-  // selection (i.e. the essence of scheduling). We will simply traverse the
-  // resource map in some order, and grab the first resource available.
   VLOG(2) << "Trying to place task " << task_desc.uid() << "...";
-  vector<ResourceStatus*> resources;
-  // Find the first idle resource in the resource map
-  for (ResourceMap_t::iterator res_iter = resource_map_->begin();
-       res_iter != resource_map_->end();
-       ++res_iter) {
-    resources.push_back(res_iter->second);
-  }
-  for (uint64_t max_attempts = 2000; max_attempts > 0; max_attempts--) {
-    uint32_t resource_index =
-      static_cast<uint32_t>(rand_r(&rand_seed_)) % resources.size();
-    if (resources[resource_index]->descriptor().state() ==
+  while (!idle_pus_.empty()) {
+    ResourceID_t res_id = idle_pus_[
+      static_cast<uint64_t>(rand_r(&rand_seed_)) % idle_pus_.size()];
+    ResourceStatus* rs_ptr = FindPtrOrNull(*resource_map_, res_id);
+    if (rs_ptr && rs_ptr->descriptor().state() ==
         ResourceDescriptor::RESOURCE_IDLE) {
-      *best_resource = ResourceIDFromString(
-          resources[resource_index]->descriptor().uuid());
+      *best_resource = res_id;
       return true;
     }
+    // The PU has changed state without us noticing; drop it.
+    RemoveIdlePU(res_id);
   }
   // We have not found any idle resources in our local resource map. At this
   // point, we should start looking beyond the machine boundary and towards
@@ -186,6 +194,37 @@ void SimpleScheduler::PopulateSchedulerTaskUI(TaskID_t task_id,
   // for the simple scheduler.
 }
 
+void SimpleScheduler::RegisterResource(
+    ResourceTopologyNodeDescriptor* rtnd_ptr,
+    bool local,
+    bool simulated) {
+  boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
+  EventDrivenScheduler::RegisterResource(rtnd_ptr, local, simulated);
+  BFSTraverseResourceProtobufTreeReturnRTND(
+      rtnd_ptr,
+      boost::bind(&SimpleScheduler::UpdateIdlePUForNode, this, _1));
+}
+
+void SimpleScheduler::RemoveIdlePU(ResourceID_t res_id) {
+  uint64_t* index_ptr = FindOrNull(idle_pu_indices_, res_id);
+  if (!index_ptr) {
+    return;
+  }
+  // Move the last PU into the removed PU's slot.
+  uint64_t index = *index_ptr;
+  idle_pu_indices_.erase(res_id);
+  if (index != idle_pus_.size() - 1) {
+    idle_pus_[index] = idle_pus_.back();
+    idle_pu_indices_[idle_pus_[index]] = index;
+  }
+  idle_pus_.pop_back();
+}
+
+void SimpleScheduler::RemoveIdlePUForNode(
+    ResourceTopologyNodeDescriptor* rtnd_ptr) {
+  RemoveIdlePU(ResourceIDFromString(rtnd_ptr->resource_desc().uuid()));
+}
+
 uint64_t SimpleScheduler::ScheduleAllJobs(SchedulerStats* scheduler_stats) {
   return ScheduleAllJobs(scheduler_stats, NULL);
 }
@@ -194,25 +233,52 @@ uint64_t SimpleScheduler::ScheduleAllJobs(SchedulerStats* scheduler_stats,
                                           vector<SchedulingDelta>* deltas) {
   boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
   vector<JobDescriptor*> jobs;
-  for (auto& job_id_jd : jobs_to_schedule_) {
-    jobs.push_back(job_id_jd.second);
-  }
+  ComputeJobsWithRunnableTasks(&jobs);
   uint64_t num_scheduled_tasks = ScheduleJobs(jobs, scheduler_stats, deltas);
   return num_scheduled_tasks;
 }
 
 uint64_t SimpleScheduler::ScheduleJob(JobDescriptor* jd_ptr,
                                       SchedulerStats* scheduler_stats) {
-  uint64_t num_scheduled_tasks = 0;
   VLOG(2) << "Preparing to schedule job " << jd_ptr->uuid();
   boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
+  // The job may have changed without the scheduler being told (e.g., tasks
+  // may have been spawned), so we reduce its graph again.
+  ComputeRunnableTasksForJob(jd_ptr);
+  return ScheduleRunnableTasks(jd_ptr, scheduler_stats);
+}
+
+uint64_t SimpleScheduler::ScheduleJobs(const vector<JobDescriptor*>& jds_ptr,
+                                       SchedulerStats* scheduler_stats,
+                                       vector<SchedulingDelta>* deltas) {
+  boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
+  uint64_t num_scheduled_tasks = 0;
+  boost::timer::cpu_timer scheduler_timer;
+  UpdateRunnableTasks();
+  // TODO(ionel): Populate scheduling deltas!
+  for (auto& jd_ptr : jds_ptr) {
+    num_scheduled_tasks += ScheduleRunnableTasks(jd_ptr, scheduler_stats);
+  }
+  if (scheduler_stats != NULL) {
+    scheduler_stats->scheduler_runtime_ =
+      static_cast<uint64_t>(scheduler_timer.elapsed().wall) /
+      NANOSECONDS_IN_MICROSECOND;
+  }
+  return num_scheduled_tasks;
+}
+
+uint64_t SimpleScheduler::ScheduleRunnableTasks(
+    JobDescriptor* jd_ptr,
+    SchedulerStats* scheduler_stats) {
+  uint64_t num_scheduled_tasks = 0;
   LOG(INFO) << "START SCHEDULING " << jd_ptr->uuid();
   boost::timer::cpu_timer scheduler_timer;
-  // Get the set of runnable tasks for this job
-  unordered_set<TaskID_t> runnable_tasks = ComputeRunnableTasksForJob(jd_ptr);
+  JobID_t job_id = JobIDFromString(jd_ptr->uuid());
+  // Copy the set of runnable tasks for this job, as placing the tasks removes
+  // them from it.
+  unordered_set<TaskID_t> runnable_tasks = runnable_tasks_[job_id];
   VLOG(2) << "Scheduling job " << jd_ptr->uuid() << ", which has "
           << runnable_tasks.size() << " runnable tasks.";
-  JobID_t job_id = JobIDFromString(jd_ptr->uuid());
   for (unordered_set<TaskID_t>::const_iterator task_iter =
        runnable_tasks.begin();
        task_iter != runnable_tasks.end();
@@ -238,7 +304,7 @@ uint64_t SimpleScheduler::ScheduleJob(JobDescriptor* jd_ptr,
       VLOG(1) << "Scheduling task " << td->uid() << " on resource "
               << rp->descriptor().uuid();
       // Remove the task from the runnable set.
-      runnable_tasks_[job_id].erase(td->uid());
+      RemoveTaskFromRunnables(job_id, td->uid());
       HandleTaskPlacement(td, rp->mutable_descriptor());
       num_scheduled_tasks++;
     }
@@ -253,22 +319,32 @@ uint64_t SimpleScheduler::ScheduleJob(JobDescriptor* jd_ptr,
   return num_scheduled_tasks;
 }
 
-uint64_t SimpleScheduler::ScheduleJobs(const vector<JobDescriptor*>& jds_ptr,
-                                       SchedulerStats* scheduler_stats,
-                                       vector<SchedulingDelta>* deltas) {
-  boost::lock_guard<boost::recursive_mutex> lock(scheduling_lock_);
-  uint64_t num_scheduled_tasks = 0;
-  boost::timer::cpu_timer scheduler_timer;
-  // TODO(ionel): Populate scheduling deltas!
-  for (auto& jd_ptr : jds_ptr) {
-    num_scheduled_tasks += ScheduleJob(jd_ptr, scheduler_stats);
+bool SimpleScheduler::UnbindTaskFromResource(TaskDescriptor* td_ptr,
+                                             ResourceID_t res_id) {
+  bool unbound = EventDrivenScheduler::UnbindTaskFromResource(td_ptr, res_id);
+  ResourceStatus* rs_ptr = FindPtrOrNull(*resource_map_, res_id);
+  if (rs_ptr) {
+    UpdateIdlePU(rs_ptr->descriptor());
   }
-  if (scheduler_stats != NULL) {
-    scheduler_stats->scheduler_runtime_ =
-      static_cast<uint64_t>(scheduler_timer.elapsed().wall) /
-      NANOSECONDS_IN_MICROSECOND;
+  return unbound;
+}
+
+void SimpleScheduler::UpdateIdlePU(const ResourceDescriptor& rd) {
+  if (rd.type() != ResourceDescriptor::RESOURCE_PU) {
+    return;
   }
-  return num_scheduled_tasks;
+  ResourceID_t res_id = ResourceIDFromString(rd.uuid());
+  if (rd.state() != ResourceDescriptor::RESOURCE_IDLE) {
+    RemoveIdlePU(res_id);
+  } else if (InsertIfNotPresent(&idle_pu_indices_, res_id,
+                                idle_pus_.size())) {
+    idle_pus_.push_back(res_id);
+  }
+}
+
+void SimpleScheduler::UpdateIdlePUForNode(
+    ResourceTopologyNodeDescriptor* rtnd_ptr) {
+  UpdateIdlePU(rtnd_ptr->resource_desc());
 }
 
 }  // namespace scheduler
@@ -57,6 +57,7 @@ class SimpleScheduler : public EventDrivenScheduler {
                   TimeInterface* time_manager,
                   TraceGenerator* trace_generator);
   ~SimpleScheduler();
+  void DeregisterResource(ResourceTopologyNodeDescriptor* rtnd_ptr);
   void HandleTaskCompletion(TaskDescriptor* td_ptr,
                             TaskFinalReport* report);
   void HandleTaskEviction(TaskDescriptor* td_ptr, ResourceDescriptor* rd_ptr);
@@ -69,6 +70,9 @@ class SimpleScheduler : public EventDrivenScheduler {
                                    TemplateDictionary* dict) const;
   void PopulateSchedulerTaskUI(TaskID_t task_id,
                                TemplateDictionary* dict) const;
+  void RegisterResource(ResourceTopologyNodeDescriptor* rtnd_ptr,
+                        bool local,
+                        bool simulated);
   uint64_t ScheduleAllJobs(SchedulerStats* scheduler_stats);
   uint64_t ScheduleAllJobs(SchedulerStats* scheduler_stats,
                            vector<SchedulingDelta>* deltas);
@@ -82,18 +86,46 @@ class SimpleScheduler : public EventDrivenScheduler {
     return *stream << "<SimpleScheduler>";
   }
 
+ protected:
+  void BindTaskToResource(TaskDescriptor* td_ptr, ResourceDescriptor* rd_ptr);
+  bool UnbindTaskFromResource(TaskDescriptor* td_ptr, ResourceID_t res_id);
+
  private:
   // Unit tests
   FRIEND_TEST(SimpleSchedulerTest, LazyGraphReductionTest);
   FRIEND_TEST(SimpleSchedulerTest, ObjectIDToReferenceDescLookup);
   FRIEND_TEST(SimpleSchedulerTest, ProducingTaskLookup);
+  FRIEND_TEST(SimpleSchedulerTest, IdlePUIndex);
 
+  /**
+   * Adds a PU to the idle PUs if it is idle, and removes it otherwise.
+   * @param rd the descriptor of the resource; other resources than PUs are
+   * ignored
+   */
+  void UpdateIdlePU(const ResourceDescriptor& rd);
+  void UpdateIdlePUForNode(ResourceTopologyNodeDescriptor* rtnd_ptr);
+  void RemoveIdlePU(ResourceID_t res_id);
+  void RemoveIdlePUForNode(ResourceTopologyNodeDescriptor* rtnd_ptr);
   bool FindResourceForTask(const TaskDescriptor& task_desc,
                            ResourceID_t* best_resource);
   bool FindRandomResourceForTask(const TaskDescriptor& task_desc,
                                  ResourceID_t* best_resource);
+  /**
+   * Places the runnable tasks of a job, without reducing its graph again.
+   * @param jd_ptr the job whose tasks to place
+   * @param scheduler_stats the stats to update
+   * @return the number of tasks placed
+   */
+  uint64_t ScheduleRunnableTasks(JobDescriptor* jd_ptr,
+                                 SchedulerStats* scheduler_stats);
 
   uint32_t rand_seed_;
+  // The PUs that are idle, in no particular order, and the index of every
+  // PU in the vector. They let us find an idle PU for a task, and mark a PU
+  // busy or idle, in constant time rather than by scanning the resource map.
+  vector<ResourceID_t> idle_pus_;
+  unordered_map<ResourceID_t, uint64_t, boost::hash<ResourceID_t>>
+    idle_pu_indices_;
 };
 
 }  // namespace scheduler
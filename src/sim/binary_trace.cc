@@ -0,0 +1,485 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "sim/binary_trace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+#include <utility>
+
+#include "misc/trace_generator.h"
+#include "misc/trace_writer.h"
+#include "sim/trace_utils.h"
+
+namespace firmament {
+namespace sim {
+
+// Value size of each column.
+static const uint32_t kColumnValueSizes[NUM_BINARY_TRACE_COLUMNS] = {
+  sizeof(uint64_t), sizeof(uint64_t),
+  sizeof(uint64_t), sizeof(uint64_t), sizeof(int32_t),
+  sizeof(uint64_t), sizeof(uint64_t), sizeof(uint64_t), sizeof(uint32_t),
+  sizeof(uint32_t), sizeof(uint32_t), sizeof(float), sizeof(double),
+  sizeof(uint64_t),
+  sizeof(TaskID_t), sizeof(uint64_t),
+  sizeof(TaskID_t), sizeof(double), sizeof(double), sizeof(double),
+  sizeof(double), sizeof(double), sizeof(double), sizeof(double),
+  sizeof(double), sizeof(double),
+};
+
+// The first column of the table each column belongs to. All the columns of a
+// table have the same number of values.
+static const BinaryTraceColumn kColumnTables[NUM_BINARY_TRACE_COLUMNS] = {
+  JOB_ID_COLUMN, JOB_ID_COLUMN,
+  MACHINE_EVENT_TIMESTAMP_COLUMN, MACHINE_EVENT_TIMESTAMP_COLUMN,
+  MACHINE_EVENT_TIMESTAMP_COLUMN,
+  TASK_EVENT_TIMESTAMP_COLUMN, TASK_EVENT_TIMESTAMP_COLUMN,
+  TASK_EVENT_TIMESTAMP_COLUMN, TASK_EVENT_TIMESTAMP_COLUMN,
+  TASK_EVENT_TIMESTAMP_COLUMN, TASK_EVENT_TIMESTAMP_COLUMN,
+  TASK_EVENT_TIMESTAMP_COLUMN, TASK_EVENT_TIMESTAMP_COLUMN,
+  TASK_EVENTS_INDEX_COLUMN,
+  TASK_RUNTIME_TASK_ID_COLUMN, TASK_RUNTIME_TASK_ID_COLUMN,
+  TASK_USAGE_TASK_ID_COLUMN, TASK_USAGE_TASK_ID_COLUMN,
+  TASK_USAGE_TASK_ID_COLUMN, TASK_USAGE_TASK_ID_COLUMN,
+  TASK_USAGE_TASK_ID_COLUMN, TASK_USAGE_TASK_ID_COLUMN,
+  TASK_USAGE_TASK_ID_COLUMN, TASK_USAGE_TASK_ID_COLUMN,
+  TASK_USAGE_TASK_ID_COLUMN, TASK_USAGE_TASK_ID_COLUMN,
+};
+
+// Columns start at multiples of this alignment, so that their values can be
+// read in place.
+static const uint64_t kColumnAlignment = 8;
+
+// Sorts rows by task id and removes all but the first row of every task.
+template<typename T>
+static void SortAndDeduplicateByTaskID(vector<pair<TaskID_t, T>>* rows,
+                                       const char* table_name) {
+  stable_sort(rows->begin(), rows->end(),
+              [](const pair<TaskID_t, T>& lhs, const pair<TaskID_t, T>& rhs) {
+                return lhs.first < rhs.first;
+              });
+  auto last = unique(rows->begin(), rows->end(),
+                     [](const pair<TaskID_t, T>& lhs,
+                        const pair<TaskID_t, T>& rhs) {
+                       return lhs.first == rhs.first;
+                     });
+  if (last != rows->end()) {
+    LOG(WARNING) << "Dropped " << rows->end() - last << " duplicate "
+                 << table_name << " rows";
+    rows->erase(last, rows->end());
+  }
+}
+
+// Copies the contents of a temporary column file to the end of a file.
+static bool CopyColumnFile(FILE* column_file, FILE* file) {
+  char buffer[1 << 16];
+  if (fseek(column_file, 0, SEEK_SET) != 0) {
+    return false;
+  }
+  size_t num_read;
+  while ((num_read = fread(buffer, 1, sizeof(buffer), column_file)) > 0) {
+    if (fwrite(buffer, 1, num_read, file) != num_read) {
+      return false;
+    }
+  }
+  return !ferror(column_file);
+}
+
+// Converts the files of a trace that was generated with
+// --generated_trace_format=binary, i.e., the files that the TraceGenerator
+// writes.
+static bool ConvertGeneratedTrace(const string& trace_path,
+                                  BinaryTraceWriter* writer) {
+  vector<uint64_t> fields;
+  if (!ReadBinaryTraceFile(trace_path + "/jobs_num_tasks/jobs_num_tasks.bin",
+                           kJobNumTasksFields, &fields)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < fields.size(); i += kJobNumTasksFields) {
+    JobNumTasksRecord record;
+    record.job_id = fields[i];
+    record.num_tasks = fields[i + 1];
+    writer->AppendJobNumTasks(record);
+  }
+  if (!ReadBinaryTraceFile(
+          trace_path + "/machine_events/part-00000-of-00001.bin",
+          kMachineEventFields, &fields)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < fields.size(); i += kMachineEventFields) {
+    MachineEventRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp = fields[i];
+    record.machine_id = fields[i + 1];
+    record.event_type = static_cast<int32_t>(fields[i + 2]);
+    writer->AppendMachineEvent(record);
+  }
+  if (!ReadBinaryTraceFile(trace_path + "/task_events/part-00000-of-00500.bin",
+                           kTaskEventFields, &fields)) {
+    return false;
+  }
+  // Like binary_trace_converter, only keep the submit events and the first
+  // event of every task. The generated trace has no scheduling classes,
+  // priorities or requests.
+  unordered_set<pair<uint64_t, uint64_t>,
+                boost::hash<pair<uint64_t, uint64_t>>> seen_tasks;
+  vector<TaskEventRecord> task_events;
+  for (uint64_t i = 0; i < fields.size(); i += kTaskEventFields) {
+    TaskEventRecord record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp = fields[i];
+    record.job_id = fields[i + 1];
+    record.task_index = fields[i + 2];
+    record.event_type = static_cast<uint32_t>(fields[i + 4]);
+    bool first_task_event =
+      seen_tasks.insert(pair<uint64_t, uint64_t>(record.job_id,
+                                                 record.task_index)).second;
+    if (record.event_type == TASK_SUBMIT_EVENT || first_task_event) {
+      task_events.push_back(record);
+    }
+  }
+  // The events are written as they are simulated, which need not be in the
+  // order of their timestamps.
+  stable_sort(task_events.begin(), task_events.end(),
+              [](const TaskEventRecord& lhs, const TaskEventRecord& rhs) {
+                return lhs.timestamp < rhs.timestamp;
+              });
+  for (auto& record : task_events) {
+    writer->AppendTaskEvent(record);
+  }
+  if (!ReadBinaryTraceFile(
+          trace_path + "/task_runtime_events/task_runtime_events.bin",
+          kTaskRuntimeFields, &fields)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < fields.size(); i += kTaskRuntimeFields) {
+    // The fields are: job id, task index, start time, total runtime, runtime
+    // of the last run and number of runs.
+    TaskRuntimeRecord record;
+    record.job_id = fields[i];
+    record.task_index = fields[i + 1];
+    record.runtime = fields[i + 3];
+    writer->AppendTaskRuntime(record);
+  }
+  if (!ReadBinaryTraceFile(trace_path + "/task_usage_stat/task_usage_stat.bin",
+                           kTaskUsageStatFields, &fields)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < fields.size(); i += kTaskUsageStatFields) {
+    // The generated trace does not contain the usage statistics.
+    TaskUsageStatsRecord record;
+    memset(&record, 0, sizeof(record));
+    record.job_id = fields[i];
+    record.task_index = fields[i + 1];
+    writer->AppendTaskUsageStats(record);
+  }
+  return true;
+}
+
+BinaryTraceWriter::BinaryTraceWriter()
+  : file_(NULL), last_task_event_timestamp_(0) {
+  memset(column_files_, 0, sizeof(column_files_));
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+  if (file_) {
+    Close();
+  }
+}
+
+void BinaryTraceWriter::AppendJobNumTasks(const JobNumTasksRecord& record) {
+  Append(JOB_ID_COLUMN, record.job_id);
+  Append(JOB_NUM_TASKS_COLUMN, record.num_tasks);
+}
+
+void BinaryTraceWriter::AppendMachineEvent(const MachineEventRecord& record) {
+  Append(MACHINE_EVENT_TIMESTAMP_COLUMN, record.timestamp);
+  Append(MACHINE_EVENT_MACHINE_ID_COLUMN, record.machine_id);
+  Append(MACHINE_EVENT_TYPE_COLUMN, record.event_type);
+}
+
+void BinaryTraceWriter::AppendTaskEvent(const TaskEventRecord& record) {
+  CHECK_GE(record.timestamp, last_task_event_timestamp_)
+    << "Task events must be appended in the order of their timestamps";
+  last_task_event_timestamp_ = record.timestamp;
+  if (header_.columns[TASK_EVENT_TIMESTAMP_COLUMN].num_values %
+      kTaskEventsIndexInterval == 0) {
+    Append(TASK_EVENTS_INDEX_COLUMN, record.timestamp);
+  }
+  Append(TASK_EVENT_TIMESTAMP_COLUMN, record.timestamp);
+  Append(TASK_EVENT_JOB_ID_COLUMN, record.job_id);
+  Append(TASK_EVENT_TASK_INDEX_COLUMN, record.task_index);
+  Append(TASK_EVENT_TYPE_COLUMN, record.event_type);
+  Append(TASK_EVENT_SCHEDULING_CLASS_COLUMN, record.scheduling_class);
+  Append(TASK_EVENT_PRIORITY_COLUMN, record.priority);
+  Append(TASK_EVENT_CPU_REQUEST_COLUMN, record.cpu_request);
+  Append(TASK_EVENT_RAM_REQUEST_COLUMN, record.ram_request);
+}
+
+void BinaryTraceWriter::AppendTaskRuntime(const TaskRuntimeRecord& record) {
+  TraceTaskIdentifier ti;
+  ti.job_id = record.job_id;
+  ti.task_index = record.task_index;
+  task_runtimes_.push_back(
+      pair<TaskID_t, TaskRuntimeRecord>(GenerateTaskIDFromTraceIdentifier(ti),
+                                        record));
+}
+
+void BinaryTraceWriter::AppendTaskUsageStats(
+    const TaskUsageStatsRecord& record) {
+  TraceTaskIdentifier ti;
+  ti.job_id = record.job_id;
+  ti.task_index = record.task_index;
+  task_usage_stats_.push_back(
+      pair<TaskID_t, TaskUsageStatsRecord>(
+          GenerateTaskIDFromTraceIdentifier(ti), record));
+}
+
+bool BinaryTraceWriter::Close() {
+  CHECK_NOTNULL(file_);
+  WriteTaskRuntimes();
+  WriteTaskUsageStats();
+  // The header is followed by the columns, in the order of their ids.
+  uint64_t offset = sizeof(header_);
+  bool written = fseek(file_, offset, SEEK_SET) == 0;
+  for (uint32_t column = 0; column < NUM_BINARY_TRACE_COLUMNS && written;
+       ++column) {
+    uint64_t padding = (kColumnAlignment - offset % kColumnAlignment) %
+      kColumnAlignment;
+    static const char kPadding[kColumnAlignment] = {0};
+    written = fwrite(kPadding, 1, padding, file_) == padding &&
+      CopyColumnFile(column_files_[column], file_);
+    BinaryTraceSection* section = &header_.columns[column];
+    section->offset = offset + padding;
+    offset = section->offset + section->num_values * section->value_size;
+  }
+  written = written && fseek(file_, 0, SEEK_SET) == 0 &&
+    fwrite(&header_, sizeof(header_), 1, file_) == 1;
+  written = fclose(file_) == 0 && written;
+  file_ = NULL;
+  for (uint32_t column = 0; column < NUM_BINARY_TRACE_COLUMNS; ++column) {
+    fclose(column_files_[column]);
+    column_files_[column] = NULL;
+  }
+  if (!written) {
+    PLOG(ERROR) << "Could not write " << file_name_;
+  }
+  return written;
+}
+
+bool BinaryTraceWriter::Open(const string& file_name) {
+  CHECK(file_ == NULL);
+  file_name_ = file_name;
+  if ((file_ = fopen(file_name.c_str(), "wb")) == NULL) {
+    PLOG(ERROR) << "Could not open " << file_name << " for writing";
+    return false;
+  }
+  for (uint32_t column = 0; column < NUM_BINARY_TRACE_COLUMNS; ++column) {
+    if ((column_files_[column] = tmpfile()) == NULL) {
+      PLOG(ERROR) << "Could not create the column files of " << file_name;
+      for (uint32_t created = 0; created < column; ++created) {
+        fclose(column_files_[created]);
+        column_files_[created] = NULL;
+      }
+      fclose(file_);
+      file_ = NULL;
+      return false;
+    }
+  }
+  memset(&header_, 0, sizeof(header_));
+  memcpy(header_.magic, kBinaryTraceMagic, sizeof(header_.magic));
+  header_.version = kBinaryTraceVersion;
+  header_.num_columns = NUM_BINARY_TRACE_COLUMNS;
+  for (uint32_t column = 0; column < NUM_BINARY_TRACE_COLUMNS; ++column) {
+    header_.columns[column].value_size = kColumnValueSizes[column];
+  }
+  last_task_event_timestamp_ = 0;
+  task_runtimes_.clear();
+  task_usage_stats_.clear();
+  return true;
+}
+
+void BinaryTraceWriter::WriteTaskRuntimes() {
+  SortAndDeduplicateByTaskID(&task_runtimes_, "task runtime");
+  for (auto& task_runtime : task_runtimes_) {
+    Append(TASK_RUNTIME_TASK_ID_COLUMN, task_runtime.first);
+    Append(TASK_RUNTIME_COLUMN, task_runtime.second.runtime);
+  }
+  vector<pair<TaskID_t, TaskRuntimeRecord>>().swap(task_runtimes_);
+}
+
+void BinaryTraceWriter::WriteTaskUsageStats() {
+  SortAndDeduplicateByTaskID(&task_usage_stats_, "task usage");
+  for (auto& task_usage : task_usage_stats_) {
+    const TaskUsageStatsRecord& record = task_usage.second;
+    Append(TASK_USAGE_TASK_ID_COLUMN, task_usage.first);
+    Append(TASK_USAGE_MEAN_CPU_USAGE_COLUMN, record.avg_mean_cpu_usage);
+    Append(TASK_USAGE_CANONICAL_MEM_USAGE_COLUMN,
+           record.avg_canonical_mem_usage);
+    Append(TASK_USAGE_ASSIGNED_MEM_USAGE_COLUMN,
+           record.avg_assigned_mem_usage);
+    Append(TASK_USAGE_UNMAPPED_PAGE_CACHE_COLUMN,
+           record.avg_unmapped_page_cache);
+    Append(TASK_USAGE_TOTAL_PAGE_CACHE_COLUMN, record.avg_total_page_cache);
+    Append(TASK_USAGE_MEAN_DISK_IO_TIME_COLUMN, record.avg_mean_disk_io_time);
+    Append(TASK_USAGE_MEAN_LOCAL_DISK_USED_COLUMN,
+           record.avg_mean_local_disk_used);
+    Append(TASK_USAGE_CPI_COLUMN, record.avg_cpi);
+    Append(TASK_USAGE_MAI_COLUMN, record.avg_mai);
+  }
+  vector<pair<TaskID_t, TaskUsageStatsRecord>>().swap(task_usage_stats_);
+}
+
+BinaryTraceFile::BinaryTraceFile()
+  : data_(NULL), size_(0), header_(NULL) {
+}
+
+BinaryTraceFile::~BinaryTraceFile() {
+  Close();
+}
+
+void BinaryTraceFile::Close() {
+  if (data_ != NULL) {
+    CHECK_EQ(munmap(const_cast<char*>(data_), size_), 0);
+  }
+  data_ = NULL;
+  size_ = 0;
+  header_ = NULL;
+}
+
+uint64_t BinaryTraceFile::FindFirstTaskEvent(uint64_t timestamp) const {
+  uint64_t num_task_events;
+  const uint64_t* timestamps =
+    Column<uint64_t>(TASK_EVENT_TIMESTAMP_COLUMN, &num_task_events);
+  uint64_t num_entries;
+  const uint64_t* index =
+    Column<uint64_t>(TASK_EVENTS_INDEX_COLUMN, &num_entries);
+  // Use the index to narrow the search down to the events between two
+  // consecutive entries, so that only the pages holding them are touched.
+  uint64_t entry = lower_bound(index, index + num_entries, timestamp) - index;
+  uint64_t begin = entry == 0 ? 0 : (entry - 1) * kTaskEventsIndexInterval;
+  uint64_t end = entry == num_entries ? num_task_events :
+    entry * kTaskEventsIndexInterval;
+  return lower_bound(timestamps + begin, timestamps + end, timestamp) -
+    timestamps;
+}
+
+bool BinaryTraceFile::FindTaskRow(BinaryTraceColumn task_id_column,
+                                  TaskID_t task_id, uint64_t* row) const {
+  CHECK(task_id_column == TASK_RUNTIME_TASK_ID_COLUMN ||
+        task_id_column == TASK_USAGE_TASK_ID_COLUMN);
+  uint64_t num_tasks;
+  const TaskID_t* task_ids = Column<TaskID_t>(task_id_column, &num_tasks);
+  const TaskID_t* task_id_ptr =
+    lower_bound(task_ids, task_ids + num_tasks, task_id);
+  if (task_id_ptr == task_ids + num_tasks || *task_id_ptr != task_id) {
+    return false;
+  }
+  *row = task_id_ptr - task_ids;
+  return true;
+}
+
+bool BinaryTraceFile::Open(const string& file_name) {
+  Close();
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    PLOG(ERROR) << "Could not open " << file_name;
+    return false;
+  }
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0);
+  uint64_t size = static_cast<uint64_t>(st.st_size);
+  if (size < sizeof(BinaryTraceHeader)) {
+    LOG(ERROR) << file_name << " is too small to be a binary trace";
+    CHECK_EQ(close(fd), 0);
+    return false;
+  }
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  CHECK_EQ(close(fd), 0);
+  if (data == MAP_FAILED) {
+    PLOG(ERROR) << "Could not map " << file_name;
+    return false;
+  }
+  data_ = reinterpret_cast<const char*>(data);
+  size_ = size;
+  header_ = reinterpret_cast<const BinaryTraceHeader*>(data_);
+  if (memcmp(header_->magic, kBinaryTraceMagic, sizeof(header_->magic)) ||
+      header_->version != kBinaryTraceVersion ||
+      header_->num_columns != NUM_BINARY_TRACE_COLUMNS) {
+    LOG(ERROR) << file_name << " is not a version " << kBinaryTraceVersion
+               << " binary trace";
+    Close();
+    return false;
+  }
+  for (uint32_t column = 0; column < NUM_BINARY_TRACE_COLUMNS; ++column) {
+    const BinaryTraceSection& section = header_->columns[column];
+    if (section.value_size != kColumnValueSizes[column] ||
+        section.offset > size_ || section.offset % section.value_size != 0 ||
+        section.num_values > (size_ - section.offset) / section.value_size ||
+        section.num_values !=
+        header_->columns[kColumnTables[column]].num_values) {
+      LOG(ERROR) << "Column " << column << " of " << file_name
+                 << " is malformed";
+      Close();
+      return false;
+    }
+  }
+  uint64_t num_task_events =
+    header_->columns[TASK_EVENT_TIMESTAMP_COLUMN].num_values;
+  if (header_->columns[TASK_EVENTS_INDEX_COLUMN].num_values !=
+      (num_task_events + kTaskEventsIndexInterval - 1) /
+      kTaskEventsIndexInterval) {
+    LOG(ERROR) << "The task events index of " << file_name
+               << " is malformed";
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool BinaryTraceFile::OpenGeneratedTrace(const string& trace_path) {
+  Close();
+  char file_name[] = "/tmp/firmament_binary_trace_XXXXXX";
+  int fd = mkstemp(file_name);
+  if (fd < 0) {
+    PLOG(ERROR) << "Could not create a temporary binary trace";
+    return false;
+  }
+  CHECK_EQ(close(fd), 0);
+  BinaryTraceWriter writer;
+  bool converted = writer.Open(file_name);
+  if (converted) {
+    converted = ConvertGeneratedTrace(trace_path, &writer);
+    converted = writer.Close() && converted && Open(file_name);
+  }
+  // The mapping remains valid once the file is removed.
+  unlink(file_name);
+  return converted;
+}
+
+}  // namespace sim
+}  // namespace firmament
@@ -0,0 +1,280 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Preprocessed binary form of a Google-style trace. A file consists of a
+// header followed by one section per column of the trace's tables. Every
+// section is an array of fixed-width values, so the simulator can map the
+// file and use the values in place instead of parsing CSV files, and a scan
+// over some of the fields of a table only touches the pages of their columns.
+//
+// The task events are sorted by timestamp and have an index with the
+// timestamp of every kTaskEventsIndexInterval-th event. The task runtimes and
+// usage statistics are sorted by task id, so that a task's values can be
+// found by a binary search instead of being loaded into a hash map.
+//
+// Timestamps and resource requests are stored as they appear in the trace;
+// flags such as --trace_speed_up and --events_fraction are applied when the
+// trace is loaded.
+//
+// A trace that was generated with --generated_trace_format=binary can be
+// replayed as well: its files are converted into a temporary binary trace.
+
+#ifndef FIRMAMENT_SIM_BINARY_TRACE_H
+#define FIRMAMENT_SIM_BINARY_TRACE_H
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/common.h"
+
+namespace firmament {
+namespace sim {
+
+// Must be incremented whenever the layout of the file changes.
+static const uint32_t kBinaryTraceVersion = 3;
+static const char kBinaryTraceMagic[8] = {'F', 'I', 'R', 'M', 'T', 'R',
+                                          'C', '\0'};
+// Number of task events between consecutive task events index entries.
+static const uint64_t kTaskEventsIndexInterval = 4096;
+
+enum BinaryTraceColumn {
+  // jobs_num_tasks.
+  JOB_ID_COLUMN = 0,
+  JOB_NUM_TASKS_COLUMN = 1,
+  // machine_events.
+  MACHINE_EVENT_TIMESTAMP_COLUMN = 2,
+  MACHINE_EVENT_MACHINE_ID_COLUMN = 3,
+  MACHINE_EVENT_TYPE_COLUMN = 4,
+  // task_events, sorted by timestamp.
+  TASK_EVENT_TIMESTAMP_COLUMN = 5,
+  TASK_EVENT_JOB_ID_COLUMN = 6,
+  TASK_EVENT_TASK_INDEX_COLUMN = 7,
+  TASK_EVENT_TYPE_COLUMN = 8,
+  TASK_EVENT_SCHEDULING_CLASS_COLUMN = 9,
+  TASK_EVENT_PRIORITY_COLUMN = 10,
+  TASK_EVENT_CPU_REQUEST_COLUMN = 11,
+  TASK_EVENT_RAM_REQUEST_COLUMN = 12,
+  // Timestamp of the task events whose index is a multiple of
+  // kTaskEventsIndexInterval.
+  TASK_EVENTS_INDEX_COLUMN = 13,
+  // task_runtime_events, sorted by task id.
+  TASK_RUNTIME_TASK_ID_COLUMN = 14,
+  TASK_RUNTIME_COLUMN = 15,
+  // task_usage_stat, sorted by task id.
+  TASK_USAGE_TASK_ID_COLUMN = 16,
+  TASK_USAGE_MEAN_CPU_USAGE_COLUMN = 17,
+  TASK_USAGE_CANONICAL_MEM_USAGE_COLUMN = 18,
+  TASK_USAGE_ASSIGNED_MEM_USAGE_COLUMN = 19,
+  TASK_USAGE_UNMAPPED_PAGE_CACHE_COLUMN = 20,
+  TASK_USAGE_TOTAL_PAGE_CACHE_COLUMN = 21,
+  TASK_USAGE_MEAN_DISK_IO_TIME_COLUMN = 22,
+  TASK_USAGE_MEAN_LOCAL_DISK_USED_COLUMN = 23,
+  TASK_USAGE_CPI_COLUMN = 24,
+  TASK_USAGE_MAI_COLUMN = 25,
+  NUM_BINARY_TRACE_COLUMNS = 26,
+};
+
+struct BinaryTraceSection {
+  uint64_t offset;
+  uint64_t num_values;
+  uint32_t value_size;
+  uint32_t reserved;
+};
+
+struct BinaryTraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_columns;
+  BinaryTraceSection columns[NUM_BINARY_TRACE_COLUMNS];
+};
+
+// The rows of the trace's tables, as they are passed to the writer. The file
+// stores every field in its own column.
+
+struct JobNumTasksRecord {
+  uint64_t job_id;
+  uint64_t num_tasks;
+};
+
+struct MachineEventRecord {
+  uint64_t timestamp;
+  uint64_t machine_id;
+  int32_t event_type;
+  uint32_t reserved;
+};
+
+// The simulator only replays task submissions. Other task events are only
+// kept if they are the first event of their task, because that is when the
+// loader accounts for tasks that are filtered out by --events_fraction.
+struct TaskEventRecord {
+  uint64_t timestamp;
+  uint64_t job_id;
+  uint64_t task_index;
+  uint32_t event_type;
+  uint32_t scheduling_class;
+  uint32_t priority;
+  // Requests normalized to the largest machine, or zero if the trace does not
+  // specify them.
+  float cpu_request;
+  double ram_request;
+};
+
+struct TaskRuntimeRecord {
+  uint64_t job_id;
+  uint64_t task_index;
+  uint64_t runtime;
+};
+
+struct TaskUsageStatsRecord {
+  uint64_t job_id;
+  uint64_t task_index;
+  double avg_mean_cpu_usage;
+  double avg_canonical_mem_usage;
+  double avg_assigned_mem_usage;
+  double avg_unmapped_page_cache;
+  double avg_total_page_cache;
+  double avg_mean_disk_io_time;
+  double avg_mean_local_disk_used;
+  double avg_cpi;
+  double avg_mai;
+};
+
+/**
+ * Writes a binary trace. The values of every column are buffered in a
+ * temporary file until the trace is closed, as the columns of a table are
+ * appended to row by row.
+ */
+class BinaryTraceWriter {
+ public:
+  BinaryTraceWriter();
+  ~BinaryTraceWriter();
+  /**
+   * Finishes the file by writing its header and its columns.
+   * @return false if the file could not be written
+   */
+  bool Close();
+  bool Open(const string& file_name);
+  void AppendJobNumTasks(const JobNumTasksRecord& record);
+  void AppendMachineEvent(const MachineEventRecord& record);
+  /**
+   * Appends a task event. The task events must be appended in the order of
+   * their timestamps.
+   */
+  void AppendTaskEvent(const TaskEventRecord& record);
+  /**
+   * Appends the runtime of a task. The runtimes are sorted by task id when
+   * the file is closed; only the first runtime of a task is kept.
+   */
+  void AppendTaskRuntime(const TaskRuntimeRecord& record);
+  /**
+   * Appends the usage statistics of a task. The statistics are sorted by task
+   * id when the file is closed; only the first statistics of a task are kept.
+   */
+  void AppendTaskUsageStats(const TaskUsageStatsRecord& record);
+
+ private:
+  template<typename T>
+  void Append(BinaryTraceColumn column, const T& value) {
+    CHECK_EQ(sizeof(T), header_.columns[column].value_size);
+    if (fwrite(&value, sizeof(T), 1, column_files_[column]) != 1) {
+      PLOG(FATAL) << "Could not buffer column " << column << " of "
+                  << file_name_;
+    }
+    header_.columns[column].num_values++;
+  }
+  void WriteTaskRuntimes();
+  void WriteTaskUsageStats();
+
+  string file_name_;
+  FILE* file_;
+  // Temporary files holding the values of every column.
+  FILE* column_files_[NUM_BINARY_TRACE_COLUMNS];
+  BinaryTraceHeader header_;
+  uint64_t last_task_event_timestamp_;
+  // The rows that are sorted by task id once all of them are known.
+  vector<pair<TaskID_t, TaskRuntimeRecord>> task_runtimes_;
+  vector<pair<TaskID_t, TaskUsageStatsRecord>> task_usage_stats_;
+};
+
+/**
+ * Read-only view of a memory-mapped binary trace.
+ */
+class BinaryTraceFile {
+ public:
+  BinaryTraceFile();
+  ~BinaryTraceFile();
+  /**
+   * Maps a binary trace into memory and checks its header.
+   * @param file_name the path of the trace
+   * @return false if the file could not be mapped or is not a binary trace
+   * of the current version
+   */
+  bool Open(const string& file_name);
+  /**
+   * Reads a trace that was generated with --generated_trace_format=binary,
+   * converts it into a temporary binary trace and maps that trace.
+   * @param trace_path the directory of the generated trace
+   * @return false if any of the generated trace's files could not be read
+   */
+  bool OpenGeneratedTrace(const string& trace_path);
+  /**
+   * Returns the values of a column.
+   * @param column the column
+   * @param num_values set to the number of values in the column
+   * @return pointer to the first value
+   */
+  template<typename T>
+  const T* Column(BinaryTraceColumn column, uint64_t* num_values) const {
+    const BinaryTraceSection& section = header_->columns[column];
+    CHECK_EQ(sizeof(T), section.value_size);
+    *num_values = section.num_values;
+    return reinterpret_cast<const T*>(data_ + section.offset);
+  }
+  /**
+   * Returns the index of the first task event whose timestamp is greater
+   * than or equal to the given timestamp, or the number of task events if
+   * there is no such event.
+   */
+  uint64_t FindFirstTaskEvent(uint64_t timestamp) const;
+  /**
+   * Finds the row of a task in a table that is sorted by task id.
+   * @param task_id_column TASK_RUNTIME_TASK_ID_COLUMN or
+   * TASK_USAGE_TASK_ID_COLUMN
+   * @param task_id the id of the task
+   * @param row set to the row of the task
+   * @return false if the table has no row for the task
+   */
+  bool FindTaskRow(BinaryTraceColumn task_id_column, TaskID_t task_id,
+                   uint64_t* row) const;
+
+ private:
+  void Close();
+
+  const char* data_;
+  uint64_t size_;
+  const BinaryTraceHeader* header_;
+};
+
+}  // namespace sim
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SIM_BINARY_TRACE_H
@@ -0,0 +1,228 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "sim/binary_trace_converter.h"
+
+#include <boost/functional/hash.hpp>
+#include <cstring>
+#include <unordered_set>
+#include <utility>
+
+#include "misc/string_utils.h"
+
+#define TASK_SUBMIT 0
+
+namespace firmament {
+namespace sim {
+
+BinaryTraceConverter::BinaryTraceConverter(const string& trace_path)
+  : trace_path_(trace_path) {
+}
+
+bool BinaryTraceConverter::Convert(const string& binary_trace_file,
+                                   int32_t num_task_events_files) {
+  BinaryTraceWriter writer;
+  if (!writer.Open(binary_trace_file)) {
+    return false;
+  }
+  ConvertJobsNumTasks(&writer);
+  ConvertMachineEvents(&writer);
+  ConvertTaskEvents(&writer, num_task_events_files);
+  ConvertTaskRuntimes(&writer);
+  ConvertTaskUsageStats(&writer);
+  return writer.Close();
+}
+
+void BinaryTraceConverter::ConvertJobsNumTasks(BinaryTraceWriter* writer) {
+  MappedCSVFile jobs_tasks_file;
+  OpenTraceFile("/jobs_num_tasks/jobs_num_tasks.csv", &jobs_tasks_file);
+  while (jobs_tasks_file.NextRow(&fields_)) {
+    JobNumTasksRecord record;
+    if (fields_.size() != 2 ||
+        !MappedCSVFile::ParseUInt64(fields_[0], &record.job_id) ||
+        !MappedCSVFile::ParseUInt64(fields_[1], &record.num_tasks)) {
+      LOG(ERROR) << "Unexpected structure of jobs num tasks row on line: "
+                 << jobs_tasks_file.line_number();
+      continue;
+    }
+    writer->AppendJobNumTasks(record);
+  }
+}
+
+void BinaryTraceConverter::ConvertMachineEvents(BinaryTraceWriter* writer) {
+  MappedCSVFile machines_file;
+  OpenTraceFile("/machine_events/part-00000-of-00001.csv", &machines_file);
+  while (machines_file.NextRow(&fields_)) {
+    // schema: (timestamp, machine_id, event_type, platform, CPUs, Memory)
+    MachineEventRecord record;
+    memset(&record, 0, sizeof(record));
+    uint64_t event_type;
+    if (fields_.size() != 6 ||
+        !MappedCSVFile::ParseUInt64(fields_[0], &record.timestamp) ||
+        !MappedCSVFile::ParseUInt64(fields_[1], &record.machine_id) ||
+        !MappedCSVFile::ParseUInt64(fields_[2], &event_type)) {
+      LOG(ERROR) << "Unexpected structure of machine events on line "
+                 << machines_file.line_number();
+      continue;
+    }
+    record.event_type = static_cast<int32_t>(event_type);
+    writer->AppendMachineEvent(record);
+  }
+}
+
+void BinaryTraceConverter::ConvertTaskEvents(BinaryTraceWriter* writer,
+                                             int32_t num_task_events_files) {
+  ParseTaskEvents(num_task_events_files,
+                  [writer](const TaskEventRecord& record) {
+                    writer->AppendTaskEvent(record);
+                  });
+}
+
+void BinaryTraceConverter::ReadTaskEvents(
+    int32_t num_task_events_files, vector<TaskEventRecord>* task_events) {
+  ParseTaskEvents(num_task_events_files,
+                  [task_events](const TaskEventRecord& record) {
+                    task_events->push_back(record);
+                  });
+}
+
+void BinaryTraceConverter::ParseTaskEvents(
+    int32_t num_task_events_files,
+    boost::function<void(const TaskEventRecord&)> process_record) {
+  // Tasks that have had at least one of their events kept.
+  unordered_set<pair<uint64_t, uint64_t>,
+                boost::hash<pair<uint64_t, uint64_t>>> seen_tasks;
+  uint64_t last_timestamp = 0;
+  for (int32_t file_id = 0; file_id < num_task_events_files; ++file_id) {
+    string relative_path;
+    spf(&relative_path, "/task_events/part-%05d-of-00500.csv", file_id);
+    MappedCSVFile task_events_file;
+    OpenTraceFile(relative_path, &task_events_file);
+    while (task_events_file.NextRow(&fields_)) {
+      TaskEventRecord record;
+      memset(&record, 0, sizeof(record));
+      uint64_t event_type;
+      if (fields_.size() != 13 ||
+          !MappedCSVFile::ParseUInt64(fields_[0], &record.timestamp) ||
+          !MappedCSVFile::ParseUInt64(fields_[2], &record.job_id) ||
+          !MappedCSVFile::ParseUInt64(fields_[3], &record.task_index) ||
+          !MappedCSVFile::ParseUInt64(fields_[5], &event_type)) {
+        LOG(ERROR) << "Malformed task event on line "
+                   << task_events_file.line_number() << " of "
+                   << task_events_file.file_name();
+        continue;
+      }
+      record.event_type = static_cast<uint32_t>(event_type);
+      pair<uint64_t, uint64_t> task(record.job_id, record.task_index);
+      bool first_task_event = seen_tasks.find(task) == seen_tasks.end();
+      if (event_type == TASK_SUBMIT) {
+        uint64_t scheduling_class;
+        uint64_t priority;
+        if (!MappedCSVFile::ParseUInt64(fields_[7], &scheduling_class) ||
+            !MappedCSVFile::ParseUInt64(fields_[8], &priority)) {
+          LOG(ERROR) << "Malformed task submit event on line "
+                     << task_events_file.line_number() << " of "
+                     << task_events_file.file_name();
+          continue;
+        }
+        record.scheduling_class = static_cast<uint32_t>(scheduling_class);
+        record.priority = static_cast<uint32_t>(priority);
+        // Some tasks do not have resource requests in the trace.
+        double cpu_request;
+        if (MappedCSVFile::ParseDouble(fields_[9], &cpu_request)) {
+          record.cpu_request = static_cast<float>(cpu_request);
+        }
+        MappedCSVFile::ParseDouble(fields_[10], &record.ram_request);
+      } else if (!first_task_event) {
+        // The simulator does not replay the event.
+        continue;
+      }
+      if (record.timestamp < last_timestamp) {
+        LOG(FATAL) << "Task events are not sorted by timestamp on line "
+                   << task_events_file.line_number() << " of "
+                   << task_events_file.file_name();
+      }
+      last_timestamp = record.timestamp;
+      if (first_task_event) {
+        seen_tasks.insert(task);
+      }
+      process_record(record);
+    }
+  }
+}
+
+void BinaryTraceConverter::ConvertTaskRuntimes(BinaryTraceWriter* writer) {
+  MappedCSVFile tasks_file;
+  OpenTraceFile("/task_runtime_events/task_runtime_events.csv", &tasks_file);
+  while (tasks_file.NextRow(&fields_)) {
+    TaskRuntimeRecord record;
+    if (fields_.size() != 13 ||
+        !MappedCSVFile::ParseUInt64(fields_[0], &record.job_id) ||
+        !MappedCSVFile::ParseUInt64(fields_[1], &record.task_index) ||
+        !MappedCSVFile::ParseUInt64(fields_[4], &record.runtime)) {
+      LOG(ERROR) << "Unexpected structure of task runtime row on line: "
+                 << tasks_file.line_number();
+      continue;
+    }
+    writer->AppendTaskRuntime(record);
+  }
+}
+
+void BinaryTraceConverter::ConvertTaskUsageStats(BinaryTraceWriter* writer) {
+  MappedCSVFile usage_file;
+  OpenTraceFile("/task_usage_stat/task_usage_stat.csv", &usage_file);
+  while (usage_file.NextRow(&fields_)) {
+    TaskUsageStatsRecord record;
+    // See GoogleTraceLoader::LoadTaskUtilizationStats for the columns.
+    if (fields_.size() != 38 ||
+        !MappedCSVFile::ParseUInt64(fields_[0], &record.job_id) ||
+        !MappedCSVFile::ParseUInt64(fields_[1], &record.task_index) ||
+        !MappedCSVFile::ParseDouble(fields_[4], &record.avg_mean_cpu_usage) ||
+        !MappedCSVFile::ParseDouble(fields_[8],
+                                    &record.avg_canonical_mem_usage) ||
+        !MappedCSVFile::ParseDouble(fields_[12],
+                                    &record.avg_assigned_mem_usage) ||
+        !MappedCSVFile::ParseDouble(fields_[16],
+                                    &record.avg_unmapped_page_cache) ||
+        !MappedCSVFile::ParseDouble(fields_[20],
+                                    &record.avg_total_page_cache) ||
+        !MappedCSVFile::ParseDouble(fields_[24],
+                                    &record.avg_mean_disk_io_time) ||
+        !MappedCSVFile::ParseDouble(fields_[28],
+                                    &record.avg_mean_local_disk_used) ||
+        !MappedCSVFile::ParseDouble(fields_[32], &record.avg_cpi) ||
+        !MappedCSVFile::ParseDouble(fields_[36], &record.avg_mai)) {
+      LOG(WARNING) << "Malformed task usage at line "
+                   << usage_file.line_number();
+      continue;
+    }
+    writer->AppendTaskUsageStats(record);
+  }
+}
+
+void BinaryTraceConverter::OpenTraceFile(const string& relative_path,
+                                         MappedCSVFile* file) {
+  if (!file->Open(trace_path_ + relative_path)) {
+    LOG(FATAL) << "Failed to open " << trace_path_ << relative_path;
+  }
+}
+
+}  // namespace sim
+}  // namespace firmament
@@ -0,0 +1,79 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Converts a preprocessed Google-style trace into a binary trace.
+
+#ifndef FIRMAMENT_SIM_BINARY_TRACE_CONVERTER_H
+#define FIRMAMENT_SIM_BINARY_TRACE_CONVERTER_H
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include "base/common.h"
+#include "sim/binary_trace.h"
+#include "sim/mapped_csv_file.h"
+
+namespace firmament {
+namespace sim {
+
+class BinaryTraceConverter {
+ public:
+  explicit BinaryTraceConverter(const string& trace_path);
+  /**
+   * Converts the trace. The trace must have been preprocessed with
+   * google_trace_processor so that it contains the jobs_num_tasks,
+   * task_runtime_events and task_usage_stat files.
+   * @param binary_trace_file the path of the binary trace to write
+   * @param num_task_events_files the number of task events files to convert
+   * @return false if the binary trace could not be written
+   */
+  bool Convert(const string& binary_trace_file, int32_t num_task_events_files);
+  /**
+   * Reads the task events that the simulator replays, i.e., the submit events
+   * and the first event of every task, without writing a binary trace.
+   * @param num_task_events_files the number of task events files to read
+   * @param task_events the vector to append the events to
+   */
+  void ReadTaskEvents(int32_t num_task_events_files,
+                      vector<TaskEventRecord>* task_events);
+
+ private:
+  void ConvertJobsNumTasks(BinaryTraceWriter* writer);
+  void ConvertMachineEvents(BinaryTraceWriter* writer);
+  void ConvertTaskEvents(BinaryTraceWriter* writer,
+                         int32_t num_task_events_files);
+  void ConvertTaskRuntimes(BinaryTraceWriter* writer);
+  void ConvertTaskUsageStats(BinaryTraceWriter* writer);
+  void OpenTraceFile(const string& relative_path, MappedCSVFile* file);
+  void ParseTaskEvents(
+      int32_t num_task_events_files,
+      boost::function<void(const TaskEventRecord&)> process_record);
+
+  string trace_path_;
+  // Fields of the row that is being converted.
+  vector<CSVField> fields_;
+};
+
+}  // namespace sim
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SIM_BINARY_TRACE_CONVERTER_H
@@ -0,0 +1,47 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Tool that converts a preprocessed Google-style trace into a binary trace
+// that the simulator can replay with --simulation=binary.
+
+#include "base/common.h"
+#include "sim/binary_trace_converter.h"
+
+DEFINE_string(trace_path, "", "Path where the trace files are.");
+DEFINE_int32(num_files_to_process, 500,
+             "Number of task events files to convert.");
+DEFINE_string(binary_trace_file, "",
+              "Path of the binary trace file to write.");
+
+using namespace firmament;  // NOLINT
+
+int main(int argc, char *argv[]) {
+  common::InitFirmament(argc, argv);
+  if (FLAGS_trace_path.empty() || FLAGS_binary_trace_file.empty()) {
+    LOG(FATAL) << "Please specify --trace_path and --binary_trace_file";
+  }
+  sim::BinaryTraceConverter converter(FLAGS_trace_path);
+  if (!converter.Convert(FLAGS_binary_trace_file,
+                         FLAGS_num_files_to_process)) {
+    LOG(FATAL) << "Failed to write " << FLAGS_binary_trace_file;
+  }
+  LOG(INFO) << "Wrote binary trace to " << FLAGS_binary_trace_file;
+  return 0;
+}
@@ -0,0 +1,310 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "sim/binary_trace_loader.h"
+
+#include <SpookyV2.h>
+#include <sys/stat.h>
+
+#include <utility>
+
+#include "misc/map-util.h"
+
+DEFINE_string(binary_trace_file, "",
+              "Path of the binary trace to replay when --simulation=binary. "
+              "Binary traces are generated by binary_trace_converter. It can "
+              "also be the directory of a trace that was generated with "
+              "--generated_trace_format=binary.");
+DEFINE_uint64(binary_trace_start_time, 0,
+              "Trace timestamp (in microseconds, before --trace_speed_up is "
+              "applied) from which to replay the task events of the binary "
+              "trace. The tasks whose first event is earlier are skipped. "
+              "Machine events are replayed from the start of the trace.");
+
+DECLARE_uint64(num_tasks_synthetic_job_after_initial_run);
+DECLARE_uint64(runtime);
+DECLARE_string(simulation);
+DECLARE_double(trace_speed_up);
+DECLARE_bool(task_duration_oracle);
+
+static bool ValidateBinaryTraceFile(const char* flagname,
+                                    const string& binary_trace_file) {
+  if (FLAGS_simulation == "binary" && binary_trace_file.empty()) {
+    LOG(ERROR) << "Please specify a path to the binary trace!";
+    return false;
+  }
+  return true;
+}
+
+static const bool binary_trace_file_validator =
+  google::RegisterFlagValidator(&FLAGS_binary_trace_file,
+                                &ValidateBinaryTraceFile);
+
+namespace firmament {
+namespace sim {
+
+BinaryTraceLoader::BinaryTraceLoader(EventManager* event_manager)
+  : GoogleTraceLoader(event_manager), trace_open_(true), task_events_(NULL),
+    next_task_event_(0), skipped_to_start_time_(false) {
+  struct stat st;
+  bool generated_trace = stat(FLAGS_binary_trace_file.c_str(), &st) == 0 &&
+    S_ISDIR(st.st_mode);
+  if (generated_trace) {
+    if (!trace_.OpenGeneratedTrace(FLAGS_binary_trace_file)) {
+      LOG(FATAL) << "Failed to load generated trace "
+                 << FLAGS_binary_trace_file;
+    }
+  } else if (!trace_.Open(FLAGS_binary_trace_file)) {
+    LOG(FATAL) << "Failed to open binary trace " << FLAGS_binary_trace_file;
+  }
+  // All the task events columns have the same number of values.
+  task_event_timestamps_ =
+    trace_.Column<uint64_t>(TASK_EVENT_TIMESTAMP_COLUMN, &num_task_events_);
+  uint64_t num_values;
+  task_event_job_ids_ =
+    trace_.Column<uint64_t>(TASK_EVENT_JOB_ID_COLUMN, &num_values);
+  task_event_task_indices_ =
+    trace_.Column<uint64_t>(TASK_EVENT_TASK_INDEX_COLUMN, &num_values);
+  task_event_types_ =
+    trace_.Column<uint32_t>(TASK_EVENT_TYPE_COLUMN, &num_values);
+  task_event_scheduling_classes_ =
+    trace_.Column<uint32_t>(TASK_EVENT_SCHEDULING_CLASS_COLUMN, &num_values);
+  task_event_priorities_ =
+    trace_.Column<uint32_t>(TASK_EVENT_PRIORITY_COLUMN, &num_values);
+  task_event_cpu_requests_ =
+    trace_.Column<float>(TASK_EVENT_CPU_REQUEST_COLUMN, &num_values);
+  task_event_ram_requests_ =
+    trace_.Column<double>(TASK_EVENT_RAM_REQUEST_COLUMN, &num_values);
+}
+
+BinaryTraceLoader::BinaryTraceLoader(
+    EventManager* event_manager,
+    const vector<TaskEventRecord>* task_events)
+  : GoogleTraceLoader(event_manager), trace_open_(false),
+    task_events_(task_events->empty() ? NULL : &(*task_events)[0]),
+    task_event_timestamps_(NULL), task_event_job_ids_(NULL),
+    task_event_task_indices_(NULL), task_event_types_(NULL),
+    task_event_scheduling_classes_(NULL), task_event_priorities_(NULL),
+    task_event_cpu_requests_(NULL), task_event_ram_requests_(NULL),
+    num_task_events_(task_events->size()), next_task_event_(0),
+    // The given task events are replayed from the start.
+    skipped_to_start_time_(true) {
+}
+
+bool BinaryTraceLoader::FindTaskRuntime(TaskID_t task_id, uint64_t* runtime) {
+  // The loader does not check if the task is sub-sampled out of the trace,
+  // as the simulator only looks up the tasks it has submitted.
+  uint64_t row;
+  if (!trace_open_ ||
+      !trace_.FindTaskRow(TASK_RUNTIME_TASK_ID_COLUMN, task_id, &row)) {
+    return false;
+  }
+  uint64_t num_values;
+  const uint64_t* runtimes =
+    trace_.Column<uint64_t>(TASK_RUNTIME_COLUMN, &num_values);
+  *runtime = runtimes[row] / FLAGS_trace_speed_up;
+  return true;
+}
+
+bool BinaryTraceLoader::FindTaskStats(TaskID_t task_id,
+                                      TraceTaskStats* task_stats) {
+  uint64_t row;
+  if (!trace_open_ ||
+      !trace_.FindTaskRow(TASK_USAGE_TASK_ID_COLUMN, task_id, &row)) {
+    return false;
+  }
+  task_stats->avg_mean_cpu_usage_ =
+    ReadTaskUsage(TASK_USAGE_MEAN_CPU_USAGE_COLUMN, row);
+  task_stats->avg_canonical_mem_usage_ =
+    ReadTaskUsage(TASK_USAGE_CANONICAL_MEM_USAGE_COLUMN, row);
+  task_stats->avg_assigned_mem_usage_ =
+    ReadTaskUsage(TASK_USAGE_ASSIGNED_MEM_USAGE_COLUMN, row);
+  task_stats->avg_unmapped_page_cache_ =
+    ReadTaskUsage(TASK_USAGE_UNMAPPED_PAGE_CACHE_COLUMN, row);
+  task_stats->avg_total_page_cache_ =
+    ReadTaskUsage(TASK_USAGE_TOTAL_PAGE_CACHE_COLUMN, row);
+  task_stats->avg_mean_disk_io_time_ =
+    ReadTaskUsage(TASK_USAGE_MEAN_DISK_IO_TIME_COLUMN, row);
+  task_stats->avg_mean_local_disk_used_ =
+    ReadTaskUsage(TASK_USAGE_MEAN_LOCAL_DISK_USED_COLUMN, row);
+  task_stats->avg_cpi_ = ReadTaskUsage(TASK_USAGE_CPI_COLUMN, row);
+  task_stats->avg_mai_ = ReadTaskUsage(TASK_USAGE_MAI_COLUMN, row);
+  if (FLAGS_task_duration_oracle) {
+    uint64_t runtime = 0;
+    CHECK(FindTaskRuntime(task_id, &runtime));
+    task_stats->total_runtime_ = runtime;
+  }
+  return true;
+}
+
+void BinaryTraceLoader::LoadJobsNumTasks(
+    unordered_map<uint64_t, uint64_t>* job_num_tasks) {
+  CHECK(trace_open_);
+  uint64_t num_jobs;
+  const uint64_t* job_ids =
+    trace_.Column<uint64_t>(JOB_ID_COLUMN, &num_jobs);
+  const uint64_t* num_tasks =
+    trace_.Column<uint64_t>(JOB_NUM_TASKS_COLUMN, &num_jobs);
+  job_num_tasks->rehash(job_num_tasks->size() + num_jobs + 1);
+  LoadSyntheticJobNumTasks(job_num_tasks);
+  for (uint64_t i = 0; i < num_jobs; ++i) {
+    CHECK(InsertIfNotPresent(job_num_tasks, job_ids[i], num_tasks[i]));
+  }
+}
+
+void BinaryTraceLoader::LoadMachineEvents(
+    multimap<uint64_t, EventDescriptor>* machine_events) {
+  CHECK(trace_open_);
+  uint64_t num_events;
+  const uint64_t* timestamps =
+    trace_.Column<uint64_t>(MACHINE_EVENT_TIMESTAMP_COLUMN, &num_events);
+  const uint64_t* machine_ids =
+    trace_.Column<uint64_t>(MACHINE_EVENT_MACHINE_ID_COLUMN, &num_events);
+  const int32_t* event_types =
+    trace_.Column<int32_t>(MACHINE_EVENT_TYPE_COLUMN, &num_events);
+  for (uint64_t i = 0; i < num_events; ++i) {
+    if (timestamps[i] > FLAGS_runtime) {
+      // only load the events that we need
+      break;
+    }
+    // Sub-sample the trace if we only retain < 100% of machines.
+    if (SpookyHash::Hash64(&machine_ids[i], sizeof(machine_ids[i]),
+                           kSeed) > MaxMachineEventHashToRetain()) {
+      continue;
+    }
+    uint64_t timestamp = timestamps[i] / FLAGS_trace_speed_up;
+    EventDescriptor event_desc;
+    event_desc.set_machine_id(machine_ids[i]);
+    event_desc.set_type(TranslateMachineEvent(event_types[i]));
+    if (event_desc.type() == EventDescriptor::REMOVE_MACHINE ||
+        event_desc.type() == EventDescriptor::ADD_MACHINE) {
+      machine_events->insert(
+          pair<uint64_t, EventDescriptor>(timestamp, event_desc));
+    }
+  }
+}
+
+bool BinaryTraceLoader::LoadTaskEvents(
+    uint64_t events_up_to_time,
+    unordered_map<uint64_t, uint64_t>* job_num_tasks) {
+  bool loaded_event = false;
+  AddSyntheticTaskEvents();
+  if (!skipped_to_start_time_) {
+    SkipToStartTime(job_num_tasks);
+  }
+  TaskEventRecord record;
+  while (next_task_event_ < num_task_events_) {
+    ReadTaskEvent(next_task_event_++, &record);
+    TraceTaskIdentifier task_id;
+    task_id.job_id = record.job_id;
+    task_id.task_index = record.task_index;
+    if (FilterTask(task_id, job_num_tasks) ||
+        record.event_type != TASK_SUBMIT_EVENT) {
+      continue;
+    }
+    uint64_t task_event_time = record.timestamp / FLAGS_trace_speed_up;
+    AddTaskSubmitEvent(task_event_time, task_id, record.scheduling_class,
+                       record.priority, record.cpu_request,
+                       record.ram_request);
+    loaded_event = true;
+    if (task_event_time > events_up_to_time) {
+      // We've loaded all the events up to the given time.
+      // NOTE: we also loaded the current task event.
+      return true;
+    }
+  }
+  return loaded_event;
+}
+
+void BinaryTraceLoader::LoadTaskUtilizationStats(
+    unordered_map<TaskID_t, TraceTaskStats>* task_id_to_stats,
+    const unordered_map<TaskID_t, uint64_t>& task_runtimes) {
+  CHECK(trace_open_);
+  // The statistics of the trace's tasks are returned by FindTaskStats.
+  LoadSyntheticTaskUtilizationStats(task_id_to_stats);
+}
+
+void BinaryTraceLoader::LoadTasksRunningTime(
+    unordered_map<TaskID_t, uint64_t>* task_runtime) {
+  CHECK(trace_open_);
+  // The runtimes of the trace's tasks are returned by FindTaskRuntime.
+  LoadSyntheticTasksRunningTime(task_runtime);
+}
+
+void BinaryTraceLoader::ReadTaskEvent(uint64_t index,
+                                      TaskEventRecord* record) const {
+  if (task_events_ != NULL) {
+    *record = task_events_[index];
+    return;
+  }
+  record->timestamp = task_event_timestamps_[index];
+  record->job_id = task_event_job_ids_[index];
+  record->task_index = task_event_task_indices_[index];
+  record->event_type = task_event_types_[index];
+  record->scheduling_class = task_event_scheduling_classes_[index];
+  record->priority = task_event_priorities_[index];
+  record->cpu_request = task_event_cpu_requests_[index];
+  record->ram_request = task_event_ram_requests_[index];
+}
+
+double BinaryTraceLoader::ReadTaskUsage(BinaryTraceColumn column,
+                                        uint64_t row) const {
+  uint64_t num_values;
+  return trace_.Column<double>(column, &num_values)[row];
+}
+
+void BinaryTraceLoader::RestoreTaskEventsPosition(
+    const TraceLoaderPosition& position) {
+  CHECK(position.task_events_file_id() == 0 &&
+        !position.task_events_file_open())
+    << "The checkpoint was saved while reading the CSV task events";
+  RestoreFilterState(position);
+  next_task_event_ = position.next_task_event();
+  // The skipped tasks are part of the restored filter state.
+  skipped_to_start_time_ = true;
+}
+
+void BinaryTraceLoader::SaveTaskEventsPosition(
+    TraceLoaderPosition* position) {
+  SaveFilterState(position);
+  position->set_next_task_event(next_task_event_);
+}
+
+void BinaryTraceLoader::SkipToStartTime(
+    unordered_map<uint64_t, uint64_t>* job_num_tasks) {
+  skipped_to_start_time_ = true;
+  if (FLAGS_binary_trace_start_time == 0) {
+    return;
+  }
+  uint64_t first_task_event =
+    trace_.FindFirstTaskEvent(FLAGS_binary_trace_start_time);
+  // Only the job id and task index columns of the skipped events are read.
+  for (; next_task_event_ < first_task_event; ++next_task_event_) {
+    TraceTaskIdentifier task_id;
+    task_id.job_id = task_event_job_ids_[next_task_event_];
+    task_id.task_index = task_event_task_indices_[next_task_event_];
+    ExcludeTask(task_id, job_num_tasks);
+  }
+  LOG(INFO) << "Skipped " << first_task_event << " task events before "
+            << FLAGS_binary_trace_start_time;
+}
+
+}  // namespace sim
+}  // namespace firmament
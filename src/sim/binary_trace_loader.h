@@ -0,0 +1,106 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Loader for Google traces that have been converted to binary traces. It
+// replays the same events as the GoogleTraceLoader does for the CSV trace.
+// The task runtimes and usage statistics are not loaded up front: they are
+// looked up in the mapped trace when the simulator needs them, so only the
+// pages that hold the tasks that are replayed are read.
+
+#ifndef FIRMAMENT_SIM_BINARY_TRACE_LOADER_H
+#define FIRMAMENT_SIM_BINARY_TRACE_LOADER_H
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "base/common.h"
+#include "sim/binary_trace.h"
+#include "sim/event_desc.pb.h"
+#include "sim/event_manager.h"
+#include "sim/google_trace_loader.h"
+
+namespace firmament {
+namespace sim {
+
+class BinaryTraceLoader : public GoogleTraceLoader {
+ public:
+  explicit BinaryTraceLoader(EventManager* event_manager);
+  /**
+   * Creates a loader that replays task events that have already been read
+   * into memory. It must only be used to load task events.
+   * @param event_manager the event manager to which task events are added
+   * @param task_events the task events to replay; not owned by the loader
+   */
+  BinaryTraceLoader(EventManager* event_manager,
+                    const vector<TaskEventRecord>* task_events);
+
+  bool FindTaskRuntime(TaskID_t task_id, uint64_t* runtime);
+  bool FindTaskStats(TaskID_t task_id, TraceTaskStats* task_stats);
+  void LoadJobsNumTasks(unordered_map<uint64_t, uint64_t>* job_num_tasks);
+  void LoadMachineEvents(multimap<uint64_t, EventDescriptor>* machine_events);
+  bool LoadTaskEvents(uint64_t events_up_to_time,
+                      unordered_map<uint64_t, uint64_t>* job_num_tasks);
+  void LoadTaskUtilizationStats(
+      unordered_map<TaskID_t, TraceTaskStats>* task_id_to_stats,
+      const unordered_map<TaskID_t, uint64_t>& task_runtimes);
+  void LoadTasksRunningTime(
+      unordered_map<TaskID_t, uint64_t>* task_runtime);
+  void RestoreTaskEventsPosition(const TraceLoaderPosition& position);
+  void SaveTaskEventsPosition(TraceLoaderPosition* position);
+
+ private:
+  void ReadTaskEvent(uint64_t index, TaskEventRecord* record) const;
+  double ReadTaskUsage(BinaryTraceColumn column, uint64_t row) const;
+  /**
+   * Skips the task events before --binary_trace_start_time. The tasks whose
+   * first event is skipped are never submitted, so they are discounted from
+   * their jobs like the tasks that are sub-sampled out of the trace.
+   * @param job_num_tasks map containing the number of tasks each job has
+   */
+  void SkipToStartTime(unordered_map<uint64_t, uint64_t>* job_num_tasks);
+
+  BinaryTraceFile trace_;
+  // True if the loader reads from trace_, false if it only replays the task
+  // events it was given.
+  bool trace_open_;
+  // The task events the loader was given, or NULL if it reads them from the
+  // columns of trace_.
+  const TaskEventRecord* task_events_;
+  const uint64_t* task_event_timestamps_;
+  const uint64_t* task_event_job_ids_;
+  const uint64_t* task_event_task_indices_;
+  const uint32_t* task_event_types_;
+  const uint32_t* task_event_scheduling_classes_;
+  const uint32_t* task_event_priorities_;
+  const float* task_event_cpu_requests_;
+  const double* task_event_ram_requests_;
+  uint64_t num_task_events_;
+  // Index of the next task event to load.
+  uint64_t next_task_event_;
+  // True once the loader has skipped to --binary_trace_start_time, or has
+  // restored its position from a checkpoint.
+  bool skipped_to_start_time_;
+};
+
+}  // namespace sim
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SIM_BINARY_TRACE_LOADER_H
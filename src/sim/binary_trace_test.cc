@@ -0,0 +1,292 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Tests for the binary trace writer and reader.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "misc/trace_generator.h"
+#include "misc/trace_writer.h"
+#include "misc/utils.h"
+#include "sim/binary_trace.h"
+#include "sim/binary_trace_converter.h"
+#include "sim/trace_utils.h"
+
+// The simulator objects that the test links with expect this flag.
+DEFINE_string(scheduler, "flow", "The scheduler to use for tests.");
+
+namespace firmament {
+namespace sim {
+
+class BinaryTraceTest : public ::testing::Test {
+ protected:
+  BinaryTraceTest() {
+    char file_name[] = "/tmp/binary_trace_test_XXXXXX";
+    int fd = mkstemp(file_name);
+    CHECK_GE(fd, 0);
+    close(fd);
+    file_name_ = file_name;
+  }
+
+  virtual ~BinaryTraceTest() {
+    unlink(file_name_.c_str());
+  }
+
+  // Writes a trace with num_task_events task events. Every timestamp is
+  // shared by two consecutive events.
+  void WriteTrace(uint64_t num_task_events) {
+    BinaryTraceWriter writer;
+    ASSERT_TRUE(writer.Open(file_name_));
+    JobNumTasksRecord job_record;
+    job_record.job_id = 42;
+    job_record.num_tasks = num_task_events;
+    writer.AppendJobNumTasks(job_record);
+    for (uint64_t i = 0; i < num_task_events; ++i) {
+      TaskEventRecord record;
+      memset(&record, 0, sizeof(record));
+      record.timestamp = 10 * (i / 2);
+      record.job_id = 42;
+      record.task_index = i;
+      writer.AppendTaskEvent(record);
+    }
+    // Append the runtimes in reverse order; the writer sorts them.
+    for (uint64_t i = num_task_events; i > 0; --i) {
+      TaskRuntimeRecord record;
+      record.job_id = 42;
+      record.task_index = i - 1;
+      record.runtime = 100 + i - 1;
+      writer.AppendTaskRuntime(record);
+    }
+    ASSERT_TRUE(writer.Close());
+  }
+
+  string file_name_;
+};
+
+TEST_F(BinaryTraceTest, ReadColumns) {
+  WriteTrace(10);
+  BinaryTraceFile trace;
+  ASSERT_TRUE(trace.Open(file_name_));
+  uint64_t num_values;
+  const uint64_t* job_ids = trace.Column<uint64_t>(JOB_ID_COLUMN, &num_values);
+  ASSERT_EQ(num_values, 1);
+  EXPECT_EQ(job_ids[0], 42);
+  const uint64_t* num_tasks =
+    trace.Column<uint64_t>(JOB_NUM_TASKS_COLUMN, &num_values);
+  ASSERT_EQ(num_values, 1);
+  EXPECT_EQ(num_tasks[0], 10);
+  const uint64_t* task_indices =
+    trace.Column<uint64_t>(TASK_EVENT_TASK_INDEX_COLUMN, &num_values);
+  ASSERT_EQ(num_values, 10);
+  for (uint64_t i = 0; i < num_values; ++i) {
+    EXPECT_EQ(task_indices[i], i);
+  }
+  // Tables that have not been written are empty.
+  trace.Column<uint64_t>(MACHINE_EVENT_MACHINE_ID_COLUMN, &num_values);
+  EXPECT_EQ(num_values, 0);
+  trace.Column<TaskID_t>(TASK_USAGE_TASK_ID_COLUMN, &num_values);
+  EXPECT_EQ(num_values, 0);
+}
+
+TEST_F(BinaryTraceTest, FindFirstTaskEvent) {
+  // Span several index entries.
+  uint64_t num_task_events = 3 * kTaskEventsIndexInterval + 5;
+  WriteTrace(num_task_events);
+  BinaryTraceFile trace;
+  ASSERT_TRUE(trace.Open(file_name_));
+  EXPECT_EQ(trace.FindFirstTaskEvent(0), 0);
+  EXPECT_EQ(trace.FindFirstTaskEvent(5), 2);
+  EXPECT_EQ(trace.FindFirstTaskEvent(10), 2);
+  // The first event of an index interval and the events around it.
+  uint64_t boundary = kTaskEventsIndexInterval;
+  EXPECT_EQ(trace.FindFirstTaskEvent(10 * (boundary / 2)), boundary);
+  EXPECT_EQ(trace.FindFirstTaskEvent(10 * (boundary / 2) - 1), boundary);
+  EXPECT_EQ(trace.FindFirstTaskEvent(10 * (boundary / 2) + 1), boundary + 2);
+  // The last event, and past the end of the trace.
+  uint64_t last_timestamp = 10 * ((num_task_events - 1) / 2);
+  EXPECT_EQ(trace.FindFirstTaskEvent(last_timestamp), num_task_events - 1);
+  EXPECT_EQ(trace.FindFirstTaskEvent(last_timestamp + 1), num_task_events);
+}
+
+TEST_F(BinaryTraceTest, FindTaskRow) {
+  WriteTrace(10);
+  BinaryTraceFile trace;
+  ASSERT_TRUE(trace.Open(file_name_));
+  uint64_t num_values;
+  const TaskID_t* task_ids =
+    trace.Column<TaskID_t>(TASK_RUNTIME_TASK_ID_COLUMN, &num_values);
+  ASSERT_EQ(num_values, 10);
+  for (uint64_t i = 1; i < num_values; ++i) {
+    EXPECT_LT(task_ids[i - 1], task_ids[i]);
+  }
+  const uint64_t* runtimes =
+    trace.Column<uint64_t>(TASK_RUNTIME_COLUMN, &num_values);
+  for (uint64_t task_index = 0; task_index < 10; ++task_index) {
+    TraceTaskIdentifier task_identifier;
+    task_identifier.job_id = 42;
+    task_identifier.task_index = task_index;
+    uint64_t row;
+    ASSERT_TRUE(trace.FindTaskRow(
+        TASK_RUNTIME_TASK_ID_COLUMN,
+        GenerateTaskIDFromTraceIdentifier(task_identifier), &row));
+    EXPECT_EQ(runtimes[row], 100 + task_index);
+  }
+  TraceTaskIdentifier task_identifier;
+  task_identifier.job_id = 43;
+  task_identifier.task_index = 0;
+  uint64_t row;
+  EXPECT_FALSE(trace.FindTaskRow(
+      TASK_RUNTIME_TASK_ID_COLUMN,
+      GenerateTaskIDFromTraceIdentifier(task_identifier), &row));
+  EXPECT_FALSE(trace.FindTaskRow(
+      TASK_USAGE_TASK_ID_COLUMN,
+      GenerateTaskIDFromTraceIdentifier(task_identifier), &row));
+}
+
+TEST_F(BinaryTraceTest, RejectInvalidFiles) {
+  BinaryTraceFile trace;
+  // The file is empty.
+  EXPECT_FALSE(trace.Open(file_name_));
+  WriteTrace(1);
+  // Change the version of the trace.
+  FILE* file = fopen(file_name_.c_str(), "r+b");
+  ASSERT_TRUE(file != NULL);
+  BinaryTraceHeader header;
+  ASSERT_EQ(fread(&header, sizeof(header), 1, file), 1);
+  header.version = kBinaryTraceVersion + 1;
+  ASSERT_EQ(fseek(file, 0, SEEK_SET), 0);
+  ASSERT_EQ(fwrite(&header, sizeof(header), 1, file), 1);
+  fclose(file);
+  EXPECT_FALSE(trace.Open(file_name_));
+}
+
+TEST_F(BinaryTraceTest, ReadTaskEventsFromCSVTrace) {
+  char trace_dir[] = "/tmp/binary_trace_test_dir_XXXXXX";
+  ASSERT_TRUE(mkdtemp(trace_dir) != NULL);
+  string trace_path = trace_dir;
+  MkdirIfNotPresent(trace_path + "/task_events");
+  string csv_file_name = trace_path + "/task_events/part-00000-of-00500.csv";
+  FILE* csv_file = fopen(csv_file_name.c_str(), "w");
+  ASSERT_TRUE(csv_file != NULL);
+  // A submit event, the first event of another task, and a later event of
+  // that task, which the simulator does not replay.
+  fputs("10,,42,0,,0,,2,9,0.5,0.25,,\n", csv_file);
+  fputs("20,,42,1,,1,,,,,,,\n", csv_file);
+  fputs("30,,42,1,,4,,,,,,,\n", csv_file);
+  fclose(csv_file);
+  BinaryTraceConverter converter(trace_path);
+  vector<TaskEventRecord> task_events;
+  converter.ReadTaskEvents(1, &task_events);
+  unlink(csv_file_name.c_str());
+  rmdir((trace_path + "/task_events").c_str());
+  rmdir(trace_dir);
+  ASSERT_EQ(task_events.size(), 2);
+  EXPECT_EQ(task_events[0].timestamp, 10);
+  EXPECT_EQ(task_events[0].task_index, 0);
+  EXPECT_EQ(task_events[0].event_type, 0);
+  EXPECT_EQ(task_events[0].scheduling_class, 2);
+  EXPECT_EQ(task_events[0].priority, 9);
+  EXPECT_FLOAT_EQ(task_events[0].cpu_request, 0.5);
+  EXPECT_DOUBLE_EQ(task_events[0].ram_request, 0.25);
+  EXPECT_EQ(task_events[1].timestamp, 20);
+  EXPECT_EQ(task_events[1].task_index, 1);
+  EXPECT_EQ(task_events[1].event_type, 1);
+}
+
+TEST_F(BinaryTraceTest, OpenGeneratedTrace) {
+  char trace_dir[] = "/tmp/binary_trace_test_dir_XXXXXX";
+  ASSERT_TRUE(mkdtemp(trace_dir) != NULL);
+  string trace_path = trace_dir;
+  const char* kFiles[] = {
+    "/jobs_num_tasks/jobs_num_tasks",
+    "/machine_events/part-00000-of-00001",
+    "/task_events/part-00000-of-00500",
+    "/task_runtime_events/task_runtime_events",
+    "/task_usage_stat/task_usage_stat",
+  };
+  const uint32_t kFields[] = {kJobNumTasksFields, kMachineEventFields,
+                              kTaskEventFields, kTaskRuntimeFields,
+                              kTaskUsageStatFields};
+  {
+    TraceWriter writer(BINARY_TRACE_FILE, 1024, 1000);
+    vector<uint32_t> file_ids;
+    for (uint32_t i = 0; i < 5; ++i) {
+      string file_path = trace_path + kFiles[i];
+      MkdirIfNotPresent(file_path.substr(0, file_path.rfind('/')));
+      file_ids.push_back(writer.AddFile(file_path, kFields[i], NULL));
+    }
+    uint64_t job_record[] = {42, 2};
+    writer.Append(file_ids[0], job_record);
+    uint64_t machine_record[] = {5, 7, MACHINE_ADD};
+    writer.Append(file_ids[1], machine_record);
+    // Task 0 is submitted, scheduled and finishes; only its submit event is
+    // kept.
+    uint64_t task_records[][5] = {{10, 42, 0, 0, TASK_SUBMIT_EVENT},
+                                  {10, 42, 0, 7, TASK_SCHEDULE_EVENT},
+                                  {20, 42, 0, 7, TASK_FINISH_EVENT}};
+    for (auto& task_record : task_records) {
+      writer.Append(file_ids[2], task_record);
+    }
+    uint64_t runtime_record[] = {42, 0, 5, 30, 10, 2};
+    writer.Append(file_ids[3], runtime_record);
+    writer.Close();
+  }
+  BinaryTraceFile trace;
+  ASSERT_TRUE(trace.OpenGeneratedTrace(trace_path));
+  for (uint32_t i = 0; i < 5; ++i) {
+    string file_path = trace_path + kFiles[i];
+    unlink((file_path + ".bin").c_str());
+    rmdir(file_path.substr(0, file_path.rfind('/')).c_str());
+  }
+  rmdir(trace_dir);
+  uint64_t num_values;
+  const uint64_t* num_tasks =
+    trace.Column<uint64_t>(JOB_NUM_TASKS_COLUMN, &num_values);
+  ASSERT_EQ(num_values, 1);
+  EXPECT_EQ(num_tasks[0], 2);
+  const uint64_t* machine_ids =
+    trace.Column<uint64_t>(MACHINE_EVENT_MACHINE_ID_COLUMN, &num_values);
+  ASSERT_EQ(num_values, 1);
+  EXPECT_EQ(machine_ids[0], 7);
+  const uint32_t* task_event_types =
+    trace.Column<uint32_t>(TASK_EVENT_TYPE_COLUMN, &num_values);
+  ASSERT_EQ(num_values, 1);
+  EXPECT_EQ(task_event_types[0], TASK_SUBMIT_EVENT);
+  const uint64_t* runtimes =
+    trace.Column<uint64_t>(TASK_RUNTIME_COLUMN, &num_values);
+  ASSERT_EQ(num_values, 1);
+  EXPECT_EQ(runtimes[0], 30);
+  trace.Column<TaskID_t>(TASK_USAGE_TASK_ID_COLUMN, &num_values);
+  EXPECT_EQ(num_values, 0);
+}
+
+}  // namespace sim
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -65,7 +65,8 @@ namespace firmament {
 namespace sim {
 
 EventManager::EventManager(SimulatedWallTime* simulated_time) :
-  simulated_time_(simulated_time), num_events_processed_(0) {
+  simulated_time_(simulated_time), next_sequence_(0), num_events_(0),
+  num_task_end_events_(0), num_events_processed_(0) {
   LOG(INFO) << "Maximum number of task events to process: " << FLAGS_max_events;
   LOG(INFO) << "Maximum number of scheduling rounds: "
             << FLAGS_max_scheduling_rounds;
@@ -75,25 +76,92 @@ EventManager::~EventManager() {
 }
 
 void EventManager::AddEvent(uint64_t timestamp, EventDescriptor event) {
-  events_.insert(pair<uint64_t, EventDescriptor>(timestamp, event));
+  uint32_t slot;
+  if (free_slots_.empty()) {
+    slot = static_cast<uint32_t>(event_slots_.size());
+    event_slots_.push_back(SimulatorEvent());
+    event_sequences_.push_back(UINT64_MAX);
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  SimulatorEvent& sim_event = event_slots_[slot];
+  sim_event.timestamp = timestamp;
+  sim_event.machine_id = event.machine_id();
+  sim_event.job_id = event.job_id();
+  sim_event.task_index = event.task_index();
+  sim_event.requested_ram = event.requested_ram();
+  sim_event.requested_cpu_cores = event.requested_cpu_cores();
+  sim_event.priority = event.priority();
+  sim_event.scheduling_class = event.scheduling_class();
+  sim_event.type = event.type();
+  EventHeapEntry entry;
+  entry.timestamp = timestamp;
+  entry.sequence = next_sequence_++;
+  entry.slot = slot;
+  event_sequences_[slot] = entry.sequence;
+  if (IsPlacementRelevant(sim_event.type)) {
+    PushEvent(entry, &placement_events_);
+  } else {
+    PushEvent(entry, &other_events_);
+  }
+  if (sim_event.type == EventDescriptor::TASK_END_RUNTIME) {
+    if (task_end_events_.size() >= 2 * num_task_end_events_ + 1024) {
+      RemoveStaleTaskEndEvents();
+    }
+    TraceTaskIdentifier task_identifier;
+    task_identifier.job_id = sim_event.job_id;
+    task_identifier.task_index = sim_event.task_index;
+    task_end_events_.insert(
+        pair<TraceTaskIdentifier, EventHeapEntry>(task_identifier, entry));
+    num_task_end_events_++;
+  }
+  num_events_++;
+}
+
+void EventManager::FreeSlot(uint32_t slot) {
+  if (event_slots_[slot].type == EventDescriptor::TASK_END_RUNTIME) {
+    // The entry of the event in task_end_events_ is removed lazily.
+    num_task_end_events_--;
+  }
+  event_sequences_[slot] = UINT64_MAX;
+  free_slots_.push_back(slot);
+  num_events_--;
 }
 
 pair<uint64_t, EventDescriptor> EventManager::GetNextEvent() {
+  vector<EventHeapEntry>* heap = NextEventHeap();
+  CHECK_NOTNULL(heap);
   num_events_processed_++;
-  multimap<uint64_t, EventDescriptor>::iterator it = events_.begin();
-  pair<uint64_t, EventDescriptor> time_event = *it;
-  events_.erase(it);
+  uint32_t slot = heap->front().slot;
+  PopEvent(heap);
+  pair<uint64_t, EventDescriptor> time_event;
+  time_event.first = event_slots_[slot].timestamp;
+  GetSlotEvent(slot, &time_event.second);
+  FreeSlot(slot);
   simulated_time_->UpdateCurrentTimestampIfSmaller(time_event.first);
   return time_event;
 }
 
+void EventManager::GetSlotEvent(uint32_t slot, EventDescriptor* event) const {
+  const SimulatorEvent& sim_event = event_slots_[slot];
+  event->set_type(sim_event.type);
+  event->set_machine_id(sim_event.machine_id);
+  event->set_job_id(sim_event.job_id);
+  event->set_task_index(sim_event.task_index);
+  event->set_requested_cpu_cores(sim_event.requested_cpu_cores);
+  event->set_requested_ram(sim_event.requested_ram);
+  event->set_priority(sim_event.priority);
+  event->set_scheduling_class(sim_event.scheduling_class);
+}
+
 uint64_t EventManager::GetTimeOfNextEvent() {
-  multimap<uint64_t, EventDescriptor>::iterator it = events_.begin();
-  if (it == events_.end()) {
+  vector<EventHeapEntry>* heap = NextEventHeap();
+  if (heap == NULL) {
     // Empty collection.
     return UINT64_MAX;
   } else {
-    return it->first;
+    return heap->front().timestamp;
   }
 }
 
@@ -108,16 +176,12 @@ uint64_t EventManager::GetTimeOfNextSchedulerRun(
     if (cur_scheduler_runtime == 0) {
       // The scheduler didn't have anything to do.
       // Only run it after the next event that can change task placement.
-      for (auto& time_event : events_) {
-        if (time_event.second.type() == EventDescriptor::TASK_SUBMIT ||
-            time_event.second.type() == EventDescriptor::REMOVE_MACHINE ||
-            time_event.second.type() == EventDescriptor::ADD_MACHINE ||
-            time_event.second.type() == EventDescriptor::TASK_END_RUNTIME) {
-          return time_event.first;
-        }
+      PopRemovedEvents(&placement_events_);
+      if (placement_events_.empty()) {
+        // There's no event left that requires a scheduler run.
+        return UINT64_MAX;
       }
-      // There's no event left that requires a scheduler run.
-      return UINT64_MAX;
+      return placement_events_.front().timestamp;
     }
   } else {
     // We're in batch mode.
@@ -141,27 +205,158 @@ bool EventManager::HasSimulationCompleted(uint64_t num_scheduling_rounds) {
               << " scheduling rounds.";
     return true;
   }
-  return events_.begin() == events_.end();
+  return num_events_ == 0;
+}
+
+bool EventManager::IsPlacementRelevant(EventDescriptor::EventType type) {
+  return type == EventDescriptor::TASK_SUBMIT ||
+    type == EventDescriptor::REMOVE_MACHINE ||
+    type == EventDescriptor::ADD_MACHINE ||
+    type == EventDescriptor::TASK_END_RUNTIME;
+}
+
+void EventManager::PopRemovedEvents(vector<EventHeapEntry>* heap) {
+  while (!heap->empty() && !IsLive(heap->front())) {
+    PopEvent(heap);
+  }
+}
+
+vector<EventManager::EventHeapEntry>* EventManager::NextEventHeap() {
+  PopRemovedEvents(&placement_events_);
+  PopRemovedEvents(&other_events_);
+  if (placement_events_.empty()) {
+    return other_events_.empty() ? NULL : &other_events_;
+  }
+  if (other_events_.empty() ||
+      EventHeapEntryLess()(placement_events_.front(),
+                           other_events_.front())) {
+    return &placement_events_;
+  }
+  return &other_events_;
+}
+
+void EventManager::PopEvent(vector<EventHeapEntry>* heap) {
+  EventHeapEntry entry = heap->back();
+  heap->pop_back();
+  uint64_t size = heap->size();
+  if (size == 0) {
+    return;
+  }
+  EventHeapEntryLess less;
+  uint64_t index = 0;
+  while (true) {
+    uint64_t first_child = kEventHeapArity * index + 1;
+    if (first_child >= size) {
+      break;
+    }
+    uint64_t last_child = min(first_child + kEventHeapArity, size);
+    uint64_t min_child = first_child;
+    for (uint64_t child = first_child + 1; child < last_child; ++child) {
+      if (less((*heap)[child], (*heap)[min_child])) {
+        min_child = child;
+      }
+    }
+    if (!less((*heap)[min_child], entry)) {
+      break;
+    }
+    (*heap)[index] = (*heap)[min_child];
+    index = min_child;
+  }
+  (*heap)[index] = entry;
+}
+
+void EventManager::PushEvent(const EventHeapEntry& entry,
+                             vector<EventHeapEntry>* heap) {
+  EventHeapEntryLess less;
+  uint64_t index = heap->size();
+  heap->push_back(entry);
+  while (index > 0) {
+    uint64_t parent = (index - 1) / kEventHeapArity;
+    if (!less(entry, (*heap)[parent])) {
+      break;
+    }
+    (*heap)[index] = (*heap)[parent];
+    index = parent;
+  }
+  (*heap)[index] = entry;
+}
+
+void EventManager::RemoveStaleTaskEndEvents() {
+  for (auto it = task_end_events_.begin(); it != task_end_events_.end();) {
+    if (IsLive(it->second)) {
+      ++it;
+    } else {
+      it = task_end_events_.erase(it);
+    }
+  }
 }
 
 void EventManager::RemoveTaskEndRuntimeEvent(
     const TraceTaskIdentifier& task_identifier,
     uint64_t task_end_time) {
-  // Remove the task end time event from the simulator events_.
-  pair<multimap<uint64_t, EventDescriptor>::iterator,
-       multimap<uint64_t, EventDescriptor>::iterator> range_it =
-    events_.equal_range(task_end_time);
-  for (; range_it.first != range_it.second; range_it.first++) {
-    if (range_it.first->second.type() == EventDescriptor::TASK_END_RUNTIME &&
-        range_it.first->second.job_id() == task_identifier.job_id &&
-        range_it.first->second.task_index() == task_identifier.task_index) {
-      break;
+  // Remove the task end time event from the simulator events. If there are
+  // several end events for the task at task_end_time, we remove the one
+  // that was added first. The event's heap entries are dropped lazily.
+  auto range_it = task_end_events_.equal_range(task_identifier);
+  auto event_it = range_it.second;
+  while (range_it.first != range_it.second) {
+    const EventHeapEntry& entry = range_it.first->second;
+    if (!IsLive(entry)) {
+      range_it.first = task_end_events_.erase(range_it.first);
+      continue;
+    }
+    if (entry.timestamp == task_end_time &&
+        (event_it == range_it.second ||
+         entry.sequence < event_it->second.sequence)) {
+      event_it = range_it.first;
     }
+    ++range_it.first;
   }
   // We've found the event.
-  if (range_it.first != range_it.second) {
-    events_.erase(range_it.first);
+  if (event_it != range_it.second) {
+    uint32_t slot = event_it->second.slot;
+    task_end_events_.erase(event_it);
+    FreeSlot(slot);
+  }
+}
+
+void EventManager::RestoreCheckpoint(const SimulationCheckpoint& checkpoint) {
+  placement_events_.clear();
+  other_events_.clear();
+  event_slots_.clear();
+  event_sequences_.clear();
+  free_slots_.clear();
+  task_end_events_.clear();
+  num_events_ = 0;
+  num_task_end_events_ = 0;
+  // The events are added in processing order, and thus get sequence numbers
+  // that keep the order of events with the same timestamp.
+  for (auto& checkpoint_event : checkpoint.events()) {
+    AddEvent(checkpoint_event.timestamp(), checkpoint_event.event());
+  }
+  num_events_processed_ = checkpoint.num_events_processed();
+}
+
+void EventManager::SaveCheckpoint(SimulationCheckpoint* checkpoint) {
+  vector<EventHeapEntry> entries;
+  entries.reserve(num_events_);
+  for (auto& entry : placement_events_) {
+    if (IsLive(entry)) {
+      entries.push_back(entry);
+    }
+  }
+  for (auto& entry : other_events_) {
+    if (IsLive(entry)) {
+      entries.push_back(entry);
+    }
+  }
+  sort(entries.begin(), entries.end(), EventHeapEntryLess());
+  for (auto& entry : entries) {
+    CheckpointEvent* checkpoint_event = checkpoint->add_events();
+    checkpoint_event->set_timestamp(entry.timestamp);
+    GetSlotEvent(entry.slot, checkpoint_event->mutable_event());
   }
+  checkpoint->set_num_events_processed(num_events_processed_);
 }
 
 } // namespace sim
@@ -21,13 +21,15 @@
 #ifndef FIRMAMENT_SIM_EVENT_MANAGER_H
 #define FIRMAMENT_SIM_EVENT_MANAGER_H
 
-#include <map>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "base/common.h"
 #include "misc/time_interface.h"
 #include "sim/event_desc.pb.h"
 #include "sim/simulated_wall_time.h"
+#include "sim/simulation_checkpoint.pb.h"
 #include "sim/trace_utils.h"
 
 namespace firmament {
@@ -80,11 +82,99 @@ class EventManager {
   void RemoveTaskEndRuntimeEvent(const TraceTaskIdentifier& task_identifier,
                                  uint64_t task_end_time);
 
+  /**
+   * Replaces the pending events with the events saved in a checkpoint.
+   * @param checkpoint the checkpoint to restore the events from
+   */
+  void RestoreCheckpoint(const SimulationCheckpoint& checkpoint);
+
+  /**
+   * Saves the pending events to a checkpoint, in the order in which they
+   * are going to be processed.
+   * @param checkpoint the checkpoint to save the events to
+   */
+  void SaveCheckpoint(SimulationCheckpoint* checkpoint);
+
  private:
+  // Compact copy of an EventDescriptor and of its timestamp.
+  struct SimulatorEvent {
+    uint64_t timestamp;
+    uint64_t machine_id;
+    uint64_t job_id;
+    uint64_t task_index;
+    uint64_t requested_ram;
+    float requested_cpu_cores;
+    uint32_t priority;
+    uint32_t scheduling_class;
+    EventDescriptor::EventType type;
+  };
+  // Entry of the event heaps. Events with the same timestamp are ordered by
+  // sequence number, so that they are returned in the order they were added.
+  struct EventHeapEntry {
+    uint64_t timestamp;
+    uint64_t sequence;
+    uint32_t slot;
+  };
+  struct EventHeapEntryLess {
+    bool operator()(const EventHeapEntry& lhs,
+                    const EventHeapEntry& rhs) const {
+      return lhs.timestamp < rhs.timestamp ||
+        (lhs.timestamp == rhs.timestamp && lhs.sequence < rhs.sequence);
+    }
+  };
+  // The event heaps are 4-ary heaps, which are shallower than binary heaps
+  // and touch fewer cache lines when an event is popped.
+  static const uint64_t kEventHeapArity = 4;
+
+  /**
+   * Returns true if the event can change task placements, i.e., the
+   * scheduler has to run after it.
+   */
+  static bool IsPlacementRelevant(EventDescriptor::EventType type);
+  // Returns true if the entry refers to an event that has not been removed.
+  inline bool IsLive(const EventHeapEntry& entry) const {
+    return event_sequences_[entry.slot] == entry.sequence;
+  }
+  // Removes the event stored in the slot.
+  void FreeSlot(uint32_t slot);
+  // Copies the event stored in the slot to an EventDescriptor.
+  void GetSlotEvent(uint32_t slot, EventDescriptor* event) const;
+  /**
+   * Returns the heap whose top entry is the next event, or NULL if there
+   * are no events left.
+   */
+  vector<EventHeapEntry>* NextEventHeap();
+  // Removes the top entry of a heap.
+  void PopEvent(vector<EventHeapEntry>* heap);
+  // Pops the removed events off the top of a heap.
+  void PopRemovedEvents(vector<EventHeapEntry>* heap);
+  void PushEvent(const EventHeapEntry& entry, vector<EventHeapEntry>* heap);
+  // Removes the entries of the events that have been processed from
+  // task_end_events_.
+  void RemoveStaleTaskEndEvents();
+
   SimulatedWallTime* simulated_time_;
-  // The map storing the simulator events. Maps from timestamp to simulator
-  // event.
-  multimap<uint64_t, EventDescriptor> events_;
+  // Min-heaps of the events that can change task placements and of the
+  // other events, ordered by timestamp. Removed events are left in the heaps
+  // and skipped once they reach the top.
+  vector<EventHeapEntry> placement_events_;
+  vector<EventHeapEntry> other_events_;
+  // The events are stored in slots that are reused once an event is removed.
+  // event_sequences_ holds the sequence number of the event in each slot, or
+  // UINT64_MAX if the slot is free.
+  vector<SimulatorEvent> event_slots_;
+  vector<uint64_t> event_sequences_;
+  vector<uint32_t> free_slots_;
+  // Heap entries of the task end events of each task. The entries of the
+  // processed events are removed lazily, when the multimap has grown to twice
+  // the number of pending task end events.
+  unordered_multimap<TraceTaskIdentifier, EventHeapEntry,
+                     TraceTaskIdentifierHasher> task_end_events_;
+  uint64_t next_sequence_;
+  // Number of events that have not been processed or removed.
+  uint64_t num_events_;
+  // Number of task end events that have not been processed or removed.
+  uint64_t num_task_end_events_;
   uint64_t num_events_processed_;
 };
 
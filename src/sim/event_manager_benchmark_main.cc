@@ -0,0 +1,195 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Microbenchmark for the simulator's event manager. It replays a synthetic
+// workload in which machines send periodic heartbeats, and every task
+// submission schedules the task's end event and the next submission. A
+// fraction of the tasks are preempted, which removes their end events. After
+// each event, the benchmark asks for the next scheduler run as the simulator
+// does in online mode. Run it with --online_factor set, as the simulator.
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <boost/timer/timer.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/common.h"
+#include "sim/event_desc.pb.h"
+#include "sim/event_manager.h"
+#include "sim/simulated_wall_time.h"
+#include "sim/trace_utils.h"
+
+DEFINE_uint64(benchmark_events, 100000000,
+              "Number of events to process.");
+DEFINE_uint64(benchmark_machines, 12000,
+              "Number of machines that send heartbeats.");
+DEFINE_uint64(benchmark_heartbeat_interval, 1000000,
+              "Interval between two heartbeats of a machine (in "
+              "microseconds).");
+DEFINE_uint64(benchmark_pending_tasks, 500000,
+              "Number of task submissions pending at any time.");
+DEFINE_uint64(benchmark_max_task_delay, 10000000,
+              "Maximum task runtime and interval between two submissions "
+              "(in microseconds).");
+DEFINE_double(benchmark_preemption_fraction, 0.05,
+              "Fraction of the task submissions that preempt a running task.");
+DEFINE_string(scheduler, "flow", "Scheduler flag used by the simulator.");
+
+namespace firmament {
+namespace sim {
+
+class EventManagerBenchmark {
+ public:
+  EventManagerBenchmark()
+    : event_manager_(new EventManager(&simulated_time_)),
+      num_tasks_(0) {
+    srand(42);
+  }
+
+  ~EventManagerBenchmark() {
+    delete event_manager_;
+  }
+
+  void Run() {
+    uint64_t base_rss = ResidentBytes();
+    boost::timer::cpu_timer timer;
+    AddInitialEvents();
+    Report("add initial events", &timer);
+    timer.start();
+    uint64_t num_events = ReplayEvents();
+    Report("replay " + to_string(num_events) + " events", &timer);
+    LOG(INFO) << "Processed "
+              << num_events * 1000000000 / (timer.elapsed().wall + 1)
+              << " events/s, resident memory: "
+              << (ResidentBytes() - base_rss) / (1024 * 1024) << " MB";
+    timer.start();
+    delete event_manager_;
+    event_manager_ = NULL;
+    Report("teardown", &timer);
+  }
+
+ private:
+  void AddInitialEvents() {
+    EventDescriptor event_desc;
+    event_desc.set_type(EventDescriptor::MACHINE_HEARTBEAT);
+    for (uint64_t machine = 0; machine < FLAGS_benchmark_machines; ++machine) {
+      event_desc.set_machine_id(machine);
+      event_manager_->AddEvent(rand() % FLAGS_benchmark_heartbeat_interval,
+                               event_desc);
+    }
+    for (uint64_t task = 0; task < FLAGS_benchmark_pending_tasks; ++task) {
+      AddTaskSubmit(0);
+    }
+    running_tasks_.resize(FLAGS_benchmark_pending_tasks);
+  }
+
+  void AddTaskSubmit(uint64_t current_time) {
+    EventDescriptor event_desc;
+    event_desc.set_type(EventDescriptor::TASK_SUBMIT);
+    event_desc.set_job_id(num_tasks_ / 100);
+    event_desc.set_task_index(num_tasks_ % 100);
+    event_desc.set_requested_cpu_cores(0.5);
+    event_desc.set_requested_ram(1024);
+    num_tasks_++;
+    event_manager_->AddEvent(current_time + TaskDelay(), event_desc);
+  }
+
+  uint64_t ReplayEvents() {
+    uint64_t num_events = 0;
+    for (; num_events < FLAGS_benchmark_events; ++num_events) {
+      pair<uint64_t, EventDescriptor> time_event =
+        event_manager_->GetNextEvent();
+      uint64_t current_time = time_event.first;
+      EventDescriptor* event_desc = &time_event.second;
+      if (event_desc->type() == EventDescriptor::MACHINE_HEARTBEAT) {
+        event_manager_->AddEvent(
+            current_time + FLAGS_benchmark_heartbeat_interval, *event_desc);
+      } else if (event_desc->type() == EventDescriptor::TASK_SUBMIT) {
+        PreemptTask();
+        // Replace the running task that was started the longest time ago.
+        pair<TraceTaskIdentifier, uint64_t>* running_task =
+          &running_tasks_[num_events % running_tasks_.size()];
+        running_task->first.job_id = event_desc->job_id();
+        running_task->first.task_index = event_desc->task_index();
+        running_task->second = current_time + TaskDelay();
+        event_desc->set_type(EventDescriptor::TASK_END_RUNTIME);
+        event_manager_->AddEvent(running_task->second, *event_desc);
+        AddTaskSubmit(current_time);
+      }
+      event_manager_->GetTimeOfNextSchedulerRun(current_time, 0);
+    }
+    return num_events;
+  }
+
+  void PreemptTask() {
+    if (rand() >= FLAGS_benchmark_preemption_fraction * RAND_MAX) {
+      return;
+    }
+    // The task may have already finished, in which case its end event
+    // is not found.
+    pair<TraceTaskIdentifier, uint64_t>& running_task =
+      running_tasks_[rand() % running_tasks_.size()];
+    event_manager_->RemoveTaskEndRuntimeEvent(running_task.first,
+                                              running_task.second);
+  }
+
+  void Report(const string& phase, boost::timer::cpu_timer* timer) {
+    timer->stop();
+    LOG(INFO) << phase << ": " << timer->elapsed().wall / 1000000 << " ms";
+  }
+
+  uint64_t ResidentBytes() {
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+      if (fscanf(statm, "%ju %ju", &size, &resident) != 2) {
+        resident = 0;
+      }
+      fclose(statm);
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+  }
+
+  uint64_t TaskDelay() {
+    return 1 + rand() % FLAGS_benchmark_max_task_delay;
+  }
+
+  SimulatedWallTime simulated_time_;
+  EventManager* event_manager_;
+  uint64_t num_tasks_;
+  // Identifiers and end times of recently started tasks.
+  vector<pair<TraceTaskIdentifier, uint64_t>> running_tasks_;
+};
+
+}  // namespace sim
+}  // namespace firmament
+
+int main(int argc, char *argv[]) {
+  firmament::common::InitFirmament(argc, argv);
+  FLAGS_logtostderr = true;
+  firmament::sim::EventManagerBenchmark benchmark;
+  benchmark.Run();
+  return 0;
+}
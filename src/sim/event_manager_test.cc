@@ -99,6 +99,134 @@ TEST(EventManagerTest, RemoveTaskEndRuntimeEvent) {
   CHECK_EQ(event_manager.GetTimeOfNextEvent(), UINT64_MAX);
 }
 
+TEST(EventManagerTest, GetNextEventInInsertionOrder) {
+  SimulatedWallTime simulated_time;
+  EventManager event_manager(&simulated_time);
+  EventDescriptor event_desc;
+  event_desc.set_type(EventDescriptor::TASK_SUBMIT);
+  event_desc.set_job_id(1);
+  for (uint64_t task_index = 0; task_index < 10; ++task_index) {
+    event_desc.set_task_index(task_index);
+    event_manager.AddEvent(5 - task_index % 2, event_desc);
+  }
+  // Events with the same timestamp are returned in the order they were added.
+  for (uint64_t task_index = 1; task_index < 10; task_index += 2) {
+    pair<uint64_t, EventDescriptor> time_event = event_manager.GetNextEvent();
+    CHECK_EQ(time_event.first, 4);
+    CHECK_EQ(time_event.second.task_index(), task_index);
+  }
+  for (uint64_t task_index = 0; task_index < 10; task_index += 2) {
+    pair<uint64_t, EventDescriptor> time_event = event_manager.GetNextEvent();
+    CHECK_EQ(time_event.first, 5);
+    CHECK_EQ(time_event.second.task_index(), task_index);
+  }
+  CHECK_EQ(event_manager.GetTimeOfNextEvent(), UINT64_MAX);
+}
+
+TEST(EventManagerTest, RemoveTaskEndRuntimeEventReusesSlot) {
+  SimulatedWallTime simulated_time;
+  EventManager event_manager(&simulated_time);
+  EventDescriptor event_desc;
+  event_desc.set_type(EventDescriptor::TASK_END_RUNTIME);
+  event_desc.set_job_id(1);
+  event_desc.set_task_index(1);
+  event_manager.AddEvent(2, event_desc);
+  TraceTaskIdentifier task_identifier;
+  task_identifier.job_id = 1;
+  task_identifier.task_index = 1;
+  // The end time does not match.
+  event_manager.RemoveTaskEndRuntimeEvent(task_identifier, 3);
+  CHECK_EQ(event_manager.GetTimeOfNextEvent(), 2);
+  event_manager.RemoveTaskEndRuntimeEvent(task_identifier, 2);
+  CHECK_EQ(event_manager.GetTimeOfNextEvent(), UINT64_MAX);
+  CHECK(event_manager.HasSimulationCompleted(0));
+  // The new event must not be hidden by the removed one.
+  event_desc.set_task_index(2);
+  event_manager.AddEvent(7, event_desc);
+  CHECK_EQ(event_manager.GetTimeOfNextEvent(), 7);
+  pair<uint64_t, EventDescriptor> time_event = event_manager.GetNextEvent();
+  CHECK_EQ(time_event.first, 7);
+  CHECK_EQ(time_event.second.job_id(), 1);
+  CHECK_EQ(time_event.second.task_index(), 2);
+  CHECK(event_manager.HasSimulationCompleted(0));
+}
+
+TEST(EventManagerTest, GetTimeOfNextSchedulerRun) {
+  SimulatedWallTime simulated_time;
+  EventManager event_manager(&simulated_time);
+  EventDescriptor event_desc;
+  event_desc.set_type(EventDescriptor::MACHINE_HEARTBEAT);
+  event_manager.AddEvent(1, event_desc);
+  event_desc.set_type(EventDescriptor::TASK_END_RUNTIME);
+  event_desc.set_job_id(1);
+  event_desc.set_task_index(1);
+  event_manager.AddEvent(3, event_desc);
+  event_desc.set_type(EventDescriptor::TASK_SUBMIT);
+  event_manager.AddEvent(5, event_desc);
+  // Heartbeats do not change task placements.
+  CHECK_EQ(event_manager.GetTimeOfNextSchedulerRun(0, 0), 3);
+  TraceTaskIdentifier task_identifier;
+  task_identifier.job_id = 1;
+  task_identifier.task_index = 1;
+  event_manager.RemoveTaskEndRuntimeEvent(task_identifier, 3);
+  CHECK_EQ(event_manager.GetTimeOfNextSchedulerRun(0, 0), 5);
+  CHECK_EQ(event_manager.GetNextEvent().first, 1);
+  CHECK_EQ(event_manager.GetNextEvent().first, 5);
+  CHECK_EQ(event_manager.GetTimeOfNextSchedulerRun(0, 0), UINT64_MAX);
+}
+
+TEST(EventManagerTest, SaveAndRestoreCheckpoint) {
+  SimulatedWallTime simulated_time;
+  EventManager event_manager(&simulated_time);
+  EventDescriptor event_desc;
+  event_desc.set_job_id(1);
+  event_desc.set_type(EventDescriptor::MACHINE_HEARTBEAT);
+  event_manager.AddEvent(20, event_desc);
+  event_desc.set_type(EventDescriptor::TASK_END_RUNTIME);
+  for (uint64_t task_index = 0; task_index < 4; ++task_index) {
+    event_desc.set_task_index(task_index);
+    event_manager.AddEvent(20, event_desc);
+  }
+  event_desc.set_type(EventDescriptor::TASK_SUBMIT);
+  event_desc.set_task_index(4);
+  event_desc.set_requested_ram(128);
+  event_manager.AddEvent(10, event_desc);
+  // Removed and processed events are not saved.
+  TraceTaskIdentifier task_identifier;
+  task_identifier.job_id = 1;
+  task_identifier.task_index = 1;
+  event_manager.RemoveTaskEndRuntimeEvent(task_identifier, 20);
+  event_manager.GetNextEvent();
+  SimulationCheckpoint checkpoint;
+  event_manager.SaveCheckpoint(&checkpoint);
+  CHECK_EQ(checkpoint.events_size(), 4);
+  CHECK_EQ(checkpoint.num_events_processed(), 1);
+
+  SimulatedWallTime restored_time;
+  EventManager restored(&restored_time);
+  event_desc.set_type(EventDescriptor::ADD_MACHINE);
+  restored.AddEvent(0, event_desc);
+  // Restoring replaces the events.
+  restored.RestoreCheckpoint(checkpoint);
+  pair<uint64_t, EventDescriptor> time_event = restored.GetNextEvent();
+  CHECK_EQ(time_event.first, 20);
+  CHECK_EQ(time_event.second.type(), EventDescriptor::MACHINE_HEARTBEAT);
+  for (uint64_t task_index : {0, 2, 3}) {
+    time_event = restored.GetNextEvent();
+    CHECK_EQ(time_event.first, 20);
+    CHECK_EQ(time_event.second.type(), EventDescriptor::TASK_END_RUNTIME);
+    CHECK_EQ(time_event.second.task_index(), task_index);
+  }
+  CHECK_EQ(restored.GetTimeOfNextEvent(), UINT64_MAX);
+  // The index of the task end events has been restored too.
+  restored.RestoreCheckpoint(checkpoint);
+  task_identifier.task_index = 2;
+  restored.RemoveTaskEndRuntimeEvent(task_identifier, 20);
+  SimulationCheckpoint removed_checkpoint;
+  restored.SaveCheckpoint(&removed_checkpoint);
+  CHECK_EQ(removed_checkpoint.events_size(), 3);
+}
+
 } // namespace sim
 } // namespace firmament
 
@@ -28,11 +28,14 @@
 #include <unordered_map>
 #include <vector>
 
+#include <boost/thread.hpp>
+
 #include "base/common.h"
 #include "base/resource_topology_node_desc.pb.h"
 #include "misc/map-util.h"
 #include "sim/event_desc.pb.h"
 #include "sim/event_manager.h"
+#include "sim/mapped_csv_file.h"
 #include "sim/trace_loader.h"
 #include "sim/trace_utils.h"
 
@@ -75,14 +78,81 @@ class GoogleTraceLoader : public TraceLoader {
   void LoadTasksRunningTime(
       unordered_map<TaskID_t, uint64_t>* task_runtime);
 
- private:
+  void RestoreTaskEventsPosition(const TraceLoaderPosition& position);
+  void SaveTaskEventsPosition(TraceLoaderPosition* position);
+
+ protected:
+  /**
+   * Adds the submit events of the synthetic job's tasks, unless they have
+   * already been added.
+   */
+  void AddSyntheticTaskEvents();
+  /**
+   * Adds a task submit event from the trace to the event manager.
+   * @param timestamp the simulation timestamp of the event
+   * @param task_id the trace identifier of the task
+   * @param scheduling_class the scheduling class of the task
+   * @param priority the priority of the task
+   * @param cpu_request the CPU request, normalized to the largest machine
+   * @param ram_request the RAM request, normalized to the largest machine
+   */
+  void AddTaskSubmitEvent(uint64_t timestamp,
+                          const TraceTaskIdentifier& task_id,
+                          uint32_t scheduling_class, uint32_t priority,
+                          float cpu_request, double ram_request);
+  /**
+   * Excludes a task from the replay. Its job is accounted for as if the task
+   * had been sub-sampled out of the trace.
+   * @param task_id the trace identifier of the task
+   * @param job_num_tasks map containing the number of tasks each job has
+   */
+  void ExcludeTask(const TraceTaskIdentifier& task_id,
+                   unordered_map<uint64_t, uint64_t>* job_num_tasks);
+  /**
+   * Checks if a task is sub-sampled out of the trace or has been excluded.
+   * The first time a task is filtered, the number of tasks its job has is
+   * decremented.
+   * @param task_id the trace identifier of the task
+   * @param job_num_tasks map containing the number of tasks each job has
+   * @return true if the task's events must be skipped
+   */
+  bool FilterTask(const TraceTaskIdentifier& task_id,
+                  unordered_map<uint64_t, uint64_t>* job_num_tasks);
+  void LoadSyntheticJobNumTasks(
+      unordered_map<uint64_t, uint64_t>* job_num_tasks);
+  void LoadSyntheticTasksRunningTime(
+      unordered_map<TaskID_t, uint64_t>* task_runtime);
+  void LoadSyntheticTaskUtilizationStats(
+      unordered_map<TaskID_t, TraceTaskStats>* task_id_to_stats);
   uint64_t MaxEventHashToRetain();
   uint64_t MaxMachineEventHashToRetain();
+  /**
+   * Restores the state shared by the CSV and the binary trace loaders, i.e.,
+   * the synthetic task and the filtered tasks.
+   */
+  void RestoreFilterState(const TraceLoaderPosition& position);
+  void SaveFilterState(TraceLoaderPosition* position);
+
+ private:
+  /**
+   * Makes the task events file with the given id the current one, and starts
+   * prefetching the file after it on a background thread.
+   * @param file_id the id of the task events file to open
+   */
+  void OpenTaskEventsFile(int32_t file_id);
+  void StartPrefetchingTaskEventsFile(int32_t file_id);
+  string TaskEventsFileName(int32_t file_id);
 
   // The number of the task events file the simulator is reading from.
   int32_t current_task_events_file_id_;
-  // File from which to read the task events.
-  FILE* task_events_file_;
+  // File from which to read the task events. NULL if no file is open.
+  MappedCSVFile* task_events_file_;
+  // The task events file after the current one, which prefetch_thread_ maps
+  // and faults into memory while the current one is being read.
+  MappedCSVFile* next_task_events_file_;
+  boost::thread* prefetch_thread_;
+  // Fields of the row that is being parsed.
+  vector<CSVField> fields_;
   // The first time we encounter a filtered task we must update the number of
   // tasks its corresponding job has. However, upon subsequent encounters we do
   // not have to do that. We use this collection to maintain a set of tasks
@@ -0,0 +1,177 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "sim/mapped_csv_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+
+// Fields longer than this cannot be numbers we care about.
+#define MAX_NUMERIC_FIELD_LENGTH 64
+
+namespace firmament {
+namespace sim {
+
+MappedCSVFile::MappedCSVFile()
+  : open_(false), data_(NULL), size_(0), position_(0), line_number_(0) {
+}
+
+MappedCSVFile::~MappedCSVFile() {
+  Close();
+}
+
+void MappedCSVFile::Close() {
+  if (data_ != NULL) {
+    CHECK_EQ(munmap(const_cast<char*>(data_), size_), 0);
+  }
+  open_ = false;
+  data_ = NULL;
+  size_ = 0;
+  position_ = 0;
+  line_number_ = 0;
+}
+
+bool MappedCSVFile::Open(const string& file_name) {
+  Close();
+  file_name_ = file_name;
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    PLOG(ERROR) << "Could not open " << file_name;
+    return false;
+  }
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0);
+  size_ = static_cast<uint64_t>(st.st_size);
+  if (size_ > 0) {
+    void* data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      PLOG(ERROR) << "Could not map " << file_name;
+      CHECK_EQ(close(fd), 0);
+      size_ = 0;
+      return false;
+    }
+    // The file is read front to back exactly once.
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = reinterpret_cast<const char*>(data);
+  }
+  CHECK_EQ(close(fd), 0);
+  open_ = true;
+  return true;
+}
+
+bool MappedCSVFile::NextRow(vector<CSVField>* fields) {
+  fields->clear();
+  const char* end = data_ + size_;
+  while (position_ < size_) {
+    const char* line = data_ + position_;
+    // memchr is vectorized in libc, which makes it much faster than scanning
+    // byte by byte for the delimiters.
+    const char* line_end = reinterpret_cast<const char*>(
+        memchr(line, '\n', end - line));
+    if (line_end == NULL) {
+      line_end = end;
+    }
+    position_ = line_end - data_ + 1;
+    line_number_++;
+    if (line_end == line) {
+      // Skip empty lines.
+      continue;
+    }
+    const char* field = line;
+    while (true) {
+      const char* field_end = reinterpret_cast<const char*>(
+          memchr(field, ',', line_end - field));
+      if (field_end == NULL) {
+        fields->push_back(CSVField{field,
+              static_cast<uint64_t>(line_end - field)});
+        break;
+      }
+      fields->push_back(CSVField{field,
+            static_cast<uint64_t>(field_end - field)});
+      field = field_end + 1;
+    }
+    return true;
+  }
+  return false;
+}
+
+void MappedCSVFile::Prefetch() {
+  if (data_ == NULL) {
+    return;
+  }
+  madvise(const_cast<char*>(data_), size_, MADV_WILLNEED);
+  // MADV_WILLNEED only starts the read-ahead; touching every page makes sure
+  // that the page faults are taken on the calling thread.
+  long page_size = sysconf(_SC_PAGESIZE);
+  volatile char sink = 0;
+  for (uint64_t offset = 0; offset < size_; offset += page_size) {
+    sink += data_[offset];
+  }
+}
+
+void MappedCSVFile::Seek(uint64_t position, uint64_t line_number) {
+  CHECK_LE(position, size_ + 1);
+  position_ = position;
+  line_number_ = line_number;
+}
+
+bool MappedCSVFile::ParseUInt64(const CSVField& field, uint64_t* value) {
+  if (field.size == 0) {
+    return false;
+  }
+  uint64_t result = 0;
+  for (uint64_t i = 0; i < field.size; ++i) {
+    uint64_t digit = static_cast<uint64_t>(field.data[i] - '0');
+    if (digit > 9) {
+      return false;
+    }
+    if (result > (UINT64_MAX - digit) / 10) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+  *value = result;
+  return true;
+}
+
+bool MappedCSVFile::ParseDouble(const CSVField& field, double* value) {
+  if (field.size == 0 || field.size >= MAX_NUMERIC_FIELD_LENGTH) {
+    return false;
+  }
+  // strtod needs a NUL-terminated string, and the mapped field is not one.
+  char buffer[MAX_NUMERIC_FIELD_LENGTH];
+  memcpy(buffer, field.data, field.size);
+  buffer[field.size] = '\0';
+  char* parsed_end;
+  double result = strtod(buffer, &parsed_end);
+  if (parsed_end != buffer + field.size) {
+    return false;
+  }
+  *value = result;
+  return true;
+}
+
+}  // namespace sim
+}  // namespace firmament
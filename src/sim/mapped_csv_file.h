@@ -0,0 +1,113 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Memory-mapped CSV file reader. Rows are split into fields in place, without
+// copying them out of the mapping.
+
+#ifndef FIRMAMENT_SIM_MAPPED_CSV_FILE_H
+#define FIRMAMENT_SIM_MAPPED_CSV_FILE_H
+
+#include <string>
+#include <vector>
+
+#include "base/common.h"
+
+namespace firmament {
+namespace sim {
+
+// A field of a CSV row. It points into the mapped file and is only valid
+// while the file is open.
+struct CSVField {
+  const char* data;
+  uint64_t size;
+};
+
+class MappedCSVFile {
+ public:
+  MappedCSVFile();
+  ~MappedCSVFile();
+  void Close();
+  inline const string& file_name() const {
+    return file_name_;
+  }
+  inline bool is_open() const {
+    return open_;
+  }
+  /**
+   * Returns the 1-based number of the line the last row was read from.
+   */
+  inline uint64_t line_number() const {
+    return line_number_;
+  }
+  /**
+   * Returns the offset of the first byte that has not been read yet.
+   */
+  inline uint64_t position() const {
+    return position_;
+  }
+  /**
+   * Maps a file into memory.
+   * @param file_name the path of the file to map
+   * @return false if the file could not be opened or mapped
+   */
+  bool Open(const string& file_name);
+  /**
+   * Reads the next non-empty row of the file.
+   * @param fields vector that gets populated with the fields of the row
+   * @return false if there are no rows left
+   */
+  bool NextRow(vector<CSVField>* fields);
+  /**
+   * Faults the whole file into memory. This is meant to be called from a
+   * background thread while another file is being read.
+   */
+  void Prefetch();
+  /**
+   * Continues reading from an offset returned by position().
+   * @param position the offset of the next row to read
+   * @param line_number the number of the line the row before it was read from
+   */
+  void Seek(uint64_t position, uint64_t line_number);
+
+  /**
+   * Parses an unsigned decimal integer field.
+   * @return false if the field is empty, not a number, or overflows
+   */
+  static bool ParseUInt64(const CSVField& field, uint64_t* value);
+  /**
+   * Parses a floating point field.
+   * @return false if the field is empty or not a number
+   */
+  static bool ParseDouble(const CSVField& field, double* value);
+
+ private:
+  string file_name_;
+  bool open_;
+  const char* data_;
+  uint64_t size_;
+  // Offset of the first byte that has not been read yet.
+  uint64_t position_;
+  uint64_t line_number_;
+};
+
+}  // namespace sim
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SIM_MAPPED_CSV_FILE_H
@@ -0,0 +1,132 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Tests for the memory-mapped CSV file reader.
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "sim/mapped_csv_file.h"
+
+// The simulator objects that the test links with expect this flag.
+DEFINE_string(scheduler, "flow", "The scheduler to use for tests.");
+
+namespace firmament {
+namespace sim {
+
+class MappedCSVFileTest : public ::testing::Test {
+ protected:
+  MappedCSVFileTest() {
+    char file_name[] = "/tmp/mapped_csv_file_test_XXXXXX";
+    int fd = mkstemp(file_name);
+    CHECK_GE(fd, 0);
+    close(fd);
+    file_name_ = file_name;
+  }
+
+  virtual ~MappedCSVFileTest() {
+    unlink(file_name_.c_str());
+  }
+
+  void WriteFile(const string& contents) {
+    FILE* file = fopen(file_name_.c_str(), "w");
+    CHECK_NOTNULL(file);
+    fwrite(contents.data(), 1, contents.size(), file);
+    fclose(file);
+  }
+
+  string FieldToString(const CSVField& field) {
+    return string(field.data, field.size);
+  }
+
+  string file_name_;
+};
+
+TEST_F(MappedCSVFileTest, ReadRows) {
+  WriteFile("1,a,,2.5\n\n\n3,b,c,\n4");
+  MappedCSVFile file;
+  ASSERT_TRUE(file.Open(file_name_));
+  vector<CSVField> fields;
+  ASSERT_TRUE(file.NextRow(&fields));
+  ASSERT_EQ(fields.size(), 4);
+  EXPECT_EQ(FieldToString(fields[0]), "1");
+  EXPECT_EQ(FieldToString(fields[1]), "a");
+  EXPECT_EQ(FieldToString(fields[2]), "");
+  EXPECT_EQ(FieldToString(fields[3]), "2.5");
+  EXPECT_EQ(file.line_number(), 1);
+  // Empty lines are skipped.
+  ASSERT_TRUE(file.NextRow(&fields));
+  ASSERT_EQ(fields.size(), 4);
+  EXPECT_EQ(FieldToString(fields[2]), "c");
+  EXPECT_EQ(FieldToString(fields[3]), "");
+  EXPECT_EQ(file.line_number(), 4);
+  // The last line does not end with a newline.
+  ASSERT_TRUE(file.NextRow(&fields));
+  ASSERT_EQ(fields.size(), 1);
+  EXPECT_EQ(FieldToString(fields[0]), "4");
+  EXPECT_FALSE(file.NextRow(&fields));
+  EXPECT_TRUE(fields.empty());
+}
+
+TEST_F(MappedCSVFileTest, EmptyAndMissingFiles) {
+  WriteFile("");
+  MappedCSVFile file;
+  ASSERT_TRUE(file.Open(file_name_));
+  file.Prefetch();
+  vector<CSVField> fields;
+  EXPECT_FALSE(file.NextRow(&fields));
+  EXPECT_FALSE(file.Open(file_name_ + "_missing"));
+  EXPECT_FALSE(file.is_open());
+}
+
+TEST_F(MappedCSVFileTest, ParseFields) {
+  WriteFile("0,18446744073709551615,18446744073709551616,-1,1e-3,0.25x,");
+  MappedCSVFile file;
+  ASSERT_TRUE(file.Open(file_name_));
+  file.Prefetch();
+  vector<CSVField> fields;
+  ASSERT_TRUE(file.NextRow(&fields));
+  ASSERT_EQ(fields.size(), 7);
+  uint64_t uint_value;
+  EXPECT_TRUE(MappedCSVFile::ParseUInt64(fields[0], &uint_value));
+  EXPECT_EQ(uint_value, 0);
+  EXPECT_TRUE(MappedCSVFile::ParseUInt64(fields[1], &uint_value));
+  EXPECT_EQ(uint_value, UINT64_MAX);
+  EXPECT_FALSE(MappedCSVFile::ParseUInt64(fields[2], &uint_value));
+  EXPECT_FALSE(MappedCSVFile::ParseUInt64(fields[3], &uint_value));
+  EXPECT_FALSE(MappedCSVFile::ParseUInt64(fields[6], &uint_value));
+  double double_value;
+  EXPECT_TRUE(MappedCSVFile::ParseDouble(fields[4], &double_value));
+  EXPECT_DOUBLE_EQ(double_value, 0.001);
+  EXPECT_FALSE(MappedCSVFile::ParseDouble(fields[5], &double_value));
+  EXPECT_FALSE(MappedCSVFile::ParseDouble(fields[6], &double_value));
+}
+
+}  // namespace sim
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,94 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "sim/preloaded_trace_loader.h"
+
+namespace firmament {
+namespace sim {
+
+PreloadedTraceLoader::PreloadedTraceLoader(
+    EventManager* event_manager,
+    const PreloadedTrace* preloaded_trace,
+    TraceLoader* task_events_loader)
+  : TraceLoader(event_manager), preloaded_trace_(preloaded_trace),
+    task_events_loader_(task_events_loader) {
+  CHECK_NOTNULL(preloaded_trace_);
+  CHECK_NOTNULL(task_events_loader_);
+}
+
+PreloadedTraceLoader::~PreloadedTraceLoader() {
+  delete task_events_loader_;
+}
+
+void PreloadedTraceLoader::Preload(TraceLoader* trace_loader,
+                                   PreloadedTrace* preloaded_trace) {
+  // Same order as in SimulatorBridge::LoadTraceData, as the task usage
+  // statistics depend on the task runtimes.
+  trace_loader->LoadMachineEvents(&preloaded_trace->machine_events);
+  trace_loader->LoadJobsNumTasks(&preloaded_trace->job_num_tasks);
+  trace_loader->LoadTasksRunningTime(&preloaded_trace->task_runtime);
+  trace_loader->LoadTaskUtilizationStats(&preloaded_trace->task_id_to_stats,
+                                         preloaded_trace->task_runtime);
+}
+
+void PreloadedTraceLoader::LoadJobsNumTasks(
+    unordered_map<uint64_t, uint64_t>* job_num_tasks) {
+  job_num_tasks->insert(preloaded_trace_->job_num_tasks.begin(),
+                        preloaded_trace_->job_num_tasks.end());
+}
+
+void PreloadedTraceLoader::LoadMachineEvents(
+    multimap<uint64_t, EventDescriptor>* machine_events) {
+  machine_events->insert(preloaded_trace_->machine_events.begin(),
+                         preloaded_trace_->machine_events.end());
+}
+
+bool PreloadedTraceLoader::LoadTaskEvents(
+    uint64_t events_up_to_time,
+    unordered_map<uint64_t, uint64_t>* job_num_tasks) {
+  return task_events_loader_->LoadTaskEvents(events_up_to_time,
+                                             job_num_tasks);
+}
+
+void PreloadedTraceLoader::LoadTaskUtilizationStats(
+    unordered_map<TaskID_t, TraceTaskStats>* task_id_to_stats,
+    const unordered_map<TaskID_t, uint64_t>& task_runtimes) {
+  task_id_to_stats->insert(preloaded_trace_->task_id_to_stats.begin(),
+                           preloaded_trace_->task_id_to_stats.end());
+}
+
+void PreloadedTraceLoader::LoadTasksRunningTime(
+    unordered_map<TaskID_t, uint64_t>* task_runtime) {
+  task_runtime->insert(preloaded_trace_->task_runtime.begin(),
+                       preloaded_trace_->task_runtime.end());
+}
+
+void PreloadedTraceLoader::RestoreTaskEventsPosition(
+    const TraceLoaderPosition& position) {
+  task_events_loader_->RestoreTaskEventsPosition(position);
+}
+
+void PreloadedTraceLoader::SaveTaskEventsPosition(
+    TraceLoaderPosition* position) {
+  task_events_loader_->SaveTaskEventsPosition(position);
+}
+
+}  // namespace sim
+}  // namespace firmament
@@ -0,0 +1,95 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Trace loader that serves the machine events, job sizes, task runtimes and
+// task usage statistics from data that has been loaded once, and reads the
+// task events through another trace loader. Simulator sweeps use it to share
+// the loaded trace between their runs. They also read the CSV task events
+// once, and replay them from memory in every run.
+
+#ifndef FIRMAMENT_SIM_PRELOADED_TRACE_LOADER_H
+#define FIRMAMENT_SIM_PRELOADED_TRACE_LOADER_H
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "base/common.h"
+#include "sim/binary_trace.h"
+#include "sim/event_desc.pb.h"
+#include "sim/event_manager.h"
+#include "sim/trace_loader.h"
+#include "sim/trace_utils.h"
+
+namespace firmament {
+namespace sim {
+
+struct PreloadedTrace {
+  multimap<uint64_t, EventDescriptor> machine_events;
+  unordered_map<uint64_t, uint64_t> job_num_tasks;
+  unordered_map<TaskID_t, uint64_t> task_runtime;
+  unordered_map<TaskID_t, TraceTaskStats> task_id_to_stats;
+  // The task events to replay, if they have been loaded. If it is empty, the
+  // runs load the task events from the trace.
+  vector<TaskEventRecord> task_events;
+};
+
+class PreloadedTraceLoader : public TraceLoader {
+ public:
+  /**
+   * @param event_manager the event manager to which task events are added
+   * @param preloaded_trace the loaded trace data; not owned by the loader
+   * @param task_events_loader the loader from which to read the task events;
+   * the preloaded trace loader takes ownership of it
+   */
+  PreloadedTraceLoader(EventManager* event_manager,
+                       const PreloadedTrace* preloaded_trace,
+                       TraceLoader* task_events_loader);
+  ~PreloadedTraceLoader();
+
+  /**
+   * Loads everything but the task events from a trace loader.
+   * @param trace_loader the loader to load the trace data with
+   * @param preloaded_trace the structure to load the data into
+   */
+  static void Preload(TraceLoader* trace_loader,
+                      PreloadedTrace* preloaded_trace);
+
+  void LoadJobsNumTasks(unordered_map<uint64_t, uint64_t>* job_num_tasks);
+  void LoadMachineEvents(multimap<uint64_t, EventDescriptor>* machine_events);
+  bool LoadTaskEvents(uint64_t events_up_to_time,
+                      unordered_map<uint64_t, uint64_t>* job_num_tasks);
+  void LoadTaskUtilizationStats(
+      unordered_map<TaskID_t, TraceTaskStats>* task_id_to_stats,
+      const unordered_map<TaskID_t, uint64_t>& task_runtimes);
+  void LoadTasksRunningTime(
+      unordered_map<TaskID_t, uint64_t>* task_runtime);
+  void RestoreTaskEventsPosition(const TraceLoaderPosition& position);
+  void SaveTaskEventsPosition(TraceLoaderPosition* position);
+
+ private:
+  const PreloadedTrace* preloaded_trace_;
+  TraceLoader* task_events_loader_;
+};
+
+}  // namespace sim
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SIM_PRELOADED_TRACE_LOADER_H
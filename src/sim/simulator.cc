@@ -25,20 +25,27 @@
 #include <signal.h>
 #include <sys/stat.h>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
 #include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/timer/timer.hpp>
 #include <cstdio>
+#include <fstream>
 #include <limits>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/units.h"
 #include "misc/string_utils.h"
 #include "misc/utils.h"
+#include "sim/binary_trace_loader.h"
 #include "sim/google_trace_loader.h"
+#include "sim/preloaded_trace_loader.h"
 #include "sim/synthetic_trace_loader.h"
 
 using boost::lexical_cast;
@@ -46,15 +53,32 @@ using boost::algorithm::is_any_of;
 using boost::token_compress_off;
 
 DEFINE_string(solver, "flowlessly",
-              "Solver to use: flowlessly | cs2 | custom.");
+              "Solver to use: flowlessly | cs2 | inprocess | custom.");
 DEFINE_bool(run_incremental_scheduler, false,
             "Run the Flowlessly incremental scheduler.");
 DEFINE_string(simulation, "google",
-              "The type of simulation to run: google | synthetic");
+              "The type of simulation to run: google | binary | synthetic");
 DEFINE_bool(exit_simulation_after_last_task_event, false,
             "True if the simulation should not wait for the running tasks "
             "to complete");
 DEFINE_double(trace_speed_up, 1, "Factor by which to speed up events");
+DEFINE_string(checkpoint_file, "",
+              "If set, a checkpoint of the simulation is saved to this file "
+              "before the first scheduler run at or after --checkpoint_at. "
+              "The checkpoint includes the warm-start state of "
+              "--solver=inprocess; the other solvers run in a separate "
+              "process and solve the first round after a restore from "
+              "scratch.");
+DEFINE_uint64(checkpoint_at, 0,
+              "Simulated time (in microseconds) at which to save the "
+              "checkpoint.");
+DEFINE_bool(exit_after_checkpoint, false,
+            "True if the simulation should stop once the checkpoint has been "
+            "saved.");
+DEFINE_string(restore_checkpoint_file, "",
+              "If set, the simulation continues from the checkpoint saved in "
+              "this file. The trace flags must be the same as when the "
+              "checkpoint was saved.");
 
 DECLARE_uint64(heartbeat_interval);
 DECLARE_uint64(max_solver_runtime);
@@ -63,8 +87,8 @@ DECLARE_string(solver_runtime_accounting_mode);
 
 static bool ValidateSolver(const char* flagname, const string& solver) {
   if (solver.compare("cs2") && solver.compare("flowlessly") &&
-      solver.compare("custom")) {
-    LOG(ERROR) << "Solver can be one of: cs2, flowlessly or custom";
+      solver.compare("inprocess") && solver.compare("custom")) {
+    LOG(ERROR) << "Solver can be one of: cs2, flowlessly, inprocess or custom";
     return false;
   }
   return true;
@@ -86,8 +110,9 @@ static const bool run_incremental_validator =
                                 &ValidateRunIncremental);
 
 static bool ValidateSimulation(const char* flagname, const string& simulation) {
-  if (simulation.compare("google") && simulation.compare("synthetic")) {
-    LOG(ERROR) << "Simulation can be one of: google or synthetic";
+  if (simulation.compare("google") && simulation.compare("binary") &&
+      simulation.compare("synthetic")) {
+    LOG(ERROR) << "Simulation can be one of: google, binary or synthetic";
     return false;
   }
   return true;
@@ -99,7 +124,25 @@ static const bool simulation_validator =
 namespace firmament {
 namespace sim {
 
-Simulator::Simulator() {
+// Flags that determine which trace events are replayed.
+static const char* kTraceFlags[] = {
+  "binary_trace_file",
+  "binary_trace_start_time",
+  "events_fraction",
+  "machine_events_fraction",
+  "num_files_to_process",
+  "num_tasks_synthetic_job_after_initial_run",
+  "runtime",
+  "simulation",
+  "task_duration_oracle",
+  "trace_path",
+  "trace_speed_up",
+};
+
+Simulator::Simulator() : preloaded_trace_(NULL) {
+  // The solver flags must be set before the scheduler and its flow graph are
+  // created.
+  ConfigureSolver();
   event_manager_ = new EventManager(&simulated_time_);
   bridge_ = new SimulatorBridge(event_manager_, &simulated_time_);
   scheduler_run_cnt_ = 0;
@@ -110,21 +153,80 @@ Simulator::~Simulator() {
   delete event_manager_;
 }
 
-void Simulator::ReplaySimulation() {
-  // Load the trace ingredients
+void Simulator::ConfigureSolver() {
+  FLAGS_flow_scheduling_solver = FLAGS_solver;
+  if (!FLAGS_solver.compare("flowlessly")) {
+    FLAGS_incremental_flow = FLAGS_run_incremental_scheduler;
+    FLAGS_only_read_assignment_changes = true;
+    FLAGS_flow_scheduling_binary =
+        SOLVER_DIR "/flowlessly/src/flowlessly-build/flow_scheduler";
+  } else if (!FLAGS_solver.compare("cs2")) {
+    FLAGS_incremental_flow = false;
+    FLAGS_only_read_assignment_changes = false;
+    FLAGS_flow_scheduling_binary = SOLVER_DIR "/cs2/src/cs2/cs2.exe";
+  } else if (!FLAGS_solver.compare("inprocess")) {
+    // The linked-in solver reads the flow graph directly and does not need
+    // the graph changes.
+    FLAGS_incremental_flow = false;
+    FLAGS_only_read_assignment_changes = false;
+  } else if (!FLAGS_solver.compare("custom")) {
+  }
+}
+
+TraceLoader* Simulator::CreateTraceLoader(EventManager* event_manager) {
   TraceLoader* trace_loader = NULL;
   if (!FLAGS_simulation.compare("google")) {
-    trace_loader = new GoogleTraceLoader(event_manager_);
+    trace_loader = new GoogleTraceLoader(event_manager);
+  } else if (!FLAGS_simulation.compare("binary")) {
+    trace_loader = new BinaryTraceLoader(event_manager);
   } else if (!FLAGS_simulation.compare("synthetic")) {
-    trace_loader = new SyntheticTraceLoader(event_manager_);
+    trace_loader = new SyntheticTraceLoader(event_manager);
   }
   CHECK_NOTNULL(trace_loader);
+  return trace_loader;
+}
+
+bool Simulator::IsTraceFlag(const string& name) {
+  if (boost::starts_with(name, "synthetic_")) {
+    return true;
+  }
+  for (const char* trace_flag : kTraceFlags) {
+    if (name == trace_flag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Simulator::ReplaySimulation() {
+  // Load the trace ingredients
+  TraceLoader* trace_loader = NULL;
+  if (preloaded_trace_) {
+    TraceLoader* task_events_loader = NULL;
+    if (preloaded_trace_->task_events.empty()) {
+      task_events_loader = CreateTraceLoader(event_manager_);
+    } else {
+      task_events_loader =
+        new BinaryTraceLoader(event_manager_, &preloaded_trace_->task_events);
+    }
+    trace_loader = new PreloadedTraceLoader(event_manager_, preloaded_trace_,
+                                            task_events_loader);
+  } else {
+    trace_loader = CreateTraceLoader(event_manager_);
+  }
   bridge_->LoadTraceData(trace_loader);
 
   uint64_t run_scheduler_at = 0;
   uint64_t current_heartbeat_time = 0;
   uint64_t num_scheduling_rounds = 0;
   bool loaded_initial_machines = false;
+  bool saved_checkpoint = FLAGS_checkpoint_file.empty();
+  if (!FLAGS_restore_checkpoint_file.empty()) {
+    RestoreCheckpoint(trace_loader, &run_scheduler_at, &current_heartbeat_time,
+                      &num_scheduling_rounds);
+    // The checkpoint contains the machines.
+    loaded_initial_machines = true;
+  }
 
   while (!event_manager_->HasSimulationCompleted(num_scheduling_rounds)) {
     // Make sure to process all the initial machine additions before we add
@@ -133,6 +235,17 @@ void Simulator::ReplaySimulation() {
       loaded_initial_machines = true;
       bridge_->ProcessSimulatorEvents(0);
     }
+    // Between scheduler runs, the simulation state is fully described by
+    // the bridge, the pending events and the trace loader's position.
+    if (!saved_checkpoint && num_scheduling_rounds > 0 &&
+        run_scheduler_at >= FLAGS_checkpoint_at) {
+      SaveCheckpoint(trace_loader, run_scheduler_at, current_heartbeat_time,
+                     num_scheduling_rounds);
+      saved_checkpoint = true;
+      if (FLAGS_exit_after_checkpoint) {
+        break;
+      }
+    }
     // Load the task events up to the next scheduler run + max_solver_runtime.
     // This assures that we'll have the events ready to be processed when
     // the scheduler will callback to the simulator
@@ -170,26 +283,92 @@ void Simulator::ReplaySimulation() {
   delete trace_loader;
 }
 
-void Simulator::Run() {
-  FLAGS_flow_scheduling_solver = FLAGS_solver;
-  if (!FLAGS_solver.compare("flowlessly")) {
-    FLAGS_incremental_flow = FLAGS_run_incremental_scheduler;
-    FLAGS_only_read_assignment_changes = true;
-    FLAGS_flow_scheduling_binary =
-        SOLVER_DIR "/flowlessly/src/flowlessly-build/flow_scheduler";
-  } else if (!FLAGS_solver.compare("cs2")) {
-    FLAGS_incremental_flow = false;
-    FLAGS_only_read_assignment_changes = false;
-    FLAGS_flow_scheduling_binary = SOLVER_DIR "/cs2/src/cs2/cs2.exe";
-  } else if (!FLAGS_solver.compare("custom")) {
+void Simulator::RestoreCheckpoint(TraceLoader* trace_loader,
+                                  uint64_t* run_scheduler_at,
+                                  uint64_t* current_heartbeat_time,
+                                  uint64_t* num_scheduling_rounds) {
+  boost::timer::cpu_timer timer;
+  SimulationCheckpoint checkpoint;
+  std::ifstream checkpoint_stream(FLAGS_restore_checkpoint_file.c_str(),
+                                  ios::in | ios::binary);
+  if (!checkpoint_stream.is_open()) {
+    LOG(FATAL) << "Could not open checkpoint "
+               << FLAGS_restore_checkpoint_file;
   }
+  ::google::protobuf::io::IstreamInputStream raw_input(&checkpoint_stream);
+  ::google::protobuf::io::CodedInputStream coded_input(&raw_input);
+  // Checkpoints of large traces exceed protobuf's default 64 MB limit.
+  coded_input.SetTotalBytesLimit(numeric_limits<int>::max(),
+                                 numeric_limits<int>::max());
+  if (!checkpoint.ParseFromCodedStream(&coded_input)) {
+    LOG(FATAL) << "Could not parse checkpoint "
+               << FLAGS_restore_checkpoint_file;
+  }
+  for (auto& trace_flag : checkpoint.trace_flags()) {
+    string value;
+    if (!google::GetCommandLineOption(trace_flag.first.c_str(), &value) ||
+        value != trace_flag.second) {
+      LOG(FATAL) << "The checkpoint was saved with --" << trace_flag.first
+                 << "=" << trace_flag.second << ", but the flag is set to "
+                 << value;
+    }
+  }
+  bridge_->RestoreCheckpoint(checkpoint);
+  trace_loader->RestoreTaskEventsPosition(checkpoint.trace_loader_position());
+  *run_scheduler_at = checkpoint.run_scheduler_at();
+  *current_heartbeat_time = checkpoint.current_heartbeat_time();
+  *num_scheduling_rounds = checkpoint.num_scheduling_rounds();
+  scheduler_run_cnt_ = checkpoint.scheduler_run_cnt();
+  LOG(INFO) << "Restored checkpoint " << FLAGS_restore_checkpoint_file
+            << " at " << checkpoint.current_timestamp() << " with "
+            << checkpoint.machine_ids_size() << " machines and "
+            << checkpoint.tasks_size() << " tasks in "
+            << timer.elapsed().wall / NANOSECONDS_IN_MICROSECOND << " us";
+}
 
+void Simulator::Run() {
   LOG(INFO) << "Starting Google trace simulator!";
   ReplaySimulation();
   LOG(INFO) << "Simulator has seen " << bridge_->get_num_duplicate_task_ids()
             << " duplicate task ids";
 }
 
+void Simulator::SaveCheckpoint(TraceLoader* trace_loader,
+                               uint64_t run_scheduler_at,
+                               uint64_t current_heartbeat_time,
+                               uint64_t num_scheduling_rounds) {
+  boost::timer::cpu_timer timer;
+  SimulationCheckpoint checkpoint;
+  vector<google::CommandLineFlagInfo> flags;
+  google::GetAllFlags(&flags);
+  for (auto& flag : flags) {
+    if (IsTraceFlag(flag.name)) {
+      (*checkpoint.mutable_trace_flags())[flag.name] = flag.current_value;
+    }
+  }
+  bridge_->SaveCheckpoint(&checkpoint);
+  trace_loader->SaveTaskEventsPosition(
+      checkpoint.mutable_trace_loader_position());
+  checkpoint.set_run_scheduler_at(run_scheduler_at);
+  checkpoint.set_current_heartbeat_time(current_heartbeat_time);
+  checkpoint.set_num_scheduling_rounds(num_scheduling_rounds);
+  checkpoint.set_scheduler_run_cnt(scheduler_run_cnt_);
+  std::ofstream checkpoint_stream(FLAGS_checkpoint_file.c_str(),
+                                  ios::out | ios::trunc | ios::binary);
+  if (!checkpoint_stream.is_open()) {
+    LOG(FATAL) << "Could not create checkpoint " << FLAGS_checkpoint_file;
+  }
+  CHECK(checkpoint.SerializeToOstream(&checkpoint_stream));
+  checkpoint_stream.close();
+  CHECK(!checkpoint_stream.fail()) << "Could not write checkpoint "
+                                   << FLAGS_checkpoint_file;
+  LOG(INFO) << "Saved checkpoint " << FLAGS_checkpoint_file << " at "
+            << checkpoint.current_timestamp() << " with "
+            << checkpoint.machine_ids_size() << " machines and "
+            << checkpoint.tasks_size() << " tasks in "
+            << timer.elapsed().wall / NANOSECONDS_IN_MICROSECOND << " us";
+}
+
 uint64_t Simulator::ScheduleJobsHelper(uint64_t run_scheduler_at) {
   boost::timer::cpu_timer timer;
   scheduler::SchedulerStats scheduler_stats;
@@ -31,8 +31,11 @@
 #include "base/resource_topology_node_desc.pb.h"
 #include "scheduling/flow/solver_dispatcher.h"
 #include "sim/event_manager.h"
+#include "sim/preloaded_trace_loader.h"
 #include "sim/simulated_wall_time.h"
+#include "sim/simulation_checkpoint.pb.h"
 #include "sim/simulator_bridge.h"
+#include "sim/trace_loader.h"
 #include "sim/trace_utils.h"
 
 DECLARE_string(flow_scheduling_binary);
@@ -46,11 +49,54 @@ class Simulator {
  public:
   explicit Simulator();
   virtual ~Simulator();
+  /**
+   * Creates the trace loader selected by --simulation.
+   * @param event_manager the event manager to which the loader adds events
+   */
+  static TraceLoader* CreateTraceLoader(EventManager* event_manager);
+  /**
+   * Returns true if the flag determines which trace events are replayed.
+   * @param name the name of the flag
+   */
+  static bool IsTraceFlag(const string& name);
   void Run();
   static void SchedulerTimeoutHandler(int sig);
 
+  /**
+   * Makes the simulator use trace data that has already been loaded, instead
+   * of loading it from the trace. The task events are still read from the
+   * trace. Must be called before Run().
+   * @param preloaded_trace the trace data; not owned by the simulator
+   */
+  void set_preloaded_trace(const PreloadedTrace* preloaded_trace) {
+    preloaded_trace_ = preloaded_trace;
+  }
+
  private:
+  /**
+   * Sets the flow scheduler flags that depend on --solver.
+   */
+  static void ConfigureSolver();
   void ReplaySimulation();
+  /**
+   * Restores the simulation from the checkpoint in
+   * --restore_checkpoint_file.
+   * @param trace_loader the loader from which the task events are loaded
+   * @param run_scheduler_at set to the time of the next scheduler run
+   * @param current_heartbeat_time set to the time of the next heartbeat
+   * @param num_scheduling_rounds set to the number of scheduling rounds run
+   */
+  void RestoreCheckpoint(TraceLoader* trace_loader,
+                         uint64_t* run_scheduler_at,
+                         uint64_t* current_heartbeat_time,
+                         uint64_t* num_scheduling_rounds);
+  /**
+   * Saves a checkpoint of the simulation to --checkpoint_file.
+   */
+  void SaveCheckpoint(TraceLoader* trace_loader,
+                      uint64_t run_scheduler_at,
+                      uint64_t current_heartbeat_time,
+                      uint64_t num_scheduling_rounds);
 
   /**
    * Runs the scheduler.
@@ -64,6 +110,7 @@ class Simulator {
   EventManager* event_manager_;
   SimulatedWallTime simulated_time_;
   uint64_t scheduler_run_cnt_;
+  const PreloadedTrace* preloaded_trace_;
 };
 
 }  // namespace sim
@@ -20,6 +20,7 @@
 
 #include "sim/simulator_bridge.h"
 
+#include <algorithm>
 #include <limits>
 #include <map>
 #include <set>
@@ -57,7 +58,7 @@ SimulatorBridge::SimulatorBridge(EventManager* event_manager,
     : event_manager_(event_manager), simulated_time_(simulated_time),
     job_map_(new JobMap_t),
     resource_map_(new ResourceMap_t), task_map_(new TaskMap_t),
-    num_duplicate_task_ids_(0) {
+    trace_loader_(NULL), num_duplicate_task_ids_(0) {
   trace_generator_ = new TraceGenerator(simulated_time_);
   if (FLAGS_flow_scheduling_cost_model == COST_MODEL_QUINCY) {
     // We're running Quincy => simulate the DFS.
@@ -73,7 +74,7 @@ SimulatorBridge::SimulatorBridge(EventManager* event_manager,
   rd_ptr->set_type(ResourceDescriptor::RESOURCE_COORDINATOR);
   CHECK(InsertIfNotPresent(
       resource_map_.get(), root_uuid,
-      new ResourceStatus(rd_ptr, &rtn_root_,
+      new ResourceStatus(root_uuid, rd_ptr, &rtn_root_,
                          "endpoint_uri",
                          simulated_time_->GetCurrentTimestamp())));
   messaging_adapter_ =
@@ -250,17 +251,18 @@ bool SimulatorBridge::AddTask(const TraceTaskIdentifier& task_identifier,
 void SimulatorBridge::AddTaskEndEvent(
     const TraceTaskIdentifier& task_identifier,
     TaskDescriptor* td_ptr) {
-  uint64_t* runtime_ptr = FindOrNull(task_runtime_, td_ptr->uid());
+  uint64_t runtime = 0;
+  bool has_runtime = FindTaskRuntime(td_ptr->uid(), &runtime);
   EventDescriptor event_desc;
   event_desc.set_job_id(task_identifier.job_id);
   event_desc.set_task_index(task_identifier.task_index);
   event_desc.set_type(EventDescriptor::TASK_END_RUNTIME);
-  if (runtime_ptr != NULL) {
+  if (has_runtime) {
     // We can approximate the duration of the task.
     event_manager_->AddEvent(simulated_time_->GetCurrentTimestamp() +
-                             *runtime_ptr, event_desc);
+                             runtime, event_desc);
     td_ptr->set_finish_time(simulated_time_->GetCurrentTimestamp() +
-                            *runtime_ptr);
+                            runtime);
   } else {
     // The task didn't finish in the trace. Set the task's end event to the
     // the timestamp just after the end of the simulation.
@@ -273,7 +275,12 @@ void SimulatorBridge::AddTaskEndEvent(
 void SimulatorBridge::AddTaskStats(
     const TraceTaskIdentifier& trace_task_identifier,
     TaskID_t task_id) {
+  TraceTaskStats trace_task_stats;
   TraceTaskStats* task_stats = FindOrNull(task_id_to_stats_, task_id);
+  if (!task_stats && trace_loader_ &&
+      trace_loader_->FindTaskStats(task_id, &trace_task_stats)) {
+    task_stats = &trace_task_stats;
+  }
   if (!task_stats) {
     // We have no stats for the task.
     LOG(WARNING) << "No stats for " << trace_task_identifier.job_id << ","
@@ -325,14 +332,14 @@ TaskDescriptor* SimulatorBridge::AddTaskToJob(
   // Add a dependency for the task.
   if (data_layer_manager_) {
     ReferenceDescriptor* dependency =  new_task->add_dependencies();
-    uint64_t* runtime_ptr = FindOrNull(task_runtime_, task_id);
+    uint64_t runtime = 0;
     uint64_t input_size = 0;
-    if (runtime_ptr) {
+    if (FindTaskRuntime(task_id, &runtime)) {
       uint64_t* num_tasks =
         FindOrNull(immutable_job_num_tasks_, task_identifier.job_id);
       CHECK_NOTNULL(num_tasks);
       input_size =
-        data_layer_manager_->AddFilesForTask(*new_task, *runtime_ptr, false,
+        data_layer_manager_->AddFilesForTask(*new_task, runtime, false,
                                              *num_tasks);
     } else {
       // The task didn't finish in the trace => it is a long running
@@ -351,7 +358,17 @@ TaskDescriptor* SimulatorBridge::AddTaskToJob(
   return new_task;
 }
 
+bool SimulatorBridge::FindTaskRuntime(TaskID_t task_id, uint64_t* runtime) {
+  uint64_t* runtime_ptr = FindOrNull(task_runtime_, task_id);
+  if (runtime_ptr) {
+    *runtime = *runtime_ptr;
+    return true;
+  }
+  return trace_loader_ && trace_loader_->FindTaskRuntime(task_id, runtime);
+}
+
 void SimulatorBridge::LoadTraceData(TraceLoader* trace_loader) {
+  trace_loader_ = trace_loader;
   // Load all the machine events.
   multimap<uint64_t, EventDescriptor> machine_events;
   trace_loader->LoadMachineEvents(&machine_events);
@@ -367,6 +384,24 @@ void SimulatorBridge::LoadTraceData(TraceLoader* trace_loader) {
   trace_loader->LoadTaskUtilizationStats(&task_id_to_stats_, task_runtime_);
 }
 
+ResourceDescriptor* SimulatorBridge::MachinePU(uint64_t machine_id,
+                                               uint32_t pu_index) {
+  ResourceTopologyNodeDescriptor* rtnd_ptr =
+    FindPtrOrNull(trace_machine_id_to_rtnd_, machine_id);
+  CHECK_NOTNULL(rtnd_ptr);
+  // The PUs of a machine are kept in the order in which they were set up.
+  auto range_it = machine_res_id_pus_.equal_range(
+      ResourceIDFromString(rtnd_ptr->resource_desc().uuid()));
+  for (uint32_t index = 0; range_it.first != range_it.second;
+       ++range_it.first, ++index) {
+    if (index == pu_index) {
+      return range_it.first->second;
+    }
+  }
+  LOG(FATAL) << "Machine " << machine_id << " does not have PU " << pu_index;
+  return NULL;
+}
+
 void SimulatorBridge::ProcessSimulatorEvents(uint64_t events_up_to_time) {
   while (true) {
     if (event_manager_->GetTimeOfNextEvent() > events_up_to_time) {
@@ -484,11 +519,11 @@ void SimulatorBridge::OnTaskEviction(TaskDescriptor* td_ptr,
   uint64_t task_executed_for =
     simulated_time_->GetCurrentTimestamp() - td_ptr->start_time();
   td_ptr->set_total_run_time(UpdateTaskTotalRunTime(*td_ptr));
-  uint64_t* runtime_ptr = FindOrNull(task_runtime_, task_id);
-  if (runtime_ptr != NULL) {
+  uint64_t runtime = 0;
+  if (FindTaskRuntime(task_id, &runtime)) {
     // NOTE: We assume that the work conducted by a task until eviction is
     // saved. Hence, we update the time the task has left to run.
-    InsertOrUpdate(&task_runtime_, task_id, *runtime_ptr - task_executed_for);
+    InsertOrUpdate(&task_runtime_, task_id, runtime - task_executed_for);
   } else {
     // The task didn't finish in the trace.
   }
@@ -575,6 +610,173 @@ void SimulatorBridge::RemoveTaskFromSpawned(
   }
 }
 
+void SimulatorBridge::RestoreCheckpoint(
+    const SimulationCheckpoint& checkpoint) {
+  CHECK(trace_machine_id_to_rtnd_.empty() && job_map_->empty())
+    << "A checkpoint can only be restored before the simulation starts";
+  simulated_time_->UpdateCurrentTimestamp(checkpoint.current_timestamp());
+  for (auto& machine_id : checkpoint.machine_ids()) {
+    AddMachine(machine_id);
+  }
+  // The jobs that completed before the checkpoint was saved are not in the
+  // checkpoint.
+  job_num_tasks_.clear();
+  immutable_job_num_tasks_.clear();
+  for (auto& job : checkpoint.jobs()) {
+    CHECK(InsertIfNotPresent(&job_num_tasks_, job.job_id(), job.num_tasks()));
+    CHECK(InsertIfNotPresent(&immutable_job_num_tasks_, job.job_id(),
+                             job.immutable_num_tasks()));
+  }
+  vector<pair<TaskDescriptor*, ResourceDescriptor*>> placements;
+  for (auto& task : checkpoint.tasks()) {
+    TraceTaskIdentifier task_identifier;
+    task_identifier.job_id = task.job_id();
+    task_identifier.task_index = task.task_index();
+    TaskID_t task_id = GenerateTaskIDFromTraceIdentifier(task_identifier);
+    // The runtime of a task is reduced when the task is evicted.
+    if (task.has_runtime()) {
+      InsertOrUpdate(&task_runtime_, task_id, task.runtime());
+    }
+    EventDescriptor event_desc;
+    event_desc.set_job_id(task.job_id());
+    event_desc.set_task_index(task.task_index());
+    event_desc.set_type(EventDescriptor::TASK_SUBMIT);
+    event_desc.set_requested_cpu_cores(task.requested_cpu_cores());
+    event_desc.set_requested_ram(task.requested_ram());
+    event_desc.set_priority(task.priority());
+    CHECK(AddTask(task_identifier, event_desc))
+      << "Could not restore task " << task.job_id() << ","
+      << task.task_index();
+    if (task.running()) {
+      TaskDescriptor* td_ptr =
+        FindPtrOrNull(trace_task_id_to_td_, task_identifier);
+      placements.push_back(pair<TaskDescriptor*, ResourceDescriptor*>(
+          td_ptr, MachinePU(task.machine_id(), task.pu_index())));
+    }
+  }
+  scheduler_->RestoreTaskPlacements(placements);
+  scheduler_->RestoreSolverState(checkpoint.solver_state());
+  // Placing the tasks has set their start times to the current time, so we
+  // restore the task times afterwards.
+  for (auto& task : checkpoint.tasks()) {
+    TraceTaskIdentifier task_identifier;
+    task_identifier.job_id = task.job_id();
+    task_identifier.task_index = task.task_index();
+    TaskDescriptor* td_ptr =
+      FindPtrOrNull(trace_task_id_to_td_, task_identifier);
+    CHECK_NOTNULL(td_ptr);
+    td_ptr->set_submit_time(task.submit_time());
+    td_ptr->set_start_time(task.start_time());
+    td_ptr->set_finish_time(task.finish_time());
+    td_ptr->set_total_run_time(task.total_run_time());
+    td_ptr->set_total_unscheduled_time(task.total_unscheduled_time());
+  }
+  // The submitted tasks are only restored now, as AddTask ignores tasks that
+  // have already been submitted.
+  CHECK_EQ(checkpoint.submitted_job_ids_size(),
+           checkpoint.submitted_task_indices_size());
+  submitted_tasks_.rehash(checkpoint.submitted_job_ids_size());
+  for (int32_t index = 0; index < checkpoint.submitted_job_ids_size();
+       ++index) {
+    TraceTaskIdentifier task_identifier;
+    task_identifier.job_id = checkpoint.submitted_job_ids(index);
+    task_identifier.task_index = checkpoint.submitted_task_indices(index);
+    submitted_tasks_.insert(task_identifier);
+  }
+  num_duplicate_task_ids_ = checkpoint.num_duplicate_task_ids();
+  // This also drops the end events that were added when the tasks were
+  // placed. The checkpoint has the end events at the original times.
+  event_manager_->RestoreCheckpoint(checkpoint);
+  simulated_time_->UpdateCurrentTimestamp(checkpoint.current_timestamp());
+}
+
+void SimulatorBridge::SaveCheckpoint(SimulationCheckpoint* checkpoint) {
+  checkpoint->set_current_timestamp(simulated_time_->GetCurrentTimestamp());
+  // The removed machines remain in the topology, but they are not in
+  // trace_machine_id_to_rtnd_ anymore.
+  for (auto& rtnd : rtn_root_.children()) {
+    uint64_t machine_id = rtnd.resource_desc().trace_machine_id();
+    if (FindPtrOrNull(trace_machine_id_to_rtnd_, machine_id) == &rtnd) {
+      checkpoint->add_machine_ids(machine_id);
+    }
+  }
+  for (auto& job_num_tasks : job_num_tasks_) {
+    CheckpointJob* job = checkpoint->add_jobs();
+    job->set_job_id(job_num_tasks.first);
+    job->set_num_tasks(job_num_tasks.second);
+    uint64_t* immutable_num_tasks =
+      FindOrNull(immutable_job_num_tasks_, job_num_tasks.first);
+    if (immutable_num_tasks) {
+      job->set_immutable_num_tasks(*immutable_num_tasks);
+    }
+  }
+  // Save the tasks in the order in which they were submitted, so that they
+  // are added back in the same order.
+  vector<TaskDescriptor*> tds;
+  tds.reserve(trace_task_id_to_td_.size());
+  for (auto& trace_task_id_td : trace_task_id_to_td_) {
+    tds.push_back(trace_task_id_td.second);
+  }
+  sort(tds.begin(), tds.end(),
+       [](const TaskDescriptor* lhs, const TaskDescriptor* rhs) {
+         if (lhs->submit_time() != rhs->submit_time()) {
+           return lhs->submit_time() < rhs->submit_time();
+         }
+         if (lhs->trace_job_id() != rhs->trace_job_id()) {
+           return lhs->trace_job_id() < rhs->trace_job_id();
+         }
+         return lhs->trace_task_id() < rhs->trace_task_id();
+       });
+  for (auto& td_ptr : tds) {
+    CheckpointTask* task = checkpoint->add_tasks();
+    task->set_job_id(td_ptr->trace_job_id());
+    task->set_task_index(td_ptr->trace_task_id());
+    task->set_requested_cpu_cores(td_ptr->resource_request().cpu_cores());
+    task->set_requested_ram(td_ptr->resource_request().ram_cap());
+    task->set_priority(td_ptr->priority());
+    task->set_submit_time(td_ptr->submit_time());
+    task->set_start_time(td_ptr->start_time());
+    task->set_finish_time(td_ptr->finish_time());
+    task->set_total_run_time(td_ptr->total_run_time());
+    task->set_total_unscheduled_time(td_ptr->total_unscheduled_time());
+    uint64_t runtime = 0;
+    if (FindTaskRuntime(td_ptr->uid(), &runtime)) {
+      task->set_has_runtime(true);
+      task->set_runtime(runtime);
+    }
+    ResourceID_t* res_id_ptr = scheduler_->BoundResourceForTask(td_ptr->uid());
+    if (!res_id_ptr) {
+      continue;
+    }
+    ResourceStatus* rs_ptr = FindPtrOrNull(*resource_map_, *res_id_ptr);
+    CHECK_NOTNULL(rs_ptr);
+    uint64_t machine_id = rs_ptr->descriptor().trace_machine_id();
+    ResourceTopologyNodeDescriptor* machine_rtnd_ptr =
+      FindPtrOrNull(trace_machine_id_to_rtnd_, machine_id);
+    CHECK_NOTNULL(machine_rtnd_ptr);
+    auto range_it = machine_res_id_pus_.equal_range(
+        ResourceIDFromString(machine_rtnd_ptr->resource_desc().uuid()));
+    uint32_t pu_index = 0;
+    for (; range_it.first != range_it.second; ++range_it.first, ++pu_index) {
+      if (range_it.first->second == rs_ptr->mutable_descriptor()) {
+        break;
+      }
+    }
+    CHECK(range_it.first != range_it.second)
+      << "Task " << td_ptr->uid() << " is not running on a PU";
+    task->set_running(true);
+    task->set_machine_id(machine_id);
+    task->set_pu_index(pu_index);
+  }
+  for (auto& task_identifier : submitted_tasks_) {
+    checkpoint->add_submitted_job_ids(task_identifier.job_id);
+    checkpoint->add_submitted_task_indices(task_identifier.task_index);
+  }
+  checkpoint->set_num_duplicate_task_ids(num_duplicate_task_ids_);
+  scheduler_->SaveSolverState(checkpoint->mutable_solver_state());
+  event_manager_->SaveCheckpoint(checkpoint);
+}
+
 void SimulatorBridge::SetupMachine(
     ResourceTopologyNodeDescriptor* rtnd,
     ResourceVector* machine_res_cap,
@@ -608,10 +810,10 @@ void SimulatorBridge::SetupMachine(
   rd->set_uuid(new_uuid);
   rd->set_trace_machine_id(trace_machine_id);
   // Add the resource node to the map.
+  ResourceID_t res_id = ResourceIDFromString(rd->uuid());
   CHECK(InsertIfNotPresent(
-      resource_map_.get(),
-      ResourceIDFromString(rd->uuid()),
-      new ResourceStatus(rd, rtnd, "endpoint_uri",
+      resource_map_.get(), res_id,
+      new ResourceStatus(res_id, rd, rtnd, "endpoint_uri",
                          simulated_time_->GetCurrentTimestamp())));
   if (rd->type() == ResourceDescriptor::RESOURCE_PU) {
     string* new_machine_res_id = FindOrNull(uuid_conversion_map_,
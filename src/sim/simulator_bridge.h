@@ -37,6 +37,7 @@
 #include "sim/event_manager.h"
 #include "sim/knowledge_base_simulator.h"
 #include "sim/simulated_wall_time.h"
+#include "sim/simulation_checkpoint.pb.h"
 #include "sim/trace_loader.h"
 #include "sim/trace_utils.h"
 #include "storage/object_store_interface.h"
@@ -150,6 +151,22 @@ class SimulatorBridge : public scheduler::SchedulingEventNotifierInterface {
    */
   void RemoveMachine(uint64_t machine_id);
 
+  /**
+   * Restores the machines, jobs, tasks and pending events saved in a
+   * checkpoint. The tasks that were running are placed on the same PUs
+   * without running the scheduler, which rebuilds the scheduler's state
+   * (e.g., the flow graph) from the placements. Must be called after the
+   * trace data has been loaded, and before any events are processed.
+   * @param checkpoint the checkpoint to restore
+   */
+  void RestoreCheckpoint(const SimulationCheckpoint& checkpoint);
+
+  /**
+   * Saves the machines, jobs, tasks and pending events to a checkpoint.
+   * @param checkpoint the checkpoint to save to
+   */
+  void SaveCheckpoint(SimulationCheckpoint* checkpoint);
+
   void ScheduleJobs(SchedulerStats* scheduler_stats);
 
   /**
@@ -175,6 +192,7 @@ class SimulatorBridge : public scheduler::SchedulingEventNotifierInterface {
   FRIEND_TEST(SimulatorBridgeTest, OnTaskEviction);
   FRIEND_TEST(SimulatorBridgeTest, OnTaskPlacement);
   FRIEND_TEST(SimulatorBridgeTest, RemoveMachine);
+  FRIEND_TEST(SimulatorBridgeTest, SaveAndRestoreCheckpoint);
   /**
    * Add task end event to the simulator event queue.
    * @param task_identifier the trace identifier of the task
@@ -200,6 +218,22 @@ class SimulatorBridge : public scheduler::SchedulingEventNotifierInterface {
   TaskDescriptor* AddTaskToJob(JobDescriptor* jd_ptr,
                                const TraceTaskIdentifier& task_identifier);
 
+  /**
+   * Looks up the runtime a task has left. The runtimes that have changed
+   * during the simulation override the ones the trace loader returns.
+   * @param task_id the Firmament task id
+   * @param runtime set to the runtime of the task
+   * @return false if the task didn't finish in the trace
+   */
+  bool FindTaskRuntime(TaskID_t task_id, uint64_t* runtime);
+
+  /**
+   * Returns the descriptor of a machine's PU.
+   * @param machine_id the trace id of the machine
+   * @param pu_index the index of the PU within the machine
+   */
+  ResourceDescriptor* MachinePU(uint64_t machine_id, uint32_t pu_index);
+
   /**
    * Create and populate a new job.
    * @param job_id the simulator job id
@@ -274,7 +308,9 @@ class SimulatorBridge : public scheduler::SchedulingEventNotifierInterface {
   // Map from TaskID_t to TaskDescriptor*
   shared_ptr<TaskMap_t> task_map_;
 
-  // Map holding the per-task runtime information
+  // Map holding the per-task runtime information. It only holds the
+  // runtimes that are not looked up in the trace loader, and the runtimes
+  // that have been updated because the task was evicted.
   unordered_map<TaskID_t, uint64_t> task_runtime_;
 
   // Map from the simulator machine id to the Firmament rtnd.
@@ -282,6 +318,8 @@ class SimulatorBridge : public scheduler::SchedulingEventNotifierInterface {
     ResourceTopologyNodeDescriptor*> trace_machine_id_to_rtnd_;
 
   unordered_map<TaskID_t, TraceTaskStats> task_id_to_stats_;
+  // The loader of the trace that is replayed; not owned by the bridge.
+  TraceLoader* trace_loader_;
 
   // Map used to convert between the simulator task_ids and the Firmament
   // task descriptors.
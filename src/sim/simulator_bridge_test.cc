@@ -243,6 +243,67 @@ TEST_F(SimulatorBridgeTest, OnTaskPlacement) {
   CHECK_EQ(td_ptr->start_time(), 0);
 }
 
+TEST_F(SimulatorBridgeTest, SaveAndRestoreCheckpoint) {
+  bridge_->AddMachine(1);
+  bridge_->AddMachine(2);
+  TraceTaskIdentifier trace_task_id;
+  trace_task_id.job_id = 1;
+  trace_task_id.task_index = 1;
+  EventDescriptor event_desc;
+  event_desc.set_type(EventDescriptor::TASK_SUBMIT);
+  event_desc.set_requested_ram(1);
+  event_desc.set_requested_cpu_cores(1);
+  bridge_->AddTask(trace_task_id, event_desc);
+  trace_task_id.task_index = 2;
+  bridge_->AddTask(trace_task_id, event_desc);
+  CHECK(InsertIfNotPresent(&bridge_->job_num_tasks_, trace_task_id.job_id, 2));
+  CHECK(InsertIfNotPresent(&bridge_->task_runtime_,
+                           GenerateTaskIDFromTraceIdentifier(trace_task_id),
+                           10));
+  // Place the second task on the third PU of the second machine.
+  TaskDescriptor* td_ptr =
+    FindPtrOrNull(bridge_->trace_task_id_to_td_, trace_task_id);
+  ResourceDescriptor* pu_rd_ptr = bridge_->MachinePU(2, 2);
+  vector<pair<TaskDescriptor*, ResourceDescriptor*>> placements;
+  placements.push_back(
+      pair<TaskDescriptor*, ResourceDescriptor*>(td_ptr, pu_rd_ptr));
+  bridge_->scheduler_->RestoreTaskPlacements(placements);
+  CHECK_EQ(event_manager_->GetTimeOfNextEvent(), 10);
+  SimulationCheckpoint checkpoint;
+  bridge_->SaveCheckpoint(&checkpoint);
+  CHECK_EQ(checkpoint.machine_ids_size(), 2);
+  CHECK_EQ(checkpoint.tasks_size(), 2);
+  CHECK(!checkpoint.tasks(0).running());
+  CHECK(checkpoint.tasks(1).running());
+  CHECK_EQ(checkpoint.tasks(1).machine_id(), 2);
+  CHECK_EQ(checkpoint.tasks(1).pu_index(), 2);
+  CHECK_EQ(checkpoint.events_size(), 1);
+  // Restore the checkpoint into a new simulation.
+  SimulatedWallTime simulated_time;
+  EventManager event_manager(&simulated_time);
+  SimulatorBridge bridge(&event_manager, &simulated_time);
+  bridge.RestoreCheckpoint(checkpoint);
+  CHECK_EQ(bridge.trace_machine_id_to_rtnd_.size(), 2);
+  CHECK_EQ(bridge.machine_res_id_pus_.size(), 16);
+  CHECK_EQ(bridge.trace_task_id_to_td_.size(), 2);
+  CHECK_EQ(bridge.submitted_tasks_.size(), 2);
+  CHECK_EQ(*FindOrNull(bridge.job_num_tasks_, trace_task_id.job_id), 2);
+  TaskDescriptor* restored_td_ptr =
+    FindPtrOrNull(bridge.trace_task_id_to_td_, trace_task_id);
+  CHECK_NOTNULL(restored_td_ptr);
+  CHECK_EQ(restored_td_ptr->state(), TaskDescriptor::RUNNING);
+  ResourceID_t* res_id_ptr =
+    bridge.scheduler_->BoundResourceForTask(restored_td_ptr->uid());
+  CHECK_NOTNULL(res_id_ptr);
+  CHECK_EQ(*res_id_ptr,
+           ResourceIDFromString(bridge.MachinePU(2, 2)->uuid()));
+  // The end event is restored once, at its original time.
+  CHECK_EQ(event_manager.GetTimeOfNextEvent(), 10);
+  SimulationCheckpoint restored_checkpoint;
+  bridge.SaveCheckpoint(&restored_checkpoint);
+  CHECK_EQ(restored_checkpoint.events_size(), 1);
+}
+
 TEST_F(SimulatorBridgeTest, RemoveMachine) {
   CHECK_EQ(bridge_->resource_map_->size(), 1);
   CHECK_EQ(bridge_->trace_machine_id_to_rtnd_.size(), 0);
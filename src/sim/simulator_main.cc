@@ -19,13 +19,27 @@
  */
 
 #include "base/common.h"
+#include "misc/trace_writer.h"
 #include "sim/simulator.h"
+#include "sim/simulator_sweep.h"
+
+DECLARE_string(sweep_config_file);
+DECLARE_int32(sweep_parallelism);
 
 using namespace firmament;  // NOLINT
 
 int main(int argc, char *argv[]) {
   VLOG(1) << "Calling common::InitFirmament";
   common::InitFirmament(argc, argv);
+  // Write out the generated trace records that are queued if we fail.
+  TraceWriter::InstallFailureFunction();
+  if (!FLAGS_sweep_config_file.empty()) {
+    sim::SimulatorSweep sweep;
+    if (!sweep.LoadConfigurations(FLAGS_sweep_config_file)) {
+      LOG(FATAL) << "Invalid sweep configuration " << FLAGS_sweep_config_file;
+    }
+    return sweep.Run(FLAGS_sweep_parallelism) == 0 ? 0 : 1;
+  }
   //HeapProfilerStart("ts");
   sim::Simulator simulator;
   //HeapProfilerStop();
@@ -0,0 +1,245 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "sim/simulator_sweep.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <boost/algorithm/string.hpp>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+#include "misc/utils.h"
+#include "sim/binary_trace_converter.h"
+#include "sim/event_manager.h"
+#include "sim/simulated_wall_time.h"
+#include "sim/simulator.h"
+
+DEFINE_string(sweep_config_file, "",
+              "If set, the simulator replays the trace once for every line of "
+              "the file. Each line is a list of --flag=value settings.");
+DEFINE_int32(sweep_parallelism, 0,
+             "Maximum number of sweep runs to execute at the same time. 0 "
+             "runs as many as there are cores.");
+
+DECLARE_bool(generate_trace);
+DECLARE_string(generated_trace_path);
+DECLARE_int32(num_files_to_process);
+DECLARE_string(simulation);
+DECLARE_string(trace_path);
+
+namespace firmament {
+namespace sim {
+
+// Flags that cannot be changed in a sweep, because the runs share the loaded
+// trace, or the sweep sets them.
+static bool IsSweepFixedFlag(const string& name) {
+  return Simulator::IsTraceFlag(name) || name == "generated_trace_path" ||
+    boost::starts_with(name, "sweep_");
+}
+
+SimulatorSweep::SimulatorSweep() : trace_preloaded_(false) {
+}
+
+bool SimulatorSweep::ParseSweepRun(const string& line, SweepRun* run) {
+  run->config = boost::trim_copy(line);
+  vector<string> settings;
+  boost::split(settings, run->config, boost::is_any_of(" \t"),
+               boost::token_compress_on);
+  for (auto& setting : settings) {
+    if (setting.empty()) {
+      continue;
+    }
+    if (!boost::starts_with(setting, "--")) {
+      LOG(ERROR) << "Sweep setting " << setting << " does not start with --";
+      return false;
+    }
+    string name = setting.substr(2);
+    // A flag without a value is a boolean flag that is set to true.
+    string value = "true";
+    size_t equals_pos = name.find('=');
+    if (equals_pos != string::npos) {
+      value = name.substr(equals_pos + 1);
+      name = name.substr(0, equals_pos);
+    }
+    google::CommandLineFlagInfo flag_info;
+    if (!google::GetCommandLineFlagInfo(name.c_str(), &flag_info)) {
+      LOG(ERROR) << "Unknown flag --" << name << " in sweep configuration";
+      return false;
+    }
+    if (IsSweepFixedFlag(name)) {
+      LOG(ERROR) << "--" << name << " cannot be changed in a sweep, because "
+                 << "the runs share the loaded trace";
+      return false;
+    }
+    run->flags.push_back(pair<string, string>(name, value));
+  }
+  return true;
+}
+
+bool SimulatorSweep::LoadConfigurations(const string& config_file) {
+  std::ifstream config_stream(config_file.c_str());
+  if (!config_stream.is_open()) {
+    LOG(ERROR) << "Could not open sweep configuration file " << config_file;
+    return false;
+  }
+  string line;
+  while (std::getline(config_stream, line)) {
+    string trimmed_line = boost::trim_copy(line);
+    if (trimmed_line.empty() || trimmed_line[0] == '#') {
+      continue;
+    }
+    SweepRun run;
+    run.name = "run_" + to_string(runs_.size());
+    if (!ParseSweepRun(trimmed_line, &run)) {
+      return false;
+    }
+    runs_.push_back(run);
+  }
+  return true;
+}
+
+void SimulatorSweep::PreloadTrace() {
+  // The loader only adds task events to the event manager, and we do not
+  // load any task events.
+  SimulatedWallTime simulated_time;
+  EventManager event_manager(&simulated_time);
+  TraceLoader* trace_loader = Simulator::CreateTraceLoader(&event_manager);
+  PreloadedTraceLoader::Preload(trace_loader, &preloaded_trace_);
+  // Deleting the loader joins its helper threads, which must not be running
+  // when we fork.
+  delete trace_loader;
+  if (!FLAGS_simulation.compare("google")) {
+    // Parse the CSV task events only once, rather than in every run. The
+    // runs replay them like the task events of a binary trace.
+    BinaryTraceConverter converter(FLAGS_trace_path);
+    converter.ReadTaskEvents(FLAGS_num_files_to_process,
+                             &preloaded_trace_.task_events);
+  }
+}
+
+uint32_t SimulatorSweep::Run(uint32_t parallelism) {
+  if (parallelism == 0) {
+    parallelism = max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+  }
+  // Every run maps the binary trace itself: the mapping is shared through
+  // the page cache and the runs look up the tasks' runtimes and statistics
+  // in place.
+  trace_preloaded_ = FLAGS_simulation.compare("binary") != 0;
+  if (trace_preloaded_) {
+    LOG(INFO) << "Loading the trace for " << runs_.size() << " sweep runs";
+    PreloadTrace();
+  }
+  if (FLAGS_generate_trace) {
+    MkdirIfNotPresent(FLAGS_generated_trace_path);
+  }
+  map<pid_t, const SweepRun*> running_runs;
+  uint32_t num_failed_runs = 0;
+  vector<SweepRun>::const_iterator next_run = runs_.begin();
+  while (next_run != runs_.end() || !running_runs.empty()) {
+    if (next_run != runs_.end() && running_runs.size() < parallelism) {
+      pid_t pid = StartRun(*next_run);
+      LOG(INFO) << "Started " << next_run->name << " (pid " << pid << "): "
+                << next_run->config;
+      running_runs[pid] = &(*next_run);
+      ++next_run;
+      continue;
+    }
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      PLOG(FATAL) << "Failed to wait for the sweep runs";
+    }
+    map<pid_t, const SweepRun*>::iterator it = running_runs.find(pid);
+    if (it == running_runs.end()) {
+      continue;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+      LOG(INFO) << it->second->name << " completed";
+    } else {
+      LOG(ERROR) << it->second->name << " failed with status " << status;
+      num_failed_runs++;
+    }
+    running_runs.erase(it);
+  }
+  LOG(INFO) << "Sweep completed; " << num_failed_runs << " of "
+            << runs_.size() << " runs failed";
+  return num_failed_runs;
+}
+
+int32_t SimulatorSweep::RunConfiguration(const SweepRun& run) {
+  if (!SetRunFlags(run)) {
+    return 1;
+  }
+  if (FLAGS_generate_trace) {
+    // Every run writes its own trace.
+    FLAGS_generated_trace_path += "/" + run.name;
+  }
+  Simulator simulator;
+  if (trace_preloaded_) {
+    simulator.set_preloaded_trace(&preloaded_trace_);
+  }
+  simulator.Run();
+  return 0;
+}
+
+bool SimulatorSweep::SetRunFlags(const SweepRun& run) {
+  vector<pair<string, string>> pending_flags = run.flags;
+  while (!pending_flags.empty()) {
+    vector<pair<string, string>> failed_flags;
+    for (auto& flag : pending_flags) {
+      if (google::SetCommandLineOption(flag.first.c_str(),
+                                       flag.second.c_str()).empty()) {
+        failed_flags.push_back(flag);
+      }
+    }
+    if (failed_flags.size() == pending_flags.size()) {
+      for (auto& flag : failed_flags) {
+        LOG(ERROR) << "Could not set --" << flag.first << "=" << flag.second
+                   << " for " << run.name;
+      }
+      return false;
+    }
+    pending_flags.swap(failed_flags);
+  }
+  return true;
+}
+
+pid_t SimulatorSweep::StartRun(const SweepRun& run) {
+  // Flush the buffered output so that the child does not write it again.
+  fflush(NULL);
+  pid_t pid = fork();
+  if (pid < 0) {
+    PLOG(FATAL) << "Failed to fork the process for " << run.name;
+  } else if (pid == 0) {
+    int32_t status = RunConfiguration(run);
+    // The child must not run the parent's atexit handlers and static
+    // destructors, so we flush its output and leave with _exit.
+    fflush(NULL);
+    google::FlushLogFiles(google::GLOG_INFO);
+    _exit(status);
+  }
+  return pid;
+}
+
+}  // namespace sim
+}  // namespace firmament
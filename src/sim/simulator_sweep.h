@@ -0,0 +1,104 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Runs the simulator with several flag configurations. The trace is loaded
+// once, and every configuration is replayed in a worker process forked from
+// the loading process, so that the runs share the loaded trace and each run
+// has its own copy of the flags.
+
+#ifndef FIRMAMENT_SIM_SIMULATOR_SWEEP_H
+#define FIRMAMENT_SIM_SIMULATOR_SWEEP_H
+
+#include <sys/types.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/common.h"
+#include "sim/preloaded_trace_loader.h"
+
+namespace firmament {
+namespace sim {
+
+struct SweepRun {
+  // Name of the run, which is also the name of its generated trace directory.
+  string name;
+  // The configuration line of the run.
+  string config;
+  // Flag names and values to set for the run.
+  vector<pair<string, string>> flags;
+};
+
+class SimulatorSweep {
+ public:
+  SimulatorSweep();
+
+  /**
+   * Parses a sweep configuration line. The line is a whitespace-separated
+   * list of --flag=value settings; a --flag without a value sets a boolean
+   * flag to true. Flags that affect how the trace is loaded cannot be set,
+   * because the trace is shared by all the runs.
+   * @param line the configuration line
+   * @param run the run to add the flags to
+   * @return false if the line is malformed
+   */
+  static bool ParseSweepRun(const string& line, SweepRun* run);
+
+  /**
+   * Reads the sweep configurations, one per line. Empty lines and lines
+   * starting with # are skipped.
+   * @param config_file the path of the sweep configuration file
+   * @return false if the file cannot be read or a line is malformed
+   */
+  bool LoadConfigurations(const string& config_file);
+
+  /**
+   * Loads the trace and replays it once for every configuration.
+   * @param parallelism the maximum number of runs to execute at the same time
+   * @return the number of runs that have failed
+   */
+  uint32_t Run(uint32_t parallelism);
+
+ private:
+  void PreloadTrace();
+  /**
+   * Executes a run in the calling process.
+   * @return the exit status of the run
+   */
+  int32_t RunConfiguration(const SweepRun& run);
+  /**
+   * Sets the flags of a run. Flags whose validators fail are retried after
+   * the other flags have been set, as validators may check other flags.
+   * @return false if a flag could not be set
+   */
+  bool SetRunFlags(const SweepRun& run);
+  pid_t StartRun(const SweepRun& run);
+
+  PreloadedTrace preloaded_trace_;
+  // False if the runs load the trace themselves.
+  bool trace_preloaded_;
+  vector<SweepRun> runs_;
+};
+
+}  // namespace sim
+}  // namespace firmament
+
+#endif  // FIRMAMENT_SIM_SIMULATOR_SWEEP_H
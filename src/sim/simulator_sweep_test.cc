@@ -0,0 +1,65 @@
+/*
+ * Firmament
+ * Copyright (c) The Firmament Authors.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR
+ * A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+// Tests for parsing simulator sweep configurations.
+
+#include <gtest/gtest.h>
+
+#include "sim/simulator_sweep.h"
+
+DEFINE_string(scheduler, "flow", "The scheduler to use for tests.");
+
+namespace firmament {
+namespace sim {
+
+TEST(SimulatorSweepTest, ParseSweepRun) {
+  SweepRun run;
+  ASSERT_TRUE(SimulatorSweep::ParseSweepRun(
+      "  --batch_step=1000\t--solver=cs2  --run_incremental_scheduler ",
+      &run));
+  EXPECT_EQ(run.config,
+            "--batch_step=1000\t--solver=cs2  --run_incremental_scheduler");
+  ASSERT_EQ(run.flags.size(), 3);
+  EXPECT_EQ(run.flags[0].first, "batch_step");
+  EXPECT_EQ(run.flags[0].second, "1000");
+  EXPECT_EQ(run.flags[1].first, "solver");
+  EXPECT_EQ(run.flags[1].second, "cs2");
+  // Boolean flags without a value are set to true.
+  EXPECT_EQ(run.flags[2].first, "run_incremental_scheduler");
+  EXPECT_EQ(run.flags[2].second, "true");
+}
+
+TEST(SimulatorSweepTest, RejectInvalidSettings) {
+  SweepRun run;
+  EXPECT_FALSE(SimulatorSweep::ParseSweepRun("batch_step=1000", &run));
+  EXPECT_FALSE(SimulatorSweep::ParseSweepRun("--no_such_flag=1", &run));
+  // The runs share the loaded trace.
+  EXPECT_FALSE(SimulatorSweep::ParseSweepRun("--runtime=1000", &run));
+  EXPECT_FALSE(SimulatorSweep::ParseSweepRun("--synthetic_num_jobs=5", &run));
+}
+
+}  // namespace sim
+}  // namespace firmament
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  FLAGS_logtostderr = true;
+  return RUN_ALL_TESTS();
+}
@@ -280,5 +280,15 @@ void SyntheticTraceLoader::LoadTasksRunningTime(
   }
 }
 
+void SyntheticTraceLoader::RestoreTaskEventsPosition(
+    const TraceLoaderPosition& position) {
+  last_generated_job_id_ = position.last_generated_job_id();
+}
+
+void SyntheticTraceLoader::SaveTaskEventsPosition(
+    TraceLoaderPosition* position) {
+  position->set_last_generated_job_id(last_generated_job_id_);
+}
+
 } // namespace sim
 } // namespace firmament
@@ -41,6 +41,8 @@ class SyntheticTraceLoader : public TraceLoader {
       const unordered_map<TaskID_t, uint64_t>& task_runtimes);
   void LoadTasksRunningTime(
       unordered_map<TaskID_t, uint64_t>* task_runtime);
+  void RestoreTaskEventsPosition(const TraceLoaderPosition& position);
+  void SaveTaskEventsPosition(TraceLoaderPosition* position);
  private:
   void GetNumberOfSlots(const ResourceTopologyNodeDescriptor& rtnd,
                         uint64_t* num_slots);
@@ -23,8 +23,11 @@
 #ifndef FIRMAMENT_SIM_TRACE_LOADER_H
 #define FIRMAMENT_SIM_TRACE_LOADER_H
 
+#include <map>
+
 #include "base/common.h"
 #include "sim/event_manager.h"
+#include "sim/simulation_checkpoint.pb.h"
 #include "sim/trace_utils.h"
 
 namespace firmament {
@@ -39,6 +42,30 @@ class TraceLoader {
     // We don't delete event_manager_ because it is owned by the simulator.
   }
 
+  /**
+   * Looks up the runtime of a task in the trace. Loaders that serve the
+   * runtimes from the trace in place only load the runtimes that are not in
+   * the trace (e.g., the synthetic job's) in LoadTasksRunningTime, and return
+   * the others from this method.
+   * @param task_id the id of the task
+   * @param runtime set to the runtime of the task
+   * @return false if the loader does not have a runtime for the task
+   */
+  virtual bool FindTaskRuntime(TaskID_t task_id, uint64_t* runtime) {
+    return false;
+  }
+
+  /**
+   * Looks up the usage statistics of a task in the trace, like
+   * FindTaskRuntime does for the runtimes.
+   * @param task_id the id of the task
+   * @param task_stats set to the statistics of the task
+   * @return false if the loader does not have statistics for the task
+   */
+  virtual bool FindTaskStats(TaskID_t task_id, TraceTaskStats* task_stats) {
+    return false;
+  }
+
   virtual void LoadJobsNumTasks(
       unordered_map<uint64_t, uint64_t>* job_num_tasks) = 0;
 
@@ -66,10 +93,26 @@ class TraceLoader {
 
   /**
    * Loads all the task runtimes and returns map task_identifier -> runtime.
+   * Loaders that implement FindTaskRuntime only load the runtimes that it
+   * does not return.
    */
   virtual void LoadTasksRunningTime(
       unordered_map<TaskID_t, uint64_t>* task_runtime) = 0;
 
+  /**
+   * Continues loading the task events from a position saved in a checkpoint.
+   * Must be called before any task events are loaded.
+   * @param position the position to continue from
+   */
+  virtual void RestoreTaskEventsPosition(
+      const TraceLoaderPosition& position) = 0;
+
+  /**
+   * Saves the position up to which the task events have been loaded.
+   * @param position the position to save to
+   */
+  virtual void SaveTaskEventsPosition(TraceLoaderPosition* position) = 0;
+
  protected:
   EventManager* event_manager_;
 };
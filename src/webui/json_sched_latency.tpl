@@ -0,0 +1,26 @@
+{
+  "rounds": {{SCHED_ROUNDS}},
+  "phases": [
+    {{#PHASE_DATA}}
+    {
+      "name": "{{PHASE_NAME}}",
+      "mean_us": {{PHASE_MEAN}},
+      "p50_us": {{PHASE_P50}},
+      "p90_us": {{PHASE_P90}},
+      "p99_us": {{PHASE_P99}},
+      "p999_us": {{PHASE_P999}},
+      "max_us": {{PHASE_MAX}}
+    }{{#PHASE_DATA_separator}}, {{/PHASE_DATA_separator}}
+    {{/PHASE_DATA}}
+  ],
+  "admission": {
+    "batches": {{ADMISSION_BATCHES}},
+    "jobs": {{ADMISSION_JOBS}},
+    "mean_us": {{ADMISSION_MEAN}},
+    "p50_us": {{ADMISSION_P50}},
+    "p90_us": {{ADMISSION_P90}},
+    "p99_us": {{ADMISSION_P99}},
+    "p999_us": {{ADMISSION_P999}},
+    "max_us": {{ADMISSION_MAX}}
+  }
+}
@@ -0,0 +1,66 @@
+{{>HEADER}}
+
+{{>PAGE_HEADER}}
+
+<h1>Scheduler latency</h1>
+
+<p>Runtimes of the phases of the {{SCHED_ROUNDS}} scheduling rounds so far, in
+microseconds (<a href="/sched/latency/?json=1">JSON</a>).</p>
+
+<table class="table table-bordered">
+  <thead>
+    <tr>
+      <th>Phase</th>
+      <th>Mean</th>
+      <th>p50</th>
+      <th>p90</th>
+      <th>p99</th>
+      <th>p99.9</th>
+      <th>Max</th>
+    </tr>
+  </thead>
+  <tbody>
+  {{#PHASE_DATA}}
+    <tr>
+      <td>{{PHASE_NAME}}</td>
+      <td>{{PHASE_MEAN}}</td>
+      <td>{{PHASE_P50}}</td>
+      <td>{{PHASE_P90}}</td>
+      <td>{{PHASE_P99}}</td>
+      <td>{{PHASE_P999}}</td>
+      <td>{{PHASE_MAX}}</td>
+    </tr>
+  {{/PHASE_DATA}}
+  </tbody>
+</table>
+
+<h2>Admission delay</h2>
+
+<p>Time the jobs admitted in the {{ADMISSION_BATCHES}} admission batches so far
+({{ADMISSION_JOBS}} jobs) waited for their batch to be scheduled, in
+microseconds.</p>
+
+<table class="table table-bordered">
+  <thead>
+    <tr>
+      <th>Mean</th>
+      <th>p50</th>
+      <th>p90</th>
+      <th>p99</th>
+      <th>p99.9</th>
+      <th>Max</th>
+    </tr>
+  </thead>
+  <tbody>
+    <tr>
+      <td>{{ADMISSION_MEAN}}</td>
+      <td>{{ADMISSION_P50}}</td>
+      <td>{{ADMISSION_P90}}</td>
+      <td>{{ADMISSION_P99}}</td>
+      <td>{{ADMISSION_P999}}</td>
+      <td>{{ADMISSION_MAX}}</td>
+    </tr>
+  </tbody>
+</table>
+
+{{>PAGE_FOOTER}}